@@ -16,6 +16,7 @@
 
 #define LOG_TAG "atrace"
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
@@ -30,8 +31,11 @@
 #include <unistd.h>
 #include <zlib.h>
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <binder/IBinder.h>
 #include <binder/IServiceManager.h>
@@ -260,6 +264,7 @@ static int g_traceDurationSeconds = 5;
 static bool g_traceOverwrite = false;
 static int g_traceBufferSizeKB = 2048;
 static bool g_compress = false;
+static bool g_rawTrace = false;
 static bool g_nohup = false;
 static int g_initialSleepSecs = 0;
 static const char* g_categoriesFile = nullptr;
@@ -324,6 +329,15 @@ static const char* k_tracePath =
 static const char* k_traceStreamPath =
     "trace_pipe";
 
+static const char* k_traceEventsPath =
+    "events/";
+
+static const char* k_traceCmdlinesPath =
+    "saved_cmdlines";
+
+static const char* k_tracePrintkFormatsPath =
+    "printk_formats";
+
 static const char* k_traceMarkerPath =
     "trace_marker";
 
@@ -968,29 +982,108 @@ static void stopTrace()
     setTracingEnabled(false);
 }
 
+// Copies the tracing pipe to stdout through userspace, for when splice isn't supported.
+static void copyTraceStream(int traceFD)
+{
+    char trace_data[64 * 1024];
+    while (!g_traceAborted) {
+        ssize_t bytes_read = read(traceFD, trace_data, sizeof(trace_data));
+        if (bytes_read > 0) {
+            if (!android::base::WriteFully(STDOUT_FILENO, trace_data, bytes_read)) {
+                fprintf(stderr, "error writing trace: %s (%d)\n", strerror(errno), errno);
+                break;
+            }
+        } else if (bytes_read == -1 && errno == EINTR) {
+            continue;
+        } else {
+            if (!g_traceAborted) {
+                fprintf(stderr, "read returned %zd bytes err %d (%s)\n",
+                        bytes_read, errno, strerror(errno));
+            }
+            break;
+        }
+    }
+}
+
 // Read data from the tracing pipe and forward to stdout
 static void streamTrace()
 {
-    char trace_data[4096];
     int traceFD = open((g_traceFolder + k_traceStreamPath).c_str(), O_RDWR);
     if (traceFD == -1) {
         fprintf(stderr, "error opening %s: %s (%d)\n", k_traceStreamPath,
                 strerror(errno), errno);
         return;
     }
-    while (!g_traceAborted) {
-        ssize_t bytes_read = read(traceFD, trace_data, 4096);
-        if (bytes_read > 0) {
-            write(STDOUT_FILENO, trace_data, bytes_read);
-            fflush(stdout);
-        } else {
+    fflush(stdout);
+
+    // Move the trace to stdout with splice through a pipe, so that the data never has to be
+    // copied through userspace and a busy device doesn't overrun the kernel buffer while
+    // we're copying. Fall back to read/write if splice isn't supported for stdout.
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) == -1) {
+        fprintf(stderr, "error creating pipe: %s (%d)\n", strerror(errno), errno);
+        copyTraceStream(traceFD);
+        close(traceFD);
+        return;
+    }
+    fcntl(pipeFds[1], F_SETPIPE_SZ, 1024 * 1024);
+    int pipeSize = fcntl(pipeFds[1], F_GETPIPE_SZ);
+    if (pipeSize <= 0) {
+        pipeSize = 64 * 1024;
+    }
+
+    bool spliced = false;
+    bool fallback = false;
+    bool failed = false;
+    while (!g_traceAborted && !fallback && !failed) {
+        ssize_t bytes_in = splice(traceFD, nullptr, pipeFds[1], nullptr, pipeSize, SPLICE_F_MOVE);
+        if (bytes_in == -1 && errno == EINTR) {
+            continue;
+        } else if (bytes_in == -1 && errno == EINVAL && !spliced) {
+            fallback = true;
+            break;
+        } else if (bytes_in <= 0) {
             if (!g_traceAborted) {
-                fprintf(stderr, "read returned %zd bytes err %d (%s)\n",
-                        bytes_read, errno, strerror(errno));
+                fprintf(stderr, "splice returned %zd bytes err %d (%s)\n",
+                        bytes_in, errno, strerror(errno));
             }
             break;
         }
+
+        while (bytes_in > 0) {
+            ssize_t bytes_out = splice(pipeFds[0], nullptr, STDOUT_FILENO, nullptr, bytes_in,
+                                       SPLICE_F_MOVE);
+            if (bytes_out == -1 && errno == EINTR) {
+                continue;
+            } else if (bytes_out == -1 && errno == EINVAL && !spliced) {
+                // stdout can't be spliced to: write out what is in the pipe, then copy.
+                char trace_data[4096];
+                ssize_t rc;
+                while (bytes_in > 0 &&
+                       (rc = TEMP_FAILURE_RETRY(read(pipeFds[0], trace_data,
+                                                     sizeof(trace_data)))) > 0) {
+                    android::base::WriteFully(STDOUT_FILENO, trace_data, rc);
+                    bytes_in -= rc;
+                }
+                fallback = true;
+                break;
+            } else if (bytes_out <= 0) {
+                fprintf(stderr, "error writing trace: %s (%d)\n", strerror(errno), errno);
+                failed = true;
+                break;
+            }
+            spliced = true;
+            bytes_in -= bytes_out;
+        }
     }
+
+    if (fallback) {
+        copyTraceStream(traceFD);
+    }
+
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    close(traceFD);
 }
 
 // Read the current kernel trace and write it to stdout.
@@ -1097,6 +1190,186 @@ static void dumpTrace(int outFd)
     close(traceFD);
 }
 
+// Appends the bytes of value to buf, in host byte order.
+template <typename T>
+static void appendRaw(std::string* buf, T value)
+{
+    buf->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Appends a section with the contents of a tracing file, preceded by its size in a
+// SizeType. A file that can't be read is written as empty.
+template <typename SizeType>
+static void appendFileSection(std::string* buf, const std::string& path)
+{
+    std::string content;
+    android::base::ReadFileToString(path, &content);
+    appendRaw<SizeType>(buf, content.size());
+    buf->append(content);
+}
+
+// Returns the names of the subdirectories of path, sorted.
+static std::vector<std::string> listSubdirectories(const std::string& path)
+{
+    std::vector<std::string> names;
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return names;
+    }
+    dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_type == DT_DIR && strcmp(entry->d_name, ".") != 0 &&
+                strcmp(entry->d_name, "..") != 0) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Appends the format files of the events in an event system directory. Unless all is set,
+// only the events that are enabled are included, since no others can be in the trace.
+static void appendEventFormats(std::string* buf, const std::string& systemPath, bool all,
+        uint32_t* count)
+{
+    std::string formats;
+    *count = 0;
+    for (const std::string& event : listSubdirectories(systemPath)) {
+        std::string eventPath = systemPath + event + "/";
+        std::string enable;
+        if (!all && android::base::ReadFileToString(eventPath + "enable", &enable) &&
+                enable.compare(0, 1, "1") != 0) {
+            continue;
+        }
+        std::string format;
+        if (!android::base::ReadFileToString(eventPath + "format", &format)) {
+            continue;
+        }
+        appendRaw<uint64_t>(&formats, format.size());
+        formats.append(format);
+        (*count)++;
+    }
+    buf->append(formats);
+}
+
+// Reads the unconsumed pages of a CPU's ring buffer, as the kernel stores them.
+static bool readRawCpuBuffer(const std::string& path, size_t pageSize, std::string* data)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        fprintf(stderr, "error opening %s: %s (%d)\n", path.c_str(), strerror(errno), errno);
+        return false;
+    }
+    std::unique_ptr<char[]> page(new char[pageSize]);
+    ssize_t rc;
+    while ((rc = TEMP_FAILURE_RETRY(read(fd, page.get(), pageSize))) > 0) {
+        data->append(page.get(), rc);
+        // A short page is the one the kernel was still writing to.
+        data->append(pageSize - rc, '\0');
+    }
+    bool ok = rc == 0 || errno == EAGAIN;
+    if (!ok) {
+        fprintf(stderr, "error reading %s: %s (%d)\n", path.c_str(), strerror(errno), errno);
+    }
+    close(fd);
+    return ok;
+}
+
+// Writes the kernel trace to outFd in the trace-cmd trace.dat (version 6) format, straight
+// from the per-CPU ring buffer pages. The kernel doesn't have to format any event, and the
+// binary events are several times smaller than their text. The file can be decoded offline
+// with trace-cmd report or any other tool that reads trace.dat.
+//
+// The layout is: magic, version, endianness, sizeof(long), page size, the header_page and
+// header_event files, the ftrace and enabled event formats grouped by system, kallsyms
+// (left empty), printk_formats, saved_cmdlines, the CPU count, an empty options section, and
+// a "flyrecord" table with the offset and size of each CPU's page-aligned ring buffer data.
+static void dumpRawTrace(int outFd)
+{
+    ALOGI("Dumping raw trace");
+    const std::string eventsPath = g_traceFolder + k_traceEventsPath;
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    std::string buf("\027\010\104tracing", 10);
+    buf.append("6", 2);
+    uint16_t endianTest = 1;
+    appendRaw<uint8_t>(&buf, *reinterpret_cast<uint8_t*>(&endianTest) == 1 ? 0 : 1);
+    appendRaw<uint8_t>(&buf, sizeof(long));
+    appendRaw<uint32_t>(&buf, pageSize);
+
+    buf.append("header_page", 12);
+    appendFileSection<uint64_t>(&buf, eventsPath + "header_page");
+    buf.append("header_event", 13);
+    appendFileSection<uint64_t>(&buf, eventsPath + "header_event");
+
+    std::string formats;
+    uint32_t count;
+    appendEventFormats(&formats, eventsPath + "ftrace/", true, &count);
+    appendRaw<uint32_t>(&buf, count);
+    buf.append(formats);
+
+    std::string systems;
+    uint32_t systemCount = 0;
+    for (const std::string& system : listSubdirectories(eventsPath)) {
+        if (system == "ftrace") {
+            continue;
+        }
+        formats.clear();
+        appendEventFormats(&formats, eventsPath + system + "/", false, &count);
+        if (count == 0) {
+            continue;
+        }
+        systems.append(system.c_str(), system.size() + 1);
+        appendRaw<uint32_t>(&systems, count);
+        systems.append(formats);
+        systemCount++;
+    }
+    appendRaw<uint32_t>(&buf, systemCount);
+    buf.append(systems);
+
+    appendRaw<uint32_t>(&buf, 0);
+    appendFileSection<uint32_t>(&buf, g_traceFolder + k_tracePrintkFormatsPath);
+    appendFileSection<uint64_t>(&buf, g_traceFolder + k_traceCmdlinesPath);
+
+    // The ring buffers are held in memory until the offsets are known. They are no larger
+    // than the buffer size the trace was taken with.
+    std::vector<std::string> cpuData;
+    for (int cpu = 0;; cpu++) {
+        std::string path = g_traceFolder +
+                android::base::StringPrintf("per_cpu/cpu%d/trace_pipe_raw", cpu);
+        if (!fileExists(path.c_str())) {
+            break;
+        }
+        cpuData.emplace_back();
+        if (!readRawCpuBuffer(path, pageSize, &cpuData.back())) {
+            return;
+        }
+    }
+    appendRaw<uint32_t>(&buf, cpuData.size());
+
+    buf.append("options  ", 10);
+    appendRaw<uint16_t>(&buf, 0);
+    buf.append("flyrecord", 10);
+
+    uint64_t offset = buf.size() + cpuData.size() * 2 * sizeof(uint64_t);
+    offset = (offset + pageSize - 1) / pageSize * pageSize;
+    for (const std::string& data : cpuData) {
+        appendRaw<uint64_t>(&buf, offset);
+        appendRaw<uint64_t>(&buf, data.size());
+        offset += data.size();
+    }
+    buf.append((pageSize - buf.size() % pageSize) % pageSize, '\0');
+
+    bool ok = android::base::WriteFully(outFd, buf.data(), buf.size());
+    for (const std::string& data : cpuData) {
+        ok = ok && android::base::WriteFully(outFd, data.data(), data.size());
+    }
+    if (!ok) {
+        fprintf(stderr, "error writing raw trace: %s (%d)\n", strerror(errno), errno);
+    }
+}
+
 static void handleSignal(int /*signo*/)
 {
     if (!g_nohup) {
@@ -1145,6 +1418,8 @@ static void showHelp(const char *cmd)
                     "  -s N            sleep for N seconds before tracing [default 0]\n"
                     "  -t N            trace for N seconds [default 5]\n"
                     "  -z              compress the trace dump\n"
+                    "  --raw           dump the binary ring buffers as a trace-cmd trace.dat\n"
+                    "                    file, to be decoded offline; requires -o\n"
                     "  --async_start   start circular trace and return immediately\n"
                     "  --async_dump    dump the current contents of circular trace buffer\n"
                     "  --async_stop    stop tracing and dump the current contents of circular\n"
@@ -1287,6 +1562,7 @@ int main(int argc, char **argv)
             {"only_userspace",    no_argument, nullptr,  0 },
             {"list_categories",   no_argument, nullptr,  0 },
             {"stream",            no_argument, nullptr,  0 },
+            {"raw",               no_argument, nullptr,  0 },
             {nullptr,                       0, nullptr,  0 }
         };
 
@@ -1362,6 +1638,8 @@ int main(int argc, char **argv)
                 } else if (!strcmp(long_options[option_index].name, "stream")) {
                     traceStream = true;
                     traceDump = false;
+                } else if (!strcmp(long_options[option_index].name, "raw")) {
+                    g_rawTrace = true;
                 } else if (!strcmp(long_options[option_index].name, "list_categories")) {
                     listSupportedCategories();
                     exit(0);
@@ -1384,6 +1662,11 @@ int main(int argc, char **argv)
         }
     }
 
+    if (g_rawTrace && (g_compress || g_outputFile == nullptr)) {
+        fprintf(stderr, "--raw requires -o and can't be used with -z\n");
+        exit(1);
+    }
+
     registerSigHandler();
 
     if (g_initialSleepSecs > 0) {
@@ -1450,8 +1733,12 @@ int main(int argc, char **argv)
             if (outFd == -1) {
                 printf("Failed to open '%s', err=%d", g_outputFile, errno);
             } else {
-                dprintf(outFd, "TRACE:\n");
-                dumpTrace(outFd);
+                if (g_rawTrace) {
+                    dumpRawTrace(outFd);
+                } else {
+                    dprintf(outFd, "TRACE:\n");
+                    dumpTrace(outFd);
+                }
                 if (g_outputFile) {
                     close(outFd);
                 }
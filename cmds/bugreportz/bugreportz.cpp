@@ -73,3 +73,26 @@ int bugreportz(int s, bool show_progress) {
 
     return EXIT_SUCCESS;
 }
+
+int bugreportz_stream(int s) {
+    while (1) {
+        char buffer[65536];
+        ssize_t bytes_read = TEMP_FAILURE_RETRY(read(s, buffer, sizeof(buffer)));
+        if (bytes_read == 0) {
+            break;
+        } else if (bytes_read == -1) {
+            // EAGAIN really means time out, so change the errno.
+            if (errno == EAGAIN) {
+                errno = ETIMEDOUT;
+            }
+            fprintf(stderr, "Bugreport read terminated abnormally (%s)\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        if (!android::base::WriteFully(STDOUT_FILENO, buffer, bytes_read)) {
+            fprintf(stderr, "Failed to write data to stdout: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -84,6 +84,21 @@ class BugreportzTest : public ::testing::Test {
         ASSERT_EQ(0, status) << "bugrepotz() call failed (stdout: " << stdout_ << ")";
     }
 
+    // Same as Bugreportz(), but calls bugreportz_stream().
+    void BugreportzStream() {
+        close(write_fd_);
+        write_fd_ = -1;
+
+        CaptureStdout();
+        int status = bugreportz_stream(read_fd_);
+
+        close(read_fd_);
+        read_fd_ = -1;
+        stdout_ = GetCapturedStdout();
+
+        ASSERT_EQ(0, status) << "bugreportz_stream() call failed (stdout: " << stdout_ << ")";
+    }
+
   private:
     int read_fd_;
     int write_fd_;
@@ -126,3 +141,13 @@ TEST_F(BugreportzTest, WithProgress) {
         "PROGRESS:IS NOT AUTOMATIC\n"
         "Newline is optional");
 }
+
+// Tests 'bugreportz -s' - it will copy everything dumpstate writes, including progress-like lines.
+TEST_F(BugreportzTest, Stream) {
+    WriteToSocket(std::string("PK\x03\x04\0zip", 8));
+    WriteToSocket("PROGRESS:NOT A LINE\n");
+
+    BugreportzStream();
+
+    AssertStdoutEquals(std::string("PK\x03\x04\0zipPROGRESS:NOT A LINE\n", 28));
+}
@@ -18,6 +18,10 @@
 
 #include "DumpstateSectionReporter.h"
 
+#include <android-base/stringprintf.h>
+
+#include "DumpstateTimeline.h"
+
 namespace android {
 namespace os {
 namespace dumpstate {
@@ -30,9 +34,20 @@ DumpstateSectionReporter::DumpstateSectionReporter(const std::string& title,
 }
 
 DumpstateSectionReporter::~DumpstateSectionReporter() {
+    auto now = std::chrono::steady_clock::now();
+    std::string status;
+    if (status_ == TIMED_OUT) {
+        status = "timed out";
+    } else if (status_ != OK) {
+        status = android::base::StringPrintf("error %d", status_);
+    }
+    DumpstateTimeline::GetInstance().AddEvent(
+        title_, "dumpsys",
+        std::chrono::duration_cast<std::chrono::nanoseconds>(started_.time_since_epoch()).count(),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count(),
+        status);
     if ((listener_ != nullptr) && (sendReport_)) {
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - started_);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - started_);
         listener_->onSectionComplete(title_, status_, size_, (int32_t)elapsed.count());
     }
 }
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "dumpstate"
+
+#include "DumpstateTimeline.h"
+
+#include <inttypes.h>
+#include <unistd.h>
+
+#include <android-base/stringprintf.h>
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+namespace {
+
+// Appends s to out as the contents of a JSON string.
+void AppendJsonString(std::string* out, const std::string& s) {
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out->push_back('\\');
+            out->push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            android::base::StringAppendF(out, "\\u%04x", c);
+        } else {
+            out->push_back(c);
+        }
+    }
+}
+
+}  // namespace
+
+DumpstateTimeline& DumpstateTimeline::GetInstance() {
+    static DumpstateTimeline timeline;
+    return timeline;
+}
+
+void DumpstateTimeline::AddEvent(const std::string& name, const char* category, uint64_t start_ns,
+                                 uint64_t end_ns, const std::string& status) {
+    pid_t tid = gettid();
+    std::lock_guard<std::mutex> lock(lock_);
+    events_.push_back({name, category, start_ns, end_ns, tid, status});
+}
+
+std::string DumpstateTimeline::ToJson() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::string json = "{\"traceEvents\":[";
+    bool first = true;
+    for (const Event& event : events_) {
+        json.append(first ? "\n" : ",\n");
+        first = false;
+        json.append("{\"name\":\"");
+        AppendJsonString(&json, event.name);
+        android::base::StringAppendF(
+            &json, "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" PRIu64 ",\"dur\":%" PRIu64
+                   ",\"pid\":%d,\"tid\":%d",
+            event.category, event.start_ns / 1000, (event.end_ns - event.start_ns) / 1000,
+            getpid(), event.tid);
+        if (!event.status.empty()) {
+            json.append(",\"args\":{\"status\":\"");
+            AppendJsonString(&json, event.status);
+            json.append("\"}");
+        }
+        json.append("}");
+    }
+    json.append("\n],\"displayTimeUnit\":\"ms\"}\n");
+    return json;
+}
+
+void DumpstateTimeline::Clear() {
+    std::lock_guard<std::mutex> lock(lock_);
+    events_.clear();
+}
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_OS_DUMPSTATETIMELINE_H_
+#define ANDROID_OS_DUMPSTATETIMELINE_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+/*
+ * Records when each dumpstate section, command and dumpsys service ran, and on which thread, so
+ * the bugreport can include a timeline of where its time went. The timeline is written in the
+ * Chrome trace event JSON format, which chrome://tracing and Perfetto can open.
+ *
+ * Typical usage:
+ *
+ *    DumpstateTimeline::GetInstance().AddEvent(title, "section", start_ns, Nanotime());
+ *
+ */
+class DumpstateTimeline {
+  public:
+    static DumpstateTimeline& GetInstance();
+
+    // Records an event that ran on the calling thread from start_ns to end_ns (CLOCK_MONOTONIC).
+    // A non-empty status, such as "timed out", is shown with the event.
+    void AddEvent(const std::string& name, const char* category, uint64_t start_ns,
+                  uint64_t end_ns, const std::string& status = "");
+
+    // Returns the events recorded so far, as a Chrome trace event JSON object.
+    std::string ToJson() const;
+
+    // Drops the events recorded so far.
+    void Clear();
+
+  private:
+    struct Event {
+        std::string name;
+        const char* category;
+        uint64_t start_ns;
+        uint64_t end_ns;
+        pid_t tid;
+        std::string status;
+    };
+
+    mutable std::mutex lock_;
+    std::vector<Event> events_;
+};
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
+
+#endif  // ANDROID_OS_DUMPSTATETIMELINE_H_
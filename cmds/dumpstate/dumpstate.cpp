@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/poll.h>
+#include <sys/mman.h>
 #include <sys/prctl.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
@@ -39,9 +40,11 @@
 #include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <regex>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -70,6 +73,7 @@
 #include "DumpstateInternal.h"
 #include "DumpstateSectionReporter.h"
 #include "DumpstateService.h"
+#include "DumpstateTimeline.h"
 #include "dumpstate.h"
 
 using ::android::hardware::dumpstate::V1_0::IDumpstateDevice;
@@ -94,6 +98,7 @@ using android::os::IDumpstateListener;
 using android::os::dumpstate::CommandOptions;
 using android::os::dumpstate::DumpFileToFd;
 using android::os::dumpstate::DumpstateSectionReporter;
+using android::os::dumpstate::DumpstateTimeline;
 using android::os::dumpstate::GetPidByName;
 using android::os::dumpstate::PropertiesHelper;
 
@@ -793,6 +798,16 @@ static const std::set<std::string> PROBLEMATIC_FILE_EXTENSIONS = {
       ".shb", ".sys", ".vb",  ".vbe", ".vbs", ".vxd", ".wsc", ".wsf", ".wsh"
 };
 
+// List of file extensions whose contents are already compressed, so they're stored in the zip
+// file instead of being deflated again.
+static const std::set<std::string> COMPRESSED_FILE_EXTENSIONS = {
+      ".apk", ".br", ".bz2", ".gz", ".jpeg", ".jpg", ".lz4", ".png", ".webp", ".xz", ".zip",
+      ".zst"
+};
+
+// Zip entries that take longer than this to add are reported in the log.
+static constexpr std::chrono::milliseconds SLOW_ZIP_ENTRY_DURATION = 1s;
+
 status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
                                       std::chrono::milliseconds timeout = 0ms) {
     if (!IsZipping()) {
@@ -801,6 +816,7 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
         return INVALID_OPERATION;
     }
     std::string valid_name = entry_name;
+    size_t flags = ZipWriter::kCompress;
 
     // Rename extension if necessary.
     size_t idx = entry_name.rfind('.');
@@ -811,11 +827,14 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
             valid_name = entry_name + ".renamed";
             MYLOGI("Renaming entry %s to %s\n", entry_name.c_str(), valid_name.c_str());
         }
+        if (COMPRESSED_FILE_EXTENSIONS.count(extension) != 0) {
+            flags = 0;
+        }
     }
 
-    // Logging statement  below is useful to time how long each entry takes, but it's too verbose.
-    // MYLOGD("Adding zip entry %s\n", entry_name.c_str());
-    int32_t err = zip_writer_->StartEntryWithTime(valid_name.c_str(), ZipWriter::kCompress,
+    // Logging every entry is useful to time how long each entry takes, but it's too verbose; only
+    // the slow ones are logged below.
+    int32_t err = zip_writer_->StartEntryWithTime(valid_name.c_str(), flags,
                                                   get_mtime(fd, ds.now_));
     if (err != 0) {
         MYLOGE("zip_writer_->StartEntryWithTime(%s): %s\n", valid_name.c_str(),
@@ -880,6 +899,14 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
         return UNKNOWN_ERROR;
     }
 
+    auto duration = std::chrono::steady_clock::now() - start;
+    if (duration >= SLOW_ZIP_ENTRY_DURATION) {
+        MYLOGD("Adding zip entry %s took %lldms (%s)\n", valid_name.c_str(),
+               static_cast<long long>(
+                   std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()),
+               flags == 0 ? "stored" : "deflated");
+    }
+
     return OK;
 }
 
@@ -1321,6 +1348,12 @@ static void DumpHals() {
 static Dumpstate::RunStatus dumpstate() {
     DurationReporter duration_reporter("DUMPSTATE");
 
+    // The board HAL often takes many seconds, so let it run alongside the sections below. If
+    // dumping stops early, its files are dropped.
+    ds.StartDumpstateBoard();
+    auto board_guard =
+            android::base::make_scope_guard([] { ds.dumpstate_board_task_.reset(); });
+
     // Dump various things. Note that anything that takes "long" (i.e. several seconds) should
     // check intermittently (if it's intrerruptable like a foreach on pids) and/or should be wrapped
     // in a consent check (via RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK).
@@ -1715,13 +1748,23 @@ Dumpstate::RunStatus Dumpstate::DumpTraces(const char** path) {
         return RunStatus::OK;
     }
 
-    // Number of times process dumping has timed out. If we encounter too many
-    // failures, we'll give up.
-    int timeout_failures = 0;
     bool dalvik_found = false;
 
     const std::set<int> hal_pids = get_interesting_hal_pids();
 
+    struct TraceDump {
+        int pid;
+        bool is_java_process;
+        // Receives the dump, which is copied to fd and closed once the dumps before it are
+        // written.
+        android::base::unique_fd out;
+        bool done = false;
+        bool skipped = true;
+        int ret = -1;
+        uint64_t duration = 0;
+    };
+    std::vector<TraceDump> dumps;
+
     struct dirent* d;
     while ((d = readdir(proc.get()))) {
         RETURN_IF_USER_DENIED_CONSENT();
@@ -1751,36 +1794,123 @@ Dumpstate::RunStatus Dumpstate::DumpTraces(const char** path) {
             // Probably a native process we don't care about, continue.
             continue;
         }
+        dumps.push_back({pid, is_java_process});
+    }
+
+    // A process stuck in the kernel holds up its dump until the timeout, so several dumps are
+    // requested at once. They are written out in /proc order: whichever thread finishes the
+    // dump at the front writes every finished dump from there on, so only the dumps still
+    // waiting on an earlier one stay in memory.
+    static constexpr size_t kMaxConcurrentTraceDumps = 4;
+    std::mutex lock;
+    size_t next = 0;
+    size_t written = 0;
+    bool writing = false;
+    // Number of dumps in a row, in /proc order, that have timed out. Counting in completion
+    // order instead would let the other workers' dumps break up or pad a run. If we encounter
+    // too many failures, we'll give up.
+    int timeout_failures = 0;
+    const TraceDump* slowest = nullptr;
 
-        // If 3 backtrace dumps fail in a row, consider debuggerd dead.
-        if (timeout_failures == 3) {
-            dprintf(fd, "ERROR: Too many stack dump failures, exiting.\n");
-            break;
-        }
-
-        const uint64_t start = Nanotime();
-        const int ret = dump_backtrace_to_file_timeout(
-            pid, is_java_process ? kDebuggerdJavaBacktrace : kDebuggerdNativeBacktrace,
-            is_java_process ? 5 : 20, fd);
-
-        if (ret == -1) {
+    auto write_dump = [&fd](TraceDump* dump) {
+        if (dump->ret == -1) {
             // For consistency, the header and footer to this message match those
             // dumped by debuggerd in the success case.
-            dprintf(fd, "\n---- pid %d at [unknown] ----\n", pid);
+            dprintf(fd, "\n---- pid %d at [unknown] ----\n", dump->pid);
             dprintf(fd, "Dump failed, likely due to a timeout.\n");
-            dprintf(fd, "---- end %d ----", pid);
-            timeout_failures++;
-            continue;
+            dprintf(fd, "---- end %d ----", dump->pid);
+        } else {
+            lseek(dump->out.get(), 0, SEEK_SET);
+            char buf[65536];
+            ssize_t bytes_read;
+            while ((bytes_read = TEMP_FAILURE_RETRY(read(dump->out.get(), buf, sizeof(buf)))) >
+                   0) {
+                if (!android::base::WriteFully(fd.get(), buf, bytes_read)) {
+                    MYLOGE("Failed to write traces of pid %d: %s\n", dump->pid, strerror(errno));
+                    break;
+                }
+            }
+
+            // Write a summary of the elapsed time to the file and continue with the
+            // next process.
+            dprintf(fd, "[dump %s stack %d: %.3fs elapsed]\n",
+                    dump->is_java_process ? "dalvik" : "native", dump->pid,
+                    (float)dump->duration / NANOS_PER_SEC);
         }
+        dump->out.reset();
+    };
 
-        // We've successfully dumped stack traces, reset the failure count
-        // and write a summary of the elapsed time to the file and continue with the
-        // next process.
-        timeout_failures = 0;
+    // Writes every finished dump at the front, unless another thread already is. Called with
+    // guard held.
+    auto write_finished = [&](std::unique_lock<std::mutex>& guard) {
+        if (writing) return;
+        writing = true;
+        while (written < dumps.size() && dumps[written].done) {
+            TraceDump* dump = &dumps[written++];
+            if (dump->skipped) continue;
+            // A successful dump resets the failure count.
+            timeout_failures = dump->ret == -1 ? timeout_failures + 1 : 0;
+            if (slowest == nullptr || dump->duration > slowest->duration) {
+                slowest = dump;
+            }
+            guard.unlock();
+            write_dump(dump);
+            guard.lock();
+        }
+        writing = false;
+    };
+
+    auto dump_all = [&]() {
+        while (true) {
+            TraceDump* dump;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                // If 3 backtrace dumps fail in a row, consider debuggerd dead.
+                if (next == dumps.size() || timeout_failures >= 3) return;
+                dump = &dumps[next++];
+            }
+            dump->out.reset(memfd_create("dumptrace", MFD_CLOEXEC));
+            if (dump->out == -1) {
+                MYLOGE("memfd_create for pid %d: %s\n", dump->pid, strerror(errno));
+            } else {
+                dump->skipped = false;
+                const uint64_t start = Nanotime();
+                dump->ret = dump_backtrace_to_file_timeout(
+                    dump->pid,
+                    dump->is_java_process ? kDebuggerdJavaBacktrace : kDebuggerdNativeBacktrace,
+                    dump->is_java_process ? 5 : 20, dump->out.get());
+                dump->duration = Nanotime() - start;
+            }
 
-        dprintf(fd, "[dump %s stack %d: %.3fs elapsed]\n", is_java_process ? "dalvik" : "native",
-                pid, (float)(Nanotime() - start) / NANOS_PER_SEC);
+            std::unique_lock<std::mutex> guard(lock);
+            dump->done = true;
+            write_finished(guard);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(kMaxConcurrentTraceDumps, dumps.size()); i++) {
+        threads.emplace_back(dump_all);
+    }
+    dump_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    {
+        // Every dump that was started is done by now; the rest were never started.
+        std::unique_lock<std::mutex> guard(lock);
+        write_finished(guard);
+        if (written < dumps.size()) {
+            dprintf(fd, "ERROR: Too many stack dump failures, exiting.\n");
+        }
+    }
+    if (slowest != nullptr) {
+        dprintf(fd, "[dump traces: %zu processes, slowest was pid %d: %.3fs]\n", dumps.size(),
+                slowest->pid, (float)slowest->duration / NANOS_PER_SEC);
+        MYLOGD("Dumped traces of %zu processes; slowest was pid %d (%.3fs)\n", dumps.size(),
+               slowest->pid, (float)slowest->duration / NANOS_PER_SEC);
     }
+    RETURN_IF_USER_DENIED_CONSENT();
 
     if (!dalvik_found) {
         MYLOGE("Warning: no Dalvik processes found to dump stacks\n");
@@ -1790,24 +1920,30 @@ Dumpstate::RunStatus Dumpstate::DumpTraces(const char** path) {
     return RunStatus::OK;
 }
 
-void Dumpstate::DumpstateBoard() {
-    DurationReporter duration_reporter("dumpstate_board()");
-    printf("========================================================\n");
-    printf("== Board\n");
-    printf("========================================================\n");
+using ScopedNativeHandle =
+        std::unique_ptr<native_handle_t, std::function<void(native_handle_t*)>>;
 
-    if (!IsZipping()) {
-        MYLOGD("Not dumping board info because it's not a zipped bugreport\n");
+struct Dumpstate::DumpstateBoardTask {
+    std::vector<std::string> paths;
+    std::vector<android::base::ScopeGuard<std::function<void()>>> remover;
+    // Shared with the HAL call, which may outlive this task if the HAL hangs.
+    std::shared_ptr<native_handle_t> handle;
+    std::future<bool> result;
+    std::chrono::steady_clock::time_point start;
+};
+
+void Dumpstate::StartDumpstateBoard() {
+    if (!IsZipping() || dumpstate_board_task_ != nullptr) {
         return;
     }
 
-    std::vector<std::string> paths;
-    std::vector<android::base::ScopeGuard<std::function<void()>>> remover;
+    auto task = std::make_shared<DumpstateBoardTask>();
     for (int i = 0; i < NUM_OF_DUMPS; i++) {
-        paths.emplace_back(StringPrintf("%s/%s", ds.bugreport_internal_dir_.c_str(),
-                                        kDumpstateBoardFiles[i].c_str()));
-        remover.emplace_back(android::base::make_scope_guard(
-            std::bind([](std::string path) { android::os::UnlinkAndLogOnError(path); }, paths[i])));
+        task->paths.emplace_back(StringPrintf("%s/%s", ds.bugreport_internal_dir_.c_str(),
+                                              kDumpstateBoardFiles[i].c_str()));
+        task->remover.emplace_back(android::base::make_scope_guard(
+            std::bind([](std::string path) { android::os::UnlinkAndLogOnError(path); },
+                      task->paths[i])));
     }
 
     sp<IDumpstateDevice> dumpstate_device(IDumpstateDevice::getService());
@@ -1816,9 +1952,7 @@ void Dumpstate::DumpstateBoard() {
         return;
     }
 
-    using ScopedNativeHandle =
-            std::unique_ptr<native_handle_t, std::function<void(native_handle_t*)>>;
-    ScopedNativeHandle handle(native_handle_create(static_cast<int>(paths.size()), 0),
+    ScopedNativeHandle handle(native_handle_create(static_cast<int>(task->paths.size()), 0),
                               [](native_handle_t* handle) {
                                   native_handle_close(handle);
                                   native_handle_delete(handle);
@@ -1829,25 +1963,26 @@ void Dumpstate::DumpstateBoard() {
     }
 
     // TODO(128270426): Check for consent in between?
-    for (size_t i = 0; i < paths.size(); i++) {
-        MYLOGI("Calling IDumpstateDevice implementation using path %s\n", paths[i].c_str());
+    for (size_t i = 0; i < task->paths.size(); i++) {
+        MYLOGI("Calling IDumpstateDevice implementation using path %s\n", task->paths[i].c_str());
 
         android::base::unique_fd fd(TEMP_FAILURE_RETRY(
-            open(paths[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW,
+            open(task->paths[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW,
                  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)));
         if (fd < 0) {
-            MYLOGE("Could not open file %s: %s\n", paths[i].c_str(), strerror(errno));
+            MYLOGE("Could not open file %s: %s\n", task->paths[i].c_str(), strerror(errno));
             return;
         }
         handle.get()->data[i] = fd.release();
     }
+    task->handle = std::move(handle);
 
     // Given that bugreport is required to diagnose failures, it's better to
     // set an arbitrary amount of timeout for IDumpstateDevice than to block the
     // rest of bugreport. In the timeout case, we will kill dumpstate board HAL
     // and grab whatever dumped
     std::packaged_task<bool()>
-            dumpstate_task([paths, dumpstate_device, &handle]() -> bool {
+            dumpstate_task([dumpstate_device, handle = task->handle]() -> bool {
             android::hardware::Return<void> status = dumpstate_device->dumpstateBoard(handle.get());
             if (!status.isOk()) {
                 MYLOGE("dumpstateBoard failed: %s\n", status.description().c_str());
@@ -1856,29 +1991,53 @@ void Dumpstate::DumpstateBoard() {
             return true;
         });
 
-    auto result = dumpstate_task.get_future();
+    task->result = dumpstate_task.get_future();
+    task->start = std::chrono::steady_clock::now();
     std::thread(std::move(dumpstate_task)).detach();
+    dumpstate_board_task_ = std::move(task);
+}
+
+void Dumpstate::DumpstateBoard() {
+    DurationReporter duration_reporter("dumpstate_board()");
+    printf("========================================================\n");
+    printf("== Board\n");
+    printf("========================================================\n");
+
+    if (!IsZipping()) {
+        MYLOGD("Not dumping board info because it's not a zipped bugreport\n");
+        return;
+    }
 
+    StartDumpstateBoard();
+    std::shared_ptr<DumpstateBoardTask> task = std::move(dumpstate_board_task_);
+    if (task == nullptr) {
+        return;
+    }
+    const std::vector<std::string>& paths = task->paths;
+
+    // The timeout counts from when the HAL was called, which may have been a while ago.
     constexpr size_t timeout_sec = 30;
-    if (result.wait_for(std::chrono::seconds(timeout_sec)) != std::future_status::ready) {
+    if (task->result.wait_until(task->start + std::chrono::seconds(timeout_sec)) !=
+            std::future_status::ready) {
         MYLOGE("dumpstateBoard timed out after %zus, killing dumpstate vendor HAL\n", timeout_sec);
         if (!android::base::SetProperty("ctl.interface_restart",
                                         android::base::StringPrintf("%s/default",
                                                                     IDumpstateDevice::descriptor))) {
             MYLOGE("Couldn't restart dumpstate HAL\n");
         }
-    }
-    // Wait some time for init to kill dumpstate vendor HAL
-    constexpr size_t killing_timeout_sec = 10;
-    if (result.wait_for(std::chrono::seconds(killing_timeout_sec)) != std::future_status::ready) {
-        MYLOGE("killing dumpstateBoard timed out after %zus, continue and "
-               "there might be racing in content\n", killing_timeout_sec);
+        // Wait some time for init to kill dumpstate vendor HAL
+        constexpr size_t killing_timeout_sec = 10;
+        if (task->result.wait_for(std::chrono::seconds(killing_timeout_sec)) !=
+                std::future_status::ready) {
+            MYLOGE("killing dumpstateBoard timed out after %zus, continue and "
+                   "there might be racing in content\n", killing_timeout_sec);
+        }
     }
 
     auto file_sizes = std::make_unique<ssize_t[]>(paths.size());
     for (size_t i = 0; i < paths.size(); i++) {
         struct stat s;
-        if (fstat(handle.get()->data[i], &s) == -1) {
+        if (fstat(task->handle->data[i], &s) == -1) {
             MYLOGE("Failed to fstat %s: %s\n", kDumpstateBoardFiles[i].c_str(),
                    strerror(errno));
             file_sizes[i] = -1;
@@ -1904,7 +2063,7 @@ void Dumpstate::DumpstateBoard() {
 static void ShowUsage() {
     fprintf(stderr,
             "usage: dumpstate [-h] [-b soundfile] [-e soundfile] [-o file] [-d] [-p] "
-            "[-z]] [-s] [-S] [-q] [-B] [-P] [-R] [-V version]\n"
+            "[-z]] [-s] [-S] [-Z] [-q] [-B] [-P] [-R] [-V version]\n"
             "  -h: display this help message\n"
             "  -b: play sound file instead of vibrate, at beginning of job\n"
             "  -e: play sound file instead of vibrate, at end of job\n"
@@ -1914,6 +2073,8 @@ static void ShowUsage() {
             "  -z: generate zipped file (requires -o)\n"
             "  -s: write output to control socket (for init)\n"
             "  -S: write file location to control socket (for init; requires -o and -z)\n"
+            "  -Z: stream the zipped file to the control socket as it is written (for init;\n"
+            "      requires -z, can't be used with -S or -B)\n"
             "  -q: disable vibrate\n"
             "  -B: send broadcast when finished (requires -o)\n"
             "  -P: send broadcast when started and update system properties on "
@@ -1939,6 +2100,9 @@ bool Dumpstate::FinishZipFile() {
     MYLOGD("dumpstate id %d finished around %s (%ld s)\n", ds.id_, date,
            the_real_now_please_stand_up - ds.now_);
 
+    if (!AddTextZipEntry("dumpstate_timeline.json", DumpstateTimeline::GetInstance().ToJson())) {
+        MYLOGE("Failed to add dumpstate_timeline.json to .zip file\n");
+    }
     if (!ds.AddZipEntry(entry_name, tmp_path_)) {
         MYLOGE("Failed to add text entry to .zip file\n");
         return false;
@@ -2090,9 +2254,14 @@ static void PrepareToWriteToFile() {
 
     if (ds.options_->do_zip_file) {
         ds.path_ = ds.GetPath(".zip");
-        MYLOGD("Creating initial .zip file (%s)\n", ds.path_.c_str());
-        create_parent_dirs(ds.path_.c_str());
-        ds.zip_file.reset(fopen(ds.path_.c_str(), "wb"));
+        if (ds.options_->stream_to_socket) {
+            MYLOGD("Streaming .zip file to the dumpstate socket\n");
+            ds.zip_file.reset(fdopen(dup(ds.control_socket_fd_), "wb"));
+        } else {
+            MYLOGD("Creating initial .zip file (%s)\n", ds.path_.c_str());
+            create_parent_dirs(ds.path_.c_str());
+            ds.zip_file.reset(fopen(ds.path_.c_str(), "wb"));
+        }
         if (ds.zip_file == nullptr) {
             MYLOGE("fopen(%s, 'wb'): %s\n", ds.path_.c_str(), strerror(errno));
         } else {
@@ -2143,7 +2312,7 @@ static void FinalizeFile() {
             do_text_file = false;
             // If the user has changed the suffix, we need to change the zip file name.
             std::string new_path = ds.GetPath(".zip");
-            if (ds.path_ != new_path) {
+            if (ds.path_ != new_path && !ds.options_->stream_to_socket) {
                 MYLOGD("Renaming zip file from %s to %s\n", ds.path_.c_str(), new_path.c_str());
                 if (rename(ds.path_.c_str(), new_path.c_str())) {
                     MYLOGE("rename(%s, %s): %s\n", ds.path_.c_str(), new_path.c_str(),
@@ -2337,6 +2506,7 @@ static void LogDumpOptions(const Dumpstate::DumpOptions& options) {
     MYLOGI("do_vibrate: %d\n", options.do_vibrate);
     MYLOGI("use_socket: %d\n", options.use_socket);
     MYLOGI("use_control_socket: %d\n", options.use_control_socket);
+    MYLOGI("stream_to_socket: %d\n", options.stream_to_socket);
     MYLOGI("do_fb: %d\n", options.do_fb);
     MYLOGI("do_broadcast: %d\n", options.do_broadcast);
     MYLOGI("is_remote_mode: %d\n", options.is_remote_mode);
@@ -2371,7 +2541,7 @@ void Dumpstate::DumpOptions::Initialize(BugreportMode bugreport_mode,
 Dumpstate::RunStatus Dumpstate::DumpOptions::Initialize(int argc, char* argv[]) {
     RunStatus status = RunStatus::OK;
     int c;
-    while ((c = getopt(argc, argv, "dho:svqzpPBRSV:w")) != -1) {
+    while ((c = getopt(argc, argv, "dho:svqzpPBRSZV:w")) != -1) {
         switch (c) {
             // clang-format off
             case 'd': do_add_date = true;            break;
@@ -2381,6 +2551,7 @@ Dumpstate::RunStatus Dumpstate::DumpOptions::Initialize(int argc, char* argv[])
             case 'o': break;
             case 's': use_socket = true;             break;
             case 'S': use_control_socket = true;     break;
+            case 'Z': stream_to_socket = true;       break;
             case 'v': show_header_only = true;       break;
             case 'q': do_vibrate = false;            break;
             case 'p': do_fb = true;                  break;
@@ -2430,6 +2601,12 @@ bool Dumpstate::DumpOptions::ValidateOptions() const {
         return false;
     }
 
+    // The socket carries the zip file itself, so it can't be shared with other output.
+    if (stream_to_socket &&
+        (!do_zip_file || use_control_socket || bugreport_fd.get() != -1 || do_broadcast)) {
+        return false;
+    }
+
     if (do_progress_updates && !do_broadcast) {
         return false;
     }
@@ -2592,6 +2769,14 @@ Dumpstate::RunStatus Dumpstate::RunInternal(int32_t calling_uid,
         options_->do_progress_updates = 1;
     }
 
+    if (options_->stream_to_socket) {
+        MYLOGD("Opening zip stream socket\n");
+        control_socket_fd_ = open_socket("dumpstate");
+        if (control_socket_fd_ == -1) {
+            return ERROR;
+        }
+    }
+
     if (is_redirecting) {
         PrepareToWriteToFile();
 
@@ -2635,7 +2820,7 @@ Dumpstate::RunStatus Dumpstate::RunInternal(int32_t calling_uid,
         }
     }
 
-    if (options_->do_zip_file && zip_file != nullptr) {
+    if (options_->do_zip_file && zip_file != nullptr && !options_->stream_to_socket) {
         if (chown(path_.c_str(), AID_SHELL, AID_SHELL)) {
             MYLOGE("Unable to change ownership of zip file %s: %s\n", path_.c_str(),
                    strerror(errno));
@@ -2763,7 +2948,8 @@ Dumpstate::RunStatus Dumpstate::RunInternal(int32_t calling_uid,
         TEMP_FAILURE_RETRY(dup2(dup_stderr_fd, fileno(stderr)));
     }
 
-    if (options_->use_control_socket && control_socket_fd_ != -1) {
+    if ((options_->use_control_socket || options_->stream_to_socket) &&
+        control_socket_fd_ != -1) {
         MYLOGD("Closing control socket\n");
         close(control_socket_fd_);
     }
@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -297,6 +298,10 @@ class Dumpstate {
     // Returns OK in all other cases.
     RunStatus DumpTraces(const char** path);
 
+    // Calls the dumpstate board HAL in the background, so that it runs while the rest of the
+    // bugreport is collected. DumpstateBoard() then waits for it and adds its files.
+    void StartDumpstateBoard();
+
     void DumpstateBoard();
 
     /*
@@ -350,6 +355,8 @@ class Dumpstate {
         // Writes bugreport content to a socket; only flatfile format is supported.
         bool use_socket = false;
         bool use_control_socket = false;
+        // Writes the zip file to the dumpstate socket as it is produced, instead of to a file.
+        bool stream_to_socket = false;
         bool do_fb = false;
         bool do_broadcast = false;
         bool is_remote_mode = false;
@@ -462,6 +469,11 @@ class Dumpstate {
     // List of open ANR dump files.
     std::vector<DumpData> anr_data_;
 
+    // The dumpstate board HAL call started by StartDumpstateBoard(), until DumpstateBoard()
+    // collects it.
+    struct DumpstateBoardTask;
+    std::shared_ptr<DumpstateBoardTask> dumpstate_board_task_;
+
     // A callback to IncidentCompanion service, which checks user consent for sharing the
     // bugreport with the calling app. If the user has not responded yet to the dialog it will
     // be neither confirmed nor denied.
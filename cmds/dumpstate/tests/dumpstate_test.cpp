@@ -19,6 +19,7 @@
 
 #include "DumpstateInternal.h"
 #include "DumpstateService.h"
+#include "DumpstateTimeline.h"
 #include "android/os/BnDumpstate.h"
 #include "dumpstate.h"
 
@@ -566,6 +567,17 @@ TEST_F(DumpOptionsTest, ValidateOptionsNeedZipfile) {
     EXPECT_TRUE(options_.ValidateOptions());
 }
 
+TEST_F(DumpOptionsTest, ValidateOptionsStreamToSocket) {
+    options_.stream_to_socket = true;
+    EXPECT_FALSE(options_.ValidateOptions());
+
+    options_.do_zip_file = true;
+    EXPECT_TRUE(options_.ValidateOptions());
+
+    options_.use_control_socket = true;
+    EXPECT_FALSE(options_.ValidateOptions());
+}
+
 TEST_F(DumpOptionsTest, ValidateOptionsUpdateProgressNeedsBroadcast) {
     options_.do_progress_updates = true;
     EXPECT_FALSE(options_.ValidateOptions());
@@ -1773,6 +1785,22 @@ TEST_F(DumpstateUtilTest, FindingPidWithNotExistingProcess) {
     EXPECT_THAT(err, StrEq("can't find the pid\n"));
 }
 
+TEST(DumpstateTimelineTest, ToJson) {
+    DumpstateTimeline timeline;
+    timeline.AddEvent("DUMPSYS \"a\"", "section", 1000000, 3500000);
+    timeline.AddEvent("DUMPSYS - b", "dumpsys", 2000000, 2600000, "timed out");
+    std::string json = timeline.ToJson();
+    EXPECT_THAT(json, StartsWith("{\"traceEvents\":["));
+    EXPECT_THAT(json, HasSubstr("{\"name\":\"DUMPSYS \\\"a\\\"\",\"cat\":\"section\",\"ph\":\"X\","
+                                "\"ts\":1000,\"dur\":2500,"));
+    EXPECT_THAT(json, HasSubstr("{\"name\":\"DUMPSYS - b\",\"cat\":\"dumpsys\",\"ph\":\"X\","
+                                "\"ts\":2000,\"dur\":600,"));
+    EXPECT_THAT(json, HasSubstr("\"args\":{\"status\":\"timed out\"}}"));
+
+    timeline.Clear();
+    EXPECT_THAT(timeline.ToJson(), StrEq("{\"traceEvents\":[\n],\"displayTimeUnit\":\"ms\"}\n"));
+}
+
 }  // namespace dumpstate
 }  // namespace os
 }  // namespace android
@@ -54,10 +54,12 @@
 #include <private/android_filesystem_config.h>
 
 #include "DumpstateInternal.h"
+#include "DumpstateTimeline.h"
 
 // TODO: remove once moved to namespace
 using android::os::dumpstate::CommandOptions;
 using android::os::dumpstate::DumpFileToFd;
+using android::os::dumpstate::DumpstateTimeline;
 using android::os::dumpstate::PropertiesHelper;
 
 // Keep in sync with
@@ -102,7 +104,9 @@ DurationReporter::DurationReporter(const std::string& title, bool logcat_only)
 
 DurationReporter::~DurationReporter() {
     if (!title_.empty()) {
-        float elapsed = (float)(Nanotime() - started_) / NANOS_PER_SEC;
+        uint64_t ended = Nanotime();
+        DumpstateTimeline::GetInstance().AddEvent(title_, "section", started_, ended);
+        float elapsed = (float)(ended - started_) / NANOS_PER_SEC;
         if (elapsed < .5f) {
             return;
         }
@@ -16,12 +16,17 @@
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <thread>
 
 #include <android-base/file.h>
 #include <android-base/stringprintf.h>
 #include <android-base/unique_fd.h>
+#include <binder/BinderCallStats.h>
 #include <binder/Parcel.h>
 #include <binder/ProcessState.h>
 #include <binder/TextOutput.h>
@@ -34,6 +39,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -59,8 +65,8 @@ static void usage() {
             "usage: dumpsys\n"
             "         To dump all services.\n"
             "or:\n"
-            "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--help | -l | --skip SERVICES | "
-            "SERVICE [ARGS]]\n"
+            "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--binder-stats] "
+            "[--parallel N] [--help | -l | --skip SERVICES | SERVICE [ARGS]]\n"
             "         --help: shows this help\n"
             "         -l: only list services, do not dump them\n"
             "         -t TIMEOUT_SEC: TIMEOUT to use in seconds instead of default 10 seconds\n"
@@ -69,6 +75,12 @@ static void usage() {
             "               will be in proto format.\n"
             "         --priority LEVEL: filter services based on specified priority\n"
             "               LEVEL must be one of CRITICAL | HIGH | NORMAL\n"
+            "         --binder-stats: dumps the binder call stats of the processes hosting the\n"
+            "               services instead. ARGS may be one of enable | disable | reset\n"
+            "               to change collection first.\n"
+            "         --parallel N: when dumping several services, dumps up to N of them at\n"
+            "               once. Their output is still written one service at a time, in order,\n"
+            "               so a slow service holds back the ones after it for up to TIMEOUT.\n"
             "         --skip SERVICES: dumps all services but SERVICES (comma-separated list)\n"
             "         SERVICE [ARGS]: dumps only service SERVICE, optionally passing ARGS to it\n");
 }
@@ -120,12 +132,16 @@ int Dumpsys::main(int argc, char* const argv[]) {
     bool showListOnly = false;
     bool skipServices = false;
     bool asProto = false;
+    Type type = Type::DUMP;
     int timeoutArgMs = 10000;
     int priorityFlags = IServiceManager::DUMP_FLAG_PRIORITY_ALL;
+    int maxParallel = 1;
     static struct option longOptions[] = {{"priority", required_argument, 0, 0},
                                           {"proto", no_argument, 0, 0},
                                           {"skip", no_argument, 0, 0},
                                           {"help", no_argument, 0, 0},
+                                          {"binder-stats", no_argument, 0, 0},
+                                          {"parallel", required_argument, 0, 0},
                                           {0, 0, 0, 0}};
 
     // Must reset optind, otherwise subsequent calls will fail (wouldn't happen on main.cpp, but
@@ -147,6 +163,8 @@ int Dumpsys::main(int argc, char* const argv[]) {
                 skipServices = true;
             } else if (!strcmp(longOptions[optionIndex].name, "proto")) {
                 asProto = true;
+            } else if (!strcmp(longOptions[optionIndex].name, "binder-stats")) {
+                type = Type::BINDER_STATS;
             } else if (!strcmp(longOptions[optionIndex].name, "help")) {
                 usage();
                 return 0;
@@ -157,6 +175,13 @@ int Dumpsys::main(int argc, char* const argv[]) {
                     usage();
                     return -1;
                 }
+            } else if (!strcmp(longOptions[optionIndex].name, "parallel")) {
+                char* endptr;
+                maxParallel = strtol(optarg, &endptr, 10);
+                if (*endptr != '\0' || maxParallel <= 0) {
+                    fprintf(stderr, "Error: invalid parallel dump count: '%s'\n", optarg);
+                    return -1;
+                }
             }
             break;
 
@@ -214,7 +239,9 @@ int Dumpsys::main(int argc, char* const argv[]) {
 
     if (services.empty() || showListOnly) {
         services = listServices(priorityFlags, asProto);
-        setServiceArgs(args, asProto, priorityFlags);
+        if (type == Type::DUMP) {
+            setServiceArgs(args, asProto, priorityFlags);
+        }
     }
 
     const size_t N = services.size();
@@ -236,11 +263,17 @@ int Dumpsys::main(int argc, char* const argv[]) {
         return 0;
     }
 
+    if (N > 1 && maxParallel > 1) {
+        dumpServicesInParallel(type, services, skippedServices, args, priorityFlags,
+                               std::chrono::milliseconds(timeoutArgMs), asProto, maxParallel);
+        return 0;
+    }
+
     for (size_t i = 0; i < N; i++) {
         const String16& serviceName = services[i];
         if (IsSkipped(skippedServices, serviceName)) continue;
 
-        if (startDumpThread(serviceName, args) == OK) {
+        if (startDumpThread(type, serviceName, args) == OK) {
             bool addSeparator = (N > 1);
             if (addSeparator) {
                 writeDumpHeader(STDOUT_FILENO, serviceName, priorityFlags);
@@ -308,12 +341,39 @@ void Dumpsys::setServiceArgs(Vector<String16>& args, bool asProto, int priorityF
 }
 
 status_t Dumpsys::startDumpThread(const String16& serviceName, const Vector<String16>& args) {
+    return startDumpThread(Type::DUMP, serviceName, args);
+}
+
+static bool parseBinderStatsCommand(const Vector<String16>& args,
+                                    BinderCallStats::Command* command) {
+    if (args.empty()) {
+        *command = BinderCallStats::COMMAND_DUMP;
+    } else if (args.size() == 1 && args[0] == String16("enable")) {
+        *command = BinderCallStats::COMMAND_ENABLE;
+    } else if (args.size() == 1 && args[0] == String16("disable")) {
+        *command = BinderCallStats::COMMAND_DISABLE;
+    } else if (args.size() == 1 && args[0] == String16("reset")) {
+        *command = BinderCallStats::COMMAND_RESET;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+status_t Dumpsys::startDumpThread(Type type, const String16& serviceName,
+                                  const Vector<String16>& args) {
     sp<IBinder> service = sm_->checkService(serviceName);
     if (service == nullptr) {
         aerr << "Can't find service: " << serviceName << endl;
         return NAME_NOT_FOUND;
     }
 
+    BinderCallStats::Command statsCommand = BinderCallStats::COMMAND_DUMP;
+    if (type == Type::BINDER_STATS && !parseBinderStatsCommand(args, &statsCommand)) {
+        aerr << "Unknown binder stats command for " << serviceName << endl;
+        return BAD_VALUE;
+    }
+
     int sfd[2];
     if (pipe(sfd) != 0) {
         aerr << "Failed to create pipe to dump service info for " << serviceName << ": "
@@ -327,7 +387,19 @@ status_t Dumpsys::startDumpThread(const String16& serviceName, const Vector<Stri
 
     // dump blocks until completion, so spawn a thread..
     activeThread_ = std::thread([=, remote_end{std::move(remote_end)}]() mutable {
-        int err = service->dump(remote_end.get(), args);
+        int err;
+        if (type == Type::DUMP) {
+            err = service->dump(remote_end.get(), args);
+        } else {
+            err = NO_ERROR;
+            if (statsCommand != BinderCallStats::COMMAND_DUMP) {
+                err = BinderCallStats::sendCommand(service, statsCommand, remote_end.get());
+            }
+            if (err == NO_ERROR) {
+                err = BinderCallStats::sendCommand(service, BinderCallStats::COMMAND_DUMP,
+                                                   remote_end.get());
+            }
+        }
 
         // It'd be nice to be able to close the remote end of the socketpair before the dump
         // call returns, to terminate our reads if the other end closes their copy of the
@@ -353,6 +425,116 @@ void Dumpsys::stopDumpThread(bool dumpComplete) {
     redirectFd_.reset();
 }
 
+// A service dumped by dumpServicesInParallel. The worker dumps it into an anonymous memory file,
+// which is copied to stdout once every service before it has been written.
+struct Dumpsys::ParallelDump {
+    String16 serviceName;
+    unique_fd outputFd;
+    std::thread worker;
+    status_t startStatus = OK;
+    status_t status = OK;
+    std::chrono::duration<double> elapsedDuration{0};
+    // Set by the worker once the dump is complete, guarded by the dumpServicesInParallel mutex.
+    bool done = false;
+};
+
+void Dumpsys::dumpServicesInParallel(Type type, const Vector<String16>& services,
+                                     const Vector<String16>& skippedServices,
+                                     const Vector<String16>& args, int priorityFlags,
+                                     std::chrono::milliseconds timeout, bool asProto,
+                                     size_t maxParallel) {
+    std::mutex mutex;
+    std::condition_variable doneCondition;
+    // Dumps not written yet, in output order. Only the running ones count against maxParallel,
+    // so finished dumps waiting behind a slow service do not keep new ones from starting.
+    std::deque<std::unique_ptr<ParallelDump>> pending;
+    size_t running = 0;
+    size_t next = 0;
+
+    auto hasNext = [&]() {
+        while (next < services.size() && IsSkipped(skippedServices, services[next])) next++;
+        return next < services.size();
+    };
+
+    // Called with mutex held.
+    auto startNext = [&]() {
+        if (!hasNext()) return false;
+
+        auto dump = std::make_unique<ParallelDump>();
+        dump->serviceName = services[next++];
+        dump->outputFd.reset(memfd_create("dumpsys", MFD_CLOEXEC));
+        if (dump->outputFd == -1) {
+            aerr << "Failed to create buffer to dump service info for " << dump->serviceName
+                 << ": " << strerror(errno) << endl;
+            dump->startStatus = -errno;
+            dump->done = true;
+        } else {
+            ParallelDump* d = dump.get();
+            running++;
+            d->worker = std::thread([=, &mutex, &doneCondition, &running]() {
+                // Each worker needs its own dump thread and pipe.
+                Dumpsys dumpsys(sm_);
+                d->startStatus = dumpsys.startDumpThread(type, d->serviceName, args);
+                if (d->startStatus == OK) {
+                    size_t bytesWritten = 0;
+                    d->status = dumpsys.writeDump(d->outputFd.get(), d->serviceName, timeout,
+                                                  asProto, d->elapsedDuration, bytesWritten);
+                    dumpsys.stopDumpThread(d->status == OK);
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                d->done = true;
+                running--;
+                doneCondition.notify_one();
+            });
+        }
+        pending.push_back(std::move(dump));
+        return true;
+    };
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        while (running < maxParallel && startNext()) {
+        }
+        if (pending.empty()) break;
+
+        // Wait until the next dump in order can be written, or a slot frees up. writeDump stops
+        // each dump after timeout, so no service blocks the output for longer than that.
+        doneCondition.wait(lock, [&]() {
+            return pending.front()->done || (running < maxParallel && hasNext());
+        });
+        if (!pending.front()->done) continue;
+
+        std::unique_ptr<ParallelDump> dump = std::move(pending.front());
+        pending.pop_front();
+        lock.unlock();
+        if (dump->worker.joinable()) {
+            dump->worker.join();
+        }
+
+        if (dump->startStatus == OK) {
+            writeDumpHeader(STDOUT_FILENO, dump->serviceName, priorityFlags);
+            char buf[4096];
+            ssize_t rc;
+            lseek(dump->outputFd.get(), 0, SEEK_SET);
+            while ((rc = TEMP_FAILURE_RETRY(read(dump->outputFd.get(), buf, sizeof(buf)))) > 0) {
+                if (!WriteFully(STDOUT_FILENO, buf, rc)) {
+                    aerr << "Failed to write while dumping service " << dump->serviceName << ": "
+                         << strerror(errno) << endl;
+                    break;
+                }
+            }
+            if (dump->status == TIMED_OUT) {
+                aout << endl
+                     << "*** SERVICE '" << dump->serviceName << "' DUMP TIMEOUT ("
+                     << timeout.count() << "ms) EXPIRED ***" << endl
+                     << endl;
+            }
+            writeDumpFooter(STDOUT_FILENO, dump->serviceName, dump->elapsedDuration);
+        }
+        lock.lock();
+    }
+}
+
 void Dumpsys::writeDumpHeader(int fd, const String16& serviceName, int priorityFlags) const {
     std::string msg(
         "----------------------------------------"
@@ -28,6 +28,11 @@ class Dumpsys {
   public:
     explicit Dumpsys(android::IServiceManager* sm) : sm_(sm) {
     }
+
+    enum class Type {
+        DUMP,         // the service's own dump()
+        BINDER_STATS, // BinderCallStats of the process hosting the service
+    };
     /**
      * Main entry point into dumpsys.
      */
@@ -63,6 +68,14 @@ class Dumpsys {
      */
     status_t startDumpThread(const String16& serviceName, const Vector<String16>& args);
 
+    /**
+     * Same as above, but {@code type} selects what the thread asks the service for. With
+     * {@code Type::BINDER_STATS}, {@code args} may hold one of enable, disable or reset, which
+     * is sent before the stats are dumped.
+     */
+    status_t startDumpThread(Type type, const String16& serviceName,
+                             const Vector<String16>& args);
+
     /**
      * Writes a section header to a file descriptor.
      * @param fd file descriptor to write data
@@ -116,6 +129,21 @@ class Dumpsys {
     }
 
   private:
+    struct ParallelDump;
+
+    /**
+     * Dumps {@code services} but {@code skippedServices} to stdout with up to {@code
+     * maxParallel} dumps in flight at once, for {@code --parallel}. Each service's output is
+     * written as a whole, with its header and footer, in the order of {@code services}, as soon as
+     * the services before it have been written. A slow service holds back the output of the ones
+     * after it for up to {@code timeout}, while they carry on dumping into memory.
+     */
+    void dumpServicesInParallel(Type type, const Vector<String16>& services,
+                                const Vector<String16>& skippedServices,
+                                const Vector<String16>& args, int priorityFlags,
+                                std::chrono::milliseconds timeout, bool asProto,
+                                size_t maxParallel);
+
     android::IServiceManager* sm_;
     std::thread activeThread_;
     mutable android::base::unique_fd redirectFd_;
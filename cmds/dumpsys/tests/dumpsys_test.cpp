@@ -16,12 +16,15 @@
 
 #include "../dumpsys.h"
 
+#include <unistd.h>
+
 #include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include <android-base/file.h>
+#include <binder/BinderCallStats.h>
 #include <serviceutils/PriorityDumper.h>
 #include <utils/String16.h>
 #include <utils/String8.h>
@@ -425,6 +428,24 @@ TEST_F(DumpsysTest, DumpMultipleServices) {
     AssertDumped("running3", "dump3");
 }
 
+// Tests 'dumpsys --parallel 2' with some services not running.
+TEST_F(DumpsysTest, DumpMultipleServicesInParallel) {
+    ExpectListServices({"running1", "stopped2", "running3", "running4"});
+    ExpectDump("running1", "dump1");
+    ExpectCheckService("stopped2", false);
+    ExpectDump("running3", "dump3");
+    ExpectDump("running4", "dump4");
+
+    CallMain({"--parallel", "2"});
+
+    AssertRunningServices({"running1", "running3", "running4"});
+    AssertDumped("running1", "dump1");
+    AssertStopped("stopped2");
+    AssertDumped("running3", "dump3");
+    AssertDumped("running4", "dump4");
+    AssertOutputContains("dump1--------- ");
+}
+
 // Tests 'dumpsys --skip skipped3 skipped5', which should skip these services
 TEST_F(DumpsysTest, DumpWithSkip) {
     ExpectListServices({"running1", "stopped2", "skipped3", "running4", "skipped5"});
@@ -539,6 +560,21 @@ TEST_F(DumpsysTest, DumpWithPriorityHighAndProto) {
     AssertDumpedWithPriority("runninghigh2", "dump2", PriorityDumper::PRIORITY_ARG_HIGH);
 }
 
+// Tests 'dumpsys --binder-stats service_name enable'
+TEST_F(DumpsysTest, DumpBinderStats) {
+    ExpectCheckService("Valet");
+
+    CallMain({"--binder-stats", "Valet", "enable"});
+
+    AssertOutputContains("Binder call stats (pid " + std::to_string(getpid()) + ", enabled):\n");
+    EXPECT_TRUE(BinderCallStats::isEnabled());
+
+    CallMain({"--binder-stats", "Valet", "disable"});
+
+    AssertOutputContains("disabled):\n");
+    EXPECT_FALSE(BinderCallStats::isEnabled());
+}
+
 TEST_F(DumpsysTest, GetBytesWritten) {
     const char* serviceName = "service2";
     const char* dumpContents = "dump1";
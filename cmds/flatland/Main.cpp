@@ -36,6 +36,7 @@ using namespace ::android;
 
 static uint32_t g_SleepBetweenSamplesMs = 0;
 static bool     g_PresentToWindow       = false;
+static bool     g_CsvOutput             = false;
 static size_t   g_BenchmarkNameLen      = 0;
 
 struct BenchmarkDesc {
@@ -201,6 +202,40 @@ static const BenchmarkDesc benchmarks[] = {
             },
         },
     },
+
+    { "16:10 Multi-Window Overview",
+        2560, 1600, { 800, 1200, 1600, 2400 },
+        {
+            {   // Wallpaper
+                0, staticGradient, opaque,
+                0,    50,     2560,   1454,
+            },
+            {   // Recent task
+                0, staticGradient, blendShrink,
+                40,   90,     1220,   667,
+            },
+            {   // Recent task
+                0, staticGradient, blendShrink,
+                1300, 90,     1220,   667,
+            },
+            {   // Recent task
+                0, staticGradient, blendShrink,
+                40,   797,    1220,   667,
+            },
+            {   // Recent task
+                0, staticGradient, blendShrink,
+                1300, 797,    1220,   667,
+            },
+            {   // Status bar
+                0, staticGradient, opaque,
+                0,    0,      2560,   50,
+            },
+            {   // Navigation bar
+                0, staticGradient, opaque,
+                0,    1504,   2560,   96,
+            },
+        },
+    },
 };
 
 static const ShaderDesc shaders[] = {
@@ -594,8 +629,12 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
 
     uint32_t runHeight = b.runHeights[run];
     uint32_t runWidth = b.width * runHeight / b.height;
-    printf(" %-*s | %4d x %4d | ", static_cast<int>(g_BenchmarkNameLen), b.name,
-            runWidth, runHeight);
+    if (g_CsvOutput) {
+        printf("\"%s\",%d,%d,", b.name, runWidth, runHeight);
+    } else {
+        printf(" %-*s | %4d x %4d | ", static_cast<int>(g_BenchmarkNameLen), b.name,
+                runWidth, runHeight);
+    }
     fflush(stdout);
 
     BenchmarkRunner r(b, run);
@@ -627,11 +666,11 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
 
     if (totalFrames - warmUpFrames > 16) {
         // The test runs too fast to get a stable result.  Skip it.
-        printf("  fast");
+        printf(g_CsvOutput ? "fast" : "  fast");
         goto done;
     } else if (totalFrames == 5 && runTime > 200e6) {
         // The test runs too slow to be very useful.  Skip it.
-        printf("  slow");
+        printf(g_CsvOutput ? "slow" : "  slow");
         goto done;
     }
 
@@ -668,7 +707,7 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
         result = (samples[elem-1] + samples[elem]) * 0.5;
     } while (fabs(result - prevResult) > threshold * result);
 
-    printf("%6.3f", result / double(totalFrames - warmUpFrames) / 1e6);
+    printf(g_CsvOutput ? "%.3f" : "%6.3f", result / double(totalFrames - warmUpFrames) / 1e6);
 
 done:
 
@@ -680,6 +719,11 @@ done:
 }
 
 static void printResultsTableHeader() {
+    if (g_CsvOutput) {
+        printf("scenario,width,height,time_ms\n");
+        return;
+    }
+
     const char* scenario = "Scenario";
     size_t len = strlen(scenario);
     size_t leftPad = (g_BenchmarkNameLen - len) / 2;
@@ -723,6 +767,7 @@ static void showHelp(const char *cmd) {
     fprintf(stderr, "options include:\n"
                     "  -s N            sleep for N ms between samples\n"
                     "  -d              display the test frame to a window\n"
+                    "  -c              print the results as CSV\n"
                     "  --help          print this helpful message and exit\n"
             );
 }
@@ -741,7 +786,7 @@ int main(int argc, char** argv) {
             {     0,               0, 0,  0 }
         };
 
-        ret = getopt_long(argc, argv, "ds:",
+        ret = getopt_long(argc, argv, "cds:",
                           long_options, &option_index);
 
         if (ret < 0) {
@@ -749,6 +794,10 @@ int main(int argc, char** argv) {
         }
 
         switch(ret) {
+            case 'c':
+                g_CsvOutput = true;
+            break;
+
             case 'd':
                 g_PresentToWindow = true;
             break;
@@ -772,7 +821,7 @@ int main(int argc, char** argv) {
 
     g_BenchmarkNameLen = maxBenchmarkNameLen();
 
-    printf(" cmdline:");
+    printf(g_CsvOutput ? "# cmdline:" : " cmdline:");
     for (int i = 0; i < argc; i++) {
         printf(" %s", argv[i]);
     }
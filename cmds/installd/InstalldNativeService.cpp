@@ -19,6 +19,7 @@
 #define ATRACE_TAG ATRACE_TAG_PACKAGE_MANAGER
 
 #include <algorithm>
+#include <atomic>
 #include <errno.h>
 #include <fstream>
 #include <fts.h>
@@ -37,6 +38,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/xattr.h>
+#include <thread>
 #include <unistd.h>
 
 #include <android-base/file.h>
@@ -96,6 +98,16 @@ static constexpr const char *kIdMapPath = "/system/bin/idmap";
 static constexpr const char* IDMAP_PREFIX = "/data/resource-cache/";
 static constexpr const char* IDMAP_SUFFIX = "@idmap";
 
+// Number of threads loading cache stats in freeCache. Without quota support every app's cache
+// tree is walked, which on a device with hundreds of apps is mostly spent waiting on storage.
+static constexpr size_t kFreeCacheStatsThreads = 4;
+
+// Number of dexopt calls whose timing is kept for dumpsys.
+static constexpr size_t kMaxDexoptJobs = 32;
+
+// How long a measurement of the dalvik cache is reused by getAppSize.
+static constexpr std::chrono::seconds kDalvikCacheSizesMaxAge(10);
+
 // fsverity assumes the page size is always 4096. If not, the feature can not be
 // enabled.
 static constexpr int kVerityPageSize = 4096;
@@ -291,6 +303,18 @@ status_t InstalldNativeService::dump(int fd, const Vector<String16> & /* args */
         }
     }
 
+    {
+        std::lock_guard<std::mutex> lock(mDexoptStatsLock);
+        out << endl << "Dexopt: " << mDexoptCount << " calls, " << mDexoptFailures
+                << " failed, " << mDexoptTotalMs << "ms total, " << mDexoptMaxMs << "ms max"
+                << endl;
+        for (const auto& job : mDexoptJobs) {
+            out << "    " << job.packageName << " " << job.instructionSet << " "
+                    << job.compilerFilter << " " << job.durationMs << "ms result "
+                    << job.result << endl;
+        }
+    }
+
     out << endl;
     out.flush();
 
@@ -835,6 +859,18 @@ static int32_t copy_directory_recursive(const char* from, const char* to) {
     return android_fork_execvp(ARRAY_SIZE(argv), argv, nullptr, false, true);
 }
 
+// Copies app data for a rollback snapshot or its restore. The snapshots live on the same volume
+// as the data, so the contents can often be shared with a reflink instead of written again; cp
+// remains the fallback if the copy fails.
+static int32_t clone_app_data(const char* from, const char* to) {
+    LOG(DEBUG) << "Cloning " << from << " to " << to;
+    if (clone_directory_recursive(from, to) == 0) {
+        return 0;
+    }
+    LOG(WARNING) << "Failed to clone " << from << " to " << to << ", falling back to cp";
+    return copy_directory_recursive(from, to);
+}
+
 binder::Status InstalldNativeService::snapshotAppData(
         const std::unique_ptr<std::string>& volumeUuid,
         const std::string& packageName, int32_t user, int32_t snapshotId,
@@ -917,7 +953,7 @@ binder::Status InstalldNativeService::snapshotAppData(
             return error(rc, "Failed clearing existing snapshot " + rollback_package_path);
         }
 
-        rc = copy_directory_recursive(from.c_str(), to.c_str());
+        rc = clone_app_data(from.c_str(), to.c_str());
         if (rc != 0) {
             res = error(rc, "Failed copying " + from + " to " + to);
             clear_de_on_exit = true;
@@ -941,7 +977,7 @@ binder::Status InstalldNativeService::snapshotAppData(
             return error(rc, "Failed clearing existing snapshot " + rollback_package_path);
         }
 
-        rc = copy_directory_recursive(from.c_str(), to.c_str());
+        rc = clone_app_data(from.c_str(), to.c_str());
         if (rc != 0) {
             res = error(rc, "Failed copying " + from + " to " + to);
             clear_ce_on_exit = true;
@@ -1005,7 +1041,7 @@ binder::Status InstalldNativeService::restoreAppDataSnapshot(
 
     if (needs_ce_rollback) {
         auto to_ce = create_data_user_ce_path(volume_uuid, user);
-        int rc = copy_directory_recursive(from_ce.c_str(), to_ce.c_str());
+        int rc = clone_app_data(from_ce.c_str(), to_ce.c_str());
         if (rc != 0) {
             res = error(rc, "Failed copying " + from_ce + " to " + to_ce);
             return res;
@@ -1014,7 +1050,7 @@ binder::Status InstalldNativeService::restoreAppDataSnapshot(
 
     if (needs_de_rollback) {
         auto to_de = create_data_user_de_path(volume_uuid, user);
-        int rc = copy_directory_recursive(from_de.c_str(), to_de.c_str());
+        int rc = clone_app_data(from_de.c_str(), to_de.c_str());
         if (rc != 0) {
             if (needs_ce_rollback) {
                 auto ce_data = create_data_user_ce_package_path(volume_uuid, user, package_name);
@@ -1315,10 +1351,30 @@ binder::Status InstalldNativeService::freeCache(const std::unique_ptr<std::strin
         };
         std::priority_queue<std::shared_ptr<CacheTracker>,
                 std::vector<std::shared_ptr<CacheTracker>>, decltype(cmp)> queue(cmp);
+        std::vector<std::shared_ptr<CacheTracker>> pending;
+        pending.reserve(trackers.size());
         for (const auto& it : trackers) {
-            it.second->loadStats();
-            queue.push(it.second);
-            cacheTotal += it.second->cacheUsed;
+            pending.push_back(it.second);
+        }
+        // Each thread takes the next tracker that nobody has started on, so that one app with a
+        // huge cache doesn't hold up the others.
+        std::atomic<size_t> nextTracker(0);
+        auto loadStats = [&]() {
+            for (size_t i = nextTracker++; i < pending.size(); i = nextTracker++) {
+                pending[i]->loadStats();
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < std::min(pending.size(), kFreeCacheStatsThreads); i++) {
+            threads.emplace_back(loadStats);
+        }
+        loadStats();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& tracker : pending) {
+            queue.push(tracker);
+            cacheTotal += tracker->cacheUsed;
         }
         ATRACE_END();
 
@@ -1427,6 +1483,7 @@ binder::Status InstalldNativeService::rmdex(const std::string& codePath,
             return error(StringPrintf("Failed to unlink %s", dex_path));
         }
     }
+    invalidateDalvikCacheSizes();
     return ok();
 }
 
@@ -1717,8 +1774,7 @@ binder::Status InstalldNativeService::getAppSize(const std::unique_ptr<std::stri
             ATRACE_BEGIN("dalvik");
             int32_t sharedGid = multiuser_get_shared_gid(0, appId);
             if (sharedGid != -1) {
-                calculate_tree_size(create_data_dalvik_cache_path(), &stats.codeSize,
-                        sharedGid, -1);
+                stats.codeSize += getDalvikCacheSizeForGid(sharedGid);
             }
             ATRACE_END();
         }
@@ -1738,6 +1794,24 @@ binder::Status InstalldNativeService::getAppSize(const std::unique_ptr<std::stri
     return ok();
 }
 
+int64_t InstalldNativeService::getDalvikCacheSizeForGid(gid_t gid) {
+    std::lock_guard<std::mutex> lock(mDalvikCacheSizesLock);
+    auto now = std::chrono::steady_clock::now();
+    if (!mDalvikCacheSizesValid || now - mDalvikCacheSizesTime > kDalvikCacheSizesMaxAge) {
+        mDalvikCacheSizes.clear();
+        calculate_tree_size_by_gid(create_data_dalvik_cache_path(), &mDalvikCacheSizes);
+        mDalvikCacheSizesTime = now;
+        mDalvikCacheSizesValid = true;
+    }
+    auto size = mDalvikCacheSizes.find(gid);
+    return size != mDalvikCacheSizes.end() ? size->second : 0;
+}
+
+void InstalldNativeService::invalidateDalvikCacheSizes() {
+    std::lock_guard<std::mutex> lock(mDalvikCacheSizesLock);
+    mDalvikCacheSizesValid = false;
+}
+
 binder::Status InstalldNativeService::getUserSize(const std::unique_ptr<std::string>& uuid,
         int32_t userId, int32_t flags, const std::vector<int32_t>& appIds,
         std::vector<int64_t>* _aidl_return) {
@@ -2119,9 +2193,24 @@ binder::Status InstalldNativeService::dexopt(const std::string& apkPath, int32_t
     const char* dm_path = getCStr(dexMetadataPath);
     const char* compilation_reason = getCStr(compilationReason);
     std::string error_msg;
+    auto start = std::chrono::steady_clock::now();
     int res = android::installd::dexopt(apk_path, uid, pkgname, instruction_set, dexoptNeeded,
             oat_dir, dexFlags, compiler_filter, volume_uuid, class_loader_context, se_info,
             downgrade, targetSdkVersion, profile_name, dm_path, compilation_reason, &error_msg);
+    int64_t durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> statsLock(mDexoptStatsLock);
+        mDexoptCount++;
+        mDexoptFailures += (res != 0);
+        mDexoptTotalMs += durationMs;
+        mDexoptMaxMs = std::max(mDexoptMaxMs, durationMs);
+        if (mDexoptJobs.size() == kMaxDexoptJobs) {
+            mDexoptJobs.pop_front();
+        }
+        mDexoptJobs.push_back({pkgname, instruction_set, compiler_filter, durationMs, res});
+    }
+    invalidateDalvikCacheSizes();
     return res ? error(res, error_msg) : ok();
 }
 
@@ -2339,15 +2428,8 @@ static int flatten_path(const char *prefix, const char *suffix,
     return 0;
 }
 
-binder::Status InstalldNativeService::idmap(const std::string& targetApkPath,
-        const std::string& overlayApkPath, int32_t uid) {
-    ENFORCE_UID(AID_SYSTEM);
-    CHECK_ARGUMENT_PATH(targetApkPath);
-    CHECK_ARGUMENT_PATH(overlayApkPath);
-    std::lock_guard<std::recursive_mutex> lock(mLock);
-
-    const char* target_apk = targetApkPath.c_str();
-    const char* overlay_apk = overlayApkPath.c_str();
+// Creates the idmap of overlay_apk over target_apk, unless an up to date one already exists.
+static bool create_idmap(const char* target_apk, const char* overlay_apk, int32_t uid) {
     ALOGV("idmap target_apk=%s overlay_apk=%s uid=%d\n", target_apk, overlay_apk, uid);
 
     int idmap_fd = -1;
@@ -2388,7 +2470,7 @@ binder::Status InstalldNativeService::idmap(const std::string& targetApkPath,
 
     if (!outdated) {
         close(idmap_fd);
-        return ok();
+        return true;
     }
 
     pid_t pid;
@@ -2419,13 +2501,55 @@ binder::Status InstalldNativeService::idmap(const std::string& targetApkPath,
     }
 
     close(idmap_fd);
-    return ok();
+    return true;
 fail:
     if (idmap_fd >= 0) {
         close(idmap_fd);
         unlink(idmap_path);
     }
-    return error();
+    return false;
+}
+
+binder::Status InstalldNativeService::idmap(const std::string& targetApkPath,
+        const std::string& overlayApkPath, int32_t uid) {
+    ENFORCE_UID(AID_SYSTEM);
+    CHECK_ARGUMENT_PATH(targetApkPath);
+    CHECK_ARGUMENT_PATH(overlayApkPath);
+    std::lock_guard<std::recursive_mutex> lock(mLock);
+
+    if (!create_idmap(targetApkPath.c_str(), overlayApkPath.c_str(), uid)) {
+        return error();
+    }
+    return ok();
+}
+
+binder::Status InstalldNativeService::idmapMultiple(const std::string& targetApkPath,
+        const std::vector<std::string>& overlayApkPaths, int32_t uid) {
+    ENFORCE_UID(AID_SYSTEM);
+    CHECK_ARGUMENT_PATH(targetApkPath);
+    for (const auto& overlayApkPath : overlayApkPaths) {
+        CHECK_ARGUMENT_PATH(overlayApkPath);
+    }
+    std::lock_guard<std::recursive_mutex> lock(mLock);
+
+    const char* target_apk = targetApkPath.c_str();
+    if (access(target_apk, R_OK) != 0) {
+        return error("Failed to access target " + targetApkPath);
+    }
+
+    // Keep going after a failure so that one broken overlay doesn't leave the rest without
+    // an idmap; the error reports how many of them failed.
+    int failures = 0;
+    for (const auto& overlayApkPath : overlayApkPaths) {
+        if (!create_idmap(target_apk, overlayApkPath.c_str(), uid)) {
+            failures++;
+        }
+    }
+    if (failures > 0) {
+        return error(StringPrintf("Failed to create %d of %zu idmaps for %s", failures,
+                overlayApkPaths.size(), target_apk));
+    }
+    return ok();
 }
 
 binder::Status InstalldNativeService::removeIdmap(const std::string& overlayApkPath) {
@@ -2577,6 +2701,7 @@ binder::Status InstalldNativeService::deleteOdex(const std::string& apkPath,
     const char* oat_dir = outputPath ? outputPath->c_str() : nullptr;
 
     bool res = delete_odex(apk_path, instruction_set, oat_dir);
+    invalidateDalvikCacheSizes();
     return res ? ok() : error();
 }
 
@@ -2660,22 +2785,28 @@ binder::Status InstalldNativeService::installApkVerity(const std::string& filePa
     if (data.get() == MAP_FAILED) {
         return error("Failed to mmap the ashmem");
     }
-    char* cursor = reinterpret_cast<char*>(data.get());
-    int remaining = contentSize;
-    while (remaining > 0) {
-        int ret = TEMP_FAILURE_RETRY(write(wfd.get(), cursor, remaining));
-        if (ret < 0) {
-            return error("Failed to write to " + filePath + " (" + std::to_string(remaining) +
-                         + "/" + std::to_string(contentSize) + ")");
+    {
+        ATRACE_NAME("write verity");
+        char* cursor = reinterpret_cast<char*>(data.get());
+        int remaining = contentSize;
+        while (remaining > 0) {
+            int ret = TEMP_FAILURE_RETRY(write(wfd.get(), cursor, remaining));
+            if (ret < 0) {
+                return error("Failed to write to " + filePath + " (" +
+                             std::to_string(remaining) + "/" + std::to_string(contentSize) + ")");
+            }
+            cursor += ret;
+            remaining -= ret;
         }
-        cursor += ret;
-        remaining -= ret;
+        wfd.reset();
     }
-    wfd.reset();
 
     // 3. Enable fsverity (needs readonly fd. Once it's done, the file becomes immutable.
     ::android::base::unique_fd rfd(open(filePath.c_str(), O_RDONLY));
-    if (ioctl(rfd.get(), FS_IOC_ENABLE_VERITY, nullptr) < 0) {
+    ATRACE_BEGIN("enable verity");
+    int ret = ioctl(rfd.get(), FS_IOC_ENABLE_VERITY, nullptr);
+    ATRACE_END();
+    if (ret < 0) {
         return error("Failed to enable fsverity on " + filePath);
     }
     return ok();
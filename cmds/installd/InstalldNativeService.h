@@ -21,6 +21,9 @@
 #include <inttypes.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <deque>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 
@@ -121,6 +124,8 @@ public:
 
     binder::Status idmap(const std::string& targetApkPath, const std::string& overlayApkPath,
             int32_t uid);
+    binder::Status idmapMultiple(const std::string& targetApkPath,
+            const std::vector<std::string>& overlayApkPaths, int32_t uid);
     binder::Status removeIdmap(const std::string& overlayApkPath);
     binder::Status rmPackageDir(const std::string& packageDir);
     binder::Status markBootComplete(const std::string& instructionSet);
@@ -169,7 +174,34 @@ private:
     /* Map from UID to cache quota size */
     std::unordered_map<uid_t, int64_t> mCacheQuotas;
 
+    /* Timing of the most recent dexopt calls, most recent last, for dumpsys */
+    struct DexoptJob {
+        std::string packageName;
+        std::string instructionSet;
+        std::string compilerFilter;
+        int64_t durationMs;
+        int result;
+    };
+    std::mutex mDexoptStatsLock;
+    std::deque<DexoptJob> mDexoptJobs;
+    int64_t mDexoptCount = 0;
+    int64_t mDexoptFailures = 0;
+    int64_t mDexoptTotalMs = 0;
+    int64_t mDexoptMaxMs = 0;
+
+    /* Sizes of the dalvik cache by gid, measured at mDalvikCacheSizesTime */
+    std::mutex mDalvikCacheSizesLock;
+    std::unordered_map<gid_t, int64_t> mDalvikCacheSizes;
+    std::chrono::steady_clock::time_point mDalvikCacheSizesTime;
+    bool mDalvikCacheSizesValid = false;
+
     std::string findDataMediaPath(const std::unique_ptr<std::string>& uuid, userid_t userid);
+
+    // Returns the size of the files in the dalvik cache owned by gid. The whole cache is measured
+    // at once and the result reused for a few seconds, since the storage UI asks for the size of
+    // every app in turn.
+    int64_t getDalvikCacheSizeForGid(gid_t gid);
+    void invalidateDalvikCacheSizes();
 };
 
 }  // namespace installd
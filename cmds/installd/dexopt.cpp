@@ -826,6 +826,21 @@ static bool analyze_profiles(uid_t uid, const std::string& package_name,
         return false;
     }
 
+    // Current profiles are truncated once they have been merged, so for most packages there is
+    // nothing new to merge. profman would only report PROFMAN_BIN_RETURN_CODE_SKIP_COMPILATION
+    // for them, so don't fork it.
+    bool has_current_data = false;
+    for (const unique_fd& profile_fd : profiles_fd) {
+        struct stat st;
+        if (fstat(profile_fd.get(), &st) != 0 || st.st_size > 0) {
+            has_current_data = true;
+            break;
+        }
+    }
+    if (!has_current_data) {
+        return false;
+    }
+
     RunProfman profman_merge;
     profman_merge.SetupMerge(profiles_fd, reference_profile_fd);
     pid_t pid = fork();
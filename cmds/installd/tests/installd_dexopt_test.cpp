@@ -20,6 +20,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
@@ -1020,6 +1021,22 @@ TEST_F(ProfileTest, ProfileMergeOkNoReference) {
     mergePackageProfiles(package_name_, "primary.prof", /*expected_result*/ true);
 }
 
+// Current profiles are truncated after a merge; there is nothing to merge from them.
+TEST_F(ProfileTest, ProfileMergeSkipsEmptyCurrentProfile) {
+    LOG(INFO) << "ProfileMergeSkipsEmptyCurrentProfile";
+
+    SetupProfiles(/*setup_ref*/ true);
+    ASSERT_EQ(0, truncate(cur_profile_.c_str(), 0));
+    struct stat ref_before;
+    ASSERT_EQ(0, stat(ref_profile_.c_str(), &ref_before));
+
+    mergePackageProfiles(package_name_, "primary.prof", /*expected_result*/ false);
+
+    struct stat ref_after;
+    ASSERT_EQ(0, stat(ref_profile_.c_str(), &ref_after));
+    ASSERT_EQ(ref_before.st_size, ref_after.st_size);
+}
+
 TEST_F(ProfileTest, ProfileMergeFailWrongPackage) {
     LOG(INFO) << "ProfileMergeFailWrongPackage";
 
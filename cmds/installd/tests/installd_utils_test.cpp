@@ -16,7 +16,10 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/scopeguard.h>
 #include <gtest/gtest.h>
@@ -628,5 +631,43 @@ TEST_F(UtilsTest, TestCreateDirIfNeeded) {
     ASSERT_NE(0, create_dir_if_needed("/data/local/tmp/user/0/bar/baz", 0700));
 }
 
+TEST_F(UtilsTest, TestCloneDirectoryRecursive) {
+    system("mkdir -p /data/local/tmp/user/0/from/com.example/sub /data/local/tmp/user/0/to");
+
+    auto deleter = [&]() {
+        delete_dir_contents_and_dir("/data/local/tmp/user/0", true /* ignore_if_missing */);
+    };
+    auto scope_guard = android::base::make_scope_guard(deleter);
+
+    ASSERT_TRUE(android::base::WriteStringToFile("hello",
+            "/data/local/tmp/user/0/from/com.example/sub/file"));
+    ASSERT_EQ(0, chmod("/data/local/tmp/user/0/from/com.example/sub/file", 0640));
+    ASSERT_EQ(0, chmod("/data/local/tmp/user/0/from/com.example/sub", 0500));
+    ASSERT_EQ(0, symlink("sub/file", "/data/local/tmp/user/0/from/com.example/link"));
+
+    ASSERT_EQ(0, clone_directory_recursive("/data/local/tmp/user/0/from/com.example",
+            "/data/local/tmp/user/0/to"));
+
+    std::string contents;
+    ASSERT_TRUE(android::base::ReadFileToString("/data/local/tmp/user/0/to/com.example/sub/file",
+            &contents));
+    EXPECT_EQ("hello", contents);
+    struct stat st;
+    ASSERT_EQ(0, stat("/data/local/tmp/user/0/to/com.example/sub/file", &st));
+    EXPECT_EQ(0640, st.st_mode & ALLPERMS);
+    ASSERT_EQ(0, stat("/data/local/tmp/user/0/to/com.example/sub", &st));
+    EXPECT_EQ(0500, st.st_mode & ALLPERMS);
+    std::string target;
+    ASSERT_TRUE(android::base::Readlink("/data/local/tmp/user/0/to/com.example/link", &target));
+    EXPECT_EQ("sub/file", target);
+
+    // Copying again replaces the existing copy, even in read-only directories.
+    ASSERT_EQ(0, clone_directory_recursive("/data/local/tmp/user/0/from/com.example",
+            "/data/local/tmp/user/0/to"));
+
+    ASSERT_EQ(0, chmod("/data/local/tmp/user/0/from/com.example/sub", 0700));
+    ASSERT_EQ(0, chmod("/data/local/tmp/user/0/to/com.example/sub", 0700));
+}
+
 }  // namespace installd
 }  // namespace android
@@ -21,11 +21,16 @@
 #include <fts.h>
 #include <stdlib.h>
 #include <sys/capability.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <sys/xattr.h>
 #include <sys/statvfs.h>
 
+#include <linux/fs.h>
+
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/strings.h>
 #include <android-base/stringprintf.h>
@@ -429,6 +434,32 @@ int calculate_tree_size(const std::string& path, int64_t* size,
     return 0;
 }
 
+int calculate_tree_size_by_gid(const std::string& path,
+        std::unordered_map<gid_t, int64_t>* sizes) {
+    FTS *fts;
+    FTSENT *p;
+    char *argv[] = { (char*) path.c_str(), nullptr };
+    if (!(fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR | FTS_XDEV, nullptr))) {
+        if (errno != ENOENT) {
+            PLOG(ERROR) << "Failed to fts_open " << path;
+        }
+        return -1;
+    }
+    while ((p = fts_read(fts)) != nullptr) {
+        switch (p->fts_info) {
+        case FTS_D:
+        case FTS_DEFAULT:
+        case FTS_F:
+        case FTS_SL:
+        case FTS_SLNONE:
+            (*sizes)[p->fts_statp->st_gid] += (p->fts_statp->st_blocks * 512);
+            break;
+        }
+    }
+    fts_close(fts);
+    return 0;
+}
+
 /**
  * Checks whether the package name is valid. Returns -1 on error and
  * 0 on success.
@@ -714,6 +745,115 @@ int copy_dir_files(const char *srcname,
     return res;
 }
 
+static int clone_file_contents(int from_fd, int to_fd, off_t size) {
+    if (ioctl(to_fd, FICLONE, from_fd) == 0) {
+        return 0;
+    }
+    off_t offset = 0;
+    while (offset < size) {
+        ssize_t copied = sendfile(to_fd, from_fd, &offset, size - offset);
+        if (copied < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        } else if (copied == 0) {
+            // The file shrank while being copied
+            break;
+        }
+    }
+    return 0;
+}
+
+// Sets the ownership, mode and timestamps of to, which was just created by copying from.
+static int clone_attributes(const char* to, const struct stat& st) {
+    if (lchown(to, st.st_uid, st.st_gid) != 0) {
+        return -1;
+    }
+    if (!S_ISLNK(st.st_mode) && chmod(to, st.st_mode & ALLPERMS) != 0) {
+        return -1;
+    }
+    const struct timespec times[] = { st.st_atim, st.st_mtim };
+    return utimensat(AT_FDCWD, to, times, AT_SYMLINK_NOFOLLOW);
+}
+
+int clone_directory_recursive(const std::string& from, const std::string& to) {
+    FTS *fts;
+    FTSENT *p;
+    char *argv[] = { (char*) from.c_str(), nullptr };
+    if (!(fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR | FTS_XDEV, nullptr))) {
+        PLOG(ERROR) << "Failed to fts_open " << from;
+        return -1;
+    }
+
+    auto slash = from.find_last_of('/');
+    const std::string to_root = to + "/" + (slash == std::string::npos ? from
+            : from.substr(slash + 1));
+    int res = 0;
+    while (res == 0 && (p = fts_read(fts)) != nullptr) {
+        const std::string path = to_root + (p->fts_path + from.size());
+        const char* to_path = path.c_str();
+        switch (p->fts_info) {
+        case FTS_D:
+            // Keep the directory writable until its contents are copied, in FTS_DP
+            if (mkdir(to_path, 0700) != 0 && (errno != EEXIST || chmod(to_path, 0700) != 0)) {
+                PLOG(ERROR) << "Failed to mkdir " << path;
+                res = -1;
+            }
+            break;
+        case FTS_DP:
+            if (clone_attributes(to_path, *p->fts_statp) != 0) {
+                PLOG(ERROR) << "Failed to set attributes of " << path;
+                res = -1;
+            }
+            break;
+        case FTS_F: {
+            unlink(to_path);
+            android::base::unique_fd from_fd(
+                    open(p->fts_path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+            android::base::unique_fd to_fd(
+                    open(to_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600));
+            if (from_fd == -1 || to_fd == -1
+                    || clone_file_contents(from_fd, to_fd, p->fts_statp->st_size) != 0) {
+                PLOG(ERROR) << "Failed to copy " << p->fts_path << " to " << path;
+                res = -1;
+            } else if (clone_attributes(to_path, *p->fts_statp) != 0) {
+                PLOG(ERROR) << "Failed to set attributes of " << path;
+                res = -1;
+            }
+            break;
+        }
+        case FTS_SL:
+        case FTS_SLNONE: {
+            std::string target;
+            unlink(to_path);
+            if (!android::base::Readlink(p->fts_path, &target)
+                    || symlink(target.c_str(), to_path) != 0
+                    || clone_attributes(to_path, *p->fts_statp) != 0) {
+                PLOG(ERROR) << "Failed to copy link " << p->fts_path << " to " << path;
+                res = -1;
+            }
+            break;
+        }
+        case FTS_DEFAULT:
+            unlink(to_path);
+            if (mknod(to_path, p->fts_statp->st_mode, p->fts_statp->st_rdev) != 0
+                    || clone_attributes(to_path, *p->fts_statp) != 0) {
+                PLOG(ERROR) << "Failed to copy node " << p->fts_path << " to " << path;
+                res = -1;
+            }
+            break;
+        case FTS_DC:
+            break;
+        default:
+            errno = p->fts_errno;
+            PLOG(ERROR) << "Failed to read " << p->fts_path;
+            res = -1;
+            break;
+        }
+    }
+    fts_close(fts);
+    return res;
+}
+
 int64_t data_disk_free(const std::string& data_path) {
     struct statvfs sfs;
     if (statvfs(data_path.c_str(), &sfs) == 0) {
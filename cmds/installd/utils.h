@@ -19,6 +19,7 @@
 #define UTILS_H_
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <dirent.h>
@@ -107,6 +108,11 @@ std::vector<userid_t> get_known_users(const char* volume_uuid);
 int calculate_tree_size(const std::string& path, int64_t* size,
         int32_t include_gid = -1, int32_t exclude_gid = -1, bool exclude_apps = false);
 
+// Like calculate_tree_size() with include_gid, but measures every gid found in a single walk,
+// adding the sizes to sizes.
+int calculate_tree_size_by_gid(const std::string& path,
+        std::unordered_map<gid_t, int64_t>* sizes);
+
 int create_user_config_path(char path[PKG_PATH_MAX], userid_t userid);
 
 bool is_valid_filename(const std::string& name);
@@ -128,6 +134,11 @@ int rm_package_dir(const std::string& package_dir);
 
 int copy_dir_files(const char *srcname, const char *dstname, uid_t owner, gid_t group);
 
+// Copies the tree at from into the directory to, like `cp -F -p -R -P from to`, keeping modes,
+// ownership and timestamps. File contents are shared with FICLONE where the filesystem supports
+// it, and otherwise copied in the kernel. Returns 0 on success.
+int clone_directory_recursive(const std::string& from, const std::string& to);
+
 int64_t data_disk_free(const std::string& data_path);
 
 int get_path_inode(const std::string& path, ino_t *inode);
@@ -19,6 +19,7 @@
 #include <getopt.h>
 
 #include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <functional>
 #include <iomanip>
@@ -26,6 +27,7 @@
 #include <map>
 #include <regex>
 #include <sstream>
+#include <thread>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
@@ -290,6 +292,7 @@ bool ListCommand::getPidInfo(
 }
 
 const PidInfo* ListCommand::getPidInfoCached(pid_t serverPid) {
+    std::lock_guard<std::mutex> lock(mCachedPidInfosLock);
     auto pair = mCachedPidInfos.insert({serverPid, PidInfo{}});
     if (pair.second /* did insertion take place? */) {
         if (!getPidInfo(serverPid, &pair.first->second)) {
@@ -666,16 +669,46 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
         return DUMP_BINDERIZED_ERROR;
     }
 
-    Status status = OK;
+    struct Fetch {
+        TableEntry* entry;
+        std::stringstream warnings;
+        Status status = OK;
+    };
     std::map<std::string, TableEntry> allTableEntries;
-    for (const auto &fqInstanceName : fqInstanceNames) {
+    std::vector<Fetch> fetches(fqInstanceNames.size());
+    for (size_t i = 0; i < fqInstanceNames.size(); ++i) {
         // create entry and default assign all fields.
-        TableEntry& entry = allTableEntries[fqInstanceName];
-        entry.interfaceName = fqInstanceName;
+        TableEntry& entry = allTableEntries[fqInstanceNames[i]];
+        entry.interfaceName = fqInstanceNames[i];
         entry.transport = mode;
         entry.serviceStatus = ServiceStatus::NON_RESPONSIVE;
+        fetches[i].entry = &entry;
+    }
 
-        status |= fetchBinderizedEntry(manager, &entry);
+    // Each entry takes several IPCs, and a slow or hung HAL costs up to IPC_CALL_WAIT for
+    // each of them, so fetch a few entries at a time.
+    static constexpr size_t kMaxFetchThreads = 8;
+    std::atomic<size_t> next{0};
+    auto fetchAll = [&] {
+        for (size_t i = next++; i < fetches.size(); i = next++) {
+            fetches[i].status = fetchBinderizedEntry(manager, fetches[i].entry,
+                                                     fetches[i].warnings);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(kMaxFetchThreads, fetches.size()); ++i) {
+        threads.emplace_back(fetchAll);
+    }
+    fetchAll();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Warnings are printed in the order of the list, as if entries were fetched one by one.
+    Status status = OK;
+    for (const auto& fetch : fetches) {
+        err() << fetch.warnings.str();
+        status |= fetch.status;
     }
 
     for (auto& pair : allTableEntries) {
@@ -685,10 +718,11 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
 }
 
 Status ListCommand::fetchBinderizedEntry(const sp<IServiceManager> &manager,
-                                         TableEntry *entry) {
+                                         TableEntry *entry, std::ostream &warnings) {
     Status status = OK;
     const auto handleError = [&](Status additionalError, const std::string& msg) {
-        err() << "Warning: Skipping \"" << entry->interfaceName << "\": " << msg << std::endl;
+        warnings << "Warning: Skipping \"" << entry->interfaceName << "\": " << msg
+                 << std::endl;
         status |= DUMP_BINDERIZED_ERROR | additionalError;
     };
 
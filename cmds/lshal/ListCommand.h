@@ -21,6 +21,8 @@
 #include <stdint.h>
 
 #include <fstream>
+#include <mutex>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -102,8 +104,9 @@ protected:
     Status fetchManifestHals();
     Status fetchLazyHals();
 
+    // Warnings are written to warnings, so that concurrent fetches don't interleave them.
     Status fetchBinderizedEntry(const sp<::android::hidl::manager::V1_0::IServiceManager> &manager,
-                                TableEntry *entry);
+                                TableEntry *entry, std::ostream &warnings);
 
     // Get relevant information for a PID by parsing files under /d/binder.
     // It is a virtual member function so that it can be mocked.
@@ -187,7 +190,9 @@ protected:
     // If an entry exist and not empty, it contains the cached content of /proc/{pid}/cmdline.
     std::map<pid_t, std::string> mCmdlines;
 
-    // Cache for getPidInfo.
+    // Cache for getPidInfo. Guarded by mCachedPidInfosLock, since binderized entries are
+    // fetched concurrently.
+    std::mutex mCachedPidInfosLock;
     std::map<pid_t, PidInfo> mCachedPidInfos;
 
     // Cache for getPartition.
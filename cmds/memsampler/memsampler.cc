@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+ /*
+  * memsampler periodically samples the RSS, PSS, swap and RSS high-water
+  * mark of every running process from /proc/PID/smaps_rollup and
+  * /proc/PID/status, and keeps the last samples of each process in a ring.
+  * This costs far less than the full /proc/PID/smaps walks of a bugreport,
+  * so memory use can be followed continuously.
+  *
+  * The samples are exposed through the "memsampler" binder service:
+  * "dumpsys memsampler" prints them, and "dumpsys memsampler PID" prints
+  * those of a single process.
+  *
+  * It is started by setting persist.memsampler.enable to "1". The sampling
+  * period, in seconds, is read from persist.memsampler.period_s.
+  */
+
+#define LOG_TAG "memsampler"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
+#include <binder/Binder.h>
+#include <binder/IServiceManager.h>
+#include <binder/ProcessState.h>
+#include <log/log.h>
+#include <utils/String8.h>
+
+using ::android::base::StringAppendF;
+using ::android::base::StringPrintf;
+
+namespace {
+
+constexpr int kDefaultPeriodSeconds = 60;
+constexpr int kMinPeriodSeconds = 5;
+// Samples kept per process: an hour at the default period.
+constexpr size_t kSamplesPerProcess = 60;
+
+struct Sample {
+    int64_t time;  // seconds since boot
+    uint32_t rss_kb;
+    uint32_t pss_kb;
+    uint32_t swap_kb;
+    uint32_t hwm_kb;
+};
+
+struct ProcessSeries {
+    std::string cmdline;
+    std::array<Sample, kSamplesPerProcess> samples;
+    // Index where the next sample goes, and how many of samples are valid.
+    size_t next = 0;
+    size_t count = 0;
+    // Set when the process is seen in a sampling pass; series of processes that weren't are
+    // dropped.
+    bool seen = false;
+
+    void add(const Sample& sample) {
+        samples[next] = sample;
+        next = (next + 1) % samples.size();
+        if (count < samples.size()) count++;
+    }
+};
+
+// Returns the value in kB of the line starting with field in the contents of a /proc file, or
+// 0 if there isn't one.
+uint32_t find_kb_field(const std::string& contents, const char* field) {
+    for (size_t pos = contents.find(field); pos != std::string::npos;
+            pos = contents.find(field, pos + 1)) {
+        if (pos == 0 || contents[pos - 1] == '\n') {
+            return strtoul(contents.c_str() + pos + strlen(field), nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+int64_t seconds_since_boot() {
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return ts.tv_sec;
+}
+
+class MemSampler : public android::BBinder {
+  public:
+    // Takes one sample of every running process.
+    void sample_all() {
+        DIR* dirp = opendir("/proc");
+        if (dirp == nullptr) {
+            ALOGE("unable to read /proc");
+            return;
+        }
+        int64_t now = seconds_since_boot();
+        std::lock_guard<std::mutex> lock(lock_);
+        for (auto& entry : series_) entry.second.seen = false;
+
+        struct dirent* entry;
+        while ((entry = readdir(dirp)) != nullptr) {
+            if (entry->d_type != DT_DIR) continue;
+            int pid;
+            if (!android::base::ParseInt(entry->d_name, &pid)) continue;
+            sample_locked(pid, now);
+        }
+        closedir(dirp);
+
+        for (auto it = series_.begin(); it != series_.end();) {
+            it = it->second.seen ? std::next(it) : series_.erase(it);
+        }
+    }
+
+    android::status_t dump(int fd, const android::Vector<android::String16>& args) override {
+        int only_pid = -1;
+        if (!args.empty() &&
+                !android::base::ParseInt(android::String8(args[0]).c_str(), &only_pid)) {
+            android::base::WriteStringToFd("usage: dumpsys memsampler [PID]\n", fd);
+            return android::BAD_VALUE;
+        }
+
+        std::string out;
+        std::lock_guard<std::mutex> lock(lock_);
+        for (const auto& [pid, series] : series_) {
+            if (only_pid != -1 && pid != only_pid) continue;
+            StringAppendF(&out, "%d %s\n", pid, series.cmdline.c_str());
+            size_t first = (series.next + series.samples.size() - series.count) %
+                    series.samples.size();
+            for (size_t i = 0; i < series.count; i++) {
+                const Sample& s = series.samples[(first + i) % series.samples.size()];
+                StringAppendF(&out,
+                        "  %" PRId64 "s rss=%ukB pss=%ukB swap=%ukB hwm=%ukB\n",
+                        s.time, s.rss_kb, s.pss_kb, s.swap_kb, s.hwm_kb);
+            }
+        }
+        android::base::WriteStringToFd(out, fd);
+        return android::OK;
+    }
+
+  private:
+    void sample_locked(int pid, int64_t now) {
+        // smaps_rollup has the sums of smaps, which the kernel computes without formatting
+        // every mapping.
+        if (!android::base::ReadFileToString(StringPrintf("/proc/%d/smaps_rollup", pid),
+                                             &buffer_)) {
+            return;
+        }
+        Sample sample = {.time = now};
+        sample.rss_kb = find_kb_field(buffer_, "Rss:");
+        sample.pss_kb = find_kb_field(buffer_, "Pss:");
+        sample.swap_kb = find_kb_field(buffer_, "Swap:");
+        if (android::base::ReadFileToString(StringPrintf("/proc/%d/status", pid), &buffer_)) {
+            sample.hwm_kb = find_kb_field(buffer_, "VmHWM:");
+        }
+
+        ProcessSeries& series = series_[pid];
+        if (series.count == 0) {
+            // The cmdline is only read once per process.
+            android::base::ReadFileToString(StringPrintf("/proc/%d/cmdline", pid),
+                                            &series.cmdline);
+            series.cmdline = series.cmdline.c_str();
+        }
+        series.seen = true;
+        series.add(sample);
+    }
+
+    std::mutex lock_;
+    std::map<int, ProcessSeries> series_;
+    // Reused for every /proc file read.
+    std::string buffer_;
+};
+
+}  // namespace
+
+int main(int /* argc */, char** /* argv[] */) {
+    android::sp<MemSampler> sampler = new MemSampler();
+    android::status_t status = android::defaultServiceManager()->addService(
+            android::String16("memsampler"), sampler);
+    if (status != android::OK) {
+        ALOGE("unable to register the memsampler service: %d", status);
+        return 1;
+    }
+    android::ProcessState::self()->startThreadPool();
+
+    while (true) {
+        sampler->sample_all();
+        int period = android::base::GetIntProperty("persist.memsampler.period_s",
+                                                   kDefaultPeriodSeconds, kMinPeriodSeconds);
+        sleep(period);
+    }
+    return 0;
+}
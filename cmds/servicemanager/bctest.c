@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 
 #include "binder.h"
 
@@ -54,6 +55,32 @@ int svcmgr_publish(struct binder_state *bs, uint32_t target, const char *name, v
     return status;
 }
 
+/* Times count lookups of name, the way getService() storms hit servicemanager at boot. */
+int svcmgr_bench_lookup(struct binder_state *bs, uint32_t target, const char *name, int count)
+{
+    struct timespec start, end;
+    uint32_t handle;
+    int64_t elapsed_ns;
+    int i;
+
+    if (count <= 0)
+        return -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < count; i++) {
+        handle = svcmgr_lookup(bs, target, name);
+        if (!handle)
+            return -1;
+        binder_release(bs, handle);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    elapsed_ns = (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+    fprintf(stderr, "bench(%s) %d lookups, %lld ns per lookup\n", name, count,
+            (long long) (elapsed_ns / count));
+    return 0;
+}
+
 unsigned token;
 
 int main(int argc, char **argv)
@@ -88,6 +115,17 @@ int main(int argc, char **argv)
             fprintf(stderr,"lookup(%s) = %x\n", argv[1], handle);
             argc--;
             argv++;
+        } else if (!strcmp(argv[0],"bench")) {
+            if (argc < 3) {
+                fprintf(stderr,"arguments required\n");
+                return -1;
+            }
+            if (svcmgr_bench_lookup(bs, svcmgr, argv[1], atoi(argv[2]))) {
+                fprintf(stderr,"cannot bench lookup(%s)\n", argv[1]);
+                return -1;
+            }
+            argc -= 2;
+            argv += 2;
         } else if (!strcmp(argv[0],"publish")) {
             if (argc < 2) {
                 fprintf(stderr,"argument required\n");
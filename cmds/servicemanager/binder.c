@@ -412,6 +412,34 @@ fail:
     return -1;
 }
 
+int binder_call_oneway(struct binder_state *bs, struct binder_io *msg,
+                       uint32_t target, uint32_t code)
+{
+    struct {
+        uint32_t cmd;
+        struct binder_transaction_data txn;
+    } __attribute__((packed)) writebuf;
+
+    if (msg->flags & BIO_F_OVERFLOW) {
+        fprintf(stderr,"binder: txn buffer overflow\n");
+        return -1;
+    }
+
+    /* The driver copies the data on write. Its BR_TRANSACTION_COMPLETE
+     * is read and ignored by whoever reads next. */
+    writebuf.cmd = BC_TRANSACTION;
+    writebuf.txn.target.handle = target;
+    writebuf.txn.cookie = 0;
+    writebuf.txn.code = code;
+    writebuf.txn.flags = TF_ONE_WAY;
+    writebuf.txn.data_size = msg->data - msg->data0;
+    writebuf.txn.offsets_size = ((char*) msg->offs) - ((char*) msg->offs0);
+    writebuf.txn.data.ptr.buffer = (uintptr_t)msg->data0;
+    writebuf.txn.data.ptr.offsets = (uintptr_t)msg->offs0;
+
+    return binder_write(bs, &writebuf, sizeof(writebuf)) < 0 ? -1 : 0;
+}
+
 void binder_loop(struct binder_state *bs, binder_handler func)
 {
     int res;
@@ -39,8 +39,13 @@ enum {
     SVC_MGR_CHECK_SERVICE,
     SVC_MGR_ADD_SERVICE,
     SVC_MGR_LIST_SERVICES,
+    SVC_MGR_REGISTER_FOR_NOTIFICATIONS,
 };
 
+/* Sent, oneway, to binders registered with SVC_MGR_REGISTER_FOR_NOTIFICATIONS
+ * once the service they wait for is added. Holds the service name. */
+#define SVC_MGR_SERVICE_REGISTERED 1
+
 typedef int (*binder_handler)(struct binder_state *bs,
                               struct binder_transaction_data_secctx *txn,
                               struct binder_io *msg,
@@ -56,6 +61,12 @@ int binder_call(struct binder_state *bs,
                 struct binder_io *msg, struct binder_io *reply,
                 uint32_t target, uint32_t code);
 
+/* initiate a oneway binder call
+ * - returns zero on success
+ */
+int binder_call_oneway(struct binder_state *bs, struct binder_io *msg,
+                       uint32_t target, uint32_t code);
+
 /* release any state associate with the binder_io
  * - call once any necessary data has been extracted from the
  *   binder_io after binder_call() returns
@@ -139,6 +139,8 @@ static int svc_can_find(const uint16_t *name, size_t name_len, pid_t spid, const
 struct svcinfo
 {
     struct svcinfo *next;
+    struct svcinfo *hash_next;
+    uint32_t hash;
     uint32_t handle;
     struct binder_death death;
     int allow_isolated;
@@ -147,14 +149,32 @@ struct svcinfo
     uint16_t name[0];
 };
 
+/* Every service, most recently added first, in the order list returns them. */
 struct svcinfo *svclist = NULL;
 
-struct svcinfo *find_svc(const uint16_t *s16, size_t len)
+/* The same services, chained by hash_next, for lookups by name. A few
+ * hundred services are registered on a typical device. */
+#define SVC_HASH_BUCKETS 512
+static struct svcinfo *svchash[SVC_HASH_BUCKETS];
+
+static uint32_t svc_hash(const uint16_t *s16, size_t len)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ s16[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static struct svcinfo *find_svc_hashed(const uint16_t *s16, size_t len, uint32_t hash)
 {
     struct svcinfo *si;
 
-    for (si = svclist; si; si = si->next) {
-        if ((len == si->len) &&
+    for (si = svchash[hash % SVC_HASH_BUCKETS]; si; si = si->hash_next) {
+        if ((hash == si->hash) && (len == si->len) &&
             !memcmp(s16, si->name, len * sizeof(uint16_t))) {
             return si;
         }
@@ -162,6 +182,84 @@ struct svcinfo *find_svc(const uint16_t *s16, size_t len)
     return NULL;
 }
 
+struct svcinfo *find_svc(const uint16_t *s16, size_t len)
+{
+    return find_svc_hashed(s16, len, svc_hash(s16, len));
+}
+
+/* A binder waiting for a service that isn't registered yet. Notified and
+ * dropped once the service is added. */
+struct svcwaiter
+{
+    struct svcwaiter *next;
+    uint32_t handle;
+    size_t len;
+    uint16_t name[0];
+};
+
+/* Waiters of clients that gave up or died are only dropped when their
+ * service shows up, so cap how many are kept. */
+#define SVC_MAX_WAITERS 256
+static struct svcwaiter *svcwaiters;
+static size_t svcwaiter_count;
+
+static int add_svc_waiter(struct binder_state *bs, const uint16_t *s, size_t len, uint32_t handle)
+{
+    struct svcwaiter *w;
+    struct svcwaiter **wp;
+
+    if (!handle || (len == 0) || (len > 127))
+        return -1;
+
+    if (svcwaiter_count == SVC_MAX_WAITERS) {
+        /* drop the oldest, at the end of the list */
+        for (wp = &svcwaiters; (*wp)->next; wp = &(*wp)->next)
+            ;
+        binder_release(bs, (*wp)->handle);
+        free(*wp);
+        *wp = NULL;
+        svcwaiter_count--;
+    }
+
+    w = malloc(sizeof(*w) + len * sizeof(uint16_t));
+    if (!w)
+        return -1;
+    w->handle = handle;
+    w->len = len;
+    memcpy(w->name, s, len * sizeof(uint16_t));
+    w->next = svcwaiters;
+    svcwaiters = w;
+    svcwaiter_count++;
+
+    binder_acquire(bs, handle);
+    return 0;
+}
+
+static void notify_svc_waiters(struct binder_state *bs, const struct svcinfo *si)
+{
+    struct svcwaiter **wp = &svcwaiters;
+    struct svcwaiter *w;
+    unsigned iodata[512/4];
+    struct binder_io msg;
+
+    while ((w = *wp) != NULL) {
+        if ((w->len != si->len) || memcmp(w->name, si->name, si->len * sizeof(uint16_t))) {
+            wp = &w->next;
+            continue;
+        }
+
+        bio_init(&msg, iodata, sizeof(iodata), 4);
+        bio_put_string16(&msg, si->name);
+        if (binder_call_oneway(bs, &msg, w->handle, SVC_MGR_SERVICE_REGISTERED)) {
+            ALOGW("could not notify a waiter for '%s'\n", str8(si->name, si->len));
+        }
+        binder_release(bs, w->handle);
+        *wp = w->next;
+        free(w);
+        svcwaiter_count--;
+    }
+}
+
 void svcinfo_death(struct binder_state *bs, void *ptr)
 {
     struct svcinfo *si = (struct svcinfo* ) ptr;
@@ -206,6 +304,7 @@ uint32_t do_find_service(const uint16_t *s, size_t len, uid_t uid, pid_t spid, c
 int do_add_service(struct binder_state *bs, const uint16_t *s, size_t len, uint32_t handle,
                    uid_t uid, int allow_isolated, uint32_t dumpsys_priority, pid_t spid, const char* sid) {
     struct svcinfo *si;
+    uint32_t hash;
 
     //ALOGI("add_service('%s',%x,%s) uid=%d\n", str8(s, len), handle,
     //        allow_isolated ? "allow_isolated" : "!allow_isolated", uid);
@@ -219,7 +318,8 @@ int do_add_service(struct binder_state *bs, const uint16_t *s, size_t len, uint3
         return -1;
     }
 
-    si = find_svc(s, len);
+    hash = svc_hash(s, len);
+    si = find_svc_hashed(s, len, hash);
     if (si) {
         if (si->handle) {
             ALOGE("add_service('%s',%x) uid=%d - ALREADY REGISTERED, OVERRIDE\n",
@@ -244,10 +344,14 @@ int do_add_service(struct binder_state *bs, const uint16_t *s, size_t len, uint3
         si->dumpsys_priority = dumpsys_priority;
         si->next = svclist;
         svclist = si;
+        si->hash = hash;
+        si->hash_next = svchash[hash % SVC_HASH_BUCKETS];
+        svchash[hash % SVC_HASH_BUCKETS] = si;
     }
 
     binder_acquire(bs, handle);
     binder_link_to_death(bs, handle, &si->death);
+    notify_svc_waiters(bs, si);
     return 0;
 }
 
@@ -331,6 +435,26 @@ int svcmgr_handler(struct binder_state *bs,
             return -1;
         break;
 
+    case SVC_MGR_REGISTER_FOR_NOTIFICATIONS:
+        s = bio_get_string16(msg, &len);
+        if (s == NULL) {
+            return -1;
+        }
+        handle = bio_get_ref(msg);
+        if (!svc_can_find(s, len, txn->sender_pid, (const char*) txn_secctx->secctx,
+                          txn->sender_euid)) {
+            return -1;
+        }
+        si = find_svc(s, len);
+        if (si && si->handle) {
+            /* Already there, the caller should look it up again */
+            bio_put_uint32(reply, 1);
+            return 0;
+        }
+        if (add_svc_waiter(bs, s, len, handle))
+            return -1;
+        break;
+
     case SVC_MGR_LIST_SERVICES: {
         uint32_t n = bio_get_uint32(msg);
         uint32_t req_dumpsys_priority = bio_get_uint32(msg);
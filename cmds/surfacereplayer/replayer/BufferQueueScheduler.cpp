@@ -43,7 +43,8 @@ void BufferQueueScheduler::startScheduling() {
             lock.unlock();
 
             bufferUpdate(event.dimensions);
-            fillSurface(event.event);
+            fillSurface(event.event, event.timestamp);
+            updateFrameStats();
             mColor.modulate();
             lock.lock();
             mBufferEvents.pop();
@@ -77,9 +78,11 @@ void BufferQueueScheduler::bufferUpdate(const Dimensions& dimensions) {
     s->setBuffersDimensions(dimensions.width, dimensions.height);
 }
 
-void BufferQueueScheduler::fillSurface(const std::shared_ptr<Event>& event) {
+void BufferQueueScheduler::fillSurface(const std::shared_ptr<Event>& event, nsecs_t traceTime) {
     ANativeWindow_Buffer outBuffer;
     sp<Surface> s = mSurfaceControl->getSurface();
+    s->enableFrameTimestamps(true);
+    const uint64_t frameNumber = s->getNextFrameNumber();
 
     status_t status = s->lock(&outBuffer, nullptr);
 
@@ -106,4 +109,54 @@ void BufferQueueScheduler::fillSurface(const std::shared_ptr<Event>& event) {
     status = s->unlockAndPost();
 
     ALOGE_IF(status != NO_ERROR, "fillSurface: failed to unlock and post buffer, (%d)", status);
+    if (status == NO_ERROR) {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mStatsSurface = s;
+        mPostedFrames.push_back({frameNumber, traceTime});
+    }
+}
+
+void BufferQueueScheduler::updateFrameStats() {
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+    if (mStatsSurface == nullptr) {
+        return;
+    }
+
+    nsecs_t refreshPeriod = 0;
+    mStatsSurface->getDisplayRefreshCycleDuration(&refreshPeriod);
+
+    while (!mPostedFrames.empty()) {
+        const PostedFrame frame = mPostedFrames.front();
+        nsecs_t requestedPresentTime = NATIVE_WINDOW_TIMESTAMP_INVALID;
+        nsecs_t presentTime = NATIVE_WINDOW_TIMESTAMP_INVALID;
+        status_t status = mStatsSurface->getFrameTimestamps(frame.frameNumber,
+                &requestedPresentTime, nullptr, nullptr, nullptr, nullptr, nullptr, &presentTime,
+                nullptr, nullptr);
+        if (status == NO_ERROR && presentTime == NATIVE_WINDOW_TIMESTAMP_PENDING) {
+            break;
+        }
+        mPostedFrames.pop_front();
+
+        // Frames that were dropped, or whose history was already overwritten,
+        // have no present time.
+        if (status != NO_ERROR || presentTime < 0) {
+            continue;
+        }
+
+        mFrameStats.latencies.push_back(presentTime - requestedPresentTime);
+        if (mLastPresentTime != 0 && refreshPeriod > 0) {
+            const nsecs_t recordedInterval = frame.traceTime - mLastTraceTime;
+            const nsecs_t presentInterval = presentTime - mLastPresentTime;
+            if (presentInterval - recordedInterval >= refreshPeriod) {
+                mFrameStats.missedFrames++;
+            }
+        }
+        mLastPresentTime = presentTime;
+        mLastTraceTime = frame.traceTime;
+    }
+}
+
+FrameStats BufferQueueScheduler::getFrameStats() {
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+    return mFrameStats;
 }
@@ -20,15 +20,19 @@
 #include "Color.h"
 #include "Event.h"
 
+#include <gui/Surface.h>
 #include <gui/SurfaceControl.h>
 
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <queue>
 #include <utility>
+#include <vector>
 
 namespace android {
 
@@ -44,10 +48,21 @@ struct Dimensions {
 
 struct BufferEvent {
     BufferEvent() = default;
-    BufferEvent(std::shared_ptr<Event> e, Dimensions d) : event(e), dimensions(d) {}
+    BufferEvent(std::shared_ptr<Event> e, Dimensions d, nsecs_t t)
+          : event(e), dimensions(d), timestamp(t) {}
 
     std::shared_ptr<Event> event;
     Dimensions dimensions;
+    // When the buffer was queued in the recorded trace
+    nsecs_t timestamp = 0;
+};
+
+struct FrameStats {
+    // Time from queueing each presented buffer to its display present
+    std::vector<nsecs_t> latencies;
+    // Buffers presented at least one refresh later than the recorded interval
+    // from the previous buffer of the same surface implies
+    int missedFrames = 0;
 };
 
 class BufferQueueScheduler {
@@ -60,12 +75,21 @@ class BufferQueueScheduler {
 
     void setSurfaceControl(const sp<SurfaceControl>& surfaceControl, const HSV& color);
 
+    // Collects the frame timestamps of the buffers presented so far.
+    void updateFrameStats();
+    FrameStats getFrameStats();
+
   private:
+    struct PostedFrame {
+        uint64_t frameNumber;
+        nsecs_t traceTime;
+    };
+
     void bufferUpdate(const Dimensions& dimensions);
 
     // Lock and fill the surface, block until the event is signaled by the main loop,
     // then unlock and post the buffer.
-    void fillSurface(const std::shared_ptr<Event>& event);
+    void fillSurface(const std::shared_ptr<Event>& event, nsecs_t traceTime);
 
     sp<SurfaceControl> mSurfaceControl;
     HSV mColor;
@@ -76,6 +100,13 @@ class BufferQueueScheduler {
     std::queue<BufferEvent> mBufferEvents;
     std::mutex mMutex;
     std::condition_variable mCondition;
+
+    std::mutex mStatsMutex;
+    sp<Surface> mStatsSurface;
+    std::deque<PostedFrame> mPostedFrames;
+    FrameStats mFrameStats;
+    nsecs_t mLastPresentTime = 0;
+    nsecs_t mLastTraceTime = 0;
 };
 
 }  // namespace android
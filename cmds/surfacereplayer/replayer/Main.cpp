@@ -51,6 +51,8 @@ void printHelpMenu() {
 
     std::cout << "  -l  Indefinitely loop the replayer\n";
 
+    std::cout << "  -r  Report composition latency and missed frames after replaying\n";
+
     std::cout << "  -h  Display help menu\n";
 
     std::cout << std::endl;
@@ -63,9 +65,10 @@ int main(int argc, char** argv) {
     bool pauseBeginning = false;
     int numThreads = DEFAULT_THREADS;
     long stopHere = -1;
+    bool reportStats = false;
 
     int opt = 0;
-    while ((opt = getopt(argc, argv, "mt:s:nlh?")) != -1) {
+    while ((opt = getopt(argc, argv, "mt:s:nlrh?")) != -1) {
         switch (opt) {
             case 'm':
                 pauseBeginning = true;
@@ -82,6 +85,9 @@ int main(int argc, char** argv) {
             case 'l':
                 loop = true;
                 break;
+            case 'r':
+                reportStats = true;
+                break;
             case 'h':
             case '?':
                 printHelpMenu();
@@ -102,7 +108,7 @@ int main(int argc, char** argv) {
 
     status_t status = NO_ERROR;
     do {
-        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere);
+        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere, reportStats);
         status = r.replay();
     } while(loop);
 
@@ -20,7 +20,8 @@
 
 #include <android/native_window.h>
 
-#include <android-base/file.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
 
 #include <gui/BufferQueue.h>
 #include <gui/ISurfaceComposer.h>
@@ -33,6 +34,10 @@
 #include <utils/String8.h>
 #include <utils/Trace.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <condition_variable>
@@ -50,30 +55,50 @@ using namespace android;
 
 std::atomic_bool Replayer::sReplayingManually(false);
 
+namespace {
+
+class FdInputStream : public google::protobuf::io::CopyingInputStream {
+  public:
+    explicit FdInputStream(android::base::unique_fd fd) : mFd(std::move(fd)) {}
+
+    int Read(void* buffer, int size) override {
+        return TEMP_FAILURE_RETRY(read(mFd, buffer, size));
+    }
+
+  private:
+    android::base::unique_fd mFd;
+};
+
+}  // namespace
+
 Replayer::Replayer(const std::string& filename, bool replayManually, int numThreads, bool wait,
-        nsecs_t stopHere)
-      : mTrace(),
-        mLoaded(false),
+        nsecs_t stopHere, bool reportStats)
+      : mLoaded(false),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
         mWaitForTimeStamps(wait),
-        mStopTimeStamp(stopHere) {
+        mStopTimeStamp(stopHere),
+        mReportStats(reportStats) {
     srand(RAND_COLOR_SEED);
 
-    std::string input;
-    if (!android::base::ReadFileToString(filename, &input, true)) {
+    android::base::unique_fd fd(open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
         std::cerr << "Trace did not load. Does " << filename << " exist?" << std::endl;
         abort();
     }
+    mTraceStream = std::make_unique<google::protobuf::io::CopyingInputStreamAdaptor>(
+            new FdInputStream(std::move(fd)));
+    mTraceStream->SetOwnsCopyingStream(true);
 
-    mLoaded = mTrace.ParseFromString(input);
+    const Increment* first = getIncrement(0);
+    mLoaded = first != nullptr;
     if (!mLoaded) {
         std::cerr << "Trace did not load." << std::endl;
         abort();
     }
 
-    mCurrentTime = mTrace.increment(0).time_stamp();
+    mCurrentTime = first->time_stamp();
 
     sReplayingManually.store(replayManually);
 
@@ -82,16 +107,18 @@ Replayer::Replayer(const std::string& filename, bool replayManually, int numThre
     }
 }
 
-Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere)
-      : mTrace(t),
+Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere,
+        bool reportStats)
+      : mIncrements(t.increment().begin(), t.increment().end()),
         mLoaded(true),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
         mWaitForTimeStamps(wait),
-        mStopTimeStamp(stopHere) {
+        mStopTimeStamp(stopHere),
+        mReportStats(reportStats) {
     srand(RAND_COLOR_SEED);
-    mCurrentTime = mTrace.increment(0).time_stamp();
+    mCurrentTime = mIncrements.empty() ? 0 : mIncrements.front().time_stamp();
 
     sReplayingManually.store(replayManually);
 
@@ -103,7 +130,6 @@ Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wai
 status_t Replayer::replay() {
     signal(SIGINT, Replayer::stopAutoReplayHandler); //for manual control
 
-    ALOGV("There are %d increments.", mTrace.increment_size());
 
     status_t status = loadSurfaceComposerClient();
 
@@ -118,7 +144,7 @@ status_t Replayer::replay() {
 
     ALOGV("Starting actual Replay!");
     while (!mPendingIncrements.empty()) {
-        mCurrentIncrement = mTrace.increment(mIncrementIndex);
+        mCurrentIncrement = *getIncrement(mIncrementIndex);
 
         if (mHasStopped == false && mCurrentIncrement.time_stamp() >= mStopTimeStamp) {
             mHasStopped = true;
@@ -140,7 +166,7 @@ status_t Replayer::replay() {
             mWaitingForNextVSync = false;
         }
 
-        if (mIncrementIndex + mNumThreads < mTrace.increment_size()) {
+        if (getIncrement(mIncrementIndex + mNumThreads) != nullptr) {
             status = dispatchEvent(mIncrementIndex + mNumThreads);
 
             if (status != NO_ERROR) {
@@ -155,11 +181,46 @@ status_t Replayer::replay() {
 
     SurfaceComposerClient::enableVSyncInjections(false);
 
+    if (mReportStats) {
+        reportFrameStats();
+    }
+
     return status;
 }
 
+void Replayer::reportFrameStats() {
+    // Give the last frames time to be presented.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<nsecs_t> latencies;
+    int missedFrames = 0;
+    {
+        std::lock_guard<std::mutex> lock(mBufferQueueSchedulerLock);
+        for (const auto& [id, scheduler] : mBufferQueueSchedulers) {
+            scheduler->updateFrameStats();
+            const FrameStats stats = scheduler->getFrameStats();
+            latencies.insert(latencies.end(), stats.latencies.begin(), stats.latencies.end());
+            missedFrames += stats.missedFrames;
+        }
+    }
+
+    std::cout << "Presented frames: " << latencies.size() << "\n";
+    std::cout << "Missed frames: " << missedFrames << "\n";
+    if (latencies.empty()) {
+        return;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&](size_t p) {
+        return ns2us(latencies[(latencies.size() - 1) * p / 100]) / 1000.0;
+    };
+    std::cout << "Queue to present latency (ms): p50 " << percentile(50) << ", p90 "
+              << percentile(90) << ", p99 " << percentile(99) << ", max " << percentile(100)
+              << std::endl;
+}
+
 status_t Replayer::initReplay() {
-    for (int i = 0; i < mNumThreads && i < mTrace.increment_size(); i++) {
+    for (int i = 0; i < mNumThreads && getIncrement(i) != nullptr; i++) {
         status_t status = dispatchEvent(i);
 
         if (status != NO_ERROR) {
@@ -273,7 +334,7 @@ void Replayer::waitForConsoleCommmand() {
 }
 
 status_t Replayer::dispatchEvent(int index) {
-    auto increment = mTrace.increment(index);
+    auto increment = *getIncrement(index);
     std::shared_ptr<Event> event = std::make_shared<Event>(increment.increment_case());
     mPendingIncrements.push(event);
 
@@ -291,7 +352,7 @@ status_t Replayer::dispatchEvent(int index) {
             std::lock_guard<std::mutex> lock2(mBufferQueueSchedulerLock);
 
             Dimensions dimensions(increment.buffer_update().w(), increment.buffer_update().h());
-            BufferEvent bufferEvent(event, dimensions);
+            BufferEvent bufferEvent(event, dimensions, increment.time_stamp());
 
             auto layerId = increment.buffer_update().id();
             if (mBufferQueueSchedulers.count(layerId) == 0) {
@@ -680,3 +741,62 @@ status_t Replayer::loadSurfaceComposerClient() {
     mComposerClient = new SurfaceComposerClient;
     return mComposerClient->initCheck();
 }
+
+const Increment* Replayer::getIncrement(int32_t index) {
+    while (mFirstIncrementIndex < mIncrementIndex && !mIncrements.empty()) {
+        mIncrements.pop_front();
+        mFirstIncrementIndex++;
+    }
+    if (index < mFirstIncrementIndex) {
+        return nullptr;
+    }
+    while (index - mFirstIncrementIndex >= static_cast<int32_t>(mIncrements.size())) {
+        if (!readNextIncrement()) {
+            return nullptr;
+        }
+    }
+    return &mIncrements[index - mFirstIncrementIndex];
+}
+
+bool Replayer::readNextIncrement() {
+    using google::protobuf::internal::WireFormatLite;
+
+    if (mTraceStream == nullptr) {
+        return false;
+    }
+
+    // A trace is a sequence of length delimited increment fields, which lets
+    // them be parsed one at a time.
+    google::protobuf::io::CodedInputStream input(mTraceStream.get());
+    while (true) {
+        const uint32_t tag = input.ReadTag();
+        if (tag == 0) {
+            break;
+        }
+        if (WireFormatLite::GetTagFieldNumber(tag) != Trace::kIncrementFieldNumber ||
+            WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+            if (!WireFormatLite::SkipField(&input, tag)) {
+                break;
+            }
+            continue;
+        }
+
+        uint32_t length;
+        if (!input.ReadVarint32(&length)) {
+            break;
+        }
+        const auto limit = input.PushLimit(length);
+        Increment increment;
+        if (!increment.ParseFromCodedStream(&input) || !input.ConsumedEntireMessage()) {
+            ALOGE("Increment %d of the trace is corrupt",
+                  mFirstIncrementIndex + static_cast<int32_t>(mIncrements.size()));
+            break;
+        }
+        input.PopLimit(limit);
+        mIncrements.push_back(std::move(increment));
+        return true;
+    }
+
+    mTraceStream.reset();
+    return false;
+}
@@ -23,6 +23,9 @@
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
+#include <android-base/unique_fd.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
 #include <gui/SurfaceComposerClient.h>
 #include <gui/SurfaceControl.h>
 
@@ -31,6 +34,7 @@
 
 #include <stdatomic.h>
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -53,14 +57,17 @@ typedef google::protobuf::RepeatedPtrField<DisplayChange> DisplayChanges;
 class Replayer {
   public:
     Replayer(const std::string& filename, bool replayManually = false,
-            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1);
+            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1,
+            bool reportStats = false);
     Replayer(const Trace& trace, bool replayManually = false, int numThreads = DEFAULT_THREADS,
-            bool wait = true, nsecs_t stopHere = -1);
+            bool wait = true, nsecs_t stopHere = -1, bool reportStats = false);
 
     status_t replay();
 
   private:
     status_t initReplay();
+    // Prints the composition latency and missed frames of all replayed buffers.
+    void reportFrameStats();
 
     void waitForConsoleCommmand();
     static void stopAutoReplayHandler(int signal);
@@ -123,7 +130,15 @@ class Replayer {
             const DeferredTransactionChange& dtc, std::unique_lock<std::mutex>& lock);
     status_t loadSurfaceComposerClient();
 
-    Trace mTrace;
+    // Returns the increment at index, or nullptr past the end of the trace.
+    // Trace files are read as increments are needed, and increments before
+    // mIncrementIndex are dropped, so long traces don't have to fit in memory.
+    const Increment* getIncrement(int32_t index);
+    bool readNextIncrement();
+
+    std::deque<Increment> mIncrements;
+    int32_t mFirstIncrementIndex = 0;
+    std::unique_ptr<google::protobuf::io::CopyingInputStreamAdaptor> mTraceStream;
     bool mLoaded = false;
     int32_t mIncrementIndex = 0;
     int64_t mCurrentTime = 0;
@@ -137,6 +152,7 @@ class Replayer {
     bool mWaitingForNextVSync;
     bool mWaitForTimeStamps;
     nsecs_t mStopTimeStamp;
+    bool mReportStats;
     bool mHasStopped;
 
     std::mutex mLayerLock;
@@ -20,13 +20,43 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <vector>
+
 #include <binder/IInterface.h>
 
+#include <input/InputLatencyStats.h>
 #include <input/InputWindow.h>
 #include <input/ISetInputWindowsListener.h>
 
 namespace android {
 
+/*
+ * Changes to the input window list since an earlier generation of it. Windows are keyed by
+ * their token, so windows without a token can't be part of an update.
+ */
+struct InputWindowsUpdate {
+    // Generation the update applies to, or 0 if changedWindows is the full list.
+    uint64_t baseGeneration = 0;
+    // Generation of the list once the update is applied.
+    uint64_t generation = 0;
+    // Windows that were added or whose info changed since baseGeneration.
+    std::vector<InputWindowInfo> changedWindows;
+    // Tokens of the windows removed since baseGeneration.
+    std::vector<sp<IBinder>> removedWindows;
+    // Tokens of every window, front to back. Empty if windows were neither added nor moved, in
+    // which case the remaining windows keep their order. Unused for full lists, which are
+    // already front to back.
+    std::vector<sp<IBinder>> order;
+
+    bool isFull() const { return baseGeneration == 0; }
+    bool isEmpty() const {
+        return changedWindows.empty() && removedWindows.empty() && order.empty();
+    }
+
+    status_t write(Parcel& output) const;
+    static status_t read(const Parcel& from, InputWindowsUpdate* outUpdate);
+};
+
 /*
  * This class defines the Binder IPC interface for accessing various
  * InputFlinger features.
@@ -37,9 +67,23 @@ public:
 
     virtual void setInputWindows(const std::vector<InputWindowInfo>& inputHandles,
             const sp<ISetInputWindowsListener>& setInputWindowsListener) = 0;
+    /*
+     * Applies an update to the windows sent by the previous updateInputWindows call, so that
+     * only the windows that changed cross binder. Updates that don't apply to the current
+     * generation are dropped. The call is oneway, so the only way a delta can stop applying is
+     * an earlier update failing to be delivered. The sender must then start over with a full
+     * list, which is why the transaction's status is returned.
+     */
+    virtual status_t updateInputWindows(const InputWindowsUpdate& update,
+            const sp<ISetInputWindowsListener>& setInputWindowsListener) = 0;
     virtual void transferTouchFocus(const sp<IBinder>& fromToken, const sp<IBinder>& toToken) = 0;
     virtual void registerInputChannel(const sp<InputChannel>& channel) = 0;
     virtual void unregisterInputChannel(const sp<InputChannel>& channel) = 0;
+    /*
+     * Gets the latency histograms of every window input was delivered to, since the window's
+     * input channel was registered.
+     */
+    virtual status_t getInputLatencyStats(std::vector<InputLatencyStats>* outStats) = 0;
 };
 
 
@@ -52,7 +96,9 @@ public:
         SET_INPUT_WINDOWS_TRANSACTION = IBinder::FIRST_CALL_TRANSACTION,
         REGISTER_INPUT_CHANNEL_TRANSACTION,
         UNREGISTER_INPUT_CHANNEL_TRANSACTION,
-        TRANSFER_TOUCH_FOCUS
+        TRANSFER_TOUCH_FOCUS,
+        UPDATE_INPUT_WINDOWS_TRANSACTION,
+        GET_INPUT_LATENCY_STATS_TRANSACTION,
     };
 
     virtual status_t onTransact(uint32_t code, const Parcel& data,
@@ -38,6 +38,9 @@ struct InputApplicationInfo {
 
     status_t write(Parcel& output) const;
     static InputApplicationInfo read(const Parcel& from);
+
+    bool operator==(const InputApplicationInfo& other) const;
+    bool operator!=(const InputApplicationInfo& other) const { return !(*this == other); }
 };
 
 
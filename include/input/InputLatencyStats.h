@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LIBINPUT_INPUT_LATENCY_STATS_H
+#define _LIBINPUT_INPUT_LATENCY_STATS_H
+
+#include <stdint.h>
+
+#include <array>
+#include <string>
+
+#include <binder/Parcel.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+/*
+ * Histograms of how long the input events delivered to one window spent in each stage
+ * of the pipeline. Kept by the dispatcher, and pulled with IInputFlinger::getInputLatencyStats.
+ */
+struct InputLatencyStats {
+    enum Stage {
+        // From the kernel timestamp of the event to the dispatcher queueing it: the time
+        // spent in the reader and the classifier.
+        STAGE_EVENT_TO_DISPATCHER,
+        // From the dispatcher queueing the event to publishing it to the window.
+        STAGE_DISPATCHER_TO_PUBLISH,
+        // From the publish to the window reporting the event finished.
+        STAGE_PUBLISH_TO_FINISH,
+        // From the kernel timestamp to the window reporting the event finished.
+        STAGE_END_TO_END,
+
+        STAGE_COUNT
+    };
+
+    // Bucket i counts latencies up to BUCKET_LIMITS_US[i], and above the previous limit.
+    // The last bucket counts everything above the last limit.
+    static constexpr size_t BUCKET_COUNT = 12;
+    static constexpr std::array<nsecs_t, BUCKET_COUNT - 1> BUCKET_LIMITS_US = {
+            500, 1000, 2000, 4000, 8000, 16000, 32000, 64000, 128000, 256000, 512000};
+
+    std::string windowName;
+    std::array<std::array<uint32_t, BUCKET_COUNT>, STAGE_COUNT> histograms = {};
+
+    void record(Stage stage, nsecs_t latency);
+    uint32_t getCount(Stage stage) const;
+    // Returns the upper limit of the bucket holding the given percentile, in nanoseconds,
+    // -1 for the open-ended last bucket, or 0 if nothing was recorded.
+    nsecs_t getPercentile(Stage stage, float percentile) const;
+
+    static const char* stageToString(Stage stage);
+
+    status_t write(Parcel& output) const;
+    static status_t read(const Parcel& from, InputLatencyStats* outStats);
+};
+
+} // namespace android
+
+#endif // _LIBINPUT_INPUT_LATENCY_STATS_H
@@ -29,10 +29,12 @@
  * The InputConsumer is used by the application to receive events from the input dispatcher.
  */
 
+#include <memory>
 #include <string>
 
 #include <binder/IBinder.h>
 #include <input/Input.h>
+#include <input/TouchPredictor.h>
 #include <utils/Errors.h>
 #include <utils/Timers.h>
 #include <utils/RefBase.h>
@@ -60,6 +62,7 @@ struct InputMessage {
         TYPE_KEY = 1,
         TYPE_MOTION = 2,
         TYPE_FINISHED = 3,
+        TYPE_SAMPLE_RING_WAKEUP = 4,
     };
 
     struct Header {
@@ -141,6 +144,16 @@ struct InputMessage {
                 return sizeof(Finished);
             }
         } finished;
+
+        // Tells the consumer that motion samples up to this run may be waiting in the
+        // channel's InputSampleRing.
+        struct SampleRingWakeup {
+            uint64_t run;
+
+            inline size_t size() const {
+                return sizeof(SampleRingWakeup);
+            }
+        } sampleRingWakeup;
     } __attribute__((aligned(8))) body;
 
     bool isValid(size_t actualSize) const;
@@ -148,6 +161,79 @@ struct InputMessage {
     void getSanitizedCopy(InputMessage* msg) const;
 };
 
+/*
+ * A ring of motion samples in shared memory, shared by the two ends of an input channel.
+ *
+ * The publisher writes batchable motion samples into the ring instead of onto the socket,
+ * and the consumer reads them back in order. Only one thread may write and only one thread
+ * may read at a time; neither side takes a lock.
+ *
+ * Samples are grouped in runs. The publisher starts a new run after any message it sent on
+ * the socket, and announces each run with a TYPE_SAMPLE_RING_WAKEUP message on the socket,
+ * so the consumer never reads a sample ahead of a socket message that was sent before it.
+ * Within a run, the socket only carries a wakeup when the consumer may have gone idle.
+ */
+class InputSampleRing : public RefBase {
+protected:
+    virtual ~InputSampleRing();
+
+public:
+    /* Creates a ring with room for capacity samples.
+     * Returns nullptr if the shared memory could not be allocated.
+     */
+    static sp<InputSampleRing> create(const std::string& name, size_t capacity);
+
+    /* Maps a ring made by create, e.g. in another process. Takes ownership of fd.
+     * Returns nullptr if fd does not refer to a valid ring.
+     */
+    static sp<InputSampleRing> map(int fd);
+
+    inline int getFd() const { return mFd; }
+    inline size_t getCapacity() const { return mCapacity; }
+
+    /* Appends a sample written in the given run. Publisher only.
+     *
+     * Returns false if the ring is full, or if the consumer corrupted it, in which case the
+     * sample should be sent on the socket instead.
+     * Sets *outWasEmpty if the consumer had already read every earlier sample, in which case
+     * it may have gone idle and should be woken up.
+     */
+    bool write(const InputMessage* msg, uint64_t run, bool* outWasEmpty);
+
+    /* Removes the sample appended by the last call to write, which the consumer cannot have
+     * read yet because its run has not been announced. Publisher only.
+     */
+    void unwrite();
+
+    /* Returns true if the oldest sample in the ring was written in a run no later than run.
+     * Consumer only. Samples that fail validation are dropped.
+     */
+    bool hasSample(uint64_t run);
+
+    /* Takes the oldest sample if hasSample(run). Consumer only. */
+    bool read(uint64_t run, InputMessage* outMsg);
+
+private:
+    struct Header;
+    struct Slot;
+
+    InputSampleRing(int fd, void* data, size_t size, uint32_t capacity);
+
+    Header* getHeader() const;
+    Slot* getSlot(uint32_t index) const;
+    uint32_t nextIndex(uint32_t index) const;
+
+    int mFd;
+    void* mData;
+    size_t mSize;
+    uint32_t mCapacity;
+    // The publisher's own copy of the head index. The consumer can write to the shared memory,
+    // so the publisher never reads indices back from it without checking them.
+    uint32_t mHead = 0;
+    // Set by the publisher when the indices in shared memory stop making sense.
+    bool mBroken = false;
+};
+
 /*
  * An input channel consists of a local unix domain socket used to send and receive
  * input messages across processes.  Each channel has a descriptive name for debugging purposes.
@@ -165,15 +251,31 @@ public:
     InputChannel(const std::string& name, int fd);
 
     /* Creates a pair of input channels.
+     *
+     * The channels share an InputSampleRing with room for the number of motion samples
+     * given by the ro.input.sample_ring_capacity property (none by default).
      *
      * Returns OK on success.
      */
     static status_t openInputChannelPair(const std::string& name,
             sp<InputChannel>& outServerChannel, sp<InputChannel>& outClientChannel);
 
+    /* Creates a pair of input channels that share an InputSampleRing with room for
+     * sampleRingCapacity motion samples, or no ring if sampleRingCapacity is 0.
+     * The channels still work if the ring can't be created.
+     *
+     * Returns OK on success.
+     */
+    static status_t openInputChannelPair(const std::string& name,
+            sp<InputChannel>& outServerChannel, sp<InputChannel>& outClientChannel,
+            size_t sampleRingCapacity);
+
     inline std::string getName() const { return mName; }
     inline int getFd() const { return mFd; }
 
+    /* Gets the motion sample ring shared with the other endpoint, or nullptr if none. */
+    inline const sp<InputSampleRing>& getSampleRing() const { return mSampleRing; }
+
     /* Sends a message to the other endpoint.
      *
      * If the channel is full then the message is guaranteed not to have been sent at all.
@@ -213,6 +315,7 @@ private:
 
     std::string mName;
     int mFd = -1;
+    sp<InputSampleRing> mSampleRing;
 
     sp<IBinder> mToken = nullptr;
 };
@@ -283,6 +386,66 @@ public:
             const PointerProperties* pointerProperties,
             const PointerCoords* pointerCoords);
 
+    /* Fills in the message publishKeyEvent would send, without sending it.
+     * The message can be sent later with publishMessage, e.g. once the caller has released
+     * the locks that protect the event.
+     *
+     * Returns OK on success.
+     * Returns BAD_VALUE if seq is 0.
+     */
+    status_t makeKeyEventMessage(InputMessage* outMsg,
+            uint32_t seq,
+            int32_t deviceId,
+            int32_t source,
+            int32_t displayId,
+            int32_t action,
+            int32_t flags,
+            int32_t keyCode,
+            int32_t scanCode,
+            int32_t metaState,
+            int32_t repeatCount,
+            nsecs_t downTime,
+            nsecs_t eventTime) const;
+
+    /* Fills in the message publishMotionEvent would send, without sending it.
+     *
+     * Returns OK on success.
+     * Returns BAD_VALUE if seq is 0 or if pointerCount is less than 1 or greater than MAX_POINTERS.
+     */
+    status_t makeMotionEventMessage(InputMessage* outMsg,
+            uint32_t seq,
+            int32_t deviceId,
+            int32_t source,
+            int32_t displayId,
+            int32_t action,
+            int32_t actionButton,
+            int32_t flags,
+            int32_t edgeFlags,
+            int32_t metaState,
+            int32_t buttonState,
+            MotionClassification classification,
+            float xOffset,
+            float yOffset,
+            float xPrecision,
+            float yPrecision,
+            nsecs_t downTime,
+            nsecs_t eventTime,
+            uint32_t pointerCount,
+            const PointerProperties* pointerProperties,
+            const PointerCoords* pointerCoords) const;
+
+    /* Publishes a message made by makeKeyEventMessage or makeMotionEventMessage.
+     *
+     * If the channel has a sample ring, batchable motion samples are written to it, and the
+     * socket only carries a wakeup when needed.
+     *
+     * Returns OK on success.
+     * Returns WOULD_BLOCK if the channel is full.
+     * Returns DEAD_OBJECT if the channel's peer has been closed.
+     * Other errors probably indicate that the channel is broken.
+     */
+    status_t publishMessage(const InputMessage& msg);
+
     /* Receives the finished signal from the consumer in reply to the original dispatch signal.
      * If a signal was received, returns the message sequence number,
      * and whether the consumer handled the message.
@@ -298,6 +461,14 @@ public:
 
 private:
     sp<InputChannel> mChannel;
+
+    // The current run of samples in the channel's sample ring, and whether more samples may
+    // still be added to it, i.e. nothing has been sent on the socket since it was announced.
+    uint64_t mSampleRingRun = 0;
+    bool mSampleRingRunOpen = false;
+
+    status_t publishToSampleRing(const sp<InputSampleRing>& ring, const InputMessage& msg);
+    status_t sendSampleRingWakeup(uint64_t run);
 };
 
 /*
@@ -376,12 +547,29 @@ public:
      */
     bool hasPendingBatch() const;
 
+    /* Switches touch resampling to predictive mode, or back to the default mode if predictor
+     * is null.
+     *
+     * In predictive mode, batched touch moves are not resampled to slightly before the frame
+     * time but predicted ahead to frameTime + presentLatency, the time the frame is expected
+     * to reach the display. The predictor is fed the real coordinates of every touch sample
+     * the consumer receives.
+     */
+    void setTouchPredictor(std::unique_ptr<TouchPredictor> predictor, nsecs_t presentLatency);
+
 private:
     int mTouchMoveCounter = 0;
 
     // True if touch resampling is enabled.
     const bool mResampleTouch;
 
+    // The touch predictor for predictive resampling, or null. It follows one device and
+    // source at a time.
+    std::unique_ptr<TouchPredictor> mTouchPredictor;
+    nsecs_t mPresentLatency = 0;
+    int32_t mTouchPredictorDeviceId = -1;
+    int32_t mTouchPredictorSource = 0;
+
     // The input channel.
     sp<InputChannel> mChannel;
 
@@ -392,6 +580,18 @@ private:
     // call to consume and that still needs to be handled.
     bool mMsgDeferred;
 
+    // The latest run of samples announced by the publisher. Samples up to this run are
+    // read from the channel's sample ring ahead of the socket.
+    uint64_t mSampleRingRun = 0;
+
+    // A message read from the socket that has to wait for samples which were written to the
+    // sample ring before it was sent.
+    InputMessage mSampleRingDeferredMsg;
+    bool mSampleRingMsgDeferred = false;
+
+    // Reads the next message, from the sample ring or the socket.
+    status_t receiveMessage(InputMessage* msg);
+
     // Batched motion events per device and source.
     struct Batch {
         Vector<InputMessage> samples;
@@ -505,6 +705,8 @@ private:
     void updateTouchState(InputMessage& msg);
     void resampleTouchState(nsecs_t frameTime, MotionEvent* event,
             const InputMessage *next);
+    void updateTouchPredictor(const InputMessage& msg);
+    void predictTouchState(nsecs_t presentTime, MotionEvent* event);
 
     ssize_t findBatch(int32_t deviceId, int32_t source) const;
     ssize_t findTouchState(int32_t deviceId, int32_t source) const;
@@ -186,6 +186,10 @@ struct InputWindowInfo {
 
     status_t write(Parcel& output) const;
     static InputWindowInfo read(const Parcel& from);
+
+    // Compares every field that write() sends.
+    bool operator==(const InputWindowInfo& other) const;
+    bool operator!=(const InputWindowInfo& other) const { return !(*this == other); }
 };
 
 
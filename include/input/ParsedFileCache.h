@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LIBINPUT_PARSED_FILE_CACHE_H
+#define _LIBINPUT_PARSED_FILE_CACHE_H
+
+#include <sys/stat.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <utils/RefBase.h>
+
+namespace android {
+
+/*
+ * Keeps the objects parsed from files, so that loading a file that has not changed since
+ * it was last parsed returns the same object. Meant for objects that are immutable once
+ * loaded, such as key layout and key character maps, which are loaded again every time
+ * a keyboard is added even though most keyboards share the same few files.
+ *
+ * A file counts as changed when its inode, size or modification time are different.
+ */
+template <typename T>
+class ParsedFileCache {
+public:
+    explicit ParsedFileCache(size_t capacity) : mCapacity(capacity) { }
+
+    // Returns the object parsed from the file with the given variant, or nullptr.
+    sp<T> find(const std::string& filename, int32_t variant) {
+        Entry entry;
+        if (!stat(filename, &entry)) {
+            return nullptr;
+        }
+        std::scoped_lock lock(mLock);
+        auto it = mEntries.find(std::make_pair(filename, variant));
+        if (it == mEntries.end() || !it->second.isSameFile(entry)) {
+            return nullptr;
+        }
+        return it->second.object;
+    }
+
+    // Keeps an object just parsed from the file. Call it after parsing, so that a change
+    // made to the file while it was parsed is noticed the next time.
+    void insert(const std::string& filename, int32_t variant, const sp<T>& object) {
+        Entry entry;
+        if (!stat(filename, &entry)) {
+            return;
+        }
+        entry.object = object;
+        std::scoped_lock lock(mLock);
+        if (mEntries.size() >= mCapacity) {
+            mEntries.clear();
+        }
+        mEntries[std::make_pair(filename, variant)] = std::move(entry);
+    }
+
+private:
+    struct Entry {
+        dev_t device;
+        ino_t inode;
+        off_t size;
+        struct timespec modificationTime;
+        sp<T> object;
+
+        bool isSameFile(const Entry& other) const {
+            return device == other.device && inode == other.inode && size == other.size
+                    && modificationTime.tv_sec == other.modificationTime.tv_sec
+                    && modificationTime.tv_nsec == other.modificationTime.tv_nsec;
+        }
+    };
+
+    static bool stat(const std::string& filename, Entry* outEntry) {
+        struct stat info;
+        if (::stat(filename.c_str(), &info)) {
+            return false;
+        }
+        outEntry->device = info.st_dev;
+        outEntry->inode = info.st_ino;
+        outEntry->size = info.st_size;
+        outEntry->modificationTime = info.st_mtim;
+        return true;
+    }
+
+    const size_t mCapacity;
+    std::mutex mLock;
+    std::map<std::pair<std::string, int32_t>, Entry> mEntries;
+};
+
+} // namespace android
+
+#endif // _LIBINPUT_PARSED_FILE_CACHE_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LIBINPUT_TOUCH_PREDICTOR_H
+#define _LIBINPUT_TOUCH_PREDICTOR_H
+
+#include <memory>
+
+#include <input/VelocityTracker.h>
+#include <utils/BitSet.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+/*
+ * Predicts where touch pointers will be at a later time from their recent movement.
+ *
+ * InputConsumer uses a predictor, if the app sets one, to resample touch moves to the
+ * time the frame being drawn is expected to be presented.
+ */
+class TouchPredictor {
+public:
+    virtual ~TouchPredictor() { }
+
+    // Creates the named predictor, or returns nullptr if there is no such predictor.
+    // Known predictors: "lsq1" and "lsq2", a linear or quadratic fit of recent movements.
+    static std::unique_ptr<TouchPredictor> create(const char* name);
+
+    // Forgets all movements, e.g. at the start of a gesture.
+    virtual void clear() = 0;
+
+    // Forgets the movements of specific pointers, whose ids may be reused.
+    virtual void clearPointers(BitSet32 idBits) = 0;
+
+    // Adds movement information for a set of pointers, in the same form as
+    // VelocityTracker::addMovement: one position per id in idBits, by increasing id.
+    virtual void addMovement(nsecs_t eventTime, BitSet32 idBits,
+            const VelocityTracker::Position* positions) = 0;
+
+    // Predicts the position of a pointer at the given time.
+    // Returns false if there is not enough movement information to predict from.
+    virtual bool predict(uint32_t id, nsecs_t time, float* outX, float* outY) const = 0;
+};
+
+/*
+ * Fits a polynomial to the recent movements of each pointer, using a VelocityTracker
+ * least squares strategy, and extrapolates it.
+ */
+class PolynomialTouchPredictor : public TouchPredictor {
+public:
+    explicit PolynomialTouchPredictor(uint32_t degree);
+
+    virtual void clear();
+    virtual void clearPointers(BitSet32 idBits);
+    virtual void addMovement(nsecs_t eventTime, BitSet32 idBits,
+            const VelocityTracker::Position* positions);
+    virtual bool predict(uint32_t id, nsecs_t time, float* outX, float* outY) const;
+
+private:
+    VelocityTracker mTracker;
+};
+
+} // namespace android
+
+#endif // _LIBINPUT_TOUCH_PREDICTOR_H
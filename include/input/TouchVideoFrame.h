@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <sys/time.h>
 #include <ui/DisplayInfo.h>
+#include <memory>
 #include <vector>
 
 namespace android {
@@ -28,11 +29,20 @@ namespace android {
  * Represents data from a single scan of the touchscreen device.
  * Similar in concept to a video frame, but the touch strength is used as
  * the values instead.
+ *
+ * Copies of a frame share its data, so that passing frames along the input pipeline does
+ * not copy the heatmap.
  */
 class TouchVideoFrame {
 public:
     TouchVideoFrame(uint32_t height, uint32_t width, std::vector<int16_t> data,
             const struct timeval& timestamp);
+    /**
+     * Create a frame that uses the data without copying it. The data must not change while
+     * any frame shares it, which the owner can tell from the use count.
+     */
+    static TouchVideoFrame fromSharedData(uint32_t height, uint32_t width,
+            std::shared_ptr<const std::vector<int16_t>> data, const struct timeval& timestamp);
 
     bool operator==(const TouchVideoFrame& rhs) const;
 
@@ -63,9 +73,14 @@ public:
     void rotate(int32_t orientation);
 
 private:
+    // Keeps this constructor out of overload resolution for the public one
+    struct SharedDataTag {};
+    TouchVideoFrame(SharedDataTag, uint32_t height, uint32_t width,
+            std::shared_ptr<const std::vector<int16_t>> data, const struct timeval& timestamp);
+
     uint32_t mHeight;
     uint32_t mWidth;
-    std::vector<int16_t> mData;
+    std::shared_ptr<const std::vector<int16_t>> mData;
     struct timeval mTimestamp;
 
     /**
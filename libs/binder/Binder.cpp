@@ -17,7 +17,9 @@
 #include <binder/Binder.h>
 
 #include <atomic>
+#include <mutex>
 #include <utils/misc.h>
+#include <binder/BinderCallStats.h>
 #include <binder/BpBinder.h>
 #include <binder/IInterface.h>
 #include <binder/IResultReceiver.h>
@@ -88,10 +90,15 @@ class BBinder::Extras
 public:
     // unlocked objects
     bool mRequestingSid = false;
+    bool mOnewayOffloaded = false;
 
     // for below objects
     Mutex mLock;
     BpBinder::ObjectManager mObjects;
+
+    // getInterfaceDescriptor(), looked up once for BinderCallStats
+    std::once_flag mStatsDescriptorOnce;
+    String16 mStatsDescriptor;
 };
 
 // ---------------------------------------------------------------------------
@@ -125,6 +132,9 @@ status_t BBinder::transact(
 {
     data.setDataPosition(0);
 
+    const bool recordStats = BinderCallStats::isEnabled();
+    const nsecs_t start = recordStats ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+
     status_t err = NO_ERROR;
     switch (code) {
         case PING_TRANSACTION:
@@ -135,6 +145,12 @@ status_t BBinder::transact(
             break;
     }
 
+    if (recordStats) {
+        BinderCallStats::recordIncoming(getStatsDescriptor(), code,
+                systemTime(SYSTEM_TIME_MONOTONIC) - start, data.dataSize(),
+                reply != nullptr ? reply->dataSize() : 0, err);
+    }
+
     if (reply != nullptr) {
         reply->setDataPosition(0);
     }
@@ -221,6 +237,29 @@ void BBinder::setRequestingSid(bool requestingSid)
     e->mRequestingSid = requestingSid;
 }
 
+bool BBinder::isOnewayOffloaded()
+{
+    Extras* e = mExtras.load(std::memory_order_acquire);
+
+    return e && e->mOnewayOffloaded;
+}
+
+void BBinder::setOnewayOffloaded(bool offloaded)
+{
+    Extras* e = mExtras.load(std::memory_order_acquire);
+
+    if (!e) {
+        if (!offloaded) {
+            return;
+        }
+
+        e = getOrCreateExtras();
+        if (!e) return; // out of memory
+    }
+
+    e->mOnewayOffloaded = offloaded;
+}
+
 BBinder::~BBinder()
 {
     Extras* e = mExtras.load(std::memory_order_relaxed);
@@ -279,6 +318,9 @@ status_t BBinder::onTransact(
             return NO_ERROR;
         }
 
+        case TRANSACTION_STATS_TRANSACTION:
+            return BinderCallStats::onCommand(data);
+
         default:
             return UNKNOWN_TRANSACTION;
     }
@@ -303,6 +345,20 @@ BBinder::Extras* BBinder::getOrCreateExtras()
     return e;
 }
 
+const String16& BBinder::getStatsDescriptor()
+{
+    // Subclasses that don't name an interface warn on every getInterfaceDescriptor(),
+    // so only ask once per object.
+    static String16 sEmptyDescriptor;
+    Extras* e = getOrCreateExtras();
+    if (!e) return sEmptyDescriptor; // out of memory
+
+    std::call_once(e->mStatsDescriptorOnce, [&] {
+        e->mStatsDescriptor = getInterfaceDescriptor();
+    });
+    return e->mStatsDescriptor;
+}
+
 // ---------------------------------------------------------------------------
 
 enum {
@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BinderCallStats"
+
+#include <binder/BinderCallStats.h>
+
+#include <binder/IPCThreadState.h>
+#include <binder/Parcel.h>
+#include <private/android_filesystem_config.h>
+#include <utils/Log.h>
+#include <utils/String8.h>
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace android {
+
+// ---------------------------------------------------------------------------
+
+constexpr std::array<uint32_t, BinderCallStats::LATENCY_BUCKETS - 1>
+        BinderCallStats::LATENCY_BUCKET_LIMITS_US;
+
+std::atomic_bool BinderCallStats::sEnabled(false);
+
+namespace {
+
+struct CallKey {
+    BinderCallStats::Direction direction;
+    String16 descriptor;
+    int32_t handle;
+    uint32_t code;
+
+    bool operator==(const CallKey& o) const {
+        return direction == o.direction && handle == o.handle && code == o.code &&
+                descriptor == o.descriptor;
+    }
+};
+
+struct CallKeyHash {
+    size_t operator()(const CallKey& key) const {
+        // Only shifts and xors, which the integer sanitizer doesn't trap on.
+        const size_t descriptorHash = std::hash<std::u16string_view>()(
+                std::u16string_view(key.descriptor.string(), key.descriptor.size()));
+        return descriptorHash ^ (static_cast<size_t>(key.code) << 1) ^
+                (static_cast<size_t>(static_cast<uint32_t>(key.handle)) << 3) ^
+                static_cast<size_t>(key.direction);
+    }
+};
+
+struct CallCounters {
+    uint64_t calls = 0;
+    uint64_t failures = 0;
+    uint64_t totalLatencyNs = 0;
+    uint64_t maxLatencyNs = 0;
+    uint64_t totalDataBytes = 0;
+    uint64_t maxDataBytes = 0;
+    uint64_t totalReplyBytes = 0;
+    uint64_t maxReplyBytes = 0;
+    std::array<uint64_t, BinderCallStats::LATENCY_BUCKETS> latencyHistogram{};
+
+    void merge(const CallCounters& o) {
+        calls += o.calls;
+        failures += o.failures;
+        totalLatencyNs += o.totalLatencyNs;
+        maxLatencyNs = std::max(maxLatencyNs, o.maxLatencyNs);
+        totalDataBytes += o.totalDataBytes;
+        maxDataBytes = std::max(maxDataBytes, o.maxDataBytes);
+        totalReplyBytes += o.totalReplyBytes;
+        maxReplyBytes = std::max(maxReplyBytes, o.maxReplyBytes);
+        for (size_t i = 0; i < latencyHistogram.size(); i++) {
+            latencyHistogram[i] += o.latencyHistogram[i];
+        }
+    }
+};
+
+typedef std::unordered_map<CallKey, CallCounters, CallKeyHash> CallTable;
+
+// One per thread that has recorded a call. The lock is only ever contended
+// by a dump or a reset.
+struct ThreadCallTable {
+    std::mutex lock;
+    CallTable calls;
+};
+
+// Every live thread's table, plus what exited threads left behind. Never
+// destroyed, so binder threads still running at exit can keep recording.
+struct CallTableRegistry {
+    std::mutex lock;
+    std::vector<ThreadCallTable*> tables;
+    CallTable retired;
+};
+
+CallTableRegistry& registry()
+{
+    static CallTableRegistry* sRegistry = new CallTableRegistry;
+    return *sRegistry;
+}
+
+pthread_once_t gCallTableKeyOnce = PTHREAD_ONCE_INIT;
+pthread_key_t gCallTableKey;
+
+void destroyCallTable(void* st)
+{
+    ThreadCallTable* table = static_cast<ThreadCallTable*>(st);
+    CallTableRegistry& r = registry();
+    {
+        std::lock_guard<std::mutex> _l(r.lock);
+        r.tables.erase(std::find(r.tables.begin(), r.tables.end(), table));
+        for (const auto& call : table->calls) {
+            r.retired[call.first].merge(call.second);
+        }
+    }
+    delete table;
+}
+
+void makeCallTableKey()
+{
+    pthread_key_create(&gCallTableKey, destroyCallTable);
+}
+
+ThreadCallTable* getCallTable()
+{
+    pthread_once(&gCallTableKeyOnce, makeCallTableKey);
+    ThreadCallTable* table = static_cast<ThreadCallTable*>(pthread_getspecific(gCallTableKey));
+    if (table == nullptr) {
+        table = new ThreadCallTable;
+        CallTableRegistry& r = registry();
+        {
+            std::lock_guard<std::mutex> _l(r.lock);
+            r.tables.push_back(table);
+        }
+        pthread_setspecific(gCallTableKey, table);
+    }
+    return table;
+}
+
+size_t latencyBucket(nsecs_t latency)
+{
+    const uint64_t us = static_cast<uint64_t>(latency) / 1000;
+    const auto& limits = BinderCallStats::LATENCY_BUCKET_LIMITS_US;
+    return std::upper_bound(limits.begin(), limits.end(), us) - limits.begin();
+}
+
+void record(CallKey&& key, nsecs_t latency, size_t dataSize, size_t replySize, status_t err)
+{
+    const uint64_t latencyNs = latency > 0 ? latency : 0;
+    ThreadCallTable* table = getCallTable();
+    std::lock_guard<std::mutex> _l(table->lock);
+    CallCounters& c = table->calls[std::move(key)];
+    c.calls++;
+    if (err != NO_ERROR) c.failures++;
+    c.totalLatencyNs += latencyNs;
+    c.maxLatencyNs = std::max(c.maxLatencyNs, latencyNs);
+    c.totalDataBytes += dataSize;
+    c.maxDataBytes = std::max<uint64_t>(c.maxDataBytes, dataSize);
+    c.totalReplyBytes += replySize;
+    c.maxReplyBytes = std::max<uint64_t>(c.maxReplyBytes, replySize);
+    c.latencyHistogram[latencyBucket(latency)]++;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+void BinderCallStats::setEnabled(bool enabled)
+{
+    sEnabled.store(enabled);
+}
+
+std::vector<BinderCallStats::Entry> BinderCallStats::getEntries()
+{
+    CallTable merged;
+    CallTableRegistry& r = registry();
+    {
+        std::lock_guard<std::mutex> _l(r.lock);
+        merged = r.retired;
+        for (ThreadCallTable* table : r.tables) {
+            std::lock_guard<std::mutex> _tl(table->lock);
+            for (const auto& call : table->calls) {
+                merged[call.first].merge(call.second);
+            }
+        }
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(merged.size());
+    for (const auto& call : merged) {
+        const CallKey& k = call.first;
+        const CallCounters& c = call.second;
+        entries.push_back(Entry{k.direction, k.descriptor, k.handle, k.code, c.calls, c.failures,
+                                c.totalLatencyNs, c.maxLatencyNs, c.totalDataBytes,
+                                c.maxDataBytes, c.totalReplyBytes, c.maxReplyBytes,
+                                c.latencyHistogram});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        if (a.direction != b.direction) return a.direction < b.direction;
+        if (a.descriptor != b.descriptor) return a.descriptor < b.descriptor;
+        if (a.handle != b.handle) return a.handle < b.handle;
+        return a.code < b.code;
+    });
+    return entries;
+}
+
+void BinderCallStats::reset()
+{
+    CallTableRegistry& r = registry();
+    std::lock_guard<std::mutex> _l(r.lock);
+    r.retired.clear();
+    for (ThreadCallTable* table : r.tables) {
+        std::lock_guard<std::mutex> _tl(table->lock);
+        table->calls.clear();
+    }
+}
+
+void BinderCallStats::dump(int fd)
+{
+    const std::vector<Entry> entries = getEntries();
+    String8 out;
+    out.appendFormat("Binder call stats (pid %d, %s):\n", getpid(),
+                     isEnabled() ? "enabled" : "disabled");
+    for (const Entry& e : entries) {
+        if (e.direction == Direction::INCOMING) {
+            out.appendFormat("  incoming %s", String8(e.descriptor).string());
+        } else {
+            out.appendFormat("  outgoing handle %d", e.handle);
+        }
+        out.appendFormat(" code %u: calls=%" PRIu64 " failures=%" PRIu64 "\n", e.code, e.calls,
+                         e.failures);
+        out.appendFormat("    latency avg=%" PRIu64 "us max=%" PRIu64 "us,",
+                         e.totalLatencyNs / e.calls / 1000, e.maxLatencyNs / 1000);
+        out.appendFormat(" data avg=%" PRIu64 " max=%" PRIu64 ",", e.totalDataBytes / e.calls,
+                         e.maxDataBytes);
+        out.appendFormat(" reply avg=%" PRIu64 " max=%" PRIu64 "\n", e.totalReplyBytes / e.calls,
+                         e.maxReplyBytes);
+        out.append("    histogram");
+        for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+            if (i < LATENCY_BUCKET_LIMITS_US.size()) {
+                out.appendFormat(" <%uus:%" PRIu64, LATENCY_BUCKET_LIMITS_US[i],
+                                 e.latencyHistogram[i]);
+            } else {
+                out.appendFormat(" more:%" PRIu64, e.latencyHistogram[i]);
+            }
+        }
+        out.append("\n");
+    }
+    write(fd, out.string(), out.size());
+}
+
+status_t BinderCallStats::sendCommand(const sp<IBinder>& target, Command command, int fd)
+{
+    Parcel send;
+    Parcel reply;
+    send.writeFileDescriptor(fd);
+    send.writeInt32(command);
+    return target->transact(IBinder::TRANSACTION_STATS_TRANSACTION, send, &reply);
+}
+
+status_t BinderCallStats::onCommand(const Parcel& data)
+{
+    // Only the same uid and the usual debugging uids may look at or change
+    // which calls this process handles.
+    const uid_t uid = IPCThreadState::self()->getCallingUid();
+    if (uid != getuid() && uid != AID_ROOT && uid != AID_SYSTEM && uid != AID_SHELL) {
+        return PERMISSION_DENIED;
+    }
+
+    const int fd = data.readFileDescriptor();
+    int32_t command;
+    status_t err = data.readInt32(&command);
+    if (err != NO_ERROR) return err;
+
+    switch (command) {
+        case COMMAND_DUMP:
+            if (fd < 0) return BAD_VALUE;
+            dump(fd);
+            return NO_ERROR;
+        case COMMAND_ENABLE:
+            setEnabled(true);
+            return NO_ERROR;
+        case COMMAND_DISABLE:
+            setEnabled(false);
+            return NO_ERROR;
+        case COMMAND_RESET:
+            reset();
+            return NO_ERROR;
+        default:
+            return BAD_VALUE;
+    }
+}
+
+void BinderCallStats::recordIncoming(const String16& descriptor, uint32_t code,
+                                     nsecs_t latency, size_t dataSize, size_t replySize,
+                                     status_t err)
+{
+    record(CallKey{Direction::INCOMING, descriptor, 0, code}, latency, dataSize, replySize, err);
+}
+
+void BinderCallStats::recordOutgoing(int32_t handle, uint32_t code, nsecs_t latency,
+                                     size_t dataSize, size_t replySize, status_t err)
+{
+    record(CallKey{Direction::OUTGOING, String16(), handle, code}, latency, dataSize, replySize,
+           err);
+}
+
+}; // namespace android
@@ -19,6 +19,7 @@
 
 #include <binder/BpBinder.h>
 
+#include <binder/BinderCallStats.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IResultReceiver.h>
 #include <cutils/compiler.h>
@@ -212,8 +213,15 @@ status_t BpBinder::transact(
 {
     // Once a binder has died, it will never come back to life.
     if (mAlive) {
+        const bool recordStats = BinderCallStats::isEnabled();
+        const nsecs_t start = recordStats ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
         status_t status = IPCThreadState::self()->transact(
             mHandle, code, data, reply, flags);
+        if (recordStats) {
+            BinderCallStats::recordOutgoing(mHandle, code,
+                    systemTime(SYSTEM_TIME_MONOTONIC) - start, data.dataSize(),
+                    reply != nullptr ? reply->dataSize() : 0, status);
+        }
         if (status == DEAD_OBJECT) mAlive = 0;
         return status;
     }
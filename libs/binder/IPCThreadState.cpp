@@ -31,6 +31,7 @@
 #include <utils/threads.h>
 
 #include <private/binder/binder_module.h>
+#include <private/binder/OnewayExecutor.h>
 #include <private/binder/Static.h>
 
 #include <errno.h>
@@ -505,6 +506,9 @@ status_t IPCThreadState::getAndExecuteCommand()
 
         pthread_mutex_lock(&mProcess->mThreadCountLock);
         mProcess->mExecutingThreadsCount++;
+        if (mProcess->mExecutingThreadsCount > mProcess->mPeakExecutingThreadsCount) {
+            mProcess->mPeakExecutingThreadsCount = mProcess->mExecutingThreadsCount;
+        }
         if (mProcess->mExecutingThreadsCount >= mProcess->mMaxThreads &&
                 mProcess->mStarvationStartTimeMs == 0) {
             mProcess->mStarvationStartTimeMs = uptimeMillis();
@@ -587,6 +591,10 @@ void IPCThreadState::joinThreadPool(bool isMain)
 
     mOut.writeInt32(isMain ? BC_ENTER_LOOPER : BC_REGISTER_LOOPER);
 
+    pthread_mutex_lock(&mProcess->mThreadCountLock);
+    mProcess->mPoolThreadsCount++;
+    pthread_mutex_unlock(&mProcess->mThreadCountLock);
+
     status_t result;
     do {
         processPendingDerefs();
@@ -604,8 +612,17 @@ void IPCThreadState::joinThreadPool(bool isMain)
         if(result == TIMED_OUT && !isMain) {
             break;
         }
+        if (!isMain && mIn.dataPosition() >= mIn.dataSize() &&
+                mProcess->shouldRetirePooledThread()) {
+            result = TIMED_OUT;
+            break;
+        }
     } while (result != -ECONNREFUSED && result != -EBADF);
 
+    pthread_mutex_lock(&mProcess->mThreadCountLock);
+    mProcess->mPoolThreadsCount--;
+    pthread_mutex_unlock(&mProcess->mThreadCountLock);
+
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS LEAVING THE THREAD POOL err=%d\n",
         (void*)pthread_self(), getpid(), result);
 
@@ -664,6 +681,9 @@ status_t IPCThreadState::transact(int32_t handle,
 
     LOG_ONEWAY(">>>> SEND from pid %d uid %d %s", getpid(), getuid(),
         (flags & TF_ONE_WAY) == 0 ? "READ REPLY" : "ONE WAY");
+    if ((flags & TF_ONE_WAY) != 0 && mOnewayBatchDepth > 0) {
+        return queueOnewayTransaction(handle, code, data, flags);
+    }
     err = writeTransactionData(BC_TRANSACTION, flags, handle, code, data, nullptr);
 
     if (err != NO_ERROR) {
@@ -799,13 +819,90 @@ status_t IPCThreadState::clearDeathNotification(int32_t handle, BpBinder* proxy)
     return NO_ERROR;
 }
 
+// Queued oneway transactions are written to the driver once there are this
+// many, or this much data, so that a long batch neither holds on to a lot of
+// memory nor fills up the receivers' async buffers all at once.
+static const size_t kMaxBatchedOnewayTransactions = 32;
+static const size_t kMaxBatchedOnewayBytes = 64 * 1024;
+
+void IPCThreadState::beginOnewayBatch()
+{
+    mOnewayBatchDepth++;
+}
+
+status_t IPCThreadState::endOnewayBatch()
+{
+    if (mOnewayBatchDepth == 0) {
+        ALOGE("endOnewayBatch() without beginOnewayBatch()");
+        return INVALID_OPERATION;
+    }
+    if (--mOnewayBatchDepth > 0) {
+        return NO_ERROR;
+    }
+    flushOnewayBatch();
+    const status_t err = mOnewayBatchError;
+    mOnewayBatchError = NO_ERROR;
+    return err;
+}
+
+status_t IPCThreadState::queueOnewayTransaction(int32_t handle, uint32_t code,
+                                                const Parcel& data, uint32_t flags)
+{
+    std::unique_ptr<Parcel> copy = std::make_unique<Parcel>();
+    status_t err = data.errorCheck();
+    if (err == NO_ERROR) {
+        // Also takes references on the binders and file descriptors the data holds
+        err = copy->appendFrom(&data, 0, data.ipcDataSize());
+    }
+    if (err == NO_ERROR) {
+        err = writeTransactionData(BC_TRANSACTION, flags, handle, code, *copy, nullptr);
+    }
+    if (err != NO_ERROR) {
+        return (mLastError = err);
+    }
+    mOnewayBatchBytes += copy->ipcDataSize();
+    mOnewayBatchParcels.push_back(std::move(copy));
+    mPendingOnewayCount++;
+
+    if (mOnewayBatchParcels.size() >= kMaxBatchedOnewayTransactions ||
+            mOnewayBatchBytes >= kMaxBatchedOnewayBytes) {
+        flushOnewayBatch();
+    }
+    return NO_ERROR;
+}
+
+void IPCThreadState::flushOnewayBatch()
+{
+    while (mPendingOnewayCount > 0) {
+        const size_t pending = mPendingOnewayCount;
+        // Returns once it has read the result of the oldest queued transaction
+        const status_t err = waitForResponse(nullptr, nullptr);
+        if (mPendingOnewayCount == pending) {
+            // The driver itself failed, so nothing more will complete. Drop what
+            // is still queued, since its data is about to go away.
+            ALOGE("Failed to write %zu queued oneway transactions: %d", pending, err);
+            if (mOnewayBatchError == NO_ERROR) {
+                mOnewayBatchError = err < NO_ERROR ? err : UNKNOWN_ERROR;
+            }
+            mOut.setDataSize(0);
+            mPendingOnewayCount = 0;
+        }
+    }
+    mOnewayBatchParcels.clear();
+    mOnewayBatchBytes = 0;
+}
+
 IPCThreadState::IPCThreadState()
     : mProcess(ProcessState::self()),
       mWorkSource(kUnsetWorkSource),
       mPropagateWorkSource(false),
       mStrictModePolicy(0),
       mLastTransactionBinderFlags(0),
-      mCallRestriction(mProcess->mCallRestriction)
+      mCallRestriction(mProcess->mCallRestriction),
+      mOnewayBatchDepth(0),
+      mPendingOnewayCount(0),
+      mOnewayBatchError(NO_ERROR),
+      mOnewayBatchBytes(0)
 {
     pthread_setspecific(gTLS, this);
     clearCaller();
@@ -848,15 +945,28 @@ status_t IPCThreadState::waitForResponse(Parcel *reply, status_t *acquireResult)
 
         switch (cmd) {
         case BR_TRANSACTION_COMPLETE:
+            if (mPendingOnewayCount > 0) {
+                // The result of a queued oneway transaction, which is ahead of
+                // whatever the caller is waiting for
+                mPendingOnewayCount--;
+                if (!reply && !acquireResult) goto finish;
+                break;
+            }
             if (!reply && !acquireResult) goto finish;
             break;
 
         case BR_DEAD_REPLY:
-            err = DEAD_OBJECT;
-            goto finish;
-
         case BR_FAILED_REPLY:
-            err = FAILED_TRANSACTION;
+            err = cmd == BR_DEAD_REPLY ? DEAD_OBJECT : FAILED_TRANSACTION;
+            if (mPendingOnewayCount > 0) {
+                mPendingOnewayCount--;
+                if (mOnewayBatchError == NO_ERROR) {
+                    mOnewayBatchError = err;
+                }
+                err = NO_ERROR;
+                if (!reply && !acquireResult) goto finish;
+                break;
+            }
             goto finish;
 
         case BR_ACQUIRE_RESULT:
@@ -875,6 +985,7 @@ status_t IPCThreadState::waitForResponse(Parcel *reply, status_t *acquireResult)
                 ALOG_ASSERT(err == NO_ERROR, "Not enough command data for brREPLY");
                 if (err != NO_ERROR) goto finish;
 
+                void* const cookie = receivedBufferCookie(tr);
                 if (reply) {
                     if ((tr.flags & TF_STATUS_CODE) == 0) {
                         reply->ipcSetDataReference(
@@ -882,21 +993,21 @@ status_t IPCThreadState::waitForResponse(Parcel *reply, status_t *acquireResult)
                             tr.data_size,
                             reinterpret_cast<const binder_size_t*>(tr.data.ptr.offsets),
                             tr.offsets_size/sizeof(binder_size_t),
-                            freeBuffer, this);
+                            freeBuffer, cookie);
                     } else {
                         err = *reinterpret_cast<const status_t*>(tr.data.ptr.buffer);
                         freeBuffer(nullptr,
                             reinterpret_cast<const uint8_t*>(tr.data.ptr.buffer),
                             tr.data_size,
                             reinterpret_cast<const binder_size_t*>(tr.data.ptr.offsets),
-                            tr.offsets_size/sizeof(binder_size_t), this);
+                            tr.offsets_size/sizeof(binder_size_t), cookie);
                     }
                 } else {
                     freeBuffer(nullptr,
                         reinterpret_cast<const uint8_t*>(tr.data.ptr.buffer),
                         tr.data_size,
                         reinterpret_cast<const binder_size_t*>(tr.data.ptr.offsets),
-                        tr.offsets_size/sizeof(binder_size_t), this);
+                        tr.offsets_size/sizeof(binder_size_t), cookie);
                     continue;
                 }
             }
@@ -1058,6 +1169,63 @@ status_t IPCThreadState::writeTransactionData(int32_t cmd, uint32_t binderFlags,
     return NO_ERROR;
 }
 
+bool IPCThreadState::offloadOnewayTransaction(BBinder* target,
+    const binder_transaction_data& tr, const char* callingSid, const Parcel& data)
+{
+    // The copy takes its own references on the objects and fds in the
+    // transaction, so the driver's buffer can be freed as soon as it's made.
+    std::unique_ptr<OnewayTransaction> txn(new OnewayTransaction);
+    txn->data.reset(new Parcel);
+    if (txn->data->appendFrom(&data, 0, data.dataSize()) != NO_ERROR) {
+        return false;
+    }
+    txn->target = target;
+    txn->code = tr.code;
+    txn->flags = tr.flags;
+    txn->callingPid = tr.sender_pid;
+    txn->callingUid = tr.sender_euid;
+    txn->hasCallingSid = callingSid != nullptr;
+    if (callingSid != nullptr) {
+        txn->callingSid = callingSid;
+    }
+
+    return OnewayExecutor::self().enqueue(txn);
+}
+
+void IPCThreadState::executeOffloadedTransaction(OnewayTransaction& txn)
+{
+    mIPCThreadStateBase->pushCurrentState(IPCThreadStateBase::CallState::BINDER, txn.code,
+                                          txn.callingPid);
+
+    const pid_t origPid = mCallingPid;
+    const char* origSid = mCallingSid;
+    const uid_t origUid = mCallingUid;
+    const int32_t origStrictModePolicy = mStrictModePolicy;
+    const int32_t origTransactionBinderFlags = mLastTransactionBinderFlags;
+    const int32_t origWorkSource = mWorkSource;
+    const bool origPropagateWorkSet = mPropagateWorkSource;
+    clearCallingWorkSource();
+    clearPropagateWorkSource();
+
+    mCallingPid = txn.callingPid;
+    mCallingSid = txn.hasCallingSid ? txn.callingSid.c_str() : nullptr;
+    mCallingUid = txn.callingUid;
+    mLastTransactionBinderFlags = txn.flags;
+
+    Parcel reply;
+    txn.target->transact(txn.code, *txn.data, &reply, txn.flags);
+
+    mIPCThreadStateBase->popCurrentState();
+
+    mCallingPid = origPid;
+    mCallingSid = origSid;
+    mCallingUid = origUid;
+    mStrictModePolicy = origStrictModePolicy;
+    mLastTransactionBinderFlags = origTransactionBinderFlags;
+    mWorkSource = origWorkSource;
+    mPropagateWorkSource = origPropagateWorkSet;
+}
+
 sp<BBinder> the_context_object;
 
 void setTheContextObject(sp<BBinder> obj)
@@ -1163,13 +1331,14 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
 
             //Record the fact that we're in a binder call.
             mIPCThreadStateBase->pushCurrentState(
-                IPCThreadStateBase::CallState::BINDER);
+                IPCThreadStateBase::CallState::BINDER, tr.code, tr.sender_pid);
             Parcel buffer;
             buffer.ipcSetDataReference(
                 reinterpret_cast<const uint8_t*>(tr.data.ptr.buffer),
                 tr.data_size,
                 reinterpret_cast<const binder_size_t*>(tr.data.ptr.offsets),
-                tr.offsets_size/sizeof(binder_size_t), freeBuffer, this);
+                tr.offsets_size/sizeof(binder_size_t), freeBuffer,
+                receivedBufferCookie(tr));
 
             const pid_t origPid = mCallingPid;
             const char* origSid = mCallingSid;
@@ -1210,9 +1379,14 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
                 // safely acquire a strong reference before doing anything else with it.
                 if (reinterpret_cast<RefBase::weakref_type*>(
                         tr.target.ptr)->attemptIncStrong(this)) {
-                    error = reinterpret_cast<BBinder*>(tr.cookie)->transact(tr.code, buffer,
-                            &reply, tr.flags);
-                    reinterpret_cast<BBinder*>(tr.cookie)->decStrong(this);
+                    BBinder* target = reinterpret_cast<BBinder*>(tr.cookie);
+                    if ((tr.flags & TF_ONE_WAY) != 0 && target->isOnewayOffloaded() &&
+                            offloadOnewayTransaction(target, tr, mCallingSid, buffer)) {
+                        error = NO_ERROR;
+                    } else {
+                        error = target->transact(tr.code, buffer, &reply, tr.flags);
+                    }
+                    target->decStrong(this);
                 } else {
                     error = UNKNOWN_TRANSACTION;
                 }
@@ -1307,10 +1481,20 @@ void IPCThreadState::threadDestructor(void *st)
 }
 
 
+// The cookie handed back to freeBuffer() is the size the buffer was counted for
+// in ProcessState. Sizes are 8-byte aligned, so the lowest bit marks oneway
+// transactions.
+void* IPCThreadState::receivedBufferCookie(const binder_transaction_data& tr)
+{
+    const bool oneway = (tr.flags & TF_ONE_WAY) != 0;
+    const size_t bytes = mProcess->onBufferReceived(tr.data_size, tr.offsets_size, oneway);
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(bytes | (oneway ? 1 : 0)));
+}
+
 void IPCThreadState::freeBuffer(Parcel* parcel, const uint8_t* data,
                                 size_t /*dataSize*/,
                                 const binder_size_t* /*objects*/,
-                                size_t /*objectsSize*/, void* /*cookie*/)
+                                size_t /*objectsSize*/, void* cookie)
 {
     //ALOGI("Freeing parcel %p", &parcel);
     IF_LOG_COMMANDS() {
@@ -1319,6 +1503,8 @@ void IPCThreadState::freeBuffer(Parcel* parcel, const uint8_t* data,
     ALOG_ASSERT(data != NULL, "Called with NULL data");
     if (parcel != nullptr) parcel->closeFileDescriptors();
     IPCThreadState* state = self();
+    const uintptr_t counted = reinterpret_cast<uintptr_t>(cookie);
+    state->mProcess->onBufferFreed(counted & ~uintptr_t(1), (counted & 1) != 0);
     state->mOut.writeInt32(BC_FREE_BUFFER);
     state->mOut.writePointer((uintptr_t)data);
 }
@@ -32,6 +32,9 @@
 
 #include <unistd.h>
 
+#include <atomic>
+#include <map>
+
 namespace android {
 
 sp<IServiceManager> defaultServiceManager()
@@ -132,11 +135,133 @@ bool checkPermission(const String16& permission, pid_t pid, uid_t uid)
 
 // ----------------------------------------------------------------------
 
+static std::atomic<uint64_t> gServiceCacheHits(0);
+static std::atomic<uint64_t> gServiceCacheMisses(0);
+static std::atomic<uint64_t> gServiceCacheInvalidations(0);
+
+ServiceCacheStats getServiceCacheStats()
+{
+    return ServiceCacheStats{gServiceCacheHits.load(), gServiceCacheMisses.load(),
+                             gServiceCacheInvalidations.load()};
+}
+
+// The remote services this process has looked up, until they die. Services
+// in this process are never cached, since they can't be linked to.
+class ServiceCache : public IBinder::DeathRecipient
+{
+public:
+    sp<IBinder> find(const String16& name)
+    {
+        AutoMutex _l(mLock);
+        auto it = mServices.find(name);
+        if (it == mServices.end()) {
+            gServiceCacheMisses++;
+            return nullptr;
+        }
+        if (!it->second->isBinderAlive()) {
+            // Died before its obituary arrived, which needs a binder thread
+            mServices.erase(it);
+            gServiceCacheInvalidations++;
+            gServiceCacheMisses++;
+            return nullptr;
+        }
+        gServiceCacheHits++;
+        return it->second;
+    }
+
+    void add(const String16& name, const sp<IBinder>& service)
+    {
+        if (service->remoteBinder() == nullptr) return;
+        {
+            AutoMutex _l(mLock);
+            sp<IBinder>& cached = mServices[name];
+            if (cached == service) return;
+            cached = service;
+        }
+        // Linked after it's added, so a death in between still removes it.
+        if (service->linkToDeath(this) != NO_ERROR) {
+            remove(name);
+        }
+    }
+
+    void remove(const String16& name)
+    {
+        AutoMutex _l(mLock);
+        mServices.erase(name);
+    }
+
+    virtual void binderDied(const wp<IBinder>& who)
+    {
+        AutoMutex _l(mLock);
+        for (auto it = mServices.begin(); it != mServices.end();) {
+            if (it->second.get() == who.unsafe_get()) {
+                it = mServices.erase(it);
+                gServiceCacheInvalidations++;
+            } else {
+                ++it;
+            }
+        }
+    }
+
+private:
+    Mutex mLock;
+    std::map<String16, sp<IBinder>> mServices;
+};
+
+// ----------------------------------------------------------------------
+
+// Woken by servicemanager once the service it was registered for is added.
+// It is only called if this process has a binder thread to receive the call,
+// so waiting on it has to time out and check again anyway.
+class ServiceRegisteredWaiter : public BBinder
+{
+public:
+    // Must match SVC_MGR_SERVICE_REGISTERED in servicemanager's binder.h
+    enum {
+        SERVICE_REGISTERED_TRANSACTION = IBinder::FIRST_CALL_TRANSACTION,
+    };
+
+    ServiceRegisteredWaiter() : mRegistered(false) {}
+
+    // Returns true if notified within timeoutMs
+    bool wait(long timeoutMs)
+    {
+        AutoMutex _l(mLock);
+        if (!mRegistered) {
+            mCondition.waitRelative(mLock, milliseconds_to_nanoseconds(timeoutMs));
+        }
+        const bool registered = mRegistered;
+        mRegistered = false;
+        return registered;
+    }
+
+protected:
+    // NOLINTNEXTLINE(google-default-arguments)
+    virtual status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply,
+                                uint32_t flags = 0)
+    {
+        if (code != SERVICE_REGISTERED_TRANSACTION) {
+            return BBinder::onTransact(code, data, reply, flags);
+        }
+        AutoMutex _l(mLock);
+        mRegistered = true;
+        mCondition.broadcast();
+        return NO_ERROR;
+    }
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    bool mRegistered;
+};
+
+// ----------------------------------------------------------------------
+
 class BpServiceManager : public BpInterface<IServiceManager>
 {
 public:
     explicit BpServiceManager(const sp<IBinder>& impl)
-        : BpInterface<IServiceManager>(impl)
+        : BpInterface<IServiceManager>(impl), mCache(new ServiceCache())
     {
     }
 
@@ -157,12 +282,27 @@ public:
         // retry interval in millisecond; note that vendor services stay at 100ms
         const long sleepTime = gSystemBootCompleted ? 1000 : 100;
 
+        // Rather than only polling, get woken as soon as the service is added.
+        // Older service managers don't support this, and processes without a
+        // binder thread never see the notification, so keep polling as well.
+        sp<ServiceRegisteredWaiter> waiter = new ServiceRegisteredWaiter();
+        bool alreadyRegistered = false;
+        const bool canWait = registerForNotification(name, waiter, &alreadyRegistered);
+        if (alreadyRegistered) {
+            svc = checkService(name);
+            if (svc != nullptr) return svc;
+        }
+
         int n = 0;
         while (uptimeMillis() < timeout) {
             n++;
             ALOGI("Waiting for service '%s' on '%s'...", String8(name).string(),
                 ProcessState::self()->getDriverName().c_str());
-            usleep(1000*sleepTime);
+            if (canWait) {
+                waiter->wait(sleepTime);
+            } else {
+                usleep(1000*sleepTime);
+            }
 
             sp<IBinder> svc = checkService(name);
             if (svc != nullptr) return svc;
@@ -173,11 +313,16 @@ public:
 
     virtual sp<IBinder> checkService( const String16& name) const
     {
+        sp<IBinder> svc = mCache->find(name);
+        if (svc != nullptr) return svc;
+
         Parcel data, reply;
         data.writeInterfaceToken(IServiceManager::getInterfaceDescriptor());
         data.writeString16(name);
         remote()->transact(CHECK_SERVICE_TRANSACTION, data, &reply);
-        return reply.readStrongBinder();
+        svc = reply.readStrongBinder();
+        if (svc != nullptr) mCache->add(name, svc);
+        return svc;
     }
 
     virtual status_t addService(const String16& name, const sp<IBinder>& service,
@@ -189,9 +334,25 @@ public:
         data.writeInt32(allowIsolated ? 1 : 0);
         data.writeInt32(dumpsysPriority);
         status_t err = remote()->transact(ADD_SERVICE_TRANSACTION, data, &reply);
+        // Whatever was registered under this name before has been replaced
+        mCache->remove(name);
         return err == NO_ERROR ? reply.readExceptionCode() : err;
     }
 
+    // Returns false if the service manager won't notify waiter.
+    bool registerForNotification(const String16& name, const sp<IBinder>& waiter,
+                                 bool* alreadyRegistered) const
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(IServiceManager::getInterfaceDescriptor());
+        data.writeString16(name);
+        data.writeStrongBinder(waiter);
+        status_t err = remote()->transact(REGISTER_FOR_NOTIFICATIONS_TRANSACTION, data, &reply);
+        if (err != NO_ERROR) return false;
+        *alreadyRegistered = reply.readInt32() != 0;
+        return !*alreadyRegistered;
+    }
+
     virtual Vector<String16> listServices(int dumpsysPriority) {
         Vector<String16> res;
         int n = 0;
@@ -208,6 +369,9 @@ public:
         }
         return res;
     }
+
+private:
+    const sp<ServiceCache> mCache;
 };
 
 IMPLEMENT_META_INTERFACE(ServiceManager, "android.os.IServiceManager");
@@ -25,6 +25,7 @@
 #include <utils/String8.h>
 #include <utils/threads.h>
 
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,6 +39,8 @@
 #include <sys/mman.h>
 #include <sys/file.h>
 
+#include <unordered_map>
+
 namespace android {
 // ----------------------------------------------------------------------------
 
@@ -120,6 +123,13 @@ private:
 
 // ----------------------------------------------------------------------------
 
+// Hands out ranges of the heap, in kMemoryAlign units.
+//
+// Free chunks are kept on segregated free lists, one per power of two size
+// class, next to the address ordered list of every chunk that is used to
+// coalesce neighbours. Allocating takes the first chunk of the smallest class
+// that is bound to fit, and freeing finds its chunk through a hash table, so
+// neither walks the heap.
 class SimpleBestFitAllocator
 {
     enum {
@@ -141,24 +151,45 @@ private:
 
     struct chunk_t {
         chunk_t(size_t start, size_t size)
-        : start(start), size(size), free(1), prev(nullptr), next(nullptr) {
+        : start(start), size(size), free(1), prev(nullptr), next(nullptr),
+          free_prev(nullptr), free_next(nullptr) {
         }
         size_t              start;
         size_t              size : 28;
         int                 free : 4;
         mutable chunk_t*    prev;
         mutable chunk_t*    next;
+        // links in the free list of the chunk's size class, while it is free
+        chunk_t*            free_prev;
+        chunk_t*            free_next;
     };
 
+    // One class per bit of chunk_t::size: class n holds the free chunks of
+    // [2^n, 2^(n+1)) units.
+    static const int    kSizeClasses = 28;
+
     ssize_t  alloc(size_t size, uint32_t flags);
     chunk_t* dealloc(size_t start);
+    chunk_t* findFree(size_t size, uint32_t flags) const;
+    void     insertFree(chunk_t* chunk);
+    void     removeFree(chunk_t* chunk);
     void     dump_l(const char* what) const;
     void     dump_l(String8& res, const char* what) const;
 
+    static int sizeClass(size_t size) { return 31 - __builtin_clz(uint32_t(size)); }
+
     static const int    kMemoryAlign;
     mutable Mutex       mLock;
     LinkedList<chunk_t> mList;
+    chunk_t*            mFreeLists[kSizeClasses];
+    // bit n is set when mFreeLists[n] is not empty
+    uint32_t            mFreeClasses;
+    // allocated chunks, by start
+    std::unordered_map<size_t, chunk_t*> mAllocated;
     size_t              mHeapSize;
+    size_t              mAllocatedSize;
+    size_t              mPeakAllocatedSize;
+    uint64_t            mFailedAllocations;
 };
 
 // ----------------------------------------------------------------------------
@@ -278,12 +309,17 @@ size_t MemoryDealer::getAllocationAlignment()
 const int SimpleBestFitAllocator::kMemoryAlign = 32;
 
 SimpleBestFitAllocator::SimpleBestFitAllocator(size_t size)
+    : mFreeLists(), mFreeClasses(0), mAllocatedSize(0), mPeakAllocatedSize(0),
+      mFailedAllocations(0)
 {
     size_t pagesize = getpagesize();
     mHeapSize = ((size + pagesize-1) & ~(pagesize-1));
 
-    chunk_t* node = new chunk_t(0, mHeapSize / kMemoryAlign);
-    mList.insertHead(node);
+    if (mHeapSize) {
+        chunk_t* node = new chunk_t(0, mHeapSize / kMemoryAlign);
+        mList.insertHead(node);
+        insertFree(node);
+    }
 }
 
 SimpleBestFitAllocator::~SimpleBestFitAllocator()
@@ -323,102 +359,152 @@ status_t SimpleBestFitAllocator::deallocate(size_t offset)
     return NAME_NOT_FOUND;
 }
 
+void SimpleBestFitAllocator::insertFree(chunk_t* chunk)
+{
+    const int c = sizeClass(chunk->size);
+    chunk->free_prev = nullptr;
+    chunk->free_next = mFreeLists[c];
+    if (mFreeLists[c]) {
+        mFreeLists[c]->free_prev = chunk;
+    }
+    mFreeLists[c] = chunk;
+    mFreeClasses |= 1u << c;
+}
+
+void SimpleBestFitAllocator::removeFree(chunk_t* chunk)
+{
+    const int c = sizeClass(chunk->size);
+    if (chunk->free_prev) {
+        chunk->free_prev->free_next = chunk->free_next;
+    } else {
+        mFreeLists[c] = chunk->free_next;
+        if (!mFreeLists[c]) {
+            mFreeClasses &= ~(1u << c);
+        }
+    }
+    if (chunk->free_next) {
+        chunk->free_next->free_prev = chunk->free_prev;
+    }
+    chunk->free_prev = chunk->free_next = nullptr;
+}
+
+SimpleBestFitAllocator::chunk_t* SimpleBestFitAllocator::findFree(
+        size_t size, uint32_t flags) const
+{
+    const size_t pageunits = getpagesize() / kMemoryAlign;
+    // the most padding aligning the start to a page may need
+    const size_t worst = (flags & PAGE_ALIGNED) ? size + pageunits - 1 : size;
+    if (worst >= (size_t(1) << kSizeClasses)) {
+        return nullptr;
+    }
+
+    // Every chunk of a class above the one worst falls in is big enough, so
+    // any of them will do without looking. Chunks of worst's own class all
+    // fit only when worst is that class's lower bound.
+    const int c = sizeClass(worst);
+    const uint32_t fits = mFreeClasses &
+            ((worst == (size_t(1) << c)) ? ~((1u << c) - 1) : ~((2u << c) - 1));
+    if (fits) {
+        return mFreeLists[__builtin_ctz(fits)];
+    }
+
+    // Only smaller chunks are left: those that may still fit are in the
+    // classes of size and worst, and looking at them is the slow path of a
+    // nearly full heap.
+    for (int i = sizeClass(size); i <= c; i++) {
+        for (chunk_t* cur = mFreeLists[i]; cur; cur = cur->free_next) {
+            size_t extra = 0;
+            if (flags & PAGE_ALIGNED)
+                extra = ( -cur->start & (pageunits-1) ) ;
+            if (cur->size >= size + extra) {
+                return cur;
+            }
+        }
+    }
+    return nullptr;
+}
+
 ssize_t SimpleBestFitAllocator::alloc(size_t size, uint32_t flags)
 {
     if (size == 0) {
         return 0;
     }
     size = (size + kMemoryAlign-1) / kMemoryAlign;
-    chunk_t* free_chunk = nullptr;
-    chunk_t* cur = mList.head();
+
+    chunk_t* free_chunk = findFree(size, flags);
+    if (!free_chunk) {
+        mFailedAllocations++;
+        return NO_MEMORY;
+    }
 
     size_t pagesize = getpagesize();
-    while (cur) {
+    removeFree(free_chunk);
+    const size_t free_size = free_chunk->size;
+    free_chunk->free = 0;
+    free_chunk->size = size;
+    if (free_size > size) {
         int extra = 0;
         if (flags & PAGE_ALIGNED)
-            extra = ( -cur->start & ((pagesize/kMemoryAlign)-1) ) ;
-
-        // best fit
-        if (cur->free && (cur->size >= (size+extra))) {
-            if ((!free_chunk) || (cur->size < free_chunk->size)) {
-                free_chunk = cur;
-            }
-            if (cur->size == size) {
-                break;
-            }
+            extra = ( -free_chunk->start & ((pagesize/kMemoryAlign)-1) ) ;
+        if (extra) {
+            chunk_t* split = new chunk_t(free_chunk->start, extra);
+            free_chunk->start += extra;
+            mList.insertBefore(free_chunk, split);
+            insertFree(split);
         }
-        cur = cur->next;
-    }
-
-    if (free_chunk) {
-        const size_t free_size = free_chunk->size;
-        free_chunk->free = 0;
-        free_chunk->size = size;
-        if (free_size > size) {
-            int extra = 0;
-            if (flags & PAGE_ALIGNED)
-                extra = ( -free_chunk->start & ((pagesize/kMemoryAlign)-1) ) ;
-            if (extra) {
-                chunk_t* split = new chunk_t(free_chunk->start, extra);
-                free_chunk->start += extra;
-                mList.insertBefore(free_chunk, split);
-            }
 
-            ALOGE_IF((flags&PAGE_ALIGNED) && 
-                    ((free_chunk->start*kMemoryAlign)&(pagesize-1)),
-                    "PAGE_ALIGNED requested, but page is not aligned!!!");
+        ALOGE_IF((flags&PAGE_ALIGNED) &&
+                ((free_chunk->start*kMemoryAlign)&(pagesize-1)),
+                "PAGE_ALIGNED requested, but page is not aligned!!!");
 
-            const ssize_t tail_free = free_size - (size+extra);
-            if (tail_free > 0) {
-                chunk_t* split = new chunk_t(
-                        free_chunk->start + free_chunk->size, tail_free);
-                mList.insertAfter(free_chunk, split);
-            }
+        const ssize_t tail_free = free_size - (size+extra);
+        if (tail_free > 0) {
+            chunk_t* split = new chunk_t(
+                    free_chunk->start + free_chunk->size, tail_free);
+            mList.insertAfter(free_chunk, split);
+            insertFree(split);
         }
-        return (free_chunk->start)*kMemoryAlign;
     }
-    return NO_MEMORY;
+
+    mAllocated[free_chunk->start] = free_chunk;
+    mAllocatedSize += free_chunk->size;
+    if (mAllocatedSize > mPeakAllocatedSize) {
+        mPeakAllocatedSize = mAllocatedSize;
+    }
+    return (free_chunk->start)*kMemoryAlign;
 }
 
 SimpleBestFitAllocator::chunk_t* SimpleBestFitAllocator::dealloc(size_t start)
 {
     start = start / kMemoryAlign;
-    chunk_t* cur = mList.head();
-    while (cur) {
-        if (cur->start == start) {
-            LOG_FATAL_IF(cur->free,
-                "block at offset 0x%08lX of size 0x%08lX already freed",
-                cur->start*kMemoryAlign, cur->size*kMemoryAlign);
-
-            // merge freed blocks together
-            chunk_t* freed = cur;
-            cur->free = 1;
-            do {
-                chunk_t* const p = cur->prev;
-                chunk_t* const n = cur->next;
-                if (p && (p->free || !cur->size)) {
-                    freed = p;
-                    p->size += cur->size;
-                    mList.remove(cur);
-                    delete cur;
-                }
-                cur = n;
-            } while (cur && cur->free);
-
-            #ifndef NDEBUG
-                if (!freed->free) {
-                    dump_l("dealloc (!freed->free)");
-                }
-            #endif
-            LOG_FATAL_IF(!freed->free,
-                "freed block at offset 0x%08lX of size 0x%08lX is not free!",
-                freed->start * kMemoryAlign, freed->size * kMemoryAlign);
-
-            return freed;
-        }
-        cur = cur->next;
+    auto it = mAllocated.find(start);
+    if (it == mAllocated.end()) {
+        return nullptr;
     }
-    return nullptr;
+    chunk_t* freed = it->second;
+    mAllocated.erase(it);
+    mAllocatedSize -= freed->size;
+
+    // merge with the free neighbours, which are never next to another free
+    // chunk themselves
+    freed->free = 1;
+    chunk_t* const p = freed->prev;
+    if (p && p->free) {
+        removeFree(p);
+        p->size += freed->size;
+        mList.remove(freed);
+        delete freed;
+        freed = p;
+    }
+    chunk_t* const n = freed->next;
+    if (n && n->free) {
+        removeFree(n);
+        freed->size += n->size;
+        mList.remove(n);
+        delete n;
+    }
+    insertFree(freed);
+    return freed;
 }
 
 void SimpleBestFitAllocator::dump(const char* what) const
@@ -445,6 +531,9 @@ void SimpleBestFitAllocator::dump_l(String8& result,
         const char* what) const
 {
     size_t size = 0;
+    size_t free_size = 0;
+    size_t largest_free = 0;
+    size_t free_chunks = 0;
     int32_t i = 0;
     chunk_t const* cur = mList.head();
     
@@ -469,8 +558,14 @@ void SimpleBestFitAllocator::dump_l(String8& result,
         
         result.append(buffer);
 
-        if (!cur->free)
+        if (!cur->free) {
             size += cur->size*kMemoryAlign;
+        } else {
+            free_size += cur->size*kMemoryAlign;
+            free_chunks++;
+            if (cur->size*kMemoryAlign > largest_free)
+                largest_free = cur->size*kMemoryAlign;
+        }
 
         i++;
         cur = cur->next;
@@ -478,6 +573,34 @@ void SimpleBestFitAllocator::dump_l(String8& result,
     snprintf(buffer, SIZE,
             "  size allocated: %u (%u KB)\n", int(size), int(size/1024));
     result.append(buffer);
+
+    // How much of the free space can't be handed out in one piece: 0 when it
+    // is all one chunk, approaching 100 as it splinters.
+    const unsigned int fragmentation = free_size ?
+            (unsigned int)(100 - (largest_free * 100) / free_size) : 0;
+    snprintf(buffer, SIZE,
+            "  allocations: %zu, peak allocated: %zu (%zu KB), failed allocations: %" PRIu64 "\n",
+            mAllocated.size(), mPeakAllocatedSize*kMemoryAlign,
+            (mPeakAllocatedSize*kMemoryAlign)/1024, mFailedAllocations);
+    result.append(buffer);
+    snprintf(buffer, SIZE,
+            "  free: %zu (%zu KB) in %zu chunks, largest free: %zu (%zu KB), "
+            "fragmentation: %u%%\n",
+            free_size, free_size/1024, free_chunks, largest_free, largest_free/1024,
+            fragmentation);
+    result.append(buffer);
+
+    result.append("  free chunks by size:");
+    for (int c = 0; c < kSizeClasses; c++) {
+        size_t count = 0;
+        for (chunk_t const* f = mFreeLists[c]; f; f = f->free_next) {
+            count++;
+        }
+        if (count) {
+            result.appendFormat(" >=%zu:%zu", (size_t(1) << c)*kMemoryAlign, count);
+        }
+    }
+    result.append("\n");
 }
 
 
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OnewayExecutor"
+
+#include <private/binder/OnewayExecutor.h>
+
+#include <binder/IPCThreadState.h>
+#include <utils/Log.h>
+#include <utils/String8.h>
+
+namespace android {
+
+// ---------------------------------------------------------------------------
+
+class OnewayExecutor::Worker : public Thread
+{
+public:
+    explicit Worker(OnewayExecutor& executor)
+        : mExecutor(executor)
+    {
+    }
+
+protected:
+    virtual bool threadLoop()
+    {
+        mExecutor.runOne();
+        return true;
+    }
+
+    OnewayExecutor& mExecutor;
+};
+
+OnewayExecutor& OnewayExecutor::self()
+{
+    // Never destroyed, so workers can keep running at exit.
+    static OnewayExecutor* sExecutor = new OnewayExecutor;
+    return *sExecutor;
+}
+
+bool OnewayExecutor::enqueue(std::unique_ptr<OnewayTransaction>& txn)
+{
+    BBinder* target = txn->target.get();
+    const size_t bytes = txn->data->dataSize();
+
+    std::unique_lock<std::mutex> _l(mLock);
+    if (mQueuedBytes > 0 && mQueuedBytes + bytes > kMaxQueuedBytes) {
+        mSpaceAvailable.wait(_l, [&] {
+            return mQueuedBytes == 0 || mQueuedBytes + bytes <= kMaxQueuedBytes ||
+                    mNodes.find(target) == mNodes.end();
+        });
+        if (mQueuedBytes > 0 && mQueuedBytes + bytes > kMaxQueuedBytes) {
+            // Nothing of target's is queued or running any more, so it can
+            // run now without overtaking anything.
+            return false;
+        }
+    }
+
+    startWorkersLocked();
+    if (mWorkers.empty()) {
+        return false;
+    }
+
+    Node& node = mNodes[target];
+    node.pending.push_back(std::move(txn));
+    mQueuedBytes += bytes;
+    if (!node.scheduled) {
+        node.scheduled = true;
+        mReady.push_back(target);
+        mWorkAvailable.notify_one();
+    }
+    return true;
+}
+
+void OnewayExecutor::startWorkersLocked()
+{
+    while (mWorkers.size() < kWorkerThreads) {
+        sp<Thread> worker = new Worker(*this);
+        String8 name = String8::format("binder:oneway_%zu", mWorkers.size() + 1);
+        if (worker->run(name.string()) != NO_ERROR) {
+            ALOGE("Could not start %s", name.string());
+            return;
+        }
+        mWorkers.push_back(worker);
+    }
+}
+
+void OnewayExecutor::runOne()
+{
+    BBinder* target;
+    std::unique_ptr<OnewayTransaction> txn;
+    {
+        std::unique_lock<std::mutex> _l(mLock);
+        mWorkAvailable.wait(_l, [this] { return !mReady.empty(); });
+        target = mReady.front();
+        mReady.pop_front();
+        Node& node = mNodes[target];
+        txn = std::move(node.pending.front());
+        node.pending.pop_front();
+        mQueuedBytes -= txn->data->dataSize();
+    }
+    mSpaceAvailable.notify_all();
+
+    IPCThreadState* ipc = IPCThreadState::self();
+    ipc->executeOffloadedTransaction(*txn);
+    txn.reset();
+    // Sends the reference changes releasing the transaction made, since this
+    // thread may not talk to the driver again for a while.
+    ipc->flushCommands();
+
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        auto it = mNodes.find(target);
+        if (it->second.pending.empty()) {
+            mNodes.erase(it);
+        } else {
+            // Back of the line, so other nodes get a turn
+            mReady.push_back(target);
+            mWorkAvailable.notify_one();
+        }
+    }
+    mSpaceAvailable.notify_all();
+}
+
+}; // namespace android
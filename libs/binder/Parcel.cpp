@@ -73,6 +73,32 @@ static size_t pad_size(size_t s) {
     return PAD_SIZE_UNSAFE(s);
 }
 
+// Strings on the hot paths, like package names, are nearly always ASCII, which
+// converts between UTF-8 and UTF-16 by widening or narrowing each unit. The
+// checks and conversion loops below have no dependencies between iterations,
+// so the compiler vectorizes them.
+static bool isAscii(const uint8_t* str, size_t len) {
+    uint64_t bits = 0;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(word));
+        bits |= word;
+    }
+    for (; i < len; i++) {
+        bits |= str[i];
+    }
+    return (bits & 0x8080808080808080ULL) == 0;
+}
+
+static bool isAscii(const char16_t* str, size_t len) {
+    char16_t bits = 0;
+    for (size_t i = 0; i < len; i++) {
+        bits |= str[i];
+    }
+    return (bits & ~char16_t(0x7f)) == 0;
+}
+
 // Note: must be kept in sync with android/os/StrictMode.java's PENALTY_GATHER
 #define STRICT_MODE_PENALTY_GATHER (1 << 31)
 
@@ -84,6 +110,96 @@ static size_t gParcelGlobalAllocCount = 0;
 
 static size_t gMaxFds = 0;
 
+// Data and object buffers of destroyed Parcels are kept per thread, so that the
+// next Parcel written on that thread reuses one instead of allocating and
+// growing a fresh buffer. Only buffers of exactly POOLED_BUFFER_SIZE bytes are
+// kept, which is what a small Parcel gets when it first allocates, so any of
+// them fits any request up to that size.
+static const size_t POOLED_BUFFER_SIZE = 512;
+
+struct ParcelBufferCache {
+    static const size_t MAX_BUFFERS = 8;
+    void* buffers[MAX_BUFFERS];
+    size_t count = 0;
+};
+
+static pthread_once_t gBufferCacheKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t gBufferCacheKey;
+
+static void destroyBufferCache(void* st)
+{
+    ParcelBufferCache* cache = static_cast<ParcelBufferCache*>(st);
+    for (size_t i = 0; i < cache->count; i++) {
+        free(cache->buffers[i]);
+    }
+    delete cache;
+}
+
+static void makeBufferCacheKey()
+{
+    pthread_key_create(&gBufferCacheKey, destroyBufferCache);
+}
+
+static ParcelBufferCache* getBufferCache(bool create)
+{
+    pthread_once(&gBufferCacheKeyOnce, makeBufferCacheKey);
+    ParcelBufferCache* cache = static_cast<ParcelBufferCache*>(
+            pthread_getspecific(gBufferCacheKey));
+    if (cache == nullptr && create) {
+        cache = new ParcelBufferCache;
+        pthread_setspecific(gBufferCacheKey, cache);
+    }
+    return cache;
+}
+
+// Returns a buffer of at least size bytes, and its actual size in outCapacity.
+static void* allocateBuffer(size_t size, size_t* outCapacity)
+{
+    if (size > POOLED_BUFFER_SIZE) {
+        *outCapacity = size;
+        return malloc(size);
+    }
+    *outCapacity = POOLED_BUFFER_SIZE;
+    ParcelBufferCache* cache = getBufferCache(true /*create*/);
+    if (cache->count > 0) {
+        return cache->buffers[--cache->count];
+    }
+    return malloc(POOLED_BUFFER_SIZE);
+}
+
+// capacity must be the actual size of the buffer.
+static void releaseBuffer(void* buffer, size_t capacity)
+{
+    if (buffer == nullptr) {
+        return;
+    }
+    if (capacity == POOLED_BUFFER_SIZE) {
+        // Not created here: the thread may be exiting and have destroyed its cache already
+        ParcelBufferCache* cache = getBufferCache(false /*create*/);
+        if (cache != nullptr && cache->count < ParcelBufferCache::MAX_BUFFERS) {
+            cache->buffers[cache->count++] = buffer;
+            return;
+        }
+    }
+    free(buffer);
+}
+
+// Grows an objects array to at least *inOutCapacity entries, and returns the
+// entries it has room for in *inOutCapacity.
+static binder_size_t* reallocObjects(binder_size_t* objects, size_t* inOutCapacity)
+{
+    if (objects == nullptr) {
+        size_t bytes;
+        binder_size_t* allocated = static_cast<binder_size_t*>(
+                allocateBuffer(*inOutCapacity * sizeof(binder_size_t), &bytes));
+        if (allocated != nullptr) {
+            *inOutCapacity = bytes / sizeof(binder_size_t);
+        }
+        return allocated;
+    }
+    return static_cast<binder_size_t*>(realloc(objects, *inOutCapacity * sizeof(binder_size_t)));
+}
+
 // Maximum size of a blob to transfer in-place.
 static const size_t BLOB_INPLACE_LIMIT = 16 * 1024;
 
@@ -522,8 +638,7 @@ status_t Parcel::appendFrom(const Parcel *parcel, size_t offset, size_t len)
         if (mObjectsCapacity < mObjectsSize + numObjects) {
             size_t newSize = ((mObjectsSize + numObjects)*3)/2;
             if (newSize*sizeof(binder_size_t) < mObjectsSize) return NO_MEMORY;   // overflow
-            binder_size_t *objects =
-                (binder_size_t*)realloc(mObjects, newSize*sizeof(binder_size_t));
+            binder_size_t *objects = reallocObjects(mObjects, &newSize);
             if (objects == (binder_size_t*)nullptr) {
                 return NO_MEMORY;
             }
@@ -607,12 +722,32 @@ void Parcel::updateWorkSourceRequestHeaderPosition() const {
 status_t Parcel::writeInterfaceToken(const String16& interface)
 {
     const IPCThreadState* threadState = IPCThreadState::self();
-    writeInt32(threadState->getStrictModePolicy() | STRICT_MODE_PENALTY_GATHER);
-    updateWorkSourceRequestHeaderPosition();
-    writeInt32(threadState->shouldPropagateWorkSource() ?
-            threadState->getCallingWorkSourceUid() : IPCThreadState::kUnsetWorkSource);
-    // currently the interface identification token is just its name as a string
-    return writeString16(interface);
+    // The strict mode policy, the work source, and the interface identification
+    // token, which is just its name as a string, laid out the way writeInt32()
+    // twice and writeString16() would, but written in one go.
+    const size_t len = interface.size();
+    const size_t workSourcePosition = dataPosition() + sizeof(int32_t);
+    uint8_t* data = reinterpret_cast<uint8_t*>(
+            writeInplace(3 * sizeof(int32_t) + (len + 1) * sizeof(char16_t)));
+    if (!data) {
+        return NO_MEMORY;
+    }
+    if (!mRequestHeaderPresent) {
+        mWorkSourceRequestHeaderPosition = workSourcePosition;
+        mRequestHeaderPresent = true;
+    }
+    const int32_t header[3] = {
+        threadState->getStrictModePolicy() | STRICT_MODE_PENALTY_GATHER,
+        threadState->shouldPropagateWorkSource() ?
+                static_cast<int32_t>(threadState->getCallingWorkSourceUid()) :
+                IPCThreadState::kUnsetWorkSource,
+        static_cast<int32_t>(len),
+    };
+    memcpy(data, header, sizeof(header));
+    char16_t* str = reinterpret_cast<char16_t*>(data + sizeof(header));
+    memcpy(str, interface.string(), len * sizeof(char16_t));
+    str[len] = 0;
+    return NO_ERROR;
 }
 
 bool Parcel::replaceCallingWorkSourceUid(uid_t uid)
@@ -649,8 +784,36 @@ bool Parcel::checkInterface(IBinder* binder) const
 bool Parcel::enforceInterface(const String16& interface,
                               IPCThreadState* threadState) const
 {
+    // The sender writes the strict mode policy, the work source and the length
+    // of the interface descriptor back to back, so take all three with one
+    // bounds check, and fall back to reading them one by one if that fails.
+    int32_t strictPolicy;
+    int32_t workSource;
+    size_t len = 0;
+    const char16_t* str = nullptr;
+    const size_t headerPosition = dataPosition();
+    const int32_t* header = reinterpret_cast<const int32_t*>(readInplace(3 * sizeof(int32_t)));
+    if (header != nullptr) {
+        strictPolicy = header[0];
+        workSource = header[1];
+        if (!mRequestHeaderPresent) {
+            mWorkSourceRequestHeaderPosition = headerPosition + sizeof(int32_t);
+            mRequestHeaderPresent = true;
+        }
+        if (header[2] >= 0 && header[2] < INT32_MAX) {
+            str = reinterpret_cast<const char16_t*>(
+                    readInplace((header[2] + 1) * sizeof(char16_t)));
+            len = str ? header[2] : 0;
+        }
+    } else {
+        setDataPosition(headerPosition);
+        strictPolicy = readInt32();
+        updateWorkSourceRequestHeaderPosition();
+        workSource = readInt32();
+        str = readString16Inplace(&len);
+    }
+
     // StrictModePolicy.
-    int32_t strictPolicy = readInt32();
     if (threadState == nullptr) {
         threadState = IPCThreadState::self();
     }
@@ -665,16 +828,14 @@ bool Parcel::enforceInterface(const String16& interface,
       threadState->setStrictModePolicy(strictPolicy);
     }
     // WorkSource.
-    updateWorkSourceRequestHeaderPosition();
-    int32_t workSource = readInt32();
     threadState->setCallingWorkSourceUidWithoutPropagation(workSource);
-    // Interface descriptor.
-    const String16 str(readString16());
-    if (str == interface) {
+    // Interface descriptor. Compared in place, without copying it into a String16.
+    if (len == interface.size() &&
+            (len == 0 || memcmp(str, interface.string(), len * sizeof(char16_t)) == 0)) {
         return true;
     } else {
         ALOGW("**** enforceInterface() expected '%s' but read '%s'",
-                String8(interface).string(), String8(str).string());
+                String8(interface).string(), str ? String8(str, len).string() : "");
         return false;
     }
 }
@@ -808,6 +969,22 @@ restart_write:
 status_t Parcel::writeUtf8AsUtf16(const std::string& str) {
     const uint8_t* strData = (uint8_t*)str.data();
     const size_t strLen= str.length();
+    if (strLen <= size_t(std::numeric_limits<int32_t>::max()) && isAscii(strData, strLen)) {
+        status_t err = writeInt32(strLen);
+        if (err) {
+            return err;
+        }
+        char16_t* dst = (char16_t*)writeInplace((strLen + 1) * sizeof(char16_t));
+        if (!dst) {
+            return NO_MEMORY;
+        }
+        for (size_t i = 0; i < strLen; i++) {
+            dst[i] = strData[i];
+        }
+        dst[strLen] = 0;
+        return NO_ERROR;
+    }
+
     const ssize_t utf16Len = utf8_to_utf16_length(strData, strLen);
     if (utf16Len < 0 || utf16Len > std::numeric_limits<int32_t>::max()) {
         return BAD_VALUE;
@@ -1321,6 +1498,30 @@ status_t Parcel::writeDupImmutableBlobFileDescriptor(int fd)
     return writeDupFileDescriptor(fd);
 }
 
+status_t Parcel::writeByteVectorAsBlob(const std::vector<uint8_t>& val)
+{
+    if (val.size() > std::numeric_limits<int32_t>::max()) {
+        return BAD_VALUE;
+    }
+    status_t status = writeInt32(val.size());
+    if (status != OK) return status;
+
+    WritableBlob blob;
+    status = writeBlob(val.size(), false /*mutableCopy*/, &blob);
+    if (status != OK) return status;
+    memcpy(blob.data(), val.data(), val.size());
+    blob.release();
+    return OK;
+}
+
+status_t Parcel::writeByteVectorAsBlob(const std::unique_ptr<std::vector<uint8_t>>& val)
+{
+    if (!val) {
+        return writeInt32(-1);
+    }
+    return writeByteVectorAsBlob(*val);
+}
+
 status_t Parcel::write(const FlattenableHelperInterface& val)
 {
     status_t err;
@@ -1401,7 +1602,7 @@ restart_write:
     if (!enoughObjects) {
         size_t newSize = ((mObjectsSize+2)*3)/2;
         if (newSize*sizeof(binder_size_t) < mObjectsSize) return NO_MEMORY;   // overflow
-        binder_size_t* objects = (binder_size_t*)realloc(mObjects, newSize*sizeof(binder_size_t));
+        binder_size_t* objects = reallocObjects(mObjects, &newSize);
         if (objects == nullptr) return NO_MEMORY;
         mObjects = objects;
         mObjectsCapacity = newSize;
@@ -2056,6 +2257,15 @@ status_t Parcel::readUtf8FromUtf16(std::string* str) const {
        return NO_ERROR;
     }
 
+    if (isAscii(src, utf16Size)) {
+        str->resize(utf16Size);
+        char* dst = &(*str)[0];
+        for (size_t i = 0; i < utf16Size; i++) {
+            dst[i] = static_cast<char>(src[i]);
+        }
+        return NO_ERROR;
+    }
+
     // Allow for closing '\0'
     ssize_t utf8Size = utf16_to_utf8_length(src, utf16Size) + 1;
     if (utf8Size < 1) {
@@ -2406,6 +2616,50 @@ status_t Parcel::readBlob(size_t len, ReadableBlob* outBlob) const
     return NO_ERROR;
 }
 
+status_t Parcel::readSizedBlob(ReadableBlob* outBlob) const
+{
+    int32_t size;
+    status_t status = readInt32(&size);
+    if (status != OK) return status;
+    if (size < 0) return UNEXPECTED_NULL;
+    return readBlob(size, outBlob);
+}
+
+status_t Parcel::readByteVectorFromBlob(std::vector<uint8_t>* val) const
+{
+    val->clear();
+    ReadableBlob blob;
+    status_t status = readSizedBlob(&blob);
+    if (status != OK) return status;
+
+    const uint8_t* data = static_cast<const uint8_t*>(blob.data());
+    val->assign(data, data + blob.size());
+    blob.release();
+    return OK;
+}
+
+status_t Parcel::readByteVectorFromBlob(std::unique_ptr<std::vector<uint8_t>>* val) const
+{
+    const size_t start = dataPosition();
+    int32_t size;
+    status_t status = readInt32(&size);
+    val->reset();
+    if (status != OK || size < 0) {
+        return status;
+    }
+
+    setDataPosition(start);
+    val->reset(new (std::nothrow) std::vector<uint8_t>());
+    if (!*val) {
+        return NO_MEMORY;
+    }
+    status = readByteVectorFromBlob(val->get());
+    if (status != OK) {
+        val->reset();
+    }
+    return status;
+}
+
 status_t Parcel::read(FlattenableHelperInterface& val) const
 {
     // size
@@ -2671,9 +2925,9 @@ void Parcel::freeDataNoInit()
               gParcelGlobalAllocCount--;
             }
             pthread_mutex_unlock(&gParcelGlobalAllocSizeLock);
-            free(mData);
+            releaseBuffer(mData, mDataCapacity);
         }
-        if (mObjects) free(mObjects);
+        releaseBuffer(mObjects, mObjectsCapacity*sizeof(binder_size_t));
     }
 }
 
@@ -2729,7 +2983,7 @@ status_t Parcel::restartWrite(size_t desired)
     ALOGV("restartWrite Setting data size of %p to %zu", this, mDataSize);
     ALOGV("restartWrite Setting data pos of %p to %zu", this, mDataPos);
 
-    free(mObjects);
+    releaseBuffer(mObjects, mObjectsCapacity*sizeof(binder_size_t));
     mObjects = nullptr;
     mObjectsSize = mObjectsCapacity = 0;
     mNextObjectHint = 0;
@@ -2773,7 +3027,8 @@ status_t Parcel::continueWrite(size_t desired)
 
         // If there is a different owner, we need to take
         // posession.
-        uint8_t* data = (uint8_t*)malloc(desired);
+        size_t capacity;
+        uint8_t* data = (uint8_t*)allocateBuffer(desired, &capacity);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -2783,7 +3038,7 @@ status_t Parcel::continueWrite(size_t desired)
         if (objectsSize) {
             objects = (binder_size_t*)calloc(objectsSize, sizeof(binder_size_t));
             if (!objects) {
-                free(data);
+                releaseBuffer(data, capacity);
 
                 mError = NO_MEMORY;
                 return NO_MEMORY;
@@ -2807,9 +3062,9 @@ status_t Parcel::continueWrite(size_t desired)
         mOwner(this, mData, mDataSize, mObjects, mObjectsSize, mOwnerCookie);
         mOwner = nullptr;
 
-        LOG_ALLOC("Parcel %p: taking ownership of %zu capacity", this, desired);
+        LOG_ALLOC("Parcel %p: taking ownership of %zu capacity", this, capacity);
         pthread_mutex_lock(&gParcelGlobalAllocSizeLock);
-        gParcelGlobalAllocSize += desired;
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
         pthread_mutex_unlock(&gParcelGlobalAllocSizeLock);
 
@@ -2817,7 +3072,7 @@ status_t Parcel::continueWrite(size_t desired)
         mObjects = objects;
         mDataSize = (mDataSize < desired) ? mDataSize : desired;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
         mObjectsSize = mObjectsCapacity = objectsSize;
         mNextObjectHint = 0;
         mObjectsSorted = false;
@@ -2837,13 +3092,15 @@ status_t Parcel::continueWrite(size_t desired)
             }
 
             if (objectsSize == 0) {
-                free(mObjects);
+                releaseBuffer(mObjects, mObjectsCapacity*sizeof(binder_size_t));
                 mObjects = nullptr;
+                mObjectsCapacity = 0;
             } else {
                 binder_size_t* objects =
                     (binder_size_t*)realloc(mObjects, objectsSize*sizeof(binder_size_t));
                 if (objects) {
                     mObjects = objects;
+                    mObjectsCapacity = objectsSize;
                 }
             }
             mObjectsSize = objectsSize;
@@ -2880,7 +3137,8 @@ status_t Parcel::continueWrite(size_t desired)
 
     } else {
         // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        size_t capacity;
+        uint8_t* data = (uint8_t*)allocateBuffer(desired, &capacity);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -2891,9 +3149,9 @@ status_t Parcel::continueWrite(size_t desired)
             ALOGE("continueWrite: %zu/%p/%zu/%zu", mDataCapacity, mObjects, mObjectsCapacity, desired);
         }
 
-        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, desired);
+        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, capacity);
         pthread_mutex_lock(&gParcelGlobalAllocSizeLock);
-        gParcelGlobalAllocSize += desired;
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
         pthread_mutex_unlock(&gParcelGlobalAllocSizeLock);
 
@@ -2901,7 +3159,7 @@ status_t Parcel::continueWrite(size_t desired)
         mDataSize = mDataPos = 0;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
         ALOGV("continueWrite Setting data pos of %p to %zu", this, mDataPos);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
     }
 
     return NO_ERROR;
@@ -18,8 +18,10 @@
 
 #include <stdint.h>
 #include <utils/Log.h>
+#include <binder/ActivityManager.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
+#include <binder/IUidObserver.h>
 #include <binder/PermissionCache.h>
 #include <utils/String8.h>
 
@@ -36,13 +38,11 @@ PermissionCache::PermissionCache() {
 
 status_t PermissionCache::check(bool* granted,
         const String16& permission, uid_t uid) const {
-    Mutex::Autolock _l(mLock);
-    Entry e;
-    e.name = permission;
-    e.uid  = uid;
-    ssize_t index = mCache.indexOf(e);
-    if (index >= 0) {
-        *granted = mCache.itemAt(index).granted;
+    const Shard& shard(shardFor(uid));
+    Mutex::Autolock _l(shard.lock);
+    auto it = shard.entries.find(Key{permission, uid});
+    if (it != shard.entries.end() && it->second.expires > systemTime()) {
+        *granted = it->second.granted;
         return NO_ERROR;
     }
     return NAME_NOT_FOUND;
@@ -50,28 +50,62 @@ status_t PermissionCache::check(bool* granted,
 
 void PermissionCache::cache(const String16& permission,
         uid_t uid, bool granted) {
-    Mutex::Autolock _l(mLock);
-    Entry e;
-    ssize_t index = mPermissionNamesPool.indexOf(permission);
-    if (index > 0) {
-        e.name = mPermissionNamesPool.itemAt(index);
-    } else {
-        mPermissionNamesPool.add(permission);
-        e.name = permission;
-    }
     // note, we don't need to store the pid, which is not actually used in
     // permission checks
-    e.uid  = uid;
-    e.granted = granted;
-    index = mCache.indexOf(e);
-    if (index < 0) {
-        mCache.add(e);
-    }
+    const nsecs_t now = systemTime();
+    Shard& shard(shardFor(uid));
+    Mutex::Autolock _l(shard.lock);
+    shard.entries[Key{permission, uid}] =
+            Entry{granted, now + (granted ? GRANTED_TIMEOUT : DENIED_TIMEOUT)};
 }
 
 void PermissionCache::purge() {
-    Mutex::Autolock _l(mLock);
-    mCache.clear();
+    for (Shard& shard : mShards) {
+        Mutex::Autolock _l(shard.lock);
+        shard.entries.clear();
+    }
+}
+
+void PermissionCache::invalidate(uid_t uid) {
+    Shard& shard(PermissionCache::getInstance().shardFor(uid));
+    Mutex::Autolock _l(shard.lock);
+    for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+        if (it->first.uid == uid) {
+            it = shard.entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PermissionCache::invalidateAll() {
+    PermissionCache::getInstance().purge();
+}
+
+// Revoking a runtime permission kills the app, so its uid going away is as
+// close to a permission change notification as native code gets.
+class PermissionCacheUidObserver : public BnUidObserver {
+public:
+    virtual void onUidGone(uid_t uid, bool /*disabled*/) {
+        PermissionCache::invalidate(uid);
+    }
+    virtual void onUidActive(uid_t /*uid*/) {}
+    virtual void onUidIdle(uid_t /*uid*/, bool /*disabled*/) {}
+    virtual void onUidStateChanged(uid_t /*uid*/, int32_t /*procState*/,
+            int64_t /*procStateSeq*/) {}
+};
+
+void PermissionCache::watchUidChanges(const String16& callingPackage) {
+    static Mutex sLock;
+    static sp<IUidObserver> sObserver;
+    Mutex::Autolock _l(sLock);
+    if (sObserver != nullptr) {
+        return;
+    }
+    sObserver = new PermissionCacheUidObserver();
+    ActivityManager am;
+    am.registerUidObserver(sObserver, ActivityManager::UID_OBSERVER_GONE,
+            ActivityManager::PROCESS_STATE_UNKNOWN, callingPackage);
 }
 
 bool PermissionCache::checkCallingPermission(const String16& permission) {
@@ -19,7 +19,9 @@
 #include <binder/PersistableBundle.h>
 #include <private/binder/ParcelValTypes.h>
 
+#include <algorithm>
 #include <limits>
+#include <utility>
 
 #include <binder/IBinder.h>
 #include <binder/Parcel.h>
@@ -53,6 +55,40 @@ bool getValue(const android::String16& key, T* out, const map<android::String16,
     return true;
 }
 
+// Sizes of the values as Parcel encodes them, each padded to 4 bytes.
+size_t parcelDataSize(const android::String16& value) {
+    return sizeof(int32_t) + (((value.size() + 1) * sizeof(char16_t) + 3) & ~3);
+}
+
+size_t parcelDataSize(const vector<android::String16>& value) {
+    size_t size = sizeof(int32_t);
+    for (const auto& element : value) {
+        size += parcelDataSize(element);
+    }
+    return size;
+}
+
+template <typename T>
+size_t parcelDataSize(const vector<T>& value) {
+    return sizeof(int32_t) + value.size() * std::max(sizeof(T), sizeof(int32_t));
+}
+
+template <typename T>
+size_t parcelDataSize(const T&) {
+    return std::max(sizeof(T), sizeof(int32_t));
+}
+
+// Size of the key, type and value of every entry in the map.
+template <typename T>
+size_t parcelDataSize(const map<android::String16, T>& map) {
+    size_t size = 0;
+    for (const auto& key_value_pair : map) {
+        size += parcelDataSize(key_value_pair.first) + sizeof(int32_t) +
+                parcelDataSize(key_value_pair.second);
+    }
+    return size;
+}
+
 template <typename T>
 set<android::String16> getKeys(const map<android::String16, T>& map) {
     if (map.empty()) return set<android::String16>();
@@ -87,6 +123,13 @@ namespace os {
     }
 
 status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
+    // Grow the parcel once for the whole bundle, including any nested bundles, rather than
+    // repeatedly while the entries are written. If this fails the writes report the error.
+    parcel->setDataCapacity(parcel->dataPosition() + getParcelDataSize());
+    return writeToParcelWithLength(parcel);
+}
+
+status_t PersistableBundle::writeToParcelWithLength(Parcel* parcel) const {
     /*
      * Keep implementation in sync with writeToParcelInner() in
      * frameworks/base/core/java/android/os/BaseBundle.java.
@@ -375,11 +418,35 @@ status_t PersistableBundle::writeToParcelInner(Parcel* parcel) const {
     for (const auto& key_val_pair : mPersistableBundleMap) {
         RETURN_IF_FAILED(parcel->writeString16(key_val_pair.first));
         RETURN_IF_FAILED(parcel->writeInt32(VAL_PERSISTABLEBUNDLE));
-        RETURN_IF_FAILED(key_val_pair.second.writeToParcel(parcel));
+        RETURN_IF_FAILED(key_val_pair.second.writeToParcelWithLength(parcel));
     }
     return NO_ERROR;
 }
 
+size_t PersistableBundle::getParcelDataSize() const {
+    // The length, then for a non-empty bundle the magic number and the number of entries.
+    size_t size = sizeof(int32_t);
+    if (empty()) {
+        return size;
+    }
+    size += 2 * sizeof(int32_t);
+    size += parcelDataSize(mBoolMap);
+    size += parcelDataSize(mIntMap);
+    size += parcelDataSize(mLongMap);
+    size += parcelDataSize(mDoubleMap);
+    size += parcelDataSize(mStringMap);
+    size += parcelDataSize(mBoolVectorMap);
+    size += parcelDataSize(mIntVectorMap);
+    size += parcelDataSize(mLongVectorMap);
+    size += parcelDataSize(mDoubleVectorMap);
+    size += parcelDataSize(mStringVectorMap);
+    for (const auto& key_val_pair : mPersistableBundleMap) {
+        size += parcelDataSize(key_val_pair.first) + sizeof(int32_t) +
+                key_val_pair.second.getParcelDataSize();
+    }
+    return size;
+}
+
 status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t length) {
     /*
      * Note: we don't actually use length for anything other than an empty PersistableBundle
@@ -415,51 +482,51 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
 
         /*
          * We assume that both the C++ and Java APIs ensure that all keys in a PersistableBundle
-         * are unique.
+         * are unique. The key is moved into whichever map the value belongs to.
          */
         switch (value_type) {
             case VAL_STRING: {
-                RETURN_IF_FAILED(parcel->readString16(&mStringMap[key]));
+                RETURN_IF_FAILED(parcel->readString16(&mStringMap[std::move(key)]));
                 break;
             }
             case VAL_INTEGER: {
-                RETURN_IF_FAILED(parcel->readInt32(&mIntMap[key]));
+                RETURN_IF_FAILED(parcel->readInt32(&mIntMap[std::move(key)]));
                 break;
             }
             case VAL_LONG: {
-                RETURN_IF_FAILED(parcel->readInt64(&mLongMap[key]));
+                RETURN_IF_FAILED(parcel->readInt64(&mLongMap[std::move(key)]));
                 break;
             }
             case VAL_DOUBLE: {
-                RETURN_IF_FAILED(parcel->readDouble(&mDoubleMap[key]));
+                RETURN_IF_FAILED(parcel->readDouble(&mDoubleMap[std::move(key)]));
                 break;
             }
             case VAL_BOOLEAN: {
-                RETURN_IF_FAILED(parcel->readBool(&mBoolMap[key]));
+                RETURN_IF_FAILED(parcel->readBool(&mBoolMap[std::move(key)]));
                 break;
             }
             case VAL_STRINGARRAY: {
-                RETURN_IF_FAILED(parcel->readString16Vector(&mStringVectorMap[key]));
+                RETURN_IF_FAILED(parcel->readString16Vector(&mStringVectorMap[std::move(key)]));
                 break;
             }
             case VAL_INTARRAY: {
-                RETURN_IF_FAILED(parcel->readInt32Vector(&mIntVectorMap[key]));
+                RETURN_IF_FAILED(parcel->readInt32Vector(&mIntVectorMap[std::move(key)]));
                 break;
             }
             case VAL_LONGARRAY: {
-                RETURN_IF_FAILED(parcel->readInt64Vector(&mLongVectorMap[key]));
+                RETURN_IF_FAILED(parcel->readInt64Vector(&mLongVectorMap[std::move(key)]));
                 break;
             }
             case VAL_BOOLEANARRAY: {
-                RETURN_IF_FAILED(parcel->readBoolVector(&mBoolVectorMap[key]));
+                RETURN_IF_FAILED(parcel->readBoolVector(&mBoolVectorMap[std::move(key)]));
                 break;
             }
             case VAL_PERSISTABLEBUNDLE: {
-                RETURN_IF_FAILED(mPersistableBundleMap[key].readFromParcel(parcel));
+                RETURN_IF_FAILED(mPersistableBundleMap[std::move(key)].readFromParcel(parcel));
                 break;
             }
             case VAL_DOUBLEARRAY: {
-                RETURN_IF_FAILED(parcel->readDoubleVector(&mDoubleVectorMap[key]));
+                RETURN_IF_FAILED(parcel->readDoubleVector(&mDoubleVectorMap[std::move(key)]));
                 break;
             }
             default: {
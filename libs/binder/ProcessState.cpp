@@ -24,6 +24,7 @@
 #include <cutils/atomic.h>
 #include <utils/Log.h>
 #include <utils/String8.h>
+#include <utils/SystemClock.h>
 #include <utils/String8.h>
 #include <utils/threads.h>
 
@@ -41,6 +42,8 @@
 #include <sys/types.h>
 
 #define BINDER_VM_SIZE ((1 * 1024 * 1024) - sysconf(_SC_PAGE_SIZE) * 2)
+// The driver refuses to map more than this for one process
+#define BINDER_VM_SIZE_MAX (4 * 1024 * 1024)
 #define DEFAULT_MAX_BINDER_THREADS 15
 
 #ifdef __ANDROID_VNDK__
@@ -77,17 +80,31 @@ sp<ProcessState> ProcessState::self()
     if (gProcess != nullptr) {
         return gProcess;
     }
-    gProcess = new ProcessState(kDefaultDriver);
+    gProcess = new ProcessState(kDefaultDriver, BINDER_VM_SIZE);
     return gProcess;
 }
 
 sp<ProcessState> ProcessState::initWithDriver(const char* driver)
 {
+    return initWithDriver(driver, BINDER_VM_SIZE);
+}
+
+sp<ProcessState> ProcessState::initWithDriver(const char* driver, size_t mmapSize)
+{
+    const size_t pageSize = sysconf(_SC_PAGE_SIZE);
+    mmapSize = (mmapSize + pageSize - 1) & ~(pageSize - 1);
+    if (mmapSize == 0 || mmapSize > BINDER_VM_SIZE_MAX) {
+        ALOGW("Binder mmap size %zu is out of range, using %zu instead.", mmapSize,
+              (size_t) BINDER_VM_SIZE);
+        mmapSize = BINDER_VM_SIZE;
+    }
+
     Mutex::Autolock _l(gProcessMutex);
     if (gProcess != nullptr) {
         // Allow for initWithDriver to be called repeatedly with the same
-        // driver.
-        if (!strcmp(gProcess->getDriverName().c_str(), driver)) {
+        // driver and mmap size.
+        if (!strcmp(gProcess->getDriverName().c_str(), driver) &&
+                gProcess->getMmapSize() == mmapSize) {
             return gProcess;
         }
         LOG_ALWAYS_FATAL("ProcessState was already initialized.");
@@ -98,7 +115,7 @@ sp<ProcessState> ProcessState::initWithDriver(const char* driver)
         driver = "/dev/binder";
     }
 
-    gProcess = new ProcessState(driver);
+    gProcess = new ProcessState(driver, mmapSize);
     return gProcess;
 }
 
@@ -376,15 +393,51 @@ void ProcessState::spawnPooledThread(bool isMain)
 
 status_t ProcessState::setThreadPoolMaxThreadCount(size_t maxThreads) {
     status_t result = NO_ERROR;
-    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &maxThreads) != -1) {
+    pthread_mutex_lock(&mThreadCountLock);
+    size_t driverMaxThreads = maxThreads + mRetiredThreadsCount;
+    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &driverMaxThreads) != -1) {
         mMaxThreads = maxThreads;
     } else {
         result = -errno;
         ALOGE("Binder ioctl to set max threads failed: %s", strerror(-result));
     }
+    pthread_mutex_unlock(&mThreadCountLock);
     return result;
 }
 
+void ProcessState::setThreadPoolIdleTimeoutMs(int64_t timeoutMs) {
+    pthread_mutex_lock(&mThreadCountLock);
+    mIdleTimeoutMs = timeoutMs > 0 ? timeoutMs : 0;
+    mIdleWindowStartMs = uptimeMillis();
+    mPeakExecutingThreadsCount = mExecutingThreadsCount;
+    pthread_mutex_unlock(&mThreadCountLock);
+}
+
+bool ProcessState::shouldRetirePooledThread() {
+    bool retire = false;
+    pthread_mutex_lock(&mThreadCountLock);
+    if (mIdleTimeoutMs > 0) {
+        const int64_t now = uptimeMillis();
+        if (now - mIdleWindowStartMs >= mIdleTimeoutMs) {
+            // No more than the peak were busy at once over the whole window,
+            // so the threads past it, less one kept spare, were not needed.
+            // At most one thread retires per window, so a single quiet
+            // window doesn't empty the pool.
+            if (mPoolThreadsCount > mPeakExecutingThreadsCount + 1) {
+                size_t driverMaxThreads = mMaxThreads + mRetiredThreadsCount + 1;
+                if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &driverMaxThreads) != -1) {
+                    mRetiredThreadsCount++;
+                    retire = true;
+                }
+            }
+            mIdleWindowStartMs = now;
+            mPeakExecutingThreadsCount = mExecutingThreadsCount;
+        }
+    }
+    pthread_mutex_unlock(&mThreadCountLock);
+    return retire;
+}
+
 void ProcessState::giveThreadPoolName() {
     androidSetThreadName( makeBinderThreadName().string() );
 }
@@ -393,6 +446,62 @@ String8 ProcessState::getDriverName() {
     return mDriverName;
 }
 
+size_t ProcessState::getMmapSize() const {
+    return mMmapSize;
+}
+
+static void updatePeak(std::atomic<size_t>& peak, size_t value)
+{
+    size_t current = peak.load(std::memory_order_relaxed);
+    while (value > current &&
+            !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+size_t ProcessState::onBufferReceived(size_t dataSize, size_t offsetsSize, bool oneway)
+{
+    // The driver allocates each part of the buffer 8-byte aligned
+    const size_t bytes = ((dataSize + 7) & ~size_t(7)) + ((offsetsSize + 7) & ~size_t(7));
+    updatePeak(mPeakBufferBytesInUse,
+               mBufferBytesInUse.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    if (oneway) {
+        updatePeak(mPeakAsyncBufferBytesInUse,
+                   mAsyncBufferBytesInUse.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    }
+    updatePeak(mLargestTransaction, bytes);
+
+    size_t bucket = 0;
+    while (bucket < TRANSACTION_SIZE_BUCKETS - 1 &&
+            bytes > TRANSACTION_SIZE_BUCKET_LIMITS[bucket]) {
+        bucket++;
+    }
+    mTransactionSizeHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    return bytes;
+}
+
+void ProcessState::onBufferFreed(size_t bytes, bool oneway)
+{
+    mBufferBytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+    if (oneway) {
+        mAsyncBufferBytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+}
+
+ProcessState::TransactionBufferStats ProcessState::getTransactionBufferStats() const
+{
+    TransactionBufferStats stats;
+    stats.mmapSize = mMmapSize;
+    stats.bytesInUse = mBufferBytesInUse.load(std::memory_order_relaxed);
+    stats.peakBytesInUse = mPeakBufferBytesInUse.load(std::memory_order_relaxed);
+    stats.asyncBytesInUse = mAsyncBufferBytesInUse.load(std::memory_order_relaxed);
+    stats.peakAsyncBytesInUse = mPeakAsyncBufferBytesInUse.load(std::memory_order_relaxed);
+    stats.largestTransaction = mLargestTransaction.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < TRANSACTION_SIZE_BUCKETS; i++) {
+        stats.sizeHistogram[i] = mTransactionSizeHistogram[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
 static int open_driver(const char *driver)
 {
     int fd = open(driver, O_RDWR | O_CLOEXEC);
@@ -421,15 +530,26 @@ static int open_driver(const char *driver)
     return fd;
 }
 
-ProcessState::ProcessState(const char *driver)
+ProcessState::ProcessState(const char *driver, size_t mmapSize)
     : mDriverName(String8(driver))
     , mDriverFD(open_driver(driver))
     , mVMStart(MAP_FAILED)
+    , mMmapSize(mmapSize)
+    , mBufferBytesInUse(0)
+    , mPeakBufferBytesInUse(0)
+    , mAsyncBufferBytesInUse(0)
+    , mPeakAsyncBufferBytesInUse(0)
+    , mLargestTransaction(0)
     , mThreadCountLock(PTHREAD_MUTEX_INITIALIZER)
     , mThreadCountDecrement(PTHREAD_COND_INITIALIZER)
     , mExecutingThreadsCount(0)
     , mMaxThreads(DEFAULT_MAX_BINDER_THREADS)
     , mStarvationStartTimeMs(0)
+    , mPoolThreadsCount(0)
+    , mPeakExecutingThreadsCount(0)
+    , mIdleWindowStartMs(0)
+    , mIdleTimeoutMs(0)
+    , mRetiredThreadsCount(0)
     , mManagesContexts(false)
     , mBinderContextCheckFunc(nullptr)
     , mBinderContextUserData(nullptr)
@@ -437,9 +557,13 @@ ProcessState::ProcessState(const char *driver)
     , mThreadPoolSeq(1)
     , mCallRestriction(CallRestriction::NONE)
 {
+    for (std::atomic<uint64_t>& count : mTransactionSizeHistogram) {
+        count.store(0, std::memory_order_relaxed);
+    }
+
     if (mDriverFD >= 0) {
         // mmap the binder, providing a chunk of virtual address space to receive transactions.
-        mVMStart = mmap(nullptr, BINDER_VM_SIZE, PROT_READ, MAP_PRIVATE | MAP_NORESERVE, mDriverFD, 0);
+        mVMStart = mmap(nullptr, mMmapSize, PROT_READ, MAP_PRIVATE | MAP_NORESERVE, mDriverFD, 0);
         if (mVMStart == MAP_FAILED) {
             // *sigh*
             ALOGE("Using %s failed: unable to mmap transaction memory.\n", mDriverName.c_str());
@@ -456,7 +580,7 @@ ProcessState::~ProcessState()
 {
     if (mDriverFD >= 0) {
         if (mVMStart != MAP_FAILED) {
-            munmap(mVMStart, BINDER_VM_SIZE);
+            munmap(mVMStart, mMmapSize);
         }
         close(mDriverFD);
     }
@@ -64,6 +64,13 @@ public:
     // This must be called before the object is sent to another process. Not thread safe.
     void                setRequestingSid(bool requestSid);
 
+    bool                isOnewayOffloaded();
+    // Runs this object's oneway transactions on a separate pool of threads,
+    // so the binder thread that received one can go back for the next
+    // transaction right away. They still run one at a time, in order. Not
+    // thread safe.
+    void                setOnewayOffloaded(bool offloaded);
+
 protected:
     virtual             ~BBinder();
 
@@ -80,6 +87,7 @@ private:
     class Extras;
 
     Extras*             getOrCreateExtras();
+    const String16&     getStatsDescriptor();
 
     std::atomic<Extras*> mExtras;
             void*       mReserved0;
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_BINDER_CALL_STATS_H
+#define ANDROID_BINDER_CALL_STATS_H
+
+#include <binder/IBinder.h>
+#include <utils/Errors.h>
+#include <utils/String16.h>
+#include <utils/Timers.h>
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+namespace android {
+
+/**
+ * Per interface and transaction code statistics of the binder calls this
+ * process makes and serves: call and failure counts, a latency histogram and
+ * parcel sizes.
+ *
+ * Collection is off by default. When it is on, every thread records into its
+ * own table, so recording only takes a lock nobody else holds, except while
+ * the tables are being merged for a dump.
+ */
+class BinderCallStats
+{
+public:
+    static constexpr size_t LATENCY_BUCKETS = 10;
+    // Upper bounds, in microseconds, of all but the last latency bucket, which
+    // collects everything slower.
+    static constexpr std::array<uint32_t, LATENCY_BUCKETS - 1> LATENCY_BUCKET_LIMITS_US = {
+            16, 64, 256, 1000, 4000, 16000, 64000, 256000, 1000000};
+
+    enum class Direction : uint8_t {
+        // Calls served by a local BBinder, keyed by interface descriptor.
+        INCOMING,
+        // Calls made through a BpBinder, keyed by handle. The descriptor
+        // can't be looked up while transacting without another call.
+        OUTGOING,
+    };
+
+    struct Entry {
+        Direction direction;
+        String16 descriptor;
+        int32_t handle;
+        uint32_t code;
+        uint64_t calls;
+        uint64_t failures;
+        uint64_t totalLatencyNs;
+        uint64_t maxLatencyNs;
+        uint64_t totalDataBytes;
+        uint64_t maxDataBytes;
+        uint64_t totalReplyBytes;
+        uint64_t maxReplyBytes;
+        std::array<uint64_t, LATENCY_BUCKETS> latencyHistogram;
+    };
+
+    // Commands carried by TRANSACTION_STATS_TRANSACTION.
+    enum Command : int32_t {
+        COMMAND_DUMP = 0,
+        COMMAND_ENABLE = 1,
+        COMMAND_DISABLE = 2,
+        COMMAND_RESET = 3,
+    };
+
+    static void             setEnabled(bool enabled);
+    static inline bool      isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    // Merges the tables of every thread, including threads that have exited.
+    static std::vector<Entry> getEntries();
+    static void             reset();
+    static void             dump(int fd);
+
+    // Sends command to the process hosting target. COMMAND_DUMP writes that
+    // process's statistics to fd.
+    static status_t         sendCommand(const sp<IBinder>& target, Command command, int fd);
+
+private:
+    friend class BBinder;
+    friend class BpBinder;
+
+    static status_t         onCommand(const Parcel& data);
+
+    static void             recordIncoming(const String16& descriptor, uint32_t code,
+                                           nsecs_t latency, size_t dataSize, size_t replySize,
+                                           status_t err);
+    static void             recordOutgoing(int32_t handle, uint32_t code, nsecs_t latency,
+                                           size_t dataSize, size_t replySize, status_t err);
+
+    static std::atomic_bool sEnabled;
+};
+
+}; // namespace android
+
+// ---------------------------------------------------------------------------
+
+#endif // ANDROID_BINDER_CALL_STATS_H
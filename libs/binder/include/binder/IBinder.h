@@ -59,6 +59,8 @@ public:
         SHELL_COMMAND_TRANSACTION = B_PACK_CHARS('_','C','M','D'),
         INTERFACE_TRANSACTION   = B_PACK_CHARS('_', 'N', 'T', 'F'),
         SYSPROPS_TRANSACTION    = B_PACK_CHARS('_', 'S', 'P', 'R'),
+        // Handled by BBinder on behalf of BinderCallStats
+        TRANSACTION_STATS_TRANSACTION = B_PACK_CHARS('_', 'T', 'S', 'T'),
 
         // Corresponds to TF_ONE_WAY -- an asynchronous call.
         FLAG_ONEWAY             = 0x00000001
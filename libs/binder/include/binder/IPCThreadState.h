@@ -22,6 +22,9 @@
 #include <binder/ProcessState.h>
 #include <utils/Vector.h>
 
+#include <memory>
+#include <vector>
+
 #if defined(_WIN32)
 typedef  int  uid_t;
 #endif
@@ -31,6 +34,9 @@ namespace android {
 
 class IPCThreadStateBase;
 
+class OnewayExecutor;
+struct OnewayTransaction;
+
 class IPCThreadState
 {
 public:
@@ -85,6 +91,16 @@ public:
                                          uint32_t code, const Parcel& data,
                                          Parcel* reply, uint32_t flags);
 
+            // Oneway transactions made on this thread between beginOnewayBatch()
+            // and the matching endOnewayBatch() are queued, and written to the
+            // driver together when the outermost batch ends or the queue fills
+            // up, rather than with one BINDER_WRITE_READ each. transact() returns
+            // NO_ERROR for a queued transaction, and endOnewayBatch() returns the
+            // first error among them. Other calls stay in order with the queued
+            // ones. Batches may nest.
+            void                beginOnewayBatch();
+            status_t            endOnewayBatch();
+
             void                incStrongHandle(int32_t handle, BpBinder *proxy);
             void                decStrongHandle(int32_t handle);
             void                incWeakHandle(int32_t handle, BpBinder *proxy);
@@ -145,6 +161,8 @@ public:
             static const int32_t kUnsetWorkSource = -1;
 
 private:
+    friend class OnewayExecutor;
+
                                 IPCThreadState();
                                 ~IPCThreadState();
 
@@ -158,6 +176,14 @@ private:
                                                      uint32_t code,
                                                      const Parcel& data,
                                                      status_t* statusBuffer);
+            status_t            queueOnewayTransaction(int32_t handle, uint32_t code,
+                                                       const Parcel& data, uint32_t flags);
+            void                flushOnewayBatch();
+            bool                offloadOnewayTransaction(BBinder* target,
+                                                         const binder_transaction_data& tr,
+                                                         const char* callingSid,
+                                                         const Parcel& data);
+            void                executeOffloadedTransaction(OnewayTransaction& txn);
             status_t            getAndExecuteCommand();
             status_t            executeCommand(int32_t command);
             void                processPendingDerefs();
@@ -166,6 +192,7 @@ private:
             void                clearCaller();
 
     static  void                threadDestructor(void *st);
+            void*               receivedBufferCookie(const binder_transaction_data& tr);
     static  void                freeBuffer(Parcel* parcel,
                                            const uint8_t* data, size_t dataSize,
                                            const binder_size_t* objects, size_t objectsSize,
@@ -192,6 +219,17 @@ private:
             IPCThreadStateBase  *mIPCThreadStateBase;
 
             ProcessState::CallRestriction mCallRestriction;
+
+            int                 mOnewayBatchDepth;
+            // Queued oneway transactions the driver has yet to complete. It
+            // completes transactions in order, so the first completions read
+            // are always theirs.
+            size_t              mPendingOnewayCount;
+            status_t            mOnewayBatchError;
+            // The driver reads a transaction's data when it is written, so the
+            // queued ones keep copies of theirs until then.
+            std::vector<std::unique_ptr<Parcel>> mOnewayBatchParcels;
+            size_t              mOnewayBatchBytes;
 };
 
 }; // namespace android
@@ -22,6 +22,8 @@
 #include <utils/Vector.h>
 #include <utils/String16.h>
 
+#include <stdint.h>
+
 namespace android {
 
 // ----------------------------------------------------------------------
@@ -77,6 +79,8 @@ public:
         CHECK_SERVICE_TRANSACTION,
         ADD_SERVICE_TRANSACTION,
         LIST_SERVICES_TRANSACTION,
+        // Asks servicemanager to call the given binder once a service is added
+        REGISTER_FOR_NOTIFICATIONS_TRANSACTION,
     };
 };
 
@@ -98,6 +102,16 @@ bool checkCallingPermission(const String16& permission,
                             int32_t* outPid, int32_t* outUid);
 bool checkPermission(const String16& permission, pid_t pid, uid_t uid);
 
+// How often this process's checkService() and getService() calls were answered
+// from its cache of live services instead of a call to the service manager.
+struct ServiceCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    // Entries dropped because their service died
+    uint64_t invalidations;
+};
+ServiceCacheStats getServiceCacheStats();
+
 }; // namespace android
 
 #endif // ANDROID_ISERVICE_MANAGER_H
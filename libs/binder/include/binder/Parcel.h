@@ -238,6 +238,12 @@ public:
     // as long as it keeps a dup of the blob file descriptor handy for later.
     status_t            writeDupImmutableBlobFileDescriptor(int fd);
 
+    // Writes the bytes as an immutable blob preceded by its size, so that large
+    // payloads travel in shared memory rather than through the binder buffer.
+    // Same format as android.os.Parcel#writeBlob(byte[]).
+    status_t            writeByteVectorAsBlob(const std::vector<uint8_t>& val);
+    status_t            writeByteVectorAsBlob(const std::unique_ptr<std::vector<uint8_t>>& val);
+
     status_t            writeObject(const flat_binder_object& val, bool nullMetaData);
 
     // Like Parcel.java's writeNoException().  Just writes a zero int32.
@@ -387,6 +393,14 @@ public:
     // The caller should call release() on the blob after reading its contents.
     status_t            readBlob(size_t len, ReadableBlob* outBlob) const;
 
+    // Reads what writeByteVectorAsBlob() wrote. readSizedBlob() leaves the bytes
+    // in place, mapped read-only if they came in shared memory, for callers that
+    // don't need a copy. The caller should call release() on the blob after
+    // reading its contents.
+    status_t            readSizedBlob(ReadableBlob* outBlob) const;
+    status_t            readByteVectorFromBlob(std::vector<uint8_t>* val) const;
+    status_t            readByteVectorFromBlob(std::unique_ptr<std::vector<uint8_t>>* val) const;
+
     const flat_binder_object* readObject(bool nullMetaData) const;
 
     // Explicitly close all file descriptors in the parcel.
@@ -22,41 +22,62 @@
 #include <stdint.h>
 #include <unistd.h>
 
+#include <string_view>
+#include <unordered_map>
+
 #include <utils/String16.h>
 #include <utils/Singleton.h>
-#include <utils/SortedVector.h>
+#include <utils/Timers.h>
 
 namespace android {
 // ---------------------------------------------------------------------------
 
 /*
- * PermissionCache caches permission checks for a given uid.
+ * PermissionCache caches permission checks for a given uid, both granted and
+ * denied, for a limited time.
  *
- * Currently the cache is not updated when there is a permission change,
- * for instance when an application is uninstalled.
+ * Denied results expire quickly, since runtime permissions can be granted at
+ * any time. Revoking a runtime permission kills the app, so once
+ * watchUidChanges() is called, a uid's results are also dropped when it goes
+ * away. Without that, granted results can outlive a revocation by up to
+ * GRANTED_TIMEOUT.
  *
- * IMPORTANT: for the reason stated above, only system permissions are safe
- * to cache. This restriction may be lifted at a later time.
+ * IMPORTANT: for the reasons stated above, system permissions remain the
+ * safest to cache.
  *
  */
 
 class PermissionCache : Singleton<PermissionCache> {
-    struct Entry {
+    struct Key {
         String16    name;
         uid_t       uid;
-        bool        granted;
-        inline bool operator < (const Entry& e) const {
-            return (uid == e.uid) ? (name < e.name) : (uid < e.uid);
+        inline bool operator == (const Key& k) const {
+            return uid == k.uid && name == k.name;
         }
     };
-    mutable Mutex mLock;
-    // we pool all the permission names we see, as many permissions checks
-    // will have identical names
-    SortedVector< String16 > mPermissionNamesPool;
-    // this is our cache per say. it stores pooled names.
-    SortedVector< Entry > mCache;
-
-    // free the whole cache, but keep the permission name pool
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<std::u16string_view>()(
+                    std::u16string_view(k.name.string(), k.name.size()));
+        }
+    };
+    struct Entry {
+        bool        granted;
+        nsecs_t     expires;
+    };
+    // Checks for different uids rarely contend: each uid's entries live in
+    // one shard, picked by uid.
+    struct Shard {
+        mutable Mutex lock;
+        std::unordered_map<Key, Entry, KeyHash> entries;
+    };
+    static const size_t SHARDS = 8;
+    Shard mShards[SHARDS];
+
+    Shard& shardFor(uid_t uid) { return mShards[uid % SHARDS]; }
+    const Shard& shardFor(uid_t uid) const { return mShards[uid % SHARDS]; }
+
+    // free the whole cache
     void purge();
 
     status_t check(bool* granted,
@@ -65,6 +86,9 @@ class PermissionCache : Singleton<PermissionCache> {
     void cache(const String16& permission, uid_t uid, bool granted);
 
 public:
+    static constexpr nsecs_t GRANTED_TIMEOUT = s2ns(10 * 60);
+    static constexpr nsecs_t DENIED_TIMEOUT = s2ns(5);
+
     PermissionCache();
 
     static bool checkCallingPermission(const String16& permission);
@@ -74,6 +98,14 @@ public:
 
     static bool checkPermission(const String16& permission,
             pid_t pid, uid_t uid);
+
+    // Drops the cached results of uid, or of every uid.
+    static void invalidate(uid_t uid);
+    static void invalidateAll();
+
+    // Asks ActivityManager to report uids going away, and invalidates them
+    // when it does. Needs a binder thread pool to receive the reports.
+    static void watchUidChanges(const String16& callingPackage);
 };
 
 // ---------------------------------------------------------------------------
@@ -109,7 +109,10 @@ public:
     }
 
 private:
+    status_t writeToParcelWithLength(Parcel* parcel) const;
     status_t writeToParcelInner(Parcel* parcel) const;
+    // Returns the number of bytes writeToParcelWithLength writes for this bundle.
+    size_t getParcelDataSize() const;
     status_t readFromParcelInner(const Parcel* parcel, size_t length);
 
     std::map<String16, bool> mBoolMap;
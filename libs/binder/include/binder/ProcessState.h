@@ -24,6 +24,8 @@
 
 #include <utils/threads.h>
 
+#include <array>
+#include <atomic>
 #include <pthread.h>
 
 // ---------------------------------------------------------------------------
@@ -44,6 +46,12 @@ public:
      * which are not.
      */
     static  sp<ProcessState>    initWithDriver(const char *driver);
+    /* Same as initWithDriver(driver), but maps mmapSize bytes of transaction
+     * buffer space instead of the default of about 1MB. Half of it is
+     * available to oneway transactions. The size is rounded up to whole
+     * pages, and the kernel caps it at 4MB.
+     */
+    static  sp<ProcessState>    initWithDriver(const char *driver, size_t mmapSize);
 
             void                setContextObject(const sp<IBinder>& object);
             sp<IBinder>         getContextObject(const sp<IBinder>& caller);
@@ -71,12 +79,41 @@ public:
             void                spawnPooledThread(bool isMain);
             
             status_t            setThreadPoolMaxThreadCount(size_t maxThreads);
+            // Lets threads the driver spawned leave the pool once it has had
+            // more threads than it needed for timeoutMs. The driver spawns new
+            // ones again when every thread is busy. 0, the default, keeps
+            // every thread for the life of the process.
+            void                setThreadPoolIdleTimeoutMs(int64_t timeoutMs);
             void                giveThreadPoolName();
 
             String8             getDriverName();
 
             ssize_t             getKernelReferences(size_t count, uintptr_t* buf);
 
+            // Size of the transaction buffer space mapped from the driver.
+            size_t              getMmapSize() const;
+
+            // Upper bounds of the transaction size histogram buckets, in bytes.
+            // The last bucket counts everything larger.
+            static constexpr size_t TRANSACTION_SIZE_BUCKET_LIMITS[] =
+                    {256, 1024, 4096, 16384, 65536, 262144};
+            static constexpr size_t TRANSACTION_SIZE_BUCKETS =
+                    sizeof(TRANSACTION_SIZE_BUCKET_LIMITS) / sizeof(size_t) + 1;
+
+            // Use of the mapped transaction buffer space, as far as this process
+            // can tell. Counts the transactions and replies it has received, by
+            // the size the driver allocated for them, until it frees them.
+            struct TransactionBufferStats {
+                size_t mmapSize;
+                size_t bytesInUse;
+                size_t peakBytesInUse;
+                size_t asyncBytesInUse;
+                size_t peakAsyncBytesInUse;
+                size_t largestTransaction;
+                std::array<uint64_t, TRANSACTION_SIZE_BUCKETS> sizeHistogram;
+            };
+            TransactionBufferStats getTransactionBufferStats() const;
+
             enum class CallRestriction {
                 // all calls okay
                 NONE,
@@ -92,7 +129,7 @@ public:
 private:
     friend class IPCThreadState;
     
-            explicit            ProcessState(const char* driver);
+                                ProcessState(const char* driver, size_t mmapSize);
                                 ~ProcessState();
 
                                 ProcessState(const ProcessState& o);
@@ -106,9 +143,28 @@ private:
 
             handle_entry*       lookupHandleLocked(int32_t handle);
 
+            // Called by a spawned thread of the pool between commands. Returns
+            // true if it should leave the pool.
+            bool                shouldRetirePooledThread();
+
+            // Called by IPCThreadState when it receives a buffer from the driver
+            // and when it frees one. Returns the bytes the buffer was counted for.
+            size_t              onBufferReceived(size_t dataSize, size_t offsetsSize,
+                                                 bool oneway);
+            void                onBufferFreed(size_t bytes, bool oneway);
+
             String8             mDriverName;
             int                 mDriverFD;
             void*               mVMStart;
+            size_t              mMmapSize;
+
+            std::atomic<size_t> mBufferBytesInUse;
+            std::atomic<size_t> mPeakBufferBytesInUse;
+            std::atomic<size_t> mAsyncBufferBytesInUse;
+            std::atomic<size_t> mPeakAsyncBufferBytesInUse;
+            std::atomic<size_t> mLargestTransaction;
+            std::array<std::atomic<uint64_t>, TRANSACTION_SIZE_BUCKETS>
+                                mTransactionSizeHistogram;
 
             // Protects thread count variable below.
             pthread_mutex_t     mThreadCountLock;
@@ -119,6 +175,15 @@ private:
             size_t              mMaxThreads;
             // Time when thread pool was emptied
             int64_t             mStarvationStartTimeMs;
+            // Number of threads in joinThreadPool().
+            size_t              mPoolThreadsCount;
+            // Most threads executing at once since mIdleWindowStartMs.
+            size_t              mPeakExecutingThreadsCount;
+            int64_t             mIdleWindowStartMs;
+            int64_t             mIdleTimeoutMs;
+            // The driver counts every thread it ever spawned against its
+            // limit, so the limit it has is raised by one per retired thread.
+            size_t              mRetiredThreadsCount;
 
     mutable Mutex               mLock;  // protects everything below.
 
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PRIVATE_BINDER_ONEWAY_EXECUTOR_H
+#define ANDROID_PRIVATE_BINDER_ONEWAY_EXECUTOR_H
+
+#include <binder/Binder.h>
+#include <binder/Parcel.h>
+#include <utils/threads.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+
+// A oneway transaction taken off the driver's buffer, so that the looper that
+// read it can free the buffer and go back for more work.
+struct OnewayTransaction {
+    sp<BBinder> target;
+    uint32_t code;
+    uint32_t flags;
+    std::unique_ptr<Parcel> data;
+    pid_t callingPid;
+    uid_t callingUid;
+    bool hasCallingSid;
+    std::string callingSid;
+};
+
+// Runs the oneway transactions of BBinders that asked for it on a small pool
+// of threads that are not binder loopers.
+//
+// Each node's transactions still run one at a time, in the order they were
+// received, as the driver would have delivered them. Idle workers pick up
+// whichever node has work next, so one busy node doesn't hold up the others.
+class OnewayExecutor
+{
+public:
+    static OnewayExecutor& self();
+
+    // Queues txn, or hands it back in txn if it should run inline on the
+    // calling looper instead. Blocks while the queue is full and the target
+    // already has queued work, since running it inline would reorder it.
+    // Returns true if txn was queued.
+    bool enqueue(std::unique_ptr<OnewayTransaction>& txn);
+
+private:
+    static const size_t kWorkerThreads = 2;
+    // Bounds the memory held by queued transactions, like the driver bounds
+    // the async half of the mapped buffer.
+    static const size_t kMaxQueuedBytes = 512 * 1024;
+
+    class Worker;
+
+    struct Node {
+        std::deque<std::unique_ptr<OnewayTransaction>> pending;
+        // Queued in mReady, or its transaction is running
+        bool scheduled = false;
+    };
+
+    OnewayExecutor() = default;
+
+    void startWorkersLocked();
+    // Runs one transaction, waiting for one if there is none.
+    void runOne();
+
+    std::mutex mLock;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mSpaceAvailable;
+    std::unordered_map<BBinder*, Node> mNodes;
+    std::deque<BBinder*> mReady;
+    size_t mQueuedBytes = 0;
+    std::vector<sp<Thread>> mWorkers;
+};
+
+} // namespace android
+
+#endif // ANDROID_PRIVATE_BINDER_ONEWAY_EXECUTOR_H
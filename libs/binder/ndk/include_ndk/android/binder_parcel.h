@@ -1015,6 +1015,40 @@ binder_status_t AParcel_readByteArray(const AParcel* parcel, void* arrayData,
 // @END-PRIMITIVE-READ-WRITE
 
 #endif  //__ANDROID_API__ >= __ANDROID_API_Q__
+
+#if __ANDROID_API__ >= 30
+
+/**
+ * Writes count int32_t values to the next location in a non-null parcel, with no length in front
+ * of them. This is laid out like count calls to AParcel_writeInt32, but crosses into this library
+ * once. Every primitive type takes up one or two int32_t values in a parcel, so this can also write
+ * a run of mixed primitive fields; see AParcel_writePrimitives in binder_parcel_utils.h.
+ *
+ * \param parcel the parcel to write to.
+ * \param values an array of size 'count' (may be null if count is 0).
+ * \param count the number of values to write.
+ *
+ * \return STATUS_OK on successful write.
+ */
+binder_status_t AParcel_writeInt32Values(AParcel* parcel, const int32_t* values, int32_t count)
+        __INTRODUCED_IN(30);
+
+/**
+ * Reads count int32_t values, with no length in front of them, from the next location in a non-null
+ * parcel. This is the counterpart of AParcel_writeInt32Values. Either all of the values are read,
+ * or, if the parcel doesn't hold that many, none of them are.
+ *
+ * \param parcel the parcel to read from.
+ * \param values an array of size 'count' to read into (may be null if count is 0).
+ * \param count the number of values to read.
+ *
+ * \return STATUS_OK on successful read.
+ */
+binder_status_t AParcel_readInt32Values(const AParcel* parcel, int32_t* values, int32_t count)
+        __INTRODUCED_IN(30);
+
+#endif  //__ANDROID_API__ >= 30
+
 __END_DECLS
 
 /** @} */
@@ -29,8 +29,11 @@
 #include <android/binder_auto_utils.h>
 #include <android/binder_parcel.h>
 
+#include <string.h>
+
 #include <optional>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace ndk {
@@ -832,6 +835,93 @@ static inline binder_status_t AParcel_resizeVector(const AParcel* parcel,
     return STATUS_OK;
 }
 
+/**
+ * Whether T is one of the primitive types AParcel_writePrimitives and AParcel_readPrimitives take.
+ */
+template <typename T>
+struct AParcel_isPrimitive
+    : std::integral_constant<
+              bool, std::is_same<T, int32_t>::value || std::is_same<T, uint32_t>::value ||
+                            std::is_same<T, int64_t>::value || std::is_same<T, uint64_t>::value ||
+                            std::is_same<T, float>::value || std::is_same<T, double>::value ||
+                            std::is_same<T, bool>::value || std::is_same<T, char16_t>::value ||
+                            std::is_same<T, int8_t>::value> {};
+
+/**
+ * The number of int32_t values the primitive T takes up in a parcel. Types narrower than int32_t
+ * are widened to one.
+ */
+template <typename T>
+static constexpr int32_t AParcel_primitiveValueCount() {
+    static_assert(AParcel_isPrimitive<T>::value, "not a parcelable primitive");
+    return sizeof(T) <= sizeof(int32_t) ? 1 : sizeof(T) / sizeof(int32_t);
+}
+
+/**
+ * Lays value out in out the way the AParcel_write* function for T would, and returns the next
+ * location of out.
+ */
+template <typename T>
+static inline int32_t* AParcel_packPrimitive(int32_t* out, T value) {
+    if constexpr (sizeof(T) < sizeof(int32_t)) {
+        *out = static_cast<int32_t>(value);
+    } else {
+        memcpy(out, &value, sizeof(T));
+    }
+    return out + AParcel_primitiveValueCount<T>();
+}
+
+/**
+ * Reads value from in the way the AParcel_read* function for T would, and returns the next location
+ * of in.
+ */
+template <typename T>
+static inline const int32_t* AParcel_unpackPrimitive(const int32_t* in, T* value) {
+    if constexpr (std::is_same<T, bool>::value) {
+        *value = *in != 0;
+    } else if constexpr (sizeof(T) < sizeof(int32_t)) {
+        *value = static_cast<T>(*in);
+    } else {
+        memcpy(value, in, sizeof(T));
+    }
+    return in + AParcel_primitiveValueCount<T>();
+}
+
+#if __ANDROID_API__ >= 30
+
+/**
+ * Writes a run of primitive fields, such as those of a parcelable, with one call into the library.
+ * This is laid out exactly like calling the AParcel_write* function of each value in turn.
+ */
+template <typename... T>
+static inline binder_status_t AParcel_writePrimitives(AParcel* parcel, T... values) {
+    static_assert(sizeof...(T) > 0, "no values");
+    constexpr int32_t kCount = (AParcel_primitiveValueCount<T>() + ...);
+    int32_t buffer[kCount];
+    int32_t* out = buffer;
+    ((out = AParcel_packPrimitive(out, values)), ...);
+    return AParcel_writeInt32Values(parcel, buffer, kCount);
+}
+
+/**
+ * Reads a run of primitive fields written by AParcel_writePrimitives, or by the AParcel_write*
+ * function of each, with one call into the library. On failure, none of values are changed.
+ */
+template <typename... T>
+static inline binder_status_t AParcel_readPrimitives(const AParcel* parcel, T*... values) {
+    static_assert(sizeof...(T) > 0, "no values");
+    constexpr int32_t kCount = (AParcel_primitiveValueCount<T>() + ...);
+    int32_t buffer[kCount];
+    binder_status_t status = AParcel_readInt32Values(parcel, buffer, kCount);
+    if (status != STATUS_OK) return status;
+
+    const int32_t* in = buffer;
+    ((in = AParcel_unpackPrimitive(in, values)), ...);
+    return STATUS_OK;
+}
+
+#endif  //__ANDROID_API__ >= 30
+
 }  // namespace ndk
 
 /** @} */
@@ -651,3 +651,38 @@ binder_status_t AParcel_readByteArray(const AParcel* parcel, void* arrayData,
 }
 
 // @END
+
+binder_status_t AParcel_writeInt32Values(AParcel* parcel, const int32_t* values, int32_t count) {
+    if (count < 0) return STATUS_BAD_VALUE;
+    if (count == 0) return STATUS_OK;
+    if (values == nullptr) return STATUS_UNEXPECTED_NULL;
+
+    int32_t size = 0;
+    if (__builtin_smul_overflow(sizeof(int32_t), count, &size)) return STATUS_NO_MEMORY;
+
+    void* const data = parcel->get()->writeInplace(size);
+    if (data == nullptr) return STATUS_NO_MEMORY;
+
+    memcpy(data, values, size);
+
+    return STATUS_OK;
+}
+
+binder_status_t AParcel_readInt32Values(const AParcel* parcel, int32_t* values, int32_t count) {
+    if (count < 0) return STATUS_BAD_VALUE;
+    if (count == 0) return STATUS_OK;
+    if (values == nullptr) return STATUS_UNEXPECTED_NULL;
+
+    int32_t size = 0;
+    if (__builtin_smul_overflow(sizeof(int32_t), count, &size)) return STATUS_NO_MEMORY;
+
+    const Parcel* rawParcel = parcel->get();
+    if (rawParcel->dataAvail() < static_cast<size_t>(size)) return STATUS_NOT_ENOUGH_DATA;
+
+    const void* data = rawParcel->readInplace(size);
+    if (data == nullptr) return STATUS_BAD_VALUE;
+
+    memcpy(values, data, size);
+
+    return STATUS_OK;
+}
@@ -70,7 +70,7 @@ void AStatus_delete(AStatus* status) {
     delete status;
 }
 
-binder_status_t PruneStatusT(status_t status) {
+binder_status_t PruneErrorStatusT(status_t status) {
     switch (status) {
         case ::android::OK:
             return STATUS_OK;
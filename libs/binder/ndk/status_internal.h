@@ -32,8 +32,15 @@ struct AStatus {
     ::android::binder::Status mStatus;
 };
 
-// This collapses the statuses into the declared range.
-binder_status_t PruneStatusT(android::status_t status);
+// PruneStatusT, for statuses other than OK.
+binder_status_t PruneErrorStatusT(android::status_t status);
+
+// This collapses the statuses into the declared range. It is inline so that the success path of
+// every AParcel call doesn't pay for another call.
+inline binder_status_t PruneStatusT(android::status_t status) {
+    if (status == ::android::OK) return STATUS_OK;
+    return PruneErrorStatusT(status);
+}
 
 // This collapses the exception into the declared range.
 binder_exception_t PruneException(int32_t exception);
@@ -17,6 +17,7 @@
 #include <android-base/logging.h>
 #include <android/binder_ibinder_jni.h>
 #include <android/binder_manager.h>
+#include <android/binder_parcel_utils.h>
 #include <android/binder_process.h>
 #include <gtest/gtest.h>
 #include <iface/iface.h>
@@ -196,6 +197,61 @@ TEST(NdkBinder, AddServiceMultipleTimes) {
     EXPECT_EQ(IFoo::getService(kInstanceName1), IFoo::getService(kInstanceName2));
 }
 
+TEST(NdkBinder, ParcelPrimitivesMatchSingleWrites) {
+    static const char* kInstanceName = "test-parcel-primitives";
+    sp<IFoo> foo = new MyTestFoo;
+    ASSERT_EQ(STATUS_OK, foo->addService(kInstanceName));
+
+    AIBinder* binder = nullptr;
+    ASSERT_NE(nullptr, IFoo::getService(kInstanceName, &binder));
+    AParcel* parcel = nullptr;
+    ASSERT_EQ(STATUS_OK, AIBinder_prepareTransaction(binder, &parcel));
+    const int32_t start = AParcel_getDataPosition(parcel);
+
+    EXPECT_EQ(STATUS_OK, ndk::AParcel_writePrimitives(parcel, int32_t(-5), int64_t(1) << 40, true,
+                                                      char16_t(u'\xffff'), int8_t(-3), 1.5f, 2.25));
+
+    int32_t i32;
+    int64_t i64;
+    bool b;
+    char16_t c;
+    int8_t i8;
+    float f;
+    double d;
+    EXPECT_EQ(STATUS_OK, AParcel_setDataPosition(parcel, start));
+    EXPECT_EQ(STATUS_OK, AParcel_readInt32(parcel, &i32));
+    EXPECT_EQ(STATUS_OK, AParcel_readInt64(parcel, &i64));
+    EXPECT_EQ(STATUS_OK, AParcel_readBool(parcel, &b));
+    EXPECT_EQ(STATUS_OK, AParcel_readChar(parcel, &c));
+    EXPECT_EQ(STATUS_OK, AParcel_readByte(parcel, &i8));
+    EXPECT_EQ(STATUS_OK, AParcel_readFloat(parcel, &f));
+    EXPECT_EQ(STATUS_OK, AParcel_readDouble(parcel, &d));
+    EXPECT_EQ(-5, i32);
+    EXPECT_EQ(int64_t(1) << 40, i64);
+    EXPECT_TRUE(b);
+    EXPECT_EQ(u'\xffff', c);
+    EXPECT_EQ(-3, i8);
+    EXPECT_EQ(1.5f, f);
+    EXPECT_EQ(2.25, d);
+
+    i32 = 0;
+    i64 = 0;
+    EXPECT_EQ(STATUS_OK, AParcel_setDataPosition(parcel, start));
+    EXPECT_EQ(STATUS_OK, ndk::AParcel_readPrimitives(parcel, &i32, &i64, &b, &c, &i8, &f, &d));
+    EXPECT_EQ(-5, i32);
+    EXPECT_EQ(int64_t(1) << 40, i64);
+    EXPECT_EQ(-3, i8);
+    EXPECT_EQ(2.25, d);
+
+    // Nothing is left to read, so nothing is read.
+    const int32_t end = AParcel_getDataPosition(parcel);
+    EXPECT_EQ(STATUS_NOT_ENOUGH_DATA, ndk::AParcel_readPrimitives(parcel, &i32));
+    EXPECT_EQ(end, AParcel_getDataPosition(parcel));
+
+    AParcel_delete(parcel);
+    AIBinder_decStrong(binder);
+}
+
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
 
@@ -20,10 +20,12 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <gtest/gtest.h>
 
 #include <binder/Binder.h>
+#include <binder/BinderCallStats.h>
 #include <binder/IBinder.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
@@ -73,6 +75,7 @@ enum BinderLibTestTranscationCode {
     BINDER_LIB_TEST_CREATE_BINDER_TRANSACTION,
     BINDER_LIB_TEST_GET_WORK_SOURCE_TRANSACTION,
     BINDER_LIB_TEST_ECHO_VECTOR,
+    BINDER_LIB_TEST_CREATE_OFFLOADED_BINDER_TRANSACTION,
 };
 
 pid_t start_server_process(int arg2, bool usePoll = false)
@@ -314,6 +317,50 @@ class BinderLibTestEvent
         pthread_t m_triggeringThread;
 };
 
+// Checks that the oneway calls it gets arrive in order, on the oneway
+// executor's threads.
+class BinderLibTestOffloadedService : public BBinder, public BinderLibTestEvent
+{
+    public:
+        explicit BinderLibTestOffloadedService(int32_t expectedCalls)
+            : m_expectedCalls(expectedCalls)
+            , m_calls(0)
+            , m_errors(0)
+        {
+            setOnewayOffloaded(true);
+        }
+        virtual status_t onTransact(uint32_t code,
+                                    const Parcel& data, Parcel* reply,
+                                    uint32_t flags = 0) {
+            switch (code) {
+            case BINDER_LIB_TEST_NOP_TRANSACTION: {
+                char name[16] = {};
+                pthread_getname_np(pthread_self(), name, sizeof(name));
+                if ((flags & TF_ONE_WAY) == 0 || data.readInt32() != m_calls ||
+                        strncmp(name, "binder:oneway_", strlen("binder:oneway_")) != 0) {
+                    m_errors++;
+                }
+                // Gives the next calls time to queue up behind this one
+                usleep(1000);
+                if (++m_calls == m_expectedCalls) {
+                    triggerEvent();
+                }
+                return NO_ERROR;
+            }
+            case BINDER_LIB_TEST_GET_STATUS_TRANSACTION:
+                reply->writeInt32(waitEvent(5));
+                reply->writeInt32(m_errors);
+                return NO_ERROR;
+            default:
+                return UNKNOWN_TRANSACTION;
+            }
+        }
+    private:
+        const int32_t m_expectedCalls;
+        int32_t m_calls;
+        int32_t m_errors;
+};
+
 class BinderLibTestCallBack : public BBinder, public BinderLibTestEvent
 {
     public:
@@ -941,6 +988,40 @@ TEST_F(BinderLibTest, OnewayQueueing)
     EXPECT_EQ(NO_ERROR, ret);
 }
 
+TEST_F(BinderLibTest, OnewayBatch)
+{
+    status_t ret;
+    sp<IBinder> pollServer = addPollServer();
+
+    std::vector<sp<BinderLibTestCallBack>> callBacks;
+    IPCThreadState::self()->beginOnewayBatch();
+    // More than fit in one write, so the batch is flushed on the way
+    for (int i = 0; i < 40; i++) {
+        Parcel data;
+        sp<BinderLibTestCallBack> callBack = new BinderLibTestCallBack();
+        data.writeStrongBinder(callBack);
+        data.writeInt32(0); // delay in us
+        ret = pollServer->transact(BINDER_LIB_TEST_DELAYED_CALL_BACK, data, nullptr, TF_ONE_WAY);
+        EXPECT_EQ(NO_ERROR, ret);
+        callBacks.push_back(callBack);
+    }
+    // A call that waits for its reply in the middle of the batch
+    {
+        Parcel data, reply;
+        ret = m_server->transact(BINDER_LIB_TEST_NOP_TRANSACTION, data, &reply);
+        EXPECT_EQ(NO_ERROR, ret);
+    }
+    EXPECT_EQ(NO_ERROR, IPCThreadState::self()->endOnewayBatch());
+
+    for (const sp<BinderLibTestCallBack>& callBack : callBacks) {
+        ret = callBack->waitEvent(5);
+        EXPECT_EQ(NO_ERROR, ret);
+        ret = callBack->getResult();
+        EXPECT_EQ(NO_ERROR, ret);
+    }
+    EXPECT_EQ(INVALID_OPERATION, IPCThreadState::self()->endOnewayBatch());
+}
+
 TEST_F(BinderLibTest, WorkSourceUnsetByDefault)
 {
     status_t ret;
@@ -1076,6 +1157,222 @@ TEST_F(BinderLibTest, VectorSent) {
     EXPECT_EQ(readValue, testValue);
 }
 
+TEST_F(BinderLibTest, ParcelReusesFreedBuffer) {
+    const uint8_t* freedData;
+    {
+        Parcel parcel;
+        parcel.writeInt32(1);
+        freedData = parcel.data();
+    }
+    Parcel parcel;
+    parcel.writeInt32(2);
+    EXPECT_EQ(freedData, parcel.data());
+}
+
+TEST_F(BinderLibTest, ParcelGrowsPastReusedBuffer) {
+    {
+        Parcel parcel;
+        parcel.writeInt32(1);
+    }
+    Parcel parcel;
+    for (int32_t i = 0; i < 1000; i++) {
+        ASSERT_EQ(NO_ERROR, parcel.writeInt32(i));
+    }
+    parcel.setDataPosition(0);
+    for (int32_t i = 0; i < 1000; i++) {
+        ASSERT_EQ(i, parcel.readInt32());
+    }
+}
+
+TEST_F(BinderLibTest, ByteVectorAsBlob) {
+    const std::vector<uint8_t> small(16, 0x5a);
+    std::vector<uint8_t> large(256 * 1024);
+    for (size_t i = 0; i < large.size(); i++) {
+        large[i] = i & 0xff;
+    }
+    Parcel parcel;
+    EXPECT_EQ(NO_ERROR, parcel.writeByteVectorAsBlob(small));
+    EXPECT_EQ(NO_ERROR, parcel.writeByteVectorAsBlob(large));
+    EXPECT_EQ(NO_ERROR, parcel.writeByteVectorAsBlob(std::unique_ptr<std::vector<uint8_t>>()));
+    // The large vector went into shared memory
+    EXPECT_LT(parcel.dataSize(), 1024u);
+
+    parcel.setDataPosition(0);
+    std::vector<uint8_t> readSmall;
+    EXPECT_EQ(NO_ERROR, parcel.readByteVectorFromBlob(&readSmall));
+    EXPECT_EQ(small, readSmall);
+    Parcel::ReadableBlob blob;
+    ASSERT_EQ(NO_ERROR, parcel.readSizedBlob(&blob));
+    ASSERT_EQ(large.size(), blob.size());
+    EXPECT_GE(blob.fd(), 0);
+    EXPECT_EQ(0, memcmp(large.data(), blob.data(), large.size()));
+    blob.release();
+    std::unique_ptr<std::vector<uint8_t>> readNull(new std::vector<uint8_t>());
+    EXPECT_EQ(NO_ERROR, parcel.readByteVectorFromBlob(&readNull));
+    EXPECT_EQ(nullptr, readNull);
+}
+
+TEST_F(BinderLibTest, EnforceInterfaceToken) {
+    const String16 descriptor("android.binder.test.IToken");
+    Parcel data;
+    ASSERT_EQ(NO_ERROR, data.writeInterfaceToken(descriptor));
+    data.setDataPosition(0);
+    EXPECT_TRUE(data.enforceInterface(descriptor));
+
+    data.setDataPosition(0);
+    EXPECT_FALSE(data.enforceInterface(String16("android.binder.test.ITokem")));
+    data.setDataPosition(0);
+    EXPECT_FALSE(data.enforceInterface(String16("android.binder.test.ITokens")));
+
+    // A header the sender cut short, read one field at a time
+    Parcel truncated;
+    truncated.writeInt32(0);
+    truncated.setDataPosition(0);
+    EXPECT_FALSE(truncated.enforceInterface(descriptor));
+}
+
+TEST_F(BinderLibTest, TransactionBufferStats) {
+    auto histogramTotal = [](const ProcessState::TransactionBufferStats& stats) {
+        uint64_t total = 0;
+        for (uint64_t count : stats.sizeHistogram) {
+            total += count;
+        }
+        return total;
+    };
+    const ProcessState::TransactionBufferStats before =
+            ProcessState::self()->getTransactionBufferStats();
+    EXPECT_EQ(ProcessState::self()->getMmapSize(), before.mmapSize);
+    EXPECT_GT(before.mmapSize, 0u);
+
+    {
+        Parcel data, reply;
+        status_t ret = m_server->transact(BINDER_LIB_TEST_GET_ID_TRANSACTION, data, &reply);
+        EXPECT_EQ(NO_ERROR, ret);
+
+        // The reply holds its buffer until it is destroyed
+        const ProcessState::TransactionBufferStats during =
+                ProcessState::self()->getTransactionBufferStats();
+        EXPECT_EQ(before.bytesInUse + 8, during.bytesInUse);
+        EXPECT_GE(during.peakBytesInUse, during.bytesInUse);
+        EXPECT_GE(during.largestTransaction, 8u);
+        EXPECT_EQ(histogramTotal(before) + 1, histogramTotal(during));
+        EXPECT_EQ(before.sizeHistogram[0] + 1, during.sizeHistogram[0]);
+    }
+
+    const ProcessState::TransactionBufferStats after =
+            ProcessState::self()->getTransactionBufferStats();
+    EXPECT_EQ(before.bytesInUse, after.bytesInUse);
+    EXPECT_EQ(before.asyncBytesInUse, after.asyncBytesInUse);
+}
+
+TEST_F(BinderLibTest, ServiceCache) {
+    sp<IServiceManager> sm = defaultServiceManager();
+    sp<IBinder> first = sm->checkService(binderLibTestServiceName);
+    ASSERT_TRUE(first != nullptr);
+
+    const ServiceCacheStats before = getServiceCacheStats();
+    sp<IBinder> second = sm->checkService(binderLibTestServiceName);
+    const ServiceCacheStats after = getServiceCacheStats();
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(before.hits + 1, after.hits);
+    EXPECT_EQ(before.misses, after.misses);
+
+    EXPECT_TRUE(sm->checkService(String16("test.binderLib.missing")) == nullptr);
+    EXPECT_EQ(after.misses + 1, getServiceCacheStats().misses);
+}
+
+TEST_F(BinderLibTest, OnewayOffload) {
+    const int32_t calls = 50;
+    sp<IBinder> offloaded;
+    {
+        Parcel data, reply;
+        data.writeInt32(calls);
+        EXPECT_EQ(NO_ERROR, m_server->transact(BINDER_LIB_TEST_CREATE_OFFLOADED_BINDER_TRANSACTION,
+                                               data, &reply));
+        offloaded = reply.readStrongBinder();
+        ASSERT_TRUE(offloaded != nullptr);
+    }
+
+    for (int32_t i = 0; i < calls; i++) {
+        Parcel data, reply;
+        data.writeInt32(i);
+        EXPECT_EQ(NO_ERROR,
+                  offloaded->transact(BINDER_LIB_TEST_NOP_TRANSACTION, data, &reply, TF_ONE_WAY));
+    }
+
+    Parcel data, reply;
+    EXPECT_EQ(NO_ERROR, offloaded->transact(BINDER_LIB_TEST_GET_STATUS_TRANSACTION, data, &reply));
+    EXPECT_EQ(NO_ERROR, reply.readInt32());
+    EXPECT_EQ(0, reply.readInt32());
+}
+
+TEST_F(BinderLibTest, BinderCallStats) {
+    auto findEntry = [](BinderCallStats::Direction direction, int32_t handle, uint32_t code) {
+        for (const BinderCallStats::Entry& entry : BinderCallStats::getEntries()) {
+            if (entry.direction == direction && entry.handle == handle && entry.code == code) {
+                return entry;
+            }
+        }
+        return BinderCallStats::Entry{};
+    };
+    const int32_t handle = m_server->remoteBinder()->handle();
+
+    BinderCallStats::reset();
+    {
+        // Not collected until enabled
+        Parcel data, reply;
+        EXPECT_EQ(NO_ERROR, m_server->transact(BINDER_LIB_TEST_GET_ID_TRANSACTION, data, &reply));
+    }
+    EXPECT_EQ(0u, findEntry(BinderCallStats::Direction::OUTGOING, handle,
+                            BINDER_LIB_TEST_GET_ID_TRANSACTION).calls);
+
+    BinderCallStats::setEnabled(true);
+    for (int i = 0; i < 2; i++) {
+        Parcel data, reply;
+        data.writeInt32(i);
+        EXPECT_EQ(NO_ERROR, m_server->transact(BINDER_LIB_TEST_GET_ID_TRANSACTION, data, &reply));
+    }
+    sp<BBinder> local = new BBinder();
+    {
+        Parcel data, reply;
+        EXPECT_EQ(NO_ERROR, local->transact(IBinder::PING_TRANSACTION, data, &reply));
+    }
+    BinderCallStats::setEnabled(false);
+
+    const BinderCallStats::Entry outgoing = findEntry(BinderCallStats::Direction::OUTGOING,
+                                                      handle, BINDER_LIB_TEST_GET_ID_TRANSACTION);
+    EXPECT_EQ(2u, outgoing.calls);
+    EXPECT_EQ(0u, outgoing.failures);
+    EXPECT_EQ(8u, outgoing.totalDataBytes);
+    EXPECT_EQ(4u, outgoing.maxDataBytes);
+    EXPECT_EQ(4u, outgoing.maxReplyBytes);
+    EXPECT_GT(outgoing.maxLatencyNs, 0u);
+    uint64_t histogramTotal = 0;
+    for (uint64_t count : outgoing.latencyHistogram) {
+        histogramTotal += count;
+    }
+    EXPECT_EQ(2u, histogramTotal);
+
+    const BinderCallStats::Entry incoming =
+            findEntry(BinderCallStats::Direction::INCOMING, 0, IBinder::PING_TRANSACTION);
+    EXPECT_EQ(1u, incoming.calls);
+    EXPECT_EQ(4u, incoming.totalReplyBytes);
+
+    int pipefd[2];
+    ASSERT_EQ(0, pipe2(pipefd, O_NONBLOCK));
+    EXPECT_EQ(NO_ERROR,
+              BinderCallStats::sendCommand(local, BinderCallStats::COMMAND_DUMP, pipefd[1]));
+    char buf[4096] = {};
+    EXPECT_GT(read(pipefd[0], buf, sizeof(buf) - 1), 0);
+    EXPECT_NE(nullptr, strstr(buf, " code 1599098439: calls=1 failures=0"));
+    close(pipefd[0]);
+    close(pipefd[1]);
+
+    BinderCallStats::reset();
+    EXPECT_EQ(0u, findEntry(BinderCallStats::Direction::OUTGOING, handle,
+                            BINDER_LIB_TEST_GET_ID_TRANSACTION).calls);
+}
+
 class BinderLibTestService : public BBinder
 {
     public:
@@ -1374,6 +1671,11 @@ class BinderLibTestService : public BBinder
                 }
                 return NO_ERROR;
             }
+            case BINDER_LIB_TEST_CREATE_OFFLOADED_BINDER_TRANSACTION: {
+                sp<IBinder> binder = new BinderLibTestOffloadedService(data.readInt32());
+                reply->writeStrongBinder(binder);
+                return NO_ERROR;
+            }
             case BINDER_LIB_TEST_GET_WORK_SOURCE_TRANSACTION: {
                 data.enforceInterface(binderLibTestServiceName);
                 reply->writeInt32(IPCThreadState::self()->getCallingWorkSourceUid());
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <binder/MemoryDealer.h>
+
+#include <random>
+#include <vector>
+
+namespace android {
+namespace {
+
+constexpr size_t kHeapSize = 4 * 1024 * 1024;
+
+// The small regions media and audio clients carve out of a shared heap.
+size_t randomSize(std::mt19937& rng) {
+    return 32 + rng() % 2048;
+}
+
+// Fills the heap with state.range(0) live allocations, then measures replacing
+// a random one of them. The cost of the old allocator grew with the number of
+// chunks on the heap, so run this against a build without the size class free
+// lists to compare the two.
+void BM_MemoryDealerReplace(benchmark::State& state) {
+    sp<MemoryDealer> dealer = new MemoryDealer(kHeapSize, "BM_MemoryDealerReplace");
+    std::mt19937 rng(42);
+    std::vector<sp<IMemory>> live(state.range(0));
+    for (auto& memory : live) {
+        memory = dealer->allocate(randomSize(rng));
+    }
+
+    for (auto _ : state) {
+        sp<IMemory>& victim = live[rng() % live.size()];
+        victim.clear();
+        victim = dealer->allocate(randomSize(rng));
+        benchmark::DoNotOptimize(victim.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MemoryDealerReplace)->Arg(16)->Arg(256)->Arg(2048);
+
+// Allocates and frees one region on an otherwise empty heap: the best case,
+// where both allocators only ever look at one chunk.
+void BM_MemoryDealerAllocateFree(benchmark::State& state) {
+    sp<MemoryDealer> dealer = new MemoryDealer(kHeapSize, "BM_MemoryDealerAllocateFree");
+    for (auto _ : state) {
+        sp<IMemory> memory = dealer->allocate(state.range(0));
+        benchmark::DoNotOptimize(memory.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MemoryDealerAllocateFree)->Arg(256)->Arg(64 * 1024);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
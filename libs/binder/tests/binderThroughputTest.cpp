@@ -6,11 +6,19 @@
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
+#include <cinttypes>
 
+#include <algorithm>
+#include <chrono>
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
 #include <vector>
 #include <tuple>
 
+#include <sched.h>
 #include <unistd.h>
 #include <sys/wait.h>
 
@@ -19,8 +27,12 @@ using namespace android;
 
 enum BinderWorkerServiceCode {
     BINDER_NOP = IBinder::FIRST_CALL_TRANSACTION,
+    BINDER_STRINGS,
 };
 
+static const String16 kWorkerInterface("android.binder.IBinderWorker");
+static const string kWorkerPackage("com.android.binder.throughput");
+
 #define ASSERT_TRUE(cond) \
 do { \
     if (!(cond)) {\
@@ -43,6 +55,17 @@ public:
         switch (code) {
         case BINDER_NOP:
             return NO_ERROR;
+        case BINDER_STRINGS: {
+            if (!data.enforceInterface(kWorkerInterface)) {
+                return PERMISSION_DENIED;
+            }
+            string package;
+            status_t ret = data.readUtf8FromUtf16(&package);
+            if (ret != NO_ERROR) {
+                return ret;
+            }
+            return reply->writeUtf8AsUtf16(package);
+        }
         default:
             return UNKNOWN_TRANSACTION;
         };
@@ -79,13 +102,26 @@ public:
         int error = read(m_readFd, &val, sizeof(val));
         ASSERT_TRUE(error >= 0);
     }
+    // Results can be larger than PIPE_BUF, so they may take several reads and writes.
     template <typename T> void send(const T& v) {
-        int error = write(m_writeFd, &v, sizeof(T));
-        ASSERT_TRUE(error >= 0);
+        const char* in = reinterpret_cast<const char*>(&v);
+        size_t left = sizeof(T);
+        while (left > 0) {
+            int written = write(m_writeFd, in, left);
+            ASSERT_TRUE(written > 0);
+            in += written;
+            left -= written;
+        }
     }
     template <typename T> void recv(T& v) {
-        int error = read(m_readFd, &v, sizeof(T));
-        ASSERT_TRUE(error >= 0);
+        char* out = reinterpret_cast<char*>(&v);
+        size_t left = sizeof(T);
+        while (left > 0) {
+            int received = read(m_readFd, out, left);
+            ASSERT_TRUE(received > 0);
+            out += received;
+            left -= received;
+        }
     }
     static tuple<Pipe, Pipe> createPipePair() {
         int a[2];
@@ -168,6 +204,192 @@ struct ProcResults {
     }
 };
 
+// Latencies on a log-linear scale, so that p99.9 is as precise as p50: each power of two of
+// nanoseconds is split into kSubBuckets buckets, which keeps every value within 1/kSubBuckets.
+struct LatencyHistogram {
+    static const uint32_t kSubBucketBits = 5;
+    static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+    // Up to 2^kMaxBits ns, about 18 minutes
+    static const uint32_t kMaxBits = 40;
+    static const uint32_t kBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+    uint64_t m_buckets[kBuckets] = {0};
+    uint64_t m_calls = 0;
+    uint64_t m_failures = 0;
+    uint64_t m_worst = 0;
+
+    static uint32_t bucket_for(uint64_t time) {
+        time = min<uint64_t>(time, (1ull << kMaxBits) - 1);
+        if (time < kSubBuckets) {
+            return time;
+        }
+        uint32_t msb = 63 - __builtin_clzll(time);
+        uint32_t shift = msb - kSubBucketBits;
+        return (shift + 1) * kSubBuckets + (time >> shift) - kSubBuckets;
+    }
+    // The middle of the range of times that fall in bucket.
+    static uint64_t time_for(uint32_t bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        uint32_t shift = bucket / kSubBuckets - 1;
+        uint64_t low = uint64_t(kSubBuckets + bucket % kSubBuckets) << shift;
+        return low + ((1ull << shift) >> 1);
+    }
+
+    void add_time(uint64_t time) {
+        m_buckets[bucket_for(time)]++;
+        m_calls++;
+        m_worst = max(time, m_worst);
+    }
+    void add(const LatencyHistogram& o) {
+        for (uint32_t i = 0; i < kBuckets; i++) {
+            m_buckets[i] += o.m_buckets[i];
+        }
+        m_calls += o.m_calls;
+        m_failures += o.m_failures;
+        m_worst = max(m_worst, o.m_worst);
+    }
+    uint64_t percentile(double p) const {
+        uint64_t target = uint64_t(p * m_calls);
+        uint64_t cur_total = 0;
+        for (uint32_t i = 0; i < kBuckets; i++) {
+            cur_total += m_buckets[i];
+            if (cur_total > target) {
+                return min(time_for(i), m_worst);
+            }
+        }
+        return m_worst;
+    }
+};
+
+struct WorkerResults {
+    ProcResults m_all;
+    LatencyHistogram m_twoway;
+    LatencyHistogram m_oneway;
+    // Open loop calls that went out more than an interval after they were due, because the
+    // ones before them took too long.
+    uint64_t m_late_calls = 0;
+
+    void add(const WorkerResults& o) {
+        m_all = ProcResults::combine(m_all, o.m_all);
+        m_twoway.add(o.m_twoway);
+        m_oneway.add(o.m_oneway);
+        m_late_calls += o.m_late_calls;
+    }
+    // One line per kind of call, in a fixed layout so runs on different builds can be diffed.
+    void dump_latency_table() const {
+        printf("%-8s %10s %10s %10s %10s %10s %10s\n", "latency", "calls", "failures", "p50(us)",
+               "p99(us)", "p99.9(us)", "max(us)");
+        const pair<const char*, const LatencyHistogram*> rows[] = {
+            {"twoway", &m_twoway}, {"oneway", &m_oneway}};
+        for (const auto& row : rows) {
+            const LatencyHistogram& h = *row.second;
+            if (h.m_calls == 0 && h.m_failures == 0) {
+                continue;
+            }
+            printf("%-8s %10" PRIu64 " %10" PRIu64 " %10.1f %10.1f %10.1f %10.1f\n", row.first,
+                   h.m_calls, h.m_failures, h.percentile(0.5) / 1.0E3, h.percentile(0.99) / 1.0E3,
+                   h.percentile(0.999) / 1.0E3, h.m_worst / 1.0E3);
+        }
+        if (m_late_calls > 0) {
+            cout << m_late_calls << " calls went out late: the target rate is more than the "
+                 "workers can keep up with" << endl;
+        }
+    }
+};
+
+enum class PayloadDistribution {
+    FIXED,
+    // Between none and twice -s
+    UNIFORM,
+    // Exponentially distributed around a mean of -s
+    EXPONENTIAL,
+    // Nine calls in ten send -s / 8, the rest 8 * -s
+    BIMODAL,
+};
+
+// How the clients load the workers, on top of the closed loop of fixed size twoway calls
+// binderThroughputTest ran before these were added.
+struct LoadOptions {
+    // Calls per second each client sends at, whether or not earlier calls have returned.
+    // 0 sends the next call as soon as the last one returns.
+    double qps = 0;
+    PayloadDistribution payload_distribution = PayloadDistribution::FIXED;
+    // Percentage of calls sent FLAG_ONEWAY
+    int oneway_percent = 0;
+    // Worker N runs on clusters[N % clusters.size()]
+    vector<cpu_set_t> clusters;
+};
+
+static const int kMaxPayloadSize = 128 * 1024;
+
+static int next_payload_size(const LoadOptions& load, int payload_size, mt19937& rng)
+{
+    int sz = payload_size;
+    switch (load.payload_distribution) {
+    case PayloadDistribution::FIXED:
+        break;
+    case PayloadDistribution::UNIFORM:
+        sz = uniform_int_distribution<int>(0, 2 * payload_size)(rng);
+        break;
+    case PayloadDistribution::EXPONENTIAL:
+        sz = int(exponential_distribution<double>(1.0 / max(payload_size, 1))(rng));
+        break;
+    case PayloadDistribution::BIMODAL:
+        sz = rng() % 10 ? payload_size / 8 : payload_size * 8;
+        break;
+    }
+    return min(sz, kMaxPayloadSize);
+}
+
+// Parses lists of CPUs like "0-3:4-7", where ':' separates clusters and each cluster is a
+// comma separated list of CPUs or ranges of them.
+static bool parse_clusters(const string& spec, vector<cpu_set_t>* clusters)
+{
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t end = spec.find(':', pos);
+        if (end == string::npos) {
+            end = spec.size();
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        string cluster = spec.substr(pos, end - pos);
+        const char* cur = cluster.c_str();
+        while (*cur) {
+            char* next;
+            long first = strtol(cur, &next, 10);
+            long last = first;
+            if (next == cur || first < 0 || first >= CPU_SETSIZE) {
+                return false;
+            }
+            if (*next == '-') {
+                cur = next + 1;
+                last = strtol(cur, &next, 10);
+                if (next == cur || last < first || last >= CPU_SETSIZE) {
+                    return false;
+                }
+            }
+            for (long cpu = first; cpu <= last; cpu++) {
+                CPU_SET(cpu, &set);
+            }
+            if (*next == ',') {
+                next++;
+            } else if (*next) {
+                return false;
+            }
+            cur = next;
+        }
+        if (CPU_COUNT(&set) == 0) {
+            return false;
+        }
+        clusters->push_back(set);
+        pos = end + 1;
+    }
+    return !clusters->empty();
+}
+
 String16 generateServiceName(int num)
 {
     char num_str[32];
@@ -181,8 +403,18 @@ void worker_fx(int num,
                int iterations,
                int payload_size,
                bool cs_pair,
+               bool strings,
+               const LoadOptions& load,
                Pipe p)
 {
+    // Pin before starting the thread pool so the binder threads end up on the
+    // same cluster.
+    if (!load.clusters.empty()) {
+        const cpu_set_t& cluster = load.clusters[num % load.clusters.size()];
+        int error = sched_setaffinity(0, sizeof(cluster), &cluster);
+        ASSERT_TRUE(error == 0);
+    }
+
     // Create BinderWorkerService and for go.
     ProcessState::self()->startThreadPool();
     sp<IServiceManager> serviceMgr = defaultServiceManager();
@@ -208,27 +440,100 @@ void worker_fx(int num,
     }
 
     // Run the benchmark if client
-    ProcResults results;
-    chrono::time_point<chrono::high_resolution_clock> start, end;
-    for (int i = 0; (!cs_pair || num >= server_count) && i < iterations; i++) {
+    typedef chrono::time_point<chrono::high_resolution_clock> Time;
+    const bool is_client = !cs_pair || num >= server_count;
+    const chrono::nanoseconds interval(load.qps > 0 ? int64_t(1.0E9 / load.qps) : 0);
+
+    // Sends one call. With due set, the call is timed from when it was due instead of from
+    // when it went out.
+    auto send_call = [&](int i, mt19937& rng, const Time* due, WorkerResults& results) {
         Parcel data, reply;
-        int target = cs_pair ? num % server_count : rand() % workers.size();
-        int sz = payload_size;
+        int target = cs_pair ? num % server_count : rng() % workers.size();
+        int sz = next_payload_size(load, payload_size, rng);
+        const bool oneway = int(rng() % 100) < load.oneway_percent;
 
+        if (due) {
+            this_thread::sleep_until(*due);
+        }
+        Time start = chrono::high_resolution_clock::now();
+        if (strings) {
+            // Build the call the way AIDL generated code does
+            data.writeInterfaceToken(kWorkerInterface);
+            data.writeUtf8AsUtf16(kWorkerPackage);
+        }
         while (sz >= sizeof(uint32_t)) {
             data.writeInt32(0);
             sz -= sizeof(uint32_t);
         }
-        start = chrono::high_resolution_clock::now();
-        status_t ret = workers[target]->transact(BINDER_NOP, data, &reply);
-        end = chrono::high_resolution_clock::now();
+        if (!strings) {
+            // Without -u only the call itself is timed, not building the payload
+            start = chrono::high_resolution_clock::now();
+        }
+        status_t ret = workers[target]->transact(strings ? BINDER_STRINGS : BINDER_NOP, data,
+                                                 oneway ? nullptr : &reply,
+                                                 oneway ? IBinder::FLAG_ONEWAY : 0);
+        if (strings && !oneway && ret == NO_ERROR) {
+            string package;
+            ret = reply.readUtf8FromUtf16(&package);
+        }
+        Time end = chrono::high_resolution_clock::now();
 
         uint64_t cur_time = uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
-        results.add_time(cur_time);
+        results.m_all.add_time(cur_time);
+
+        LatencyHistogram& latency = oneway ? results.m_oneway : results.m_twoway;
+        if (due) {
+            // In an open loop a call is as late as its reply, measured from when it was due.
+            // Timing it from when it actually went out would hide the calls that queued up
+            // behind a slow one.
+            if (start - *due > interval) {
+                results.m_late_calls++;
+            }
+            cur_time = uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - *due).count());
+        }
 
         if (ret != NO_ERROR) {
-           cout << "thread " << num << " failed " << ret << "i : " << i << endl;
-           exit(EXIT_FAILURE);
+            if (oneway) {
+                // The async space of the target filled up; keep going and report it.
+                latency.m_failures++;
+                return;
+            }
+            cout << "thread " << num << " failed " << ret << "i : " << i << endl;
+            exit(EXIT_FAILURE);
+        }
+        latency.add_time(cur_time);
+    };
+
+    WorkerResults results;
+    if (is_client && interval.count()) {
+        // Open loop: call i is due at i intervals after the start, whether or not the calls
+        // before it have returned. A pool of sender threads takes the calls in order, so a
+        // slow reply holds up only its own thread. A call only goes out late, and is counted
+        // as such, when every sender is still waiting on an earlier reply.
+        static const int kOpenLoopSenders = 16;
+        const Time first_due = chrono::high_resolution_clock::now();
+        atomic<int> next_call(0);
+        mutex results_lock;
+        vector<thread> senders;
+        for (int t = 0; t < kOpenLoopSenders; t++) {
+            senders.emplace_back([&, t]() {
+                mt19937 rng(num * kOpenLoopSenders + t);
+                WorkerResults sender_results;
+                for (int i = next_call++; i < iterations; i = next_call++) {
+                    const Time due = first_due + i * interval;
+                    send_call(i, rng, &due, sender_results);
+                }
+                lock_guard<mutex> guard(results_lock);
+                results.add(sender_results);
+            });
+        }
+        for (thread& sender : senders) {
+            sender.join();
+        }
+    } else if (is_client) {
+        mt19937 rng(num);
+        for (int i = 0; i < iterations; i++) {
+            send_call(i, rng, nullptr, results);
         }
     }
 
@@ -243,7 +548,8 @@ void worker_fx(int num,
     exit(EXIT_SUCCESS);
 }
 
-Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bool cs_pair)
+Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bool cs_pair,
+                 bool strings, const LoadOptions& load)
 {
     auto pipe_pair = Pipe::createPipePair();
     pid_t pid = fork();
@@ -252,7 +558,8 @@ Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bo
         return move(get<0>(pipe_pair));
     } else {
         /* child */
-        worker_fx(num, worker_count, iterations, payload_size, cs_pair, move(get<1>(pipe_pair)));
+        worker_fx(num, worker_count, iterations, payload_size, cs_pair, strings, load,
+                  move(get<1>(pipe_pair)));
         /* never get here */
         return move(get<0>(pipe_pair));
     }
@@ -277,12 +584,14 @@ void run_main(int iterations,
               int workers,
               int payload_size,
               int cs_pair,
+              bool strings,
+              const LoadOptions& load,
               bool training_round=false)
 {
     vector<Pipe> pipes;
     // Create all the workers and wait for them to spawn.
     for (int i = 0; i < workers; i++) {
-        pipes.push_back(make_worker(i, iterations, workers, payload_size, cs_pair));
+        pipes.push_back(make_worker(i, iterations, workers, payload_size, cs_pair, strings, load));
     }
     wait_all(pipes);
 
@@ -301,11 +610,11 @@ void run_main(int iterations,
     // Collect all results from the workers.
     cout << "collecting results" << endl;
     signal_all(pipes);
-    ProcResults tot_results;
+    WorkerResults tot_results;
     for (int i = 0; i < workers; i++) {
-        ProcResults tmp_results;
+        WorkerResults tmp_results;
         pipes[i].recv(tmp_results);
-        tot_results = ProcResults::combine(tot_results, tmp_results);
+        tot_results.add(tmp_results);
     }
 
     // Kill all the workers.
@@ -321,11 +630,12 @@ void run_main(int iterations,
     if (training_round) {
         // sets max_time_bucket to 2 * m_worst from the training round.
         // Also needs to adjust time_per_bucket accordingly.
-        max_time_bucket = 2 * tot_results.m_worst;
+        max_time_bucket = 2 * tot_results.m_all.m_worst;
         time_per_bucket = max_time_bucket / num_buckets;
-        cout << "Max latency during training: " << tot_results.m_worst / 1.0E6 << "ms" << endl;
+        cout << "Max latency during training: " << tot_results.m_all.m_worst / 1.0E6 << "ms" << endl;
     } else {
-            tot_results.dump();
+            tot_results.m_all.dump();
+            tot_results.dump_latency_table();
     }
 }
 
@@ -336,6 +646,8 @@ int main(int argc, char *argv[])
     int payload_size = 0;
     bool cs_pair = false;
     bool training_round = false;
+    bool strings = false;
+    LoadOptions load;
     (void)argc;
     (void)argv;
 
@@ -343,11 +655,20 @@ int main(int argc, char *argv[])
     for (int i = 1; i < argc; i++) {
         if (string(argv[i]) == "--help") {
             cout << "Usage: binderThroughputTest [OPTIONS]" << endl;
+            cout << "\t-c L    : Pin workers to CPU clusters, like 0-3:4-7. Worker N runs on" << endl;
+            cout << "\t          cluster N modulo the number of clusters." << endl;
+            cout << "\t-d D    : Payload size distribution around -s: fixed (default), uniform," << endl;
+            cout << "\t          exponential or bimodal." << endl;
             cout << "\t-i N    : Specify number of iterations." << endl;
             cout << "\t-m N    : Specify expected max latency in microseconds." << endl;
+            cout << "\t-o N    : Send N percent of the calls oneway." << endl;
             cout << "\t-p      : Split workers into client/server pairs." << endl;
+            cout << "\t-q N    : Have each client send N calls per second from 16 threads," << endl;
+            cout << "\t          whether or not earlier calls have returned, and time calls" << endl;
+            cout << "\t          from when they were due." << endl;
             cout << "\t-s N    : Specify payload size." << endl;
             cout << "\t-t N    : Run training round." << endl;
+            cout << "\t-u      : Send an interface token and a UTF-8 string in each call." << endl;
             cout << "\t-w N    : Specify total number of workers." << endl;
             return 0;
         }
@@ -365,6 +686,49 @@ int main(int argc, char *argv[])
             payload_size = atoi(argv[i+1]);
             i++;
         }
+        if (string(argv[i]) == "-q") {
+            load.qps = atof(argv[i+1]);
+            if (load.qps <= 0) {
+                cout << "Target rate -q must be positive." << endl;
+                exit(EXIT_FAILURE);
+            }
+            i++;
+            continue;
+        }
+        if (string(argv[i]) == "-d") {
+            string dist = argv[i+1];
+            if (dist == "fixed") {
+                load.payload_distribution = PayloadDistribution::FIXED;
+            } else if (dist == "uniform") {
+                load.payload_distribution = PayloadDistribution::UNIFORM;
+            } else if (dist == "exponential") {
+                load.payload_distribution = PayloadDistribution::EXPONENTIAL;
+            } else if (dist == "bimodal") {
+                load.payload_distribution = PayloadDistribution::BIMODAL;
+            } else {
+                cout << "Unknown payload distribution " << dist << endl;
+                exit(EXIT_FAILURE);
+            }
+            i++;
+            continue;
+        }
+        if (string(argv[i]) == "-o") {
+            load.oneway_percent = atoi(argv[i+1]);
+            if (load.oneway_percent < 0 || load.oneway_percent > 100) {
+                cout << "Oneway percentage -o must be between 0 and 100." << endl;
+                exit(EXIT_FAILURE);
+            }
+            i++;
+            continue;
+        }
+        if (string(argv[i]) == "-c") {
+            if (!parse_clusters(argv[i+1], &load.clusters)) {
+                cout << "Could not parse CPU clusters " << argv[i+1] << endl;
+                exit(EXIT_FAILURE);
+            }
+            i++;
+            continue;
+        }
         if (string(argv[i]) == "-p") {
             // client/server pairs instead of spreading
             // requests to all workers. If true, half
@@ -376,6 +740,11 @@ int main(int argc, char *argv[])
             // to get an approximation of max latency.
             training_round = true;
         }
+        if (string(argv[i]) == "-u") {
+            // Include the string work AIDL generated code does in every call:
+            // an interface token and a @utf8InCpp argument
+            strings = true;
+        }
         if (string(argv[i]) == "-m") {
             // Caller specified the max latency in microseconds.
             // No need to run training round in this case.
@@ -392,10 +761,10 @@ int main(int argc, char *argv[])
 
     if (training_round) {
         cout << "Start training round" << endl;
-        run_main(iterations, workers, payload_size, cs_pair, training_round=true);
+        run_main(iterations, workers, payload_size, cs_pair, strings, load, training_round=true);
         cout << "Completed training round" << endl << endl;
     }
 
-    run_main(iterations, workers, payload_size, cs_pair);
+    run_main(iterations, workers, payload_size, cs_pair, strings, load);
     return 0;
 }
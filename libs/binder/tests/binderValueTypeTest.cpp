@@ -108,3 +108,31 @@ TEST(ValueType, HandlesSwap) {
     ASSERT_TRUE(value_b.getInt(&int_x));
     ASSERT_EQ(31337, int_x);
 }
+
+TEST(PersistableBundle, ParcelRoundTrip) {
+    PersistableBundle nested;
+    nested.putString(String16("nested string"), String16("Lovely"));
+    nested.putPersistableBundle(String16("empty bundle"), PersistableBundle());
+
+    PersistableBundle bundle;
+    bundle.putBoolean(String16("boolean"), true);
+    bundle.putInt(String16("int"), 31337);
+    bundle.putLong(String16("long"), 13370133701337L);
+    bundle.putDouble(String16("double"), 3.14159265358979323846);
+    bundle.putString(String16("string"), String16("Lovely"));
+    bundle.putBooleanVector(String16("boolean vector"), {true, false, true});
+    bundle.putIntVector(String16("int vector"), {31337, 0});
+    bundle.putLongVector(String16("long vector"), {13370133701337L});
+    bundle.putDoubleVector(String16("double vector"), {});
+    bundle.putStringVector(String16("string vector"), {String16("Lovely"), String16()});
+    bundle.putPersistableBundle(String16("bundle"), nested);
+
+    android::Parcel parcel;
+    ASSERT_EQ(android::NO_ERROR, bundle.writeToParcel(&parcel));
+    parcel.setDataPosition(0);
+
+    PersistableBundle read;
+    ASSERT_EQ(android::NO_ERROR, read.readFromParcel(&parcel));
+    EXPECT_EQ(parcel.dataSize(), parcel.dataPosition());
+    EXPECT_EQ(bundle, read);
+}
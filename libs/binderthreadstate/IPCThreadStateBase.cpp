@@ -24,6 +24,10 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
 
 namespace android {
 
@@ -31,8 +35,47 @@ static pthread_mutex_t gTLSMutex = PTHREAD_MUTEX_INITIALIZER;
 static bool gHaveTLS = false;
 static pthread_key_t gTLS = 0;
 
-IPCThreadStateBase::IPCThreadStateBase() {
+// Entry of the process-wide table of incoming calls. Only the owning thread
+// writes it, under a sequence count so that readers can take a consistent copy
+// without locking: seq is odd while the owner is updating the fields.
+struct CallSlot {
+    std::atomic<pid_t> tid;
+    std::atomic<uint32_t> seq;
+    std::atomic<int32_t> callState;
+    std::atomic<uint32_t> code;
+    std::atomic<pid_t> callingPid;
+    std::atomic<int64_t> startTimeNs;
+};
+
+static constexpr size_t kMaxCallSlots = 256;
+static CallSlot gCallSlots[kMaxCallSlots];
+
+static int64_t monotonicTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+IPCThreadStateBase::IPCThreadStateBase() : mSlot(nullptr) {
     pthread_setspecific(gTLS, this);
+
+    const pid_t tid = gettid();
+    for (CallSlot& slot : gCallSlots) {
+        pid_t expected = 0;
+        if (slot.tid.compare_exchange_strong(expected, tid, std::memory_order_relaxed)) {
+            mSlot = &slot;
+            break;
+        }
+    }
+    ALOGW_IF(mSlot == nullptr, "IPCThreadStateBase: call table full, tid=%d is not tracked", tid);
+}
+
+IPCThreadStateBase::~IPCThreadStateBase() {
+    if (mSlot) {
+        mCallStateStack.clear();
+        publishTop();
+        mSlot->tid.store(0, std::memory_order_release);
+    }
 }
 
 IPCThreadStateBase* IPCThreadStateBase::self()
@@ -61,23 +104,90 @@ restart:
 }
 
 void IPCThreadStateBase::pushCurrentState(CallState callState) {
-    mCallStateStack.emplace(callState);
+    mCallStateStack.push_back({callState, false, 0, 0, 0});
+}
+
+void IPCThreadStateBase::pushCurrentState(CallState callState, uint32_t code,
+                                          pid_t callingPid) {
+    mCallStateStack.push_back({callState, true, code, callingPid, monotonicTimeNs()});
+    publishTop();
 }
 
 IPCThreadStateBase::CallState IPCThreadStateBase::popCurrentState() {
-    ALOG_ASSERT(mCallStateStack.size > 0);
-    CallState val = mCallStateStack.top();
-    mCallStateStack.pop();
-    return val;
+    ALOG_ASSERT(mCallStateStack.size() > 0);
+    const StackEntry entry = mCallStateStack.back();
+    mCallStateStack.pop_back();
+    if (entry.published) {
+        publishTop();
+    }
+    return entry.callState;
 }
 
 IPCThreadStateBase::CallState IPCThreadStateBase::getCurrentBinderCallState() {
     if (mCallStateStack.size() > 0) {
-        return mCallStateStack.top();
+        return mCallStateStack.back().callState;
     }
     return CallState::NONE;
 }
 
+void IPCThreadStateBase::publishTop() {
+    if (mSlot == nullptr) {
+        return;
+    }
+
+    // Entries pushed without call details do not replace the call below them, so publish the
+    // innermost call that has them.
+    const StackEntry* entry = nullptr;
+    for (auto it = mCallStateStack.rbegin(); it != mCallStateStack.rend(); ++it) {
+        if (it->published) {
+            entry = &*it;
+            break;
+        }
+    }
+
+    const uint32_t seq = mSlot->seq.load(std::memory_order_relaxed);
+    mSlot->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mSlot->callState.store(entry ? entry->callState : CallState::NONE, std::memory_order_relaxed);
+    mSlot->code.store(entry ? entry->code : 0, std::memory_order_relaxed);
+    mSlot->callingPid.store(entry ? entry->callingPid : 0, std::memory_order_relaxed);
+    mSlot->startTimeNs.store(entry ? entry->startTimeNs : 0, std::memory_order_relaxed);
+    mSlot->seq.store(seq + 2, std::memory_order_release);
+}
+
+size_t IPCThreadStateBase::getActiveCalls(CallRecord* records, size_t maxRecords) {
+    size_t count = 0;
+    for (const CallSlot& slot : gCallSlots) {
+        if (count == maxRecords) {
+            break;
+        }
+
+        const pid_t tid = slot.tid.load(std::memory_order_acquire);
+        if (tid == 0) {
+            continue;
+        }
+
+        CallRecord record;
+        uint32_t seq;
+        do {
+            seq = slot.seq.load(std::memory_order_acquire);
+            record.tid = tid;
+            record.callState =
+                    static_cast<CallState>(slot.callState.load(std::memory_order_relaxed));
+            record.code = slot.code.load(std::memory_order_relaxed);
+            record.callingPid = slot.callingPid.load(std::memory_order_relaxed);
+            record.startTimeNs = slot.startTimeNs.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) != 0 || seq != slot.seq.load(std::memory_order_relaxed));
+
+        // Skip idle threads, and slots handed to another thread while copying.
+        if (record.startTimeNs != 0 && slot.tid.load(std::memory_order_relaxed) == tid) {
+            records[count++] = record;
+        }
+    }
+    return count;
+}
+
 void IPCThreadStateBase::threadDestructor(void *st)
 {
     IPCThreadStateBase* const self = static_cast<IPCThreadStateBase*>(st);
@@ -17,9 +17,15 @@
 #ifndef BINDER_THREADSTATE_IPC_THREADSTATE_BASE_H
 #define BINDER_THREADSTATE_IPC_THREADSTATE_BASE_H
 
-#include <stack>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <vector>
 namespace android {
 
+struct CallSlot;
+
 class IPCThreadStateBase {
 public:
     enum CallState {
@@ -27,16 +33,51 @@ public:
         BINDER,
         NONE,
     };
+
+    // The incoming call a thread is currently handling.
+    struct CallRecord {
+        pid_t tid;
+        CallState callState;
+        uint32_t code;
+        pid_t callingPid;
+        // CLOCK_MONOTONIC time at which the call started.
+        int64_t startTimeNs;
+    };
+
     static IPCThreadStateBase* self();
     void pushCurrentState(CallState callState);
+    // Like pushCurrentState(callState), and also publishes the call so that
+    // getActiveCalls() can report it until the matching popCurrentState().
+    void pushCurrentState(CallState callState, uint32_t code, pid_t callingPid);
     CallState popCurrentState();
     CallState getCurrentBinderCallState();
 
+    // Copies up to |maxRecords| of the incoming calls currently being handled
+    // by any thread of this process to |records|, returning how many were
+    // copied. Each thread reports its innermost call. Does not block the
+    // threads being sampled, so it is safe to call from a watchdog.
+    static size_t getActiveCalls(CallRecord* records, size_t maxRecords);
+
 private:
+    struct StackEntry {
+        CallState callState;
+        bool published;
+        uint32_t code;
+        pid_t callingPid;
+        int64_t startTimeNs;
+    };
+
     IPCThreadStateBase();
+    ~IPCThreadStateBase();
     static void threadDestructor(void *st);
 
-    std::stack<CallState> mCallStateStack;
+    void publishTop();
+
+    // Innermost call last.
+    std::vector<StackEntry> mCallStateStack;
+    // This thread's entry in the process-wide call table, or null if the
+    // table was full when the thread started.
+    CallSlot* mSlot;
 };
 
 }; // namespace android
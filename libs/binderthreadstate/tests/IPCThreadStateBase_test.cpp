@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <binderthreadstate/IPCThreadStateBase.h>
+
+#include <gtest/gtest.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <thread>
+
+namespace android {
+namespace {
+
+using CallState = IPCThreadStateBase::CallState;
+
+// Returns whether the calling thread has a published call, and copies it to |outRecord|.
+bool getOwnCall(IPCThreadStateBase::CallRecord* outRecord) {
+    const pid_t tid = static_cast<pid_t>(syscall(__NR_gettid));
+    IPCThreadStateBase::CallRecord records[256];
+    const size_t count = IPCThreadStateBase::getActiveCalls(records, 256);
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].tid == tid) {
+            *outRecord = records[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Each test runs on a new thread, so it starts with an empty call stack.
+void runOnNewThread(void (*test)()) {
+    std::thread(test).join();
+}
+
+TEST(IPCThreadStateBaseTest, PushAndPop) {
+    runOnNewThread([]() {
+        IPCThreadStateBase* state = IPCThreadStateBase::self();
+        EXPECT_EQ(CallState::NONE, state->getCurrentBinderCallState());
+
+        state->pushCurrentState(CallState::BINDER);
+        state->pushCurrentState(CallState::HWBINDER);
+        EXPECT_EQ(CallState::HWBINDER, state->getCurrentBinderCallState());
+
+        EXPECT_EQ(CallState::HWBINDER, state->popCurrentState());
+        EXPECT_EQ(CallState::BINDER, state->getCurrentBinderCallState());
+        EXPECT_EQ(CallState::BINDER, state->popCurrentState());
+        EXPECT_EQ(CallState::NONE, state->getCurrentBinderCallState());
+    });
+}
+
+TEST(IPCThreadStateBaseTest, UnpublishedCallsAreNotReported) {
+    runOnNewThread([]() {
+        IPCThreadStateBase* state = IPCThreadStateBase::self();
+        IPCThreadStateBase::CallRecord record;
+
+        state->pushCurrentState(CallState::HWBINDER);
+        EXPECT_FALSE(getOwnCall(&record));
+        state->popCurrentState();
+        EXPECT_FALSE(getOwnCall(&record));
+    });
+}
+
+TEST(IPCThreadStateBaseTest, PublishesInnermostCall) {
+    runOnNewThread([]() {
+        IPCThreadStateBase* state = IPCThreadStateBase::self();
+        IPCThreadStateBase::CallRecord record;
+
+        state->pushCurrentState(CallState::BINDER, 10, 100);
+        ASSERT_TRUE(getOwnCall(&record));
+        EXPECT_EQ(CallState::BINDER, record.callState);
+        EXPECT_EQ(10u, record.code);
+        EXPECT_EQ(100, record.callingPid);
+        EXPECT_NE(0, record.startTimeNs);
+
+        state->pushCurrentState(CallState::HWBINDER, 20, 200);
+        ASSERT_TRUE(getOwnCall(&record));
+        EXPECT_EQ(CallState::HWBINDER, record.callState);
+        EXPECT_EQ(20u, record.code);
+        EXPECT_EQ(200, record.callingPid);
+
+        state->popCurrentState();
+        ASSERT_TRUE(getOwnCall(&record));
+        EXPECT_EQ(10u, record.code);
+
+        state->popCurrentState();
+        EXPECT_FALSE(getOwnCall(&record));
+    });
+}
+
+TEST(IPCThreadStateBaseTest, PopRepublishesCallBelowUnpublishedEntry) {
+    runOnNewThread([]() {
+        IPCThreadStateBase* state = IPCThreadStateBase::self();
+        IPCThreadStateBase::CallRecord record;
+
+        state->pushCurrentState(CallState::BINDER, 10, 100);
+        state->pushCurrentState(CallState::HWBINDER);
+        // An entry without call details leaves the call below it published.
+        ASSERT_TRUE(getOwnCall(&record));
+        EXPECT_EQ(10u, record.code);
+
+        state->pushCurrentState(CallState::BINDER, 30, 300);
+        ASSERT_TRUE(getOwnCall(&record));
+        EXPECT_EQ(30u, record.code);
+
+        EXPECT_EQ(CallState::BINDER, state->popCurrentState());
+        ASSERT_TRUE(getOwnCall(&record));
+        EXPECT_EQ(CallState::BINDER, record.callState);
+        EXPECT_EQ(10u, record.code);
+        EXPECT_EQ(100, record.callingPid);
+
+        EXPECT_EQ(CallState::HWBINDER, state->popCurrentState());
+        ASSERT_TRUE(getOwnCall(&record));
+        EXPECT_EQ(10u, record.code);
+
+        state->popCurrentState();
+        EXPECT_FALSE(getOwnCall(&record));
+    });
+}
+
+}  // namespace
+}  // namespace android
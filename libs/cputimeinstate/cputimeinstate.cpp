@@ -21,11 +21,14 @@
 #include <dirent.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <sys/sysinfo.h>
 
+#include <algorithm>
 #include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <android-base/file.h>
@@ -54,13 +57,33 @@ struct val_t {
     uint64_t ar[100];
 };
 
+// The concurrent times of a uid are split across entries of CPUS_PER_ENTRY counts each: the entry
+// with bucket b holds the ns spent while b * CPUS_PER_ENTRY + i + 1 CPUs were active, in total
+// (active) and in the cluster of the CPU the uid ran on (policy).
+#define CPUS_PER_ENTRY 8
+
+struct concurrent_key_t {
+    uint32_t uid;
+    uint32_t bucket;
+};
+
+struct concurrent_val_t {
+    uint64_t active[CPUS_PER_ENTRY];
+    uint64_t policy[CPUS_PER_ENTRY];
+};
+
 static std::mutex gInitializedMutex;
 static bool gInitialized = false;
 static uint32_t gNPolicies = 0;
 static std::vector<std::vector<uint32_t>> gPolicyFreqs;
 static std::vector<std::vector<uint32_t>> gPolicyCpus;
 static std::set<uint32_t> gAllFreqs;
+// Number of (cluster, freq) pairs, and where each cluster's times start in a flat list of them.
+static size_t gNFreqTimes = 0;
+static std::vector<size_t> gPolicyOffsets;
 static unique_fd gMapFd;
+static unique_fd gConcurrentMapFd;
+static uint32_t gNCpus = 0;
 
 static bool readNumbersFromFile(const std::string &path, std::vector<uint32_t> *out) {
     std::string data;
@@ -117,6 +140,8 @@ static bool initGlobals() {
         gPolicyFreqs.emplace_back(freqs);
 
         for (auto freq : freqs) gAllFreqs.insert(freq);
+        gPolicyOffsets.emplace_back(gNFreqTimes);
+        gNFreqTimes += freqs.size();
 
         std::vector<uint32_t> cpus;
         std::string path = StringPrintf("%s/%s/%s", basepath, policy.c_str(), "related_cpus");
@@ -127,6 +152,10 @@ static bool initGlobals() {
     gMapFd = unique_fd{bpf_obj_get(BPF_FS_PATH "map_time_in_state_uid_times")};
     if (gMapFd < 0) return false;
 
+    // Older BPF programs don't track concurrent times; only the concurrent APIs fail then.
+    gConcurrentMapFd = unique_fd{bpf_obj_get(BPF_FS_PATH "map_time_in_state_uid_concurrent_times")};
+    gNCpus = get_nprocs_conf();
+
     gInitialized = true;
     return true;
 }
@@ -227,6 +256,169 @@ bool getUidsCpuFreqTimes(
     return isOk(m.iterateWithValue(fn));
 }
 
+// Number of times reported per uid by getUidsCpuFreqTimesDelta, or 0 on error.
+size_t getCpuFreqTimesCount() {
+    if (!gInitialized && !initGlobals()) return 0;
+    return gNFreqTimes;
+}
+
+// Retrieve the times in ns of only the uids whose times changed since the previous call with the
+// same cursor; the first call with a new cursor reports every uid. Returns false on error.
+// Otherwise, returns true, stores those uids in uids and their times in freqTimes, flattened as
+// [t0_0_0, t0_0_1, ..., t0_1_0, t0_1_1, ..., t1_0_0, ...]
+// where ti_j_k is the ns uids[i] spent running on the jth cluster at the cluster's kth lowest freq,
+// so each uid has getCpuFreqTimesCount() times. A uid whose times were cleared is reported with
+// zeros. The output vectors keep their capacity from one call to the next, so polling with the
+// same vectors doesn't allocate once they are large enough.
+bool getUidsCpuFreqTimesDelta(UidCpuFreqTimesCursor *cursor, std::vector<uint32_t> *uids,
+                              std::vector<uint64_t> *freqTimes) {
+    if (!gInitialized && !initGlobals()) return false;
+
+    int fd = bpf_obj_get(BPF_FS_PATH "map_time_in_state_uid_times");
+    if (fd < 0) return false;
+    BpfMap<time_key_t, val_t> m(fd);
+
+    std::vector<std::unordered_map<uint32_t, uint32_t>> policyFreqIdxs(gNPolicies);
+    for (uint32_t i = 0; i < gNPolicies; ++i) {
+        for (size_t j = 0; j < gPolicyFreqs[i].size(); ++j) {
+            policyFreqIdxs[i][gPolicyFreqs[i][j]] = j;
+        }
+    }
+
+    std::fill(cursor->currentTimes.begin(), cursor->currentTimes.end(), 0);
+    auto fn = [cursor, &policyFreqIdxs](const time_key_t &key, const val_t &val,
+                                        const BpfMap<time_key_t, val_t> &) {
+        auto it = cursor->uidSlots.find(key.uid);
+        if (it == cursor->uidSlots.end()) {
+            it = cursor->uidSlots.emplace(key.uid, cursor->uidSlots.size()).first;
+            cursor->lastTimes.resize(cursor->lastTimes.size() + gNFreqTimes, 0);
+            cursor->currentTimes.resize(cursor->currentTimes.size() + gNFreqTimes, 0);
+        }
+        uint64_t *times = &cursor->currentTimes[it->second * gNFreqTimes];
+        for (size_t policy = 0; policy < gNPolicies; ++policy) {
+            auto freqIdx = policyFreqIdxs[policy].find(key.freq);
+            if (freqIdx == policyFreqIdxs[policy].end()) continue;
+            uint64_t &time = times[gPolicyOffsets[policy] + freqIdx->second];
+            for (const auto &cpu : gPolicyCpus[policy]) time += val.ar[cpu];
+        }
+        return android::netdutils::status::ok;
+    };
+    if (!isOk(m.iterateWithValue(fn))) return false;
+
+    uids->clear();
+    freqTimes->clear();
+    for (const auto &[uid, slot] : cursor->uidSlots) {
+        auto current = cursor->currentTimes.begin() + slot * gNFreqTimes;
+        auto last = cursor->lastTimes.begin() + slot * gNFreqTimes;
+        if (std::equal(current, current + gNFreqTimes, last)) continue;
+        uids->emplace_back(uid);
+        freqTimes->insert(freqTimes->end(), current, current + gNFreqTimes);
+    }
+    std::swap(cursor->lastTimes, cursor->currentTimes);
+    return true;
+}
+
+// Resize times to hold the concurrent times for gNCpus CPUs, with every time set to 0.
+static void initConcurrentTimes(ConcurrentTimes *times) {
+    times->active.assign(gNCpus, 0);
+    times->policy.resize(gNPolicies);
+    for (uint32_t i = 0; i < gNPolicies; ++i) times->policy[i].assign(gPolicyCpus[i].size(), 0);
+}
+
+// Add the times of one concurrent_val_t entry to times.
+static void addConcurrentTimes(uint32_t bucket, const concurrent_val_t &val, uint32_t policy,
+                               ConcurrentTimes *times) {
+    for (uint32_t i = 0; i < CPUS_PER_ENTRY; ++i) {
+        uint32_t idx = bucket * CPUS_PER_ENTRY + i;
+        if (idx < times->active.size()) times->active[idx] += val.active[i];
+        if (idx < times->policy[policy].size()) times->policy[policy][idx] += val.policy[i];
+    }
+}
+
+// Return the index of the cluster that cpu belongs to, or gNPolicies if none does.
+static uint32_t policyOfCpu(uint32_t cpu) {
+    for (uint32_t i = 0; i < gNPolicies; ++i) {
+        for (uint32_t c : gPolicyCpus[i]) {
+            if (c == cpu) return i;
+        }
+    }
+    return gNPolicies;
+}
+
+// Retrieve the times in ns that uid spent running while different numbers of CPUs were active,
+// and store them in times. Returns false on error. Otherwise, returns true and populates times
+// with:
+// active: [t_1, t_2, ...], where t_i is the ns uid ran while i CPUs were active in total;
+// policy: [[t0_1, t0_2, ...], [t1_1, t1_2, ...], ...], where tj_i is the ns that uid ran on the
+//         jth cluster while i of that cluster's CPUs were active.
+// The times are kept per CPU the uid ran on; they're summed over each cluster's CPUs here.
+bool getUidConcurrentTimes(uint32_t uid, ConcurrentTimes *times) {
+    if (!gInitialized && !initGlobals()) return false;
+    if (gConcurrentMapFd < 0) return false;
+
+    initConcurrentTimes(times);
+    std::vector<concurrent_val_t> values(gNCpus);
+    for (uint32_t bucket = 0; bucket * CPUS_PER_ENTRY < gNCpus; ++bucket) {
+        concurrent_key_t key = {.uid = uid, .bucket = bucket};
+        // The map is per CPU, so a lookup returns one value for each possible CPU.
+        if (findMapEntry(gConcurrentMapFd, &key, values.data())) {
+            if (errno == ENOENT) continue;
+            return false;
+        }
+        for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
+            uint32_t policy = policyOfCpu(cpu);
+            if (policy == gNPolicies) continue;
+            addConcurrentTimes(bucket, values[cpu], policy, times);
+        }
+    }
+    return true;
+}
+
+// Retrieve the concurrent times of every uid, in the format described for getUidConcurrentTimes,
+// and store them in timesMap. Returns false on error, true otherwise.
+bool getUidsConcurrentTimes(std::unordered_map<uint32_t, ConcurrentTimes> *timesMap) {
+    if (!gInitialized && !initGlobals()) return false;
+    if (gConcurrentMapFd < 0) return false;
+
+    std::vector<uint32_t> cpuPolicies(gNCpus);
+    for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) cpuPolicies[cpu] = policyOfCpu(cpu);
+
+    // Collect the keys before reading any entry. If an entry is cleared while the map is walked,
+    // the walk restarts from the first key, so reading entries along the way would count some of
+    // them twice. The set drops the keys a restarted walk returns again.
+    std::set<std::pair<uint32_t, uint32_t>> keys;
+    concurrent_key_t key, prevKey;
+    bool first = true;
+    while (first ? getFirstMapKey(gConcurrentMapFd, &key) == 0
+                 : getNextMapKey(gConcurrentMapFd, &prevKey, &key) == 0) {
+        first = false;
+        prevKey = key;
+        keys.emplace(key.uid, key.bucket);
+    }
+    if (errno != ENOENT) return false;
+
+    timesMap->clear();
+    std::vector<concurrent_val_t> values(gNCpus);
+    for (const auto &[uid, bucket] : keys) {
+        key = {.uid = uid, .bucket = bucket};
+        if (findMapEntry(gConcurrentMapFd, &key, values.data())) {
+            // The entry may have been cleared since its key was returned.
+            if (errno == ENOENT) continue;
+            return false;
+        }
+        auto it = timesMap->find(uid);
+        if (it == timesMap->end()) {
+            it = timesMap->emplace(uid, ConcurrentTimes{}).first;
+            initConcurrentTimes(&it->second);
+        }
+        for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
+            if (cpuPolicies[cpu] == gNPolicies) continue;
+            addConcurrentTimes(bucket, values[cpu], cpuPolicies[cpu], &it->second);
+        }
+    }
+    return true;
+}
+
 // Clear all time in state data for a given uid. Returns false on error, true otherwise.
 bool clearUidCpuFreqTimes(uint32_t uid) {
     if (!gInitialized && !initGlobals()) return false;
@@ -237,6 +429,12 @@ bool clearUidCpuFreqTimes(uint32_t uid) {
         key.freq = freq;
         if (deleteMapEntry(gMapFd, &key) && errno != ENOENT) return false;
     }
+
+    if (gConcurrentMapFd < 0) return true;
+    for (uint32_t bucket = 0; bucket * CPUS_PER_ENTRY < gNCpus; ++bucket) {
+        concurrent_key_t concurrentKey = {.uid = uid, .bucket = bucket};
+        if (deleteMapEntry(gConcurrentMapFd, &concurrentKey) && errno != ENOENT) return false;
+    }
     return true;
 }
 
@@ -27,5 +27,22 @@ bool getUidCpuFreqTimes(unsigned int uid, std::vector<std::vector<uint64_t>> *fr
 bool getUidsCpuFreqTimes(std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> *tisMap);
 bool clearUidCpuFreqTimes(unsigned int uid);
 
+struct ConcurrentTimes {
+    std::vector<uint64_t> active;
+    std::vector<std::vector<uint64_t>> policy;
+};
+bool getUidConcurrentTimes(uint32_t uid, ConcurrentTimes *times);
+bool getUidsConcurrentTimes(std::unordered_map<uint32_t, ConcurrentTimes> *timesMap);
+
+// State kept between calls to getUidsCpuFreqTimesDelta. The members are internal to the library.
+struct UidCpuFreqTimesCursor {
+    std::unordered_map<uint32_t, size_t> uidSlots;
+    std::vector<uint64_t> lastTimes;
+    std::vector<uint64_t> currentTimes;
+};
+size_t getCpuFreqTimesCount();
+bool getUidsCpuFreqTimesDelta(UidCpuFreqTimesCursor *cursor, std::vector<uint32_t> *uids,
+                              std::vector<uint64_t> *freqTimes);
+
 } // namespace bpf
 } // namespace android
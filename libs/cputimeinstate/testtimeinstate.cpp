@@ -33,6 +33,59 @@ TEST(TimeInStateTest, AllUid) {
     }
 }
 
+TEST(TimeInStateTest, AllUidDelta) {
+    UidCpuFreqTimesCursor cursor;
+    vector<uint32_t> uids;
+    vector<uint64_t> times;
+    ASSERT_TRUE(getUidsCpuFreqTimesDelta(&cursor, &uids, &times));
+
+    ASSERT_FALSE(uids.empty());
+    size_t count = getCpuFreqTimesCount();
+    ASSERT_GT(count, (size_t)0);
+    ASSERT_EQ(times.size(), uids.size() * count);
+
+    std::unordered_map<uint32_t, vector<vector<uint64_t>>> map;
+    ASSERT_TRUE(getUidsCpuFreqTimes(&map));
+    for (size_t i = 0; i < uids.size(); ++i) {
+        auto it = map.find(uids[i]);
+        if (it == map.end()) continue;
+        size_t j = i * count;
+        for (const auto &policyTimes : it->second) {
+            for (auto t : policyTimes) ASSERT_LE(times[j++], t);
+        }
+        ASSERT_EQ(j, (i + 1) * count);
+    }
+
+    // Only uids that ran since the first call are reported again.
+    vector<uint32_t> uids2;
+    vector<uint64_t> times2;
+    ASSERT_TRUE(getUidsCpuFreqTimesDelta(&cursor, &uids2, &times2));
+    ASSERT_LE(uids2.size(), cursor.uidSlots.size());
+    ASSERT_EQ(times2.size(), uids2.size() * count);
+}
+
+TEST(TimeInStateTest, ConcurrentTimes) {
+    ConcurrentTimes concurrentTimes;
+    // Only the newer BPF programs track concurrent times.
+    if (!getUidConcurrentTimes(0, &concurrentTimes)) return;
+
+    vector<vector<uint64_t>> freqTimes;
+    ASSERT_TRUE(getUidCpuFreqTimes(0, &freqTimes));
+    ASSERT_EQ(concurrentTimes.policy.size(), freqTimes.size());
+
+    size_t nCpus = 0;
+    for (const auto &policyTimes : concurrentTimes.policy) nCpus += policyTimes.size();
+    ASSERT_EQ(concurrentTimes.active.size(), nCpus);
+
+    std::unordered_map<uint32_t, ConcurrentTimes> map;
+    ASSERT_TRUE(getUidsConcurrentTimes(&map));
+    ASSERT_FALSE(map.empty());
+    for (const auto &entry : map) {
+        ASSERT_EQ(entry.second.active.size(), nCpus);
+        ASSERT_EQ(entry.second.policy.size(), concurrentTimes.policy.size());
+    }
+}
+
 TEST(TimeInStateTest, RemoveUid) {
     vector<vector<uint64_t>> times, times2;
     ASSERT_TRUE(getUidCpuFreqTimes(0, &times));
@@ -42,27 +42,38 @@ int64_t calculate_dir_size(int dfd)
 
     while ((de = readdir(d))) {
         const char *name = de->d_name;
-        if (de->d_type == DT_DIR) {
-            int subfd;
+        int is_dir = de->d_type == DT_DIR;
 
-            /* always skip "." and ".." */
-            if (name[0] == '.') {
-                if (name[1] == 0)
-                    continue;
-                if ((name[1] == '.') && (name[2] == 0))
-                    continue;
-            }
+        /* always skip "." and ".." */
+        if (name[0] == '.') {
+            if (name[1] == 0)
+                continue;
+            if ((name[1] == '.') && (name[2] == 0))
+                continue;
+        }
 
-            if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
-                size += stat_size(&s);
-            }
-            subfd = openat(dfd, name, O_RDONLY | O_DIRECTORY);
+        if (is_dir) {
+            /* stat the directory through its fd rather than looking its name
+             * up a second time */
+            int subfd = openat(dfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
             if (subfd >= 0) {
+                if (fstat(subfd, &s) == 0) {
+                    size += stat_size(&s);
+                }
                 size += calculate_dir_size(subfd);
+                continue;
             }
-        } else {
-            if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
-                size += stat_size(&s);
+        }
+
+        if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
+            size += stat_size(&s);
+
+            /* some filesystems do not report d_type */
+            if (de->d_type == DT_UNKNOWN && S_ISDIR(s.st_mode)) {
+                int subfd = openat(dfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                if (subfd >= 0) {
+                    size += calculate_dir_size(subfd);
+                }
             }
         }
     }
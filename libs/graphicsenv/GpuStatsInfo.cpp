@@ -123,4 +123,41 @@ std::string GpuStatsAppInfo::toString() const {
     return result;
 }
 
+status_t GpuMemInfo::writeToParcel(Parcel* parcel) const {
+    status_t status;
+    if ((status = parcel->writeInt32(pid)) != OK) return status;
+    if ((status = parcel->writeUint64(grallocMemory)) != OK) return status;
+    if ((status = parcel->writeUint64(driverMemory)) != OK) return status;
+    if ((status = parcel->writeUint64(peakMemory)) != OK) return status;
+    if ((status = parcel->writeInt64(lastUpdateTime)) != OK) return status;
+    if ((status = parcel->writeInt64Vector(memoryHistory)) != OK) return status;
+    return OK;
+}
+
+status_t GpuMemInfo::readFromParcel(const Parcel* parcel) {
+    status_t status;
+    if ((status = parcel->readInt32(&pid)) != OK) return status;
+    if ((status = parcel->readUint64(&grallocMemory)) != OK) return status;
+    if ((status = parcel->readUint64(&driverMemory)) != OK) return status;
+    if ((status = parcel->readUint64(&peakMemory)) != OK) return status;
+    if ((status = parcel->readInt64(&lastUpdateTime)) != OK) return status;
+    if ((status = parcel->readInt64Vector(&memoryHistory)) != OK) return status;
+    return OK;
+}
+
+std::string GpuMemInfo::toString() const {
+    std::string result;
+    StringAppendF(&result, "pid = %d\n", pid);
+    StringAppendF(&result, "grallocMemory = %" PRIu64 "\n", grallocMemory);
+    StringAppendF(&result, "driverMemory = %" PRIu64 "\n", driverMemory);
+    StringAppendF(&result, "peakMemory = %" PRIu64 "\n", peakMemory);
+    StringAppendF(&result, "lastUpdateTime = %" PRId64 "\n", lastUpdateTime);
+    result.append("memoryHistory:");
+    for (int64_t memory : memoryHistory) {
+        StringAppendF(&result, " %" PRId64, memory);
+    }
+    result.append("\n");
+    return result;
+}
+
 } // namespace android
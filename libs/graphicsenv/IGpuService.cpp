@@ -102,6 +102,40 @@ public:
 
         remote()->transact(BnGpuService::SET_CPU_VULKAN_IN_USE, data, &reply, IBinder::FLAG_ONEWAY);
     }
+
+    virtual void setGpuMemory(uint64_t grallocMemory, uint64_t driverMemory) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IGpuService::getInterfaceDescriptor());
+
+        data.writeUint64(grallocMemory);
+        data.writeUint64(driverMemory);
+
+        // Not oneway, since the service attributes the memory to the calling pid, which the
+        // driver doesn't report for oneway transactions.
+        remote()->transact(BnGpuService::SET_GPU_MEMORY, data, &reply);
+    }
+
+    virtual status_t getGpuMemInfo(std::vector<GpuMemInfo>* outInfo) const {
+        if (!outInfo) return UNEXPECTED_NULL;
+
+        Parcel data, reply;
+        status_t status;
+
+        if ((status = data.writeInterfaceToken(IGpuService::getInterfaceDescriptor())) != OK) {
+            return status;
+        }
+
+        if ((status = remote()->transact(BnGpuService::GET_GPU_MEM_INFO, data, &reply)) != OK) {
+            return status;
+        }
+
+        int32_t result = 0;
+        if ((status = reply.readInt32(&result)) != OK) return status;
+        if (result != OK) return result;
+
+        outInfo->clear();
+        return reply.readParcelableVector(outInfo);
+    }
 };
 
 IMPLEMENT_META_INTERFACE(GpuService, "android.graphicsenv.IGpuService");
@@ -187,6 +221,32 @@ status_t BnGpuService::onTransact(uint32_t code, const Parcel& data, Parcel* rep
 
             return OK;
         }
+        case SET_GPU_MEMORY: {
+            CHECK_INTERFACE(IGpuService, data, reply);
+
+            uint64_t grallocMemory;
+            if ((status = data.readUint64(&grallocMemory)) != OK) return status;
+
+            uint64_t driverMemory;
+            if ((status = data.readUint64(&driverMemory)) != OK) return status;
+
+            setGpuMemory(grallocMemory, driverMemory);
+
+            return OK;
+        }
+        case GET_GPU_MEM_INFO: {
+            CHECK_INTERFACE(IGpuService, data, reply);
+
+            std::vector<GpuMemInfo> info;
+            const status_t result = getGpuMemInfo(&info);
+
+            if ((status = reply->writeInt32(result)) != OK) return status;
+            if (result != OK) return result;
+
+            if ((status = reply->writeParcelableVector(info)) != OK) return status;
+
+            return OK;
+        }
         case SHELL_COMMAND_TRANSACTION: {
             int in = data.readFileDescriptor();
             int out = data.readFileDescriptor();
@@ -72,4 +72,31 @@ public:
     bool cpuVulkanInUse = false;
 };
 
+/*
+ * class for transporting the graphics memory use of one process from
+ * GpuService to authorized recipents. This class is intended to be a data
+ * container.
+ */
+class GpuMemInfo : public Parcelable {
+public:
+    GpuMemInfo() = default;
+    GpuMemInfo(const GpuMemInfo&) = default;
+    virtual ~GpuMemInfo() = default;
+    virtual status_t writeToParcel(Parcel* parcel) const;
+    virtual status_t readFromParcel(const Parcel* parcel);
+    std::string toString() const;
+
+    int32_t pid = 0;
+    // Bytes of gralloc buffers the process has allocated
+    uint64_t grallocMemory = 0;
+    // Bytes the graphics drivers report the process is using
+    uint64_t driverMemory = 0;
+    // Highest grallocMemory + driverMemory reported
+    uint64_t peakMemory = 0;
+    // systemTime() of the last report
+    int64_t lastUpdateTime = 0;
+    // grallocMemory + driverMemory of the last reports, oldest first
+    std::vector<int64_t> memoryHistory = {};
+};
+
 } // namespace android
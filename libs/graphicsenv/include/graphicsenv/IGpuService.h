@@ -49,6 +49,12 @@ public:
 
     // get GPU app stats from GpuStats module.
     virtual status_t getGpuStatsAppInfo(std::vector<GpuStatsAppInfo>* outStats) const = 0;
+
+    // set the calling process's graphics memory use.
+    virtual void setGpuMemory(uint64_t grallocMemory, uint64_t driverMemory) = 0;
+
+    // get per-process graphics memory use from GpuMem module. Requires the DUMP permission.
+    virtual status_t getGpuMemInfo(std::vector<GpuMemInfo>* outInfo) const = 0;
 };
 
 class BnGpuService : public BnInterface<IGpuService> {
@@ -58,6 +64,8 @@ public:
         GET_GPU_STATS_GLOBAL_INFO,
         GET_GPU_STATS_APP_INFO,
         SET_CPU_VULKAN_IN_USE,
+        SET_GPU_MEMORY,
+        GET_GPU_MEM_INFO,
         // Always append new enum to the end.
     };
 
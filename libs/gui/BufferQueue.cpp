@@ -82,6 +82,14 @@ void BufferQueue::ProxyConsumerListener::addAndGetFrameTimestamps(
     }
 }
 
+sp<IMemory> BufferQueue::ProxyConsumerListener::getFrameTimestampsMemory() {
+    sp<ConsumerListener> listener(mConsumerListener.promote());
+    if (listener != nullptr) {
+        return listener->getFrameTimestampsMemory();
+    }
+    return nullptr;
+}
+
 void BufferQueue::createBufferQueue(sp<IGraphicBufferProducer>* outProducer,
         sp<IGraphicBufferConsumer>* outConsumer,
         bool consumerIsSurfaceFlinger) {
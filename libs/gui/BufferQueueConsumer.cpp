@@ -58,7 +58,8 @@ status_t BufferQueueConsumer::acquireBuffer(BufferItem* outBuffer,
     int numDroppedBuffers = 0;
     sp<IProducerListener> listener;
     {
-        std::unique_lock<std::mutex> lock(mCore->mMutex);
+        std::unique_lock<std::mutex> lock =
+                mCore->lockCounted(BufferQueueCore::LockSide::Consumer);
 
         // Check that the consumer doesn't currently have the maximum number of
         // buffers acquired. We allow the max buffer count to be exceeded by one
@@ -374,6 +375,7 @@ status_t BufferQueueConsumer::attachBuffer(int* outSlot,
     }
 
     mCore->mActiveBuffers.insert(found);
+    mCore->updateActiveBufferPeakLocked();
     *outSlot = found;
     ATRACE_BUFFER_INDEX(*outSlot);
     BQ_LOGV("attachBuffer: returning slot %d", *outSlot);
@@ -421,7 +423,8 @@ status_t BufferQueueConsumer::releaseBuffer(int slot, uint64_t frameNumber,
 
     sp<IProducerListener> listener;
     { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        std::unique_lock<std::mutex> lock =
+                mCore->lockCounted(BufferQueueCore::LockSide::Consumer);
 
         // If the frame number has changed because the buffer has been reallocated,
         // we can ignore this releaseBuffer for the old buffer.
@@ -40,6 +40,8 @@
 
 #include <system/window.h>
 
+#include <utils/Timers.h>
+
 namespace android {
 
 static String8 getUniqueName() {
@@ -97,6 +99,8 @@ BufferQueueCore::BufferQueueCore() :
     mSharedBufferCache(Rect::INVALID_RECT, 0, NATIVE_WINDOW_SCALING_MODE_FREEZE,
             HAL_DATASPACE_UNKNOWN),
     mLastQueuedSlot(INVALID_BUFFER_SLOT),
+    mTrimSpareBuffers(property_get_bool("debug.bq.trim_spare_buffers", false)),
+    mActiveBufferPeak(0),
     mUniqueId(getUniqueId())
 {
     int numStartingBuffers = getMaxBufferCountLocked();
@@ -111,6 +115,21 @@ BufferQueueCore::BufferQueueCore() :
 
 BufferQueueCore::~BufferQueueCore() {}
 
+std::unique_lock<std::mutex> BufferQueueCore::lockCounted(LockSide side) const {
+    LockStats& stats = side == LockSide::Producer ? mProducerLockStats : mConsumerLockStats;
+    stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        const nsecs_t start = systemTime();
+        lock.lock();
+        stats.contentions.fetch_add(1, std::memory_order_relaxed);
+        stats.waitNs.fetch_add(static_cast<uint64_t>(systemTime() - start),
+                               std::memory_order_relaxed);
+    }
+    return lock;
+}
+
 void BufferQueueCore::dumpState(const String8& prefix, String8* outResult) const {
     std::lock_guard<std::mutex> lock(mMutex);
 
@@ -125,6 +144,14 @@ void BufferQueueCore::dumpState(const String8& prefix, String8* outResult) const
                             mDefaultWidth, mDefaultHeight, mDefaultBufferFormat);
     outResult->appendFormat("transform-hint=%02x frame-counter=%" PRIu64, mTransformHint,
                             mFrameCounter);
+    const auto dumpLockStats = [&](const char* side, const LockStats& stats) {
+        outResult->appendFormat("\n%s  %s-lock acquisitions=%" PRIu64 " contended=%" PRIu64
+                                " waited=%.3fms",
+                                prefix.string(), side, stats.acquisitions.load(),
+                                stats.contentions.load(), stats.waitNs.load() / 1e6);
+    };
+    dumpLockStats("producer", mProducerLockStats);
+    dumpLockStats("consumer", mConsumerLockStats);
 
     outResult->appendFormat("\n%sFIFO(%zu):\n", prefix.string(), mQueue.size());
     Fifo::const_iterator current(mQueue.begin());
@@ -269,6 +296,44 @@ void BufferQueueCore::discardFreeBuffersLocked() {
     VALIDATE_CONSISTENCY();
 }
 
+bool BufferQueueCore::trimSpareBufferLocked() {
+    if (!mTrimSpareBuffers || mOccupancyTracker.getDoubleBufferedSegmentCount() <
+            TRIM_SPARE_BUFFER_SEGMENTS) {
+        return false;
+    }
+
+    // Start a new measurement whatever is decided below
+    const size_t peak = mActiveBufferPeak;
+    mActiveBufferPeak = mActiveBuffers.size();
+    mOccupancyTracker.resetDoubleBufferedSegmentCount();
+
+    if (mSharedBufferMode || !mAllowAllocation || mFreeBuffers.empty()) {
+        return false;
+    }
+
+    // One buffer being rendered, the ones the consumer may hold, and one more
+    // if the producer must never block
+    const size_t minBuffers = static_cast<size_t>(mMaxAcquiredBufferCount + 1 +
+            ((mAsyncMode || mDequeueBufferCannotBlock) ? 1 : 0));
+    const size_t allocated = mFreeBuffers.size() + mActiveBuffers.size();
+    if (allocated <= std::max(minBuffers, peak)) {
+        return false;
+    }
+
+    int slot = mFreeBuffers.back();
+    BQ_LOGV("trimSpareBufferLocked: releasing slot %d", slot);
+    mFreeBuffers.pop_back();
+    mFreeSlots.insert(slot);
+    clearBufferSlotLocked(slot);
+
+    VALIDATE_CONSISTENCY();
+    return true;
+}
+
+void BufferQueueCore::updateActiveBufferPeakLocked() {
+    mActiveBufferPeak = std::max(mActiveBufferPeak, mActiveBuffers.size());
+}
+
 bool BufferQueueCore::adjustAvailableSlotsLocked(int delta) {
     if (delta >= 0) {
         // If we're going to fail, do so before modifying anything
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <inttypes.h>
 
 #define LOG_TAG "BufferQueueProducer"
@@ -358,8 +359,15 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
                                             uint64_t usage, uint64_t* outBufferAge,
                                             FrameEventHistoryDelta* outTimestamps) {
     ATRACE_CALL();
+    status_t returnFlags = NO_ERROR;
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    EGLSyncKHR eglFence = EGL_NO_SYNC_KHR;
+    bool attachedByConsumer = false;
+    sp<IConsumerListener> consumerListener;
+
     { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        std::unique_lock<std::mutex> lock =
+                mCore->lockCounted(BufferQueueCore::LockSide::Producer);
         mConsumerName = mCore->mConsumerName;
 
         if (mCore->mIsAbandoned) {
@@ -371,22 +379,18 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
             BQ_LOGE("dequeueBuffer: BufferQueue has no connected producer");
             return NO_INIT;
         }
-    } // Autolock scope
 
-    BQ_LOGV("dequeueBuffer: w=%u h=%u format=%#x, usage=%#" PRIx64, width, height, format, usage);
+        BQ_LOGV("dequeueBuffer: w=%u h=%u format=%#x, usage=%#" PRIx64, width, height, format,
+                usage);
 
-    if ((width && !height) || (!width && height)) {
-        BQ_LOGE("dequeueBuffer: invalid size: w=%u h=%u", width, height);
-        return BAD_VALUE;
-    }
+        if ((width && !height) || (!width && height)) {
+            BQ_LOGE("dequeueBuffer: invalid size: w=%u h=%u", width, height);
+            return BAD_VALUE;
+        }
 
-    status_t returnFlags = NO_ERROR;
-    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
-    EGLSyncKHR eglFence = EGL_NO_SYNC_KHR;
-    bool attachedByConsumer = false;
-
-    { // Autolock scope
-        std::unique_lock<std::mutex> lock(mCore->mMutex);
+        // Taken here so that reporting frame timestamps below doesn't need to
+        // lock mMutex a second time
+        consumerListener = mCore->mConsumerListener;
 
         // If we don't have a free buffer, but we are currently allocating, we wait until allocation
         // is finished such that we don't allocate in parallel.
@@ -454,6 +458,7 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
 
         if (mCore->mSharedBufferSlot != found) {
             mCore->mActiveBuffers.insert(found);
+            mCore->updateActiveBufferPeakLocked();
         }
         *outSlot = found;
         ATRACE_BUFFER_INDEX(found);
@@ -574,7 +579,7 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
     if (outBufferAge) {
         *outBufferAge = mCore->mBufferAge;
     }
-    addAndGetFrameTimestamps(nullptr, outTimestamps);
+    addAndGetFrameTimestamps(consumerListener, nullptr, outTimestamps);
 
     return returnFlags;
 }
@@ -755,6 +760,7 @@ status_t BufferQueueProducer::attachBuffer(int* outSlot,
     mSlots[*outSlot].mAcquireCalled = false;
     mSlots[*outSlot].mNeedsReallocation = false;
     mCore->mActiveBuffers.insert(found);
+    mCore->updateActiveBufferPeakLocked();
     VALIDATE_CONSISTENCY();
 
     return returnFlags;
@@ -800,11 +806,14 @@ status_t BufferQueueProducer::queueBuffer(int slot,
 
     sp<IConsumerListener> frameAvailableListener;
     sp<IConsumerListener> frameReplacedListener;
+    sp<IConsumerListener> releasedListener;
     int callbackTicket = 0;
     uint64_t currentFrameNumber = 0;
     BufferItem item;
+    sp<IConsumerListener> consumerListener;
     { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        std::unique_lock<std::mutex> lock =
+                mCore->lockCounted(BufferQueueCore::LockSide::Producer);
 
         if (mCore->mIsAbandoned) {
             BQ_LOGE("queueBuffer: BufferQueue has been abandoned");
@@ -905,6 +914,7 @@ status_t BufferQueueProducer::queueBuffer(int slot,
             mCore->mSharedBufferCache.dataspace = dataSpace;
         }
 
+        consumerListener = mCore->mConsumerListener;
         output->bufferReplaced = false;
         if (mCore->mQueue.empty()) {
             // When the queue is empty, we can ignore mDequeueBufferCannotBlock
@@ -958,6 +968,9 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         ATRACE_INT(mCore->mConsumerName.string(),
                 static_cast<int32_t>(mCore->mQueue.size()));
         mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
+        if (mCore->trimSpareBufferLocked()) {
+            releasedListener = mCore->mConsumerListener;
+        }
 
         // Take a ticket for the callback functions
         callbackTicket = mNextCallbackTicket++;
@@ -1001,6 +1014,11 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         mCallbackCondition.notify_all();
     }
 
+    // A spare buffer was trimmed, let the consumer drop its reference too
+    if (releasedListener != nullptr) {
+        releasedListener->onBuffersReleased();
+    }
+
     // Update and get FrameEventHistory.
     nsecs_t postedTime = systemTime(SYSTEM_TIME_MONOTONIC);
     NewFrameEventsEntry newFrameEventsEntry = {
@@ -1009,7 +1027,7 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         requestedPresentTimestamp,
         std::move(acquireFenceTime)
     };
-    addAndGetFrameTimestamps(&newFrameEventsEntry,
+    addAndGetFrameTimestamps(consumerListener, &newFrameEventsEntry,
             getFrameTimestamps ? &output->frameTimestamps : nullptr);
 
     // Wait without lock held
@@ -1026,7 +1044,7 @@ status_t BufferQueueProducer::queueBuffer(int slot,
 status_t BufferQueueProducer::cancelBuffer(int slot, const sp<Fence>& fence) {
     ATRACE_CALL();
     BQ_LOGV("cancelBuffer: slot %d", slot);
-    std::lock_guard<std::mutex> lock(mCore->mMutex);
+    std::unique_lock<std::mutex> lock = mCore->lockCounted(BufferQueueCore::LockSide::Producer);
 
     if (mCore->mIsAbandoned) {
         BQ_LOGE("cancelBuffer: BufferQueue has been abandoned");
@@ -1445,6 +1463,132 @@ void BufferQueueProducer::allocateBuffers(uint32_t width, uint32_t height,
     }
 }
 
+void BufferQueueProducer::reallocateBuffers(uint32_t width, uint32_t height,
+        PixelFormat format, uint64_t usage) {
+    ATRACE_CALL();
+    while (true) {
+        int slot = BufferQueueCore::INVALID_BUFFER_SLOT;
+        sp<GraphicBuffer> replacedBuffer;
+        uint32_t allocWidth = 0;
+        uint32_t allocHeight = 0;
+        PixelFormat allocFormat = PIXEL_FORMAT_UNKNOWN;
+        uint64_t allocUsage = 0;
+        std::string allocName;
+        { // Autolock scope
+            std::unique_lock<std::mutex> lock(mCore->mMutex);
+            mCore->waitWhileAllocatingLocked(lock);
+
+            if (mCore->mIsAbandoned) {
+                BQ_LOGE("reallocateBuffers: BufferQueue has been abandoned");
+                return;
+            }
+
+            if (!mCore->mAllowAllocation) {
+                BQ_LOGE("reallocateBuffers: allocation is not allowed for this "
+                        "BufferQueue");
+                return;
+            }
+
+            allocWidth = width > 0 ? width : mCore->mDefaultWidth;
+            allocHeight = height > 0 ? height : mCore->mDefaultHeight;
+            allocFormat = format != 0 ? format : mCore->mDefaultBufferFormat;
+            allocUsage = usage | mCore->mConsumerUsageBits;
+            allocName.assign(mCore->mConsumerName.string(), mCore->mConsumerName.size());
+
+            // Fill empty slots first, then replace free buffers that don't
+            // match. The shared buffer can't be reallocated.
+            if (!mCore->mFreeSlots.empty()) {
+                slot = *mCore->mFreeSlots.begin();
+            } else {
+                for (int s : mCore->mFreeBuffers) {
+                    const sp<GraphicBuffer>& buffer(mSlots[s].mGraphicBuffer);
+                    if (s != mCore->mSharedBufferSlot && buffer != nullptr &&
+                            buffer->needsReallocation(allocWidth, allocHeight,
+                                    allocFormat, BQ_LAYER_COUNT, allocUsage)) {
+                        slot = s;
+                        replacedBuffer = buffer;
+                        break;
+                    }
+                }
+            }
+            if (slot == BufferQueueCore::INVALID_BUFFER_SLOT) {
+                return;
+            }
+
+            mCore->mIsAllocating = true;
+        } // Autolock scope
+
+        sp<GraphicBuffer> graphicBuffer = new GraphicBuffer(
+                allocWidth, allocHeight, allocFormat, BQ_LAYER_COUNT,
+                allocUsage, allocName);
+        status_t result = graphicBuffer->initCheck();
+
+        { // Autolock scope
+            std::unique_lock<std::mutex> lock(mCore->mMutex);
+            mCore->mIsAllocating = false;
+            mCore->mIsAllocatingCondition.notify_all();
+
+            if (result != NO_ERROR) {
+                BQ_LOGE("reallocateBuffers: failed to allocate buffer (%u x %u, "
+                        "format %u, usage %#" PRIx64 ")", allocWidth, allocHeight,
+                        allocFormat, allocUsage);
+                return;
+            }
+
+            uint32_t checkWidth = width > 0 ? width : mCore->mDefaultWidth;
+            uint32_t checkHeight = height > 0 ? height : mCore->mDefaultHeight;
+            PixelFormat checkFormat = format != 0 ?
+                    format : mCore->mDefaultBufferFormat;
+            uint64_t checkUsage = usage | mCore->mConsumerUsageBits;
+            if (checkWidth != allocWidth || checkHeight != allocHeight ||
+                checkFormat != allocFormat || checkUsage != allocUsage) {
+                // Something changed while we released the lock. Retry.
+                BQ_LOGV("reallocateBuffers: size/format/usage changed while "
+                        "allocating. Retrying.");
+                continue;
+            }
+
+            // Only hand the buffer over if the slot was left untouched, which
+            // means it is still free and nobody can be using it.
+            if (replacedBuffer == nullptr) {
+                if (mCore->mFreeSlots.erase(slot) == 0) {
+                    BQ_LOGV("reallocateBuffers: slot %d was occupied while "
+                            "allocating. Retrying.", slot);
+                    continue;
+                }
+            } else {
+                auto freeBuffer = std::find(mCore->mFreeBuffers.begin(),
+                        mCore->mFreeBuffers.end(), slot);
+                if (freeBuffer == mCore->mFreeBuffers.end() ||
+                        mSlots[slot].mGraphicBuffer != replacedBuffer) {
+                    BQ_LOGV("reallocateBuffers: slot %d was used while "
+                            "allocating. Retrying.", slot);
+                    continue;
+                }
+                mCore->mFreeBuffers.erase(freeBuffer);
+            }
+
+            // clearBufferSlotLocked marks the slot as needing reallocation, so
+            // the producer requests the new buffer on its next dequeue.
+            mCore->clearBufferSlotLocked(slot);
+            graphicBuffer->setGenerationNumber(mCore->mGenerationNumber);
+            mSlots[slot].mGraphicBuffer = graphicBuffer;
+            mSlots[slot].mFence = Fence::NO_FENCE;
+            mCore->mFreeBuffers.push_front(slot);
+
+            BQ_LOGV("reallocateBuffers: %s a buffer in slot %d",
+                    replacedBuffer != nullptr ? "replaced" : "allocated", slot);
+            VALIDATE_CONSISTENCY();
+
+            // If dequeue is waiting for to allocate a buffer, release the lock until it's not
+            // waiting anymore so it can use the buffer we just allocated.
+            while (mDequeueWaitingForAllocation) {
+                mDequeueWaitingForAllocationCondition.wait(lock);
+            }
+        } // Autolock scope
+    }
+}
+
 status_t BufferQueueProducer::allowAllocation(bool allow) {
     ATRACE_CALL();
     BQ_LOGV("allowAllocation: %s", allow ? "true" : "false");
@@ -1553,10 +1697,35 @@ status_t BufferQueueProducer::getLastQueuedBuffer(sp<GraphicBuffer>* outBuffer,
 }
 
 void BufferQueueProducer::getFrameTimestamps(FrameEventHistoryDelta* outDelta) {
-    addAndGetFrameTimestamps(nullptr, outDelta);
+    sp<IConsumerListener> listener;
+    {
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        listener = mCore->mConsumerListener;
+    }
+    addAndGetFrameTimestamps(listener, nullptr, outDelta);
+}
+
+status_t BufferQueueProducer::getFrameTimestampsMemory(sp<IMemory>* outMemory) {
+    ATRACE_CALL();
+    sp<IConsumerListener> listener;
+    {
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        if (mCore->mIsAbandoned) {
+            BQ_LOGE("getFrameTimestampsMemory: BufferQueue has been abandoned");
+            return NO_INIT;
+        }
+        listener = mCore->mConsumerListener;
+    }
+    sp<IMemory> memory = listener != nullptr ? listener->getFrameTimestampsMemory() : nullptr;
+    if (memory == nullptr) {
+        return INVALID_OPERATION;
+    }
+    *outMemory = memory;
+    return NO_ERROR;
 }
 
 void BufferQueueProducer::addAndGetFrameTimestamps(
+        const sp<IConsumerListener>& listener,
         const NewFrameEventsEntry* newTimestamps,
         FrameEventHistoryDelta* outDelta) {
     if (newTimestamps == nullptr && outDelta == nullptr) {
@@ -1565,11 +1734,6 @@ void BufferQueueProducer::addAndGetFrameTimestamps(
 
     ATRACE_CALL();
     BQ_LOGV("addAndGetFrameTimestamps");
-    sp<IConsumerListener> listener;
-    {
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
-        listener = mCore->mConsumerListener;
-    }
     if (listener != nullptr) {
         listener->addAndGetFrameTimestamps(newTimestamps, outDelta);
     }
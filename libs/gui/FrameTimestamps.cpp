@@ -19,8 +19,11 @@
 #define LOG_TAG "FrameEvents"
 
 #include <android-base/stringprintf.h>
+#include <binder/MemoryBase.h>
+#include <binder/MemoryHeapBase.h>
 #include <cutils/compiler.h>  // For CC_[UN]LIKELY
 #include <inttypes.h>
+#include <sys/mman.h>
 #include <utils/Log.h>
 
 #include <algorithm>
@@ -313,6 +316,16 @@ void ProducerFrameEventHistory::updateSignalTimes() {
     mReleaseTimeline.updateSignalTimes();
 }
 
+void ProducerFrameEventHistory::setSharedTimestampsMemory(const sp<IMemory>& memory) {
+    mSharedTimestamps = memory != nullptr ? SharedFrameTimestamps::map(memory) : nullptr;
+}
+
+void ProducerFrameEventHistory::applySharedTimestamps(FrameEvents* frame) const {
+    if (mSharedTimestamps != nullptr) {
+        mSharedTimestamps->read(frame);
+    }
+}
+
 void ProducerFrameEventHistory::applyFenceDelta(FenceTimeline* timeline,
         std::shared_ptr<FenceTime>* dst, const FenceTime::Snapshot& src) const {
     if (CC_UNLIKELY(dst == nullptr || dst->get() == nullptr)) {
@@ -324,6 +337,11 @@ void ProducerFrameEventHistory::applyFenceDelta(FenceTimeline* timeline,
         case FenceTime::Snapshot::State::EMPTY:
             return;
         case FenceTime::Snapshot::State::FENCE:
+            if ((*dst)->isValid() &&
+                    (*dst)->getCachedSignalTime() != Fence::SIGNAL_TIME_PENDING) {
+                // Already read from the consumer's shared timestamps.
+                return;
+            }
             ALOGE_IF((*dst)->isValid(), "applyFenceDelta: Unexpected fence.");
             *dst = createFenceTime(src.fence);
             timeline->push(*dst);
@@ -381,6 +399,7 @@ void ConsumerFrameEventHistory::addQueue(const NewFrameEventsEntry& newEntry) {
     mFramesDirty[mQueueOffset].setDirty<FrameEvent::POSTED>();
 
     mQueueOffset = (mQueueOffset + 1) % mFrames.size();
+    publishSharedTimestamps();
 }
 
 void ConsumerFrameEventHistory::addLatch(
@@ -392,6 +411,7 @@ void ConsumerFrameEventHistory::addLatch(
     }
     frame->latchTime = latchTime;
     mFramesDirty[mCompositionOffset].setDirty<FrameEvent::LATCH>();
+    publishSharedTimestamps();
 }
 
 void ConsumerFrameEventHistory::addPreComposition(
@@ -408,6 +428,7 @@ void ConsumerFrameEventHistory::addPreComposition(
         frame->firstRefreshStartTime = refreshStartTime;
         mFramesDirty[mCompositionOffset].setDirty<FrameEvent::FIRST_REFRESH_START>();
     }
+    publishSharedTimestamps();
 }
 
 void ConsumerFrameEventHistory::addPostComposition(uint64_t frameNumber,
@@ -432,6 +453,7 @@ void ConsumerFrameEventHistory::addPostComposition(uint64_t frameNumber,
             mFramesDirty[mCompositionOffset].setDirty<FrameEvent::DISPLAY_PRESENT>();
         }
     }
+    publishSharedTimestamps();
 }
 
 void ConsumerFrameEventHistory::addRelease(uint64_t frameNumber,
@@ -445,6 +467,7 @@ void ConsumerFrameEventHistory::addRelease(uint64_t frameNumber,
     frame->dequeueReadyTime = dequeueReadyTime;
     frame->releaseFence = std::move(release);
     mFramesDirty[mReleaseOffset].setDirty<FrameEvent::RELEASE>();
+    publishSharedTimestamps();
 }
 
 void ConsumerFrameEventHistory::getFrameDelta(
@@ -481,6 +504,30 @@ void ConsumerFrameEventHistory::getAndResetDelta(
     }
 }
 
+sp<IMemory> ConsumerFrameEventHistory::getSharedTimestampsMemory() {
+    if (mSharedTimestamps == nullptr) {
+        mSharedTimestamps = SharedFrameTimestamps::create();
+        if (mSharedTimestamps == nullptr) {
+            return nullptr;
+        }
+        publishSharedTimestamps();
+    }
+    return mSharedTimestamps->getMemory();
+}
+
+void ConsumerFrameEventHistory::publishSharedTimestamps() {
+    if (mSharedTimestamps == nullptr) {
+        return;
+    }
+    // Fences of earlier frames may have signaled since they were last
+    // published, so every frame is republished.
+    for (size_t i = 0; i < mFrames.size(); i++) {
+        if (mFrames[i].valid && mFrames[i].connectId == mCurrentConnectId) {
+            mSharedTimestamps->publish(i, mFrames[i]);
+        }
+    }
+}
+
 
 // ============================================================================
 // FrameEventsDelta
@@ -701,4 +748,173 @@ status_t FrameEventHistoryDelta::unflatten(
 }
 
 
+// ============================================================================
+// SharedFrameTimestamps
+// ============================================================================
+
+namespace {
+
+// Flags of SharedFrameTimestamps::Layout::Entry
+constexpr uint32_t kPostCompositeFinal = 1 << 0;
+constexpr uint32_t kReleaseFinal = 1 << 1;
+
+// The published value of a fence: its signal time, SIGNAL_TIME_INVALID if
+// there is no fence, or TIMESTAMP_PENDING if it hasn't signaled yet.
+nsecs_t publishedSignalTime(const std::shared_ptr<FenceTime>& fence) {
+    if (!fence->isValid()) {
+        return Fence::SIGNAL_TIME_INVALID;
+    }
+    const nsecs_t signalTime = fence->getCachedSignalTime();
+    return signalTime == Fence::SIGNAL_TIME_PENDING ? FrameEvents::TIMESTAMP_PENDING : signalTime;
+}
+
+void applyPublishedSignalTime(std::shared_ptr<FenceTime>* dst, nsecs_t signalTime) {
+    if (!(*dst)->isValid() && signalTime != Fence::SIGNAL_TIME_INVALID) {
+        *dst = std::make_shared<FenceTime>(signalTime);
+    }
+}
+
+} // namespace
+
+struct SharedFrameTimestamps::Layout {
+    // Every field is atomic since the producer reads while the consumer
+    // writes. A read is only used if sequence was even and unchanged across it.
+    struct Entry {
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint32_t> flags;
+        std::atomic<uint64_t> frameNumber;
+        std::atomic<int64_t> latchTime;
+        std::atomic<int64_t> firstRefreshStartTime;
+        std::atomic<int64_t> lastRefreshStartTime;
+        std::atomic<int64_t> dequeueReadyTime;
+        std::atomic<int64_t> gpuCompositionDoneTime;
+        std::atomic<int64_t> displayPresentTime;
+        std::atomic<int64_t> releaseTime;
+    };
+    static_assert(std::atomic<int64_t>::is_always_lock_free,
+                  "SharedFrameTimestamps requires lock-free 64-bit atomics");
+
+    std::array<Entry, FrameEventHistory::MAX_FRAME_HISTORY> entries;
+};
+
+SharedFrameTimestamps::SharedFrameTimestamps(const sp<IMemory>& memory, Layout* layout)
+      : mMemory(memory), mLayout(layout) {}
+
+SharedFrameTimestamps::~SharedFrameTimestamps() = default;
+
+std::unique_ptr<SharedFrameTimestamps> SharedFrameTimestamps::create() {
+    sp<MemoryHeapBase> heap = new MemoryHeapBase(sizeof(Layout), MemoryHeapBase::READ_ONLY,
+                                                 "FrameTimestamps");
+    if (heap->getHeapID() < 0 || heap->getBase() == MAP_FAILED) {
+        ALOGE("SharedFrameTimestamps: failed to allocate shared memory");
+        return nullptr;
+    }
+    // The heap starts zero-filled, so every entry reads as frame 0, which is
+    // never queued.
+    sp<IMemory> memory = new MemoryBase(heap, 0, sizeof(Layout));
+    return std::unique_ptr<SharedFrameTimestamps>(
+            new SharedFrameTimestamps(memory, static_cast<Layout*>(heap->getBase())));
+}
+
+std::unique_ptr<SharedFrameTimestamps> SharedFrameTimestamps::map(const sp<IMemory>& memory) {
+    void* base = memory->pointer();
+    if (base == nullptr || memory->size() < sizeof(Layout)) {
+        ALOGE("SharedFrameTimestamps: invalid shared memory");
+        return nullptr;
+    }
+    return std::unique_ptr<SharedFrameTimestamps>(
+            new SharedFrameTimestamps(memory, static_cast<Layout*>(base)));
+}
+
+void SharedFrameTimestamps::publish(size_t index, const FrameEvents& frame) {
+    Layout::Entry& entry = mLayout->entries[index];
+
+    const nsecs_t gpuCompositionDoneTime = publishedSignalTime(frame.gpuCompositionDoneFence);
+    const nsecs_t displayPresentTime = publishedSignalTime(frame.displayPresentFence);
+    const nsecs_t releaseTime = publishedSignalTime(frame.releaseFence);
+    uint32_t flags = 0;
+    if (frame.addPostCompositeCalled && FrameEvents::isValidTimestamp(gpuCompositionDoneTime) &&
+        FrameEvents::isValidTimestamp(displayPresentTime)) {
+        flags |= kPostCompositeFinal;
+    }
+    if (frame.addReleaseCalled && FrameEvents::isValidTimestamp(releaseTime)) {
+        flags |= kReleaseFinal;
+    }
+
+    const uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+    entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    entry.flags.store(flags, std::memory_order_relaxed);
+    entry.frameNumber.store(frame.frameNumber, std::memory_order_relaxed);
+    entry.latchTime.store(frame.latchTime, std::memory_order_relaxed);
+    entry.firstRefreshStartTime.store(frame.firstRefreshStartTime, std::memory_order_relaxed);
+    entry.lastRefreshStartTime.store(frame.lastRefreshStartTime, std::memory_order_relaxed);
+    entry.dequeueReadyTime.store(frame.dequeueReadyTime, std::memory_order_relaxed);
+    entry.gpuCompositionDoneTime.store(gpuCompositionDoneTime, std::memory_order_relaxed);
+    entry.displayPresentTime.store(displayPresentTime, std::memory_order_relaxed);
+    entry.releaseTime.store(releaseTime, std::memory_order_relaxed);
+
+    entry.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void SharedFrameTimestamps::read(FrameEvents* frame) const {
+    // The consumer rewrites an entry a few times per frame at most, so a read
+    // that keeps racing with it gives up rather than spinning.
+    constexpr int kMaxReadAttempts = 4;
+
+    for (const Layout::Entry& entry : mLayout->entries) {
+        if (entry.frameNumber.load(std::memory_order_relaxed) != frame->frameNumber) {
+            continue;
+        }
+        for (int attempt = 0; attempt < kMaxReadAttempts; attempt++) {
+            const uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+            if (sequence & 1) {
+                continue;
+            }
+            const uint32_t flags = entry.flags.load(std::memory_order_relaxed);
+            const uint64_t frameNumber = entry.frameNumber.load(std::memory_order_relaxed);
+            const nsecs_t latchTime = entry.latchTime.load(std::memory_order_relaxed);
+            const nsecs_t firstRefreshStartTime =
+                    entry.firstRefreshStartTime.load(std::memory_order_relaxed);
+            const nsecs_t lastRefreshStartTime =
+                    entry.lastRefreshStartTime.load(std::memory_order_relaxed);
+            const nsecs_t dequeueReadyTime = entry.dequeueReadyTime.load(std::memory_order_relaxed);
+            const nsecs_t gpuCompositionDoneTime =
+                    entry.gpuCompositionDoneTime.load(std::memory_order_relaxed);
+            const nsecs_t displayPresentTime =
+                    entry.displayPresentTime.load(std::memory_order_relaxed);
+            const nsecs_t releaseTime = entry.releaseTime.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.sequence.load(std::memory_order_relaxed) != sequence) {
+                continue;
+            }
+            if (frameNumber != frame->frameNumber) {
+                // The entry was reused for a newer frame.
+                return;
+            }
+
+            if (!frame->hasLatchInfo()) {
+                frame->latchTime = latchTime;
+            }
+            if (!frame->hasFirstRefreshStartInfo()) {
+                frame->firstRefreshStartTime = firstRefreshStartTime;
+            }
+            if (!frame->addPostCompositeCalled && (flags & kPostCompositeFinal)) {
+                applyPublishedSignalTime(&frame->gpuCompositionDoneFence, gpuCompositionDoneTime);
+                applyPublishedSignalTime(&frame->displayPresentFence, displayPresentTime);
+                frame->addPostCompositeCalled = true;
+            }
+            if (!frame->addReleaseCalled && (flags & kReleaseFinal)) {
+                frame->lastRefreshStartTime = lastRefreshStartTime;
+                frame->dequeueReadyTime = dequeueReadyTime;
+                applyPublishedSignalTime(&frame->releaseFence, releaseTime);
+                frame->addReleaseCalled = true;
+            }
+            return;
+        }
+        return;
+    }
+}
+
 } // namespace android
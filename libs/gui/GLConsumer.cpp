@@ -259,6 +259,7 @@ status_t GLConsumer::releaseTexImage() {
             // so... basically, nothing more to do here.
         }
 
+        unlockCurrentBufferLocked();
         err = releaseBufferLocked(buf, mSlots[buf].mGraphicBuffer, mEglDisplay, EGL_NO_SYNC_KHR);
         if (err < NO_ERROR) {
             GLC_LOGE("releaseTexImage: failed to release buffer: %s (%d)",
@@ -414,6 +415,9 @@ status_t GLConsumer::updateAndReleaseLocked(const BufferItem& item,
     // the same.
     sp<EglImage> nextTextureImage = mEglSlots[slot].mEglImage;
 
+    // End any CPU access to the old buffer before it goes back to the queue.
+    unlockCurrentBufferLocked();
+
     // release old buffer
     if (mCurrentTexture != BufferQueue::INVALID_BUFFER_SLOT) {
         if (pendingRelease == nullptr) {
@@ -905,6 +909,7 @@ status_t GLConsumer::doGLFenceWaitLocked() const {
 void GLConsumer::freeBufferLocked(int slotIndex) {
     GLC_LOGV("freeBufferLocked: slotIndex=%d", slotIndex);
     if (slotIndex == mCurrentTexture) {
+        unlockCurrentBufferLocked();
         mCurrentTexture = BufferQueue::INVALID_BUFFER_SLOT;
     }
     mEglSlots[slotIndex].mEglImage.clear();
@@ -913,10 +918,92 @@ void GLConsumer::freeBufferLocked(int slotIndex) {
 
 void GLConsumer::abandonLocked() {
     GLC_LOGV("abandonLocked");
+    unlockCurrentBufferLocked();
     mCurrentTextureImage.clear();
     ConsumerBase::abandonLocked();
 }
 
+status_t GLConsumer::lockCurrentBuffer(void** outData) {
+    ATRACE_CALL();
+    Mutex::Autolock lock(mMutex);
+    return lockCurrentBufferLocked(outData, nullptr);
+}
+
+status_t GLConsumer::lockCurrentBufferYCbCr(android_ycbcr* outYCbCr) {
+    ATRACE_CALL();
+    if (outYCbCr == nullptr) {
+        return BAD_VALUE;
+    }
+    Mutex::Autolock lock(mMutex);
+    return lockCurrentBufferLocked(nullptr, outYCbCr);
+}
+
+status_t GLConsumer::unlockCurrentBuffer() {
+    ATRACE_CALL();
+    Mutex::Autolock lock(mMutex);
+    if (mLockedBuffer == nullptr) {
+        GLC_LOGE("unlockCurrentBuffer: the current buffer is not locked");
+        return INVALID_OPERATION;
+    }
+    return unlockCurrentBufferLocked();
+}
+
+status_t GLConsumer::lockCurrentBufferLocked(void** outData, android_ycbcr* outYCbCr) {
+    if (mAbandoned) {
+        GLC_LOGE("lockCurrentBuffer: GLConsumer is abandoned!");
+        return NO_INIT;
+    }
+
+    if (mLockedBuffer != nullptr) {
+        GLC_LOGE("lockCurrentBuffer: the current buffer is already locked");
+        return INVALID_OPERATION;
+    }
+
+    if (mCurrentTexture == BufferQueue::INVALID_BUFFER_SLOT || mCurrentTextureImage == nullptr) {
+        GLC_LOGE("lockCurrentBuffer: no current buffer");
+        return INVALID_OPERATION;
+    }
+
+    const sp<GraphicBuffer>& buffer = mCurrentTextureImage->graphicBuffer();
+    const Rect bounds(buffer->getWidth(), buffer->getHeight());
+    int fenceFd = mCurrentFence.get() ? mCurrentFence->dup() : -1;
+    status_t err = outYCbCr != nullptr
+            ? buffer->lockAsyncYCbCr(GraphicBuffer::USAGE_SW_READ_OFTEN, bounds, outYCbCr,
+                                     fenceFd)
+            : buffer->lockAsync(GraphicBuffer::USAGE_SW_READ_OFTEN, bounds, outData, fenceFd);
+    if (err != NO_ERROR) {
+        GLC_LOGE("lockCurrentBuffer: unable to lock buffer for CPU reading: %s (%d)",
+                strerror(-err), err);
+        return err;
+    }
+
+    mLockedBuffer = buffer;
+    return NO_ERROR;
+}
+
+status_t GLConsumer::unlockCurrentBufferLocked() {
+    if (mLockedBuffer == nullptr) {
+        return NO_ERROR;
+    }
+
+    int fenceFd = -1;
+    status_t err = mLockedBuffer->unlockAsync(&fenceFd);
+    if (err != NO_ERROR) {
+        GLC_LOGE("unlockCurrentBuffer: unable to unlock buffer: %s (%d)",
+                strerror(-err), err);
+    } else if (fenceFd >= 0) {
+        sp<Fence> fence = new Fence(fenceFd);
+        if (mCurrentTexture != BufferQueue::INVALID_BUFFER_SLOT) {
+            err = addReleaseFenceLocked(mCurrentTexture, mLockedBuffer, fence);
+        } else {
+            err = fence->waitForever("GLConsumer::unlockCurrentBufferLocked");
+        }
+    }
+
+    mLockedBuffer.clear();
+    return err;
+}
+
 status_t GLConsumer::setConsumerUsageBits(uint64_t usage) {
     return ConsumerBase::setConsumerUsageBits(usage | DEFAULT_USAGE_FLAGS);
 }
@@ -73,6 +73,10 @@ enum {
     GET_UNIQUE_ID,
     GET_CONSUMER_USAGE,
     SET_LEGACY_BUFFER_DROP,
+    REALLOCATE_BUFFERS,
+    GET_FRAME_TIMESTAMPS_MEMORY,
+    DEQUEUE_BUFFERS,
+    QUEUE_BUFFERS,
 };
 
 class BpGraphicBufferProducer : public BpInterface<IGraphicBufferProducer>
@@ -182,6 +186,84 @@ public:
         return result;
     }
 
+    virtual status_t dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                                    std::vector<DequeueBufferOutput>* outputs) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeUint32(static_cast<uint32_t>(inputs.size()));
+        for (const auto& input : inputs) {
+            data.writeUint32(input.width);
+            data.writeUint32(input.height);
+            data.writeInt32(static_cast<int32_t>(input.format));
+            data.writeUint64(input.usage);
+            data.writeBool(input.getTimestamps);
+        }
+
+        status_t result = remote()->transact(DEQUEUE_BUFFERS, data, &reply);
+        if (result != NO_ERROR) {
+            return result;
+        }
+        result = reply.readInt32();
+        if (result != NO_ERROR) {
+            return result;
+        }
+
+        std::vector<DequeueBufferOutput> dequeued(inputs.size());
+        for (size_t i = 0; i < inputs.size(); i++) {
+            DequeueBufferOutput& output = dequeued[i];
+            output.result = reply.readInt32();
+            output.slot = reply.readInt32();
+            sp<Fence> fence = new Fence();
+            result = reply.read(*fence);
+            if (result == NO_ERROR) {
+                output.fence = fence;
+                result = reply.readUint64(&output.bufferAge);
+            }
+            if (result == NO_ERROR && inputs[i].getTimestamps) {
+                result = reply.read(output.timestamps);
+            }
+            if (result != NO_ERROR) {
+                ALOGE("IGBP::dequeueBuffers failed to read output %zu: %d", i, result);
+                return result;
+            }
+        }
+        *outputs = std::move(dequeued);
+        return NO_ERROR;
+    }
+
+    virtual status_t queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                                  std::vector<QueueBufferOutput>* outputs) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeUint32(static_cast<uint32_t>(requests.size()));
+        for (const auto& request : requests) {
+            data.writeInt32(request.slot);
+            data.write(request.input);
+        }
+
+        status_t result = remote()->transact(QUEUE_BUFFERS, data, &reply);
+        if (result != NO_ERROR) {
+            return result;
+        }
+
+        const uint32_t queuedCount = reply.readUint32();
+        if (queuedCount > requests.size()) {
+            ALOGE("IGBP::queueBuffers got %u outputs for %zu buffers", queuedCount,
+                  requests.size());
+            return BAD_VALUE;
+        }
+        std::vector<QueueBufferOutput> queued(queuedCount);
+        for (auto& output : queued) {
+            result = reply.read(output);
+            if (result != NO_ERROR) {
+                ALOGE("IGBP::queueBuffers failed to read output: %d", result);
+                return result;
+            }
+        }
+        *outputs = std::move(queued);
+        return reply.readInt32();
+    }
+
     virtual status_t detachBuffer(int slot) {
         Parcel data, reply;
         data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
@@ -367,6 +449,21 @@ public:
         }
     }
 
+    virtual void reallocateBuffers(uint32_t width, uint32_t height,
+            PixelFormat format, uint64_t usage) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeUint32(width);
+        data.writeUint32(height);
+        data.writeInt32(static_cast<int32_t>(format));
+        data.writeUint64(usage);
+        status_t result = remote()->transact(REALLOCATE_BUFFERS, data, &reply,
+                IBinder::FLAG_ONEWAY);
+        if (result != NO_ERROR) {
+            ALOGE("reallocateBuffers failed to transact: %d", result);
+        }
+    }
+
     virtual status_t allowAllocation(bool allow) {
         Parcel data, reply;
         data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
@@ -510,6 +607,26 @@ public:
         }
     }
 
+    virtual status_t getFrameTimestampsMemory(sp<IMemory>* outMemory) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        status_t result = remote()->transact(GET_FRAME_TIMESTAMPS_MEMORY, data, &reply);
+        if (result != NO_ERROR) {
+            ALOGE("getFrameTimestampsMemory failed to transact: %d", result);
+            return result;
+        }
+        result = reply.readInt32();
+        if (result != NO_ERROR) {
+            return result;
+        }
+        sp<IMemory> memory = interface_cast<IMemory>(reply.readStrongBinder());
+        if (memory == nullptr) {
+            return BAD_VALUE;
+        }
+        *outMemory = memory;
+        return NO_ERROR;
+    }
+
     virtual status_t getUniqueId(uint64_t* outId) const {
         Parcel data, reply;
         data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
@@ -628,6 +745,11 @@ public:
         return mBase->allocateBuffers(width, height, format, usage);
     }
 
+    void reallocateBuffers(uint32_t width, uint32_t height,
+            PixelFormat format, uint64_t usage) override {
+        return mBase->reallocateBuffers(width, height, format, usage);
+    }
+
     status_t allowAllocation(bool allow) override {
         return mBase->allowAllocation(allow);
     }
@@ -668,6 +790,20 @@ public:
         return mBase->getFrameTimestamps(outDelta);
     }
 
+    status_t getFrameTimestampsMemory(sp<IMemory>* outMemory) override {
+        return mBase->getFrameTimestampsMemory(outMemory);
+    }
+
+    status_t dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                            std::vector<DequeueBufferOutput>* outputs) override {
+        return mBase->dequeueBuffers(inputs, outputs);
+    }
+
+    status_t queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                          std::vector<QueueBufferOutput>* outputs) override {
+        return mBase->queueBuffers(requests, outputs);
+    }
+
     status_t getUniqueId(uint64_t* outId) const override {
         return mBase->getUniqueId(outId);
     }
@@ -688,6 +824,62 @@ status_t IGraphicBufferProducer::setLegacyBufferDrop(bool drop) {
     return INVALID_OPERATION;
 }
 
+status_t IGraphicBufferProducer::dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                                                std::vector<DequeueBufferOutput>* outputs) {
+    if (inputs.size() > BufferQueueDefs::NUM_BUFFER_SLOTS) {
+        return BAD_VALUE;
+    }
+    std::vector<DequeueBufferOutput> dequeued(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const DequeueBufferInput& input = inputs[i];
+        DequeueBufferOutput& output = dequeued[i];
+        status_t result = dequeueBuffer(&output.slot, &output.fence, input.width, input.height,
+                                        input.format, input.usage, &output.bufferAge,
+                                        input.getTimestamps ? &output.timestamps : nullptr);
+        if (result < 0) {
+            // Hand back what was already dequeued so that the batch either
+            // fully succeeds or leaves the queue as it was.
+            for (size_t j = 0; j < i; j++) {
+                cancelBuffer(dequeued[j].slot, dequeued[j].fence);
+            }
+            return result;
+        }
+        output.result = result;
+    }
+    *outputs = std::move(dequeued);
+    return NO_ERROR;
+}
+
+status_t IGraphicBufferProducer::queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                                              std::vector<QueueBufferOutput>* outputs) {
+    if (requests.size() > BufferQueueDefs::NUM_BUFFER_SLOTS) {
+        return BAD_VALUE;
+    }
+    outputs->clear();
+    outputs->reserve(requests.size());
+    for (const auto& request : requests) {
+        QueueBufferOutput output;
+        status_t result = queueBuffer(request.slot, request.input, &output);
+        if (result != NO_ERROR) {
+            return result;
+        }
+        outputs->push_back(std::move(output));
+    }
+    return NO_ERROR;
+}
+
+status_t IGraphicBufferProducer::getFrameTimestampsMemory(sp<IMemory>* outMemory) {
+    // Only a BufferQueue in the consumer's process can share timestamps.
+    (void) outMemory;
+    return INVALID_OPERATION;
+}
+
+void IGraphicBufferProducer::reallocateBuffers(uint32_t width, uint32_t height,
+        PixelFormat format, uint64_t usage) {
+    // Fall back to only filling empty slots for IGBP other than BufferQueue.
+    allocateBuffers(width, height, format, usage);
+}
+
 status_t IGraphicBufferProducer::exportToParcel(Parcel* parcel) {
     status_t res = OK;
     res = parcel->writeUint32(USE_BUFFER_QUEUE);
@@ -929,6 +1121,15 @@ status_t BnGraphicBufferProducer::onTransact(
             allocateBuffers(width, height, format, usage);
             return NO_ERROR;
         }
+        case REALLOCATE_BUFFERS: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            uint32_t width = data.readUint32();
+            uint32_t height = data.readUint32();
+            PixelFormat format = static_cast<PixelFormat>(data.readInt32());
+            uint64_t usage = data.readUint64();
+            reallocateBuffers(width, height, format, usage);
+            return NO_ERROR;
+        }
         case ALLOW_ALLOCATION: {
             CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
             bool allow = static_cast<bool>(data.readInt32());
@@ -1050,6 +1251,69 @@ status_t BnGraphicBufferProducer::onTransact(
             reply->writeInt32(result);
             return NO_ERROR;
         }
+        case DEQUEUE_BUFFERS: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            const uint32_t count = data.readUint32();
+            if (count > BufferQueueDefs::NUM_BUFFER_SLOTS) {
+                return BAD_VALUE;
+            }
+            std::vector<DequeueBufferInput> inputs(count);
+            for (auto& input : inputs) {
+                input.width = data.readUint32();
+                input.height = data.readUint32();
+                input.format = static_cast<PixelFormat>(data.readInt32());
+                input.usage = data.readUint64();
+                input.getTimestamps = data.readBool();
+            }
+            std::vector<DequeueBufferOutput> outputs;
+            status_t result = dequeueBuffers(inputs, &outputs);
+            reply->writeInt32(result);
+            if (result != NO_ERROR) {
+                return NO_ERROR;
+            }
+            for (size_t i = 0; i < outputs.size(); i++) {
+                const DequeueBufferOutput& output = outputs[i];
+                reply->writeInt32(output.result);
+                reply->writeInt32(output.slot);
+                reply->write(*output.fence);
+                reply->writeUint64(output.bufferAge);
+                if (inputs[i].getTimestamps) {
+                    reply->write(output.timestamps);
+                }
+            }
+            return NO_ERROR;
+        }
+        case QUEUE_BUFFERS: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            const uint32_t count = data.readUint32();
+            if (count > BufferQueueDefs::NUM_BUFFER_SLOTS) {
+                return BAD_VALUE;
+            }
+            std::vector<QueueBufferRequest> requests;
+            requests.reserve(count);
+            for (uint32_t i = 0; i < count; i++) {
+                int slot = data.readInt32();
+                requests.push_back({slot, QueueBufferInput(data)});
+            }
+            std::vector<QueueBufferOutput> outputs;
+            status_t result = queueBuffers(requests, &outputs);
+            reply->writeUint32(static_cast<uint32_t>(outputs.size()));
+            for (const auto& output : outputs) {
+                reply->write(output);
+            }
+            reply->writeInt32(result);
+            return NO_ERROR;
+        }
+        case GET_FRAME_TIMESTAMPS_MEMORY: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            sp<IMemory> memory;
+            status_t result = getFrameTimestampsMemory(&memory);
+            reply->writeInt32(result);
+            if (result == NO_ERROR) {
+                reply->writeStrongBinder(IInterface::asBinder(memory));
+            }
+            return NO_ERROR;
+        }
     }
     return BBinder::onTransact(code, data, reply, flags);
 }
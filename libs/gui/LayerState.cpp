@@ -26,144 +26,284 @@
 
 namespace android {
 
+// Only the fields whose bits are set in what are flattened, so a transaction
+// that moves one layer doesn't carry, or make SurfaceFlinger parse and
+// allocate, every region, buffer and metadata map of that layer. libgui and
+// SurfaceFlinger are built together, so the layout is free to follow what.
 status_t layer_state_t::write(Parcel& output) const
 {
     output.writeStrongBinder(surface);
     output.writeUint64(what);
-    output.writeFloat(x);
-    output.writeFloat(y);
-    output.writeInt32(z);
-    output.writeUint32(w);
-    output.writeUint32(h);
-    output.writeUint32(layerStack);
-    output.writeFloat(alpha);
-    output.writeUint32(flags);
-    output.writeUint32(mask);
-    *reinterpret_cast<layer_state_t::matrix22_t *>(
-            output.writeInplace(sizeof(layer_state_t::matrix22_t))) = matrix;
-    output.write(crop_legacy);
-    output.writeStrongBinder(barrierHandle_legacy);
-    output.writeStrongBinder(reparentHandle);
-    output.writeUint64(frameNumber_legacy);
-    output.writeInt32(overrideScalingMode);
-    output.writeStrongBinder(IInterface::asBinder(barrierGbp_legacy));
-    output.writeStrongBinder(relativeLayerHandle);
-    output.writeStrongBinder(parentHandleForChild);
-    output.writeFloat(color.r);
-    output.writeFloat(color.g);
-    output.writeFloat(color.b);
+    if (what & ePositionChanged) {
+        output.writeFloat(x);
+        output.writeFloat(y);
+    }
+    if (what & (eLayerChanged | eRelativeLayerChanged)) {
+        output.writeInt32(z);
+    }
+    if (what & eSizeChanged) {
+        output.writeUint32(w);
+        output.writeUint32(h);
+    }
+    if (what & eAlphaChanged) {
+        output.writeFloat(alpha);
+    }
+    if (what & eMatrixChanged) {
+        *reinterpret_cast<layer_state_t::matrix22_t *>(
+                output.writeInplace(sizeof(layer_state_t::matrix22_t))) = matrix;
+    }
+    if (what & eTransparentRegionChanged) {
+        output.write(transparentRegion);
+    }
+    if (what & eFlagsChanged) {
+        output.writeUint32(flags);
+        output.writeUint32(mask);
+    }
+    if (what & eLayerStackChanged) {
+        output.writeUint32(layerStack);
+    }
+    if (what & eCropChanged_legacy) {
+        output.write(crop_legacy);
+    }
+    if (what & eDeferTransaction_legacy) {
+        output.writeStrongBinder(barrierHandle_legacy);
+        output.writeStrongBinder(IInterface::asBinder(barrierGbp_legacy));
+        output.writeUint64(frameNumber_legacy);
+    }
+    if (what & eOverrideScalingModeChanged) {
+        output.writeInt32(overrideScalingMode);
+    }
+    if (what & eReparentChildren) {
+        output.writeStrongBinder(reparentHandle);
+    }
+    if (what & eRelativeLayerChanged) {
+        output.writeStrongBinder(relativeLayerHandle);
+    }
+    if (what & eReparent) {
+        output.writeStrongBinder(parentHandleForChild);
+    }
+    if (what & (eColorChanged | eBackgroundColorChanged)) {
+        output.writeFloat(color.r);
+        output.writeFloat(color.g);
+        output.writeFloat(color.b);
+    }
+    if (what & eTransformChanged) {
+        output.writeUint32(transform);
+    }
+    if (what & eTransformToDisplayInverseChanged) {
+        output.writeBool(transformToDisplayInverse);
+    }
+    if (what & eCropChanged) {
+        output.write(crop);
+    }
+    if (what & eBufferChanged) {
+        if (buffer) {
+            output.writeBool(true);
+            output.write(*buffer);
+        } else {
+            output.writeBool(false);
+        }
+    }
+    if (what & eAcquireFenceChanged) {
+        if (acquireFence) {
+            output.writeBool(true);
+            output.write(*acquireFence);
+        } else {
+            output.writeBool(false);
+        }
+    }
+    if (what & eDataspaceChanged) {
+        output.writeUint32(static_cast<uint32_t>(dataspace));
+    }
+    if (what & eHdrMetadataChanged) {
+        output.write(hdrMetadata);
+    }
+    if (what & eSurfaceDamageRegionChanged) {
+        output.write(surfaceDamageRegion);
+    }
+    if (what & eApiChanged) {
+        output.writeInt32(api);
+    }
+    if (what & eSidebandStreamChanged) {
+        if (sidebandStream) {
+            output.writeBool(true);
+            output.writeNativeHandle(sidebandStream->handle());
+        } else {
+            output.writeBool(false);
+        }
+    }
+    if (what & eColorTransformChanged) {
+        memcpy(output.writeInplace(16 * sizeof(float)),
+               colorTransform.asArray(), 16 * sizeof(float));
+    }
+    if (what & eHasListenerCallbacksChanged) {
+        output.writeBool(hasListenerCallbacks);
+    }
 #ifndef NO_INPUT
-    inputInfo.write(output);
+    if (what & eInputInfoChanged) {
+        inputInfo.write(output);
+    }
 #endif
-    output.write(transparentRegion);
-    output.writeUint32(transform);
-    output.writeBool(transformToDisplayInverse);
-    output.write(crop);
-    output.write(frame);
-    if (buffer) {
-        output.writeBool(true);
-        output.write(*buffer);
-    } else {
-        output.writeBool(false);
-    }
-    if (acquireFence) {
-        output.writeBool(true);
-        output.write(*acquireFence);
-    } else {
-        output.writeBool(false);
-    }
-    output.writeUint32(static_cast<uint32_t>(dataspace));
-    output.write(hdrMetadata);
-    output.write(surfaceDamageRegion);
-    output.writeInt32(api);
-    if (sidebandStream) {
-        output.writeBool(true);
-        output.writeNativeHandle(sidebandStream->handle());
-    } else {
-        output.writeBool(false);
+    if (what & eCornerRadiusChanged) {
+        output.writeFloat(cornerRadius);
+    }
+    if (what & eFrameChanged) {
+        output.write(frame);
+    }
+    if (what & eCachedBufferChanged) {
+        output.writeWeakBinder(cachedBuffer.token);
+        output.writeUint64(cachedBuffer.id);
+    }
+    if (what & eBackgroundColorChanged) {
+        output.writeFloat(bgColorAlpha);
+        output.writeUint32(static_cast<uint32_t>(bgColorDataspace));
+    }
+    if (what & eMetadataChanged) {
+        output.writeParcelable(metadata);
+    }
+    if (what & eColorSpaceAgnosticChanged) {
+        output.writeBool(colorSpaceAgnostic);
     }
-
-    memcpy(output.writeInplace(16 * sizeof(float)),
-           colorTransform.asArray(), 16 * sizeof(float));
-    output.writeFloat(cornerRadius);
-    output.writeBool(hasListenerCallbacks);
-    output.writeWeakBinder(cachedBuffer.token);
-    output.writeUint64(cachedBuffer.id);
-    output.writeParcelable(metadata);
-
-    output.writeFloat(bgColorAlpha);
-    output.writeUint32(static_cast<uint32_t>(bgColorDataspace));
-    output.writeBool(colorSpaceAgnostic);
 
     return NO_ERROR;
 }
 
+// Fields what doesn't flag keep the values they had, usually the defaults.
 status_t layer_state_t::read(const Parcel& input)
 {
     surface = input.readStrongBinder();
     what = input.readUint64();
-    x = input.readFloat();
-    y = input.readFloat();
-    z = input.readInt32();
-    w = input.readUint32();
-    h = input.readUint32();
-    layerStack = input.readUint32();
-    alpha = input.readFloat();
-    flags = static_cast<uint8_t>(input.readUint32());
-    mask = static_cast<uint8_t>(input.readUint32());
-    const void* matrix_data = input.readInplace(sizeof(layer_state_t::matrix22_t));
-    if (matrix_data) {
-        matrix = *reinterpret_cast<layer_state_t::matrix22_t const *>(matrix_data);
-    } else {
-        return BAD_VALUE;
-    }
-    input.read(crop_legacy);
-    barrierHandle_legacy = input.readStrongBinder();
-    reparentHandle = input.readStrongBinder();
-    frameNumber_legacy = input.readUint64();
-    overrideScalingMode = input.readInt32();
-    barrierGbp_legacy = interface_cast<IGraphicBufferProducer>(input.readStrongBinder());
-    relativeLayerHandle = input.readStrongBinder();
-    parentHandleForChild = input.readStrongBinder();
-    color.r = input.readFloat();
-    color.g = input.readFloat();
-    color.b = input.readFloat();
-
+    if (what & ePositionChanged) {
+        x = input.readFloat();
+        y = input.readFloat();
+    }
+    if (what & (eLayerChanged | eRelativeLayerChanged)) {
+        z = input.readInt32();
+    }
+    if (what & eSizeChanged) {
+        w = input.readUint32();
+        h = input.readUint32();
+    }
+    if (what & eAlphaChanged) {
+        alpha = input.readFloat();
+    }
+    if (what & eMatrixChanged) {
+        const void* matrix_data = input.readInplace(sizeof(layer_state_t::matrix22_t));
+        if (matrix_data) {
+            matrix = *reinterpret_cast<layer_state_t::matrix22_t const *>(matrix_data);
+        } else {
+            return BAD_VALUE;
+        }
+    }
+    if (what & eTransparentRegionChanged) {
+        input.read(transparentRegion);
+    }
+    if (what & eFlagsChanged) {
+        flags = static_cast<uint8_t>(input.readUint32());
+        mask = static_cast<uint8_t>(input.readUint32());
+    }
+    if (what & eLayerStackChanged) {
+        layerStack = input.readUint32();
+    }
+    if (what & eCropChanged_legacy) {
+        input.read(crop_legacy);
+    }
+    if (what & eDeferTransaction_legacy) {
+        barrierHandle_legacy = input.readStrongBinder();
+        barrierGbp_legacy = interface_cast<IGraphicBufferProducer>(input.readStrongBinder());
+        frameNumber_legacy = input.readUint64();
+    }
+    if (what & eOverrideScalingModeChanged) {
+        overrideScalingMode = input.readInt32();
+    }
+    if (what & eReparentChildren) {
+        reparentHandle = input.readStrongBinder();
+    }
+    if (what & eRelativeLayerChanged) {
+        relativeLayerHandle = input.readStrongBinder();
+    }
+    if (what & eReparent) {
+        parentHandleForChild = input.readStrongBinder();
+    }
+    if (what & (eColorChanged | eBackgroundColorChanged)) {
+        color.r = input.readFloat();
+        color.g = input.readFloat();
+        color.b = input.readFloat();
+    }
+    if (what & eTransformChanged) {
+        transform = input.readUint32();
+    }
+    if (what & eTransformToDisplayInverseChanged) {
+        transformToDisplayInverse = input.readBool();
+    }
+    if (what & eCropChanged) {
+        input.read(crop);
+    }
+    if (what & eBufferChanged) {
+        buffer = new GraphicBuffer();
+        if (input.readBool()) {
+            input.read(*buffer);
+        }
+    }
+    if (what & eAcquireFenceChanged) {
+        acquireFence = new Fence();
+        if (input.readBool()) {
+            input.read(*acquireFence);
+        }
+    }
+    if (what & eDataspaceChanged) {
+        dataspace = static_cast<ui::Dataspace>(input.readUint32());
+    }
+    if (what & eHdrMetadataChanged) {
+        input.read(hdrMetadata);
+    }
+    if (what & eSurfaceDamageRegionChanged) {
+        input.read(surfaceDamageRegion);
+    }
+    if (what & eApiChanged) {
+        api = input.readInt32();
+    }
+    if (what & eSidebandStreamChanged) {
+        if (input.readBool()) {
+            sidebandStream = NativeHandle::create(input.readNativeHandle(), true);
+        }
+    }
+    if (what & eColorTransformChanged) {
+        const void* color_transform_data = input.readInplace(16 * sizeof(float));
+        if (color_transform_data) {
+            colorTransform = mat4(static_cast<const float*>(color_transform_data));
+        } else {
+            return BAD_VALUE;
+        }
+    }
+    if (what & eHasListenerCallbacksChanged) {
+        hasListenerCallbacks = input.readBool();
+    }
 #ifndef NO_INPUT
-    inputInfo = InputWindowInfo::read(input);
+    if (what & eInputInfoChanged) {
+        inputInfo = InputWindowInfo::read(input);
+    }
 #endif
-
-    input.read(transparentRegion);
-    transform = input.readUint32();
-    transformToDisplayInverse = input.readBool();
-    input.read(crop);
-    input.read(frame);
-    buffer = new GraphicBuffer();
-    if (input.readBool()) {
-        input.read(*buffer);
+    if (what & eCornerRadiusChanged) {
+        cornerRadius = input.readFloat();
     }
-    acquireFence = new Fence();
-    if (input.readBool()) {
-        input.read(*acquireFence);
+    if (what & eFrameChanged) {
+        input.read(frame);
     }
-    dataspace = static_cast<ui::Dataspace>(input.readUint32());
-    input.read(hdrMetadata);
-    input.read(surfaceDamageRegion);
-    api = input.readInt32();
-    if (input.readBool()) {
-        sidebandStream = NativeHandle::create(input.readNativeHandle(), true);
+    if (what & eCachedBufferChanged) {
+        cachedBuffer.token = input.readWeakBinder();
+        cachedBuffer.id = input.readUint64();
+    }
+    if (what & eBackgroundColorChanged) {
+        bgColorAlpha = input.readFloat();
+        bgColorDataspace = static_cast<ui::Dataspace>(input.readUint32());
+    }
+    if (what & eMetadataChanged) {
+        input.readParcelable(&metadata);
+    }
+    if (what & eColorSpaceAgnosticChanged) {
+        colorSpaceAgnostic = input.readBool();
     }
-
-    colorTransform = mat4(static_cast<const float*>(input.readInplace(16 * sizeof(float))));
-    cornerRadius = input.readFloat();
-    hasListenerCallbacks = input.readBool();
-    cachedBuffer.token = input.readWeakBinder();
-    cachedBuffer.id = input.readUint64();
-    input.readParcelable(&metadata);
-
-    bgColorAlpha = input.readFloat();
-    bgColorDataspace = static_cast<ui::Dataspace>(input.readUint32());
-    colorSpaceAgnostic = input.readBool();
 
     return NO_ERROR;
 }
@@ -110,6 +110,8 @@ void OccupancyTracker::recordPendingSegment() {
         if (mSegmentHistory.size() > MAX_HISTORY_SIZE) {
             mSegmentHistory.pop_back();
         }
+        mDoubleBufferedSegmentCount =
+                usedThirdBuffer ? 0 : mDoubleBufferedSegmentCount + 1;
     }
     mPendingSegment.clear();
 }
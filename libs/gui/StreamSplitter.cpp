@@ -57,7 +57,7 @@ status_t StreamSplitter::createSplitter(
 }
 
 StreamSplitter::StreamSplitter(const sp<IGraphicBufferConsumer>& inputQueue)
-      : mIsAbandoned(false), mMutex(), mReleaseCondition(),
+      : mIsAbandoned(false), mQueueMutex(), mMutex(), mReleaseCondition(),
         mOutstandingBuffers(0), mInput(inputQueue), mOutputs(), mBuffers() {}
 
 StreamSplitter::~StreamSplitter() {
@@ -103,44 +103,53 @@ void StreamSplitter::setName(const String8 &name) {
 
 void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
     ATRACE_CALL();
-    Mutex::Autolock lock(mMutex);
+    // Keeps frames in order on every output, without holding mMutex while the
+    // buffer is queued to them.
+    Mutex::Autolock queueLock(mQueueMutex);
 
-    // The current policy is that if any one consumer is consuming buffers too
-    // slowly, the splitter will stall the rest of the outputs by not acquiring
-    // any more buffers from the input. This will cause back pressure on the
-    // input queue, slowing down its producer.
-
-    // If there are too many outstanding buffers, we block until a buffer is
-    // released back to the input in onBufferReleased
-    while (mOutstandingBuffers >= MAX_OUTSTANDING_BUFFERS) {
-        mReleaseCondition.wait(mMutex);
-
-        // If the splitter is abandoned while we are waiting, the release
-        // condition variable will be broadcast, and we should just return
-        // without attempting to do anything more (since the input queue will
-        // also be abandoned).
-        if (mIsAbandoned) {
-            return;
+    BufferItem bufferItem;
+    sp<BufferTracker> tracker;
+    Vector<sp<IGraphicBufferProducer> > outputs;
+    {
+        Mutex::Autolock lock(mMutex);
+
+        // The current policy is that if any one consumer is consuming buffers
+        // too slowly, the splitter will stall the rest of the outputs by not
+        // acquiring any more buffers from the input. This will cause back
+        // pressure on the input queue, slowing down its producer.
+
+        // If there are too many outstanding buffers, we block until a buffer
+        // is released back to the input in onBufferReleased
+        while (mOutstandingBuffers >= MAX_OUTSTANDING_BUFFERS) {
+            mReleaseCondition.wait(mMutex);
+
+            // If the splitter is abandoned while we are waiting, the release
+            // condition variable will be broadcast, and we should just return
+            // without attempting to do anything more (since the input queue
+            // will also be abandoned).
+            if (mIsAbandoned) {
+                return;
+            }
         }
-    }
-    ++mOutstandingBuffers;
+        ++mOutstandingBuffers;
 
-    // Acquire and detach the buffer from the input
-    BufferItem bufferItem;
-    status_t status = mInput->acquireBuffer(&bufferItem, /* presentWhen */ 0);
-    LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
-            "acquiring buffer from input failed (%d)", status);
+        // Acquire and detach the buffer from the input
+        status_t status = mInput->acquireBuffer(&bufferItem, /* presentWhen */ 0);
+        LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
+                "acquiring buffer from input failed (%d)", status);
 
-    ALOGV("acquired buffer %#" PRIx64 " from input",
-            bufferItem.mGraphicBuffer->getId());
+        ALOGV("acquired buffer %#" PRIx64 " from input",
+                bufferItem.mGraphicBuffer->getId());
 
-    status = mInput->detachBuffer(bufferItem.mSlot);
-    LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
-            "detaching buffer from input failed (%d)", status);
+        status = mInput->detachBuffer(bufferItem.mSlot);
+        LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
+                "detaching buffer from input failed (%d)", status);
 
-    // Initialize our reference count for this buffer
-    mBuffers.add(bufferItem.mGraphicBuffer->getId(),
-            new BufferTracker(bufferItem.mGraphicBuffer));
+        // Initialize our reference count for this buffer
+        tracker = new BufferTracker(bufferItem.mGraphicBuffer);
+        mBuffers.add(bufferItem.mGraphicBuffer->getId(), tracker);
+        outputs = mOutputs;
+    }
 
     IGraphicBufferProducer::QueueBufferInput queueInput(
             bufferItem.mTimestamp, bufferItem.mIsAutoTimestamp,
@@ -148,18 +157,21 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             static_cast<int32_t>(bufferItem.mScalingMode),
             bufferItem.mTransform, bufferItem.mFence);
 
-    // Attach and queue the buffer to each of the outputs
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
-    for (; output != mOutputs.end(); ++output) {
+    // Attach and queue the buffer to each of the outputs. This is done without
+    // mMutex, so outputs releasing earlier buffers aren't held up by it. The
+    // buffer can't be returned to the input meanwhile, since every output
+    // still has to release it or be counted as abandoned below.
+    Vector<sp<IGraphicBufferProducer> >::iterator output = outputs.begin();
+    for (; output != outputs.end(); ++output) {
         int slot;
-        status = (*output)->attachBuffer(&slot, bufferItem.mGraphicBuffer);
+        status_t status = (*output)->attachBuffer(&slot, bufferItem.mGraphicBuffer);
         if (status == NO_INIT) {
             // If we just discovered that this output has been abandoned, note
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
+            Mutex::Autolock lock(mMutex);
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
@@ -172,9 +184,9 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             // If we just discovered that this output has been abandoned, note
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
+            Mutex::Autolock lock(mMutex);
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
@@ -189,11 +201,14 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
 void StreamSplitter::onBufferReleasedByOutput(
         const sp<IGraphicBufferProducer>& from) {
     ATRACE_CALL();
-    Mutex::Autolock lock(mMutex);
 
+    // Detach from the output before taking mMutex, since it is usually a call
+    // into another process.
     sp<GraphicBuffer> buffer;
     sp<Fence> fence;
     status_t status = from->detachNextBuffer(&buffer, &fence);
+
+    Mutex::Autolock lock(mMutex);
     if (status == NO_INIT) {
         // If we just discovered that this output has been abandoned, note that,
         // but we can't do anything else, since buffer is invalid
@@ -208,7 +223,6 @@ void StreamSplitter::onBufferReleasedByOutput(
           buffer->getId(), from.get());
 
     const sp<BufferTracker>& tracker = mBuffers.editValueFor(buffer->getId());
-
     // Merge the release fence of the incoming buffer so that the fence we send
     // back to the input includes all of the outputs' fences
     tracker->mergeFence(fence);
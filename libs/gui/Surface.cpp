@@ -127,6 +127,13 @@ void Surface::allocateBuffers() {
             mReqFormat, mReqUsage);
 }
 
+void Surface::reallocateBuffers() {
+    uint32_t reqWidth = mReqWidth ? mReqWidth : mUserWidth;
+    uint32_t reqHeight = mReqHeight ? mReqHeight : mUserHeight;
+    mGraphicBufferProducer->reallocateBuffers(reqWidth, reqHeight,
+            mReqFormat, mReqUsage);
+}
+
 status_t Surface::setGenerationNumber(uint32_t generation) {
     status_t result = mGraphicBufferProducer->setGenerationNumber(generation);
     if (result == NO_ERROR) {
@@ -176,6 +183,15 @@ void Surface::enableFrameTimestamps(bool enable) {
         FrameEventHistoryDelta delta;
         mGraphicBufferProducer->getFrameTimestamps(&delta);
         mFrameEventHistory->applyDelta(delta);
+
+        // If the consumer shares its timestamps, most polls can be answered
+        // from shared memory instead of calling getFrameTimestamps.
+        sp<IMemory> memory;
+        if (mGraphicBufferProducer->getFrameTimestampsMemory(&memory) == NO_ERROR) {
+            mFrameEventHistory->setSharedTimestampsMemory(memory);
+        }
+    } else if (mEnableFrameTimestamps && !enable) {
+        mFrameEventHistory->setSharedTimestampsMemory(nullptr);
     }
     mEnableFrameTimestamps = enable;
 }
@@ -287,11 +303,18 @@ status_t Surface::getFrameTimestamps(uint64_t frameNumber,
         return NAME_NOT_FOUND;
     }
 
-    // Update our cache of events if the requested events are not available.
-    if (checkConsumerForUpdates(events, mLastFrameNumber,
-            outLatchTime, outFirstRefreshStartTime, outLastRefreshStartTime,
-            outGpuCompositionDoneTime, outDisplayPresentTime,
-            outDequeueReadyTime, outReleaseTime)) {
+    // Update our cache of events if the requested events are not available,
+    // from the consumer's shared timestamps first if it has any.
+    const auto needsConsumerUpdate = [&] {
+        return checkConsumerForUpdates(events, mLastFrameNumber,
+                outLatchTime, outFirstRefreshStartTime, outLastRefreshStartTime,
+                outGpuCompositionDoneTime, outDisplayPresentTime,
+                outDequeueReadyTime, outReleaseTime);
+    };
+    if (needsConsumerUpdate()) {
+        mFrameEventHistory->applySharedTimestamps(events);
+    }
+    if (needsConsumerUpdate()) {
         FrameEventHistoryDelta delta;
         mGraphicBufferProducer->getFrameTimestamps(&delta);
         mFrameEventHistory->applyDelta(delta);
@@ -531,29 +554,31 @@ private:
     std::mutex mMutex;
 };
 
+void Surface::getDequeueBufferInputLocked(
+        IGraphicBufferProducer::DequeueBufferInput* dequeueInput) {
+    LOG_ALWAYS_FATAL_IF(dequeueInput == nullptr, "input is null");
+
+    dequeueInput->width = mReqWidth ? mReqWidth : mUserWidth;
+    dequeueInput->height = mReqHeight ? mReqHeight : mUserHeight;
+
+    dequeueInput->format = mReqFormat;
+    dequeueInput->usage = mReqUsage;
+
+    dequeueInput->getTimestamps = mEnableFrameTimestamps;
+}
+
 int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
     ATRACE_CALL();
     ALOGV("Surface::dequeueBuffer");
 
-    uint32_t reqWidth;
-    uint32_t reqHeight;
-    PixelFormat reqFormat;
-    uint64_t reqUsage;
-    bool enableFrameTimestamps;
-
+    IGraphicBufferProducer::DequeueBufferInput dqInput;
     {
         Mutex::Autolock lock(mMutex);
         if (mReportRemovedBuffers) {
             mRemovedBuffers.clear();
         }
 
-        reqWidth = mReqWidth ? mReqWidth : mUserWidth;
-        reqHeight = mReqHeight ? mReqHeight : mUserHeight;
-
-        reqFormat = mReqFormat;
-        reqUsage = mReqUsage;
-
-        enableFrameTimestamps = mEnableFrameTimestamps;
+        getDequeueBufferInputLocked(&dqInput);
 
         if (mSharedBufferMode && mAutoRefresh && mSharedBufferSlot !=
                 BufferItem::INVALID_BUFFER_SLOT) {
@@ -571,16 +596,17 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
     nsecs_t startTime = systemTime();
 
     FrameEventHistoryDelta frameTimestamps;
-    status_t result = mGraphicBufferProducer->dequeueBuffer(&buf, &fence, reqWidth, reqHeight,
-                                                            reqFormat, reqUsage, &mBufferAge,
-                                                            enableFrameTimestamps ? &frameTimestamps
-                                                                                  : nullptr);
+    status_t result = mGraphicBufferProducer->dequeueBuffer(&buf, &fence, dqInput.width,
+                                                            dqInput.height, dqInput.format,
+                                                            dqInput.usage, &mBufferAge,
+                                                            dqInput.getTimestamps ?
+                                                                    &frameTimestamps : nullptr);
     mLastDequeueDuration = systemTime() - startTime;
 
     if (result < 0) {
         ALOGV("dequeueBuffer: IGraphicBufferProducer::dequeueBuffer"
                 "(%d, %d, %d, %#" PRIx64 ") failed: %d",
-                reqWidth, reqHeight, reqFormat, reqUsage, result);
+                dqInput.width, dqInput.height, dqInput.format, dqInput.usage, result);
         return result;
     }
 
@@ -595,6 +621,28 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
     // Write this while holding the mutex
     mLastDequeueStartTime = startTime;
 
+    result = onBufferDequeuedLocked(buf, fence, result,
+                                    dqInput.getTimestamps ? &frameTimestamps : nullptr, fenceFd);
+    if (result != OK) {
+        return result;
+    }
+
+    *buffer = mSlots[buf].buffer.get();
+
+    if (mSharedBufferMode && mAutoRefresh) {
+        mSharedBufferSlot = buf;
+        mSharedBufferHasBeenQueued = false;
+    } else if (mSharedBufferSlot == buf) {
+        mSharedBufferSlot = BufferItem::INVALID_BUFFER_SLOT;
+        mSharedBufferHasBeenQueued = false;
+    }
+
+    return OK;
+}
+
+status_t Surface::onBufferDequeuedLocked(int buf, const sp<Fence>& fence, status_t result,
+                                         const FrameEventHistoryDelta* frameTimestamps,
+                                         int* fenceFd) {
     sp<GraphicBuffer>& gbuf(mSlots[buf].buffer);
 
     // this should never happen
@@ -609,8 +657,8 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
         freeAllBuffers();
     }
 
-    if (enableFrameTimestamps) {
-         mFrameEventHistory->applyDelta(frameTimestamps);
+    if (frameTimestamps != nullptr) {
+         mFrameEventHistory->applyDelta(*frameTimestamps);
     }
 
     if ((result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) || gbuf == nullptr) {
@@ -637,14 +685,113 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
         *fenceFd = -1;
     }
 
-    *buffer = gbuf.get();
+    return OK;
+}
 
-    if (mSharedBufferMode && mAutoRefresh) {
-        mSharedBufferSlot = buf;
-        mSharedBufferHasBeenQueued = false;
-    } else if (mSharedBufferSlot == buf) {
-        mSharedBufferSlot = BufferItem::INVALID_BUFFER_SLOT;
-        mSharedBufferHasBeenQueued = false;
+int Surface::dequeueBuffers(std::vector<BatchBuffer>* buffers) {
+    ATRACE_CALL();
+    ALOGV("Surface::dequeueBuffers");
+
+    if (buffers->size() == 0) {
+        ALOGE("%s: must dequeue at least 1 buffer!", __FUNCTION__);
+        return BAD_VALUE;
+    }
+
+    std::vector<IGraphicBufferProducer::DequeueBufferInput> dequeueInput;
+    {
+        Mutex::Autolock lock(mMutex);
+        if (mSharedBufferMode) {
+            ALOGE("%s: batch operation is not supported in shared buffer mode!", __FUNCTION__);
+            return INVALID_OPERATION;
+        }
+        if (mReportRemovedBuffers) {
+            mRemovedBuffers.clear();
+        }
+
+        IGraphicBufferProducer::DequeueBufferInput input;
+        getDequeueBufferInputLocked(&input);
+        dequeueInput.assign(buffers->size(), input);
+    } // Drop the lock so that we can still touch the Surface while blocking in IGBP::dequeueBuffers
+
+    nsecs_t startTime = systemTime();
+
+    std::vector<IGraphicBufferProducer::DequeueBufferOutput> dequeueOutput;
+    status_t result = mGraphicBufferProducer->dequeueBuffers(dequeueInput, &dequeueOutput);
+    mLastDequeueDuration = systemTime() - startTime;
+
+    if (result < 0) {
+        ALOGV("%s: IGraphicBufferProducer::dequeueBuffers(%zu) failed: %d", __FUNCTION__,
+              dequeueInput.size(), result);
+        return result;
+    }
+
+    // Cancels every buffer of the batch, for the error paths below.
+    auto cancelAll = [&]() {
+        for (const auto& output : dequeueOutput) {
+            if (output.slot >= 0 && output.slot < NUM_BUFFER_SLOTS) {
+                mGraphicBufferProducer->cancelBuffer(output.slot, output.fence);
+            }
+        }
+    };
+
+    if (dequeueOutput.size() != dequeueInput.size()) {
+        ALOGE("%s: IGraphicBufferProducer returned %zu buffers for %zu requests", __FUNCTION__,
+              dequeueOutput.size(), dequeueInput.size());
+        cancelAll();
+        return FAILED_TRANSACTION;
+    }
+    for (const auto& output : dequeueOutput) {
+        if (output.slot < 0 || output.slot >= NUM_BUFFER_SLOTS) {
+            ALOGE("%s: IGraphicBufferProducer returned invalid slot number %d", __FUNCTION__,
+                  output.slot);
+            android_errorWriteLog(0x534e4554, "36991414"); // SafetyNet logging
+            cancelAll();
+            return FAILED_TRANSACTION;
+        }
+    }
+
+    Mutex::Autolock lock(mMutex);
+
+    // Write this while holding the mutex
+    mLastDequeueStartTime = startTime;
+    mBufferAge = dequeueOutput.back().bufferAge;
+
+    // Free the slots once, before any buffer of the batch is handed out, so
+    // that a later RELEASE_ALL_BUFFERS can't drop the earlier ones.
+    for (const auto& output : dequeueOutput) {
+        if (output.result & IGraphicBufferProducer::RELEASE_ALL_BUFFERS) {
+            freeAllBuffers();
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < dequeueOutput.size(); i++) {
+        const IGraphicBufferProducer::DequeueBufferOutput& output = dequeueOutput[i];
+        const status_t flags = output.result & ~IGraphicBufferProducer::RELEASE_ALL_BUFFERS;
+        result = onBufferDequeuedLocked(output.slot, output.fence, flags,
+                                        dequeueInput[i].getTimestamps ? &output.timestamps
+                                                                      : nullptr,
+                                        &(*buffers)[i].fenceFd);
+        if (result != OK) {
+            // onBufferDequeuedLocked cancelled the failing buffer; hand back
+            // the rest of the batch and close the fences we already duped.
+            for (size_t j = 0; j < dequeueOutput.size(); j++) {
+                if (j < i && (*buffers)[j].fenceFd >= 0) {
+                    close((*buffers)[j].fenceFd);
+                }
+                if (j != i) {
+                    mGraphicBufferProducer->cancelBuffer(dequeueOutput[j].slot,
+                                                         dequeueOutput[j].fence);
+                }
+                (*buffers)[j] = BatchBuffer();
+            }
+            return result;
+        }
+        (*buffers)[i].buffer = mSlots[output.slot].buffer.get();
+        if (mSharedBufferSlot == output.slot) {
+            mSharedBufferSlot = BufferItem::INVALID_BUFFER_SLOT;
+            mSharedBufferHasBeenQueued = false;
+        }
     }
 
     return OK;
@@ -696,42 +843,21 @@ int Surface::lockBuffer_DEPRECATED(android_native_buffer_t* buffer __attribute__
     return OK;
 }
 
-int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
-    ATRACE_CALL();
-    ALOGV("Surface::queueBuffer");
-    Mutex::Autolock lock(mMutex);
-    int64_t timestamp;
+IGraphicBufferProducer::QueueBufferInput Surface::getQueueBufferInputLocked(
+        android_native_buffer_t* buffer, const sp<Fence>& fence, nsecs_t timestamp) {
     bool isAutoTimestamp = false;
 
-    if (mTimestamp == NATIVE_WINDOW_TIMESTAMP_AUTO) {
+    if (timestamp == NATIVE_WINDOW_TIMESTAMP_AUTO) {
         timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
         isAutoTimestamp = true;
         ALOGV("Surface::queueBuffer making up timestamp: %.2f ms",
             timestamp / 1000000.0);
-    } else {
-        timestamp = mTimestamp;
-    }
-    int i = getSlotFromBufferLocked(buffer);
-    if (i < 0) {
-        if (fenceFd >= 0) {
-            close(fenceFd);
-        }
-        return i;
-    }
-    if (mSharedBufferSlot == i && mSharedBufferHasBeenQueued) {
-        if (fenceFd >= 0) {
-            close(fenceFd);
-        }
-        return OK;
     }
 
-
     // Make sure the crop rectangle is entirely inside the buffer.
     Rect crop(Rect::EMPTY_RECT);
     mCrop.intersect(Rect(buffer->width, buffer->height), &crop);
 
-    sp<Fence> fence(fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE);
-    IGraphicBufferProducer::QueueBufferOutput output;
     IGraphicBufferProducer::QueueBufferInput input(timestamp, isAutoTimestamp,
             static_cast<android_dataspace>(mDataSpace), crop, mScalingMode,
             mTransform ^ mStickyTransform, fence, mStickyTransform,
@@ -803,13 +929,11 @@ int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
         input.setSurfaceDamage(flippedRegion);
     }
 
-    nsecs_t now = systemTime();
-    status_t err = mGraphicBufferProducer->queueBuffer(i, input, &output);
-    mLastQueueDuration = systemTime() - now;
-    if (err != OK)  {
-        ALOGE("queueBuffer: error queuing buffer to SurfaceTexture, %d", err);
-    }
+    return input;
+}
 
+void Surface::onBufferQueuedLocked(int slot, const sp<Fence>& fence,
+                                   const IGraphicBufferProducer::QueueBufferOutput& output) {
     if (mEnableFrameTimestamps) {
         mFrameEventHistory->applyDelta(output.frameTimestamps);
         // Update timestamps with the local acquire fence.
@@ -842,7 +966,7 @@ int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
         mDirtyRegion = Region::INVALID_REGION;
     }
 
-    if (mSharedBufferMode && mAutoRefresh && mSharedBufferSlot == i) {
+    if (mSharedBufferMode && mAutoRefresh && mSharedBufferSlot == slot) {
         mSharedBufferHasBeenQueued = true;
     }
 
@@ -852,6 +976,96 @@ int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
         static FenceMonitor gpuCompletionThread("GPU completion");
         gpuCompletionThread.queueFence(fence);
     }
+}
+
+int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
+    ATRACE_CALL();
+    ALOGV("Surface::queueBuffer");
+    Mutex::Autolock lock(mMutex);
+
+    int i = getSlotFromBufferLocked(buffer);
+    if (i < 0) {
+        if (fenceFd >= 0) {
+            close(fenceFd);
+        }
+        return i;
+    }
+    if (mSharedBufferSlot == i && mSharedBufferHasBeenQueued) {
+        if (fenceFd >= 0) {
+            close(fenceFd);
+        }
+        return OK;
+    }
+
+    sp<Fence> fence(fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE);
+    IGraphicBufferProducer::QueueBufferOutput output;
+    IGraphicBufferProducer::QueueBufferInput input =
+            getQueueBufferInputLocked(buffer, fence, mTimestamp);
+
+    nsecs_t now = systemTime();
+    status_t err = mGraphicBufferProducer->queueBuffer(i, input, &output);
+    mLastQueueDuration = systemTime() - now;
+    if (err != OK)  {
+        ALOGE("queueBuffer: error queuing buffer to SurfaceTexture, %d", err);
+    }
+
+    onBufferQueuedLocked(i, fence, output);
+    return err;
+}
+
+int Surface::queueBuffers(const std::vector<BatchQueuedBuffer>& buffers) {
+    ATRACE_CALL();
+    ALOGV("Surface::queueBuffers");
+    Mutex::Autolock lock(mMutex);
+
+    // The fences are ours to close on the paths that fail before queueing.
+    auto closeFences = [&buffers]() {
+        for (size_t i = 0; i < buffers.size(); i++) {
+            if (buffers[i].fenceFd >= 0) {
+                close(buffers[i].fenceFd);
+            }
+        }
+    };
+
+    if (mSharedBufferMode) {
+        ALOGE("%s: batched operation is not supported in shared buffer mode", __FUNCTION__);
+        closeFences();
+        return INVALID_OPERATION;
+    }
+
+    std::vector<int> slots(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        slots[i] = getSlotFromBufferLocked(buffers[i].buffer);
+        if (slots[i] < 0) {
+            closeFences();
+            return slots[i];
+        }
+    }
+
+    std::vector<sp<Fence>> fences;
+    std::vector<IGraphicBufferProducer::QueueBufferRequest> requests;
+    fences.reserve(buffers.size());
+    requests.reserve(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        const BatchQueuedBuffer& batchBuffer = buffers[i];
+        fences.push_back(batchBuffer.fenceFd >= 0 ? new Fence(batchBuffer.fenceFd)
+                                                  : Fence::NO_FENCE);
+        requests.push_back({slots[i],
+                            getQueueBufferInputLocked(batchBuffer.buffer, fences.back(),
+                                                      batchBuffer.timestamp)});
+    }
+
+    std::vector<IGraphicBufferProducer::QueueBufferOutput> queueOutput;
+    nsecs_t now = systemTime();
+    status_t err = mGraphicBufferProducer->queueBuffers(requests, &queueOutput);
+    mLastQueueDuration = systemTime() - now;
+    if (err != OK)  {
+        ALOGE("%s: error queuing buffers to SurfaceTexture, %d", __FUNCTION__, err);
+    }
+
+    for (size_t i = 0; i < queueOutput.size() && i < slots.size(); i++) {
+        onBufferQueuedLocked(slots[i], fences[i], queueOutput[i]);
+    }
 
     return err;
 }
@@ -1072,6 +1286,9 @@ int Surface::perform(int operation, va_list args)
     case NATIVE_WINDOW_GET_CONSUMER_USAGE64:
         res = dispatchGetConsumerUsage64(args);
         break;
+    case NATIVE_WINDOW_SET_DEQUEUE_TIMEOUT:
+        res = dispatchSetDequeueTimeout(args);
+        break;
     default:
         res = NAME_NOT_FOUND;
         break;
@@ -1272,6 +1489,11 @@ int Surface::dispatchGetConsumerUsage64(va_list args) {
     return getConsumerUsage(usage);
 }
 
+int Surface::dispatchSetDequeueTimeout(va_list args) {
+    nsecs_t timeout = va_arg(args, int64_t);
+    return setDequeueTimeout(timeout);
+}
+
 bool Surface::transformToDisplayInverse() {
     return (mTransform & NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) ==
             NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY;
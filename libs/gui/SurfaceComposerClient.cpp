@@ -16,9 +16,17 @@
 
 #define LOG_TAG "SurfaceComposerClient"
 
+#include <poll.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include <utils/Errors.h>
 #include <utils/Log.h>
 #include <utils/SortedVector.h>
@@ -35,6 +43,7 @@
 
 #include <gui/BufferItemConsumer.h>
 #include <gui/CpuConsumer.h>
+#include <gui/DisplayEventReceiver.h>
 #include <gui/IGraphicBufferProducer.h>
 #include <gui/ISurfaceComposer.h>
 #include <gui/ISurfaceComposerClient.h>
@@ -362,7 +371,7 @@ SurfaceComposerClient::Transaction& SurfaceComposerClient::Transaction::merge(Tr
     mInputWindowCommands.merge(other.mInputWindowCommands);
     other.mInputWindowCommands.clear();
 
-    mContainsBuffer = other.mContainsBuffer;
+    mContainsBuffer = mContainsBuffer || other.mContainsBuffer;
     other.mContainsBuffer = false;
 
     mEarlyWakeup = mEarlyWakeup || other.mEarlyWakeup;
@@ -438,11 +447,157 @@ void SurfaceComposerClient::Transaction::cacheBuffers() {
     }
 }
 
+// ---------------------------------------------------------------------------
+
+class SurfaceComposerClient::Transaction::FrameBatcher {
+public:
+    // Never destroyed, so the vsync thread can keep running at exit.
+    static FrameBatcher& getInstance() {
+        static FrameBatcher* sInstance = new FrameBatcher;
+        sInUse.store(true);
+        return *sInstance;
+    }
+
+    // Until something has been batched there is nothing to keep apply() in order with.
+    static bool isInUse() { return sInUse.load(std::memory_order_relaxed); }
+
+    status_t enqueue(Transaction& t) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mThreadStarted) {
+            std::thread(&FrameBatcher::threadMain, this).detach();
+            mThreadStarted = true;
+        }
+        take(mPending, t);
+        mHasPending = true;
+        mCondition.notify_one();
+        return NO_ERROR;
+    }
+
+    // Applies t after whatever is pending. mApplyMutex is held while sending, so a flush from
+    // the vsync thread can't overtake t or be overtaken by it. mMutex is only held to take the
+    // pending batch, so enqueue() never waits on binder.
+    status_t applyAfterPending(Transaction& t, bool synchronous) {
+        std::lock_guard<std::mutex> applyLock(mApplyMutex);
+        Transaction batch;
+        if (!takePending(&batch)) {
+            return t.applyNow(synchronous);
+        }
+        if (t.mDesiredPresentTime >= 0) {
+            // The batch was meant to be presented as soon as possible, not at t's time
+            batch.applyNow(false);
+            return t.applyNow(synchronous);
+        }
+        take(batch, t);
+        return batch.applyNow(synchronous);
+    }
+
+    status_t flush() {
+        std::lock_guard<std::mutex> applyLock(mApplyMutex);
+        Transaction batch;
+        if (!takePending(&batch)) {
+            return NO_ERROR;
+        }
+        return batch.applyNow(false);
+    }
+
+private:
+    // Don't hold transactions back for long when vsync doesn't come, e.g. while the display is
+    // off, or when there is no vsync to wait for.
+    static constexpr int kMaxVsyncWaitMs = 50;
+    static constexpr std::chrono::milliseconds kFallbackFrame{16};
+
+    FrameBatcher() = default;
+
+    // merge() leaves out the flags that only make sense for the transaction being applied,
+    // but any of them being set on a batched transaction applies to the whole batch.
+    static void take(Transaction& to, Transaction& from) {
+        to.merge(std::move(from));
+        to.mAnimation = to.mAnimation || from.mAnimation;
+        from.mAnimation = false;
+        to.mForceSynchronous |= from.mForceSynchronous;
+        from.mForceSynchronous = 0;
+    }
+
+    // Moves the pending batch into outBatch. Returns false if nothing was pending.
+    bool takePending(Transaction* outBatch) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mHasPending) {
+            return false;
+        }
+        mHasPending = false;
+        take(*outBatch, mPending);
+        return true;
+    }
+
+    void threadMain() {
+        pthread_setname_np(pthread_self(), "TxnFrameBatcher");
+        DisplayEventReceiver receiver;
+        const bool hasVsync = receiver.initCheck() == NO_ERROR;
+        if (!hasVsync) {
+            ALOGW("No vsync to batch transactions on, flushing every %lldms",
+                  static_cast<long long>(kFallbackFrame.count()));
+        }
+        DisplayEventReceiver::Event events[8];
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this] { return mHasPending; });
+            }
+            if (hasVsync) {
+                receiver.requestNextVsync();
+                struct pollfd fd = {receiver.getFd(), POLLIN, 0};
+                poll(&fd, 1, kMaxVsyncWaitMs);
+                while (receiver.getEvents(events, 8) > 0) {
+                }
+            } else {
+                std::this_thread::sleep_for(kFallbackFrame);
+            }
+            flush();
+        }
+    }
+
+    static std::atomic_bool sInUse;
+
+    // Held while a batch is sent, so batches are sent in order. Always taken before mMutex.
+    std::mutex mApplyMutex;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    Transaction mPending;
+    bool mHasPending = false;
+    bool mThreadStarted = false;
+};
+
+std::atomic_bool SurfaceComposerClient::Transaction::FrameBatcher::sInUse(false);
+
+status_t SurfaceComposerClient::Transaction::applyOnNextFrame() {
+    if (mStatus != NO_ERROR) {
+        return mStatus;
+    }
+    // Merging these would make the whole batch wait, or be presented at another time
+    if (mForceSynchronous || mDesiredPresentTime >= 0) {
+        return apply();
+    }
+    return FrameBatcher::getInstance().enqueue(*this);
+}
+
+status_t SurfaceComposerClient::Transaction::flushFrameTransactions() {
+    if (!FrameBatcher::isInUse()) {
+        return NO_ERROR;
+    }
+    return FrameBatcher::getInstance().flush();
+}
+
 status_t SurfaceComposerClient::Transaction::apply(bool synchronous) {
     if (mStatus != NO_ERROR) {
         return mStatus;
     }
+    if (FrameBatcher::isInUse()) {
+        return FrameBatcher::getInstance().applyAfterPending(*this, synchronous);
+    }
+    return applyNow(synchronous);
+}
 
+status_t SurfaceComposerClient::Transaction::applyNow(bool synchronous) {
     sp<ISurfaceComposer> sf(ComposerService::getComposerService());
 
     std::vector<ListenerCallbacks> listenerCallbacks;
@@ -29,6 +29,7 @@
 #include <utils/Trace.h>
 #include <utils/Vector.h>
 
+#include <atomic>
 #include <list>
 #include <set>
 #include <mutex>
@@ -84,9 +85,18 @@ public:
     virtual ~BufferQueueCore();
 
 private:
+    // Which side of the queue a per-frame call to lockCounted comes from.
+    enum class LockSide { Producer, Consumer };
+
     // Dump our state in a string
     void dumpState(const String8& prefix, String8* outResult) const;
 
+    // lockCounted locks mMutex for a per-frame producer or consumer call
+    // (dequeue, queue, cancel, acquire and release). If another thread holds
+    // the lock, the time spent waiting for it is added to that side's
+    // LockStats, which are reported by dumpState.
+    std::unique_lock<std::mutex> lockCounted(LockSide side) const;
+
     // getMinUndequeuedBufferCountLocked returns the minimum number of buffers
     // that must remain in a state other than DEQUEUED. The async parameter
     // tells whether we're in asynchronous mode.
@@ -129,6 +139,21 @@ private:
     // minimum possible without discarding data.
     void discardFreeBuffersLocked();
 
+    // trimSpareBufferLocked is called after each queue. Once mOccupancyTracker
+    // shows that the consumer has kept up for TRIM_SPARE_BUFFER_SEGMENTS
+    // segments in a row, it releases one free buffer if fewer buffers than
+    // are allocated were ever in use at once meanwhile, and if
+    // mTrimSpareBuffers is set. It never goes below the buffers needed to
+    // double buffer. The slot is reallocated if the producer runs out of
+    // buffers again. Returns whether a buffer was released, in which case the
+    // consumer should be told through onBuffersReleased.
+    bool trimSpareBufferLocked();
+
+    // updateActiveBufferPeakLocked records the number of buffers in use for
+    // trimSpareBufferLocked. It must be called whenever a buffer becomes
+    // active.
+    void updateActiveBufferPeakLocked();
+
     // If delta is positive, makes more slots available. If negative, takes
     // away slots. Returns false if the request can't be met.
     bool adjustAvailableSlotsLocked(int delta);
@@ -147,6 +172,17 @@ private:
     // member variable is accessed.
     mutable std::mutex mMutex;
 
+    // LockStats counts how often the per-frame paths found mMutex held by
+    // another thread. The counters are only written by lockCounted and are
+    // atomic so that they can be updated before the lock is acquired.
+    struct LockStats {
+        std::atomic<uint64_t> acquisitions{0};
+        std::atomic<uint64_t> contentions{0};
+        std::atomic<uint64_t> waitNs{0};
+    };
+    mutable LockStats mProducerLockStats;
+    mutable LockStats mConsumerLockStats;
+
     // mIsAbandoned indicates that the BufferQueue will no longer be used to
     // consume image buffers pushed to it using the IGraphicBufferProducer
     // interface. It is initialized to false, and set to true in the
@@ -346,6 +382,15 @@ private:
 
     OccupancyTracker mOccupancyTracker;
 
+    // Whether trimSpareBufferLocked may release buffers. Set from the
+    // debug.bq.trim_spare_buffers property.
+    const bool mTrimSpareBuffers;
+    static constexpr size_t TRIM_SPARE_BUFFER_SEGMENTS = 3;
+
+    // The most buffers that were in mActiveBuffers at once since
+    // trimSpareBufferLocked last checked for a spare buffer
+    size_t mActiveBufferPeak;
+
     const uint64_t mUniqueId;
 
 }; // class BufferQueueCore
@@ -156,6 +156,10 @@ public:
     virtual void allocateBuffers(uint32_t width, uint32_t height,
             PixelFormat format, uint64_t usage) override;
 
+    // See IGraphicBufferProducer::reallocateBuffers
+    virtual void reallocateBuffers(uint32_t width, uint32_t height,
+            PixelFormat format, uint64_t usage) override;
+
     // See IGraphicBufferProducer::allowAllocation
     virtual status_t allowAllocation(bool allow);
 
@@ -184,6 +188,9 @@ public:
     // See IGraphicBufferProducer::getFrameTimestamps
     virtual void getFrameTimestamps(FrameEventHistoryDelta* outDelta) override;
 
+    // See IGraphicBufferProducer::getFrameTimestampsMemory
+    virtual status_t getFrameTimestampsMemory(sp<IMemory>* outMemory) override;
+
     // See IGraphicBufferProducer::getUniqueId
     virtual status_t getUniqueId(uint64_t* outId) const override;
 
@@ -202,7 +209,11 @@ private:
     // BufferQueueCore::INVALID_BUFFER_SLOT otherwise
     int getFreeSlotLocked() const;
 
-    void addAndGetFrameTimestamps(const NewFrameEventsEntry* newTimestamps,
+    // Reports newTimestamps to and fetches outDelta from the consumer listener
+    // without taking mCore->mMutex, so callers pass the listener they read
+    // under their own critical section.
+    void addAndGetFrameTimestamps(const sp<IConsumerListener>& listener,
+            const NewFrameEventsEntry* newTimestamps,
             FrameEventHistoryDelta* outDelta);
 
     // waitForFreeSlotThenRelock finds the oldest slot in the FREE state. It may
@@ -24,12 +24,15 @@
 
 #include <array>
 #include <bitset>
+#include <memory>
 #include <vector>
 
 namespace android {
 
 struct FrameEvents;
 class FrameEventHistoryDelta;
+class IMemory;
+class SharedFrameTimestamps;
 
 
 // Identifiers for all the events that may be recorded or reported.
@@ -144,6 +147,16 @@ public:
 
     void updateSignalTimes();
 
+    // Starts reading the timestamps the consumer publishes in memory, as
+    // returned by IGraphicBufferProducer::getFrameTimestampsMemory. Passing
+    // nullptr stops reading them.
+    void setSharedTimestampsMemory(const sp<IMemory>& memory);
+
+    // Fills in the consumer-side timestamps of frame that the consumer has
+    // published in shared memory, without a call to the consumer. Timestamps
+    // that are still pending must be synced with applyDelta as usual.
+    void applySharedTimestamps(FrameEvents* frame) const;
+
 protected:
     void applyFenceDelta(FenceTimeline* timeline,
             std::shared_ptr<FenceTime>* dst,
@@ -162,6 +175,8 @@ protected:
     FenceTimeline mGpuCompositionDoneTimeline;
     FenceTimeline mPresentTimeline;
     FenceTimeline mReleaseTimeline;
+
+    std::unique_ptr<SharedFrameTimestamps> mSharedTimestamps;
 };
 
 
@@ -222,7 +237,14 @@ public:
 
     void getAndResetDelta(FrameEventHistoryDelta* delta);
 
+    // Returns the memory this history publishes its timestamps in for the
+    // producer to read, allocating it on first use. Returns nullptr if the
+    // memory can't be allocated.
+    sp<IMemory> getSharedTimestampsMemory();
+
 private:
+    void publishSharedTimestamps();
+
     void getFrameDelta(FrameEventHistoryDelta* delta,
             const std::array<FrameEvents, MAX_FRAME_HISTORY>::iterator& frame);
 
@@ -234,6 +256,46 @@ private:
 
     int mCurrentConnectId{0};
     bool mProducerWantsEvents{false};
+
+    std::unique_ptr<SharedFrameTimestamps> mSharedTimestamps;
+};
+
+
+// Consumer-side frame timestamps laid out in shared memory, so that a
+// producer in another process can poll them without a binder call. There is
+// one entry per FrameEventHistory slot, guarded by a sequence counter that
+// the consumer makes odd while it rewrites the entry.
+//
+// Only values that are final are published. A fence that hasn't signaled
+// yet when the consumer publishes is left to FrameEventHistoryDelta, which
+// carries the fence itself.
+class SharedFrameTimestamps {
+public:
+    ~SharedFrameTimestamps();
+
+    // Consumer side: allocates the memory. Other processes can only map it
+    // read-only.
+    static std::unique_ptr<SharedFrameTimestamps> create();
+
+    // Producer side: maps memory allocated by create().
+    static std::unique_ptr<SharedFrameTimestamps> map(const sp<IMemory>& memory);
+
+    const sp<IMemory>& getMemory() const { return mMemory; }
+
+    // Consumer side: publishes the state of the frame in history slot index.
+    void publish(size_t index, const FrameEvents& frame);
+
+    // Producer side: copies the published values for frame->frameNumber that
+    // frame doesn't have yet.
+    void read(FrameEvents* frame) const;
+
+private:
+    struct Layout;
+
+    SharedFrameTimestamps(const sp<IMemory>& memory, Layout* layout);
+
+    const sp<IMemory> mMemory;
+    Layout* const mLayout;
 };
 
 
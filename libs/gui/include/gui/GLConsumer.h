@@ -202,6 +202,26 @@ public:
     // buffer is ready to be read from.
     std::shared_ptr<FenceTime> getCurrentFenceTime() const;
 
+    // lockCurrentBuffer maps the current buffer for CPU reads, so that the
+    // image set by updateTexImage can be read by both the GPU and the CPU
+    // without a copy or a second BufferQueue. The buffers must be allocated
+    // with CPU read usage, e.g. by passing GRALLOC_USAGE_SW_READ_OFTEN to
+    // setConsumerUsageBits. The call waits for the producer to finish
+    // writing the buffer.
+    //
+    // The mapping stays valid until unlockCurrentBuffer is called, or until
+    // the current buffer changes in updateTexImage or releaseTexImage, which
+    // unlock it first. Only one lock may be held at a time.
+    status_t lockCurrentBuffer(void** outData);
+
+    // lockCurrentBufferYCbCr is like lockCurrentBuffer, but for flexible YUV
+    // buffers, whose planes are returned in outYCbCr.
+    status_t lockCurrentBufferYCbCr(android_ycbcr* outYCbCr);
+
+    // unlockCurrentBuffer ends the CPU access started by lockCurrentBuffer
+    // or lockCurrentBufferYCbCr.
+    status_t unlockCurrentBuffer();
+
     // setConsumerUsageBits overrides the ConsumerBase method to OR
     // DEFAULT_USAGE_FLAGS to usage.
     status_t setConsumerUsageBits(uint64_t usage);
@@ -357,6 +377,14 @@ private:
     // mCurrentTextureImage must not be NULL.
     void computeCurrentTransformMatrixLocked();
 
+    // lockCurrentBufferLocked implements lockCurrentBuffer when outYCbCr is
+    // nullptr, and lockCurrentBufferYCbCr otherwise.
+    status_t lockCurrentBufferLocked(void** outData, android_ycbcr* outYCbCr);
+
+    // unlockCurrentBufferLocked unlocks mLockedBuffer. Any fence for the end
+    // of the CPU access is added to the current buffer's release fence.
+    status_t unlockCurrentBufferLocked();
+
     // doGLFenceWaitLocked inserts a wait command into the OpenGL ES command
     // stream to ensure that it is safe for future OpenGL ES commands to
     // access the current texture buffer.
@@ -400,6 +428,10 @@ private:
     // The FenceTime wrapper around mCurrentFence.
     std::shared_ptr<FenceTime> mCurrentFenceTime{FenceTime::NO_FENCE};
 
+    // mLockedBuffer is the current buffer while it is locked for CPU reads by
+    // lockCurrentBuffer, and nullptr otherwise.
+    sp<GraphicBuffer> mLockedBuffer;
+
     // mCurrentTransformMatrix is the transform matrix for the current texture.
     // It gets computed by computeTransformMatrix each time updateTexImage is
     // called.
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <binder/IInterface.h>
+#include <binder/IMemory.h>
 #include <binder/SafeInterface.h>
 
 #include <utils/Errors.h>
@@ -79,6 +80,12 @@ public:
     // WARNING: This method can only be called when the BufferQueue is in the consumer's process.
     virtual void addAndGetFrameTimestamps(const NewFrameEventsEntry* /*newTimestamps*/,
                                           FrameEventHistoryDelta* /*outDelta*/) {}
+
+    // Returns the memory the consumer publishes its frame timestamps in, or nullptr if it doesn't.
+    // See IGraphicBufferProducer::getFrameTimestampsMemory.
+    //
+    // WARNING: This method can only be called when the BufferQueue is in the consumer's process.
+    virtual sp<IMemory> getFrameTimestampsMemory() { return nullptr; }
 };
 
 class IConsumerListener : public ConsumerListener, public IInterface {
@@ -19,11 +19,13 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <vector>
 
 #include <utils/Errors.h>
 #include <utils/RefBase.h>
 
 #include <binder/IInterface.h>
+#include <binder/IMemory.h>
 
 #include <ui/BufferQueueDefs.h>
 #include <ui/Fence.h>
@@ -417,6 +419,64 @@ public:
     virtual status_t queueBuffer(int slot, const QueueBufferInput& input,
             QueueBufferOutput* output) = 0;
 
+    // The arguments of one dequeueBuffer call in a dequeueBuffers batch.
+    struct DequeueBufferInput {
+        uint32_t width{0};
+        uint32_t height{0};
+        PixelFormat format{0};
+        uint64_t usage{0};
+        bool getTimestamps{false};
+    };
+
+    // The results of one dequeueBuffer call in a dequeueBuffers batch. result
+    // holds the flags dequeueBuffer returned for the buffer, and timestamps is
+    // only filled in if the input asked for them.
+    struct DequeueBufferOutput {
+        DequeueBufferOutput() = default;
+
+        // Moveable.
+        DequeueBufferOutput(DequeueBufferOutput&& src) = default;
+        DequeueBufferOutput& operator=(DequeueBufferOutput&& src) = default;
+        // Not copyable.
+        DequeueBufferOutput(const DequeueBufferOutput& src) = delete;
+        DequeueBufferOutput& operator=(const DequeueBufferOutput& src) = delete;
+
+        status_t result{NO_ERROR};
+        int slot{-1};
+        sp<Fence> fence{Fence::NO_FENCE};
+        uint64_t bufferAge{0};
+        FrameEventHistoryDelta timestamps;
+    };
+
+    // dequeueBuffers dequeues one buffer per entry of inputs with a single
+    // call, as if dequeueBuffer was called for each of them in order. This
+    // is most useful for producers that fill bursts of buffers, such as
+    // camera and video pipelines.
+    //
+    // If one of the dequeues fails, the buffers dequeued before it in the
+    // batch are cancelled, outputs is left empty and the error of that
+    // dequeue is returned. At most NUM_BUFFER_SLOTS buffers can be dequeued
+    // in a batch; larger batches fail with BAD_VALUE.
+    virtual status_t dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                                    std::vector<DequeueBufferOutput>* outputs);
+
+    // The arguments of one queueBuffer call in a queueBuffers batch.
+    struct QueueBufferRequest {
+        int slot;
+        QueueBufferInput input;
+    };
+
+    // queueBuffers queues one buffer per entry of requests with a single
+    // call, as if queueBuffer was called for each of them in order.
+    //
+    // Queueing stops at the first buffer that fails, and its error is
+    // returned. outputs holds one entry per buffer that was queued, so the
+    // buffers after the failing one are still dequeued. At most
+    // NUM_BUFFER_SLOTS buffers can be queued in a batch; larger batches fail
+    // with BAD_VALUE.
+    virtual status_t queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                                  std::vector<QueueBufferOutput>* outputs);
+
     // cancelBuffer indicates that the client does not wish to fill in the
     // buffer associated with slot and transfers ownership of the slot back to
     // the server.
@@ -540,6 +600,19 @@ public:
     virtual void allocateBuffers(uint32_t width, uint32_t height,
             PixelFormat format, uint64_t usage) = 0;
 
+    // Like allocateBuffers, but also replaces free buffers that don't match
+    // the given dimensions/format/usage, so that every slot permitted by the
+    // current BufferQueue configuration holds a matching buffer.
+    //
+    // Buffers that are dequeued, queued or acquired are never touched, so a
+    // replacement only takes effect when its slot is next dequeued, at which
+    // point dequeueBuffer returns BUFFER_NEEDS_REALLOCATION for it. This is
+    // most useful ahead of a resize, to allocate the new buffers off the
+    // producer's thread. Buffers still in flight at that point are
+    // reallocated by dequeueBuffer as usual.
+    virtual void reallocateBuffers(uint32_t width, uint32_t height,
+            PixelFormat format, uint64_t usage);
+
     // Sets whether dequeueBuffer is allowed to allocate new buffers.
     //
     // Normally dequeueBuffer does not discriminate between free slots which
@@ -620,6 +693,15 @@ public:
     // Gets the frame events that haven't already been retrieved.
     virtual void getFrameTimestamps(FrameEventHistoryDelta* /*outDelta*/) {}
 
+    // Returns read-only memory the consumer publishes frame timestamps in, so
+    // that they can be polled without calling getFrameTimestamps. See
+    // SharedFrameTimestamps. Only values that are final are published, so
+    // getFrameTimestamps is still needed for the rest.
+    //
+    // Return of a value other than NO_ERROR means the consumer doesn't share
+    // its frame timestamps.
+    virtual status_t getFrameTimestampsMemory(sp<IMemory>* outMemory);
+
     // Returns a unique id for this BufferQueue
     virtual status_t getUniqueId(uint64_t* outId) const = 0;
 
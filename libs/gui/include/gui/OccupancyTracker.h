@@ -36,7 +36,8 @@ public:
       : mPendingSegment(),
         mSegmentHistory(),
         mLastOccupancy(0),
-        mLastOccupancyChangeTime(0) {}
+        mLastOccupancyChangeTime(0),
+        mDoubleBufferedSegmentCount(0) {}
 
     struct Segment : public Parcelable {
         Segment()
@@ -72,6 +73,14 @@ public:
     void registerOccupancyChange(size_t occupancy);
     std::vector<Segment> getSegmentHistory(bool forceFlush);
 
+    // Returns how many of the most recently recorded segments in a row did
+    // not use a third buffer. Unlike the segment history, this is not reset
+    // by getSegmentHistory.
+    size_t getDoubleBufferedSegmentCount() const {
+        return mDoubleBufferedSegmentCount;
+    }
+    void resetDoubleBufferedSegmentCount() { mDoubleBufferedSegmentCount = 0; }
+
 private:
     static constexpr size_t MAX_HISTORY_SIZE = 10;
     static constexpr nsecs_t NEW_SEGMENT_DELAY = ms2ns(100);
@@ -96,6 +105,7 @@ private:
 
     size_t mLastOccupancy;
     nsecs_t mLastOccupancyChangeTime;
+    size_t mDoubleBufferedSegmentCount;
 
 }; // class OccupancyTracker
 
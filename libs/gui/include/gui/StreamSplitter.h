@@ -70,10 +70,10 @@ private:
     // From IConsumerListener
     //
     // During this callback, we store some tracking information, detach the
-    // buffer from the input, and attach it to each of the outputs. This call
-    // can block if there are too many outstanding buffers. If it blocks, it
-    // will resume when onBufferReleasedByOutput releases a buffer back to the
-    // input.
+    // buffer from the input, and attach it to each of the outputs. The outputs
+    // are called without mMutex held. This call can block if there are too
+    // many outstanding buffers. If it blocks, it will resume when
+    // onBufferReleasedByOutput releases a buffer back to the input.
     virtual void onFrameAvailable(const BufferItem& item);
 
     // From IConsumerListener
@@ -167,6 +167,9 @@ private:
     // communicate with it further.
     bool mIsAbandoned;
 
+    // mQueueMutex serializes onFrameAvailable calls, so that frames reach the
+    // outputs in order while mMutex is not held. It is taken before mMutex.
+    Mutex mQueueMutex;
     Mutex mMutex;
     Condition mReleaseCondition;
     int mOutstandingBuffers;
@@ -106,6 +106,13 @@ public:
      */
     void allocateBuffers();
 
+    /* Like allocateBuffers, but also replaces free buffers that don't match
+     * the requested format and dimensions, see
+     * IGraphicBufferProducer::reallocateBuffers. Call it after changing the
+     * buffer dimensions to avoid reallocating in dequeueBuffer.
+     */
+    void reallocateBuffers();
+
     /* Sets the generation number on the IGraphicBufferProducer and updates the
      * generation number on any buffers attached to the Surface after this call.
      * See IGBP::setGenerationNumber for more information. */
@@ -230,6 +237,7 @@ private:
     int dispatchGetWideColorSupport(va_list args);
     int dispatchGetHdrSupport(va_list args);
     int dispatchGetConsumerUsage64(va_list args);
+    int dispatchSetDequeueTimeout(va_list args);
     bool transformToDisplayInverse();
 
 protected:
@@ -294,6 +302,28 @@ public:
 
     static status_t attachAndQueueBuffer(Surface* surface, sp<GraphicBuffer> buffer);
 
+    // Batch version of dequeueBuffer. Dequeues buffers->size() buffers with
+    // the current buffer settings in a single IGraphicBufferProducer call and
+    // fills in one buffer and fence per entry. Either every buffer of the
+    // batch is dequeued or none is. Not supported in shared buffer mode.
+    struct BatchBuffer {
+        ANativeWindowBuffer* buffer = nullptr;
+        int fenceFd = -1;
+    };
+    virtual int dequeueBuffers(std::vector<BatchBuffer>* buffers);
+
+    // Batch version of queueBuffer. Queues the buffers in order in a single
+    // IGraphicBufferProducer call, taking ownership of their fences. Each
+    // buffer carries its own timestamp, since a burst usually covers several
+    // capture times. Queueing stops at the first buffer that fails. Not
+    // supported in shared buffer mode.
+    struct BatchQueuedBuffer {
+        ANativeWindowBuffer* buffer = nullptr;
+        int fenceFd = -1;
+        nsecs_t timestamp = NATIVE_WINDOW_TIMESTAMP_AUTO;
+    };
+    virtual int queueBuffers(const std::vector<BatchQueuedBuffer>& buffers);
+
 protected:
     enum { NUM_BUFFER_SLOTS = BufferQueueDefs::NUM_BUFFER_SLOTS };
     enum { DEFAULT_FORMAT = PIXEL_FORMAT_RGBA_8888 };
@@ -303,6 +333,15 @@ protected:
     void freeAllBuffers();
     int getSlotFromBufferLocked(android_native_buffer_t* buffer) const;
 
+    // Shared by the single and batch paths of dequeue and queue.
+    void getDequeueBufferInputLocked(IGraphicBufferProducer::DequeueBufferInput* dequeueInput);
+    status_t onBufferDequeuedLocked(int buf, const sp<Fence>& fence, status_t result,
+                                    const FrameEventHistoryDelta* frameTimestamps, int* fenceFd);
+    IGraphicBufferProducer::QueueBufferInput getQueueBufferInputLocked(
+            android_native_buffer_t* buffer, const sp<Fence>& fence, nsecs_t timestamp);
+    void onBufferQueuedLocked(int slot, const sp<Fence>& fence,
+                              const IGraphicBufferProducer::QueueBufferOutput& output);
+
     struct BufferSlot {
         sp<GraphicBuffer> buffer;
         Region dirtyRegion;
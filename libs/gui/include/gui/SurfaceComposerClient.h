@@ -320,12 +320,28 @@ public:
         void cacheBuffers();
         void registerSurfaceControlForCallback(const sp<SurfaceControl>& sc);
 
+        // Holds what applyOnNextFrame() has collected until the next vsync.
+        class FrameBatcher;
+        // Sends this transaction to SurfaceFlinger as it is, without looking at the batch.
+        status_t applyNow(bool synchronous);
+
     public:
         Transaction() = default;
         virtual ~Transaction() = default;
         Transaction(Transaction const& other);
 
         status_t apply(bool synchronous = false);
+        // Applies this transaction together with everything else this process applies with
+        // applyOnNextFrame() before the next vsync, merged per SurfaceControl into a single
+        // call to SurfaceFlinger. This bounds the number of transactions a client that updates
+        // many layers, or the same layer many times, sends per frame, at the cost of up to a
+        // frame of latency. apply() sends anything still waiting first, so transactions reach
+        // SurfaceFlinger in the order they were applied. Synchronous transactions and
+        // transactions with a desired present time are applied right away.
+        status_t applyOnNextFrame();
+        // Sends whatever applyOnNextFrame() has collected now instead of at the next vsync, for
+        // clients that run their own frame loop and know when a frame's updates are done.
+        static status_t flushFrameTransactions();
         // Merge another transaction in to this one, clearing other
         // as if it had been applied.
         Transaction& merge(Transaction&& other);
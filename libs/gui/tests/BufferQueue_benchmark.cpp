@@ -0,0 +1,155 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IConsumerListener.h>
+#include <gui/IProducerListener.h>
+#include <system/window.h>
+#include <ui/GraphicBuffer.h>
+#include <utils/String8.h>
+
+namespace android {
+namespace {
+
+constexpr uint32_t kWidth = 64;
+constexpr uint32_t kHeight = 64;
+constexpr uint64_t kUsage = GRALLOC_USAGE_SW_WRITE_OFTEN | GRALLOC_USAGE_SW_READ_OFTEN;
+
+// Wakes the consumer side of the benchmark when a frame is queued, the way
+// BufferLayerConsumer is woken in SurfaceFlinger.
+struct FrameCountingListener : public BnConsumerListener {
+    void onFrameAvailable(const BufferItem& /* item */) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingFrames++;
+        condition.notify_one();
+    }
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+
+    void waitForFrame() {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return pendingFrames > 0; });
+        pendingFrames--;
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    int pendingFrames = 0;
+};
+
+// Reads the lock counters BufferQueueCore::dumpState prints for one side.
+void readLockStats(const String8& dump, const char* side, uint64_t* acquisitions,
+                   uint64_t* contentions) {
+    const String8 needle = String8::format("%s-lock acquisitions=", side);
+    const char* stats = strstr(dump.string(), needle.string());
+    if (stats == nullptr ||
+        sscanf(stats + needle.length(), "%" SCNu64 " contended=%" SCNu64, acquisitions,
+               contentions) != 2) {
+        *acquisitions = 0;
+        *contentions = 0;
+    }
+}
+
+// A producer thread dequeues and queues as fast as it can while the benchmark
+// thread acquires and releases every frame, so both sides of the BufferQueue
+// run concurrently on every frame. range(0) is the number of buffers the
+// producer may dequeue at once: 1 for double buffering, 2 for triple.
+void BM_BufferQueuePingPong(benchmark::State& state) {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<FrameCountingListener> listener = new FrameCountingListener;
+    consumer->consumerConnect(listener, false);
+    consumer->setDefaultBufferSize(kWidth, kHeight);
+    producer->setMaxDequeuedBufferCount(state.range(0));
+
+    IGraphicBufferProducer::QueueBufferOutput output;
+    if (producer->connect(new DummyProducerListener, NATIVE_WINDOW_API_CPU, false, &output) !=
+        NO_ERROR) {
+        state.SkipWithError("failed to connect the producer");
+        return;
+    }
+    producer->allocateBuffers(0, 0, 0, kUsage);
+
+    std::thread producerThread([producer] {
+        const IGraphicBufferProducer::QueueBufferInput input(0, false, HAL_DATASPACE_UNKNOWN,
+                                                             Rect(kWidth, kHeight),
+                                                             NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                             Fence::NO_FENCE);
+        IGraphicBufferProducer::QueueBufferOutput queueOutput;
+        for (;;) {
+            int slot;
+            sp<Fence> fence;
+            const status_t result = producer->dequeueBuffer(&slot, &fence, 0, 0, 0, kUsage,
+                                                            nullptr, nullptr);
+            if (result < 0) {
+                // The consumer disconnected
+                return;
+            }
+            if (result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+                sp<GraphicBuffer> buffer;
+                producer->requestBuffer(slot, &buffer);
+            }
+            if (producer->queueBuffer(slot, input, &queueOutput) != NO_ERROR) {
+                return;
+            }
+        }
+    });
+
+    for (auto _ : state) {
+        listener->waitForFrame();
+        BufferItem item;
+        if (consumer->acquireBuffer(&item, 0) != NO_ERROR) {
+            state.SkipWithError("failed to acquire a queued frame");
+            break;
+        }
+        consumer->releaseBuffer(item.mSlot, item.mFrameNumber, EGL_NO_DISPLAY, EGL_NO_SYNC_KHR,
+                                Fence::NO_FENCE);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    String8 dump;
+    consumer->dumpState(String8(), &dump);
+    uint64_t acquisitions;
+    uint64_t contentions;
+    readLockStats(dump, "producer", &acquisitions, &contentions);
+    state.counters["producer_contended"] = contentions;
+    state.counters["producer_locks"] = acquisitions;
+    readLockStats(dump, "consumer", &acquisitions, &contentions);
+    state.counters["consumer_contended"] = contentions;
+    state.counters["consumer_locks"] = acquisitions;
+
+    // Abandons the queue, which fails the producer's next dequeue
+    consumer->consumerDisconnect();
+    producerThread.join();
+}
+BENCHMARK(BM_BufferQueuePingPong)->Arg(1)->Arg(2)->UseRealTime();
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -512,6 +512,37 @@ TEST_F(BufferQueueTest, TestDisallowingAllocation) {
                                        GRALLOC_USAGE_SW_WRITE_OFTEN, nullptr, nullptr));
 }
 
+TEST_F(BufferQueueTest, ReallocateBuffersReplacesMismatchedFreeBuffers) {
+    createBufferQueue();
+    sp<DummyConsumer> dc(new DummyConsumer);
+    ASSERT_EQ(OK, mConsumer->consumerConnect(dc, true));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    ASSERT_EQ(OK, mProducer->connect(new DummyProducerListener,
+            NATIVE_WINDOW_API_CPU, true, &output));
+
+    static const uint32_t WIDTH = 320;
+    static const uint32_t HEIGHT = 240;
+
+    ASSERT_EQ(OK, mConsumer->setDefaultBufferSize(WIDTH, HEIGHT));
+    mProducer->allocateBuffers(0, 0, 0, GRALLOC_USAGE_SW_WRITE_OFTEN);
+
+    // Replace the preallocated buffers as if the window was about to resize
+    mProducer->reallocateBuffers(WIDTH * 2, HEIGHT * 2, 0, GRALLOC_USAGE_SW_WRITE_OFTEN);
+
+    // Dequeueing at the new size must not need to allocate, but must tell the
+    // producer to request the replaced buffer
+    ASSERT_EQ(OK, mProducer->allowAllocation(false));
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> buffer;
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+              mProducer->dequeueBuffer(&slot, &fence, WIDTH * 2, HEIGHT * 2, 0,
+                                       GRALLOC_USAGE_SW_WRITE_OFTEN, nullptr, nullptr));
+    ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buffer));
+    EXPECT_EQ(WIDTH * 2, buffer->getWidth());
+    EXPECT_EQ(HEIGHT * 2, buffer->getHeight());
+}
+
 TEST_F(BufferQueueTest, TestGenerationNumbers) {
     createBufferQueue();
     sp<DummyConsumer> dc(new DummyConsumer);
@@ -998,6 +1029,39 @@ TEST_F(BufferQueueTest, TestOccupancyHistory) {
     ASSERT_EQ(true, thirdSegment.usedThirdBuffer);
 }
 
+TEST_F(BufferQueueTest, TestOccupancyDoubleBufferedSegmentCount) {
+    OccupancyTracker tracker;
+    auto runSegment = [&tracker](size_t peakOccupancy) {
+        for (size_t i = 0; i < 5; ++i) {
+            tracker.registerOccupancyChange(peakOccupancy);
+            std::this_thread::sleep_for(1ms);
+            tracker.registerOccupancyChange(0);
+            std::this_thread::sleep_for(1ms);
+        }
+        // Sleep between segments
+        std::this_thread::sleep_for(150ms);
+    };
+
+    // Each segment is only recorded once the next one starts
+    runSegment(1);
+    runSegment(1);
+    ASSERT_EQ(1u, tracker.getDoubleBufferedSegmentCount());
+    runSegment(1);
+    runSegment(2);
+    ASSERT_EQ(3u, tracker.getDoubleBufferedSegmentCount());
+
+    // A segment that used a third buffer starts the count over
+    runSegment(1);
+    ASSERT_EQ(0u, tracker.getDoubleBufferedSegmentCount());
+
+    // Reading the history doesn't reset the count
+    ASSERT_EQ(5u, tracker.getSegmentHistory(true).size());
+    ASSERT_EQ(1u, tracker.getDoubleBufferedSegmentCount());
+
+    tracker.resetDoubleBufferedSegmentCount();
+    ASSERT_EQ(0u, tracker.getDoubleBufferedSegmentCount());
+}
+
 TEST_F(BufferQueueTest, TestDiscardFreeBuffers) {
     createBufferQueue();
     sp<DummyConsumer> dc(new DummyConsumer);
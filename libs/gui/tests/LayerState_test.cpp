@@ -0,0 +1,107 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+#include <gui/LayerState.h>
+
+namespace android::test {
+
+namespace {
+
+layer_state_t roundTrip(const layer_state_t& state, size_t* parcelSize = nullptr) {
+    Parcel p;
+    EXPECT_EQ(NO_ERROR, state.write(p));
+    if (parcelSize) {
+        *parcelSize = p.dataSize();
+    }
+    p.setDataPosition(0);
+    layer_state_t result;
+    EXPECT_EQ(NO_ERROR, result.read(p));
+    EXPECT_EQ(p.dataSize(), p.dataPosition());
+    return result;
+}
+
+} // namespace
+
+TEST(LayerStateTest, ParcelsOnlyChangedFields) {
+    layer_state_t position;
+    position.what = layer_state_t::ePositionChanged;
+    position.x = 12.0f;
+    position.y = 34.0f;
+    // Not flagged, so neither sent nor read
+    position.alpha = 0.5f;
+    position.transparentRegion = Region(Rect(0, 0, 100, 100));
+
+    size_t positionSize;
+    layer_state_t result = roundTrip(position, &positionSize);
+    EXPECT_EQ(layer_state_t::ePositionChanged, result.what);
+    EXPECT_EQ(12.0f, result.x);
+    EXPECT_EQ(34.0f, result.y);
+    EXPECT_EQ(0.0f, result.alpha);
+    EXPECT_TRUE(result.transparentRegion.isEmpty());
+    EXPECT_EQ(nullptr, result.buffer);
+
+    layer_state_t positionAndRegion = position;
+    positionAndRegion.what |= layer_state_t::eTransparentRegionChanged;
+    size_t positionAndRegionSize;
+    result = roundTrip(positionAndRegion, &positionAndRegionSize);
+    EXPECT_EQ(Rect(0, 0, 100, 100), result.transparentRegion.getBounds());
+    EXPECT_LT(positionSize, positionAndRegionSize);
+}
+
+TEST(LayerStateTest, RoundTripsChangedFields) {
+    layer_state_t state;
+    state.what = layer_state_t::eRelativeLayerChanged | layer_state_t::eSizeChanged |
+            layer_state_t::eAlphaChanged | layer_state_t::eFlagsChanged |
+            layer_state_t::eCropChanged | layer_state_t::eFrameChanged |
+            layer_state_t::eBackgroundColorChanged | layer_state_t::eCornerRadiusChanged |
+            layer_state_t::eMetadataChanged | layer_state_t::eColorSpaceAgnosticChanged;
+    state.z = -3;
+    state.w = 640;
+    state.h = 480;
+    state.alpha = 0.25f;
+    state.flags = layer_state_t::eLayerOpaque;
+    state.mask = layer_state_t::eLayerOpaque | layer_state_t::eLayerHidden;
+    state.crop = Rect(1, 2, 3, 4);
+    state.frame = Rect(5, 6, 7, 8);
+    state.color = half3(0.5f, 0.25f, 1.0f);
+    state.bgColorAlpha = 0.75f;
+    state.bgColorDataspace = ui::Dataspace::SRGB;
+    state.cornerRadius = 9.0f;
+    state.metadata.setInt32(1, 42);
+    state.colorSpaceAgnostic = true;
+
+    layer_state_t result = roundTrip(state);
+    EXPECT_EQ(state.what, result.what);
+    EXPECT_EQ(-3, result.z);
+    EXPECT_EQ(640u, result.w);
+    EXPECT_EQ(480u, result.h);
+    EXPECT_EQ(0.25f, result.alpha);
+    EXPECT_EQ(state.flags, result.flags);
+    EXPECT_EQ(state.mask, result.mask);
+    EXPECT_EQ(Rect(1, 2, 3, 4), result.crop);
+    EXPECT_EQ(Rect(5, 6, 7, 8), result.frame);
+    EXPECT_EQ(state.color, result.color);
+    EXPECT_EQ(0.75f, result.bgColorAlpha);
+    EXPECT_EQ(ui::Dataspace::SRGB, result.bgColorDataspace);
+    EXPECT_EQ(9.0f, result.cornerRadius);
+    EXPECT_EQ(42, result.metadata.getInt32(1, 0));
+    EXPECT_TRUE(result.colorSpaceAgnostic);
+}
+
+} // namespace android::test
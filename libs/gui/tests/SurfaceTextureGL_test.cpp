@@ -734,4 +734,36 @@ TEST_F(SurfaceTextureGLTest, InvalidWidthOrHeightFails) {
     ASSERT_NE(NO_ERROR, mST->updateTexImage());
 }
 
+TEST_F(SurfaceTextureGLTest, LockCurrentBufferReadsTexImage) {
+    ASSERT_EQ(NO_ERROR, native_window_api_connect(mANW.get(),
+            NATIVE_WINDOW_API_CPU));
+    ASSERT_EQ(NO_ERROR, native_window_set_buffers_dimensions(mANW.get(),
+            16, 16));
+    ASSERT_EQ(NO_ERROR, native_window_set_buffers_format(mANW.get(),
+            HAL_PIXEL_FORMAT_RGBA_8888));
+    ASSERT_EQ(NO_ERROR, native_window_set_usage(mANW.get(),
+            GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN));
+
+    uint8_t* img = nullptr;
+    EXPECT_EQ(INVALID_OPERATION, mST->lockCurrentBuffer((void**)(&img)));
+
+    ASSERT_NO_FATAL_FAILURE(produceOneRGBA8Frame(mANW));
+    ASSERT_EQ(NO_ERROR, mST->updateTexImage());
+
+    ASSERT_EQ(NO_ERROR, mST->lockCurrentBuffer((void**)(&img)));
+    ASSERT_TRUE(img != nullptr);
+    EXPECT_EQ(35, img[0]);
+    EXPECT_EQ(231, img[16]);
+    EXPECT_EQ(35, img[17]);
+    EXPECT_EQ(INVALID_OPERATION, mST->lockCurrentBuffer((void**)(&img)));
+    EXPECT_EQ(NO_ERROR, mST->unlockCurrentBuffer());
+    EXPECT_EQ(INVALID_OPERATION, mST->unlockCurrentBuffer());
+
+    // Latching the next frame ends the CPU access to the previous one.
+    ASSERT_EQ(NO_ERROR, mST->lockCurrentBuffer((void**)(&img)));
+    ASSERT_NO_FATAL_FAILURE(produceOneRGBA8Frame(mANW));
+    ASSERT_EQ(NO_ERROR, mST->updateTexImage());
+    EXPECT_EQ(INVALID_OPERATION, mST->unlockCurrentBuffer());
+}
+
 } // namespace android
@@ -496,6 +496,103 @@ TEST_F(SurfaceTest, TestGetLastDequeueStartTime) {
     ASSERT_GE(after, lastDequeueTime);
 }
 
+TEST_F(SurfaceTest, BatchOperations) {
+    // Nothing acquires from DummyConsumer, so the three batches below must
+    // fit in the queue together.
+    const int BUFFER_COUNT = 16;
+    const int BATCH_SIZE = 4;
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<DummyConsumer> dummyConsumer(new DummyConsumer);
+    consumer->consumerConnect(dummyConsumer, false);
+    consumer->setConsumerName(String8("TestConsumer"));
+
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+    sp<DummyProducerListener> listener = new DummyProducerListener();
+    ASSERT_EQ(OK, surface->connect(NATIVE_WINDOW_API_CPU, listener));
+    ASSERT_EQ(NO_ERROR, native_window_set_buffer_count(window.get(), BUFFER_COUNT));
+
+    std::vector<Surface::BatchBuffer> buffers(BATCH_SIZE);
+
+    // Batch dequeued buffers can be queued individually
+    ASSERT_EQ(NO_ERROR, surface->dequeueBuffers(&buffers));
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        ANativeWindowBuffer* buffer = buffers[i].buffer;
+        int fence = buffers[i].fenceFd;
+        ASSERT_NE(nullptr, buffer);
+        ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+    }
+
+    // Batch queued buffers can be dequeued individually
+    std::vector<Surface::BatchQueuedBuffer> queuedBuffers(BATCH_SIZE);
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        ANativeWindowBuffer* buffer;
+        int fence;
+        ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+        queuedBuffers[i].buffer = buffer;
+        queuedBuffers[i].fenceFd = fence;
+        queuedBuffers[i].timestamp = NATIVE_WINDOW_TIMESTAMP_AUTO;
+    }
+    ASSERT_EQ(NO_ERROR, surface->queueBuffers(queuedBuffers));
+
+    // Batched dequeue and queue can be combined
+    ASSERT_EQ(NO_ERROR, surface->dequeueBuffers(&buffers));
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        queuedBuffers[i].buffer = buffers[i].buffer;
+        queuedBuffers[i].fenceFd = buffers[i].fenceFd;
+        queuedBuffers[i].timestamp = NATIVE_WINDOW_TIMESTAMP_AUTO;
+    }
+    ASSERT_EQ(NO_ERROR, surface->queueBuffers(queuedBuffers));
+
+    ASSERT_EQ(NO_ERROR, surface->disconnect(NATIVE_WINDOW_API_CPU));
+}
+
+TEST_F(SurfaceTest, BatchIllegalOperations) {
+    const int BUFFER_COUNT = 16;
+    const int BATCH_SIZE = 8;
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<DummyConsumer> dummyConsumer(new DummyConsumer);
+    consumer->consumerConnect(dummyConsumer, false);
+    consumer->setConsumerName(String8("TestConsumer"));
+
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+    sp<DummyProducerListener> listener = new DummyProducerListener();
+    ASSERT_EQ(OK, surface->connect(NATIVE_WINDOW_API_CPU, listener));
+    ASSERT_EQ(NO_ERROR, native_window_set_buffer_count(window.get(), BUFFER_COUNT));
+
+    std::vector<Surface::BatchBuffer> buffers(BATCH_SIZE);
+    std::vector<Surface::BatchQueuedBuffer> queuedBuffers(BATCH_SIZE);
+
+    // Batch operations are invalid in shared buffer mode
+    surface->setSharedBufferMode(true);
+    ASSERT_EQ(INVALID_OPERATION, surface->dequeueBuffers(&buffers));
+    ASSERT_EQ(INVALID_OPERATION, surface->queueBuffers(queuedBuffers));
+    surface->setSharedBufferMode(false);
+
+    // A failing batch dequeue leaves no buffer dequeued. The max dequeued
+    // buffer count is only enforced once a buffer has been queued.
+    ANativeWindowBuffer* buffer;
+    int fence;
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+    std::vector<Surface::BatchBuffer> tooManyBuffers(BUFFER_COUNT);
+    ASSERT_NE(NO_ERROR, surface->dequeueBuffers(&tooManyBuffers));
+    ASSERT_EQ(NO_ERROR, surface->dequeueBuffers(&buffers));
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        ASSERT_EQ(NO_ERROR,
+                  window->cancelBuffer(window.get(), buffers[i].buffer, buffers[i].fenceFd));
+    }
+
+    ASSERT_EQ(NO_ERROR, surface->disconnect(NATIVE_WINDOW_API_CPU));
+}
+
 class FakeConsumer : public BnConsumerListener {
 public:
     void onFrameAvailable(const BufferItem& /*item*/) override {}
@@ -527,7 +624,12 @@ public:
         mAddAndGetFrameTimestampsCallCount++;
     }
 
+    sp<IMemory> getFrameTimestampsMemory() override {
+        return mShareFrameTimestamps ? mFrameEventHistory.getSharedTimestampsMemory() : nullptr;
+    }
+
     bool mGetFrameTimestampsEnabled = false;
+    bool mShareFrameTimestamps = false;
 
     ConsumerFrameEventHistory mFrameEventHistory;
     int mAddAndGetFrameTimestampsCallCount = 0;
@@ -1526,6 +1628,42 @@ TEST_F(GetFrameTimestampsTest, ZeroRequestedTimestampsNoSync) {
     EXPECT_EQ(oldCount, mFakeConsumer->mGetFrameTimestampsCount);
 }
 
+// This test verifies that the timestamps a consumer shares in memory are read
+// without a sync call, and that a sync call is still made for pending ones.
+TEST_F(GetFrameTimestampsTest, SharedTimestampsNoSync) {
+    mFakeConsumer->mShareFrameTimestamps = true;
+    enableFrameTimestamps();
+
+    const uint64_t fId1 = getNextFrameId();
+    dequeueAndQueue(0);
+    mFrames[0].signalQueueFences();
+
+    addFrameEvents(true, NO_FRAME_INDEX, 0);
+
+    // Latch and first refresh times are final as soon as they're recorded.
+    int oldCount = mFakeConsumer->mGetFrameTimestampsCount;
+    int result = native_window_get_frame_timestamps(mWindow.get(), fId1,
+            nullptr, nullptr, &outLatchTime, &outFirstRefreshStartTime,
+            nullptr, nullptr, nullptr, nullptr, nullptr);
+    EXPECT_EQ(NO_ERROR, result);
+    EXPECT_EQ(oldCount, mFakeConsumer->mGetFrameTimestampsCount);
+    EXPECT_EQ(mFrames[0].kLatchTime, outLatchTime);
+    EXPECT_EQ(mFrames[0].mRefreshes[0].kStartTime, outFirstRefreshStartTime);
+
+    // The composition fences hadn't signaled when they were published, so
+    // the producer has to sync to get them.
+    mFrames[0].signalRefreshFences();
+    result = native_window_get_frame_timestamps(mWindow.get(), fId1,
+            nullptr, nullptr, nullptr, nullptr, nullptr,
+            &outGpuCompositionDoneTime, &outDisplayPresentTime, nullptr,
+            nullptr);
+    EXPECT_EQ(NO_ERROR, result);
+    EXPECT_EQ(oldCount + 1, mFakeConsumer->mGetFrameTimestampsCount);
+    EXPECT_EQ(mFrames[0].mRefreshes[0].kGpuCompositionDoneTime,
+            outGpuCompositionDoneTime);
+    EXPECT_EQ(mFrames[0].mRefreshes[0].kPresentTime, outDisplayPresentTime);
+}
+
 // This test verifies that fences can signal and update timestamps producer
 // side without an additional sync call to the consumer.
 TEST_F(GetFrameTimestampsTest, FencesInProducerNoSync) {
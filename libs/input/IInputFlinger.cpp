@@ -45,6 +45,21 @@ public:
                 IBinder::FLAG_ONEWAY);
     }
 
+    virtual status_t updateInputWindows(const InputWindowsUpdate& update,
+            const sp<ISetInputWindowsListener>& setInputWindowsListener) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IInputFlinger::getInterfaceDescriptor());
+
+        status_t result = update.write(data);
+        if (result != OK) {
+            return result;
+        }
+        data.writeStrongBinder(IInterface::asBinder(setInputWindowsListener));
+
+        return remote()->transact(BnInputFlinger::UPDATE_INPUT_WINDOWS_TRANSACTION, data, &reply,
+                IBinder::FLAG_ONEWAY);
+    }
+
     virtual void transferTouchFocus(const sp<IBinder>& fromToken, const sp<IBinder>& toToken) {
         Parcel data, reply;
         data.writeInterfaceToken(IInputFlinger::getInterfaceDescriptor());
@@ -68,10 +83,83 @@ public:
         channel->write(data);
         remote()->transact(BnInputFlinger::UNREGISTER_INPUT_CHANNEL_TRANSACTION, data, &reply);
     }
+
+    virtual status_t getInputLatencyStats(std::vector<InputLatencyStats>* outStats) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IInputFlinger::getInterfaceDescriptor());
+        status_t result = remote()->transact(BnInputFlinger::GET_INPUT_LATENCY_STATS_TRANSACTION,
+                data, &reply);
+        if (result != OK) {
+            return result;
+        }
+        result = reply.readInt32();
+        if (result != OK) {
+            return result;
+        }
+        size_t count = reply.readUint32();
+        if (count > reply.dataSize()) {
+            return BAD_VALUE;
+        }
+        outStats->clear();
+        outStats->resize(count);
+        for (InputLatencyStats& stats : *outStats) {
+            result = InputLatencyStats::read(reply, &stats);
+            if (result != OK) {
+                return result;
+            }
+        }
+        return OK;
+    }
 };
 
 IMPLEMENT_META_INTERFACE(InputFlinger, "android.input.IInputFlinger");
 
+status_t InputWindowsUpdate::write(Parcel& output) const {
+    output.writeUint64(baseGeneration);
+    output.writeUint64(generation);
+    output.writeUint32(static_cast<uint32_t>(changedWindows.size()));
+    for (const auto& info : changedWindows) {
+        info.write(output);
+    }
+    output.writeUint32(static_cast<uint32_t>(removedWindows.size()));
+    for (const auto& token : removedWindows) {
+        output.writeStrongBinder(token);
+    }
+    output.writeUint32(static_cast<uint32_t>(order.size()));
+    for (const auto& token : order) {
+        output.writeStrongBinder(token);
+    }
+    return OK;
+}
+
+status_t InputWindowsUpdate::read(const Parcel& from, InputWindowsUpdate* outUpdate) {
+    outUpdate->baseGeneration = from.readUint64();
+    outUpdate->generation = from.readUint64();
+
+    size_t count = from.readUint32();
+    if (count > from.dataSize()) {
+        return BAD_VALUE;
+    }
+    outUpdate->changedWindows.clear();
+    outUpdate->changedWindows.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        outUpdate->changedWindows.push_back(InputWindowInfo::read(from));
+    }
+
+    for (auto* tokens : {&outUpdate->removedWindows, &outUpdate->order}) {
+        count = from.readUint32();
+        if (count > from.dataSize()) {
+            return BAD_VALUE;
+        }
+        tokens->clear();
+        tokens->reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            tokens->push_back(from.readStrongBinder());
+        }
+    }
+    return OK;
+}
+
 status_t BnInputFlinger::onTransact(
         uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags) {
     switch(code) {
@@ -90,6 +178,18 @@ status_t BnInputFlinger::onTransact(
         setInputWindows(handles, setInputWindowsListener);
         break;
     }
+    case UPDATE_INPUT_WINDOWS_TRANSACTION: {
+        CHECK_INTERFACE(IInputFlinger, data, reply);
+        InputWindowsUpdate update;
+        status_t result = InputWindowsUpdate::read(data, &update);
+        if (result != OK) {
+            return result;
+        }
+        const sp<ISetInputWindowsListener> setInputWindowsListener =
+                ISetInputWindowsListener::asInterface(data.readStrongBinder());
+        updateInputWindows(update, setInputWindowsListener);
+        break;
+    }
     case REGISTER_INPUT_CHANNEL_TRANSACTION: {
         CHECK_INTERFACE(IInputFlinger, data, reply);
         sp<InputChannel> channel = new InputChannel();
@@ -104,6 +204,19 @@ status_t BnInputFlinger::onTransact(
         unregisterInputChannel(channel);
         break;
     }
+    case GET_INPUT_LATENCY_STATS_TRANSACTION: {
+        CHECK_INTERFACE(IInputFlinger, data, reply);
+        std::vector<InputLatencyStats> stats;
+        status_t result = getInputLatencyStats(&stats);
+        reply->writeInt32(result);
+        if (result == OK) {
+            reply->writeUint32(static_cast<uint32_t>(stats.size()));
+            for (const InputLatencyStats& windowStats : stats) {
+                windowStats.write(*reply);
+            }
+        }
+        break;
+    }
     case TRANSFER_TOUCH_FOCUS: {
         CHECK_INTERFACE(IInputFlinger, data, reply);
         sp<IBinder> fromToken = data.readStrongBinder();
@@ -39,6 +39,11 @@ InputApplicationInfo InputApplicationInfo::read(const Parcel& from) {
     return ret;
 }
 
+bool InputApplicationInfo::operator==(const InputApplicationInfo& other) const {
+    return token == other.token && name == other.name
+            && dispatchingTimeout == other.dispatchingTimeout;
+}
+
 status_t InputApplicationInfo::write(Parcel& output) const {
     output.writeStrongBinder(token);
     output.writeString8(String8(name.c_str()));
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <input/InputLatencyStats.h>
+#include <utils/String8.h>
+
+namespace android {
+
+void InputLatencyStats::record(Stage stage, nsecs_t latency) {
+    size_t bucket = 0;
+    while (bucket < BUCKET_LIMITS_US.size() && latency > us2ns(BUCKET_LIMITS_US[bucket])) {
+        bucket++;
+    }
+    histograms[stage][bucket]++;
+}
+
+uint32_t InputLatencyStats::getCount(Stage stage) const {
+    uint32_t count = 0;
+    for (uint32_t bucketCount : histograms[stage]) {
+        count += bucketCount;
+    }
+    return count;
+}
+
+nsecs_t InputLatencyStats::getPercentile(Stage stage, float percentile) const {
+    const uint32_t count = getCount(stage);
+    if (count == 0) {
+        return 0;
+    }
+    const float target = count * percentile / 100;
+    uint32_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_LIMITS_US.size(); bucket++) {
+        seen += histograms[stage][bucket];
+        if (seen >= target) {
+            return us2ns(BUCKET_LIMITS_US[bucket]);
+        }
+    }
+    return -1;
+}
+
+const char* InputLatencyStats::stageToString(Stage stage) {
+    switch (stage) {
+        case STAGE_EVENT_TO_DISPATCHER:
+            return "event->dispatcher";
+        case STAGE_DISPATCHER_TO_PUBLISH:
+            return "dispatcher->publish";
+        case STAGE_PUBLISH_TO_FINISH:
+            return "publish->finish";
+        case STAGE_END_TO_END:
+            return "event->finish";
+        case STAGE_COUNT:
+            break;
+    }
+    return "?";
+}
+
+status_t InputLatencyStats::write(Parcel& output) const {
+    output.writeString8(String8(windowName.c_str()));
+    for (const auto& histogram : histograms) {
+        for (uint32_t bucketCount : histogram) {
+            output.writeUint32(bucketCount);
+        }
+    }
+    return OK;
+}
+
+status_t InputLatencyStats::read(const Parcel& from, InputLatencyStats* outStats) {
+    outStats->windowName = from.readString8().c_str();
+    status_t result;
+    for (auto& histogram : outStats->histograms) {
+        for (uint32_t& bucketCount : histogram) {
+            result = from.readUint32(&bucketCount);
+            if (result != OK) {
+                return result;
+            }
+        }
+    }
+    return OK;
+}
+
+} // namespace android
@@ -23,12 +23,16 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <math.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
+
 #include <android-base/stringprintf.h>
 #include <binder/Parcel.h>
+#include <cutils/ashmem.h>
 #include <cutils/properties.h>
 #include <log/log.h>
 #include <utils/Trace.h>
@@ -75,6 +79,16 @@ static const nsecs_t RESAMPLE_MAX_PREDICTION = 8 * NANOS_PER_MS;
  */
 static const char* PROPERTY_RESAMPLING_ENABLED = "ro.input.resampling";
 
+/**
+ * System property for the number of motion samples in the shared memory ring of new
+ * input channels. Set to "0" to send every sample over the socket (default).
+ */
+static const char* PROPERTY_SAMPLE_RING_CAPACITY = "ro.input.sample_ring_capacity";
+
+// Upper bound on the capacity of a sample ring, to keep a misconfigured ring from taking a
+// lot of memory in every app.
+static const size_t MAX_SAMPLE_RING_CAPACITY = 256;
+
 template<typename T>
 inline static T min(const T& a, const T& b) {
     return a < b ? a : b;
@@ -88,6 +102,11 @@ inline static bool isPointerEvent(int32_t source) {
     return (source & AINPUT_SOURCE_CLASS_POINTER) == AINPUT_SOURCE_CLASS_POINTER;
 }
 
+// The consumer only batches these, so only these are worth sending through the sample ring.
+inline static bool isBatchableMotionAction(int32_t action) {
+    return action == AMOTION_EVENT_ACTION_MOVE || action == AMOTION_EVENT_ACTION_HOVER_MOVE;
+}
+
 // --- InputMessage ---
 
 bool InputMessage::isValid(size_t actualSize) const {
@@ -100,6 +119,8 @@ bool InputMessage::isValid(size_t actualSize) const {
                     && body.motion.pointerCount <= MAX_POINTERS;
         case TYPE_FINISHED:
             return true;
+        case TYPE_SAMPLE_RING_WAKEUP:
+            return true;
         }
     }
     return false;
@@ -113,6 +134,8 @@ size_t InputMessage::size() const {
         return sizeof(Header) + body.motion.size();
     case TYPE_FINISHED:
         return sizeof(Header) + body.finished.size();
+    case TYPE_SAMPLE_RING_WAKEUP:
+        return sizeof(Header) + body.sampleRingWakeup.size();
     }
     return sizeof(Header);
 }
@@ -213,6 +236,10 @@ void InputMessage::getSanitizedCopy(InputMessage* msg) const {
             msg->body.finished.handled = body.finished.handled;
             break;
         }
+        case InputMessage::TYPE_SAMPLE_RING_WAKEUP: {
+            msg->body.sampleRingWakeup.run = body.sampleRingWakeup.run;
+            break;
+        }
         default: {
             LOG_FATAL("Unexpected message type %i", header.type);
             break;
@@ -220,6 +247,184 @@ void InputMessage::getSanitizedCopy(InputMessage* msg) const {
     }
 }
 
+// --- InputSampleRing ---
+
+/*
+ * Indices run from 0 to 2 * capacity - 1, so that a full ring can be told apart from an empty
+ * one without wrapping an integer.
+ */
+struct InputSampleRing::Header {
+    uint32_t capacity;
+    uint32_t padding;
+    // Written by the publisher only.
+    std::atomic<uint32_t> head;
+    // Written by the consumer only.
+    std::atomic<uint32_t> tail;
+};
+
+struct InputSampleRing::Slot {
+    uint64_t run;
+    uint32_t size;
+    uint32_t padding;
+    InputMessage msg;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+        "InputSampleRing indices must be usable across processes");
+
+InputSampleRing::InputSampleRing(int fd, void* data, size_t size, uint32_t capacity) :
+        mFd(fd), mData(data), mSize(size), mCapacity(capacity) {
+}
+
+InputSampleRing::~InputSampleRing() {
+    munmap(mData, mSize);
+    ::close(mFd);
+}
+
+sp<InputSampleRing> InputSampleRing::create(const std::string& name, size_t capacity) {
+    if (capacity == 0 || capacity > MAX_SAMPLE_RING_CAPACITY) {
+        ALOGE("Invalid input sample ring capacity %zu", capacity);
+        return nullptr;
+    }
+    const size_t size = sizeof(Header) + capacity * sizeof(Slot);
+    std::string regionName = "input sample ring: " + name;
+    int fd = ashmem_create_region(regionName.c_str(), size);
+    if (fd < 0) {
+        ALOGE("channel '%s' ~ Could not create input sample ring.  errno=%d",
+                name.c_str(), errno);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ALOGE("channel '%s' ~ Could not map input sample ring.  errno=%d",
+                name.c_str(), errno);
+        ::close(fd);
+        return nullptr;
+    }
+    Header* header = new (data) Header();
+    header->capacity = capacity;
+    header->head.store(0);
+    header->tail.store(0);
+    return new InputSampleRing(fd, data, size, capacity);
+}
+
+sp<InputSampleRing> InputSampleRing::map(int fd) {
+    int size = ashmem_get_size_region(fd);
+    if (size < static_cast<int>(sizeof(Header))) {
+        ALOGE("Invalid input sample ring size %d", size);
+        ::close(fd);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ALOGE("Could not map input sample ring.  errno=%d", errno);
+        ::close(fd);
+        return nullptr;
+    }
+    const uint32_t capacity = static_cast<Header*>(data)->capacity;
+    if (capacity == 0 || capacity > MAX_SAMPLE_RING_CAPACITY
+            || sizeof(Header) + capacity * sizeof(Slot) > static_cast<size_t>(size)) {
+        ALOGE("Invalid input sample ring capacity %" PRIu32, capacity);
+        munmap(data, size);
+        ::close(fd);
+        return nullptr;
+    }
+    return new InputSampleRing(fd, data, size, capacity);
+}
+
+InputSampleRing::Header* InputSampleRing::getHeader() const {
+    return static_cast<Header*>(mData);
+}
+
+InputSampleRing::Slot* InputSampleRing::getSlot(uint32_t index) const {
+    Slot* slots = reinterpret_cast<Slot*>(static_cast<uint8_t*>(mData) + sizeof(Header));
+    return &slots[index < mCapacity ? index : index - mCapacity];
+}
+
+uint32_t InputSampleRing::nextIndex(uint32_t index) const {
+    return index + 1 < 2 * mCapacity ? index + 1 : 0;
+}
+
+bool InputSampleRing::write(const InputMessage* msg, uint64_t run, bool* outWasEmpty) {
+    if (mBroken) {
+        return false;
+    }
+    Header* header = getHeader();
+    const uint32_t head = mHead;
+    const uint32_t tail = header->tail.load();
+    if (tail >= 2 * mCapacity) {
+        // The consumer shares this memory, so don't trust it.
+        ALOGE("Input sample ring is corrupt, falling back to the socket");
+        mBroken = true;
+        return false;
+    }
+    const uint32_t used = head >= tail ? head - tail : head + 2 * mCapacity - tail;
+    if (used >= mCapacity) {
+        if (used > mCapacity) {
+            ALOGE("Input sample ring is corrupt, falling back to the socket");
+            mBroken = true;
+        }
+        return false;
+    }
+
+    Slot* slot = getSlot(head);
+    slot->run = run;
+    slot->size = msg->size();
+    msg->getSanitizedCopy(&slot->msg);
+    // Publishing the head and then checking the tail, both sequentially consistent, pairs
+    // with the consumer storing the tail and then checking the head: at least one side sees
+    // the other's update, so a sample is never left behind by an idle consumer.
+    mHead = nextIndex(head);
+    header->head.store(mHead);
+    *outWasEmpty = header->tail.load() == head;
+    return true;
+}
+
+void InputSampleRing::unwrite() {
+    mHead = mHead > 0 ? mHead - 1 : 2 * mCapacity - 1;
+    getHeader()->head.store(mHead);
+}
+
+bool InputSampleRing::hasSample(uint64_t run) {
+    Header* header = getHeader();
+    for (;;) {
+        const uint32_t tail = header->tail.load(std::memory_order_relaxed);
+        const uint32_t head = header->head.load();
+        if (head == tail || head >= 2 * mCapacity || tail >= 2 * mCapacity) {
+            return false;
+        }
+        const Slot* slot = getSlot(tail);
+        if (slot->run > run) {
+            return false;
+        }
+        if (slot->size <= sizeof(InputMessage)
+                && slot->msg.header.type == InputMessage::TYPE_MOTION
+                && slot->msg.isValid(slot->size)) {
+            return true;
+        }
+        ALOGE("Dropping invalid sample from the input sample ring");
+        header->tail.store(nextIndex(tail));
+    }
+}
+
+bool InputSampleRing::read(uint64_t run, InputMessage* outMsg) {
+    Header* header = getHeader();
+    while (hasSample(run)) {
+        const uint32_t tail = header->tail.load(std::memory_order_relaxed);
+        const Slot* slot = getSlot(tail);
+        const uint32_t size = slot->size;
+        if (size <= sizeof(InputMessage)) {
+            memcpy(static_cast<void*>(outMsg), &slot->msg, size);
+        }
+        header->tail.store(nextIndex(tail));
+        // Check the copy too, in case the slot changed after hasSample looked at it.
+        if (size <= sizeof(InputMessage) && outMsg->isValid(size)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // --- InputChannel ---
 
 InputChannel::InputChannel(const std::string& name, int fd) :
@@ -255,6 +460,14 @@ void InputChannel::setFd(int fd) {
 
 status_t InputChannel::openInputChannelPair(const std::string& name,
         sp<InputChannel>& outServerChannel, sp<InputChannel>& outClientChannel) {
+    int32_t sampleRingCapacity = property_get_int32(PROPERTY_SAMPLE_RING_CAPACITY, 0);
+    return openInputChannelPair(name, outServerChannel, outClientChannel,
+            sampleRingCapacity > 0 ? sampleRingCapacity : 0);
+}
+
+status_t InputChannel::openInputChannelPair(const std::string& name,
+        sp<InputChannel>& outServerChannel, sp<InputChannel>& outClientChannel,
+        size_t sampleRingCapacity) {
     int sockets[2];
     if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets)) {
         status_t result = -errno;
@@ -278,6 +491,17 @@ status_t InputChannel::openInputChannelPair(const std::string& name,
     std::string clientChannelName = name;
     clientChannelName += " (client)";
     outClientChannel = new InputChannel(clientChannelName, sockets[1]);
+
+    if (sampleRingCapacity != 0) {
+        // Each end maps the ring separately, as it would in another process.
+        sp<InputSampleRing> ring = InputSampleRing::create(name, sampleRingCapacity);
+        int fd = ring != nullptr ? ::dup(ring->getFd()) : -1;
+        sp<InputSampleRing> clientRing = fd >= 0 ? InputSampleRing::map(fd) : nullptr;
+        if (clientRing != nullptr) {
+            outServerChannel->mSampleRing = ring;
+            outClientChannel->mSampleRing = clientRing;
+        }
+    }
     return OK;
 }
 
@@ -361,7 +585,12 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
 
 sp<InputChannel> InputChannel::dup() const {
     int fd = ::dup(getFd());
-    return fd >= 0 ? new InputChannel(getName(), fd) : nullptr;
+    if (fd < 0) {
+        return nullptr;
+    }
+    sp<InputChannel> channel = new InputChannel(getName(), fd);
+    channel->mSampleRing = mSampleRing;
+    return channel;
 }
 
 
@@ -377,6 +606,14 @@ status_t InputChannel::write(Parcel& out) const {
     }
 
     s = out.writeDupFileDescriptor(getFd());
+    if (s != OK) {
+        return s;
+    }
+
+    s = out.writeBool(mSampleRing != nullptr);
+    if (s == OK && mSampleRing != nullptr) {
+        s = out.writeDupFileDescriptor(mSampleRing->getFd());
+    }
 
     return s;
 }
@@ -392,6 +629,19 @@ status_t InputChannel::read(const Parcel& from) {
         return BAD_VALUE;
     }
 
+    mSampleRing.clear();
+    if (from.readBool()) {
+        int ringFd = ::dup(from.readFileDescriptor());
+        if (ringFd < 0) {
+            return BAD_VALUE;
+        }
+        // Without the ring we would miss the samples the publisher writes to it.
+        mSampleRing = InputSampleRing::map(ringFd);
+        if (mSampleRing == nullptr) {
+            return BAD_VALUE;
+        }
+    }
+
     return OK;
 }
 
@@ -442,26 +692,47 @@ status_t InputPublisher::publishKeyEvent(
             downTime, eventTime);
 #endif
 
+    InputMessage msg;
+    status_t status = makeKeyEventMessage(&msg, seq, deviceId, source, displayId, action, flags,
+            keyCode, scanCode, metaState, repeatCount, downTime, eventTime);
+    if (status) {
+        return status;
+    }
+    return mChannel->sendMessage(&msg);
+}
+
+status_t InputPublisher::makeKeyEventMessage(InputMessage* outMsg,
+        uint32_t seq,
+        int32_t deviceId,
+        int32_t source,
+        int32_t displayId,
+        int32_t action,
+        int32_t flags,
+        int32_t keyCode,
+        int32_t scanCode,
+        int32_t metaState,
+        int32_t repeatCount,
+        nsecs_t downTime,
+        nsecs_t eventTime) const {
     if (!seq) {
         ALOGE("Attempted to publish a key event with sequence number 0.");
         return BAD_VALUE;
     }
 
-    InputMessage msg;
-    msg.header.type = InputMessage::TYPE_KEY;
-    msg.body.key.seq = seq;
-    msg.body.key.deviceId = deviceId;
-    msg.body.key.source = source;
-    msg.body.key.displayId = displayId;
-    msg.body.key.action = action;
-    msg.body.key.flags = flags;
-    msg.body.key.keyCode = keyCode;
-    msg.body.key.scanCode = scanCode;
-    msg.body.key.metaState = metaState;
-    msg.body.key.repeatCount = repeatCount;
-    msg.body.key.downTime = downTime;
-    msg.body.key.eventTime = eventTime;
-    return mChannel->sendMessage(&msg);
+    outMsg->header.type = InputMessage::TYPE_KEY;
+    outMsg->body.key.seq = seq;
+    outMsg->body.key.deviceId = deviceId;
+    outMsg->body.key.source = source;
+    outMsg->body.key.displayId = displayId;
+    outMsg->body.key.action = action;
+    outMsg->body.key.flags = flags;
+    outMsg->body.key.keyCode = keyCode;
+    outMsg->body.key.scanCode = scanCode;
+    outMsg->body.key.metaState = metaState;
+    outMsg->body.key.repeatCount = repeatCount;
+    outMsg->body.key.downTime = downTime;
+    outMsg->body.key.eventTime = eventTime;
+    return OK;
 }
 
 status_t InputPublisher::publishMotionEvent(
@@ -504,6 +775,38 @@ status_t InputPublisher::publishMotionEvent(
             xOffset, yOffset, xPrecision, yPrecision, downTime, eventTime, pointerCount);
 #endif
 
+    InputMessage msg;
+    status_t status = makeMotionEventMessage(&msg, seq, deviceId, source, displayId, action,
+            actionButton, flags, edgeFlags, metaState, buttonState, classification,
+            xOffset, yOffset, xPrecision, yPrecision, downTime, eventTime,
+            pointerCount, pointerProperties, pointerCoords);
+    if (status) {
+        return status;
+    }
+    return publishMessage(msg);
+}
+
+status_t InputPublisher::makeMotionEventMessage(InputMessage* outMsg,
+        uint32_t seq,
+        int32_t deviceId,
+        int32_t source,
+        int32_t displayId,
+        int32_t action,
+        int32_t actionButton,
+        int32_t flags,
+        int32_t edgeFlags,
+        int32_t metaState,
+        int32_t buttonState,
+        MotionClassification classification,
+        float xOffset,
+        float yOffset,
+        float xPrecision,
+        float yPrecision,
+        nsecs_t downTime,
+        nsecs_t eventTime,
+        uint32_t pointerCount,
+        const PointerProperties* pointerProperties,
+        const PointerCoords* pointerCoords) const {
     if (!seq) {
         ALOGE("Attempted to publish a motion event with sequence number 0.");
         return BAD_VALUE;
@@ -515,30 +818,78 @@ status_t InputPublisher::publishMotionEvent(
         return BAD_VALUE;
     }
 
-    InputMessage msg;
-    msg.header.type = InputMessage::TYPE_MOTION;
-    msg.body.motion.seq = seq;
-    msg.body.motion.deviceId = deviceId;
-    msg.body.motion.source = source;
-    msg.body.motion.displayId = displayId;
-    msg.body.motion.action = action;
-    msg.body.motion.actionButton = actionButton;
-    msg.body.motion.flags = flags;
-    msg.body.motion.edgeFlags = edgeFlags;
-    msg.body.motion.metaState = metaState;
-    msg.body.motion.buttonState = buttonState;
-    msg.body.motion.classification = classification;
-    msg.body.motion.xOffset = xOffset;
-    msg.body.motion.yOffset = yOffset;
-    msg.body.motion.xPrecision = xPrecision;
-    msg.body.motion.yPrecision = yPrecision;
-    msg.body.motion.downTime = downTime;
-    msg.body.motion.eventTime = eventTime;
-    msg.body.motion.pointerCount = pointerCount;
+    outMsg->header.type = InputMessage::TYPE_MOTION;
+    outMsg->body.motion.seq = seq;
+    outMsg->body.motion.deviceId = deviceId;
+    outMsg->body.motion.source = source;
+    outMsg->body.motion.displayId = displayId;
+    outMsg->body.motion.action = action;
+    outMsg->body.motion.actionButton = actionButton;
+    outMsg->body.motion.flags = flags;
+    outMsg->body.motion.edgeFlags = edgeFlags;
+    outMsg->body.motion.metaState = metaState;
+    outMsg->body.motion.buttonState = buttonState;
+    outMsg->body.motion.classification = classification;
+    outMsg->body.motion.xOffset = xOffset;
+    outMsg->body.motion.yOffset = yOffset;
+    outMsg->body.motion.xPrecision = xPrecision;
+    outMsg->body.motion.yPrecision = yPrecision;
+    outMsg->body.motion.downTime = downTime;
+    outMsg->body.motion.eventTime = eventTime;
+    outMsg->body.motion.pointerCount = pointerCount;
     for (uint32_t i = 0; i < pointerCount; i++) {
-        msg.body.motion.pointers[i].properties.copyFrom(pointerProperties[i]);
-        msg.body.motion.pointers[i].coords.copyFrom(pointerCoords[i]);
+        outMsg->body.motion.pointers[i].properties.copyFrom(pointerProperties[i]);
+        outMsg->body.motion.pointers[i].coords.copyFrom(pointerCoords[i]);
+    }
+    return OK;
+}
+
+status_t InputPublisher::publishMessage(const InputMessage& msg) {
+    const sp<InputSampleRing>& ring = mChannel->getSampleRing();
+    if (ring != nullptr && msg.header.type == InputMessage::TYPE_MOTION
+            && isBatchableMotionAction(msg.body.motion.action)) {
+        return publishToSampleRing(ring, msg);
+    }
+    mSampleRingRunOpen = false;
+    return mChannel->sendMessage(&msg);
+}
+
+status_t InputPublisher::publishToSampleRing(const sp<InputSampleRing>& ring,
+        const InputMessage& msg) {
+    // The consumer can't read the sample until its run has been announced.
+    const uint64_t run = mSampleRingRunOpen ? mSampleRingRun : mSampleRingRun + 1;
+    bool wasEmpty;
+    if (!ring->write(&msg, run, &wasEmpty)) {
+        // The ring is full. Samples already in it are read ahead of this one because their
+        // run was announced before.
+        mSampleRingRunOpen = false;
+        return mChannel->sendMessage(&msg);
+    }
+
+    if (!mSampleRingRunOpen) {
+        status_t status = sendSampleRingWakeup(run);
+        if (status) {
+            ring->unwrite();
+            return status;
+        }
+        mSampleRingRun = run;
+        mSampleRingRunOpen = true;
+    } else if (wasEmpty) {
+        // The consumer may have gone idle. If the socket is full, it will read it and then
+        // the ring anyway, so a failure here doesn't matter.
+        sendSampleRingWakeup(run);
     }
+    return OK;
+}
+
+status_t InputPublisher::sendSampleRingWakeup(uint64_t run) {
+#if DEBUG_TRANSPORT_ACTIONS
+    ALOGD("channel '%s' publisher ~ sendSampleRingWakeup: run=%" PRIu64,
+            mChannel->getName().c_str(), run);
+#endif
+    InputMessage msg;
+    msg.header.type = InputMessage::TYPE_SAMPLE_RING_WAKEUP;
+    msg.body.sampleRingWakeup.run = run;
     return mChannel->sendMessage(&msg);
 }
 
@@ -575,6 +926,14 @@ InputConsumer::InputConsumer(const sp<InputChannel>& channel) :
 InputConsumer::~InputConsumer() {
 }
 
+void InputConsumer::setTouchPredictor(std::unique_ptr<TouchPredictor> predictor,
+        nsecs_t presentLatency) {
+    mTouchPredictor = std::move(predictor);
+    mPresentLatency = presentLatency;
+    mTouchPredictorDeviceId = -1;
+    mTouchPredictorSource = 0;
+}
+
 bool InputConsumer::isTouchResamplingEnabled() {
     return property_get_bool(PROPERTY_RESAMPLING_ENABLED, true);
 }
@@ -599,7 +958,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory,
             mMsgDeferred = false;
         } else {
             // Receive a fresh message.
-            status_t result = mChannel->receiveMessage(&mMsg);
+            status_t result = receiveMessage(&mMsg);
             if (result == 0) {
                 if ((mMsg.body.motion.action & AMOTION_EVENT_ACTION_MASK) == AMOTION_EVENT_ACTION_MOVE){
                     mTouchMoveCounter++;
@@ -731,7 +1090,7 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
         }
 
         nsecs_t sampleTime = frameTime;
-        if (mResampleTouch && (*touchMoveNumber != 1)) {
+        if (mResampleTouch && !mTouchPredictor && (*touchMoveNumber != 1)) {
             sampleTime -= RESAMPLE_LATENCY;
         }
         ssize_t split = findSampleNoLaterThan(batch, sampleTime);
@@ -747,7 +1106,9 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
         } else {
             next = &batch.samples.itemAt(0);
         }
-        if (!result && mResampleTouch) {
+        if (!result && mTouchPredictor) {
+            predictTouchState(frameTime + mPresentLatency, static_cast<MotionEvent*>(*outEvent));
+        } else if (!result && mResampleTouch) {
             resampleTouchState(sampleTime, static_cast<MotionEvent*>(*outEvent), next);
         }
         return result;
@@ -784,10 +1145,13 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
 }
 
 void InputConsumer::updateTouchState(InputMessage& msg) {
-    if (!mResampleTouch || !isPointerEvent(msg.body.motion.source)) {
+    if ((!mResampleTouch && !mTouchPredictor) || !isPointerEvent(msg.body.motion.source)) {
         return;
     }
 
+    // The predictor has to see the real coordinates, before they are rewritten below.
+    updateTouchPredictor(msg);
+
     int32_t deviceId = msg.body.motion.deviceId;
     int32_t source = msg.body.motion.source;
 
@@ -859,6 +1223,66 @@ void InputConsumer::updateTouchState(InputMessage& msg) {
     }
 }
 
+void InputConsumer::updateTouchPredictor(const InputMessage& msg) {
+    if (!mTouchPredictor) {
+        return;
+    }
+
+    int32_t deviceId = msg.body.motion.deviceId;
+    int32_t source = msg.body.motion.source;
+    int32_t action = msg.body.motion.action & AMOTION_EVENT_ACTION_MASK;
+    if (deviceId != mTouchPredictorDeviceId || source != mTouchPredictorSource) {
+        // Only start following another device at the beginning of one of its gestures.
+        if (action != AMOTION_EVENT_ACTION_DOWN) {
+            return;
+        }
+        mTouchPredictorDeviceId = deviceId;
+        mTouchPredictorSource = source;
+    }
+
+    switch (action) {
+    case AMOTION_EVENT_ACTION_DOWN:
+        mTouchPredictor->clear();
+        break;
+    case AMOTION_EVENT_ACTION_MOVE:
+        break;
+    case AMOTION_EVENT_ACTION_POINTER_DOWN:
+        mTouchPredictor->clearPointers(
+                BitSet32(BitSet32::valueForBit(msg.body.motion.getActionId())));
+        break;
+    case AMOTION_EVENT_ACTION_POINTER_UP:
+        mTouchPredictor->clearPointers(
+                BitSet32(BitSet32::valueForBit(msg.body.motion.getActionId())));
+        return;
+    case AMOTION_EVENT_ACTION_UP:
+    case AMOTION_EVENT_ACTION_CANCEL:
+        mTouchPredictor->clear();
+        mTouchPredictorDeviceId = -1;
+        mTouchPredictorSource = 0;
+        return;
+    default:
+        return;
+    }
+
+    // The predictor expects the positions ordered by increasing pointer id.
+    BitSet32 idBits;
+    uint32_t idToIndex[MAX_POINTER_ID + 1];
+    for (uint32_t i = 0; i < msg.body.motion.pointerCount; i++) {
+        uint32_t id = msg.body.motion.pointers[i].properties.id;
+        idBits.markBit(id);
+        idToIndex[id] = i;
+    }
+    VelocityTracker::Position positions[MAX_POINTERS];
+    uint32_t count = 0;
+    for (BitSet32 remaining(idBits); !remaining.isEmpty(); count++) {
+        uint32_t id = remaining.clearFirstMarkedBit();
+        const PointerCoords& coords = msg.body.motion.pointers[idToIndex[id]].coords;
+        positions[count].x = coords.getX();
+        positions[count].y = coords.getY();
+    }
+    mTouchPredictor->addMovement(msg.body.motion.eventTime, idBits, positions);
+}
+
 /**
  * Replace the coordinates in msg with the coordinates in lastResample, if necessary.
  *
@@ -1031,6 +1455,80 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
     event->addSample(sampleTime, touchState.lastResample.pointers);
 }
 
+/**
+ * Appends a sample to event at presentTime, with the pointers where the touch predictor
+ * expects them to be by then. Like resampleTouchState, it records the sample in lastResample
+ * so that later samples that are older than it are rewritten rather than seen going backwards.
+ */
+void InputConsumer::predictTouchState(nsecs_t presentTime, MotionEvent* event) {
+    if (!isPointerEvent(event->getSource())
+            || event->getAction() != AMOTION_EVENT_ACTION_MOVE
+            || event->getDeviceId() != mTouchPredictorDeviceId
+            || event->getSource() != mTouchPredictorSource
+            || presentTime <= event->getEventTime()) {
+        return;
+    }
+
+    ssize_t index = findTouchState(event->getDeviceId(), event->getSource());
+    if (index < 0) {
+#if DEBUG_RESAMPLING
+        ALOGD("Not predicted, no touch state for device.");
+#endif
+        return;
+    }
+
+    TouchState& touchState = mTouchStates.editItemAt(index);
+    if (touchState.historySize < 1) {
+#if DEBUG_RESAMPLING
+        ALOGD("Not predicted, no history for device.");
+#endif
+        return;
+    }
+
+    // Ensure that the current sample has all of the pointers that need to be reported.
+    const History* current = touchState.getHistory(0);
+    size_t pointerCount = event->getPointerCount();
+    for (size_t i = 0; i < pointerCount; i++) {
+        uint32_t id = event->getPointerId(i);
+        if (!current->idBits.hasBit(id)) {
+#if DEBUG_RESAMPLING
+            ALOGD("Not predicted, missing id %d", id);
+#endif
+            return;
+        }
+    }
+
+    History oldLastResample;
+    oldLastResample.initializeFrom(touchState.lastResample);
+    touchState.lastResample.eventTime = presentTime;
+    touchState.lastResample.idBits.clear();
+    for (size_t i = 0; i < pointerCount; i++) {
+        uint32_t id = event->getPointerId(i);
+        touchState.lastResample.idToIndex[id] = i;
+        touchState.lastResample.idBits.markBit(id);
+        if (oldLastResample.hasPointerId(id) && touchState.recentCoordinatesAreIdentical(id)) {
+            // Same as in resampleTouchState: don't add jitter to a pointer that is not moving.
+            touchState.lastResample.pointers[i].copyFrom(oldLastResample.getPointerById(id));
+            continue;
+        }
+
+        PointerCoords& predictedCoords = touchState.lastResample.pointers[i];
+        predictedCoords.copyFrom(current->getPointerById(id));
+        float x, y;
+        if (shouldResampleTool(event->getToolType(i))
+                && mTouchPredictor->predict(id, presentTime, &x, &y)) {
+            predictedCoords.setAxisValue(AMOTION_EVENT_AXIS_X, x);
+            predictedCoords.setAxisValue(AMOTION_EVENT_AXIS_Y, y);
+        }
+#if DEBUG_RESAMPLING
+        ALOGD("[%d] - predicted (%0.3f, %0.3f) at %" PRId64, id,
+                predictedCoords.getX(), predictedCoords.getY(), presentTime);
+#endif
+    }
+
+    event->addSample(presentTime, touchState.lastResample.pointers);
+}
+
 bool InputConsumer::shouldResampleTool(int32_t toolType) {
     return toolType == AMOTION_EVENT_TOOL_TYPE_FINGER
             || toolType == AMOTION_EVENT_TOOL_TYPE_UNKNOWN;
@@ -1093,8 +1591,41 @@ status_t InputConsumer::sendUnchainedFinishedSignal(uint32_t seq, bool handled)
     return mChannel->sendMessage(&msg);
 }
 
+status_t InputConsumer::receiveMessage(InputMessage* msg) {
+    const sp<InputSampleRing>& ring = mChannel->getSampleRing();
+    for (;;) {
+        if (ring != nullptr && ring->read(mSampleRingRun, msg)) {
+            return OK;
+        }
+        if (mSampleRingMsgDeferred) {
+            mSampleRingMsgDeferred = false;
+            *msg = mSampleRingDeferredMsg;
+            return OK;
+        }
+
+        status_t result = mChannel->receiveMessage(msg);
+        if (result) {
+            return result;
+        }
+        if (msg->header.type == InputMessage::TYPE_SAMPLE_RING_WAKEUP) {
+            if (msg->body.sampleRingWakeup.run > mSampleRingRun) {
+                mSampleRingRun = msg->body.sampleRingWakeup.run;
+            }
+            continue;
+        }
+        // Samples of the current run that were written just before this message was sent
+        // may not have been visible when the ring was checked above. They come first.
+        if (ring != nullptr && ring->hasSample(mSampleRingRun)) {
+            mSampleRingDeferredMsg = *msg;
+            mSampleRingMsgDeferred = true;
+            continue;
+        }
+        return OK;
+    }
+}
+
 bool InputConsumer::hasDeferredEvent() const {
-    return mMsgDeferred;
+    return mMsgDeferred || mSampleRingMsgDeferred;
 }
 
 bool InputConsumer::hasPendingBatch() const {
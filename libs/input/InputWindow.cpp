@@ -17,6 +17,8 @@
 #define LOG_TAG "InputWindow"
 #define LOG_NDEBUG 0
 
+#include <algorithm>
+
 #include <binder/Parcel.h>
 #include <input/InputWindow.h>
 #include <input/InputTransport.h>
@@ -64,6 +66,36 @@ bool InputWindowInfo::overlaps(const InputWindowInfo* other) const {
             && frameTop < other->frameBottom && frameBottom > other->frameTop;
 }
 
+static bool regionsEqual(const Region& lhs, const Region& rhs) {
+    size_t lhsCount;
+    size_t rhsCount;
+    const Rect* lhsRects = lhs.getArray(&lhsCount);
+    const Rect* rhsRects = rhs.getArray(&rhsCount);
+    return lhsCount == rhsCount && std::equal(lhsRects, lhsRects + lhsCount, rhsRects);
+}
+
+bool InputWindowInfo::operator==(const InputWindowInfo& other) const {
+    return token == other.token && name == other.name
+            && layoutParamsFlags == other.layoutParamsFlags
+            && layoutParamsType == other.layoutParamsType
+            && dispatchingTimeout == other.dispatchingTimeout
+            && frameLeft == other.frameLeft && frameTop == other.frameTop
+            && frameRight == other.frameRight && frameBottom == other.frameBottom
+            && surfaceInset == other.surfaceInset
+            && globalScaleFactor == other.globalScaleFactor
+            && windowXScale == other.windowXScale && windowYScale == other.windowYScale
+            && visible == other.visible && canReceiveKeys == other.canReceiveKeys
+            && hasFocus == other.hasFocus && hasWallpaper == other.hasWallpaper
+            && paused == other.paused && layer == other.layer
+            && ownerPid == other.ownerPid && ownerUid == other.ownerUid
+            && inputFeatures == other.inputFeatures && displayId == other.displayId
+            && portalToDisplayId == other.portalToDisplayId
+            && applicationInfo == other.applicationInfo
+            && regionsEqual(touchableRegion, other.touchableRegion)
+            && replaceTouchableRegionWithCrop == other.replaceTouchableRegionWithCrop
+            && touchableRegionCropHandle == other.touchableRegionCropHandle;
+}
+
 status_t InputWindowInfo::write(Parcel& output) const {
     if (token == nullptr) {
         output.writeInt32(0);
@@ -27,6 +27,7 @@
 #include <input/InputEventLabels.h>
 #include <input/Keyboard.h>
 #include <input/KeyCharacterMap.h>
+#include <input/ParsedFileCache.h>
 
 #include <utils/Log.h>
 #include <utils/Errors.h>
@@ -82,6 +83,16 @@ static String8 toString(const char16_t* chars, size_t numChars) {
 }
 #endif
 
+// Enough for every key character map file on a device, with room to spare.
+static constexpr size_t MAX_CACHED_MAPS = 64;
+
+static ParsedFileCache<KeyCharacterMap>& getCache() {
+    // Never destroyed, so that it can still be used while the process exits.
+    static ParsedFileCache<KeyCharacterMap>* sCache =
+            new ParsedFileCache<KeyCharacterMap>(MAX_CACHED_MAPS);
+    return *sCache;
+}
+
 
 // --- KeyCharacterMap ---
 
@@ -108,7 +119,12 @@ KeyCharacterMap::~KeyCharacterMap() {
 
 status_t KeyCharacterMap::load(const std::string& filename,
         Format format, sp<KeyCharacterMap>* outMap) {
-    outMap->clear();
+    // Maps are immutable (combine makes a new one), so devices that use the same file
+    // can share one.
+    *outMap = getCache().find(filename, format);
+    if (*outMap != nullptr) {
+        return OK;
+    }
 
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
@@ -117,6 +133,9 @@ status_t KeyCharacterMap::load(const std::string& filename,
     } else {
         status = load(tokenizer, format, outMap);
         delete tokenizer;
+        if (!status) {
+            getCache().insert(filename, format, *outMap);
+        }
     }
     return status;
 }
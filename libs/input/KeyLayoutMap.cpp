@@ -22,6 +22,7 @@
 #include <input/InputEventLabels.h>
 #include <input/Keyboard.h>
 #include <input/KeyLayoutMap.h>
+#include <input/ParsedFileCache.h>
 #include <utils/Log.h>
 #include <utils/Errors.h>
 #include <utils/Tokenizer.h>
@@ -41,6 +42,16 @@ namespace android {
 
 static const char* WHITESPACE = " \t\r";
 
+// Enough for every key layout file on a device, with room to spare.
+static constexpr size_t MAX_CACHED_MAPS = 64;
+
+static ParsedFileCache<KeyLayoutMap>& getCache() {
+    // Never destroyed, so that it can still be used while the process exits.
+    static ParsedFileCache<KeyLayoutMap>* sCache =
+            new ParsedFileCache<KeyLayoutMap>(MAX_CACHED_MAPS);
+    return *sCache;
+}
+
 // --- KeyLayoutMap ---
 
 KeyLayoutMap::KeyLayoutMap() {
@@ -50,7 +61,11 @@ KeyLayoutMap::~KeyLayoutMap() {
 }
 
 status_t KeyLayoutMap::load(const std::string& filename, sp<KeyLayoutMap>* outMap) {
-    outMap->clear();
+    // Maps are immutable, so devices that use the same file can share one.
+    *outMap = getCache().find(filename, 0);
+    if (*outMap != nullptr) {
+        return NO_ERROR;
+    }
 
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
@@ -75,6 +90,7 @@ status_t KeyLayoutMap::load(const std::string& filename, sp<KeyLayoutMap>* outMa
 #endif
             if (!status) {
                 *outMap = map;
+                getCache().insert(filename, 0, map);
             }
         }
         delete tokenizer;
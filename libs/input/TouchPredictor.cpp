@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "TouchPredictor"
+//#define LOG_NDEBUG 0
+
+// Log debug messages about predictions.
+#define DEBUG_PREDICTION 0
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <input/TouchPredictor.h>
+#include <log/log.h>
+
+namespace android {
+
+// Don't predict further ahead of the newest movement than this. A polynomial fit of a
+// few samples diverges quickly once it is extrapolated past them.
+static const nsecs_t MAX_PREDICTION = 50 * 1000000LL; // 50 ms
+
+// Don't predict from a fit that explains less of the recent movement than this.
+static const float MIN_CONFIDENCE = 0.5f;
+
+// --- TouchPredictor ---
+
+std::unique_ptr<TouchPredictor> TouchPredictor::create(const char* name) {
+    if (!strcmp("lsq1", name)) {
+        return std::make_unique<PolynomialTouchPredictor>(1);
+    }
+    if (!strcmp("lsq2", name)) {
+        return std::make_unique<PolynomialTouchPredictor>(2);
+    }
+    return nullptr;
+}
+
+// --- PolynomialTouchPredictor ---
+
+PolynomialTouchPredictor::PolynomialTouchPredictor(uint32_t degree) :
+        mTracker(degree == 1 ? "lsq1" : "lsq2") {
+}
+
+void PolynomialTouchPredictor::clear() {
+    mTracker.clear();
+}
+
+void PolynomialTouchPredictor::clearPointers(BitSet32 idBits) {
+    mTracker.clearPointers(idBits);
+}
+
+void PolynomialTouchPredictor::addMovement(nsecs_t eventTime, BitSet32 idBits,
+        const VelocityTracker::Position* positions) {
+    mTracker.addMovement(eventTime, idBits, positions);
+}
+
+bool PolynomialTouchPredictor::predict(uint32_t id, nsecs_t time,
+        float* outX, float* outY) const {
+    VelocityTracker::Estimator estimator;
+    if (!mTracker.getEstimator(id, &estimator) || estimator.confidence < MIN_CONFIDENCE) {
+        return false;
+    }
+
+    // The estimator's time base is its newest movement, in seconds.
+    nsecs_t ahead = time - estimator.time;
+    if (ahead > MAX_PREDICTION) {
+        ahead = MAX_PREDICTION;
+    }
+    const float t = ahead * 0.000000001f;
+    float x = 0;
+    float y = 0;
+    float tn = 1;
+    for (uint32_t i = 0; i <= estimator.degree; i++) {
+        x += estimator.xCoeff[i] * tn;
+        y += estimator.yCoeff[i] * tn;
+        tn *= t;
+    }
+#if DEBUG_PREDICTION
+    ALOGD("[%" PRIu32 "] predicted (%0.3f, %0.3f) %" PRId64 " ns ahead, confidence %0.3f",
+            id, x, y, ahead, estimator.confidence);
+#endif
+    *outX = x;
+    *outY = y;
+    return true;
+}
+
+} // namespace android
@@ -20,13 +20,25 @@ namespace android {
 
 TouchVideoFrame::TouchVideoFrame(uint32_t height, uint32_t width, std::vector<int16_t> data,
         const struct timeval& timestamp) :
-         mHeight(height), mWidth(width),mData(std::move(data)), mTimestamp(timestamp) {
+         mHeight(height), mWidth(width),
+         mData(std::make_shared<const std::vector<int16_t>>(std::move(data))),
+         mTimestamp(timestamp) {
+}
+
+TouchVideoFrame::TouchVideoFrame(SharedDataTag, uint32_t height, uint32_t width,
+        std::shared_ptr<const std::vector<int16_t>> data, const struct timeval& timestamp) :
+         mHeight(height), mWidth(width), mData(std::move(data)), mTimestamp(timestamp) {
+}
+
+TouchVideoFrame TouchVideoFrame::fromSharedData(uint32_t height, uint32_t width,
+        std::shared_ptr<const std::vector<int16_t>> data, const struct timeval& timestamp) {
+    return TouchVideoFrame(SharedDataTag{}, height, width, std::move(data), timestamp);
 }
 
 bool TouchVideoFrame::operator==(const TouchVideoFrame& rhs) const {
     return mHeight == rhs.mHeight
             && mWidth == rhs.mWidth
-            && mData == rhs.mData
+            && *mData == *rhs.mData
             && mTimestamp.tv_sec == rhs.mTimestamp.tv_sec
             && mTimestamp.tv_usec == rhs.mTimestamp.tv_usec;
 }
@@ -35,7 +47,7 @@ uint32_t TouchVideoFrame::getHeight() const { return mHeight; }
 
 uint32_t TouchVideoFrame::getWidth() const { return mWidth; }
 
-const std::vector<int16_t>& TouchVideoFrame::getData() const { return mData; }
+const std::vector<int16_t>& TouchVideoFrame::getData() const { return *mData; }
 
 const struct timeval& TouchVideoFrame::getTimestamp() const { return mTimestamp; }
 
@@ -62,7 +74,8 @@ void TouchVideoFrame::rotate(int32_t orientation) {
  *     An element at position (i, j) is rotated to (width - j - 1, i)
  */
 void TouchVideoFrame::rotateQuarterTurn(bool clockwise) {
-    std::vector<int16_t> rotated(mData.size());
+    const std::vector<int16_t>& data = *mData;
+    std::vector<int16_t> rotated(data.size());
     for (size_t i = 0; i < mHeight; i++) {
         for (size_t j = 0; j < mWidth; j++) {
             size_t iRotated, jRotated;
@@ -74,27 +87,24 @@ void TouchVideoFrame::rotateQuarterTurn(bool clockwise) {
                 jRotated = i;
             }
             size_t indexRotated = iRotated * mHeight + jRotated;
-            rotated[indexRotated] = mData[i * mWidth + j];
+            rotated[indexRotated] = data[i * mWidth + j];
         }
     }
-    mData = std::move(rotated);
+    mData = std::make_shared<const std::vector<int16_t>>(std::move(rotated));
     std::swap(mHeight, mWidth);
 }
 
 /**
  * An element at position (i, j) is rotated to (height - i - 1, width - j - 1)
- * This is equivalent to moving element [i] to position [height * width - i - 1]
- * Since element at [height * width - i - 1] would move to position [i],
- * we can just swap elements [i] and [height * width - i - 1].
+ * This is equivalent to moving element [i] to position [height * width - i - 1],
+ * so the rotated data is the data in reverse. It is written to a new array, since
+ * other frames may share this one's.
  */
 void TouchVideoFrame::rotate180() {
-    if (mData.size() == 0) {
+    if (mData->size() == 0) {
         return;
     }
-    // Just need to swap elements i and (height * width - 1 - i)
-    for (size_t i = 0; i < mData.size() / 2; i++) {
-        std::swap(mData[i], mData[mHeight * mWidth - 1 - i]);
-    }
+    mData = std::make_shared<const std::vector<int16_t>>(mData->rbegin(), mData->rend());
 }
 
 } // namespace android
@@ -27,7 +27,6 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <math.h>
-#include <optional>
 
 #include <android-base/stringprintf.h>
 #include <cutils/properties.h>
@@ -572,55 +571,65 @@ static bool solveLeastSquares(const float* x, const float* y,
 }
 
 /*
- * Optimized unweighted second-order least squares fit. About 2x speed improvement compared to
- * the default implementation
+ * Optimized unweighted second-order least squares fit of both axes at once. About 2x speed
+ * improvement compared to the default implementation, per axis, and the sums of the powers
+ * of t are only computed once for the two axes.
+ *
+ * The sums are kept in fixed-size arrays that are updated with the same operation in every
+ * lane, so that the compiler can use SIMD additions and multiplications. Each sum still adds
+ * up its terms one sample at a time, in order, so this rounds exactly like a scalar loop.
  */
-static std::optional<std::array<float, 3>> solveUnweightedLeastSquaresDeg2(
-        const float* x, const float* y, size_t count) {
-    // Solving y = a*x^2 + b*x + c
-    float sxi = 0, sxiyi = 0, syi = 0, sxi2 = 0, sxi3 = 0, sxi2yi = 0, sxi4 = 0;
+static bool solveUnweightedLeastSquaresDeg2(const float* t, const float* x, const float* y,
+        size_t count, std::array<float, 3>* outXCoeff, std::array<float, 3>* outYCoeff) {
+    // Solving x = a*t^2 + b*t + c, and the same for y
+    // Sums of t, t^2, t^3, t^4
+    float stn[4] = {};
+    // Sums of x, t*x, t^2*x, then the same for y. The fourth lane of each axis is unused.
+    float stnv[8] = {};
 
     for (size_t i = 0; i < count; i++) {
-        float xi = x[i];
-        float yi = y[i];
-        float xi2 = xi*xi;
-        float xi3 = xi2*xi;
-        float xi4 = xi3*xi;
-        float xiyi = xi*yi;
-        float xi2yi = xi2*yi;
-
-        sxi += xi;
-        sxi2 += xi2;
-        sxiyi += xiyi;
-        sxi2yi += xi2yi;
-        syi += yi;
-        sxi3 += xi3;
-        sxi4 += xi4;
-    }
-
-    float Sxx = sxi2 - sxi*sxi / count;
-    float Sxy = sxiyi - sxi*syi / count;
-    float Sxx2 = sxi3 - sxi*sxi2 / count;
-    float Sx2y = sxi2yi - sxi2*syi / count;
-    float Sx2x2 = sxi4 - sxi2*sxi2 / count;
-
-    float denominator = Sxx*Sx2x2 - Sxx2*Sxx2;
-    if (denominator == 0) {
-        ALOGW("division by 0 when computing velocity, Sxx=%f, Sx2x2=%f, Sxx2=%f", Sxx, Sx2x2, Sxx2);
-        return std::nullopt;
-    }
-    // Compute a
-    float numerator = Sx2y*Sxx - Sxy*Sxx2;
-    float a = numerator / denominator;
+        const float ti = t[i];
+        const float ti2 = ti*ti;
+        const float ti3 = ti2*ti;
+        const float tn[4] = {ti, ti2, ti3, ti3*ti};
+        for (size_t k = 0; k < 4; k++) {
+            stn[k] += tn[k];
+        }
 
-    // Compute b
-    numerator = Sxy*Sx2x2 - Sx2y*Sxx2;
-    float b = numerator / denominator;
+        const float powers[8] = {1, ti, ti2, 0, 1, ti, ti2, 0};
+        const float values[8] = {x[i], x[i], x[i], 0, y[i], y[i], y[i], 0};
+        for (size_t k = 0; k < 8; k++) {
+            stnv[k] += powers[k] * values[k];
+        }
+    }
 
-    // Compute c
-    float c = syi/count - b * sxi/count - a * sxi2/count;
+    const float sti = stn[0], sti2 = stn[1], sti3 = stn[2], sti4 = stn[3];
+    const float Stt = sti2 - sti*sti / count;
+    const float Stt2 = sti3 - sti*sti2 / count;
+    const float St2t2 = sti4 - sti2*sti2 / count;
 
-    return std::make_optional(std::array<float, 3>({c, b, a}));
+    const float denominator = Stt*St2t2 - Stt2*Stt2;
+    if (denominator == 0) {
+        ALOGW("division by 0 when computing velocity, Stt=%f, St2t2=%f, Stt2=%f",
+                Stt, St2t2, Stt2);
+        return false;
+    }
+
+    auto solve = [&](const float* stnvi, std::array<float, 3>* outCoeff) {
+        const float svi = stnvi[0];
+        const float Stv = stnvi[1] - sti*svi / count;
+        const float St2v = stnvi[2] - sti2*svi / count;
+        // Compute a
+        const float a = (St2v*Stt - Stv*Stt2) / denominator;
+        // Compute b
+        const float b = (Stv*St2t2 - St2v*Stt2) / denominator;
+        // Compute c
+        const float c = svi/count - b * sti/count - a * sti2/count;
+        *outCoeff = {c, b, a};
+    };
+    solve(&stnv[0], outXCoeff);
+    solve(&stnv[4], outYCoeff);
+    return true;
 }
 
 bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
@@ -666,15 +675,15 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
 
     if (degree == 2 && mWeighting == WEIGHTING_NONE) {
         // Optimize unweighted, quadratic polynomial fit
-        std::optional<std::array<float, 3>> xCoeff = solveUnweightedLeastSquaresDeg2(time, x, m);
-        std::optional<std::array<float, 3>> yCoeff = solveUnweightedLeastSquaresDeg2(time, y, m);
-        if (xCoeff && yCoeff) {
+        std::array<float, 3> xCoeff;
+        std::array<float, 3> yCoeff;
+        if (solveUnweightedLeastSquaresDeg2(time, x, y, m, &xCoeff, &yCoeff)) {
             outEstimator->time = newestMovement.eventTime;
             outEstimator->degree = 2;
             outEstimator->confidence = 1;
             for (size_t i = 0; i <= outEstimator->degree; i++) {
-                outEstimator->xCoeff[i] = (*xCoeff)[i];
-                outEstimator->yCoeff[i] = (*yCoeff)[i];
+                outEstimator->xCoeff[i] = xCoeff[i];
+                outEstimator->yCoeff[i] = yCoeff[i];
             }
             return true;
         }
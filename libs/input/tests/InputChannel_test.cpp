@@ -190,4 +190,92 @@ TEST_F(InputChannelTest, SendAndReceive_MotionClassification) {
 }
 
 
+static InputMessage makeMoveMessage(uint32_t seq) {
+    InputMessage msg;
+    memset(&msg, 0, sizeof(InputMessage));
+    msg.header.type = InputMessage::TYPE_MOTION;
+    msg.body.motion.seq = seq;
+    msg.body.motion.action = AMOTION_EVENT_ACTION_MOVE;
+    msg.body.motion.pointerCount = 1;
+    msg.body.motion.pointers[0].properties.clear();
+    msg.body.motion.pointers[0].coords.clear();
+    return msg;
+}
+
+TEST_F(InputChannelTest, OpenInputChannelPair_WithSampleRing_SharesTheRing) {
+    sp<InputChannel> serverChannel, clientChannel;
+
+    status_t result = InputChannel::openInputChannelPair("channel name",
+            serverChannel, clientChannel, 4);
+
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+    ASSERT_NE(nullptr, serverChannel->getSampleRing());
+    ASSERT_NE(nullptr, clientChannel->getSampleRing());
+    EXPECT_EQ(4U, clientChannel->getSampleRing()->getCapacity());
+
+    bool wasEmpty = false;
+    InputMessage serverMsg = makeMoveMessage(7);
+    ASSERT_TRUE(serverChannel->getSampleRing()->write(&serverMsg, 1, &wasEmpty));
+    EXPECT_TRUE(wasEmpty);
+
+    InputMessage clientMsg;
+    ASSERT_TRUE(clientChannel->getSampleRing()->read(1, &clientMsg))
+            << "client should see the sample written by the server";
+    EXPECT_EQ(7U, clientMsg.body.motion.seq);
+
+    sp<InputChannel> dupChannel = clientChannel->dup();
+    EXPECT_EQ(clientChannel->getSampleRing(), dupChannel->getSampleRing())
+            << "duplicated channel should keep the ring";
+}
+
+TEST_F(InputChannelTest, SampleRing_ReadsOnlyAnnouncedRuns) {
+    sp<InputSampleRing> ring = InputSampleRing::create("channel name", 4);
+    ASSERT_NE(nullptr, ring);
+
+    bool wasEmpty;
+    InputMessage msg = makeMoveMessage(1);
+    ASSERT_TRUE(ring->write(&msg, 1, &wasEmpty));
+    msg = makeMoveMessage(2);
+    ASSERT_TRUE(ring->write(&msg, 2, &wasEmpty));
+    EXPECT_FALSE(wasEmpty)
+            << "the first sample was not read yet";
+
+    InputMessage readMsg;
+    EXPECT_FALSE(ring->hasSample(0));
+    ASSERT_TRUE(ring->read(1, &readMsg));
+    EXPECT_EQ(1U, readMsg.body.motion.seq);
+    EXPECT_FALSE(ring->read(1, &readMsg))
+            << "samples of a later run must wait for it to be announced";
+    ASSERT_TRUE(ring->read(2, &readMsg));
+    EXPECT_EQ(2U, readMsg.body.motion.seq);
+}
+
+TEST_F(InputChannelTest, SampleRing_WhenFull_RejectsSamples) {
+    sp<InputSampleRing> ring = InputSampleRing::create("channel name", 2);
+    ASSERT_NE(nullptr, ring);
+
+    bool wasEmpty;
+    InputMessage msg = makeMoveMessage(1);
+    ASSERT_TRUE(ring->write(&msg, 1, &wasEmpty));
+    ASSERT_TRUE(ring->write(&msg, 1, &wasEmpty));
+    EXPECT_FALSE(ring->write(&msg, 1, &wasEmpty))
+            << "a full ring should not take more samples";
+
+    ring->unwrite();
+    InputMessage readMsg;
+    ASSERT_TRUE(ring->read(1, &readMsg));
+    EXPECT_FALSE(ring->read(1, &readMsg))
+            << "the sample taken back with unwrite should be gone";
+
+    // The indices wrap around.
+    for (uint32_t i = 0; i < 10; i++) {
+        msg = makeMoveMessage(i + 1);
+        ASSERT_TRUE(ring->write(&msg, 1, &wasEmpty));
+        EXPECT_TRUE(wasEmpty);
+        ASSERT_TRUE(ring->read(1, &readMsg));
+        EXPECT_EQ(i + 1, readMsg.body.motion.seq);
+    }
+}
+
 } // namespace android
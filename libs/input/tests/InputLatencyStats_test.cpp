@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+#include <input/InputLatencyStats.h>
+
+namespace android {
+namespace test {
+
+TEST(InputLatencyStatsTest, NothingRecorded_HasNoPercentile) {
+    InputLatencyStats stats;
+    ASSERT_EQ(0u, stats.getCount(InputLatencyStats::STAGE_END_TO_END));
+    ASSERT_EQ(0, stats.getPercentile(InputLatencyStats::STAGE_END_TO_END, 50));
+}
+
+TEST(InputLatencyStatsTest, Record_CountsIntoTheBucketOfTheLatency) {
+    InputLatencyStats stats;
+    stats.record(InputLatencyStats::STAGE_PUBLISH_TO_FINISH, us2ns(500));
+    stats.record(InputLatencyStats::STAGE_PUBLISH_TO_FINISH, us2ns(501));
+    stats.record(InputLatencyStats::STAGE_PUBLISH_TO_FINISH, s2ns(1));
+
+    const auto& histogram = stats.histograms[InputLatencyStats::STAGE_PUBLISH_TO_FINISH];
+    ASSERT_EQ(1u, histogram[0]);
+    ASSERT_EQ(1u, histogram[1]);
+    ASSERT_EQ(1u, histogram[InputLatencyStats::BUCKET_COUNT - 1]);
+    ASSERT_EQ(3u, stats.getCount(InputLatencyStats::STAGE_PUBLISH_TO_FINISH));
+    ASSERT_EQ(0u, stats.getCount(InputLatencyStats::STAGE_END_TO_END));
+}
+
+TEST(InputLatencyStatsTest, GetPercentile_ReturnsTheLimitOfItsBucket) {
+    InputLatencyStats stats;
+    for (int i = 0; i < 9; i++) {
+        stats.record(InputLatencyStats::STAGE_END_TO_END, ms2ns(3));
+    }
+    stats.record(InputLatencyStats::STAGE_END_TO_END, s2ns(1));
+
+    ASSERT_EQ(ms2ns(4), stats.getPercentile(InputLatencyStats::STAGE_END_TO_END, 50));
+    ASSERT_EQ(ms2ns(4), stats.getPercentile(InputLatencyStats::STAGE_END_TO_END, 90));
+    // Above the last limit
+    ASSERT_EQ(-1, stats.getPercentile(InputLatencyStats::STAGE_END_TO_END, 99));
+}
+
+TEST(InputLatencyStatsTest, Parcelling) {
+    InputLatencyStats stats;
+    stats.windowName = "Foobar";
+    stats.record(InputLatencyStats::STAGE_EVENT_TO_DISPATCHER, us2ns(700));
+    stats.record(InputLatencyStats::STAGE_END_TO_END, ms2ns(20));
+
+    Parcel p;
+    ASSERT_EQ(OK, stats.write(p));
+    p.setDataPosition(0);
+    InputLatencyStats stats2;
+    ASSERT_EQ(OK, InputLatencyStats::read(p, &stats2));
+    ASSERT_EQ(stats.windowName, stats2.windowName);
+    ASSERT_EQ(stats.histograms, stats2.histograms);
+}
+
+} // namespace test
+} // namespace android
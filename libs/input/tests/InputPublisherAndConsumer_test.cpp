@@ -312,6 +312,50 @@ TEST_F(InputPublisherAndConsumerTest,
             << "publisher publishMotionEvent should return BAD_VALUE";
 }
 
+TEST_F(InputPublisherAndConsumerTest, PublishMessage_EndToEnd) {
+    status_t status;
+    InputMessage msg;
+    status = mPublisher->makeKeyEventMessage(&msg, 15, 1, AINPUT_SOURCE_KEYBOARD,
+            ADISPLAY_ID_DEFAULT, AKEY_EVENT_ACTION_DOWN, 0, AKEYCODE_ENTER, 13, 0, 0, 3, 4);
+    ASSERT_EQ(OK, status)
+            << "publisher makeKeyEventMessage should return OK";
+    status = mPublisher->publishMessage(msg);
+    ASSERT_EQ(OK, status)
+            << "publisher publishMessage should return OK";
+
+    uint32_t consumeSeq;
+    InputEvent* event;
+    int motionEventType;
+    int touchMoveNumber;
+    bool flag;
+    status = mConsumer->consume(&mEventFactory, true /*consumeBatches*/, -1, &consumeSeq, &event,
+                                &motionEventType, &touchMoveNumber, &flag);
+    ASSERT_EQ(OK, status)
+            << "consumer consume should return OK";
+    ASSERT_TRUE(event != nullptr)
+            << "consumer should have returned non-NULL event";
+    ASSERT_EQ(AINPUT_EVENT_TYPE_KEY, event->getType())
+            << "consumer should have returned a key event";
+    EXPECT_EQ(15U, consumeSeq);
+    EXPECT_EQ(AKEYCODE_ENTER, static_cast<KeyEvent*>(event)->getKeyCode());
+}
+
+TEST_F(InputPublisherAndConsumerTest,
+        MakeMotionEventMessage_WhenSequenceNumberIsZero_ReturnsError) {
+    const size_t pointerCount = 1;
+    PointerProperties pointerProperties[pointerCount];
+    PointerCoords pointerCoords[pointerCount];
+    pointerProperties[0].clear();
+    pointerCoords[0].clear();
+
+    InputMessage msg;
+    status_t status = mPublisher->makeMotionEventMessage(&msg, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            MotionClassification::NONE, 0, 0, 0, 0, 0, 0,
+            pointerCount, pointerProperties, pointerCoords);
+    ASSERT_EQ(BAD_VALUE, status)
+            << "publisher makeMotionEventMessage should return BAD_VALUE";
+}
+
 TEST_F(InputPublisherAndConsumerTest, PublishMultipleEvents_EndToEnd) {
     ASSERT_NO_FATAL_FAILURE(PublishAndConsumeMotionEvent());
     ASSERT_NO_FATAL_FAILURE(PublishAndConsumeKeyEvent());
@@ -320,4 +364,119 @@ TEST_F(InputPublisherAndConsumerTest, PublishMultipleEvents_EndToEnd) {
     ASSERT_NO_FATAL_FAILURE(PublishAndConsumeKeyEvent());
 }
 
+TEST_F(InputPublisherAndConsumerTest, TouchPredictor_PredictsToThePresentTime) {
+    constexpr nsecs_t MS = 1000000;
+    mConsumer->setTouchPredictor(TouchPredictor::create("lsq2"), 10 * MS /*presentLatency*/);
+
+    PointerProperties pointerProperties;
+    pointerProperties.clear();
+    pointerProperties.toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+    PointerCoords pointerCoords;
+    const int32_t actions[] = {AMOTION_EVENT_ACTION_DOWN, AMOTION_EVENT_ACTION_MOVE,
+            AMOTION_EVENT_ACTION_MOVE};
+    for (uint32_t i = 0; i < 3; i++) {
+        pointerCoords.clear();
+        pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_X, 10 * i);
+        pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_Y, 5);
+        status_t status = mPublisher->publishMotionEvent(i + 1, 1, AINPUT_SOURCE_TOUCHSCREEN,
+                ADISPLAY_ID_DEFAULT, actions[i], 0, 0, 0, 0, 0, MotionClassification::NONE,
+                0, 0, 0, 0, 0, 8 * MS * i /*eventTime*/, 1, &pointerProperties, &pointerCoords);
+        ASSERT_EQ(OK, status);
+    }
+
+    uint32_t consumeSeq;
+    InputEvent* event;
+    int motionEventType;
+    int touchMoveNumber = 0;
+    bool flag;
+    status_t status = mConsumer->consume(&mEventFactory, true /*consumeBatches*/, 20 * MS,
+            &consumeSeq, &event, &motionEventType, &touchMoveNumber, &flag);
+    ASSERT_EQ(OK, status);
+    ASSERT_EQ(AMOTION_EVENT_ACTION_DOWN, static_cast<MotionEvent*>(event)->getAction());
+
+    status = mConsumer->consume(&mEventFactory, true /*consumeBatches*/, 20 * MS,
+            &consumeSeq, &event, &motionEventType, &touchMoveNumber, &flag);
+    ASSERT_EQ(OK, status);
+    MotionEvent* motionEvent = static_cast<MotionEvent*>(event);
+    ASSERT_EQ(AMOTION_EVENT_ACTION_MOVE, motionEvent->getAction());
+
+    // Both moves, then the predicted sample at frameTime + presentLatency.
+    ASSERT_EQ(2U, motionEvent->getHistorySize());
+    EXPECT_EQ(30 * MS, motionEvent->getEventTime());
+    EXPECT_NEAR(37.5, motionEvent->getX(0), 0.01);
+    EXPECT_NEAR(5, motionEvent->getY(0), 0.01);
+}
+
+class InputPublisherAndConsumerSampleRingTest : public InputPublisherAndConsumerTest {
+protected:
+    virtual void SetUp() {
+        status_t result = InputChannel::openInputChannelPair("channel name",
+                serverChannel, clientChannel, 4 /*sampleRingCapacity*/);
+        ASSERT_EQ(OK, result);
+        ASSERT_NE(nullptr, clientChannel->getSampleRing());
+
+        mPublisher = new InputPublisher(serverChannel);
+        mConsumer = new InputConsumer(clientChannel);
+    }
+
+    void publishMotionEvent(uint32_t seq, int32_t deviceId, int32_t action) {
+        PointerProperties pointerProperties;
+        pointerProperties.clear();
+        PointerCoords pointerCoords;
+        pointerCoords.clear();
+        status_t status = mPublisher->publishMotionEvent(seq, deviceId,
+                AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT, action, 0, 0, 0, 0, 0,
+                MotionClassification::NONE, 0, 0, 0, 0, 0, seq /*eventTime*/,
+                1, &pointerProperties, &pointerCoords);
+        ASSERT_EQ(OK, status)
+                << "publisher publishMotionEvent should return OK";
+    }
+
+    void consumeMotionEvent(uint32_t expectedSeq, int32_t expectedAction) {
+        uint32_t consumeSeq;
+        InputEvent* event;
+        int motionEventType;
+        int touchMoveNumber;
+        bool flag;
+        status_t status = mConsumer->consume(&mEventFactory, true /*consumeBatches*/, -1,
+                &consumeSeq, &event, &motionEventType, &touchMoveNumber, &flag);
+        ASSERT_EQ(OK, status)
+                << "consumer consume should return OK";
+        ASSERT_TRUE(event != nullptr)
+                << "consumer should have returned non-NULL event";
+        ASSERT_EQ(AINPUT_EVENT_TYPE_MOTION, event->getType())
+                << "consumer should have returned a motion event";
+        EXPECT_EQ(expectedSeq, consumeSeq);
+        EXPECT_EQ(expectedAction, static_cast<MotionEvent*>(event)->getAction());
+    }
+};
+
+TEST_F(InputPublisherAndConsumerSampleRingTest, PublishMultipleEvents_EndToEnd) {
+    ASSERT_NO_FATAL_FAILURE(PublishAndConsumeMotionEvent());
+    ASSERT_NO_FATAL_FAILURE(PublishAndConsumeKeyEvent());
+    ASSERT_NO_FATAL_FAILURE(PublishAndConsumeMotionEvent());
+    ASSERT_NO_FATAL_FAILURE(PublishAndConsumeMotionEvent());
+}
+
+TEST_F(InputPublisherAndConsumerSampleRingTest, SamplesStayInOrderWithSocketMessages) {
+    // The move goes through the ring, the down through the socket.
+    ASSERT_NO_FATAL_FAILURE(publishMotionEvent(1, 1, AMOTION_EVENT_ACTION_MOVE));
+    ASSERT_NO_FATAL_FAILURE(publishMotionEvent(2, 1, AMOTION_EVENT_ACTION_DOWN));
+    ASSERT_NO_FATAL_FAILURE(publishMotionEvent(3, 1, AMOTION_EVENT_ACTION_MOVE));
+
+    ASSERT_NO_FATAL_FAILURE(consumeMotionEvent(1, AMOTION_EVENT_ACTION_MOVE));
+    ASSERT_NO_FATAL_FAILURE(consumeMotionEvent(2, AMOTION_EVENT_ACTION_DOWN));
+    ASSERT_NO_FATAL_FAILURE(consumeMotionEvent(3, AMOTION_EVENT_ACTION_MOVE));
+}
+
+TEST_F(InputPublisherAndConsumerSampleRingTest, WhenRingIsFull_FallsBackToTheSocket) {
+    // Different devices, so that the samples are not batched together.
+    for (uint32_t seq = 1; seq <= 6; seq++) {
+        ASSERT_NO_FATAL_FAILURE(publishMotionEvent(seq, seq, AMOTION_EVENT_ACTION_MOVE));
+    }
+    for (uint32_t seq = 1; seq <= 6; seq++) {
+        ASSERT_NO_FATAL_FAILURE(consumeMotionEvent(seq, AMOTION_EVENT_ACTION_MOVE));
+    }
+}
+
 } // namespace android
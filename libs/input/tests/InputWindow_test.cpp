@@ -19,6 +19,7 @@
 #include <binder/Binder.h>
 #include <binder/Parcel.h>
 
+#include <input/IInputFlinger.h>
 #include <input/InputWindow.h>
 #include <input/InputTransport.h>
 
@@ -97,6 +98,62 @@ TEST(InputWindowInfo, Parcelling) {
     ASSERT_EQ(i.portalToDisplayId, i2.portalToDisplayId);
     ASSERT_EQ(i.replaceTouchableRegionWithCrop, i2.replaceTouchableRegionWithCrop);
     ASSERT_EQ(i.touchableRegionCropHandle, i2.touchableRegionCropHandle);
+    ASSERT_TRUE(i == i2);
+}
+
+TEST(InputWindowInfo, Equality) {
+    InputWindowInfo i;
+    i.token = new BBinder();
+    i.name = "Foobar";
+    i.frameLeft = 0;
+    i.frameTop = 0;
+    i.frameRight = 100;
+    i.frameBottom = 100;
+    i.globalScaleFactor = 1.0f;
+    i.addTouchableRegion(Rect(0, 0, 100, 100));
+    i.applicationInfo.name = "App";
+
+    InputWindowInfo i2 = i;
+    ASSERT_TRUE(i == i2);
+
+    i2.frameRight = 101;
+    ASSERT_TRUE(i != i2);
+
+    i2 = i;
+    i2.addTouchableRegion(Rect(100, 0, 200, 100));
+    ASSERT_TRUE(i != i2);
+
+    i2 = i;
+    i2.applicationInfo.name = "OtherApp";
+    ASSERT_TRUE(i != i2);
+}
+
+TEST(InputWindowsUpdate, Parcelling) {
+    InputWindowInfo window;
+    window.token = new BBinder();
+    window.name = "Changed";
+
+    InputWindowsUpdate update;
+    update.baseGeneration = 4;
+    update.generation = 5;
+    update.changedWindows.push_back(window);
+    update.removedWindows.push_back(new BBinder());
+    update.order.push_back(window.token);
+
+    Parcel p;
+    ASSERT_EQ(OK, update.write(p));
+    p.setDataPosition(0);
+    InputWindowsUpdate update2;
+    ASSERT_EQ(OK, InputWindowsUpdate::read(p, &update2));
+    ASSERT_EQ(update.baseGeneration, update2.baseGeneration);
+    ASSERT_EQ(update.generation, update2.generation);
+    ASSERT_EQ(1u, update2.changedWindows.size());
+    ASSERT_EQ(window.token, update2.changedWindows[0].token);
+    ASSERT_EQ(window.name, update2.changedWindows[0].name);
+    ASSERT_EQ(update.removedWindows, update2.removedWindows);
+    ASSERT_EQ(update.order, update2.order);
+    ASSERT_FALSE(update2.isFull());
+    ASSERT_FALSE(update2.isEmpty());
 }
 
 } // namespace test
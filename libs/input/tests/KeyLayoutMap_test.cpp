@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <android-base/file.h>
+#include <android/keycodes.h>
+#include <input/KeyLayoutMap.h>
+
+namespace android {
+namespace test {
+
+static void writeLayout(const TemporaryFile& file, const char* contents) {
+    ASSERT_TRUE(android::base::WriteStringToFile(contents, file.path));
+}
+
+TEST(KeyLayoutMapTest, Load_SameFile_ReturnsTheSameMap) {
+    TemporaryFile file;
+    writeLayout(file, "key 30 A\n");
+
+    sp<KeyLayoutMap> map1;
+    ASSERT_EQ(NO_ERROR, KeyLayoutMap::load(file.path, &map1));
+    sp<KeyLayoutMap> map2;
+    ASSERT_EQ(NO_ERROR, KeyLayoutMap::load(file.path, &map2));
+    ASSERT_EQ(map1, map2);
+
+    int32_t keyCode;
+    uint32_t flags;
+    ASSERT_EQ(NO_ERROR, map2->mapKey(30, 0, &keyCode, &flags));
+    ASSERT_EQ(AKEYCODE_A, keyCode);
+}
+
+TEST(KeyLayoutMapTest, Load_ChangedFile_ParsesItAgain) {
+    TemporaryFile file;
+    writeLayout(file, "key 30 A\n");
+    sp<KeyLayoutMap> map1;
+    ASSERT_EQ(NO_ERROR, KeyLayoutMap::load(file.path, &map1));
+
+    writeLayout(file, "key 30 B\nkey 48 A\n");
+    sp<KeyLayoutMap> map2;
+    ASSERT_EQ(NO_ERROR, KeyLayoutMap::load(file.path, &map2));
+    ASSERT_NE(map1, map2);
+
+    int32_t keyCode;
+    uint32_t flags;
+    ASSERT_EQ(NO_ERROR, map2->mapKey(30, 0, &keyCode, &flags));
+    ASSERT_EQ(AKEYCODE_B, keyCode);
+}
+
+TEST(KeyLayoutMapTest, Load_InvalidFile_IsNotCached) {
+    TemporaryFile file;
+    writeLayout(file, "key 30 NOT_A_KEY\n");
+    sp<KeyLayoutMap> map;
+    ASSERT_NE(NO_ERROR, KeyLayoutMap::load(file.path, &map));
+    ASSERT_EQ(nullptr, map);
+    ASSERT_NE(NO_ERROR, KeyLayoutMap::load(file.path, &map));
+}
+
+} // namespace test
+} // namespace android
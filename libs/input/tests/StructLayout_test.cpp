@@ -69,6 +69,8 @@ void TestInputMessageAlignment() {
 
   CHECK_OFFSET(InputMessage::Body::Finished, seq, 0);
   CHECK_OFFSET(InputMessage::Body::Finished, handled, 4);
+
+  CHECK_OFFSET(InputMessage::Body::SampleRingWakeup, run, 0);
 }
 
 } // namespace android
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <input/TouchPredictor.h>
+
+namespace android {
+
+constexpr nsecs_t MS = 1000000;
+
+constexpr uint32_t POINTER_ID = 0;
+
+constexpr float PREDICTION_TOLERANCE = 0.01;
+
+class TouchPredictorTest : public testing::Test {
+protected:
+    void SetUp() override {
+        mPredictor = TouchPredictor::create("lsq2");
+        ASSERT_NE(nullptr, mPredictor);
+    }
+
+    void addMovement(nsecs_t eventTime, float x, float y) {
+        VelocityTracker::Position position = {x, y};
+        mPredictor->addMovement(eventTime, BitSet32(BitSet32::valueForBit(POINTER_ID)),
+                &position);
+    }
+
+    std::unique_ptr<TouchPredictor> mPredictor;
+};
+
+TEST_F(TouchPredictorTest, Create_WithUnknownName_ReturnsNull) {
+    EXPECT_EQ(nullptr, TouchPredictor::create("not a predictor"));
+    EXPECT_NE(nullptr, TouchPredictor::create("lsq1"));
+}
+
+TEST_F(TouchPredictorTest, Predict_WithoutMovements_ReturnsFalse) {
+    float x, y;
+    EXPECT_FALSE(mPredictor->predict(POINTER_ID, 10 * MS, &x, &y));
+
+    addMovement(0, 10, 20);
+    mPredictor->clear();
+    EXPECT_FALSE(mPredictor->predict(POINTER_ID, 10 * MS, &x, &y));
+}
+
+TEST_F(TouchPredictorTest, Predict_WithOneMovement_ReturnsTheLastPosition) {
+    addMovement(0, 10, 20);
+
+    float x, y;
+    ASSERT_TRUE(mPredictor->predict(POINTER_ID, 10 * MS, &x, &y));
+    EXPECT_NEAR(10, x, PREDICTION_TOLERANCE);
+    EXPECT_NEAR(20, y, PREDICTION_TOLERANCE);
+}
+
+TEST_F(TouchPredictorTest, Predict_LinearMovement_Extrapolates) {
+    // 1000 px/s along x, 500 px/s along y
+    addMovement(0, 0, 0);
+    addMovement(8 * MS, 8, 4);
+    addMovement(16 * MS, 16, 8);
+
+    float x, y;
+    ASSERT_TRUE(mPredictor->predict(POINTER_ID, 30 * MS, &x, &y));
+    EXPECT_NEAR(30, x, PREDICTION_TOLERANCE);
+    EXPECT_NEAR(15, y, PREDICTION_TOLERANCE);
+}
+
+TEST_F(TouchPredictorTest, Predict_FarAhead_IsLimited) {
+    addMovement(0, 0, 0);
+    addMovement(8 * MS, 8, 0);
+    addMovement(16 * MS, 16, 0);
+
+    float x, y;
+    ASSERT_TRUE(mPredictor->predict(POINTER_ID, 1000 * MS, &x, &y));
+    // No further than 50ms past the newest movement
+    EXPECT_NEAR(66, x, PREDICTION_TOLERANCE);
+}
+
+TEST_F(TouchPredictorTest, ClearPointers_ForgetsOnlyThosePointers) {
+    VelocityTracker::Position positions[2] = {{0, 0}, {100, 100}};
+    BitSet32 idBits;
+    idBits.markBit(0);
+    idBits.markBit(1);
+    mPredictor->addMovement(0, idBits, positions);
+
+    mPredictor->clearPointers(BitSet32(BitSet32::valueForBit(1)));
+
+    float x, y;
+    EXPECT_TRUE(mPredictor->predict(0, 10 * MS, &x, &y));
+    EXPECT_FALSE(mPredictor->predict(1, 10 * MS, &x, &y));
+}
+
+} // namespace android
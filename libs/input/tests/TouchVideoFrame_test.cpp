@@ -192,5 +192,41 @@ TEST(TouchVideoFrame, Rotate270_3x2_4times) {
     ASSERT_EQ(frame, frameOriginal);
 }
 
+TEST(TouchVideoFrame, Copy_SharesData) {
+    TouchVideoFrame frame(3, 2, {1, 2, 3, 4, 5, 6}, TIMESTAMP);
+    TouchVideoFrame copy = frame;
+    ASSERT_EQ(frame, copy);
+    ASSERT_EQ(frame.getData().data(), copy.getData().data());
+}
+
+TEST(TouchVideoFrame, FromSharedData_DoesNotCopy) {
+    auto data = std::make_shared<std::vector<int16_t>>(std::vector<int16_t>{1, 2, 3, 4, 5, 6});
+    TouchVideoFrame frame = TouchVideoFrame::fromSharedData(3, 2, data, TIMESTAMP);
+    ASSERT_EQ(data->data(), frame.getData().data());
+    ASSERT_EQ(2, data.use_count());
+}
+
+TEST(TouchVideoFrame, RotateCopy_LeavesOriginalAlone) {
+    TouchVideoFrame frame(3, 2, {1, 2, 3, 4, 5, 6}, TIMESTAMP);
+    TouchVideoFrame frameOriginal(3, 2, {1, 2, 3, 4, 5, 6}, TIMESTAMP);
+
+    TouchVideoFrame rotated90 = frame;
+    rotated90.rotate(DISPLAY_ORIENTATION_90);
+    TouchVideoFrame rotated180 = frame;
+    rotated180.rotate(DISPLAY_ORIENTATION_180);
+    ASSERT_EQ(frame, frameOriginal);
+
+    TouchVideoFrame frameRotated180(3, 2, {6, 5, 4, 3, 2, 1}, TIMESTAMP);
+    ASSERT_EQ(rotated180, frameRotated180);
+}
+
+TEST(TouchVideoFrame, RotateSharedData_LeavesDataAlone) {
+    auto data = std::make_shared<std::vector<int16_t>>(std::vector<int16_t>{1, 2, 3, 4, 5, 6});
+    TouchVideoFrame frame = TouchVideoFrame::fromSharedData(3, 2, data, TIMESTAMP);
+    frame.rotate(DISPLAY_ORIENTATION_180);
+    ASSERT_EQ(std::vector<int16_t>({1, 2, 3, 4, 5, 6}), *data);
+    ASSERT_EQ(1, data.use_count());
+}
+
 } // namespace test
 } // namespace android
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <input/VelocityTracker.h>
+
+namespace android {
+namespace {
+
+constexpr nsecs_t kSampleInterval = 8 * 1000000; // 8 ms, a 120 Hz touch panel
+constexpr uint32_t kSampleCount = 20;
+constexpr uint32_t kPointerId = 0;
+
+// Feeds the tracker a full history of one accelerating pointer, then measures how long
+// getEstimator takes. The strategies that fit a polynomial do all of their work there.
+void BM_VelocityTrackerGetEstimator(benchmark::State& state, const char* strategy) {
+    VelocityTracker tracker(strategy);
+    const BitSet32 idBits(BitSet32::valueForBit(kPointerId));
+    for (uint32_t i = 0; i < kSampleCount; i++) {
+        const float t = i * 0.008f;
+        const VelocityTracker::Position position = {100 + 400 * t + 2000 * t * t, 300 - 600 * t};
+        tracker.addMovement(i * kSampleInterval, idBits, &position);
+    }
+
+    VelocityTracker::Estimator estimator;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tracker.getEstimator(kPointerId, &estimator));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, impulse, "impulse");
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, lsq1, "lsq1");
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, lsq2, "lsq2");
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, lsq3, "lsq3");
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, wlsq2_delta, "wlsq2-delta");
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, wlsq2_central, "wlsq2-central");
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, wlsq2_recent, "wlsq2-recent");
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, int1, "int1");
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, int2, "int2");
+BENCHMARK_CAPTURE(BM_VelocityTrackerGetEstimator, legacy, "legacy");
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
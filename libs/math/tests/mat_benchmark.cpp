@@ -0,0 +1,92 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <math/mat3.h>
+#include <math/mat4.h>
+
+namespace android {
+namespace {
+
+// A rotation, scale and translation, like the transforms RenderEngine and
+// the sensor fusion code work with.
+template <typename T>
+details::TMat44<T> makeMatrix() {
+    return details::TMat44<T>::translate(details::TVec4<T>(1, 2, 3, 1)) *
+            details::TMat44<T>::rotate(T(0.5), details::TVec3<T>(1, 1, 0)) *
+            details::TMat44<T>::scale(details::TVec4<T>(2, 3, 4, 1));
+}
+
+template <typename T>
+void BM_Mat4MultiplyMat4(benchmark::State& state) {
+    details::TMat44<T> lhs = makeMatrix<T>();
+    details::TMat44<T> rhs = inverse(lhs);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs);
+        benchmark::DoNotOptimize(rhs);
+        details::TMat44<T> result = lhs * rhs;
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Mat4MultiplyMat4, float);
+BENCHMARK_TEMPLATE(BM_Mat4MultiplyMat4, double);
+
+template <typename T>
+void BM_Mat4MultiplyVec4(benchmark::State& state) {
+    details::TMat44<T> lhs = makeMatrix<T>();
+    details::TVec4<T> rhs(1, 2, 3, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs);
+        benchmark::DoNotOptimize(rhs);
+        details::TVec4<T> result = lhs * rhs;
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Mat4MultiplyVec4, float);
+BENCHMARK_TEMPLATE(BM_Mat4MultiplyVec4, double);
+
+template <typename T>
+void BM_Mat4Inverse(benchmark::State& state) {
+    details::TMat44<T> m = makeMatrix<T>();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m);
+        details::TMat44<T> result = inverse(m);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Mat4Inverse, float);
+BENCHMARK_TEMPLATE(BM_Mat4Inverse, double);
+
+void BM_Mat3MultiplyMat3(benchmark::State& state) {
+    mat3 lhs = mat3::rotate(0.5f, vec3(1, 1, 0));
+    mat3 rhs = transpose(lhs);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs);
+        benchmark::DoNotOptimize(rhs);
+        mat3 result = lhs * rhs;
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Mat3MultiplyMat3);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
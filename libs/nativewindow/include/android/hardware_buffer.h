@@ -520,6 +520,24 @@ int AHardwareBuffer_lockAndGetInfo(AHardwareBuffer* buffer, uint64_t usage,
         int32_t* outBytesPerPixel, int32_t* outBytesPerStride) __INTRODUCED_IN(29);
 #endif // __ANDROID_API__ >= 29
 
+#if __ANDROID_API__ >= 30
+
+/**
+ * Allocates count buffers that all match the passed AHardwareBuffer_Desc.
+ *
+ * This is the same as calling AHardwareBuffer_allocate() count times, but
+ * the description is only validated once and the buffers are allocated
+ * with a single call to the allocator where possible.
+ *
+ * \return 0 on success, or an error number if any of the allocations
+ * fails, in which case no buffer is allocated. Each returned buffer has a
+ * reference count of 1.
+ */
+int AHardwareBuffer_allocateMany(const AHardwareBuffer_Desc* desc, uint32_t count,
+        AHardwareBuffer** outBuffers) __INTRODUCED_IN(30);
+
+#endif // __ANDROID_API__ >= 30
+
 __END_DECLS
 
 #endif // ANDROID_HARDWARE_BUFFER_H
@@ -238,6 +238,7 @@ enum {
     NATIVE_WINDOW_SET_BUFFERS_SMPTE2086_METADATA = 32,
     NATIVE_WINDOW_SET_BUFFERS_CTA861_3_METADATA = 33,
     NATIVE_WINDOW_SET_BUFFERS_HDR10_PLUS_METADATA = 34,
+    NATIVE_WINDOW_SET_DEQUEUE_TIMEOUT           = 35,   /* private */
     // clang-format on
 };
 
@@ -985,4 +986,16 @@ static inline int native_window_get_consumer_usage(struct ANativeWindow* window,
     return window->perform(window, NATIVE_WINDOW_GET_CONSUMER_USAGE64, outUsage);
 }
 
+/*
+ * native_window_set_dequeue_timeout(..., int64_t timeout)
+ * Makes dequeueBuffer fail with TIMED_OUT instead of blocking for longer
+ * than timeout nanoseconds waiting for a free buffer. A negative timeout,
+ * the default, waits forever. The timeout stays in effect until it is set
+ * again, so callers that only want it for one dequeue must restore -1.
+ */
+static inline int native_window_set_dequeue_timeout(struct ANativeWindow* window,
+                                                    int64_t timeout) {
+    return window->perform(window, NATIVE_WINDOW_SET_DEQUEUE_TIMEOUT, timeout);
+}
+
 __END_DECLS
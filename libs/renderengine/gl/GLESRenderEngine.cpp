@@ -23,6 +23,7 @@
 
 #include <math.h>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 #include <unordered_set>
 
@@ -38,6 +39,7 @@
 #include <ui/ColorSpace.h>
 #include <ui/DebugUtils.h>
 #include <ui/GraphicBuffer.h>
+#include <ui/PixelFormat.h>
 #include <ui/Rect.h>
 #include <ui/Region.h>
 #include <utils/KeyedVector.h>
@@ -116,6 +118,17 @@ namespace gl {
 using base::StringAppendF;
 using ui::Dataspace;
 
+// Default byte budget of the external texture image cache, in MiB.
+static constexpr int32_t kDefaultImageCacheBudgetMb = 256;
+
+// Approximate amount of memory mapped by an image of buffer. YUV formats report no bytes per
+// pixel, so those are assumed to be 4:2:0 subsampled.
+static size_t imageSizeBytes(const GraphicBuffer& buffer) {
+    const size_t pixels = static_cast<size_t>(buffer.getStride()) * buffer.getHeight();
+    const uint32_t bpp = bytesPerPixel(buffer.getPixelFormat());
+    return bpp > 0 ? pixels * bpp : pixels * 3 / 2;
+}
+
 static status_t selectConfigForAttribute(EGLDisplay dpy, EGLint const* attrs, EGLint attribute,
                                          EGLint wanted, EGLConfig* outConfig) {
     EGLint numConfigs = -1, n = 0;
@@ -296,6 +309,10 @@ std::unique_ptr<GLESRenderEngine> GLESRenderEngine::create(int hwcFormat, uint32
             break;
     }
 
+    if (property_get_bool("debug.renderengine.async_shader_compile", true)) {
+        engine->initAsyncProgramCompile(hwcFormat);
+    }
+
     ALOGI("OpenGL ES informations:");
     ALOGI("vendor    : %s", extensions.getVendor());
     ALOGI("renderer  : %s", extensions.getRenderer());
@@ -422,10 +439,26 @@ GLESRenderEngine::GLESRenderEngine(uint32_t featureFlags, EGLDisplay display, EG
         mTraceGpuCompletion = true;
         mFlushTracer = std::make_unique<FlushTracer>(this);
     }
+
+    // Low-RAM devices get a quarter of the default image cache budget.
+    const int32_t defaultImageCacheBudgetMb = property_get_bool("ro.config.low_ram", false)
+            ? kDefaultImageCacheBudgetMb / 4
+            : kDefaultImageCacheBudgetMb;
+    const int32_t imageCacheBudgetMb =
+            property_get_int32("debug.renderengine.image_cache_budget_mb",
+                               defaultImageCacheBudgetMb);
+    mImageCacheBudget = static_cast<size_t>(std::max(imageCacheBudgetMb, 0)) << 20;
     mDrawingBuffer = createFramebuffer();
 }
 
 GLESRenderEngine::~GLESRenderEngine() {
+    ProgramCache::getInstance().stopAsyncCompile();
+    if (mCompileDummySurface != EGL_NO_SURFACE) {
+        eglDestroySurface(mEGLDisplay, mCompileDummySurface);
+    }
+    if (mCompileEGLContext != EGL_NO_CONTEXT) {
+        eglDestroyContext(mEGLDisplay, mCompileEGLContext);
+    }
     std::lock_guard<std::mutex> lock(mRenderingMutex);
     unbindFrameBuffer(mDrawingBuffer.get());
     mDrawingBuffer = nullptr;
@@ -435,6 +468,8 @@ GLESRenderEngine::~GLESRenderEngine() {
         eglDestroyImageKHR(mEGLDisplay, expired);
     }
     mImageCache.clear();
+    mImageCacheLru.clear();
+    mImageCacheBytes = 0;
     eglMakeCurrent(mEGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     eglTerminate(mEGLDisplay);
 }
@@ -456,6 +491,31 @@ void GLESRenderEngine::primeCache() const {
                                            mFeatureFlags & USE_COLOR_MANAGEMENT);
 }
 
+void GLESRenderEngine::initAsyncProgramCompile(int hwcFormat) {
+    mCompileEGLContext = createEglContext(mEGLDisplay, mEGLConfig, mEGLContext,
+                                          /*useContextPriority*/ false, Protection::UNPROTECTED);
+    if (mCompileEGLContext == EGL_NO_CONTEXT) {
+        ALOGE("Can't create shader compile context, compiling shaders synchronously");
+        return;
+    }
+    if (!GLExtensions::getInstance().hasSurfacelessContext()) {
+        mCompileDummySurface = createDummyEglPbufferSurface(mEGLDisplay, mEGLConfig, hwcFormat,
+                                                            Protection::UNPROTECTED);
+        if (mCompileDummySurface == EGL_NO_SURFACE) {
+            ALOGE("Can't create shader compile pbuffer, compiling shaders synchronously");
+            eglDestroyContext(mEGLDisplay, mCompileEGLContext);
+            mCompileEGLContext = EGL_NO_CONTEXT;
+            return;
+        }
+    }
+    ProgramCache::getInstance().startAsyncCompile(mEGLDisplay, mEGLContext, mCompileEGLContext,
+                                                  mCompileDummySurface);
+}
+
+void GLESRenderEngine::setProgramCompiledCallback(std::function<void()> callback) {
+    ProgramCache::getInstance().setProgramCompiledCallback(std::move(callback));
+}
+
 bool GLESRenderEngine::isCurrent() const {
     return mEGLDisplay == eglGetCurrentDisplay() && mEGLContext == eglGetCurrentContext();
 }
@@ -633,9 +693,14 @@ status_t GLESRenderEngine::cacheExternalTextureBufferLocked(const sp<GraphicBuff
 
     ATRACE_CALL();
 
-    if (mImageCache.count(buffer->getId()) > 0) {
+    const auto cachedImage = mImageCache.find(buffer->getId());
+    if (cachedImage != mImageCache.end()) {
+        mImageCacheHits++;
+        mImageCacheLru.splice(mImageCacheLru.begin(), mImageCacheLru,
+                              cachedImage->second.lruPosition);
         return NO_ERROR;
     }
+    mImageCacheMisses++;
 
     std::unique_ptr<Image> newImage = createImage();
 
@@ -647,11 +712,35 @@ status_t GLESRenderEngine::cacheExternalTextureBufferLocked(const sp<GraphicBuff
               buffer->getPixelFormat());
         return NO_INIT;
     }
-    mImageCache.insert(std::make_pair(buffer->getId(), std::move(newImage)));
+    const size_t sizeBytes = imageSizeBytes(*buffer);
+    mImageCacheLru.push_front(buffer->getId());
+    mImageCache.emplace(buffer->getId(),
+                        CachedImage{std::move(newImage), sizeBytes, mImageCacheLru.begin()});
+    mImageCacheBytes += sizeBytes;
+    trimImageCacheLocked();
 
     return NO_ERROR;
 }
 
+void GLESRenderEngine::eraseCachedImageLocked(uint64_t bufferId) {
+    const auto cachedImage = mImageCache.find(bufferId);
+    if (cachedImage == mImageCache.end()) {
+        return;
+    }
+    mImageCacheBytes -= cachedImage->second.sizeBytes;
+    mImageCacheLru.erase(cachedImage->second.lruPosition);
+    mImageCache.erase(cachedImage);
+}
+
+void GLESRenderEngine::trimImageCacheLocked() {
+    while (mImageCacheBytes > mImageCacheBudget && mImageCacheLru.size() > 1) {
+        const uint64_t bufferId = mImageCacheLru.back();
+        ALOGV("Evicting image for buffer: %" PRIu64, bufferId);
+        eraseCachedImageLocked(bufferId);
+        mImageCacheEvictions++;
+    }
+}
+
 status_t GLESRenderEngine::bindExternalTextureBufferLocked(uint32_t texName,
                                                            const sp<GraphicBuffer>& buffer,
                                                            const sp<Fence>& bufferFence) {
@@ -670,7 +759,7 @@ status_t GLESRenderEngine::bindExternalTextureBufferLocked(uint32_t texName,
         return NO_INIT;
     }
 
-    bindExternalTextureImage(texName, *cachedImage->second);
+    bindExternalTextureImage(texName, *cachedImage->second.image);
 
     // Wait for the new buffer to be ready.
     if (bufferFence != nullptr && bufferFence->isValid()) {
@@ -701,7 +790,7 @@ void GLESRenderEngine::unbindExternalTextureBuffer(uint64_t bufferId) {
     const auto& cachedImage = mImageCache.find(bufferId);
     if (cachedImage != mImageCache.end()) {
         ALOGV("Destroying image for buffer: %" PRIu64, bufferId);
-        mImageCache.erase(bufferId);
+        eraseCachedImageLocked(bufferId);
         return;
     }
     ALOGV("Failed to find image for buffer: %" PRIu64, bufferId);
@@ -764,19 +853,39 @@ void GLESRenderEngine::handleRoundedCorners(const DisplaySettings& display,
     // and the middle part without rounded corners.
     const int32_t radius = ceil(layer.geometry.roundedCornersRadius);
     const Rect topRect(bounds.left, bounds.top, bounds.right, bounds.top + radius);
-    setScissor(topRect);
+    setDrawScissor(topRect);
     drawMesh(mesh);
     const Rect bottomRect(bounds.left, bounds.bottom - radius, bounds.right, bounds.bottom);
-    setScissor(bottomRect);
+    setDrawScissor(bottomRect);
     drawMesh(mesh);
 
     // The middle part of the layer can turn off blending.
     const Rect middleRect(bounds.left, bounds.top + radius, bounds.right, bounds.bottom - radius);
-    setScissor(middleRect);
+    setDrawScissor(middleRect);
     mState.cornerRadius = 0.0;
     disableBlending();
     drawMesh(mesh);
-    disableScissor();
+    resetDrawScissor();
+}
+
+void GLESRenderEngine::setDrawScissor(const Rect& region) {
+    if (!mDisplayDamage.isValid()) {
+        setScissor(region);
+        return;
+    }
+    Rect scissor;
+    if (!region.intersect(mDisplayDamage, &scissor)) {
+        scissor = Rect::EMPTY_RECT;
+    }
+    setScissor(scissor);
+}
+
+void GLESRenderEngine::resetDrawScissor() {
+    if (mDisplayDamage.isValid()) {
+        setScissor(mDisplayDamage);
+    } else {
+        disableScissor();
+    }
 }
 
 status_t GLESRenderEngine::bindFrameBuffer(Framebuffer* framebuffer) {
@@ -901,6 +1010,12 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
             return fbo.getStatus();
         }
 
+        // When only part of the buffer is damaged, the rest still holds the
+        // contents drawn into it previously, so restrict all drawing to the
+        // damage.
+        mDisplayDamage = display.damage;
+        resetDrawScissor();
+
         // clear the entire buffer, sometimes when we reuse buffers we'd persist
         // ghost images otherwise.
         // we also require a full transparent framebuffer for overlays. This is
@@ -921,7 +1036,21 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         }
 
         Mesh mesh(Mesh::TRIANGLE_FAN, 4, 2, 2);
-        for (auto layer : layers) {
+        for (auto it = layers.begin(); it != layers.end(); ++it) {
+            if (isBatchableSolidColorLayer(*it)) {
+                auto runEnd = std::next(it);
+                while (runEnd != layers.end() && isBatchableSolidColorLayer(*runEnd) &&
+                       hasSameSolidColorShading(*it, *runEnd)) {
+                    runEnd++;
+                }
+                if (std::distance(it, runEnd) > 1) {
+                    drawSolidColorLayers(display, projectionMatrix, it, runEnd);
+                    it = std::prev(runEnd);
+                    continue;
+                }
+            }
+
+            const LayerSettings& layer = *it;
             mState.projectionMatrix = projectionMatrix * layer.geometry.positionTransform;
 
             const FloatRect bounds = layer.geometry.boundaries;
@@ -992,6 +1121,9 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
             }
         }
 
+        mDisplayDamage = Rect::INVALID_RECT;
+        resetDrawScissor();
+
         if (drawFence != nullptr) {
             *drawFence = flush();
         }
@@ -1013,6 +1145,55 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
     return NO_ERROR;
 }
 
+bool GLESRenderEngine::isBatchableSolidColorLayer(const LayerSettings& layer) {
+    const mat4& transform = layer.geometry.positionTransform;
+    return layer.source.buffer.buffer == nullptr && layer.geometry.roundedCornersRadius <= 0.0f &&
+            transform[0][3] == 0.0f && transform[1][3] == 0.0f && transform[3][3] == 1.0f;
+}
+
+bool GLESRenderEngine::hasSameSolidColorShading(const LayerSettings& a, const LayerSettings& b) {
+    return a.source.solidColor == b.source.solidColor && a.alpha == b.alpha &&
+            a.colorTransform == b.colorTransform && a.sourceDataspace == b.sourceDataspace &&
+            a.disableBlending == b.disableBlending;
+}
+
+void GLESRenderEngine::drawSolidColorLayers(const DisplaySettings& display,
+                                            const mat4& projectionMatrix,
+                                            std::vector<LayerSettings>::const_iterator begin,
+                                            std::vector<LayerSettings>::const_iterator end) {
+    ATRACE_CALL();
+    const size_t layerCount = std::distance(begin, end);
+    Mesh mesh(Mesh::TRIANGLES, layerCount * 6, 2);
+    Mesh::VertexArray<vec2> position(mesh.getPositionArray<vec2>());
+    size_t index = 0;
+    for (auto it = begin; it != end; ++it) {
+        const mat4& transform = it->geometry.positionTransform;
+        const FloatRect& bounds = it->geometry.boundaries;
+        const vec2 leftTop = (transform * vec4(bounds.left, bounds.top, 0.0f, 1.0f)).xy;
+        const vec2 leftBottom = (transform * vec4(bounds.left, bounds.bottom, 0.0f, 1.0f)).xy;
+        const vec2 rightBottom = (transform * vec4(bounds.right, bounds.bottom, 0.0f, 1.0f)).xy;
+        const vec2 rightTop = (transform * vec4(bounds.right, bounds.top, 0.0f, 1.0f)).xy;
+        position[index++] = leftTop;
+        position[index++] = leftBottom;
+        position[index++] = rightBottom;
+        position[index++] = leftTop;
+        position[index++] = rightBottom;
+        position[index++] = rightTop;
+    }
+
+    const LayerSettings& layer = *begin;
+    mState.projectionMatrix = projectionMatrix;
+    setColorTransform(display.colorTransform * layer.colorTransform);
+    const half3 solidColor = layer.source.solidColor;
+    const half4 color = half4(solidColor.r, solidColor.g, solidColor.b, layer.alpha);
+    setupLayerBlending(true, false, true, color, 0.0f);
+    if (layer.disableBlending) {
+        glDisable(GL_BLEND);
+    }
+    setSourceDataSpace(layer.sourceDataspace);
+    drawMesh(mesh);
+}
+
 void GLESRenderEngine::setViewportAndProjection(size_t vpw, size_t vph, Rect sourceCrop,
                                                 ui::Transform::orientation_flags rotation) {
     setViewportAndProjection(Rect(vpw, vph), sourceCrop);
@@ -1306,6 +1487,14 @@ void GLESRenderEngine::dump(std::string& result) {
     StringAppendF(&result, "RenderEngine last dataspace conversion: (%s) to (%s)\n",
                   dataspaceDetails(static_cast<android_dataspace>(mDataSpace)).c_str(),
                   dataspaceDetails(static_cast<android_dataspace>(mOutputDataSpace)).c_str());
+    {
+        std::lock_guard<std::mutex> lock(mRenderingMutex);
+        StringAppendF(&result,
+                      "RenderEngine image cache: %zu images, %zu KiB of %zu KiB, hits=%" PRIu64
+                      " misses=%" PRIu64 " evictions=%" PRIu64 "\n",
+                      mImageCache.size(), mImageCacheBytes >> 10, mImageCacheBudget >> 10,
+                      mImageCacheHits, mImageCacheMisses, mImageCacheEvictions);
+    }
 }
 
 GLESRenderEngine::GlesVersion GLESRenderEngine::parseGlesVersion(const char* str) {
@@ -1439,6 +1628,14 @@ bool GLESRenderEngine::isFramebufferImageCachedForTesting(uint64_t bufferId) {
                        });
 }
 
+size_t GLESRenderEngine::setImageCacheBudgetForTesting(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mRenderingMutex);
+    const size_t oldBudget = mImageCacheBudget;
+    mImageCacheBudget = bytes;
+    trimImageCacheLocked();
+    return oldBudget;
+}
+
 // FlushTracer implementation
 GLESRenderEngine::FlushTracer::FlushTracer(GLESRenderEngine* engine) : mEngine(engine) {
     mThread = std::thread(&GLESRenderEngine::FlushTracer::loop, this);
@@ -22,6 +22,7 @@
 #include <sys/types.h>
 #include <condition_variable>
 #include <deque>
+#include <list>
 #include <mutex>
 #include <queue>
 #include <thread>
@@ -83,6 +84,7 @@ public:
     bool isProtected() const override { return mInProtectedContext; }
     bool supportsProtectedContent() const override;
     bool useProtectedContext(bool useProtectedContext) override;
+    void setProgramCompiledCallback(std::function<void()> callback) override;
     status_t drawLayers(const DisplaySettings& display, const std::vector<LayerSettings>& layers,
                         ANativeWindowBuffer* buffer, const bool useFramebufferCache,
                         base::unique_fd&& bufferFence, base::unique_fd* drawFence)
@@ -100,6 +102,8 @@ public:
     bool isImageCachedForTesting(uint64_t bufferId) EXCLUDES(mRenderingMutex);
     // Returns true iff mFramebufferImageCache contains an image keyed by bufferId
     bool isFramebufferImageCachedForTesting(uint64_t bufferId) EXCLUDES(mRenderingMutex);
+    // Overrides the byte budget of mImageCache, evicting images if needed. Returns the old budget.
+    size_t setImageCacheBudgetForTesting(size_t bytes) EXCLUDES(mRenderingMutex);
 
 protected:
     Framebuffer* getFramebufferForDrawing() override;
@@ -145,6 +149,9 @@ private:
     void setScissor(const Rect& region);
     void disableScissor();
     bool waitSync(EGLSyncKHR sync, EGLint flags);
+    // Creates a context sharing objects with mEGLContext, which ProgramCache uses to compile
+    // programs that miss the cache in the background.
+    void initAsyncProgramCompile(int hwcFormat);
 
     // A data space is considered HDR data space if it has BT2020 color space
     // with PQ or HLG transfer function.
@@ -165,6 +172,28 @@ private:
     // blending is an expensive operation, we want to turn off blending when it's not necessary.
     void handleRoundedCorners(const DisplaySettings& display, const LayerSettings& layer,
                               const Mesh& mesh);
+    // Scissors to the given rectangle, restricted to the damage of the
+    // display being drawn, if any.
+    void setDrawScissor(const Rect& region);
+    // Restores the scissor to the damage of the display being drawn, if any.
+    void resetDrawScissor();
+
+    // Solid color layers without rounded corners and with an affine position
+    // transform can have their quads transformed on the CPU and merged into a
+    // single draw call.
+    static bool isBatchableSolidColorLayer(const LayerSettings& layer);
+    // Whether two batchable layers produce the same shader state and blending.
+    static bool hasSameSolidColorShading(const LayerSettings& a, const LayerSettings& b);
+    // Draws a run of batchable, identically-shaded layers that are adjacent in
+    // Z order with one draw call. Triangles are rasterized in order, so the
+    // result matches drawing the layers one at a time.
+    void drawSolidColorLayers(const DisplaySettings& display, const mat4& projectionMatrix,
+                              std::vector<LayerSettings>::const_iterator begin,
+                              std::vector<LayerSettings>::const_iterator end);
+
+    // The damage of the display being drawn by drawLayers, or INVALID_RECT
+    // when the whole buffer is drawn.
+    Rect mDisplayDamage = Rect::INVALID_RECT;
 
     EGLDisplay mEGLDisplay;
     EGLConfig mEGLConfig;
@@ -172,6 +201,8 @@ private:
     EGLSurface mDummySurface;
     EGLContext mProtectedEGLContext;
     EGLSurface mProtectedDummySurface;
+    EGLContext mCompileEGLContext = EGL_NO_CONTEXT;
+    EGLSurface mCompileDummySurface = EGL_NO_SURFACE;
     GLuint mProtectedTexName;
     GLint mMaxViewportDims[2];
     GLint mMaxTextureSize;
@@ -212,8 +243,22 @@ private:
     // supports sRGB, DisplayP3 color spaces.
     const bool mUseColorManagement = false;
 
-    // Cache of GL images that we'll store per GraphicBuffer ID
-    std::unordered_map<uint64_t, std::unique_ptr<Image>> mImageCache GUARDED_BY(mRenderingMutex);
+    struct CachedImage {
+        std::unique_ptr<Image> image;
+        size_t sizeBytes;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+    // Cache of GL images that we'll store per GraphicBuffer ID. Once the images add up to more
+    // than mImageCacheBudget bytes, the least recently used ones are destroyed. An evicted image
+    // is simply recreated the next time its buffer is bound.
+    std::unordered_map<uint64_t, CachedImage> mImageCache GUARDED_BY(mRenderingMutex);
+    // Buffer IDs in mImageCache, most recently used first.
+    std::list<uint64_t> mImageCacheLru GUARDED_BY(mRenderingMutex);
+    size_t mImageCacheBytes GUARDED_BY(mRenderingMutex) = 0;
+    size_t mImageCacheBudget GUARDED_BY(mRenderingMutex) = 0;
+    uint64_t mImageCacheHits GUARDED_BY(mRenderingMutex) = 0;
+    uint64_t mImageCacheMisses GUARDED_BY(mRenderingMutex) = 0;
+    uint64_t mImageCacheEvictions GUARDED_BY(mRenderingMutex) = 0;
     // Mutex guarding rendering operations, so that:
     // 1. GL operations aren't interleaved, and
     // 2. Internal state related to rendering that is potentially modified by
@@ -228,6 +273,10 @@ private:
     // is held.
     status_t cacheExternalTextureBufferLocked(const sp<GraphicBuffer>& buffer)
             REQUIRES(mRenderingMutex);
+    void eraseCachedImageLocked(uint64_t bufferId) REQUIRES(mRenderingMutex);
+    // Evicts least recently used images until mImageCache fits its budget, always keeping the
+    // most recently used one.
+    void trimImageCacheLocked() REQUIRES(mRenderingMutex);
 
     std::unique_ptr<Framebuffer> mDrawingBuffer;
 
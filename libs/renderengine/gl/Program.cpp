@@ -18,6 +18,7 @@
 
 #include <stdint.h>
 
+#include <GLES2/gl2ext.h>
 #include <log/log.h>
 #include <math/mat4.h>
 #include <utils/String8.h>
@@ -39,6 +40,37 @@ Program::Program(const ProgramCache::Key& /*needs*/, const char* vertex, const c
     glBindAttribLocation(programId, cropCoords, "cropCoords");
     glLinkProgram(programId);
 
+    if (!checkLinkStatus(programId)) {
+        glDetachShader(programId, vertexId);
+        glDetachShader(programId, fragmentId);
+        glDeleteShader(vertexId);
+        glDeleteShader(fragmentId);
+        glDeleteProgram(programId);
+    } else {
+        mVertexShader = vertexId;
+        mFragmentShader = fragmentId;
+        initialize(programId);
+    }
+}
+
+Program::Program(const ProgramCache::Key& /*needs*/, GLenum binaryFormat, const void* binary,
+                 GLsizei length)
+      : mInitialized(false), mVertexShader(0), mFragmentShader(0) {
+    GLuint programId = glCreateProgram();
+    glProgramBinaryOES(programId, binaryFormat, binary, length);
+
+    // The driver rejects binaries it did not produce, e.g. after it was updated.
+    GLint status;
+    glGetProgramiv(programId, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        ALOGV("Program binary was rejected by the driver");
+        glDeleteProgram(programId);
+    } else {
+        initialize(programId);
+    }
+}
+
+bool Program::checkLinkStatus(GLuint programId) {
     GLint status;
     glGetProgramiv(programId, GL_LINK_STATUS, &status);
     if (status != GL_TRUE) {
@@ -50,31 +82,28 @@ Program::Program(const ProgramCache::Key& /*needs*/, const char* vertex, const c
             glGetProgramInfoLog(programId, infoLen, 0, &log[0]);
             ALOGE("%s", log);
         }
-        glDetachShader(programId, vertexId);
-        glDetachShader(programId, fragmentId);
-        glDeleteShader(vertexId);
-        glDeleteShader(fragmentId);
-        glDeleteProgram(programId);
-    } else {
-        mProgram = programId;
-        mVertexShader = vertexId;
-        mFragmentShader = fragmentId;
-        mInitialized = true;
-        mProjectionMatrixLoc = glGetUniformLocation(programId, "projection");
-        mTextureMatrixLoc = glGetUniformLocation(programId, "texture");
-        mSamplerLoc = glGetUniformLocation(programId, "sampler");
-        mColorLoc = glGetUniformLocation(programId, "color");
-        mDisplayMaxLuminanceLoc = glGetUniformLocation(programId, "displayMaxLuminance");
-        mInputTransformMatrixLoc = glGetUniformLocation(programId, "inputTransformMatrix");
-        mOutputTransformMatrixLoc = glGetUniformLocation(programId, "outputTransformMatrix");
-        mCornerRadiusLoc = glGetUniformLocation(programId, "cornerRadius");
-        mCropCenterLoc = glGetUniformLocation(programId, "cropCenter");
-
-        // set-up the default values for our uniforms
-        glUseProgram(programId);
-        glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, mat4().asArray());
-        glEnableVertexAttribArray(0);
+        return false;
     }
+    return true;
+}
+
+void Program::initialize(GLuint programId) {
+    mProgram = programId;
+    mInitialized = true;
+    mProjectionMatrixLoc = glGetUniformLocation(programId, "projection");
+    mTextureMatrixLoc = glGetUniformLocation(programId, "texture");
+    mSamplerLoc = glGetUniformLocation(programId, "sampler");
+    mColorLoc = glGetUniformLocation(programId, "color");
+    mDisplayMaxLuminanceLoc = glGetUniformLocation(programId, "displayMaxLuminance");
+    mInputTransformMatrixLoc = glGetUniformLocation(programId, "inputTransformMatrix");
+    mOutputTransformMatrixLoc = glGetUniformLocation(programId, "outputTransformMatrix");
+    mCornerRadiusLoc = glGetUniformLocation(programId, "cornerRadius");
+    mCropCenterLoc = glGetUniformLocation(programId, "cropCenter");
+
+    // set-up the default values for our uniforms
+    glUseProgram(programId);
+    glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, mat4().asArray());
+    glEnableVertexAttribArray(0);
 }
 
 bool Program::isValid() const {
@@ -95,6 +124,22 @@ GLint Program::getUniform(const char* name) const {
     return glGetUniformLocation(mProgram, name);
 }
 
+bool Program::getBinary(GLenum* outBinaryFormat, std::vector<uint8_t>* outBinary) const {
+    GLint length = 0;
+    glGetProgramiv(mProgram, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) {
+        return false;
+    }
+    outBinary->resize(length);
+    GLsizei written = 0;
+    glGetProgramBinaryOES(mProgram, length, &written, outBinaryFormat, outBinary->data());
+    if (written <= 0) {
+        return false;
+    }
+    outBinary->resize(written);
+    return true;
+}
+
 GLuint Program::buildShader(const char* source, GLenum type) {
     GLuint shader = glCreateShader(type);
     glShaderSource(shader, 1, &source, 0);
@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include <GLES2/gl2.h>
 #include <renderengine/private/Description.h>
 #include "ProgramCache.h"
@@ -48,6 +50,9 @@ public:
     };
 
     Program(const ProgramCache::Key& needs, const char* vertex, const char* fragment);
+    /* Loads a program binary previously returned by getBinary, see isValid */
+    Program(const ProgramCache::Key& needs, GLenum binaryFormat, const void* binary,
+            GLsizei length);
     ~Program() = default;
 
     /* whether this object is usable */
@@ -65,8 +70,13 @@ public:
     /* set-up uniforms from the description */
     void setUniforms(const Description& desc);
 
+    /* Retrieves the driver's binary of this program, returns false if there is none */
+    bool getBinary(GLenum* outBinaryFormat, std::vector<uint8_t>* outBinary) const;
+
 private:
     GLuint buildShader(const char* source, GLenum type);
+    bool checkLinkStatus(GLuint programId);
+    void initialize(GLuint programId);
 
     // whether the initialization succeeded
     bool mInitialized;
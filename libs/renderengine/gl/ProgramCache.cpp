@@ -18,12 +18,22 @@
 
 #include "ProgramCache.h"
 
+#include <pthread.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <FileBlobCache.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+#include <cutils/properties.h>
 #include <log/log.h>
 #include <renderengine/private/Description.h>
 #include <utils/String8.h>
 #include <utils/Trace.h>
+#include "GLExtensions.h"
 #include "Program.h"
 
 ANDROID_SINGLETON_STATIC_INSTANCE(android::renderengine::gl::ProgramCache)
@@ -77,7 +87,98 @@ Formatter& dedent(Formatter& f) {
     return f;
 }
 
+// Persistent binary cache. Bump kBinaryCacheVersion when the layout of its entries changes.
+static constexpr const char* kBinaryCacheFile = "/data/misc/surfaceflinger/program_cache.bin";
+static constexpr uint32_t kBinaryCacheVersion = 1;
+static constexpr size_t kBinaryCacheMaxValueSize = 128 * 1024;
+static constexpr size_t kBinaryCacheMaxTotalSize = 2 * 1024 * 1024;
+static constexpr auto kBinaryCacheSaveDelay = std::chrono::seconds(4);
+
+enum : uint32_t {
+    BINARY_CACHE_PROGRAM = 1,
+    BINARY_CACHE_USED_KEYS = 2,
+};
+
+struct BinaryCacheKey {
+    uint32_t type;
+    uint32_t version;
+    uint32_t driverHash;
+    uint32_t key;
+};
+
+struct ProgramBinaryHeader {
+    uint32_t sourceHash;
+    GLenum binaryFormat;
+};
+
+// FNV-1a, which unlike std::hash is stable across builds
+static uint32_t hashString(const char* str, uint32_t hash = 2166136261u) {
+    for (; *str; str++) {
+        hash = (hash ^ static_cast<uint8_t>(*str)) * 16777619u;
+    }
+    return hash;
+}
+
+ProgramCache::ProgramCache() = default;
+
+ProgramCache::~ProgramCache() = default;
+
+void ProgramCache::openBinaryCache() {
+    if (mBinaryCacheEnabled || !property_get_bool("debug.renderengine.program_cache", true) ||
+        !GLExtensions::getInstance().hasProgramBinary()) {
+        return;
+    }
+
+    const GLExtensions& extensions = GLExtensions::getInstance();
+    mDriverHash = hashString(extensions.getVersion(),
+                             hashString(extensions.getRenderer(),
+                                        hashString(extensions.getVendor())));
+
+    std::lock_guard lock(mBinaryCacheMutex);
+    mBinaryCache = std::make_unique<FileBlobCache>(sizeof(BinaryCacheKey),
+                                                   kBinaryCacheMaxValueSize,
+                                                   kBinaryCacheMaxTotalSize, kBinaryCacheFile);
+    mBinaryCacheEnabled = true;
+
+    // The used keys do not depend on the driver
+    const BinaryCacheKey usedKeysKey = {BINARY_CACHE_USED_KEYS, kBinaryCacheVersion, 0, 0};
+    const size_t size = mBinaryCache->get(&usedKeysKey, sizeof(usedKeysKey), nullptr, 0);
+    std::vector<Key::key_t> usedKeys(size / sizeof(Key::key_t));
+    if (!usedKeys.empty() &&
+        mBinaryCache->get(&usedKeysKey, sizeof(usedKeysKey), usedKeys.data(), size) == size) {
+        mUsedKeys.insert(usedKeys.begin(), usedKeys.end());
+    }
+}
+
+void ProgramCache::recordKeyUsed(const Key& key) {
+    if (!mBinaryCacheEnabled || !mUsedKeys.insert(key.mKey).second) {
+        return;
+    }
+
+    const std::vector<Key::key_t> usedKeys(mUsedKeys.begin(), mUsedKeys.end());
+    const BinaryCacheKey usedKeysKey = {BINARY_CACHE_USED_KEYS, kBinaryCacheVersion, 0, 0};
+    std::lock_guard lock(mBinaryCacheMutex);
+    mBinaryCache->set(&usedKeysKey, sizeof(usedKeysKey), usedKeys.data(),
+                      usedKeys.size() * sizeof(Key::key_t));
+    scheduleBinaryCacheSaveLocked();
+}
+
+void ProgramCache::scheduleBinaryCacheSaveLocked() {
+    if (mBinaryCacheSavePending) {
+        return;
+    }
+    mBinaryCacheSavePending = true;
+    std::thread([this]() {
+        std::this_thread::sleep_for(kBinaryCacheSaveDelay);
+        std::lock_guard lock(mBinaryCacheMutex);
+        mBinaryCache->writeToFile();
+        mBinaryCacheSavePending = false;
+    }).detach();
+}
+
 void ProgramCache::primeCache(EGLContext context, bool useColorManagement) {
+    openBinaryCache();
+
     auto& cache = mCaches[context];
     uint32_t shaderCount = 0;
     uint32_t keyMask = Key::BLEND_MASK | Key::OPACITY_MASK | Key::ALPHA_MASK | Key::TEXTURE_MASK
@@ -124,6 +225,16 @@ void ProgramCache::primeCache(EGLContext context, bool useColorManagement) {
         }
     }
 
+    // Prime the keys that earlier boots used
+    for (const Key::key_t keyVal : mUsedKeys) {
+        Key shaderKey;
+        shaderKey.set(~Key::key_t(0), keyVal);
+        if (cache.count(shaderKey) == 0) {
+            cache.emplace(shaderKey, generateProgram(shaderKey));
+            shaderCount++;
+        }
+    }
+
     nsecs_t timeAfter = systemTime();
     float compileTimeMs = static_cast<float>(timeAfter - timeBefore) / 1.0E6;
     ALOGD("shader cache generated - %u shaders in %f ms\n", shaderCount, compileTimeMs);
@@ -704,7 +815,51 @@ std::unique_ptr<Program> ProgramCache::generateProgram(const Key& needs) {
     // fragment shader
     String8 fs = generateFragmentShader(needs);
 
-    return std::make_unique<Program>(needs, vs.string(), fs.string());
+    if (!mBinaryCacheEnabled) {
+        return std::make_unique<Program>(needs, vs.string(), fs.string());
+    }
+
+    const uint32_t sourceHash = hashString(fs.string(), hashString(vs.string()));
+    const BinaryCacheKey binaryKey = {BINARY_CACHE_PROGRAM, kBinaryCacheVersion, mDriverHash,
+                                      needs.mKey};
+
+    // The lock is only held to access the cache, as programs may be built on two threads
+    std::vector<uint8_t> value;
+    {
+        std::lock_guard lock(mBinaryCacheMutex);
+        const size_t size = mBinaryCache->get(&binaryKey, sizeof(binaryKey), nullptr, 0);
+        value.resize(size);
+        if (size <= sizeof(ProgramBinaryHeader) ||
+            mBinaryCache->get(&binaryKey, sizeof(binaryKey), value.data(), size) != size) {
+            value.clear();
+        }
+    }
+    if (!value.empty()) {
+        ProgramBinaryHeader header;
+        memcpy(&header, value.data(), sizeof(header));
+        if (header.sourceHash == sourceHash) {
+            auto program = std::make_unique<Program>(needs, header.binaryFormat,
+                                                     value.data() + sizeof(header),
+                                                     static_cast<GLsizei>(value.size() -
+                                                                          sizeof(header)));
+            if (program->isValid()) {
+                return program;
+            }
+        }
+    }
+
+    auto program = std::make_unique<Program>(needs, vs.string(), fs.string());
+    ProgramBinaryHeader header = {sourceHash, 0};
+    std::vector<uint8_t> binary;
+    if (program->isValid() && program->getBinary(&header.binaryFormat, &binary)) {
+        value.resize(sizeof(header) + binary.size());
+        memcpy(value.data(), &header, sizeof(header));
+        memcpy(value.data() + sizeof(header), binary.data(), binary.size());
+        std::lock_guard lock(mBinaryCacheMutex);
+        mBinaryCache->set(&binaryKey, sizeof(binaryKey), value.data(), value.size());
+        scheduleBinaryCacheSaveLocked();
+    }
+    return program;
 }
 
 void ProgramCache::useProgram(EGLContext context, const Description& description) {
@@ -713,7 +868,23 @@ void ProgramCache::useProgram(EGLContext context, const Description& description
 
     // look-up the program in the cache
     auto& cache = mCaches[context];
+    const bool async = context == mAsyncContext && context != EGL_NO_CONTEXT;
+    if (async && mHasCompiledPrograms) {
+        adoptCompiledPrograms(cache);
+    }
     auto it = cache.find(needs);
+    if (it == cache.end() && async && !needs.isY410BT2020()) {
+        // draw with a primed program while the right one is compiled
+        auto fallback = cache.find(computeFallbackKey(needs));
+        if (fallback != cache.end()) {
+            std::lock_guard lock(mCompileMutex);
+            if (mPendingKeys.insert(needs.mKey).second) {
+                mCompileQueue.push_back(needs);
+                mCompileCondition.notify_one();
+            }
+            it = fallback;
+        }
+    }
     if (it == cache.end()) {
         // we didn't find our program, so generate one...
         nsecs_t time = systemTime();
@@ -722,6 +893,7 @@ void ProgramCache::useProgram(EGLContext context, const Description& description
 
         ALOGV(">>> generated new program for context %p: needs=%08X, time=%u ms (%zu programs)",
               context, needs.mKey, uint32_t(ns2ms(time)), cache.size());
+        recordKeyUsed(needs);
     }
 
     // here we have a suitable program for this description
@@ -732,6 +904,108 @@ void ProgramCache::useProgram(EGLContext context, const Description& description
     }
 }
 
+ProgramCache::Key ProgramCache::computeFallbackKey(const Key& needs) {
+    // Every combination of these is primed
+    const Key::key_t mask = Key::BLEND_MASK | Key::OPACITY_MASK | Key::ALPHA_MASK |
+            Key::TEXTURE_MASK | Key::ROUNDED_CORNERS_MASK;
+    Key fallback;
+    fallback.set(mask, needs.mKey & mask);
+    return fallback;
+}
+
+void ProgramCache::adoptCompiledPrograms(
+        std::unordered_map<Key, std::unique_ptr<Program>, Key::Hash>& cache) {
+    std::vector<std::pair<Key, std::unique_ptr<Program>>> compiled;
+    {
+        std::lock_guard lock(mCompileMutex);
+        compiled.swap(mCompiledPrograms);
+        for (const auto& [key, program] : compiled) {
+            mPendingKeys.erase(key.mKey);
+        }
+        mHasCompiledPrograms = false;
+    }
+    for (auto& [key, program] : compiled) {
+        ALOGV(">>> adopted program compiled in the background: needs=%08X", key.mKey);
+        cache.emplace(key, std::move(program));
+        recordKeyUsed(key);
+    }
+}
+
+void ProgramCache::startAsyncCompile(EGLDisplay display, EGLContext mainContext,
+                                     EGLContext compileContext, EGLSurface compileSurface) {
+    LOG_ALWAYS_FATAL_IF(mCompileThread.joinable(), "ProgramCache is already compiling");
+    {
+        std::lock_guard lock(mCompileMutex);
+        mStopCompile = false;
+    }
+    mAsyncContext = mainContext;
+    mCompileThread = std::thread(&ProgramCache::compileLoop, this, display, compileContext,
+                                 compileSurface);
+    pthread_setname_np(mCompileThread.native_handle(), "RenderEngineCompile");
+}
+
+void ProgramCache::stopAsyncCompile() {
+    if (!mCompileThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard lock(mCompileMutex);
+        mStopCompile = true;
+        mCompileQueue.clear();
+    }
+    mCompileCondition.notify_one();
+    mCompileThread.join();
+
+    std::lock_guard lock(mCompileMutex);
+    mPendingKeys.clear();
+    mCompiledPrograms.clear();
+    mHasCompiledPrograms = false;
+    mAsyncContext = EGL_NO_CONTEXT;
+}
+
+void ProgramCache::setProgramCompiledCallback(std::function<void()> callback) {
+    std::lock_guard lock(mCompileMutex);
+    mProgramCompiledCallback = std::move(callback);
+}
+
+void ProgramCache::compileLoop(EGLDisplay display, EGLContext compileContext,
+                               EGLSurface compileSurface) {
+    if (!eglMakeCurrent(display, compileSurface, compileSurface, compileContext)) {
+        ALOGE("Can't make shader compile context current");
+        return;
+    }
+
+    std::unique_lock lock(mCompileMutex);
+    while (true) {
+        mCompileCondition.wait(lock, [this]() REQUIRES(mCompileMutex) {
+            return mStopCompile || !mCompileQueue.empty();
+        });
+        if (mStopCompile) {
+            break;
+        }
+        const Key needs = mCompileQueue.front();
+        mCompileQueue.pop_front();
+        lock.unlock();
+
+        ATRACE_NAME("ProgramCache::compileAsync");
+        std::unique_ptr<Program> program = generateProgram(needs);
+        // make sure the program is complete before the main context uses it
+        glFinish();
+
+        lock.lock();
+        mCompiledPrograms.emplace_back(needs, std::move(program));
+        mHasCompiledPrograms = true;
+        if (mProgramCompiledCallback) {
+            const std::function<void()> callback = mProgramCompiledCallback;
+            lock.unlock();
+            callback();
+            lock.lock();
+        }
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
 } // namespace gl
 } // namespace renderengine
 } // namespace android
@@ -17,17 +17,27 @@
 #ifndef SF_RENDER_ENGINE_PROGRAMCACHE_H
 #define SF_RENDER_ENGINE_PROGRAMCACHE_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
+#include <android-base/thread_annotations.h>
 #include <renderengine/private/Description.h>
 #include <utils/Singleton.h>
 #include <utils/TypeHelpers.h>
 
 namespace android {
 
+class FileBlobCache;
 class String8;
 
 namespace renderengine {
@@ -175,10 +185,11 @@ public:
         };
     };
 
-    ProgramCache() = default;
-    ~ProgramCache() = default;
+    ProgramCache();
+    ~ProgramCache();
 
-    // Generate shaders to populate the cache
+    // Generate shaders to populate the cache. Besides a fixed set of keys, this primes the keys
+    // earlier boots used, and loads programs from the persistent binary cache when possible.
     void primeCache(const EGLContext context, bool useColorManagement);
 
     size_t getSize(const EGLContext context) { return mCaches[context].size(); }
@@ -187,6 +198,16 @@ public:
     // if none can be found.
     void useProgram(const EGLContext context, const Description& description);
 
+    // Compiles programs that miss the cache of mainContext on a background thread, using
+    // compileContext, which must share objects with mainContext. Until such a program is ready,
+    // draws use the primed program with the same blending, texturing and rounded corners, which
+    // skips color space conversion, tone mapping and color transforms.
+    void startAsyncCompile(EGLDisplay display, EGLContext mainContext, EGLContext compileContext,
+                           EGLSurface compileSurface);
+    void stopAsyncCompile();
+    // Invoked on the compile thread whenever a program compiled in the background is ready.
+    void setProgramCompiledCallback(std::function<void()> callback);
+
 private:
     // compute a cache Key from a Description
     static Key computeKey(const Description& description);
@@ -198,17 +219,54 @@ private:
     static void generateOOTF(Formatter& fs, const Key& needs);
     // Generate OETF based from Key.
     static void generateOETF(Formatter& fs, const Key& needs);
-    // generates a program from the Key
-    static std::unique_ptr<Program> generateProgram(const Key& needs);
+    // generates a program from the Key, or loads it from the persistent binary cache
+    std::unique_ptr<Program> generateProgram(const Key& needs);
     // generates the vertex shader from the Key
     static String8 generateVertexShader(const Key& needs);
     // generates the fragment shader from the Key
     static String8 generateFragmentShader(const Key& needs);
 
+    // Opens the persistent binary cache and loads the keys used by earlier boots
+    void openBinaryCache();
+    // Records that a program for key was used, so later boots prime it
+    void recordKeyUsed(const Key& key);
+    // Writes the binary cache to disk after a delay, batching consecutive updates
+    void scheduleBinaryCacheSaveLocked() REQUIRES(mBinaryCacheMutex);
+    // Returns the key of the primed program to draw with while needs is compiled
+    static Key computeFallbackKey(const Key& needs);
+    // Moves programs compiled in the background into the cache of the main context
+    void adoptCompiledPrograms(std::unordered_map<Key, std::unique_ptr<Program>, Key::Hash>& cache);
+    void compileLoop(EGLDisplay display, EGLContext compileContext, EGLSurface compileSurface);
+
     // Key/Value map used for caching Programs. Currently the cache
     // is never shrunk (and the GL program objects are never deleted).
     std::unordered_map<EGLContext, std::unordered_map<Key, std::unique_ptr<Program>, Key::Hash>>
             mCaches;
+
+    // Program binaries and used keys, persisted across boots. Binaries are keyed by the driver
+    // that produced them and checked against the shader source they were built from, so driver
+    // and RenderEngine updates only cost a recompile.
+    std::mutex mBinaryCacheMutex;
+    std::unique_ptr<FileBlobCache> mBinaryCache GUARDED_BY(mBinaryCacheMutex);
+    bool mBinaryCacheSavePending GUARDED_BY(mBinaryCacheMutex) = false;
+    bool mBinaryCacheEnabled = false;
+    uint32_t mDriverHash = 0;
+    // Keys used in this boot or by earlier ones. Only tracked while the binary cache is enabled.
+    std::unordered_set<Key::key_t> mUsedKeys;
+
+    // Background compilation, see startAsyncCompile
+    EGLContext mAsyncContext = EGL_NO_CONTEXT;
+    std::thread mCompileThread;
+    std::mutex mCompileMutex;
+    std::condition_variable mCompileCondition;
+    bool mStopCompile GUARDED_BY(mCompileMutex) = false;
+    // Keys queued or being compiled, and not adopted yet
+    std::unordered_set<Key::key_t> mPendingKeys GUARDED_BY(mCompileMutex);
+    std::deque<Key> mCompileQueue GUARDED_BY(mCompileMutex);
+    std::vector<std::pair<Key, std::unique_ptr<Program>>> mCompiledPrograms
+            GUARDED_BY(mCompileMutex);
+    std::atomic<bool> mHasCompiledPrograms{false};
+    std::function<void()> mProgramCompiledCallback GUARDED_BY(mCompileMutex);
 };
 
 } // namespace gl
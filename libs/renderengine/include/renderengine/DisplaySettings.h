@@ -60,6 +60,12 @@ struct DisplaySettings {
 
     // The orientation of the physical display.
     uint32_t orientation = ui::Transform::ROT_0;
+
+    // Rectangle of the output buffer, in the same space as physicalDisplay,
+    // that needs to be redrawn. When valid, the rest of the buffer is assumed
+    // to hold up to date contents, and clearing and drawing are restricted to
+    // this rectangle.
+    Rect damage = Rect::INVALID_RECT;
 };
 
 } // namespace renderengine
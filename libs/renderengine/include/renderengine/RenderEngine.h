@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <functional>
 #include <memory>
 
 #include <android-base/unique_fd.h>
@@ -172,6 +173,11 @@ public:
     virtual bool supportsProtectedContent() const = 0;
     virtual bool useProtectedContext(bool useProtectedContext) = 0;
 
+    // Shader programs that miss the program cache may be compiled in the background, drawing
+    // with a simpler fallback program until they are ready. The callback is invoked, on an
+    // arbitrary thread, whenever such a program becomes ready, so the client can redraw.
+    virtual void setProgramCompiledCallback(std::function<void()> callback) = 0;
+
     // Renders layers for a particular display via GPU composition. This method
     // should be called for every display that needs to be rendered via the GPU.
     // @param display The display-wide settings that should be applied prior to
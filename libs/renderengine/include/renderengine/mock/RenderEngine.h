@@ -79,6 +79,7 @@ public:
     MOCK_CONST_METHOD0(isProtected, bool());
     MOCK_CONST_METHOD0(supportsProtectedContent, bool());
     MOCK_METHOD1(useProtectedContext, bool(bool));
+    MOCK_METHOD1(setProgramCompiledCallback, void(std::function<void()>));
     MOCK_METHOD6(drawLayers,
                  status_t(const DisplaySettings&, const std::vector<LayerSettings>&,
                           ANativeWindowBuffer*, const bool, base::unique_fd&&, base::unique_fd*));
@@ -986,6 +986,71 @@ TEST_F(RenderEngineTest, drawLayers_clearRegion) {
     clearRegion();
 }
 
+TEST_F(RenderEngineTest, drawLayers_batchesIdenticalSolidColorLayersInOrder) {
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    // Here logical space is 2x2
+    settings.clip = Rect(2, 2);
+
+    std::vector<renderengine::LayerSettings> layers;
+
+    // Two translucent red layers covering the left half, blended over each
+    // other, then a translated copy covering the top right quadrant.
+    renderengine::LayerSettings layer;
+    layer.geometry.boundaries = Rect(0, 0, 1, 2).toFloatRect();
+    ColorSourceVariant::fillColor(layer, 1.0f, 0.0f, 0.0f, this);
+    layer.alpha = 0.5f;
+    layers.push_back(layer);
+    layers.push_back(layer);
+
+    layer.geometry.boundaries = Rect(0, 0, 1, 1).toFloatRect();
+    layer.geometry.positionTransform = mat4::translate(vec4(1.0f, 0.0f, 0.0f, 1.0f));
+    layers.push_back(layer);
+
+    invokeDraw(settings, layers, mBuffer);
+
+    expectBufferColor(Rect(0, 0, DEFAULT_DISPLAY_WIDTH / 2, DEFAULT_DISPLAY_HEIGHT), 191, 0, 0,
+                      191, 1);
+    expectBufferColor(Rect(DEFAULT_DISPLAY_WIDTH / 2, 0, DEFAULT_DISPLAY_WIDTH,
+                           DEFAULT_DISPLAY_HEIGHT / 2),
+                      128, 0, 0, 128, 1);
+    expectBufferColor(Rect(DEFAULT_DISPLAY_WIDTH / 2, DEFAULT_DISPLAY_HEIGHT / 2,
+                           DEFAULT_DISPLAY_WIDTH, DEFAULT_DISPLAY_HEIGHT),
+                      0, 0, 0, 0);
+}
+
+TEST_F(RenderEngineTest, drawLayers_damageOnlyRedrawsDamagedArea) {
+    fillRedBuffer<ColorSourceVariant>();
+
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+    settings.damage = Rect(DEFAULT_DISPLAY_WIDTH / 2, DEFAULT_DISPLAY_HEIGHT);
+
+    std::vector<renderengine::LayerSettings> layers;
+
+    renderengine::LayerSettings layer;
+    layer.geometry.boundaries = fullscreenRect().toFloatRect();
+    layer.geometry.roundedCornersRadius = 5.0f;
+    layer.geometry.roundedCornersCrop = fullscreenRect().toFloatRect();
+    ColorSourceVariant::fillColor(layer, 0.0f, 0.0f, 1.0f, this);
+    layer.alpha = 1.0f;
+
+    layers.push_back(layer);
+
+    invokeDraw(settings, layers, mBuffer);
+
+    // Inside the damage, the rounded corner is cleared and the rest is redrawn.
+    expectBufferColor(Rect(0, 0, 1, 1), 0, 0, 0, 0);
+    expectBufferColor(Rect(5, 5, DEFAULT_DISPLAY_WIDTH / 2, DEFAULT_DISPLAY_HEIGHT - 5), 0, 0,
+                      255, 255);
+    // Outside of it, the previous contents are preserved, even where the
+    // rounded corners are drawn.
+    expectBufferColor(Rect(DEFAULT_DISPLAY_WIDTH / 2, 0, DEFAULT_DISPLAY_WIDTH,
+                           DEFAULT_DISPLAY_HEIGHT),
+                      255, 0, 0, 255);
+}
+
 TEST_F(RenderEngineTest, drawLayers_fillsBufferAndCachesImages) {
     renderengine::DisplaySettings settings;
     settings.physicalDisplay = fullscreenRect();
@@ -1037,4 +1102,27 @@ TEST_F(RenderEngineTest, drawLayers_cacheExternalBufferCachesImages) {
     EXPECT_FALSE(sRE->isImageCachedForTesting(bufferId));
 }
 
+TEST_F(RenderEngineTest, drawLayers_cacheExternalBufferEvictsLeastRecentlyUsed) {
+    sp<GraphicBuffer> first = allocateSourceBuffer(1, 1);
+    sp<GraphicBuffer> second = allocateSourceBuffer(1, 1);
+    sp<GraphicBuffer> third = allocateSourceBuffer(1, 1);
+    // Room for exactly two of these images.
+    const size_t oldBudget = sRE->setImageCacheBudgetForTesting(
+            2 * first->getStride() * first->getHeight() * 4);
+
+    sRE->cacheExternalTextureBuffer(first);
+    sRE->cacheExternalTextureBuffer(second);
+    // Touch the first buffer so that the second one becomes least recently used.
+    sRE->cacheExternalTextureBuffer(first);
+    sRE->cacheExternalTextureBuffer(third);
+
+    EXPECT_TRUE(sRE->isImageCachedForTesting(first->getId()));
+    EXPECT_FALSE(sRE->isImageCachedForTesting(second->getId()));
+    EXPECT_TRUE(sRE->isImageCachedForTesting(third->getId()));
+
+    sRE->setImageCacheBudgetForTesting(oldBudget);
+    sRE->unbindExternalTextureBuffer(first->getId());
+    sRE->unbindExternalTextureBuffer(third->getId());
+}
+
 } // namespace android
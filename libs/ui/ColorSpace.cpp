@@ -16,6 +16,10 @@
 
 #include <ui/ColorSpace.h>
 
+#include <list>
+#include <mutex>
+#include <vector>
+
 using namespace std::placeholders;
 
 namespace android {
@@ -360,11 +364,29 @@ std::unique_ptr<float3[]> ColorSpace::createLUT(uint32_t size, const ColorSpace&
     float3* data = lut.get();
 
     ColorSpaceConnector connector(src, dst);
+    const mat3& transform = connector.getTransform();
+
+    // Every component of the input takes one of only size values, so decode
+    // them once and apply the matrix per column. Only the destination's
+    // transfer function is left to evaluate for each entry.
+    std::vector<float3> r(size);
+    std::vector<float3> g(size);
+    std::vector<float3> b(size);
+    for (uint32_t i = 0; i < size; i++) {
+        float linear = src.getEOTF()(src.getClamper()(i * m));
+        r[i] = transform[0] * linear;
+        g[i] = transform[1] * linear;
+        b[i] = transform[2] * linear;
+    }
 
+    const transfer_function& OETF = dst.getOETF();
+    const clamping_function& clamper = dst.getClamper();
     for (uint32_t z = 0; z < size; z++) {
         for (int32_t y = int32_t(size - 1); y >= 0; y--) {
             for (uint32_t x = 0; x < size; x++) {
-                *data++ = connector.transform({x * m, y * m, z * m});
+                // Summed in the same order as mat3 * float3
+                float3 v = r[x] + g[y] + b[z];
+                *data++ = {clamper(OETF(v.r)), clamper(OETF(v.g)), clamper(OETF(v.b))};
             }
         }
     }
@@ -372,6 +394,62 @@ std::unique_ptr<float3[]> ColorSpace::createLUT(uint32_t size, const ColorSpace&
     return lut;
 }
 
+namespace {
+
+struct CachedLUT {
+    uint32_t size;
+    std::string srcName;
+    std::string dstName;
+    mat3 srcRGBtoXYZ;
+    mat3 dstRGBtoXYZ;
+    ColorSpace::TransferParameters srcParameters;
+    ColorSpace::TransferParameters dstParameters;
+    std::shared_ptr<const float3> lut;
+};
+
+bool operator==(const ColorSpace::TransferParameters& lhs,
+                const ColorSpace::TransferParameters& rhs) {
+    return lhs.g == rhs.g && lhs.a == rhs.a && lhs.b == rhs.b && lhs.c == rhs.c &&
+            lhs.d == rhs.d && lhs.e == rhs.e && lhs.f == rhs.f;
+}
+
+// A 256^3 LUT takes 192MB, so keep only a handful.
+constexpr size_t kMaxCachedLUTs = 4;
+
+std::mutex gLUTCacheLock;
+// Most recently used first
+std::list<CachedLUT> gLUTCache;
+
+} // namespace
+
+std::shared_ptr<const float3> ColorSpace::getLUT(uint32_t size, const ColorSpace& src,
+                                                 const ColorSpace& dst) {
+    size = clamp(size, 2u, 256u);
+
+    std::lock_guard<std::mutex> lock(gLUTCacheLock);
+    for (auto it = gLUTCache.begin(); it != gLUTCache.end(); ++it) {
+        if (it->size == size && it->srcName == src.getName() && it->dstName == dst.getName() &&
+                it->srcRGBtoXYZ == src.getRGBtoXYZ() && it->dstRGBtoXYZ == dst.getRGBtoXYZ() &&
+                it->srcParameters == src.getTransferParameters() &&
+                it->dstParameters == dst.getTransferParameters()) {
+            gLUTCache.splice(gLUTCache.begin(), gLUTCache, it);
+            return it->lut;
+        }
+    }
+
+    // Generated under the lock, so that concurrent callers asking for
+    // the same LUT don't each generate it.
+    std::shared_ptr<const float3> lut(createLUT(size, src, dst).release(),
+                                      std::default_delete<float3[]>());
+    gLUTCache.push_front({size, src.getName(), dst.getName(), src.getRGBtoXYZ(),
+                          dst.getRGBtoXYZ(), src.getTransferParameters(),
+                          dst.getTransferParameters(), lut});
+    if (gLUTCache.size() > kMaxCachedLUTs) {
+        gLUTCache.pop_back();
+    }
+    return lut;
+}
+
 static const float2 ILLUMINANT_D50_XY = {0.34567f, 0.35850f};
 static const float3 ILLUMINANT_D50_XYZ = {0.964212f, 1.0f, 0.825188f};
 static const mat3 BRADFORD = mat3{
@@ -413,4 +491,18 @@ ColorSpaceConnector::ColorSpaceConnector(
     }
 }
 
+void ColorSpaceConnector::transform(const float3* in, float3* out, size_t count) const noexcept {
+    const ColorSpace::clamping_function& srcClamper = mSource.getClamper();
+    const ColorSpace::transfer_function& EOTF = mSource.getEOTF();
+    const ColorSpace::transfer_function& OETF = mDestination.getOETF();
+    const ColorSpace::clamping_function& dstClamper = mDestination.getClamper();
+    for (size_t i = 0; i < count; i++) {
+        const float3& v = in[i];
+        float3 linear = mTransform *
+                float3{EOTF(srcClamper(v.r)), EOTF(srcClamper(v.g)), EOTF(srcClamper(v.b))};
+        out[i] = {dstClamper(OETF(linear.r)), dstClamper(OETF(linear.g)),
+                  dstClamper(OETF(linear.b))};
+    }
+}
+
 }; // namespace android
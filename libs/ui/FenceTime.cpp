@@ -20,10 +20,17 @@
 
 #include <cutils/compiler.h>  // For CC_[UN]LIKELY
 #include <utils/Log.h>
+#include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include <memory>
+#include <thread>
 
 namespace android {
 
@@ -260,6 +267,9 @@ status_t FenceTime::Snapshot::unflatten(
 // FenceTimeline
 // ============================================================================
 void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
+    const bool resolvedInBackground =
+            FenceResolver::isEnabled() && FenceResolver::getInstance().track(fence);
+
     std::lock_guard<std::mutex> lock(mMutex);
     while (mQueue.size() >= MAX_ENTRIES) {
         // This is a sanity check to make sure the queue doesn't grow unbounded.
@@ -267,7 +277,7 @@ void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
         // In case this path is taken though, users of FenceTime must make sure
         // not to rely solely on FenceTimeline to get the final timestamp and
         // should eventually call Fence::getSignalTime on their own.
-        std::shared_ptr<FenceTime> front = mQueue.front().lock();
+        std::shared_ptr<FenceTime> front = mQueue.front().fence.lock();
         if (front) {
             // Make a last ditch effort to get the signalTime here since
             // we are removing it from the timeline.
@@ -275,19 +285,23 @@ void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
         }
         mQueue.pop();
     }
-    mQueue.push(fence);
+    mQueue.push({fence, resolvedInBackground});
 }
 
 void FenceTimeline::updateSignalTimes() {
     std::lock_guard<std::mutex> lock(mMutex);
     while (!mQueue.empty()) {
-        std::shared_ptr<FenceTime> fence = mQueue.front().lock();
+        const Entry& entry = mQueue.front();
+        std::shared_ptr<FenceTime> fence = entry.fence.lock();
         if (!fence) {
             // The shared_ptr no longer exists and no one cares about the
             // timestamp anymore.
             mQueue.pop();
             continue;
-        } else if (fence->getSignalTime() != Fence::SIGNAL_TIME_PENDING) {
+        }
+        const nsecs_t signalTime = entry.resolvedInBackground ?
+                fence->getCachedSignalTime() : fence->getSignalTime();
+        if (signalTime != Fence::SIGNAL_TIME_PENDING) {
             // The fence has signaled and we've removed the sp<Fence> ref.
             mQueue.pop();
             continue;
@@ -299,6 +313,119 @@ void FenceTimeline::updateSignalTimes() {
     }
 }
 
+// ============================================================================
+// FenceResolver
+// ============================================================================
+
+// How often the resolver looks for fences nobody cares about any more while
+// none of them are signaling.
+static constexpr int kExpiredCheckIntervalMs = 1000;
+
+std::atomic_bool FenceResolver::sEnabled(false);
+
+void FenceResolver::enable() {
+    getInstance();
+    sEnabled.store(true);
+}
+
+bool FenceResolver::isEnabled() {
+    return sEnabled.load(std::memory_order_relaxed);
+}
+
+FenceResolver& FenceResolver::getInstance() {
+    // Never destroyed, so the thread can keep running at exit.
+    static FenceResolver* sInstance = new FenceResolver;
+    return *sInstance;
+}
+
+FenceResolver::FenceResolver() : mWakeFd(eventfd(0, EFD_CLOEXEC)) {
+    if (mWakeFd < 0) {
+        ALOGE("Could not create eventfd: %s", strerror(errno));
+        return;
+    }
+    std::thread(&FenceResolver::threadMain, this).detach();
+}
+
+bool FenceResolver::track(const std::shared_ptr<FenceTime>& fence) {
+    if (mWakeFd < 0) {
+        return false;
+    }
+    FenceTime::Snapshot snapshot = fence->getSnapshot();
+    if (snapshot.state != FenceTime::Snapshot::State::FENCE || !snapshot.fence->isValid()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mTracked >= MAX_ENTRIES) {
+        return false;
+    }
+    mTracked++;
+    mIncoming.push_back({fence, std::move(snapshot.fence)});
+    if (mIncoming.size() == 1) {
+        const uint64_t one = 1;
+        write(mWakeFd, &one, sizeof(one));
+    }
+    return true;
+}
+
+void FenceResolver::threadMain() {
+    pthread_setname_np(pthread_self(), "FenceResolver");
+
+    std::vector<Entry> entries;
+    std::vector<struct pollfd> fds;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (Entry& entry : mIncoming) {
+                entries.push_back(std::move(entry));
+            }
+            mIncoming.clear();
+        }
+
+        fds.resize(entries.size() + 1);
+        fds[0] = {mWakeFd, POLLIN, 0};
+        for (size_t i = 0; i < entries.size(); i++) {
+            fds[i + 1] = {entries[i].fence->get(), POLLIN, 0};
+        }
+        if (poll(fds.data(), fds.size(), entries.empty() ? -1 : kExpiredCheckIntervalMs) < 0) {
+            if (errno != EINTR) {
+                ALOGE("poll failed: %s", strerror(errno));
+            }
+            continue;
+        }
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            read(mWakeFd, &count, sizeof(count));
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            std::shared_ptr<FenceTime> fenceTime = entries[i].fenceTime.lock();
+            bool done = !fenceTime ||
+                    fenceTime->getCachedSignalTime() != Fence::SIGNAL_TIME_PENDING;
+            if (!done && fds[i + 1].revents != 0) {
+                // A fence polls readable once it has signaled or errored, so
+                // this is the only time its signal time is asked for. An
+                // errored fence stays pending, as it does for anyone who asks,
+                // and polling it again would spin, so it is dropped either way.
+                fenceTime->getSignalTime();
+                done = true;
+            }
+            if (!done) {
+                if (kept != i) {
+                    entries[kept] = std::move(entries[i]);
+                }
+                kept++;
+            }
+        }
+        if (kept != entries.size()) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTracked -= entries.size() - kept;
+        }
+        entries.resize(kept);
+    }
+}
+
 // ============================================================================
 // FenceToFenceTimeMap
 // ============================================================================
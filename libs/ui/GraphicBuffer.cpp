@@ -203,24 +203,60 @@ status_t GraphicBuffer::initWithSize(uint32_t inWidth, uint32_t inHeight,
         std::string requestorName)
 {
     GraphicBufferAllocator& allocator = GraphicBufferAllocator::get();
+    buffer_handle_t outHandle = nullptr;
     uint32_t outStride = 0;
     status_t err = allocator.allocate(inWidth, inHeight, inFormat, inLayerCount,
-            inUsage, &handle, &outStride, mId,
+            inUsage, &outHandle, &outStride, mId,
             std::move(requestorName));
     if (err == NO_ERROR) {
-        mBufferMapper.getTransportSize(handle, &mTransportNumFds, &mTransportNumInts);
-
-        width = static_cast<int>(inWidth);
-        height = static_cast<int>(inHeight);
-        format = inFormat;
-        layerCount = inLayerCount;
-        usage = inUsage;
-        usage_deprecated = int(usage);
-        stride = static_cast<int>(outStride);
+        initWithAllocatedHandle(outHandle, inWidth, inHeight, inFormat, inLayerCount, inUsage,
+                                outStride);
     }
     return err;
 }
 
+void GraphicBuffer::initWithAllocatedHandle(buffer_handle_t inHandle, uint32_t inWidth,
+        uint32_t inHeight, PixelFormat inFormat, uint32_t inLayerCount, uint64_t inUsage,
+        uint32_t inStride)
+{
+    handle = inHandle;
+    mBufferMapper.getTransportSize(handle, &mTransportNumFds, &mTransportNumInts);
+
+    width = static_cast<int>(inWidth);
+    height = static_cast<int>(inHeight);
+    format = inFormat;
+    layerCount = inLayerCount;
+    usage = inUsage;
+    usage_deprecated = int(usage);
+    stride = static_cast<int>(inStride);
+}
+
+status_t GraphicBuffer::allocateMany(uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
+        uint32_t inLayerCount, uint64_t inUsage, uint32_t count, std::string requestorName,
+        std::vector<sp<GraphicBuffer>>* outBuffers)
+{
+    outBuffers->clear();
+
+    std::vector<buffer_handle_t> handles(count);
+    std::vector<uint32_t> strides(count);
+    status_t err = GraphicBufferAllocator::get().allocateMany(inWidth, inHeight, inFormat,
+            inLayerCount, inUsage, count, handles.data(), strides.data(),
+            std::move(requestorName));
+    if (err != NO_ERROR) {
+        return err;
+    }
+
+    outBuffers->reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        // Owns its data, like a buffer made by the allocating constructor
+        sp<GraphicBuffer> buffer(new GraphicBuffer());
+        buffer->initWithAllocatedHandle(handles[i], inWidth, inHeight, inFormat, inLayerCount,
+                                        inUsage, strides[i]);
+        outBuffers->push_back(std::move(buffer));
+    }
+    return NO_ERROR;
+}
+
 status_t GraphicBuffer::initWithHandle(const native_handle_t* inHandle, HandleWrapMethod method,
                                        uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
                                        uint32_t inLayerCount, uint64_t inUsage, uint32_t inStride) {
@@ -538,8 +574,10 @@ status_t GraphicBuffer::unflatten(void const*& buffer, size_t& size, int const*&
 
     if (handle != nullptr) {
         buffer_handle_t importedHandle;
+        // A buffer that comes back, e.g. detached and attached again, shares
+        // the import it had last time, if that is still alive.
         status_t err = mBufferMapper.importBuffer(handle, uint32_t(width), uint32_t(height),
-                uint32_t(layerCount), format, usage, uint32_t(stride), &importedHandle);
+                uint32_t(layerCount), format, usage, uint32_t(stride), mId, &importedHandle);
         if (err != NO_ERROR) {
             width = height = stride = format = usage_deprecated = 0;
             layerCount = 0;
@@ -20,8 +20,11 @@
 
 #include <ui/GraphicBufferAllocator.h>
 
+#include <pthread.h>
 #include <stdio.h>
 
+#include <thread>
+
 #include <grallocusage/GrallocUsageConversion.h>
 
 #include <android-base/stringprintf.h>
@@ -44,6 +47,9 @@ ANDROID_SINGLETON_STATIC_INSTANCE( GraphicBufferAllocator )
 Mutex GraphicBufferAllocator::sLock;
 KeyedVector<buffer_handle_t,
     GraphicBufferAllocator::alloc_rec_t> GraphicBufferAllocator::sAllocList;
+std::list<GraphicBufferAllocator::pooled_buffer_t> GraphicBufferAllocator::sPool;
+size_t GraphicBufferAllocator::sPoolBytes = 0;
+size_t GraphicBufferAllocator::sPoolBudget = 0;
 
 GraphicBufferAllocator::GraphicBufferAllocator() : mMapper(GraphicBufferMapper::getInstance()) {
     mAllocator = std::make_unique<const Gralloc3Allocator>(
@@ -66,7 +72,7 @@ size_t GraphicBufferAllocator::getTotalSize() const {
     for (size_t i = 0; i < sAllocList.size(); ++i) {
         total += sAllocList.valueAt(i).size;
     }
-    return total;
+    return total + sPoolBytes;
 }
 
 void GraphicBufferAllocator::dump(std::string& result) const {
@@ -91,6 +97,8 @@ void GraphicBufferAllocator::dump(std::string& result) const {
         total += rec.size;
     }
     StringAppendF(&result, "Total allocated (estimate): %.2f KB\n", total / 1024.0);
+    StringAppendF(&result, "Pooled: %zu buffers, %.2f KB of %.2f KB\n", sPool.size(),
+                  sPoolBytes / 1024.0, sPoolBudget / 1024.0);
 
     result.append(mAllocator->dumpDebugInfo());
 }
@@ -118,23 +126,20 @@ status_t GraphicBufferAllocator::allocate(uint32_t width, uint32_t height,
     if (layerCount < 1)
         layerCount = 1;
 
+    {
+        Mutex::Autolock _l(sLock);
+        if (takeFromPoolLocked(width, height, format, layerCount, usage, handle, stride,
+                               requestorName)) {
+            return NO_ERROR;
+        }
+    }
+
     status_t error =
             mAllocator->allocate(width, height, format, layerCount, usage, 1, stride, handle);
     if (error == NO_ERROR) {
         Mutex::Autolock _l(sLock);
-        KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
-        uint32_t bpp = bytesPerPixel(format);
-        alloc_rec_t rec;
-        rec.width = width;
-        rec.height = height;
-        rec.stride = *stride;
-        rec.format = format;
-        rec.layerCount = layerCount;
-        rec.usage = usage;
-        rec.size = static_cast<size_t>(height * (*stride) * bpp);
-        rec.requestorName = std::move(requestorName);
-        list.add(*handle, rec);
-
+        addAllocRecLocked(*handle, width, height, *stride, format, layerCount, usage,
+                          std::move(requestorName));
         return NO_ERROR;
     } else {
         ALOGE("Failed to allocate (%u x %u) layerCount %u format %d "
@@ -145,20 +150,203 @@ status_t GraphicBufferAllocator::allocate(uint32_t width, uint32_t height,
     }
 }
 
+status_t GraphicBufferAllocator::allocateMany(uint32_t width, uint32_t height,
+        PixelFormat format, uint32_t layerCount, uint64_t usage, uint32_t count,
+        buffer_handle_t* handles, uint32_t* strides, std::string requestorName)
+{
+    ATRACE_CALL();
+
+    // Same defaults as allocate()
+    if (!width || !height)
+        width = height = 1;
+    if (layerCount < 1)
+        layerCount = 1;
+
+    uint32_t pooled = 0;
+    {
+        Mutex::Autolock _l(sLock);
+        while (pooled < count) {
+            std::string name(requestorName);
+            if (!takeFromPoolLocked(width, height, format, layerCount, usage, &handles[pooled],
+                                    &strides[pooled], name)) {
+                break;
+            }
+            pooled++;
+        }
+    }
+    if (pooled == count) {
+        return NO_ERROR;
+    }
+
+    uint32_t stride = 0;
+    status_t error = mAllocator->allocate(width, height, format, layerCount, usage,
+                                          count - pooled, &stride, &handles[pooled]);
+    if (error != NO_ERROR) {
+        ALOGE("Failed to allocate %u buffers (%u x %u) layerCount %u format %d "
+                "usage %" PRIx64 ": %d",
+                count - pooled, width, height, layerCount, format, usage, error);
+        for (uint32_t i = 0; i < pooled; i++) {
+            free(handles[i]);
+        }
+        return NO_MEMORY;
+    }
+
+    Mutex::Autolock _l(sLock);
+    for (uint32_t i = pooled; i < count; i++) {
+        strides[i] = stride;
+        addAllocRecLocked(handles[i], width, height, stride, format, layerCount, usage,
+                          requestorName);
+    }
+    return NO_ERROR;
+}
+
+std::future<GraphicBufferAllocator::AllocationResult> GraphicBufferAllocator::allocateAsync(
+        uint32_t width, uint32_t height, PixelFormat format, uint32_t layerCount, uint64_t usage,
+        std::string requestorName)
+{
+    {
+        Mutex::Autolock _l(sLock);
+        if (sPoolBytes > 0) {
+            AllocationResult result{NO_ERROR, nullptr, 0};
+            // Same defaults as allocate()
+            const uint32_t w = width && height ? width : 1;
+            const uint32_t h = width && height ? height : 1;
+            if (takeFromPoolLocked(w, h, format, layerCount < 1 ? 1 : layerCount, usage,
+                                   &result.handle, &result.stride, requestorName)) {
+                std::promise<AllocationResult> ready;
+                ready.set_value(result);
+                return ready.get_future();
+            }
+        }
+    }
+
+    std::packaged_task<AllocationResult()> task(
+            [this, width, height, format, layerCount, usage,
+             requestorName = std::move(requestorName)]() {
+                AllocationResult result{NO_ERROR, nullptr, 0};
+                result.status = allocate(width, height, format, layerCount, usage,
+                                         &result.handle, &result.stride, 0, requestorName);
+                return result;
+            });
+    std::future<AllocationResult> future = task.get_future();
+
+    std::lock_guard<std::mutex> lock(mAsyncLock);
+    if (!mAsyncThreadStarted) {
+        // The singleton is never destroyed, so neither is the thread.
+        std::thread(&GraphicBufferAllocator::asyncThreadMain, this).detach();
+        mAsyncThreadStarted = true;
+    }
+    mAsyncQueue.push_back(std::move(task));
+    mAsyncCondition.notify_one();
+    return future;
+}
+
+void GraphicBufferAllocator::asyncThreadMain()
+{
+    pthread_setname_np(pthread_self(), "GBAllocAsync");
+    for (;;) {
+        std::packaged_task<AllocationResult()> task;
+        {
+            std::unique_lock<std::mutex> lock(mAsyncLock);
+            mAsyncCondition.wait(lock, [this] { return !mAsyncQueue.empty(); });
+            task = std::move(mAsyncQueue.front());
+            mAsyncQueue.pop_front();
+        }
+        task();
+    }
+}
+
 status_t GraphicBufferAllocator::free(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    std::vector<buffer_handle_t> evicted;
+    {
+        Mutex::Autolock _l(sLock);
+        KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
+        const ssize_t index = list.indexOfKey(handle);
+        // Buffers of unknown size can't be accounted for, so they aren't pooled.
+        if (index >= 0 && list.valueAt(index).size > 0 &&
+            list.valueAt(index).size <= sPoolBudget) {
+            sPool.push_front({handle, list.valueAt(index)});
+            sPoolBytes += list.valueAt(index).size;
+            list.removeItemsAt(index);
+            evicted = trimPoolLocked();
+        } else {
+            list.removeItem(handle);
+            evicted.push_back(handle);
+        }
+    }
+
     // We allocated a buffer from the allocator and imported it into the
     // mapper to get the handle.  We just need to free the handle now.
-    mMapper.freeBuffer(handle);
-
-    Mutex::Autolock _l(sLock);
-    KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
-    list.removeItem(handle);
+    for (buffer_handle_t h : evicted) {
+        mMapper.freeBuffer(h);
+    }
 
     return NO_ERROR;
 }
 
+void GraphicBufferAllocator::setPoolBudget(size_t bytes)
+{
+    std::vector<buffer_handle_t> evicted;
+    {
+        Mutex::Autolock _l(sLock);
+        sPoolBudget = bytes;
+        evicted = trimPoolLocked();
+    }
+    for (buffer_handle_t h : evicted) {
+        mMapper.freeBuffer(h);
+    }
+}
+
+void GraphicBufferAllocator::addAllocRecLocked(buffer_handle_t handle, uint32_t width,
+        uint32_t height, uint32_t stride, PixelFormat format, uint32_t layerCount,
+        uint64_t usage, std::string requestorName)
+{
+    alloc_rec_t rec;
+    rec.width = width;
+    rec.height = height;
+    rec.stride = stride;
+    rec.format = format;
+    rec.layerCount = layerCount;
+    rec.usage = usage;
+    rec.size = static_cast<size_t>(height * stride * bytesPerPixel(format));
+    rec.requestorName = std::move(requestorName);
+    sAllocList.add(handle, rec);
+}
+
+bool GraphicBufferAllocator::takeFromPoolLocked(uint32_t width, uint32_t height,
+        PixelFormat format, uint32_t layerCount, uint64_t usage, buffer_handle_t* handle,
+        uint32_t* stride, std::string& requestorName)
+{
+    for (auto it = sPool.begin(); it != sPool.end(); ++it) {
+        alloc_rec_t& rec = it->rec;
+        if (rec.width != width || rec.height != height || rec.format != format ||
+            rec.layerCount != layerCount || rec.usage != usage) {
+            continue;
+        }
+        *handle = it->handle;
+        *stride = rec.stride;
+        sPoolBytes -= rec.size;
+        rec.requestorName = std::move(requestorName);
+        sAllocList.add(it->handle, rec);
+        sPool.erase(it);
+        return true;
+    }
+    return false;
+}
+
+std::vector<buffer_handle_t> GraphicBufferAllocator::trimPoolLocked()
+{
+    std::vector<buffer_handle_t> evicted;
+    while (sPoolBytes > sPoolBudget) {
+        evicted.push_back(sPool.back().handle);
+        sPoolBytes -= sPool.back().rec.size;
+        sPool.pop_back();
+    }
+    return evicted;
+}
+
 // ---------------------------------------------------------------------------
 }; // namespace android
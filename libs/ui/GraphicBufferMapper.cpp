@@ -39,6 +39,10 @@
 
 #include <system/graphics.h>
 
+#include <sys/stat.h>
+
+#include <algorithm>
+
 namespace android {
 // ---------------------------------------------------------------------------
 
@@ -67,9 +71,63 @@ status_t GraphicBufferMapper::importBuffer(buffer_handle_t rawHandle,
         uint32_t width, uint32_t height, uint32_t layerCount,
         PixelFormat format, uint64_t usage, uint32_t stride,
         buffer_handle_t* outHandle)
+{
+    return importBuffer(rawHandle, width, height, layerCount, format, usage, stride, 0, outHandle);
+}
+
+bool GraphicBufferMapper::getFiles(buffer_handle_t rawHandle,
+        std::vector<std::pair<dev_t, ino_t>>* outFiles)
+{
+    outFiles->clear();
+    outFiles->reserve(rawHandle->numFds);
+    for (int i = 0; i < rawHandle->numFds; i++) {
+        struct stat st;
+        if (fstat(rawHandle->data[i], &st) != 0) {
+            return false;
+        }
+        outFiles->emplace_back(st.st_dev, st.st_ino);
+    }
+    return true;
+}
+
+bool GraphicBufferMapper::matches(const SharedImport& import, buffer_handle_t rawHandle,
+        const std::vector<std::pair<dev_t, ino_t>>& files, uint32_t width, uint32_t height,
+        uint32_t layerCount, PixelFormat format, uint64_t usage, uint32_t stride)
+{
+    return import.width == width && import.height == height &&
+            import.layerCount == layerCount && import.format == format &&
+            import.usage == usage && import.stride == stride &&
+            import.files == files &&
+            import.ints.size() == static_cast<size_t>(rawHandle->numInts) &&
+            std::equal(import.ints.begin(), import.ints.end(),
+                       rawHandle->data + rawHandle->numFds);
+}
+
+status_t GraphicBufferMapper::importBuffer(buffer_handle_t rawHandle,
+        uint32_t width, uint32_t height, uint32_t layerCount,
+        PixelFormat format, uint64_t usage, uint32_t stride,
+        uint64_t bufferId, buffer_handle_t* outHandle)
 {
     ATRACE_CALL();
 
+    // Without the identity of every fd, the import can't be shared safely.
+    std::vector<std::pair<dev_t, ino_t>> files;
+    if (bufferId != 0 && !getFiles(rawHandle, &files)) {
+        bufferId = 0;
+    }
+
+    if (bufferId != 0) {
+        std::lock_guard<std::mutex> lock(mSharedImportLock);
+        auto it = mSharedImports.find(bufferId);
+        if (it != mSharedImports.end() &&
+            matches(it->second, rawHandle, files, width, height, layerCount, format, usage,
+                    stride)) {
+            it->second.refs++;
+            *outHandle = it->second.handle;
+            return NO_ERROR;
+        }
+    }
+
     buffer_handle_t bufferHandle;
     status_t error = mMapper->importBuffer(hardware::hidl_handle(rawHandle), &bufferHandle);
     if (error != NO_ERROR) {
@@ -85,6 +143,21 @@ status_t GraphicBufferMapper::importBuffer(buffer_handle_t rawHandle,
         return static_cast<status_t>(error);
     }
 
+    if (bufferId != 0) {
+        std::lock_guard<std::mutex> lock(mSharedImportLock);
+        // If another thread imported the same buffer meanwhile, or a
+        // different buffer has the same id, this import stays unshared.
+        if (mSharedImports.count(bufferId) == 0) {
+            const int* ints = rawHandle->data + rawHandle->numFds;
+            mSharedImports.emplace(bufferId,
+                                   SharedImport{bufferHandle, 1, width, height, layerCount,
+                                                format, usage, stride, std::move(files),
+                                                std::vector<int>(ints,
+                                                                 ints + rawHandle->numInts)});
+            mSharedImportIds.emplace(bufferHandle, bufferId);
+        }
+    }
+
     *outHandle = bufferHandle;
 
     return NO_ERROR;
@@ -100,6 +173,19 @@ status_t GraphicBufferMapper::freeBuffer(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    {
+        std::lock_guard<std::mutex> lock(mSharedImportLock);
+        auto id = mSharedImportIds.find(handle);
+        if (id != mSharedImportIds.end()) {
+            auto it = mSharedImports.find(id->second);
+            if (--it->second.refs > 0) {
+                return NO_ERROR;
+            }
+            mSharedImports.erase(it);
+            mSharedImportIds.erase(id);
+        }
+    }
+
     mMapper->freeBuffer(handle);
 
     return NO_ERROR;
@@ -19,6 +19,8 @@
 #include <inttypes.h>
 #include <limits.h>
 
+#include <algorithm>
+
 #include <android-base/stringprintf.h>
 
 #include <utils/Log.h>
@@ -68,7 +70,7 @@ const Region Region::INVALID_REGION(Rect::INVALID_RECT);
 // ----------------------------------------------------------------------------
 
 Region::Region() {
-    mStorage.add(Rect(0,0));
+    mStorage.push_back(Rect(0,0));
 }
 
 Region::Region(const Region& rhs)
@@ -79,8 +81,15 @@ Region::Region(const Region& rhs)
 #endif
 }
 
+Region::Region(Region&& rhs) noexcept
+    : mStorage(std::move(rhs.mStorage))
+{
+    // leave rhs as a valid empty region
+    rhs.mStorage.push_back(Rect(0,0));
+}
+
 Region::Region(const Rect& rhs) {
-    mStorage.add(rhs);
+    mStorage.push_back(rhs);
 }
 
 Region::~Region()
@@ -101,8 +110,8 @@ Region::~Region()
  * final, correctly ordered region buffer. Each rectangle will be compared with the span directly
  * above it, and subdivided to resolve any remaining T-junctions.
  */
-static void reverseRectsResolvingJunctions(const Rect* begin, const Rect* end,
-        Vector<Rect>& dst, int spanDirection) {
+void Region::reverseRectsResolvingJunctions(const Rect* begin, const Rect* end,
+        Storage& dst, int spanDirection) {
     dst.clear();
 
     const Rect* current = end - 1;
@@ -110,7 +119,7 @@ static void reverseRectsResolvingJunctions(const Rect* begin, const Rect* end,
 
     // add first span immediately
     do {
-        dst.add(*current);
+        dst.push_back(*current);
         current--;
     } while (current->top == lastTop && current >= begin);
 
@@ -148,12 +157,12 @@ static void reverseRectsResolvingJunctions(const Rect* begin, const Rect* end,
                 if (prev.right <= left) break;
 
                 if (prev.right > left && prev.right < right) {
-                    dst.add(Rect(prev.right, top, right, bottom));
+                    dst.push_back(Rect(prev.right, top, right, bottom));
                     right = prev.right;
                 }
 
                 if (prev.left > left && prev.left < right) {
-                    dst.add(Rect(prev.left, top, right, bottom));
+                    dst.push_back(Rect(prev.left, top, right, bottom));
                     right = prev.left;
                 }
 
@@ -167,12 +176,12 @@ static void reverseRectsResolvingJunctions(const Rect* begin, const Rect* end,
                 if (prev.left >= right) break;
 
                 if (prev.left > left && prev.left < right) {
-                    dst.add(Rect(left, top, prev.left, bottom));
+                    dst.push_back(Rect(left, top, prev.left, bottom));
                     left = prev.left;
                 }
 
                 if (prev.right > left && prev.right < right) {
-                    dst.add(Rect(left, top, prev.right, bottom));
+                    dst.push_back(Rect(left, top, prev.right, bottom));
                     left = prev.right;
                 }
                 // if an entry in the previous span is too far left, nothing further right in the
@@ -184,7 +193,7 @@ static void reverseRectsResolvingJunctions(const Rect* begin, const Rect* end,
         }
 
         if (left < right) {
-            dst.add(Rect(left, top, right, bottom));
+            dst.push_back(Rect(left, top, right, bottom));
         }
 
         current--;
@@ -202,13 +211,13 @@ Region Region::createTJunctionFreeRegion(const Region& r) {
     if (r.isEmpty()) return r;
     if (r.isRect()) return r;
 
-    Vector<Rect> reversed;
+    Storage reversed;
     reverseRectsResolvingJunctions(r.begin(), r.end(), reversed, direction_RTL);
 
     Region outputRegion;
     reverseRectsResolvingJunctions(reversed.begin(), reversed.end(),
             outputRegion.mStorage, direction_LTR);
-    outputRegion.mStorage.add(r.getBounds()); // to make region valid, mStorage must end with bounds
+    outputRegion.mStorage.push_back(r.getBounds()); // to make region valid, mStorage must end with bounds
 
 #if defined(VALIDATE_REGIONS)
     validate(outputRegion, "T-Junction free region");
@@ -227,12 +236,21 @@ Region& Region::operator = (const Region& rhs)
     return *this;
 }
 
+Region& Region::operator = (Region&& rhs) noexcept
+{
+    if (this != &rhs) {
+        mStorage = std::move(rhs.mStorage);
+        rhs.mStorage.push_back(Rect(0,0));
+    }
+    return *this;
+}
+
 Region& Region::makeBoundsSelf()
 {
     if (mStorage.size() >= 2) {
         const Rect bounds(getBounds());
         mStorage.clear();
-        mStorage.add(bounds);
+        mStorage.push_back(bounds);
     }
     return *this;
 }
@@ -256,29 +274,33 @@ bool Region::contains(int x, int y) const {
 void Region::clear()
 {
     mStorage.clear();
-    mStorage.add(Rect(0,0));
+    mStorage.push_back(Rect(0,0));
 }
 
 void Region::set(const Rect& r)
 {
     mStorage.clear();
-    mStorage.add(r);
+    mStorage.push_back(r);
 }
 
 void Region::set(int32_t w, int32_t h)
 {
     mStorage.clear();
-    mStorage.add(Rect(w, h));
+    mStorage.push_back(Rect(w, h));
 }
 
 void Region::set(uint32_t w, uint32_t h)
 {
     mStorage.clear();
-    mStorage.add(Rect(w, h));
+    mStorage.push_back(Rect(w, h));
 }
 
 bool Region::isTriviallyEqual(const Region& region) const {
-    return begin() == region.begin();
+    if (this == &region) {
+        return true;
+    }
+    return mStorage.size() == region.mStorage.size() &&
+            memcmp(mStorage.data(), region.mStorage.data(), mStorage.size() * sizeof(Rect)) == 0;
 }
 
 // ----------------------------------------------------------------------------
@@ -286,8 +308,7 @@ bool Region::isTriviallyEqual(const Region& region) const {
 void Region::addRectUnchecked(int l, int t, int r, int b)
 {
     Rect rect(l,t,r,b);
-    size_t where = mStorage.size() - 1;
-    mStorage.insertAt(rect, where, 1);
+    mStorage.insert(mStorage.end() - 1, rect);
 }
 
 // ----------------------------------------------------------------------------
@@ -305,8 +326,10 @@ Region& Region::subtractSelf(const Rect& r) {
     return operationSelf(r, op_nand);
 }
 Region& Region::operationSelf(const Rect& r, uint32_t op) {
-    Region lhs(*this);
-    boolean_operation(op, *this, lhs, r);
+    // r may refer to one of our own rects
+    const Rect rhs(r);
+    Region lhs(std::move(*this));
+    boolean_operation(op, *this, lhs, rhs);
     return *this;
 }
 
@@ -325,7 +348,12 @@ Region& Region::subtractSelf(const Region& rhs) {
     return operationSelf(rhs, op_nand);
 }
 Region& Region::operationSelf(const Region& rhs, uint32_t op) {
-    Region lhs(*this);
+    if (&rhs == this) {
+        // the operation must not read rhs after this region is moved from
+        const Region copy(rhs);
+        return operationSelf(copy, op);
+    }
+    Region lhs(std::move(*this));
     boolean_operation(op, *this, lhs, rhs);
     return *this;
 }
@@ -337,7 +365,7 @@ Region& Region::translateSelf(int x, int y) {
 
 Region& Region::scaleSelf(float sx, float sy) {
     size_t count = mStorage.size();
-    Rect* rects = mStorage.editArray();
+    Rect* rects = mStorage.data();
     while (count) {
         rects->left = static_cast<int32_t>(rects->left * sx + 0.5f);
         rects->right = static_cast<int32_t>(rects->right * sx + 0.5f);
@@ -351,19 +379,19 @@ Region& Region::scaleSelf(float sx, float sy) {
 
 // ----------------------------------------------------------------------------
 
-const Region Region::merge(const Rect& rhs) const {
+Region Region::merge(const Rect& rhs) const {
     return operation(rhs, op_or);
 }
-const Region Region::mergeExclusive(const Rect& rhs) const {
+Region Region::mergeExclusive(const Rect& rhs) const {
     return operation(rhs, op_xor);
 }
-const Region Region::intersect(const Rect& rhs) const {
+Region Region::intersect(const Rect& rhs) const {
     return operation(rhs, op_and);
 }
-const Region Region::subtract(const Rect& rhs) const {
+Region Region::subtract(const Rect& rhs) const {
     return operation(rhs, op_nand);
 }
-const Region Region::operation(const Rect& rhs, uint32_t op) const {
+Region Region::operation(const Rect& rhs, uint32_t op) const {
     Region result;
     boolean_operation(op, result, *this, rhs);
     return result;
@@ -371,25 +399,25 @@ const Region Region::operation(const Rect& rhs, uint32_t op) const {
 
 // ----------------------------------------------------------------------------
 
-const Region Region::merge(const Region& rhs) const {
+Region Region::merge(const Region& rhs) const {
     return operation(rhs, op_or);
 }
-const Region Region::mergeExclusive(const Region& rhs) const {
+Region Region::mergeExclusive(const Region& rhs) const {
     return operation(rhs, op_xor);
 }
-const Region Region::intersect(const Region& rhs) const {
+Region Region::intersect(const Region& rhs) const {
     return operation(rhs, op_and);
 }
-const Region Region::subtract(const Region& rhs) const {
+Region Region::subtract(const Region& rhs) const {
     return operation(rhs, op_nand);
 }
-const Region Region::operation(const Region& rhs, uint32_t op) const {
+Region Region::operation(const Region& rhs, uint32_t op) const {
     Region result;
     boolean_operation(op, result, *this, rhs);
     return result;
 }
 
-const Region Region::translate(int x, int y) const {
+Region Region::translate(int x, int y) const {
     Region result;
     translate(result, *this, x, y);
     return result;
@@ -410,26 +438,31 @@ Region& Region::subtractSelf(const Region& rhs, int dx, int dy) {
     return operationSelf(rhs, dx, dy, op_nand);
 }
 Region& Region::operationSelf(const Region& rhs, int dx, int dy, uint32_t op) {
-    Region lhs(*this);
+    if (&rhs == this) {
+        // the operation must not read rhs after this region is moved from
+        const Region copy(rhs);
+        return operationSelf(copy, dx, dy, op);
+    }
+    Region lhs(std::move(*this));
     boolean_operation(op, *this, lhs, rhs, dx, dy);
     return *this;
 }
 
 // ----------------------------------------------------------------------------
 
-const Region Region::merge(const Region& rhs, int dx, int dy) const {
+Region Region::merge(const Region& rhs, int dx, int dy) const {
     return operation(rhs, dx, dy, op_or);
 }
-const Region Region::mergeExclusive(const Region& rhs, int dx, int dy) const {
+Region Region::mergeExclusive(const Region& rhs, int dx, int dy) const {
     return operation(rhs, dx, dy, op_xor);
 }
-const Region Region::intersect(const Region& rhs, int dx, int dy) const {
+Region Region::intersect(const Region& rhs, int dx, int dy) const {
     return operation(rhs, dx, dy, op_and);
 }
-const Region Region::subtract(const Region& rhs, int dx, int dy) const {
+Region Region::subtract(const Region& rhs, int dx, int dy) const {
     return operation(rhs, dx, dy, op_nand);
 }
-const Region Region::operation(const Region& rhs, int dx, int dy, uint32_t op) const {
+Region Region::operation(const Region& rhs, int dx, int dy, uint32_t op) const {
     Region result;
     boolean_operation(op, result, *this, rhs, dx, dy);
     return result;
@@ -442,10 +475,10 @@ const Region Region::operation(const Region& rhs, int dx, int dy, uint32_t op) c
 class Region::rasterizer : public region_operator<Rect>::region_rasterizer
 {
     Rect bounds;
-    Vector<Rect>& storage;
+    Storage& storage;
     Rect* head;
     Rect* tail;
-    Vector<Rect> span;
+    Storage span;
     Rect* cur;
 public:
     explicit rasterizer(Region& reg)
@@ -472,8 +505,8 @@ Region::rasterizer::~rasterizer()
         flushSpan();
     }
     if (storage.size()) {
-        bounds.top = storage.itemAt(0).top;
-        bounds.bottom = storage.top().bottom;
+        bounds.top = storage.front().top;
+        bounds.bottom = storage.back().bottom;
         if (storage.size() == 1) {
             storage.clear();
         }
@@ -481,7 +514,7 @@ Region::rasterizer::~rasterizer()
         bounds.left  = 0;
         bounds.right = 0;
     }
-    storage.add(bounds);
+    storage.push_back(bounds);
 }
 
 void Region::rasterizer::operator()(const Rect& rect)
@@ -496,15 +529,15 @@ void Region::rasterizer::operator()(const Rect& rect)
             return;
         }
     }
-    span.add(rect);
-    cur = span.editArray() + (span.size() - 1);
+    span.push_back(rect);
+    cur = span.data() + (span.size() - 1);
 }
 
 void Region::rasterizer::flushSpan()
 {
     bool merge = false;
     if (tail-head == ssize_t(span.size())) {
-        Rect const* p = span.editArray();
+        Rect const* p = span.data();
         Rect const* q = head;
         if (p->top == q->bottom) {
             merge = true;
@@ -526,18 +559,134 @@ void Region::rasterizer::flushSpan()
             r++;
         }
     } else {
-        bounds.left = min(span.itemAt(0).left, bounds.left);
-        bounds.right = max(span.top().right, bounds.right);
-        storage.appendVector(span);
-        tail = storage.editArray() + storage.size();
+        bounds.left = min(span.front().left, bounds.left);
+        bounds.right = max(span.back().right, bounds.right);
+        storage.append(span.begin(), span.end());
+        tail = storage.data() + storage.size();
         head = tail - span.size();
     }
     span.clear();
 }
 
+// Computes the result of a boolean operation without running the general
+// sweep when it is trivially known from the operands' bounds; this covers the
+// empty, disjoint and single-rect cases that dominate SurfaceFlinger's
+// per-frame region math. Returns false if the full sweep is needed.
+bool Region::boolean_operation_fast(uint32_t op, Region& dst,
+        const Region& lhs, const Rect& rhsBounds, bool rhsIsRect)
+{
+    const Rect lhsBounds = lhs.getBounds();
+    // INVALID_RECT is used as a signal value, leave it to the sweep
+    if (!lhsBounds.isValid() || !rhsBounds.isValid()) {
+        return false;
+    }
+
+    const bool lhsEmpty = lhsBounds.isEmpty();
+    const bool rhsEmpty = rhsBounds.isEmpty();
+    Rect intersection;
+    const bool overlap = !lhsEmpty && !rhsEmpty && lhsBounds.intersect(rhsBounds, &intersection);
+
+    switch (op) {
+        case op_and:
+            if (!overlap) {
+                dst.setEmpty();
+                return true;
+            }
+            if (lhs.isRect() && rhsIsRect) {
+                dst.setRect(intersection);
+                return true;
+            }
+            // rhs is a rect covering all of lhs
+            if (rhsIsRect && intersection == lhsBounds) {
+                dst = lhs;
+                return true;
+            }
+            return false;
+        case op_nand:
+            if (lhsEmpty) {
+                dst.setEmpty();
+                return true;
+            }
+            if (!overlap) {
+                dst = lhs;
+                return true;
+            }
+            // rhs is a rect covering all of lhs
+            if (rhsIsRect && intersection == lhsBounds) {
+                dst.setEmpty();
+                return true;
+            }
+            return false;
+        case op_or:
+            if (rhsEmpty) {
+                dst = lhs;
+                return true;
+            }
+            if (lhsEmpty && rhsIsRect) {
+                dst.setRect(rhsBounds);
+                return true;
+            }
+            if (rhsIsRect) {
+                // rhs covers all of lhs
+                if (lhsBounds.left >= rhsBounds.left && lhsBounds.top >= rhsBounds.top &&
+                    lhsBounds.right <= rhsBounds.right && lhsBounds.bottom <= rhsBounds.bottom) {
+                    dst.setRect(rhsBounds);
+                    return true;
+                }
+                if (lhs.isRect()) {
+                    // lhs covers all of rhs
+                    if (intersection == rhsBounds) {
+                        dst = lhs;
+                        return true;
+                    }
+                    // two rects forming a single rect, side by side or stacked
+                    const bool sameRows = lhsBounds.top == rhsBounds.top &&
+                            lhsBounds.bottom == rhsBounds.bottom &&
+                            lhsBounds.left <= rhsBounds.right && rhsBounds.left <= lhsBounds.right;
+                    const bool sameColumns = lhsBounds.left == rhsBounds.left &&
+                            lhsBounds.right == rhsBounds.right &&
+                            lhsBounds.top <= rhsBounds.bottom && rhsBounds.top <= lhsBounds.bottom;
+                    if (sameRows || sameColumns) {
+                        dst.setRect(Rect(std::min(lhsBounds.left, rhsBounds.left),
+                                         std::min(lhsBounds.top, rhsBounds.top),
+                                         std::max(lhsBounds.right, rhsBounds.right),
+                                         std::max(lhsBounds.bottom, rhsBounds.bottom)));
+                        return true;
+                    }
+                }
+            }
+            return false;
+        case op_xor:
+            if (rhsEmpty) {
+                dst = lhs;
+                return true;
+            }
+            if (lhsEmpty && rhsIsRect) {
+                dst.setRect(rhsBounds);
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
+void Region::setEmpty() {
+    mStorage.clear();
+    mStorage.push_back(Rect(0, 0));
+}
+
+void Region::setRect(const Rect& r) {
+    mStorage.clear();
+    if (r.isEmpty()) {
+        mStorage.push_back(Rect(0, 0));
+    } else {
+        mStorage.push_back(r);
+    }
+}
+
 bool Region::validate(const Region& reg, const char* name, bool silent)
 {
-    if (reg.mStorage.isEmpty()) {
+    if (reg.mStorage.empty()) {
         ALOGE_IF(!silent, "%s: mStorage is empty, which is never valid", name);
         // return immediately as the code below assumes mStorage is non-empty
         return false;
@@ -625,6 +774,15 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     validate(dst, "boolean_operation (before): dst");
 #endif
 
+#if !VALIDATE_WITH_CORECG
+    if (boolean_operation_fast(op, dst, lhs, rhs.getBounds().offsetBy(dx, dy), rhs.isRect())) {
+#if defined(VALIDATE_REGIONS)
+        validate(dst, "boolean_operation (fast): dst");
+#endif
+        return;
+    }
+#endif
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -740,6 +898,10 @@ void Region::boolean_operation(uint32_t op, Region& dst,
 #if VALIDATE_WITH_CORECG || defined(VALIDATE_REGIONS)
     boolean_operation(op, dst, lhs, Region(rhs), dx, dy);
 #else
+    if (boolean_operation_fast(op, dst, lhs, Rect(rhs).offsetBy(dx, dy), true)) {
+        return;
+    }
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -773,7 +935,7 @@ void Region::translate(Region& reg, int dx, int dy)
         validate(reg, "translate (before)");
 #endif
         size_t count = reg.mStorage.size();
-        Rect* rects = reg.mStorage.editArray();
+        Rect* rects = reg.mStorage.data();
         while (count) {
             rects->offsetBy(dx, dy);
             rects++;
@@ -853,24 +1015,24 @@ status_t Region::unflatten(void const* buffer, size_t size) {
         ALOGE("Region::unflatten() failed, invalid region");
         return BAD_VALUE;
     }
-    mStorage = result.mStorage;
+    mStorage = std::move(result.mStorage);
     return NO_ERROR;
 }
 
 // ----------------------------------------------------------------------------
 
 Region::const_iterator Region::begin() const {
-    return mStorage.array();
+    return mStorage.data();
 }
 
 Region::const_iterator Region::end() const {
     // Workaround for b/77643177
     // mStorage should never be empty, but somehow it is and it's causing
     // an abort in ubsan
-    if (mStorage.isEmpty()) return mStorage.array();
+    if (mStorage.empty()) return mStorage.data();
 
     size_t numRects = isRect() ? 1 : mStorage.size() - 1;
-    return mStorage.array() + numRects;
+    return mStorage.data() + numRects;
 }
 
 Rect const* Region::getArray(size_t* count) const {
@@ -205,51 +205,68 @@ Rect Transform::makeBounds(int w, int h) const
     return transform( Rect(w, h) );
 }
 
-Rect Transform::transform(const Rect& bounds, bool roundOutwards) const
+// Transforms that preserve rects map each edge to an edge, so two of the
+// four corners are enough, and only the matrix terms that aren't zero are
+// used. The results are the same as transforming all four corners: the
+// terms skipped only ever add zero.
+FloatRect Transform::transform(const FloatRect& bounds) const
 {
-    Rect r;
-    vec2 lt( bounds.left,  bounds.top    );
-    vec2 rt( bounds.right, bounds.top    );
-    vec2 lb( bounds.left,  bounds.bottom );
-    vec2 rb( bounds.right, bounds.bottom );
-
-    lt = transform(lt);
-    rt = transform(rt);
-    lb = transform(lb);
-    rb = transform(rb);
-
-    if (roundOutwards) {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]})));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]})));
-        r.right  = static_cast<int32_t>(ceilf(std::max({lt[0], rt[0], lb[0], rb[0]})));
-        r.bottom = static_cast<int32_t>(ceilf(std::max({lt[1], rt[1], lb[1], rb[1]})));
+    const mat33& M(mMatrix);
+    // Skips the call when the type is known, which it almost always is
+    const uint32_t t = CC_LIKELY(!(mType & UNKNOWN_TYPE)) ? mType : type();
+    float x0, x1, y0, y1;
+    if (CC_LIKELY(t <= TRANSLATE)) {
+        x0 = bounds.left + M[2][0];
+        x1 = bounds.right + M[2][0];
+        y0 = bounds.top + M[2][1];
+        y1 = bounds.bottom + M[2][1];
+    } else if ((t >> 8) & ROT_INVALID) {
+        const vec2 lt = transform(vec2(bounds.left, bounds.top));
+        const vec2 rt = transform(vec2(bounds.right, bounds.top));
+        const vec2 lb = transform(vec2(bounds.left, bounds.bottom));
+        const vec2 rb = transform(vec2(bounds.right, bounds.bottom));
+        FloatRect r;
+        r.left = std::min({lt[0], rt[0], lb[0], rb[0]});
+        r.top = std::min({lt[1], rt[1], lb[1], rb[1]});
+        r.right = std::max({lt[0], rt[0], lb[0], rb[0]});
+        r.bottom = std::max({lt[1], rt[1], lb[1], rb[1]});
+        return r;
+    } else if ((t >> 8) & ROT_90) {
+        // x comes from y, and y from x
+        x0 = M[1][0] * bounds.top + M[2][0];
+        x1 = M[1][0] * bounds.bottom + M[2][0];
+        y0 = M[0][1] * bounds.left + M[2][1];
+        y1 = M[0][1] * bounds.right + M[2][1];
     } else {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
-        r.right  = static_cast<int32_t>(floorf(std::max({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.bottom = static_cast<int32_t>(floorf(std::max({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
+        x0 = M[0][0] * bounds.left + M[2][0];
+        x1 = M[0][0] * bounds.right + M[2][0];
+        y0 = M[1][1] * bounds.top + M[2][1];
+        y1 = M[1][1] * bounds.bottom + M[2][1];
     }
-
+    FloatRect r;
+    r.left = std::min(x0, x1);
+    r.top = std::min(y0, y1);
+    r.right = std::max(x0, x1);
+    r.bottom = std::max(y0, y1);
     return r;
 }
 
-FloatRect Transform::transform(const FloatRect& bounds) const
+Rect Transform::transform(const Rect& bounds, bool roundOutwards) const
 {
-    vec2 lt(bounds.left, bounds.top);
-    vec2 rt(bounds.right, bounds.top);
-    vec2 lb(bounds.left, bounds.bottom);
-    vec2 rb(bounds.right, bounds.bottom);
+    const FloatRect f = transform(bounds.toFloatRect());
 
-    lt = transform(lt);
-    rt = transform(rt);
-    lb = transform(lb);
-    rb = transform(rb);
-
-    FloatRect r;
-    r.left = std::min({lt[0], rt[0], lb[0], rb[0]});
-    r.top = std::min({lt[1], rt[1], lb[1], rb[1]});
-    r.right = std::max({lt[0], rt[0], lb[0], rb[0]});
-    r.bottom = std::max({lt[1], rt[1], lb[1], rb[1]});
+    Rect r;
+    if (roundOutwards) {
+        r.left   = static_cast<int32_t>(floorf(f.left));
+        r.top    = static_cast<int32_t>(floorf(f.top));
+        r.right  = static_cast<int32_t>(ceilf(f.right));
+        r.bottom = static_cast<int32_t>(ceilf(f.bottom));
+    } else {
+        r.left   = static_cast<int32_t>(floorf(f.left + 0.5f));
+        r.top    = static_cast<int32_t>(floorf(f.top + 0.5f));
+        r.right  = static_cast<int32_t>(floorf(f.right + 0.5f));
+        r.bottom = static_cast<int32_t>(floorf(f.bottom + 0.5f));
+    }
 
     return r;
 }
@@ -253,6 +253,13 @@ public:
     static std::unique_ptr<float3[]> createLUT(uint32_t size, const ColorSpace& src,
                                                const ColorSpace& dst);
 
+    // Same as createLUT(), but the LUT is shared with earlier callers that
+    // asked for the same size and pair of color spaces, so that it is only
+    // generated once. Color spaces are told apart by name, conversion matrix
+    // and transfer parameters. Only the few most recently used LUTs are kept.
+    static std::shared_ptr<const float3> getLUT(uint32_t size, const ColorSpace& src,
+                                                const ColorSpace& dst);
+
 private:
     static constexpr mat3 computeXYZMatrix(
             const std::array<float2, 3>& primaries, const float2& whitePoint);
@@ -289,6 +296,10 @@ public:
         return apply(mDestination.fromLinear(mTransform * linear), mDestination.getClamper());
     }
 
+    // Same as transform(), for count values at once. in and out may be the
+    // same array.
+    void transform(const float3* in, float3* out, size_t count) const noexcept;
+
     constexpr float3 transformLinear(const float3& v) const noexcept {
         float3 linear = apply(v, mSource.getClamper());
         return apply(mTransform * linear, mDestination.getClamper());
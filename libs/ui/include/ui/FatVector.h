@@ -0,0 +1,184 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+#include <log/log.h>
+
+namespace android {
+
+/**
+ * A vector of trivially copyable elements that keeps up to SIZE elements
+ * inline and only allocates from the heap once it grows past that. Moving a
+ * FatVector that has spilled to the heap steals its allocation.
+ */
+template <typename T, size_t SIZE>
+class FatVector {
+    static_assert(std::is_trivially_copyable<T>::value, "FatVector requires a trivial type");
+    static_assert(SIZE > 0, "FatVector requires inline storage");
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    FatVector() = default;
+
+    FatVector(const FatVector& other) { assign(other.begin(), other.end()); }
+
+    FatVector(FatVector&& other) noexcept { moveFrom(other); }
+
+    ~FatVector() { releaseHeap(); }
+
+    FatVector& operator=(const FatVector& other) {
+        if (this != &other) {
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    FatVector& operator=(FatVector&& other) noexcept {
+        if (this != &other) {
+            releaseHeap();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+    size_t capacity() const { return mCapacity; }
+    bool isInline() const { return mData == inlineData(); }
+
+    T* data() { return mData; }
+    const T* data() const { return mData; }
+
+    iterator begin() { return mData; }
+    iterator end() { return mData + mSize; }
+    const_iterator begin() const { return mData; }
+    const_iterator end() const { return mData + mSize; }
+
+    T& operator[](size_t i) { return mData[i]; }
+    const T& operator[](size_t i) const { return mData[i]; }
+    T& front() { return mData[0]; }
+    const T& front() const { return mData[0]; }
+    T& back() { return mData[mSize - 1]; }
+    const T& back() const { return mData[mSize - 1]; }
+
+    // Keeps the current allocation, so a cleared vector can be refilled
+    // without touching the heap.
+    void clear() { mSize = 0; }
+
+    void reserve(size_t capacity) {
+        if (capacity <= mCapacity) {
+            return;
+        }
+        T* data = static_cast<T*>(malloc(capacity * sizeof(T)));
+        LOG_ALWAYS_FATAL_IF(data == nullptr, "FatVector: out of memory (%zu elements)", capacity);
+        if (mSize) {
+            memcpy(static_cast<void*>(data), mData, mSize * sizeof(T));
+        }
+        releaseHeap();
+        mData = data;
+        mCapacity = capacity;
+    }
+
+    void push_back(const T& value) {
+        if (mSize == mCapacity) {
+            // value may alias our storage
+            const T copy = value;
+            grow(mSize + 1);
+            mData[mSize++] = copy;
+        } else {
+            mData[mSize++] = value;
+        }
+    }
+
+    void pop_back() { mSize--; }
+
+    iterator insert(const_iterator pos, const T& value) {
+        const size_t index = pos - mData;
+        const T copy = value;
+        if (mSize == mCapacity) {
+            grow(mSize + 1);
+        }
+        memmove(static_cast<void*>(mData + index + 1), mData + index,
+                (mSize - index) * sizeof(T));
+        mData[index] = copy;
+        mSize++;
+        return mData + index;
+    }
+
+    // [first, last) must not point into this vector
+    void append(const T* first, const T* last) {
+        const size_t count = last - first;
+        if (mSize + count > mCapacity) {
+            grow(mSize + count);
+        }
+        if (count) {
+            memcpy(static_cast<void*>(mData + mSize), first, count * sizeof(T));
+        }
+        mSize += count;
+    }
+
+    void assign(const T* first, const T* last) {
+        clear();
+        append(first, last);
+    }
+
+private:
+    T* inlineData() { return reinterpret_cast<T*>(mInline); }
+    const T* inlineData() const { return reinterpret_cast<const T*>(mInline); }
+
+    void grow(size_t minCapacity) { reserve(std::max(minCapacity, mCapacity * 2)); }
+
+    void releaseHeap() {
+        if (!isInline()) {
+            free(mData);
+            mData = inlineData();
+            mCapacity = SIZE;
+        }
+    }
+
+    // Expects this vector to be using its inline storage.
+    void moveFrom(FatVector& other) {
+        if (other.isInline()) {
+            mSize = 0;
+            append(other.begin(), other.end());
+        } else {
+            mData = other.mData;
+            mSize = other.mSize;
+            mCapacity = other.mCapacity;
+            other.mData = other.inlineData();
+            other.mCapacity = SIZE;
+        }
+        other.mSize = 0;
+    }
+
+    alignas(T) unsigned char mInline[SIZE * sizeof(T)];
+    T* mData = inlineData();
+    size_t mSize = 0;
+    size_t mCapacity = SIZE;
+};
+
+} // namespace android
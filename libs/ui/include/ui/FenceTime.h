@@ -26,6 +26,7 @@
 #include <mutex>
 #include <queue>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 
@@ -151,6 +152,9 @@ private:
 //
 // push() and updateSignalTimes() are safe to call simultaneously from
 // different threads.
+//
+// Once FenceResolver is enabled, pushed fences are handed to it, and
+// updateSignalTimes() only reads the times it has cached.
 class FenceTimeline {
 public:
     static constexpr size_t MAX_ENTRIES = 64;
@@ -159,8 +163,55 @@ public:
     void updateSignalTimes();
 
 private:
+    struct Entry {
+        std::weak_ptr<FenceTime> fence;
+        // FenceResolver will set the signal time, so it doesn't have to be
+        // asked for.
+        bool resolvedInBackground;
+    };
+
     mutable std::mutex mMutex;
-    std::queue<std::weak_ptr<FenceTime>> mQueue GUARDED_BY(mMutex);
+    std::queue<Entry> mQueue GUARDED_BY(mMutex);
+};
+
+// Resolves the signal times of the fences pushed to any FenceTimeline on a
+// background thread. The thread waits for all of them in a single poll() and
+// only asks for the signal time of a fence once it has signaled, so nobody
+// makes a syscall for a fence that is still pending, and the signal time is
+// only asked for once.
+//
+// Off by default, since it is only worth a thread in processes that keep
+// many fences in flight. It can't be disabled once enabled.
+class FenceResolver {
+public:
+    // Fences beyond this are left to their timelines to resolve.
+    static constexpr size_t MAX_ENTRIES = 1024;
+
+    static void enable();
+    static bool isEnabled();
+
+    // Returns true if the signal time of fence will be set in the
+    // background, which is only done for pending fences.
+    bool track(const std::shared_ptr<FenceTime>& fence);
+
+    static FenceResolver& getInstance();
+
+private:
+    struct Entry {
+        std::weak_ptr<FenceTime> fenceTime;
+        // Keeps the file descriptor that is being polled open.
+        sp<Fence> fence;
+    };
+
+    FenceResolver();
+    void threadMain();
+
+    static std::atomic_bool sEnabled;
+
+    const int mWakeFd;
+    std::mutex mMutex;
+    std::vector<Entry> mIncoming GUARDED_BY(mMutex);
+    size_t mTracked GUARDED_BY(mMutex) = 0;
 };
 
 // Used by test code to create or get FenceTimes for a given Fence.
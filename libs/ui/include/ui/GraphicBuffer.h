@@ -98,6 +98,14 @@ public:
             uint32_t inLayerCount, uint64_t inUsage,
             std::string requestorName = "<Unknown>");
 
+    // Allocates count GraphicBuffers with the same description, with a
+    // single allocator call where possible. This function is privileged, like
+    // the constructor above. On failure, outBuffers is left empty.
+    static status_t allocateMany(uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
+                                 uint32_t inLayerCount, uint64_t inUsage, uint32_t count,
+                                 std::string requestorName,
+                                 std::vector<sp<GraphicBuffer>>* outBuffers);
+
     // Create a GraphicBuffer from an existing handle.
     enum HandleWrapMethod : uint8_t {
         // Wrap and use the handle directly.  It assumes the handle has been
@@ -260,6 +268,11 @@ private:
             PixelFormat inFormat, uint32_t inLayerCount,
             uint64_t inUsage, std::string requestorName);
 
+    // Takes over a handle fresh from GraphicBufferAllocator.
+    void initWithAllocatedHandle(buffer_handle_t inHandle, uint32_t inWidth, uint32_t inHeight,
+                                 PixelFormat inFormat, uint32_t inLayerCount, uint64_t inUsage,
+                                 uint32_t inStride);
+
     status_t initWithHandle(const native_handle_t* inHandle, HandleWrapMethod method,
                             uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
                             uint32_t inLayerCount, uint64_t inUsage, uint32_t inStride);
@@ -20,8 +20,14 @@
 
 #include <stdint.h>
 
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <cutils/native_handle.h>
 
@@ -47,8 +53,35 @@ public:
             buffer_handle_t* handle, uint32_t* stride, uint64_t graphicBufferId,
             std::string requestorName);
 
+    struct AllocationResult {
+        status_t status;
+        buffer_handle_t handle;
+        uint32_t stride;
+    };
+
+    // Like allocate(), but the gralloc call is made on a worker thread, so
+    // the caller can do something else while it runs. Allocations the pool
+    // can satisfy are ready right away.
+    std::future<AllocationResult> allocateAsync(uint32_t w, uint32_t h, PixelFormat format,
+                                                uint32_t layerCount, uint64_t usage,
+                                                std::string requestorName);
+
+    // Allocates count buffers with the same description, in a single
+    // allocator call for those the pool can't supply. On failure, nothing is
+    // allocated.
+    status_t allocateMany(uint32_t w, uint32_t h, PixelFormat format, uint32_t layerCount,
+                          uint64_t usage, uint32_t count, buffer_handle_t* handles,
+                          uint32_t* strides, std::string requestorName);
+
     status_t free(buffer_handle_t handle);
 
+    // Keeps up to bytes worth of freed buffers around, so that allocating a
+    // buffer of the same size, format, layer count and usage again can reuse
+    // one without a gralloc call. The least recently freed buffers are
+    // released first. 0, the default, disables the pool.
+    void setPoolBudget(size_t bytes);
+
+    // Includes the buffers held by the pool.
     size_t getTotalSize() const;
 
     void dump(std::string& res) const;
@@ -66,15 +99,44 @@ private:
         std::string requestorName;
     };
 
+    struct pooled_buffer_t {
+        buffer_handle_t handle;
+        alloc_rec_t rec;
+    };
+
     static Mutex sLock;
     static KeyedVector<buffer_handle_t, alloc_rec_t> sAllocList;
+    // Most recently freed first
+    static std::list<pooled_buffer_t> sPool;
+    static size_t sPoolBytes;
+    static size_t sPoolBudget;
 
     friend class Singleton<GraphicBufferAllocator>;
     GraphicBufferAllocator();
     ~GraphicBufferAllocator();
 
+    // Moves a pooled buffer matching the request to sAllocList. Called with
+    // sLock held.
+    bool takeFromPoolLocked(uint32_t width, uint32_t height, PixelFormat format,
+                            uint32_t layerCount, uint64_t usage, buffer_handle_t* handle,
+                            uint32_t* stride, std::string& requestorName);
+    // Adds a buffer the allocator returned to sAllocList. Called with sLock
+    // held.
+    static void addAllocRecLocked(buffer_handle_t handle, uint32_t width, uint32_t height,
+                                  uint32_t stride, PixelFormat format, uint32_t layerCount,
+                                  uint64_t usage, std::string requestorName);
+    // Removes the least recently freed buffers until the pool fits its
+    // budget, returning the handles to free once sLock is released.
+    std::vector<buffer_handle_t> trimPoolLocked();
+    void asyncThreadMain();
+
     GraphicBufferMapper& mMapper;
     std::unique_ptr<const GrallocAllocator> mAllocator;
+
+    std::mutex mAsyncLock;
+    std::condition_variable mAsyncCondition;
+    std::deque<std::packaged_task<AllocationResult()>> mAsyncQueue;
+    bool mAsyncThreadStarted = false;
 };
 
 // ---------------------------------------------------------------------------
@@ -21,6 +21,10 @@
 #include <sys/types.h>
 
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <ui/PixelFormat.h>
 #include <utils/Singleton.h>
@@ -55,6 +59,15 @@ public:
             PixelFormat format, uint64_t usage, uint32_t stride,
             buffer_handle_t* outHandle);
 
+    // Like importBuffer() above, but bufferId, the id of the GraphicBuffer
+    // rawHandle came from, is used to find out whether the same buffer is
+    // already imported, in which case outHandle is that import and no gralloc
+    // call is made. Every import, shared or not, is freed with freeBuffer.
+    status_t importBuffer(buffer_handle_t rawHandle,
+            uint32_t width, uint32_t height, uint32_t layerCount,
+            PixelFormat format, uint64_t usage, uint32_t stride,
+            uint64_t bufferId, buffer_handle_t* outHandle);
+
     status_t freeBuffer(buffer_handle_t handle);
 
     void getTransportSize(buffer_handle_t handle,
@@ -94,11 +107,44 @@ public:
 private:
     friend class Singleton<GraphicBufferMapper>;
 
+    // A handle imported with a buffer id, shared by every import of the same
+    // buffer until the last one is freed.
+    struct SharedImport {
+        buffer_handle_t handle;
+        size_t refs;
+        // What the import was validated against. A buffer id comes from the
+        // sender and can be forged, so the raw handle's fds must refer to the
+        // same files, and its ints, which identify the buffer to gralloc,
+        // must match too.
+        uint32_t width;
+        uint32_t height;
+        uint32_t layerCount;
+        PixelFormat format;
+        uint64_t usage;
+        uint32_t stride;
+        std::vector<std::pair<dev_t, ino_t>> files;
+        std::vector<int> ints;
+    };
+
     GraphicBufferMapper();
 
+    // Gets the device and inode of every fd in rawHandle. Returns false if
+    // any of them can't be stat'ed.
+    static bool getFiles(buffer_handle_t rawHandle,
+                         std::vector<std::pair<dev_t, ino_t>>* outFiles);
+
+    static bool matches(const SharedImport& import, buffer_handle_t rawHandle,
+                        const std::vector<std::pair<dev_t, ino_t>>& files, uint32_t width,
+                        uint32_t height, uint32_t layerCount, PixelFormat format, uint64_t usage,
+                        uint32_t stride);
+
     std::unique_ptr<const GrallocMapper> mMapper;
 
     Version mMapperVersion;
+
+    std::mutex mSharedImportLock;
+    std::unordered_map<uint64_t, SharedImport> mSharedImports;
+    std::unordered_map<buffer_handle_t, uint64_t> mSharedImportIds;
 };
 
 // ---------------------------------------------------------------------------
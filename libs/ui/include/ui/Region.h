@@ -22,6 +22,7 @@
 
 #include <utils/Vector.h>
 
+#include <ui/FatVector.h>
 #include <ui/Rect.h>
 #include <utils/Flattenable.h>
 
@@ -39,17 +40,19 @@ public:
 
                         Region();
                         Region(const Region& rhs);
+                        Region(Region&& rhs) noexcept;
     explicit            Region(const Rect& rhs);
                         ~Region();
 
     static  Region      createTJunctionFreeRegion(const Region& r);
 
         Region& operator = (const Region& rhs);
+        Region& operator = (Region&& rhs) noexcept;
 
     inline  bool        isEmpty() const     { return getBounds().isEmpty(); }
     inline  bool        isRect() const      { return mStorage.size() == 1; }
 
-    inline  Rect        getBounds() const   { return mStorage[mStorage.size() - 1]; }
+    inline  Rect        getBounds() const   { return mStorage.back(); }
     inline  Rect        bounds() const      { return getBounds(); }
 
             bool        contains(const Point& point) const;
@@ -75,16 +78,16 @@ public:
             Region&     subtractSelf(const Region& rhs);
 
             // boolean operators
-    const   Region      merge(const Rect& rhs) const;
-    const   Region      mergeExclusive(const Rect& rhs) const;
-    const   Region      intersect(const Rect& rhs) const;
-    const   Region      subtract(const Rect& rhs) const;
+            Region      merge(const Rect& rhs) const;
+            Region      mergeExclusive(const Rect& rhs) const;
+            Region      intersect(const Rect& rhs) const;
+            Region      subtract(const Rect& rhs) const;
 
             // boolean operators
-    const   Region      merge(const Region& rhs) const;
-    const   Region      mergeExclusive(const Region& rhs) const;
-    const   Region      intersect(const Region& rhs) const;
-    const   Region      subtract(const Region& rhs) const;
+            Region      merge(const Region& rhs) const;
+            Region      mergeExclusive(const Region& rhs) const;
+            Region      intersect(const Region& rhs) const;
+            Region      subtract(const Region& rhs) const;
 
             // these translate rhs first
             Region&     translateSelf(int dx, int dy);
@@ -96,18 +99,18 @@ public:
 
 
             // these translate rhs first
-    const   Region      translate(int dx, int dy) const WARN_UNUSED;
-    const   Region      merge(const Region& rhs, int dx, int dy) const WARN_UNUSED;
-    const   Region      mergeExclusive(const Region& rhs, int dx, int dy) const WARN_UNUSED;
-    const   Region      intersect(const Region& rhs, int dx, int dy) const WARN_UNUSED;
-    const   Region      subtract(const Region& rhs, int dx, int dy) const WARN_UNUSED;
+            Region      translate(int dx, int dy) const WARN_UNUSED;
+            Region      merge(const Region& rhs, int dx, int dy) const WARN_UNUSED;
+            Region      mergeExclusive(const Region& rhs, int dx, int dy) const WARN_UNUSED;
+            Region      intersect(const Region& rhs, int dx, int dy) const WARN_UNUSED;
+            Region      subtract(const Region& rhs, int dx, int dy) const WARN_UNUSED;
 
     // convenience operators overloads
-    inline  const Region      operator | (const Region& rhs) const;
-    inline  const Region      operator ^ (const Region& rhs) const;
-    inline  const Region      operator & (const Region& rhs) const;
-    inline  const Region      operator - (const Region& rhs) const;
-    inline  const Region      operator + (const Point& pt) const;
+    inline  Region      operator | (const Region& rhs) const;
+    inline  Region      operator ^ (const Region& rhs) const;
+    inline  Region      operator & (const Region& rhs) const;
+    inline  Region      operator - (const Region& rhs) const;
+    inline  Region      operator + (const Point& pt) const;
 
     inline  Region&     operator |= (const Region& rhs);
     inline  Region&     operator ^= (const Region& rhs);
@@ -116,7 +119,8 @@ public:
     inline  Region&     operator += (const Point& pt);
 
 
-    // returns true if the regions share the same underlying storage
+    // returns true if the regions hold the same rects; this is a cheap
+    // comparison of the underlying storage, it does not normalize the regions
     bool isTriviallyEqual(const Region& region) const;
 
 
@@ -153,9 +157,9 @@ private:
     Region& operationSelf(const Rect& r, uint32_t op);
     Region& operationSelf(const Region& r, uint32_t op);
     Region& operationSelf(const Region& r, int dx, int dy, uint32_t op);
-    const Region operation(const Rect& rhs, uint32_t op) const;
-    const Region operation(const Region& rhs, uint32_t op) const;
-    const Region operation(const Region& rhs, int dx, int dy, uint32_t op) const;
+    Region operation(const Rect& rhs, uint32_t op) const;
+    Region operation(const Region& rhs, uint32_t op) const;
+    Region operation(const Region& rhs, int dx, int dy, uint32_t op) const;
 
     static void boolean_operation(uint32_t op, Region& dst,
             const Region& lhs, const Region& rhs, int dx, int dy);
@@ -167,6 +171,18 @@ private:
     static void boolean_operation(uint32_t op, Region& dst,
             const Region& lhs, const Rect& rhs);
 
+    static bool boolean_operation_fast(uint32_t op, Region& dst,
+            const Region& lhs, const Rect& rhsBounds, bool rhsIsRect);
+
+    void setEmpty();
+    void setRect(const Rect& r);
+
+    // Up to four rects plus the bounds are stored without allocating.
+    typedef FatVector<Rect, 5> Storage;
+
+    static void reverseRectsResolvingJunctions(const Rect* begin, const Rect* end,
+            Storage& dst, int spanDirection);
+
     static void translate(Region& reg, int dx, int dy);
     static void translate(Region& dst, const Region& reg, int dx, int dy);
 
@@ -177,23 +193,23 @@ private:
     // with an extra Rect as the last element which is set to the
     // bounds of the region. However, if the region is
     // a simple Rect then mStorage contains only that rect.
-    Vector<Rect> mStorage;
+    Storage mStorage;
 };
 
 
-const Region Region::operator | (const Region& rhs) const {
+Region Region::operator | (const Region& rhs) const {
     return merge(rhs);
 }
-const Region Region::operator ^ (const Region& rhs) const {
+Region Region::operator ^ (const Region& rhs) const {
     return mergeExclusive(rhs);
 }
-const Region Region::operator & (const Region& rhs) const {
+Region Region::operator & (const Region& rhs) const {
     return intersect(rhs);
 }
-const Region Region::operator - (const Region& rhs) const {
+Region Region::operator - (const Region& rhs) const {
     return subtract(rhs);
 }
-const Region Region::operator + (const Point& pt) const {
+Region Region::operator + (const Point& pt) const {
     return translate(pt.x, pt.y);
 }
 
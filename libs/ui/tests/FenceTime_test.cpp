@@ -0,0 +1,94 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "FenceTimeTest"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+#include <ui/FenceTime.h>
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+namespace {
+
+// Stands in for a fence: the read end of a pipe polls readable once something
+// is written to it. Asking it for a signal time fails, which resolves the
+// FenceTime to SIGNAL_TIME_INVALID.
+class PipeFence {
+public:
+    PipeFence() {
+        EXPECT_EQ(0, pipe(mFds));
+        mFenceTime = std::make_shared<FenceTime>(new Fence(mFds[0]));
+    }
+
+    ~PipeFence() { close(mFds[1]); }
+
+    void signal() { ASSERT_EQ(1, write(mFds[1], "s", 1)); }
+
+    const std::shared_ptr<FenceTime>& fenceTime() const { return mFenceTime; }
+
+private:
+    int mFds[2];
+    std::shared_ptr<FenceTime> mFenceTime;
+};
+
+bool waitUntilResolved(const std::shared_ptr<FenceTime>& fenceTime) {
+    for (int i = 0; i < 200; i++) {
+        if (fenceTime->getCachedSignalTime() != Fence::SIGNAL_TIME_PENDING) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+} // namespace
+
+TEST(FenceResolverTest, ResolvesOnlyAfterFenceSignals) {
+    FenceResolver::enable();
+    PipeFence first;
+    PipeFence second;
+    FenceTimeline timeline;
+    timeline.push(first.fenceTime());
+    timeline.push(second.fenceTime());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    timeline.updateSignalTimes();
+    EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, first.fenceTime()->getCachedSignalTime());
+    EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, second.fenceTime()->getCachedSignalTime());
+
+    second.signal();
+    EXPECT_TRUE(waitUntilResolved(second.fenceTime()));
+    EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, first.fenceTime()->getCachedSignalTime());
+
+    first.signal();
+    EXPECT_TRUE(waitUntilResolved(first.fenceTime()));
+    timeline.updateSignalTimes();
+}
+
+TEST(FenceResolverTest, DoesNotTrackResolvedFences) {
+    FenceResolver::enable();
+    auto resolved = std::make_shared<FenceTime>(123);
+    EXPECT_FALSE(FenceResolver::getInstance().track(resolved));
+    EXPECT_FALSE(FenceResolver::getInstance().track(FenceTime::NO_FENCE));
+}
+
+} // namespace android
@@ -16,8 +16,13 @@
 
 #define LOG_TAG "GraphicBufferTest"
 
+#include <unistd.h>
+
+#include <vector>
+
 #include <ui/BufferHubBuffer.h>
 #include <ui/GraphicBuffer.h>
+#include <ui/GraphicBufferAllocator.h>
 
 #include <gtest/gtest.h>
 
@@ -119,4 +124,147 @@ TEST_F(GraphicBufferTest, flattenAndUnflatten) {
     EXPECT_EQ(gb2->getGenerationNumber(), 42);
 }
 
+
+TEST_F(GraphicBufferTest, AllocatorPoolReusesFreedBuffer) {
+    GraphicBufferAllocator& allocator = GraphicBufferAllocator::get();
+    allocator.setPoolBudget(4 * 1024 * 1024);
+
+    buffer_handle_t handle;
+    uint32_t stride;
+    ASSERT_EQ(NO_ERROR,
+              allocator.allocate(64, 64, HAL_PIXEL_FORMAT_RGBA_8888, kTestLayerCount, kTestUsage,
+                                 &handle, &stride, 0, "GraphicBufferTest"));
+    const size_t totalSize = allocator.getTotalSize();
+    ASSERT_EQ(NO_ERROR, allocator.free(handle));
+    // Still allocated, just pooled
+    EXPECT_EQ(totalSize, allocator.getTotalSize());
+
+    buffer_handle_t reused;
+    uint32_t reusedStride;
+    ASSERT_EQ(NO_ERROR,
+              allocator.allocate(64, 64, HAL_PIXEL_FORMAT_RGBA_8888, kTestLayerCount, kTestUsage,
+                                 &reused, &reusedStride, 0, "GraphicBufferTest"));
+    EXPECT_EQ(handle, reused);
+    EXPECT_EQ(stride, reusedStride);
+
+    ASSERT_EQ(NO_ERROR, allocator.free(reused));
+    allocator.setPoolBudget(0);
+    EXPECT_EQ(totalSize - 64 * 4 * stride, allocator.getTotalSize());
+}
+
+TEST_F(GraphicBufferTest, AllocatorAllocatesAsync) {
+    GraphicBufferAllocator& allocator = GraphicBufferAllocator::get();
+    GraphicBufferAllocator::AllocationResult result =
+            allocator.allocateAsync(64, 64, HAL_PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                    kTestUsage, "GraphicBufferTest")
+                    .get();
+    ASSERT_EQ(NO_ERROR, result.status);
+    EXPECT_NE(nullptr, result.handle);
+    EXPECT_GE(result.stride, 64u);
+    EXPECT_EQ(NO_ERROR, allocator.free(result.handle));
+}
+
+TEST_F(GraphicBufferTest, AllocateMany) {
+    std::vector<sp<GraphicBuffer>> buffers;
+    ASSERT_EQ(NO_ERROR,
+              GraphicBuffer::allocateMany(64, 64, HAL_PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                          kTestUsage, 4, "GraphicBufferTest", &buffers));
+    ASSERT_EQ(4u, buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        const sp<GraphicBuffer>& gb = buffers[i];
+        EXPECT_EQ(NO_ERROR, gb->initCheck());
+        EXPECT_NE(nullptr, gb->handle);
+        EXPECT_EQ(64u, gb->getWidth());
+        EXPECT_EQ(64u, gb->getHeight());
+        EXPECT_GE(gb->getStride(), 64u);
+        EXPECT_EQ(kTestUsage, gb->getUsage());
+        for (size_t j = 0; j < i; j++) {
+            EXPECT_NE(buffers[j]->handle, gb->handle);
+            EXPECT_NE(buffers[j]->getId(), gb->getId());
+        }
+    }
+}
+
+
+TEST_F(GraphicBufferTest, UnflattenSharesImportOfSameBuffer) {
+    sp<GraphicBuffer> gb(new GraphicBuffer(64, 64, HAL_PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                           kTestUsage, "GraphicBufferTest"));
+    ASSERT_EQ(NO_ERROR, gb->initCheck());
+
+    std::vector<uint8_t> data(gb->getFlattenedSize());
+    std::vector<int> fds(gb->getFdCount());
+    void* dataStart = data.data();
+    int* fdsStart = fds.data();
+    size_t size = data.size();
+    size_t fdCount = fds.size();
+    ASSERT_EQ(NO_ERROR, gb->flatten(dataStart, size, fdsStart, fdCount));
+
+    // unflatten takes ownership of the fds it is given
+    auto unflatten = [&]() {
+        std::vector<int> dupFds;
+        for (int fd : fds) {
+            dupFds.push_back(dup(fd));
+        }
+        const void* unflattenData = data.data();
+        const int* unflattenFds = dupFds.data();
+        size_t unflattenSize = data.size();
+        size_t unflattenFdCount = dupFds.size();
+        sp<GraphicBuffer> out(new GraphicBuffer());
+        EXPECT_EQ(NO_ERROR,
+                  out->unflatten(unflattenData, unflattenSize, unflattenFds, unflattenFdCount));
+        return out;
+    };
+
+    sp<GraphicBuffer> first = unflatten();
+    sp<GraphicBuffer> second = unflatten();
+    EXPECT_EQ(first->handle, second->handle);
+
+    // The import stays usable until the last GraphicBuffer sharing it is gone
+    first.clear();
+    void* vaddr;
+    ASSERT_EQ(NO_ERROR, second->lock(GraphicBuffer::USAGE_SW_WRITE_OFTEN, &vaddr));
+    EXPECT_EQ(NO_ERROR, second->unlock());
+}
+
+TEST_F(GraphicBufferTest, UnflattenDoesNotShareImportForForgedId) {
+    sp<GraphicBuffer> gb(new GraphicBuffer(64, 64, HAL_PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                           kTestUsage, "GraphicBufferTest"));
+    ASSERT_EQ(NO_ERROR, gb->initCheck());
+    sp<GraphicBuffer> other(new GraphicBuffer(64, 64, HAL_PIXEL_FORMAT_RGBA_8888,
+                                              kTestLayerCount, kTestUsage, "GraphicBufferTest"));
+    ASSERT_EQ(NO_ERROR, other->initCheck());
+
+    auto unflatten = [](const sp<GraphicBuffer>& in, uint64_t id) {
+        std::vector<uint8_t> data(in->getFlattenedSize());
+        std::vector<int> fds(in->getFdCount());
+        void* dataStart = data.data();
+        int* fdsStart = fds.data();
+        size_t size = data.size();
+        size_t fdCount = fds.size();
+        EXPECT_EQ(NO_ERROR, in->flatten(dataStart, size, fdsStart, fdCount));
+
+        // Claim the given id, as a malicious sender could
+        int32_t* buf = reinterpret_cast<int32_t*>(data.data());
+        buf[7] = static_cast<int32_t>(id >> 32);
+        buf[8] = static_cast<int32_t>(id & 0xFFFFFFFFull);
+
+        std::vector<int> dupFds;
+        for (int fd : fds) {
+            dupFds.push_back(dup(fd));
+        }
+        const void* unflattenData = data.data();
+        const int* unflattenFds = dupFds.data();
+        size_t unflattenSize = data.size();
+        size_t unflattenFdCount = dupFds.size();
+        sp<GraphicBuffer> out(new GraphicBuffer());
+        EXPECT_EQ(NO_ERROR,
+                  out->unflatten(unflattenData, unflattenSize, unflattenFds, unflattenFdCount));
+        return out;
+    };
+
+    sp<GraphicBuffer> first = unflatten(gb, gb->getId());
+    sp<GraphicBuffer> forged = unflatten(other, gb->getId());
+    EXPECT_NE(first->handle, forged->handle);
+}
+
 } // namespace android
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+namespace android {
+namespace {
+
+// Builds a region of |spans| horizontal bands, each holding two rects, shaped
+// like the visible region of a stack of partially overlapping windows.
+Region makeRegion(int spans, int offset) {
+    Region r;
+    for (int i = 0; i < spans; i++) {
+        const int top = i * 10;
+        r.orSelf(Rect(offset, top, offset + 40, top + 10));
+        r.orSelf(Rect(offset + 50 + (i % 3) * 5, top, offset + 100, top + 10));
+    }
+    return r;
+}
+
+template <typename Op>
+void runRegionOp(benchmark::State& state, Op op) {
+    const Region lhs = makeRegion(state.range(0), 0);
+    const Region rhs = makeRegion(state.range(0), 20);
+    for (auto _ : state) {
+        Region result = op(lhs, rhs);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_RegionOr(benchmark::State& state) {
+    runRegionOp(state, [](const Region& lhs, const Region& rhs) { return lhs | rhs; });
+}
+BENCHMARK(BM_RegionOr)->RangeMultiplier(4)->Range(1, 256);
+
+void BM_RegionAnd(benchmark::State& state) {
+    runRegionOp(state, [](const Region& lhs, const Region& rhs) { return lhs & rhs; });
+}
+BENCHMARK(BM_RegionAnd)->RangeMultiplier(4)->Range(1, 256);
+
+void BM_RegionSubtract(benchmark::State& state) {
+    runRegionOp(state, [](const Region& lhs, const Region& rhs) { return lhs - rhs; });
+}
+BENCHMARK(BM_RegionSubtract)->RangeMultiplier(4)->Range(1, 256);
+
+void BM_RegionIntersectRect(benchmark::State& state) {
+    const Region lhs = makeRegion(state.range(0), 0);
+    const Rect rhs(10, 10, 60, 60);
+    for (auto _ : state) {
+        Region result = lhs.intersect(rhs);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegionIntersectRect)->RangeMultiplier(4)->Range(1, 256);
+
+void BM_RegionSingleRects(benchmark::State& state) {
+    const Region lhs(Rect(0, 0, 100, 100));
+    const Region rhs(Rect(50, 50, 150, 150));
+    for (auto _ : state) {
+        Region merged = lhs | rhs;
+        Region intersected = lhs & rhs;
+        Region subtracted = lhs - Region(Rect(200, 200, 300, 300));
+        benchmark::DoNotOptimize(merged);
+        benchmark::DoNotOptimize(intersected);
+        benchmark::DoNotOptimize(subtracted);
+    }
+    state.SetItemsProcessed(state.iterations() * 3);
+}
+BENCHMARK(BM_RegionSingleRects);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
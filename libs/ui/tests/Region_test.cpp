@@ -152,5 +152,127 @@ TEST_F(RegionTest, Random_TJunction) {
     }
 }
 
+TEST_F(RegionTest, SingleRectOperations) {
+    const Region a(Rect(0, 0, 10, 10));
+
+    // disjoint
+    EXPECT_TRUE(a.intersect(Rect(20, 20, 30, 30)).isEmpty());
+    EXPECT_EQ(Rect(0, 0, 10, 10), a.subtract(Rect(20, 20, 30, 30)).getBounds());
+
+    // overlapping
+    Region r = a.intersect(Rect(5, 5, 15, 15));
+    EXPECT_TRUE(r.isRect());
+    EXPECT_EQ(Rect(5, 5, 10, 10), r.getBounds());
+
+    // containing
+    EXPECT_TRUE(a.subtract(Rect(-1, -1, 11, 11)).isEmpty());
+    r = a.merge(Rect(2, 2, 8, 8));
+    EXPECT_TRUE(r.isRect());
+    EXPECT_EQ(Rect(0, 0, 10, 10), r.getBounds());
+    r = a.merge(Rect(-5, -5, 15, 15));
+    EXPECT_TRUE(r.isRect());
+    EXPECT_EQ(Rect(-5, -5, 15, 15), r.getBounds());
+
+    // adjacent rects merge into one
+    r = a.merge(Rect(10, 0, 20, 10));
+    EXPECT_TRUE(r.isRect());
+    EXPECT_EQ(Rect(0, 0, 20, 10), r.getBounds());
+    r = a.merge(Rect(0, 5, 10, 20));
+    EXPECT_TRUE(r.isRect());
+    EXPECT_EQ(Rect(0, 0, 10, 20), r.getBounds());
+
+    // general case still goes through the sweep
+    r = a.merge(Rect(5, 5, 15, 15));
+    EXPECT_EQ(3, r.end() - r.begin());
+    EXPECT_EQ(Rect(0, 0, 15, 15), r.getBounds());
+}
+
+TEST_F(RegionTest, EmptyOperands) {
+    const Region empty;
+    const Region a(Rect(0, 0, 10, 10));
+
+    EXPECT_TRUE(empty.intersect(a).isEmpty());
+    EXPECT_TRUE(empty.subtract(a).isEmpty());
+    EXPECT_TRUE(a.intersect(empty).isEmpty());
+    EXPECT_TRUE((a ^ a).isEmpty());
+    EXPECT_EQ(Rect(0, 0, 10, 10), empty.merge(a).getBounds());
+    EXPECT_EQ(Rect(0, 0, 10, 10), a.merge(empty).getBounds());
+    EXPECT_EQ(Rect(0, 0, 10, 10), a.subtract(empty).getBounds());
+    EXPECT_EQ(Rect(0, 0, 10, 10), empty.mergeExclusive(a).getBounds());
+}
+
+TEST_F(RegionTest, Random_MatchesPixelCoverage) {
+    srandom(54321);
+
+    auto randomRect = []() {
+        const int l = random() % X_MAX;
+        const int t = random() % Y_MAX;
+        return Rect(l, t, l + random() % (X_MAX - l + 1), t + random() % (Y_MAX - t + 1));
+    };
+    auto randomRegion = [&]() {
+        Region r;
+        for (int i = random() % 4; i >= 0; i--) {
+            r.orSelf(randomRect());
+        }
+        return r;
+    };
+
+    for (int iter = 0; iter < ITER_MAX; iter++) {
+        const Region a = randomRegion();
+        const Region b = (random() % 2) ? Region(randomRect()) : randomRegion();
+        const Region merged = a | b;
+        const Region intersected = a & b;
+        const Region subtracted = a - b;
+        const Region exclusive = a ^ b;
+        for (int x = 0; x < X_MAX; x++) {
+            for (int y = 0; y < Y_MAX; y++) {
+                const bool inA = a.contains(x, y);
+                const bool inB = b.contains(x, y);
+                EXPECT_EQ(inA || inB, merged.contains(x, y));
+                EXPECT_EQ(inA && inB, intersected.contains(x, y));
+                EXPECT_EQ(inA && !inB, subtracted.contains(x, y));
+                EXPECT_EQ(inA != inB, exclusive.contains(x, y));
+            }
+        }
+    }
+}
+
+TEST_F(RegionTest, MoveLeavesEmptyRegion) {
+    Region r;
+    // enough spans to spill out of the inline storage
+    for (int i = 0; i < 16; i++) {
+        r.orSelf(Rect(i * 2, i, i * 2 + 1, i + 1));
+    }
+    const Region copy(r);
+
+    Region moved(std::move(r));
+    EXPECT_TRUE(r.isEmpty());
+    EXPECT_TRUE(moved.isTriviallyEqual(copy));
+    EXPECT_TRUE((moved ^ copy).isEmpty());
+
+    Region assigned;
+    assigned = std::move(moved);
+    EXPECT_TRUE(moved.isEmpty());
+    EXPECT_TRUE((assigned ^ copy).isEmpty());
+
+    // moved-from regions remain usable
+    moved.orSelf(Rect(0, 0, 4, 4));
+    EXPECT_EQ(Rect(0, 0, 4, 4), moved.getBounds());
+}
+
+TEST_F(RegionTest, SelfOperations) {
+    Region r;
+    r.orSelf(Rect(0, 0, 10, 10));
+    r.orSelf(Rect(5, 5, 15, 15));
+    const Region copy(r);
+
+    r.orSelf(r);
+    EXPECT_TRUE((r ^ copy).isEmpty());
+    r.andSelf(r);
+    EXPECT_TRUE((r ^ copy).isEmpty());
+    r.subtractSelf(r);
+    EXPECT_TRUE(r.isEmpty());
+}
+
 }; // namespace android
 
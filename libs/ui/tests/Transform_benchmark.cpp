@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+namespace android {
+namespace {
+
+using ui::Transform;
+
+enum TransformKind { TRANSLATE, SCALE, ROT_90, GENERAL };
+
+// The kinds of transform layers usually have, plus a skewed one that takes
+// the general path.
+Transform makeTransform(int kind) {
+    Transform t;
+    switch (kind) {
+        case TRANSLATE:
+            break;
+        case SCALE:
+            t.set(2.0f, 0.0f, 0.0f, 0.5f);
+            break;
+        case ROT_90:
+            t.set(Transform::ROT_90, 1080, 1920);
+            break;
+        case GENERAL:
+            t.set(0.8f, 0.2f, -0.2f, 0.8f);
+            break;
+    }
+    t.set(t.tx() + 12.0f, t.ty() + 34.0f);
+    return t;
+}
+
+void BM_TransformRect(benchmark::State& state) {
+    const Transform t = makeTransform(state.range(0));
+    Rect bounds(10, 20, 300, 400);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bounds);
+        Rect result = t.transform(bounds);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransformRect)->DenseRange(TRANSLATE, GENERAL);
+
+void BM_TransformFloatRect(benchmark::State& state) {
+    const Transform t = makeTransform(state.range(0));
+    FloatRect bounds(10.5f, 20.5f, 300.5f, 400.5f);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bounds);
+        FloatRect result = t.transform(bounds);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransformFloatRect)->DenseRange(TRANSLATE, GENERAL);
+
+void BM_TransformInverse(benchmark::State& state) {
+    const Transform t = makeTransform(state.range(0));
+    for (auto _ : state) {
+        Transform result = t.inverse();
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransformInverse)->DenseRange(TRANSLATE, GENERAL);
+
+void BM_TransformRegion(benchmark::State& state) {
+    const Transform t = makeTransform(state.range(0));
+    Region region;
+    for (int i = 0; i < 32; i++) {
+        region.orSelf(Rect(i * 7, i * 10, i * 7 + 40, i * 10 + 10));
+    }
+    for (auto _ : state) {
+        Region result = t.transform(region);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransformRegion)->DenseRange(TRANSLATE, GENERAL);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -23,6 +23,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 namespace android {
 
 class ColorSpaceTest : public testing::Test {
@@ -180,4 +182,48 @@ TEST_F(ColorSpaceTest, LUT) {
 
 }
 
+TEST_F(ColorSpaceTest, LUTMatchesConnector) {
+    const uint32_t size = 9;
+    ColorSpace src(ColorSpace::sRGB());
+    ColorSpace dst(ColorSpace::ProPhotoRGB());
+    auto lut = ColorSpace::createLUT(size, src, dst);
+    ColorSpaceConnector connector(src, dst);
+
+    float m = 1.0f / float(size - 1);
+    const float3* data = lut.get();
+    for (uint32_t z = 0; z < size; z++) {
+        for (int32_t y = int32_t(size - 1); y >= 0; y--) {
+            for (uint32_t x = 0; x < size; x++) {
+                EXPECT_EQ(connector.transform({x * m, y * m, z * m}), *data++);
+            }
+        }
+    }
+}
+
+TEST_F(ColorSpaceTest, ConnectBatch) {
+    ColorSpaceConnector connector(ColorSpace::DisplayP3(), ColorSpace::BT2020());
+    std::vector<float3> in{{1.0f, 0.5f, 0.0f}, {0.0f, 0.0f, 0.0f}, {0.2f, 0.9f, 0.4f},
+                           {2.0f, -1.0f, 1.0f}};
+    std::vector<float3> out(in.size());
+    connector.transform(in.data(), out.data(), in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+        EXPECT_EQ(connector.transform(in[i]), out[i]);
+    }
+
+    // In place
+    connector.transform(in.data(), in.data(), in.size());
+    EXPECT_EQ(out, in);
+}
+
+TEST_F(ColorSpaceTest, SharedLUT) {
+    auto lut = ColorSpace::getLUT(17, ColorSpace::sRGB(), ColorSpace::AdobeRGB());
+    ASSERT_TRUE(lut != nullptr);
+    EXPECT_EQ(lut, ColorSpace::getLUT(17, ColorSpace::sRGB(), ColorSpace::AdobeRGB()));
+    EXPECT_NE(lut, ColorSpace::getLUT(9, ColorSpace::sRGB(), ColorSpace::AdobeRGB()));
+    EXPECT_NE(lut, ColorSpace::getLUT(17, ColorSpace::AdobeRGB(), ColorSpace::sRGB()));
+
+    auto r = lut.get()[0 * 17 * 17 + 8 * 17 + 16];
+    EXPECT_TRUE(all(lessThan(abs(r - float3{0.8912f, 0.4962f, 0.1164f}), float3{1e-4f})));
+}
+
 }; // namespace android
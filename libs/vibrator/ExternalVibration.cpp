@@ -43,7 +43,7 @@ ExternalVibration::ExternalVibration(int32_t uid, std::string pkg, const audio_a
 
 status_t ExternalVibration::writeToParcel(Parcel* parcel) const {
     parcel->writeInt32(mUid);
-    parcel->writeString16(String16(mPkg.c_str()));
+    parcel->writeUtf8AsUtf16(mPkg);
     writeAudioAttributes(mAttrs, parcel);
     parcel->writeStrongBinder(IInterface::asBinder(mController));
     parcel->writeStrongBinder(mToken);
@@ -51,8 +51,7 @@ status_t ExternalVibration::writeToParcel(Parcel* parcel) const {
 }
 status_t ExternalVibration::readFromParcel(const Parcel* parcel) {
     mUid = parcel->readInt32();
-    String8 pkgStr8 = String8(parcel->readString16());
-    mPkg = pkgStr8.c_str();
+    parcel->readUtf8FromUtf16(&mPkg);
     readAudioAttributes(&mAttrs, parcel);
     mController = IExternalVibrationController::asInterface(parcel->readStrongBinder());
     mToken = parcel->readStrongBinder();
@@ -5,6 +5,8 @@
 #include <log/log.h>
 #include <ui/GraphicBuffer.h>
 
+#include <vector>
+
 namespace android {
 namespace dvr {
 
@@ -37,6 +39,14 @@ class IonBuffer {
   int Alloc(uint32_t width, uint32_t height, uint32_t layer_count,
             uint32_t format, uint64_t usage);
 
+  // Allocates |count| native handles with the same parameters, using a single
+  // allocator call where possible, and replaces the contents of |buffers| with
+  // them. Returns 0 on success or a negative errno code otherwise, in which
+  // case nothing is allocated.
+  static int AllocMany(uint32_t width, uint32_t height, uint32_t layer_count,
+                       uint32_t format, uint64_t usage, size_t count,
+                       std::vector<IonBuffer>* buffers);
+
   // Resets the underlying native handle and parameters, freeing the previous
   // native handle if necessary.
   void Reset(buffer_handle_t handle, uint32_t width, uint32_t height,
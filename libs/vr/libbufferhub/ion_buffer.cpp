@@ -88,6 +88,33 @@ int IonBuffer::Alloc(uint32_t width, uint32_t height, uint32_t layer_count,
   }
 }
 
+int IonBuffer::AllocMany(uint32_t width, uint32_t height, uint32_t layer_count,
+                         uint32_t format, uint64_t usage, size_t count,
+                         std::vector<IonBuffer>* buffers) {
+  ATRACE_NAME("IonBuffer::AllocMany");
+  ALOGD_IF(TRACE,
+           "IonBuffer::AllocMany: width=%u height=%u layer_count=%u format=%u "
+           "usage=%" PRIx64 " count=%zu",
+           width, height, layer_count, format, usage, count);
+
+  std::vector<sp<GraphicBuffer>> graphic_buffers;
+  if (GraphicBuffer::allocateMany(width, height, format, layer_count, usage,
+                                  count, "<Unknown>",
+                                  &graphic_buffers) != OK) {
+    ALOGE("IonBuffer::AllocMany: Failed to allocate %zu buffers", count);
+    return -EINVAL;
+  }
+
+  buffers->clear();
+  buffers->reserve(count);
+  for (auto& graphic_buffer : graphic_buffers) {
+    IonBuffer buffer;
+    buffer.buffer_ = std::move(graphic_buffer);
+    buffers->push_back(std::move(buffer));
+  }
+  return 0;
+}
+
 void IonBuffer::Reset(buffer_handle_t handle, uint32_t width, uint32_t height,
                       uint32_t layer_count, uint32_t stride, uint32_t format,
                       uint64_t usage) {
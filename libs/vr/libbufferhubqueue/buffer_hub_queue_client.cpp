@@ -149,6 +149,8 @@ bool BufferHubQueue::WaitForBuffers(int timeout) {
 
   // Loop at least once to check for hangups.
   do {
+    EnqueueAvailableBuffers();
+
     ALOGD_IF(
         TRACE,
         "BufferHubQueue::WaitForBuffers: queue_id=%d count=%zu capacity=%zu",
@@ -229,6 +231,13 @@ Status<void> BufferHubQueue::HandleBufferEvent(size_t slot, int event_fd,
       id(), buffers_[slot]->id(), slot, event_fd, poll_events, events);
 
   if (events & EPOLLIN) {
+    // The buffer may have been enqueued from its shared state already, and
+    // even dequeued again, before this event was handled.
+    if (enqueued_slots_[slot] || !IsBufferAvailable(slot)) {
+      ALOGD_IF(TRACE, "%s: Ignoring stale event: slot=%zu", __FUNCTION__,
+               slot);
+      return {};
+    }
     return Enqueue({buffers_[slot], slot, buffers_[slot]->GetQueueIndex()});
   } else if (events & EPOLLHUP) {
     ALOGW(
@@ -329,6 +338,7 @@ Status<void> BufferHubQueue::RemoveBuffer(size_t slot) {
       on_buffer_removed_(buffers_[slot]);
 
     buffers_[slot] = nullptr;
+    enqueued_slots_[slot] = false;
     capacity_--;
   }
 
@@ -346,6 +356,7 @@ Status<void> BufferHubQueue::Enqueue(Entry entry) {
       unavailable_buffers_slot_.erase(enqueued_buffer_iter);
     }
 
+    enqueued_slots_[entry.slot] = true;
     available_buffers_.push(std::move(entry));
 
     // Trigger OnBufferAvailable callback if registered.
@@ -378,6 +389,7 @@ Status<std::shared_ptr<BufferHubBase>> BufferHubQueue::Dequeue(int timeout,
   *slot = entry.slot;
 
   available_buffers_.pop();
+  enqueued_slots_[*slot] = false;
   unavailable_buffers_slot_.push_back(*slot);
 
   return {std::move(buffer)};
@@ -396,6 +408,7 @@ pdx::Status<void> BufferHubQueue::FreeAllBuffers() {
   // Clear all available buffers.
   while (!available_buffers_.empty())
     available_buffers_.pop();
+  enqueued_slots_.fill(false);
 
   pdx::Status<void> last_error;  // No error.
   // Clear all buffers this producer queue is tracking.
@@ -564,6 +577,24 @@ Status<size_t> ProducerQueue::InsertBuffer(
   return {slot};
 }
 
+bool ProducerQueue::IsBufferAvailable(size_t slot) {
+  auto buffer = GetBuffer(slot);
+  return buffer && buffer->buffer_state() == 0U;
+}
+
+size_t ProducerQueue::EnqueueAvailableBuffers() {
+  size_t enqueued_count = 0;
+  for (size_t slot = 0; slot < kMaxQueueCapacity && !is_full(); slot++) {
+    if (enqueued_slots_[slot] || !IsBufferAvailable(slot))
+      continue;
+
+    auto buffer = GetBuffer(slot);
+    if (Enqueue({buffer, slot, buffer->GetQueueIndex()}))
+      enqueued_count++;
+  }
+  return enqueued_count;
+}
+
 Status<void> ProducerQueue::RemoveBuffer(size_t slot) {
   auto status =
       InvokeRemoteMethod<BufferHubRPC::ProducerQueueRemoveBuffer>(slot);
@@ -801,6 +832,12 @@ Status<std::shared_ptr<ConsumerBuffer>> ConsumerQueue::Dequeue(
   return {std::move(buffer)};
 }
 
+bool ConsumerQueue::IsBufferAvailable(size_t slot) {
+  auto buffer = GetBuffer(slot);
+  return buffer && BufferHubDefs::isClientPosted(buffer->buffer_state(),
+                                                 buffer->client_state_mask());
+}
+
 Status<void> ConsumerQueue::OnBufferAllocated() {
   ALOGD_IF(TRACE, "%s: queue_id=%d", __FUNCTION__, id());
 
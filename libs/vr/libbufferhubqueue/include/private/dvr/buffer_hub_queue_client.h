@@ -206,6 +206,16 @@ class BufferHubQueue : public pdx::Client {
   // Called when a buffer is allocated remotely.
   virtual pdx::Status<void> OnBufferAllocated() { return {}; }
 
+  // Returns whether the buffer in |slot| can be dequeued according to the
+  // buffer state in shared memory. Buffer events that arrive after the buffer
+  // has already changed state again are ignored based on this.
+  virtual bool IsBufferAvailable(size_t slot) = 0;
+
+  // Enqueues the buffers that the shared buffer state shows are available but
+  // whose buffer event has not been handled yet, so that they can be dequeued
+  // without waiting on the epoll set. Returns the number of buffers enqueued.
+  virtual size_t EnqueueAvailableBuffers() { return 0; }
+
   // Size of the metadata that buffers in this queue cary.
   size_t user_metadata_size_{0};
 
@@ -217,6 +227,9 @@ class BufferHubQueue : public pdx::Client {
   // the slot of posted or acquired buffers in the perspective of a producer.
   std::vector<size_t> unavailable_buffers_slot_;
 
+  // Whether the buffer in each slot has an entry in |available_buffers_|.
+  std::array<bool, kMaxQueueCapacity> enqueued_slots_{};
+
  private:
   void Initialize();
 
@@ -399,6 +412,14 @@ class ProducerQueue : public pdx::ClientBase<ProducerQueue, BufferHubQueue> {
   explicit ProducerQueue(pdx::LocalChannelHandle handle);
   ProducerQueue(const ProducerQueueConfig& config, const UsagePolicy& usage);
 
+  // A producer buffer is available once bufferhubd has seen every consumer
+  // release it and reset the buffer state to zero.
+  bool IsBufferAvailable(size_t slot) override;
+
+  // bufferhubd resets the buffer state before it signals the producer, so the
+  // released buffers can be taken from shared memory directly.
+  size_t EnqueueAvailableBuffers() override;
+
   // Dequeue a producer buffer to write. The returned buffer in |Gain|'ed mode,
   // and caller should call Post() once it's done writing to release the buffer
   // to the consumer side.
@@ -468,6 +489,12 @@ class ConsumerQueue : public BufferHubQueue {
                               size_t slot);
 
   pdx::Status<void> OnBufferAllocated() override;
+
+  // A consumer buffer is available while it is posted for this consumer.
+  // Consumers don't take posted buffers from shared memory ahead of their
+  // buffer event: bufferhubd tracks the post, acquire and release impulses
+  // per channel and would reject an acquire that overtakes the post.
+  bool IsBufferAvailable(size_t slot) override;
 };
 
 }  // namespace dvr
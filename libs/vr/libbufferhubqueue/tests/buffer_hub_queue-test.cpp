@@ -124,6 +124,35 @@ TEST_F(BufferHubQueueTest, TestDequeue) {
   }
 }
 
+TEST_F(BufferHubQueueTest, TestReleasedBufferIsDequeuedOnce) {
+  ASSERT_TRUE(CreateQueues(config_builder_.Build(), UsagePolicy{}));
+  AllocateBuffer();
+
+  size_t slot;
+  LocalHandle fence;
+  DvrNativeBufferMetadata mi, mo;
+
+  auto p1_status = producer_queue_->Dequeue(kTimeoutMs, &slot, &mo, &fence);
+  ASSERT_TRUE(p1_status.ok());
+  auto p1 = p1_status.take();
+  ASSERT_EQ(p1->PostAsync(&mi, LocalHandle()), 0);
+
+  auto c1_status = consumer_queue_->Dequeue(kTimeoutMs, &slot, &mo, &fence);
+  ASSERT_TRUE(c1_status.ok()) << c1_status.GetErrorMessage();
+  auto c1 = c1_status.take();
+  ASSERT_EQ(c1->ReleaseAsync(&mi, LocalHandle()), 0);
+
+  // The released buffer is picked up either from its shared buffer state or
+  // from its buffer event, but must not be handed out twice.
+  p1_status = producer_queue_->Dequeue(kTimeoutMs, &slot, &mo, &fence);
+  ASSERT_TRUE(p1_status.ok()) << p1_status.GetErrorMessage();
+  EXPECT_EQ(p1_status.take(), p1);
+
+  p1_status = producer_queue_->Dequeue(0, &slot, &mo, &fence);
+  EXPECT_FALSE(p1_status.ok());
+  EXPECT_EQ(ETIMEDOUT, p1_status.error());
+}
+
 TEST_F(BufferHubQueueTest,
        TestDequeuePostedBufferIfNoAvailableReleasedBuffer_withConsumerBuffer) {
   ASSERT_TRUE(CreateQueues(config_builder_.Build(), UsagePolicy{}));
@@ -11,6 +11,7 @@
 #include <pdx/rpc/argument_encoder.h>
 #include <pdx/rpc/message_buffer.h>
 #include <pdx/rpc/payload.h>
+#include <pdx/rpc/serializable.h>
 #include <pdx/utility.h>
 
 using namespace android::pdx::rpc;
@@ -403,6 +404,44 @@ class TestRunner {
   std::vector<TestEntry> tests_;
 };
 
+// The same pose, serialized member by member and as raw bytes, to compare the
+// two encodings of small structs.
+struct Pose {
+  float x, y, z;
+  float qx, qy, qz, qw;
+  uint32_t sequence;
+  int64_t timestamp_ns;
+
+  bool operator==(const Pose& other) const {
+    return x == other.x && y == other.y && z == other.z && qx == other.qx &&
+           qy == other.qy && qz == other.qz && qw == other.qw &&
+           sequence == other.sequence && timestamp_ns == other.timestamp_ns;
+  }
+  bool operator!=(const Pose& other) const { return !(*this == other); }
+
+ private:
+  PDX_SERIALIZABLE_MEMBERS(Pose, x, y, z, qx, qy, qz, qw, sequence,
+                           timestamp_ns);
+};
+
+struct TrivialPose {
+  float x, y, z;
+  float qx, qy, qz, qw;
+  uint32_t sequence;
+  int64_t timestamp_ns;
+
+  bool operator==(const TrivialPose& other) const {
+    return x == other.x && y == other.y && z == other.z && qx == other.qx &&
+           qy == other.qy && qz == other.qz && qw == other.qw &&
+           sequence == other.sequence && timestamp_ns == other.timestamp_ns;
+  }
+  bool operator!=(const TrivialPose& other) const { return !(*this == other); }
+
+ private:
+  PDX_SERIALIZABLE_TRIVIAL_MEMBERS(TrivialPose, x, y, z, qx, qy, qz, qw,
+                                   sequence, timestamp_ns);
+};
+
 std::string GenerateContainerName(const std::string& type, size_t count) {
   std::stringstream ss;
   ss << type << "(" << count << ")";
@@ -476,6 +515,18 @@ int main(int /*argc*/, char** /*argv*/) {
         std::move(test_map));
   }
 
+  const Pose pose{1.f, 2.f, 3.f, 0.f, 0.f, 0.f, 1.f, 42, 123456789};
+  const TrivialPose trivial_pose{1.f, 2.f, 3.f, 0.f, 0.f, 0.f, 1.f, 42,
+                                 123456789};
+  test_runner.AddTest("Pose", Pose{pose});
+  test_runner.AddTest("TrivialPose", TrivialPose{trivial_pose});
+  for (size_t len : {1, 8, 64}) {
+    test_runner.AddTest(GenerateContainerName("vector<Pose>", len),
+                        std::vector<Pose>(len, pose));
+    test_runner.AddTest(GenerateContainerName("vector<TrivialPose>", len),
+                        std::vector<TrivialPose>(len, trivial_pose));
+  }
+
   // BufferWrapper can't be used with deserialization tests right now because
   // it requires external buffer to be filled in, which is not available.
   std::vector<std::vector<uint8_t>> data_buffers;
@@ -112,6 +112,11 @@ typedef std::uint8_t EncodingType;
 enum EncodingExtType : int8_t {
   ENCODING_EXT_TYPE_FILE_DESCRIPTOR,
   ENCODING_EXT_TYPE_CHANNEL_HANDLE,
+  // The raw bytes of a trivially serializable object, or of an array of them.
+  // Peers that predate these versions of the format encode such objects and
+  // arrays member by member, which is still accepted when deserializing.
+  ENCODING_EXT_TYPE_TRIVIAL_OBJECT,
+  ENCODING_EXT_TYPE_TRIVIAL_ARRAY,
 };
 
 // Encoding predicates. Determines whether the given encoding is of a specific
@@ -271,6 +276,17 @@ inline constexpr bool IsFixextEncoding(EncodingType encoding) {
   }
 }
 
+inline constexpr bool IsExtEncoding(EncodingType encoding) {
+  switch (encoding) {
+    case ENCODING_TYPE_EXT8:
+    case ENCODING_TYPE_EXT16:
+    case ENCODING_TYPE_EXT32:
+      return true;
+    default:
+      return IsFixextEncoding(encoding);
+  }
+}
+
 inline constexpr bool IsFloat32Encoding(EncodingType encoding) {
   switch (encoding) {
     case ENCODING_TYPE_FLOAT32:
@@ -423,6 +439,15 @@ inline constexpr EncodingType EncodeStringType(std::size_t size) {
     return ENCODING_TYPE_STR32;
 }
 
+inline constexpr EncodingType EncodeExtType(std::size_t size) {
+  if (size < (1U << 8))
+    return ENCODING_TYPE_EXT8;
+  else if (size < (1U << 16))
+    return ENCODING_TYPE_EXT16;
+  else
+    return ENCODING_TYPE_EXT32;
+}
+
 inline constexpr EncodingType EncodeBinType(std::size_t size) {
   if (size < (1U << 8))
     return ENCODING_TYPE_BIN8;
@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <string>
 #include <tuple>
+#include <type_traits>
 
 #include <pdx/message_reader.h>
 #include <pdx/message_writer.h>
@@ -86,27 +87,77 @@ struct SerializableMembersType {
 //     };
 //
 // Note that const and static member serialization is not supported.
+//
+// Trivially copyable types with a fixed layout, such as plain structs of
+// numbers, may use PDX_SERIALIZABLE_TRIVIAL_MEMBERS(...) instead. Such types
+// are serialized as a copy of their bytes, and arrays of them as a single
+// block, which avoids encoding and decoding every member. The members are
+// still listed so that objects from peers that serialize the type member by
+// member can be deserialized. The listed members must take up the whole type,
+// with no padding, so that no uninitialized bytes are sent; a static_assert
+// checks this. Use this only when both ends of a channel share the same layout
+// of the type (the same ABI and endianness), and only after every peer that
+// deserializes the type understands the trivial encoding.
 
 template <typename T>
 class SerializableTraits {
  public:
   // Gets the serialized size of type T.
   static std::size_t GetSerializedSize(const T& value) {
-    return GetEncodingSize(EncodeArrayType(SerializableMembers::MemberCount)) +
-           GetMembersSize<SerializableMembers>(value);
+    return GetSerializedSize(value, IsTriviallySerializable<T>{});
   }
 
   // Serializes type T.
   static void SerializeObject(const T& value, MessageWriter* writer,
                               void*& buffer) {
+    SerializeObject(value, writer, buffer, IsTriviallySerializable<T>{});
+  }
+
+  // Deserializes type T.
+  static ErrorType DeserializeObject(T* value, MessageReader* reader,
+                                     const void*& start, const void* end) {
+    return DeserializeObject(value, reader, start, end,
+                             IsTriviallySerializable<T>{});
+  }
+
+ private:
+  using SerializableMembers = typename T::SerializableMembers;
+
+  static std::size_t GetSerializedSize(const T& value, std::false_type) {
+    return GetEncodingSize(EncodeArrayType(SerializableMembers::MemberCount)) +
+           GetMembersSize<SerializableMembers>(value);
+  }
+
+  static std::size_t GetSerializedSize(const T& /*value*/, std::true_type) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Types using PDX_SERIALIZABLE_TRIVIAL_MEMBERS must be "
+                  "trivially copyable.");
+    return GetTrivialSerializedSize(sizeof(T));
+  }
+
+  static void SerializeObject(const T& value, MessageWriter* writer,
+                              void*& buffer, std::false_type) {
     SerializeArrayEncoding(EncodeArrayType(SerializableMembers::MemberCount),
                            SerializableMembers::MemberCount, buffer);
     SerializeMembers<SerializableMembers>(value, writer, buffer);
   }
 
-  // Deserializes type T.
+  static void SerializeObject(const T& value, MessageWriter* /*writer*/,
+                              void*& buffer, std::true_type) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Types using PDX_SERIALIZABLE_TRIVIAL_MEMBERS must be "
+                  "trivially copyable.");
+    static_assert(IsPaddingFree<T>::value,
+                  "Types using PDX_SERIALIZABLE_TRIVIAL_MEMBERS must not have "
+                  "padding or members that are not serialized.");
+    SerializeExtEncoding(EncodeExtType(sizeof(T)),
+                         ENCODING_EXT_TYPE_TRIVIAL_OBJECT, sizeof(T), buffer);
+    WriteRawData(buffer, &value, sizeof(T));
+  }
+
   static ErrorType DeserializeObject(T* value, MessageReader* reader,
-                                     const void*& start, const void* end) {
+                                     const void*& start, const void* end,
+                                     std::false_type) {
     EncodingType encoding;
     std::size_t size;
 
@@ -120,8 +171,30 @@ class SerializableTraits {
     }
   }
 
- private:
-  using SerializableMembers = typename T::SerializableMembers;
+  // Accepts both the trivial encoding and the member by member encoding.
+  static ErrorType DeserializeObject(T* value, MessageReader* reader,
+                                     const void*& start, const void* end,
+                                     std::true_type) {
+    if (!IsNextExtEncoding(start, end))
+      return DeserializeObject(value, reader, start, end, std::false_type{});
+
+    EncodingType encoding;
+    EncodingExtType type;
+    std::size_t size;
+
+    if (const auto error =
+            DeserializeExtType(&encoding, &type, &size, reader, start, end)) {
+      return error;
+    } else if (type != ENCODING_EXT_TYPE_TRIVIAL_OBJECT) {
+      return ErrorType(ErrorCode::UNEXPECTED_ENCODING,
+                       ENCODING_CLASS_EXTENSION, encoding);
+    } else if (size != sizeof(T)) {
+      return ErrorType(ErrorCode::UNEXPECTED_TYPE_SIZE,
+                       ENCODING_CLASS_EXTENSION, encoding);
+    } else {
+      return ReadRawData(value, reader, start, end, sizeof(T));
+    }
+  }
 };
 
 // Utility macro to define a MemberPointer type for a member name.
@@ -143,6 +216,16 @@ class SerializableTraits {
   using SerializableMembers = ::android::pdx::rpc::SerializableMembersType< \
       type, PDX_MEMBERS(type, __VA_ARGS__)>
 
+// Like PDX_SERIALIZABLE_MEMBERS(...), for trivially copyable types that are
+// serialized as a copy of their bytes, as described above.
+#define PDX_SERIALIZABLE_TRIVIAL_MEMBERS(type, ... /*members*/) \
+  template <typename, typename>                                 \
+  friend struct ::android::pdx::rpc::IsTriviallySerializable;   \
+  template <typename, typename>                                 \
+  friend struct ::android::pdx::rpc::IsPaddingFree;             \
+  using SerializeTrivially = std::true_type;                    \
+  PDX_SERIALIZABLE_MEMBERS(type, __VA_ARGS__)
+
 }  // namespace rpc
 }  // namespace pdx
 }  // namespace android
@@ -59,6 +59,8 @@ namespace rpc {
 //   * BufferWrapper of any POD type.
 //   * StringWrapper of any supported char type.
 //   * User types with correctly defined SerializableMembers member type.
+//   * Trivially copyable user types that opt in to serialization as raw bytes
+//     with PDX_SERIALIZABLE_TRIVIAL_MEMBERS, and arrays of them.
 //
 // Planned support for:
 //   * std::basic_string with all supported char types.
@@ -106,6 +108,56 @@ template <typename T>
 using EnableIfHasSerializableMembers =
     typename std::enable_if<HasSerializableMembers<T>::value>::type;
 
+// Determines whether type T has serializable members and opted in to being
+// serialized as its raw bytes, with a member type named SerializeTrivially.
+template <typename, typename = void>
+struct IsTriviallySerializable : std::false_type {};
+template <typename T>
+struct IsTriviallySerializable<
+    T, TrySerializableMembersType<typename T::SerializeTrivially>>
+    : std::integral_constant<bool, HasSerializableMembers<T>::value &&
+                                       T::SerializeTrivially::value> {};
+
+// Determines whether every byte of type T is part of its value, so that a raw
+// copy of it carries no padding, which may hold stale memory contents. Unlike
+// std::has_unique_object_representations, float and double are accepted: they
+// have several representations of some values, but no padding. Trivially
+// serializable types qualify when their members are padding free and take up
+// all of their size.
+template <typename, typename = void>
+struct IsPaddingFree;
+
+template <typename Members>
+struct IsPaddingFreeMembers : std::false_type {};
+template <typename T, typename... MemberPointers>
+struct IsPaddingFreeMembers<SerializableMembersType<T, MemberPointers...>>
+    : std::integral_constant<
+          bool,
+          (0 + ... + sizeof(std::remove_reference_t<decltype(
+                         MemberPointers::Resolve(std::declval<T&>()))>)) ==
+                  sizeof(T) &&
+              (true && ... &&
+               IsPaddingFree<std::remove_reference_t<decltype(
+                   MemberPointers::Resolve(std::declval<T&>()))>>::value)> {};
+
+template <typename T, typename>
+struct IsPaddingFree
+    : std::integral_constant<
+          bool, std::has_unique_object_representations<T>::value ||
+                    std::is_same<T, float>::value ||
+                    std::is_same<T, double>::value> {};
+template <typename T, std::size_t Size>
+struct IsPaddingFree<T[Size]> : IsPaddingFree<T> {};
+template <typename T, std::size_t Size>
+struct IsPaddingFree<std::array<T, Size>>
+    : std::integral_constant<bool, sizeof(std::array<T, Size>) ==
+                                           Size * sizeof(T) &&
+                                       IsPaddingFree<T>::value> {};
+template <typename T>
+struct IsPaddingFree<
+    T, typename std::enable_if<IsTriviallySerializable<T>::value>::type>
+    : IsPaddingFreeMembers<typename T::SerializableMembers> {};
+
 // Utility to simplify overload enable expressions for enum types.
 template <typename T, typename ReturnType = void>
 using EnableIfEnum =
@@ -343,15 +395,36 @@ inline constexpr std::size_t GetSerializedSize(
   return GetEncodingSize(EncodeType(channel_handle)) + sizeof(std::int32_t);
 }
 
-// Overload for standard vector types.
-template <typename T, typename Allocator>
-inline std::size_t GetSerializedSize(const std::vector<T, Allocator>& v) {
+// Gets the size of a trivially serializable object or array with a payload of
+// the given size, encoded as an extension type.
+inline constexpr std::size_t GetTrivialSerializedSize(std::size_t size) {
+  return GetEncodingSize(EncodeExtType(size)) + sizeof(EncodingExtType) + size;
+}
+
+// Gets the size of array types with elements that are serialized one by one.
+template <typename ArrayType>
+inline std::size_t GetArraySize(const ArrayType& v, std::false_type) {
+  using T = typename ArrayType::value_type;
   return std::accumulate(v.begin(), v.end(), GetEncodingSize(EncodeType(v)),
                          [](const std::size_t& sum, const T& object) {
                            return sum + GetSerializedSize(object);
                          });
 }
 
+// Gets the size of array types with trivially serializable elements, which are
+// serialized together as one block of raw bytes.
+template <typename ArrayType>
+inline std::size_t GetArraySize(const ArrayType& v, std::true_type) {
+  return GetTrivialSerializedSize(v.size() *
+                                  sizeof(typename ArrayType::value_type));
+}
+
+// Overload for standard vector types.
+template <typename T, typename Allocator>
+inline std::size_t GetSerializedSize(const std::vector<T, Allocator>& v) {
+  return GetArraySize(v, IsTriviallySerializable<T>{});
+}
+
 // Overload for standard map types.
 template <typename Key, typename T, typename Compare, typename Allocator>
 inline std::size_t GetSerializedSize(
@@ -380,19 +453,13 @@ inline std::size_t GetSerializedSize(
 // Overload for ArrayWrapper types.
 template <typename T>
 inline std::size_t GetSerializedSize(const ArrayWrapper<T>& v) {
-  return std::accumulate(v.begin(), v.end(), GetEncodingSize(EncodeType(v)),
-                         [](const std::size_t& sum, const T& object) {
-                           return sum + GetSerializedSize(object);
-                         });
+  return GetArraySize(v, IsTriviallySerializable<T>{});
 }
 
 // Overload for std::array types.
 template <typename T, std::size_t Size>
 inline std::size_t GetSerializedSize(const std::array<T, Size>& v) {
-  return std::accumulate(v.begin(), v.end(), GetEncodingSize(EncodeType(v)),
-                         [](const std::size_t& sum, const T& object) {
-                           return sum + GetSerializedSize(object);
-                         });
+  return GetArraySize(v, IsTriviallySerializable<T>{});
 }
 
 // Overload for std::pair.
@@ -961,15 +1028,38 @@ inline void SerializeObject(const StringWrapper<T>& s,
   SerializeString(s, buffer);
 }
 
-// Serializes the payload of array types.
+// Serializes array types with elements that are serialized one by one.
 template <typename ArrayType>
 inline void SerializeArray(const ArrayType& v, MessageWriter* writer,
-                           void*& buffer) {
+                           void*& buffer, std::false_type) {
   SerializeType(v, buffer);
   for (const auto& element : v)
     SerializeObject(element, writer, buffer);
 }
 
+// Serializes array types with trivially serializable elements as one block of
+// raw bytes.
+template <typename ArrayType>
+inline void SerializeArray(const ArrayType& v, MessageWriter* /*writer*/,
+                           void*& buffer, std::true_type) {
+  static_assert(IsPaddingFree<typename ArrayType::value_type>::value,
+                "Types using PDX_SERIALIZABLE_TRIVIAL_MEMBERS must not have "
+                "padding or members that are not serialized.");
+  const std::size_t size = v.size() * sizeof(typename ArrayType::value_type);
+  SerializeExtEncoding(EncodeExtType(size), ENCODING_EXT_TYPE_TRIVIAL_ARRAY,
+                       size, buffer);
+  WriteRawData(buffer, v.data(), size);
+}
+
+// Serializes the payload of array types.
+template <typename ArrayType>
+inline void SerializeArray(const ArrayType& v, MessageWriter* writer,
+                           void*& buffer) {
+  SerializeArray(
+      v, writer, buffer,
+      IsTriviallySerializable<typename ArrayType::value_type>{});
+}
+
 // Serializes the payload for map types.
 template <typename MapType>
 inline void SerializeMap(const MapType& v, MessageWriter* writer,
@@ -1712,11 +1802,46 @@ inline ErrorType DeserializeMapType(EncodingType* encoding, std::size_t* size,
   }
 }
 
-// Overload for std::vector types.
+// Determines whether the next value in the buffer has an extension encoding,
+// without consuming it.
+inline bool IsNextExtEncoding(const void* start, const void* end) {
+  return start < end && IsExtEncoding(*static_cast<const EncodingType*>(start));
+}
+
+// Deserializes the type code and size of an array of trivially serializable
+// elements of type T, returning the number of elements in |count|.
+template <typename T>
+inline ErrorType DeserializeTrivialArrayType(std::size_t* count,
+                                             MessageReader* reader,
+                                             const void*& start,
+                                             const void*& end) {
+  EncodingType encoding;
+  EncodingExtType type;
+  std::size_t size;
+
+  if (const auto error =
+          DeserializeExtType(&encoding, &type, &size, reader, start, end)) {
+    return error;
+  } else if (type != ENCODING_EXT_TYPE_TRIVIAL_ARRAY) {
+    return ErrorType(ErrorCode::UNEXPECTED_ENCODING, ENCODING_CLASS_EXTENSION,
+                     encoding);
+  } else if (size % sizeof(T) != 0) {
+    return ErrorType(ErrorCode::UNEXPECTED_TYPE_SIZE, ENCODING_CLASS_EXTENSION,
+                     encoding);
+  } else if (static_cast<std::size_t>(PointerDistance(end, start)) < size) {
+    // Check before the caller allocates room for the elements.
+    return ErrorCode::INSUFFICIENT_BUFFER;
+  } else {
+    *count = size / sizeof(T);
+    return ErrorCode::NO_ERROR;
+  }
+}
+
+// Deserializes std::vector types with elements that are serialized one by one.
 template <typename T, typename Allocator>
-inline ErrorType DeserializeObject(std::vector<T, Allocator>* value,
+inline ErrorType DeserializeVector(std::vector<T, Allocator>* value,
                                    MessageReader* reader, const void*& start,
-                                   const void*& end) {
+                                   const void*& end, std::false_type) {
   EncodingType encoding;
   std::size_t size;
 
@@ -1724,24 +1849,47 @@ inline ErrorType DeserializeObject(std::vector<T, Allocator>* value,
           DeserializeArrayType(&encoding, &size, reader, start, end))
     return error;
 
-  std::vector<T, Allocator> result(size);
+  // Deserialize in place so that a reused vector keeps its capacity. On error
+  // the contents of |value| are unspecified.
+  value->clear();
+  value->resize(size);
   for (std::size_t i = 0; i < size; i++) {
-    if (const auto error = DeserializeObject(&result[i], reader, start, end))
+    if (const auto error = DeserializeObject(&(*value)[i], reader, start, end))
       return error;
   }
+  return ErrorCode::NO_ERROR;
+}
+
+// Deserializes std::vector types with trivially serializable elements. Arrays
+// serialized one element at a time by older peers are accepted as well.
+template <typename T, typename Allocator>
+inline ErrorType DeserializeVector(std::vector<T, Allocator>* value,
+                                   MessageReader* reader, const void*& start,
+                                   const void*& end, std::true_type) {
+  if (!IsNextExtEncoding(start, end))
+    return DeserializeVector(value, reader, start, end, std::false_type{});
+
+  std::size_t count;
+  if (const auto error =
+          DeserializeTrivialArrayType<T>(&count, reader, start, end))
+    return error;
+
+  std::vector<T, Allocator> result(count);
+  if (const auto error =
+          ReadRawData(result.data(), reader, start, end, count * sizeof(T)))
+    return error;
 
   *value = std::move(result);
   return ErrorCode::NO_ERROR;
+}
 
-// TODO(eieio): Consider the benefits and trade offs of this alternative.
-#if 0
-  value->resize(size);
-  for (std::size_t i = 0; i < size; i++) {
-    if (const auto error = DeserializeObject(&(*value)[i], reader, start, end))
-      return error;
-  }
-  return ErrorCode::NO_ERROR;
-#endif
+// Overload for std::vector types.
+template <typename T, typename Allocator>
+inline ErrorType DeserializeObject(std::vector<T, Allocator>* value,
+                                   MessageReader* reader, const void*& start,
+                                   const void*& end) {
+  return DeserializeVector(value, reader, start, end,
+                           IsTriviallySerializable<T>{});
 }
 
 // Deserializes an EmptyVariant value.
@@ -1836,11 +1984,12 @@ inline ErrorType DeserializeObject(
   return DeserializeMap(value, reader, start, end);
 }
 
-// Overload for ArrayWrapper types.
+// Deserializes ArrayWrapper types with elements that are serialized one by one.
 template <typename T>
-inline ErrorType DeserializeObject(ArrayWrapper<T>* value,
-                                   MessageReader* reader, const void*& start,
-                                   const void*& end) {
+inline ErrorType DeserializeArrayWrapper(ArrayWrapper<T>* value,
+                                         MessageReader* reader,
+                                         const void*& start, const void*& end,
+                                         std::false_type) {
   EncodingType encoding;
   std::size_t size;
 
@@ -1865,11 +2014,49 @@ inline ErrorType DeserializeObject(ArrayWrapper<T>* value,
   return ErrorCode::NO_ERROR;
 }
 
-// Overload for std::array types.
-template <typename T, std::size_t Size>
-inline ErrorType DeserializeObject(std::array<T, Size>* value,
+// Deserializes ArrayWrapper types with trivially serializable elements. Arrays
+// serialized one element at a time by older peers are accepted as well.
+template <typename T>
+inline ErrorType DeserializeArrayWrapper(ArrayWrapper<T>* value,
+                                         MessageReader* reader,
+                                         const void*& start, const void*& end,
+                                         std::true_type) {
+  if (!IsNextExtEncoding(start, end)) {
+    return DeserializeArrayWrapper(value, reader, start, end,
+                                   std::false_type{});
+  }
+
+  std::size_t count;
+  if (const auto error =
+          DeserializeTrivialArrayType<T>(&count, reader, start, end)) {
+    return error;
+  }
+
+  // Try to resize the wrapper.
+  value->resize(count);
+
+  // Make sure there is enough space in the ArrayWrapper for the
+  // payload.
+  if (count > value->capacity())
+    return ErrorCode::INSUFFICIENT_DESTINATION_SIZE;
+
+  return ReadRawData(value->data(), reader, start, end, count * sizeof(T));
+}
+
+// Overload for ArrayWrapper types.
+template <typename T>
+inline ErrorType DeserializeObject(ArrayWrapper<T>* value,
                                    MessageReader* reader, const void*& start,
                                    const void*& end) {
+  return DeserializeArrayWrapper(value, reader, start, end,
+                                 IsTriviallySerializable<T>{});
+}
+
+// Deserializes std::array types with elements that are serialized one by one.
+template <typename T, std::size_t Size>
+inline ErrorType DeserializeStdArray(std::array<T, Size>* value,
+                                     MessageReader* reader, const void*& start,
+                                     const void*& end, std::false_type) {
   EncodingType encoding;
   std::size_t size;
 
@@ -1889,6 +2076,36 @@ inline ErrorType DeserializeObject(std::array<T, Size>* value,
   return ErrorCode::NO_ERROR;
 }
 
+// Deserializes std::array types with trivially serializable elements. Arrays
+// serialized one element at a time by older peers are accepted as well.
+template <typename T, std::size_t Size>
+inline ErrorType DeserializeStdArray(std::array<T, Size>* value,
+                                     MessageReader* reader, const void*& start,
+                                     const void*& end, std::true_type) {
+  if (!IsNextExtEncoding(start, end))
+    return DeserializeStdArray(value, reader, start, end, std::false_type{});
+
+  std::size_t count;
+  if (const auto error =
+          DeserializeTrivialArrayType<T>(&count, reader, start, end)) {
+    return error;
+  }
+
+  if (count != Size)
+    return ErrorCode::INSUFFICIENT_DESTINATION_SIZE;
+
+  return ReadRawData(value->data(), reader, start, end, Size * sizeof(T));
+}
+
+// Overload for std::array types.
+template <typename T, std::size_t Size>
+inline ErrorType DeserializeObject(std::array<T, Size>* value,
+                                   MessageReader* reader, const void*& start,
+                                   const void*& end) {
+  return DeserializeStdArray(value, reader, start, end,
+                             IsTriviallySerializable<T>{});
+}
+
 // Deserializes std::pair types.
 template <typename T, typename U>
 inline ErrorType DeserializeObject(std::pair<T, U>* value,
@@ -80,6 +80,19 @@ struct TestTemplateType {
   PDX_SERIALIZABLE_MEMBERS(TestTemplateType<FileHandleType>, fd);
 };
 
+struct TestTrivialType {
+  std::uint8_t a;
+  std::uint8_t b;
+  std::uint8_t c;
+
+  bool operator==(const TestTrivialType& other) const {
+    return a == other.a && b == other.b && c == other.c;
+  }
+
+ private:
+  PDX_SERIALIZABLE_TRIVIAL_MEMBERS(TestTrivialType, a, b, c);
+};
+
 // Utilities to generate test maps and payloads.
 template <typename MapType>
 MapType MakeMap(std::size_t size) {
@@ -1233,6 +1246,40 @@ TEST(SerializationTest, Serializable) {
   EXPECT_EQ(expected, result);
 }
 
+TEST(SerializationTest, TrivialSerializable) {
+  Payload result;
+  Payload expected;
+
+  TestTrivialType t1{1, 2, 3};
+  Serialize(t1, &result);
+  expected = decltype(expected)(
+      {ENCODING_TYPE_EXT8, 3, ENCODING_EXT_TYPE_TRIVIAL_OBJECT, 1, 2, 3});
+  EXPECT_EQ(expected, result);
+  EXPECT_EQ(expected.Size(), GetSerializedSize(t1));
+  result.Clear();
+
+  // Arrays are serialized as one block.
+  std::vector<TestTrivialType> v = {{1, 2, 3}, {4, 5, 6}};
+  Serialize(v, &result);
+  expected = decltype(expected)({ENCODING_TYPE_EXT8, 6,
+                                 ENCODING_EXT_TYPE_TRIVIAL_ARRAY, 1, 2, 3, 4,
+                                 5, 6});
+  EXPECT_EQ(expected, result);
+  EXPECT_EQ(expected.Size(), GetSerializedSize(v));
+  result.Clear();
+
+  std::array<TestTrivialType, 2> a = {{{1, 2, 3}, {4, 5, 6}}};
+  Serialize(a, &result);
+  EXPECT_EQ(expected, result);
+  result.Clear();
+
+  v.clear();
+  Serialize(v, &result);
+  expected = decltype(expected)(
+      {ENCODING_TYPE_EXT8, 0, ENCODING_EXT_TYPE_TRIVIAL_ARRAY});
+  EXPECT_EQ(expected, result);
+}
+
 TEST(SerializationTest, Variant) {
   Payload result;
   Payload expected;
@@ -2365,6 +2412,71 @@ TEST(DeserializationTest, Serializable) {
   EXPECT_EQ(TestTemplateType<LocalHandle>(LocalHandle(-1)), tt);
 }
 
+TEST(DeserializationTest, TrivialSerializable) {
+  Payload buffer;
+  ErrorType error;
+
+  buffer = decltype(buffer)(
+      {ENCODING_TYPE_EXT8, 3, ENCODING_EXT_TYPE_TRIVIAL_OBJECT, 1, 2, 3});
+  TestTrivialType t1;
+  error = Deserialize(&t1, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(TestTrivialType({1, 2, 3}), t1);
+
+  // The member by member encoding is still accepted.
+  buffer = decltype(buffer)({ENCODING_TYPE_FIXARRAY_MIN + 3, 4, 5, 6});
+  error = Deserialize(&t1, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(TestTrivialType({4, 5, 6}), t1);
+
+  buffer = decltype(buffer)(
+      {ENCODING_TYPE_EXT8, 2, ENCODING_EXT_TYPE_TRIVIAL_OBJECT, 1, 2});
+  error = Deserialize(&t1, &buffer);
+  EXPECT_EQ(ErrorCode::UNEXPECTED_TYPE_SIZE, error);
+
+  std::vector<TestTrivialType> v;
+  const std::vector<TestTrivialType> expected_v = {{1, 2, 3}, {4, 5, 6}};
+  buffer = decltype(buffer)({ENCODING_TYPE_EXT8, 6,
+                             ENCODING_EXT_TYPE_TRIVIAL_ARRAY, 1, 2, 3, 4, 5,
+                             6});
+  error = Deserialize(&v, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(expected_v, v);
+
+  buffer = decltype(buffer)({ENCODING_TYPE_FIXARRAY_MIN + 2,
+                             ENCODING_TYPE_FIXARRAY_MIN + 3, 1, 2, 3,
+                             ENCODING_TYPE_FIXARRAY_MIN + 3, 4, 5, 6});
+  v.clear();
+  error = Deserialize(&v, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(expected_v, v);
+
+  buffer = decltype(buffer)({ENCODING_TYPE_EXT8, 6,
+                             ENCODING_EXT_TYPE_TRIVIAL_ARRAY, 1, 2, 3, 4, 5});
+  error = Deserialize(&v, &buffer);
+  EXPECT_EQ(ErrorCode::INSUFFICIENT_BUFFER, error);
+
+  buffer = decltype(buffer)({ENCODING_TYPE_EXT8, 5,
+                             ENCODING_EXT_TYPE_TRIVIAL_ARRAY, 1, 2, 3, 4, 5});
+  error = Deserialize(&v, &buffer);
+  EXPECT_EQ(ErrorCode::UNEXPECTED_TYPE_SIZE, error);
+
+  std::array<TestTrivialType, 2> a;
+  buffer = decltype(buffer)({ENCODING_TYPE_EXT8, 6,
+                             ENCODING_EXT_TYPE_TRIVIAL_ARRAY, 1, 2, 3, 4, 5,
+                             6});
+  error = Deserialize(&a, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(expected_v[0], a[0]);
+  EXPECT_EQ(expected_v[1], a[1]);
+
+  TestTrivialType wrapper_buffer[1];
+  ArrayWrapper<TestTrivialType> w(wrapper_buffer, 1, 0);
+  buffer.Rewind();
+  error = Deserialize(&w, &buffer);
+  EXPECT_EQ(ErrorCode::INSUFFICIENT_DESTINATION_SIZE, error);
+}
+
 TEST(DeserializationTest, Variant) {
   Payload buffer;
   ErrorType error;
@@ -6,6 +6,9 @@
 #include <sys/epoll.h>
 #include <sys/socket.h>
 
+#include <memory>
+#include <vector>
+
 #include <pdx/client.h>
 #include <pdx/service_endpoint.h>
 #include <uds/ipc_helper.h>
@@ -66,10 +69,28 @@ struct TransactionState {
     }
   }
 
+  // Prepares the state for reuse by another transaction. The handle vectors
+  // keep their capacity; unclaimed response handles are closed here.
+  void Reset() {
+    request.file_descriptors.clear();
+    request.channels.clear();
+    response.ret_code = 0;
+    response.recv_len = 0;
+    response.file_descriptors.clear();
+    response.channels.clear();
+  }
+
   RequestHeader<BorrowedHandle> request;
   ResponseHeader<LocalHandle> response;
 };
 
+// Transaction states released on this thread, kept for the next transactions
+// so that steady-state calls don't allocate. A few are kept since a thread may
+// have transactions on several channels in flight at once.
+constexpr size_t kMaxCachedTransactionStates = 4;
+thread_local std::vector<std::unique_ptr<TransactionState>>
+    cached_transaction_states;
+
 Status<void> ReadAndDiscardData(const BorrowedHandle& socket_fd, size_t size) {
   while (size > 0) {
     // If there is more data to read in the message than the buffers provided
@@ -110,7 +131,8 @@ Status<void> ReceiveResponse(const BorrowedHandle& socket_fd,
     return status;
 
   if (transaction_state->response.recv_len > 0) {
-    std::vector<iovec> read_buffers;
+    thread_local std::vector<iovec> read_buffers;
+    read_buffers.clear();
     size_t size_remaining = 0;
     if (transaction_state->response.recv_len != max_recv_len) {
       // If the receive buffer not exactly the size of data available, recreate
@@ -153,10 +175,21 @@ ClientChannel::~ClientChannel() {
     shutdown(channel_handle_.value(), SHUT_WR);
 }
 
-void* ClientChannel::AllocateTransactionState() { return new TransactionState; }
+void* ClientChannel::AllocateTransactionState() {
+  if (cached_transaction_states.empty())
+    return new TransactionState;
+  TransactionState* state = cached_transaction_states.back().release();
+  cached_transaction_states.pop_back();
+  return state;
+}
 
 void ClientChannel::FreeTransactionState(void* state) {
-  delete static_cast<TransactionState*>(state);
+  std::unique_ptr<TransactionState> transaction_state{
+      static_cast<TransactionState*>(state)};
+  if (cached_transaction_states.size() < kMaxCachedTransactionStates) {
+    transaction_state->Reset();
+    cached_transaction_states.push_back(std::move(transaction_state));
+  }
 }
 
 Status<void> ClientChannel::SendImpulse(int opcode, const void* buffer,
@@ -173,6 +173,17 @@ struct MessagePreamble {
   uint32_t fd_count{0};
 };
 
+SendPayload& SendPayload::GetThreadLocal() {
+  thread_local SendPayload payload;
+  payload.Clear();
+  return payload;
+}
+
+void SendPayload::Clear() {
+  buffer_.clear();
+  file_handles_.clear();
+}
+
 Status<void> SendPayload::Send(const BorrowedHandle& socket_fd) {
   return Send(socket_fd, nullptr);
 }
@@ -276,6 +287,18 @@ Status<ChannelReference> SendPayload::PushChannelHandle(
   return ErrorStatus{EOPNOTSUPP};
 }
 
+ReceivePayload& ReceivePayload::GetThreadLocal() {
+  thread_local ReceivePayload payload;
+  payload.Clear();
+  return payload;
+}
+
+void ReceivePayload::Clear() {
+  buffer_.clear();
+  file_handles_.clear();
+  read_pos_ = 0;
+}
+
 Status<void> ReceivePayload::Receive(const BorrowedHandle& socket_fd) {
   return Receive(socket_fd, nullptr);
 }
@@ -1,5 +1,7 @@
 #include "uds/ipc_helper.h"
 
+#include <sys/socket.h>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -8,12 +10,15 @@ using testing::SetErrnoAndReturn;
 using testing::_;
 
 using android::pdx::BorrowedHandle;
+using android::pdx::LocalHandle;
 using android::pdx::uds::SendInterface;
 using android::pdx::uds::RecvInterface;
 using android::pdx::uds::SendAll;
 using android::pdx::uds::SendMsgAll;
 using android::pdx::uds::RecvAll;
 using android::pdx::uds::RecvMsgAll;
+using android::pdx::uds::ReceiveData;
+using android::pdx::uds::SendData;
 
 namespace {
 
@@ -362,4 +367,22 @@ TEST_F(RecvMessageTest, Error2) {
   EXPECT_EQ(EBADF, status.error());
 }
 
+TEST(PayloadTest, ThreadLocalPayloadsAreReused) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  LocalHandle send_fd{fds[0]};
+  LocalHandle recv_fd{fds[1]};
+
+  // The thread local payloads must not carry data from one message into the
+  // next, even when the second message is smaller.
+  std::vector<int> received;
+  ASSERT_TRUE(SendData(send_fd.Borrow(), std::vector<int>{1, 2, 3, 4}));
+  ASSERT_TRUE(ReceiveData(recv_fd.Borrow(), &received));
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4}), received);
+
+  ASSERT_TRUE(SendData(send_fd.Borrow(), std::vector<int>{5}));
+  ASSERT_TRUE(ReceiveData(recv_fd.Borrow(), &received));
+  EXPECT_EQ((std::vector<int>{5}), received);
+}
+
 }  // namespace
@@ -58,6 +58,14 @@ Status<void> RecvMsgAll(RecvInterface* receiver,
 class SendPayload : public MessageWriter, public OutputResourceMapper {
  public:
   explicit SendPayload(SendInterface* sender = nullptr) : sender_{sender} {}
+
+  // Returns an empty payload owned by the calling thread. Its buffers keep
+  // their capacity between messages, so steady-state sends don't allocate.
+  static SendPayload& GetThreadLocal();
+
+  // Drops the serialized data and file descriptors, keeping the capacity.
+  void Clear();
+
   Status<void> Send(const BorrowedHandle& socket_fd);
   Status<void> Send(const BorrowedHandle& socket_fd, const ucred* cred,
                     const iovec* data_vec = nullptr, size_t vec_count = 0);
@@ -87,6 +95,15 @@ class ReceivePayload : public MessageReader, public InputResourceMapper {
  public:
   explicit ReceivePayload(RecvInterface* receiver = nullptr)
       : receiver_{receiver} {}
+
+  // Returns an empty payload owned by the calling thread. Its buffers keep
+  // their capacity between messages, so steady-state receives don't allocate.
+  static ReceivePayload& GetThreadLocal();
+
+  // Drops the received data and closes any file descriptors that were not
+  // claimed by GetFileHandle(), keeping the capacity.
+  void Clear();
+
   Status<void> Receive(const BorrowedHandle& socket_fd);
   Status<void> Receive(const BorrowedHandle& socket_fd, ucred* cred);
 
@@ -163,7 +180,7 @@ template <typename T>
 inline Status<void> SendData(const BorrowedHandle& socket_fd, const T& data,
                              const iovec* data_vec = nullptr,
                              size_t vec_count = 0) {
-  SendPayload payload;
+  SendPayload& payload = SendPayload::GetThreadLocal();
   rpc::Serialize(data, &payload);
   return payload.Send(socket_fd, nullptr, data_vec, vec_count);
 }
@@ -173,7 +190,7 @@ inline Status<void> SendData(const BorrowedHandle& socket_fd,
                              const RequestHeader<FileHandleType>& request,
                              const iovec* data_vec = nullptr,
                              size_t vec_count = 0) {
-  SendPayload payload;
+  SendPayload& payload = SendPayload::GetThreadLocal();
   rpc::Serialize(request, &payload);
   return payload.Send(socket_fd, &request.cred, data_vec, vec_count);
 }
@@ -185,20 +202,22 @@ Status<void> SendDataVector(const BorrowedHandle& socket_fd, const iovec* data,
 
 template <typename T>
 inline Status<void> ReceiveData(const BorrowedHandle& socket_fd, T* data) {
-  ReceivePayload payload;
+  ReceivePayload& payload = ReceivePayload::GetThreadLocal();
   Status<void> status = payload.Receive(socket_fd);
   if (status && rpc::Deserialize(data, &payload) != rpc::ErrorCode::NO_ERROR)
     status.SetError(EIO);
+  payload.Clear();
   return status;
 }
 
 template <typename FileHandleType>
 inline Status<void> ReceiveData(const BorrowedHandle& socket_fd,
                                 RequestHeader<FileHandleType>* request) {
-  ReceivePayload payload;
+  ReceivePayload& payload = ReceivePayload::GetThreadLocal();
   Status<void> status = payload.Receive(socket_fd, &request->cred);
   if (status && rpc::Deserialize(request, &payload) != rpc::ErrorCode::NO_ERROR)
     status.SetError(EIO);
+  payload.Clear();
   return status;
 }
 
@@ -2,6 +2,7 @@
 #define ANDROID_PDX_UDS_SERVICE_ENDPOINT_H_
 
 #include <sys/stat.h>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -130,6 +131,9 @@ class Endpoint : public pdx::Endpoint {
 
   void BuildCloseMessage(int32_t channel_id, Message* message);
 
+  Status<int> GetNextReadyFd();
+  Status<int> PopReadyFdLocked();
+  void UpdateReadyEventLocked();
   Status<void> AcceptConnection(Message* message);
   Status<void> ReceiveMessageForChannel(const BorrowedHandle& channel_fd,
                                         Message* message);
@@ -150,6 +154,7 @@ class Endpoint : public pdx::Endpoint {
   bool is_blocking_;
   LocalHandle socket_fd_;
   LocalHandle cancel_event_fd_;
+  LocalHandle ready_event_fd_;
   LocalHandle epoll_fd_;
 
   mutable std::mutex channel_mutex_;
@@ -157,6 +162,13 @@ class Endpoint : public pdx::Endpoint {
   std::map<int, int32_t> channel_fd_to_id_;
   int32_t last_channel_id_{0};
 
+  // Fds reported ready by epoll_wait that no dispatch thread has handled yet.
+  // Each one is registered with EPOLLONESHOT, so it stays disarmed, and is
+  // handed to exactly one thread, until it is re-enabled after its message.
+  // ready_event_fd_ is signaled exactly while this is not empty.
+  std::mutex ready_fds_mutex_;
+  std::deque<int> ready_fds_;
+
   Service* service_{nullptr};
   std::atomic<uint32_t> next_message_id_;
 };
@@ -5,7 +5,7 @@
 #include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
-#include <algorithm>  // std::min
+#include <algorithm>  // std::min, std::remove
 
 #include <android-base/logging.h>
 #include <android-base/strings.h>
@@ -20,6 +20,9 @@ namespace {
 
 constexpr int kMaxBackLogForSocketListen = 1;
 
+// The most ready fds to take from the epoll set in one wakeup.
+constexpr int kMaxReadyEvents = 16;
+
 using android::pdx::BorrowedChannelHandle;
 using android::pdx::BorrowedHandle;
 using android::pdx::ChannelReference;
@@ -179,6 +182,10 @@ void Endpoint::Init(LocalHandle socket_fd) {
   CHECK(cancel_event_fd_.IsValid())
       << "Endpoint::Endpoint: Failed to create event fd: " << strerror(errno);
 
+  ready_event_fd_.Reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+  CHECK(ready_event_fd_.IsValid())
+      << "Endpoint::Endpoint: Failed to create event fd: " << strerror(errno);
+
   epoll_fd_.Reset(epoll_create1(EPOLL_CLOEXEC));
   CHECK(epoll_fd_.IsValid())
       << "Endpoint::Endpoint: Failed to create epoll fd: " << strerror(errno);
@@ -203,6 +210,19 @@ void Endpoint::Init(LocalHandle socket_fd) {
   CHECK_EQ(ret, 0)
       << "Endpoint::Endpoint: Failed to add cancel event fd to epoll fd: "
       << strerror(errno);
+
+  // Level-triggered, and kept signaled while ready_fds_ is not empty, so the
+  // epoll fd stays readable for ServiceDispatcher until every queued fd has
+  // been handled.
+  epoll_event ready_event;
+  ready_event.events = EPOLLIN;
+  ready_event.data.fd = ready_event_fd_.Get();
+
+  ret = epoll_ctl(epoll_fd_.Get(), EPOLL_CTL_ADD, ready_event_fd_.Get(),
+                  &ready_event);
+  CHECK_EQ(ret, 0)
+      << "Endpoint::Endpoint: Failed to add ready event fd to epoll fd: "
+      << strerror(errno);
   socket_fd_ = std::move(socket_fd);
 }
 
@@ -333,6 +353,15 @@ Status<void> Endpoint::CloseChannelLocked(int32_t channel_id) {
     return ErrorStatus{EINVAL};
 
   int channel_fd = iter->second.data_fd.Get();
+  {
+    // The fd number may be reused by a new channel, which must not inherit a
+    // pending event of this one.
+    std::lock_guard<std::mutex> autolock(ready_fds_mutex_);
+    ready_fds_.erase(
+        std::remove(ready_fds_.begin(), ready_fds_.end(), channel_fd),
+        ready_fds_.end());
+    UpdateReadyEventLocked();
+  }
   Status<void> status;
   epoll_event dummy;  // See BUGS in man 2 epoll_ctl.
   if (epoll_ctl(epoll_fd_.Get(), EPOLL_CTL_DEL, channel_fd, &dummy) < 0) {
@@ -576,26 +605,89 @@ void Endpoint::BuildCloseMessage(int32_t channel_id, Message* message) {
   *message = Message{info};
 }
 
-Status<void> Endpoint::MessageReceive(Message* message) {
-  // Receive at most one event from the epoll set. This should prevent multiple
-  // dispatch threads from attempting to handle messages on the same socket at
-  // the same time.
-  epoll_event event;
-  int count = RETRY_EINTR(
-      epoll_wait(epoll_fd_.Get(), &event, 1, is_blocking_ ? -1 : 0));
-  if (count < 0) {
-    ALOGE("Endpoint::MessageReceive: Failed to wait for epoll events: %s\n",
-          strerror(errno));
-    return ErrorStatus{errno};
-  } else if (count == 0) {
-    return ErrorStatus{ETIMEDOUT};
+void Endpoint::UpdateReadyEventLocked() {
+  eventfd_t value;
+  if (ready_fds_.empty())
+    eventfd_read(ready_event_fd_.Get(), &value);
+  else
+    eventfd_write(ready_event_fd_.Get(), 1);
+}
+
+Status<int> Endpoint::PopReadyFdLocked() {
+  if (ready_fds_.empty())
+    return ErrorStatus{EAGAIN};
+  int fd = ready_fds_.front();
+  ready_fds_.pop_front();
+  UpdateReadyEventLocked();
+  return fd;
+}
+
+Status<int> Endpoint::GetNextReadyFd() {
+  {
+    std::lock_guard<std::mutex> autolock(ready_fds_mutex_);
+    auto status = PopReadyFdLocked();
+    if (status)
+      return status;
   }
 
-  if (event.data.fd == cancel_event_fd_.Get()) {
-    return ErrorStatus{ESHUTDOWN};
+  // Take every ready fd from one wakeup, instead of waiting again for each
+  // message, which saves a syscall per message when many channels are busy.
+  // The events are one-shot, so no other dispatch thread can receive a message
+  // on the same socket while these are pending. The queued fds are disarmed,
+  // so ready_event_fd_ stands in for them in the epoll set.
+  while (true) {
+    epoll_event events[kMaxReadyEvents];
+    int count = RETRY_EINTR(epoll_wait(epoll_fd_.Get(), events,
+                                       kMaxReadyEvents, is_blocking_ ? -1 : 0));
+    if (count < 0) {
+      ALOGE("Endpoint::MessageReceive: Failed to wait for epoll events: %s\n",
+            strerror(errno));
+      return ErrorStatus{errno};
+    } else if (count == 0) {
+      return ErrorStatus{ETIMEDOUT};
+    }
+
+    bool canceled = false;
+    int fd = -1;
+    std::lock_guard<std::mutex> autolock(ready_fds_mutex_);
+    for (int i = 0; i < count; i++) {
+      if (events[i].data.fd == cancel_event_fd_.Get())
+        canceled = true;
+      else if (events[i].data.fd == ready_event_fd_.Get())
+        continue;
+      else if (fd < 0)
+        fd = events[i].data.fd;
+      else
+        ready_fds_.push_back(events[i].data.fd);
+    }
+    if (canceled) {
+      // Keep the other fds for the next call, since they won't be reported
+      // again until they are re-enabled.
+      if (fd >= 0)
+        ready_fds_.push_front(fd);
+      UpdateReadyEventLocked();
+      return ErrorStatus{ESHUTDOWN};
+    }
+    UpdateReadyEventLocked();
+    if (fd >= 0)
+      return fd;
+
+    // Only the ready event fired. Another thread may have taken the queued fds
+    // first, in which case wait again.
+    auto status = PopReadyFdLocked();
+    if (status)
+      return status;
+    if (!is_blocking_)
+      return ErrorStatus{ETIMEDOUT};
   }
+}
+
+Status<void> Endpoint::MessageReceive(Message* message) {
+  auto fd_status = GetNextReadyFd();
+  if (!fd_status)
+    return fd_status.error_status();
 
-  if (socket_fd_ && event.data.fd == socket_fd_.Get()) {
+  if (socket_fd_ && fd_status.get() == socket_fd_.Get()) {
     auto status = AcceptConnection(message);
     auto reenable_status = ReenableEpollEvent(socket_fd_.Borrow());
     if (!reenable_status)
@@ -603,7 +695,7 @@ Status<void> Endpoint::MessageReceive(Message* message) {
     return status;
   }
 
-  BorrowedHandle channel_fd{event.data.fd};
+  BorrowedHandle channel_fd{fd_status.get()};
   return ReceiveMessageForChannel(channel_fd, message);
 }
 
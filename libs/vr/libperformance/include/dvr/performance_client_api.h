@@ -22,6 +22,23 @@ extern "C" {
 /// @returns Returns 0 on success or a negative errno error code on error.
 int dvrSetSchedulerPolicy(pid_t task_id, const char* scheduler_policy);
 
+/// Sets the scheduler policies for a group of tasks.
+///
+/// Sets the scheduler policy of each task in |task_ids| to the corresponding
+/// entry in |scheduler_policies| with a single request to the performance
+/// service. The request is validated as a whole: if any task or policy is
+/// invalid or not permitted, no task is changed.
+///
+/// @param task_ids Array of |count| task ids. A task id of 0 is replaced with
+/// the current task id.
+/// @param scheduler_policies Array of |count| NULL-terminated ASCII strings
+/// containing the desired scheduler policies.
+/// @param count Number of tasks to set the policy for.
+/// @returns Returns 0 on success or a negative errno error code on error.
+int dvrSetSchedulerPolicies(const pid_t* task_ids,
+                            const char* const* scheduler_policies,
+                            size_t count);
+
 /// Sets the CPU partition for a task.
 ///
 /// Sets the CPU partition for a task to the partition described by a CPU
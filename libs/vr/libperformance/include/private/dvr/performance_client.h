@@ -6,6 +6,8 @@
 #include <cstddef>
 #include <string>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include <pdx/client.h>
 
@@ -17,6 +19,12 @@ class PerformanceClient : public pdx::ClientBase<PerformanceClient> {
   int SetSchedulerPolicy(pid_t task_id, const std::string& scheduler_policy);
   int SetSchedulerPolicy(pid_t task_id, const char* scheduler_policy);
 
+  // Sets the scheduler policy of each task in |task_policies| in one call. The
+  // policies are only applied if every task and policy in the list is valid
+  // and permitted. A task id of 0 is replaced with the calling thread's id.
+  int SetSchedulerPolicies(
+      std::vector<std::pair<pid_t, std::string>> task_policies);
+
   // TODO(eieio): Consider deprecating this API.
   int SetCpuPartition(pid_t task_id, const std::string& partition);
   int SetCpuPartition(pid_t task_id, const char* partition);
@@ -4,6 +4,8 @@
 #include <sys/types.h>
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <pdx/rpc/remote_method_type.h>
 
@@ -22,8 +24,12 @@ struct PerformanceRPC {
     kOpSetSchedulerClass,
     kOpGetCpuPartition,
     kOpSetSchedulerPolicy,
+    kOpSetSchedulerPolicies,
   };
 
+  // A task id and the scheduler policy to apply to it.
+  using TaskPolicy = std::pair<pid_t, std::string>;
+
   // Methods.
   PDX_REMOTE_METHOD(SetCpuPartition, kOpSetCpuPartition,
                     void(pid_t, const std::string&));
@@ -32,6 +38,8 @@ struct PerformanceRPC {
   PDX_REMOTE_METHOD(GetCpuPartition, kOpGetCpuPartition, std::string(pid_t));
   PDX_REMOTE_METHOD(SetSchedulerPolicy, kOpSetSchedulerPolicy,
                     void(pid_t, const std::string&));
+  PDX_REMOTE_METHOD(SetSchedulerPolicies, kOpSetSchedulerPolicies,
+                    void(const std::vector<TaskPolicy>&));
 };
 
 }  // namespace dvr
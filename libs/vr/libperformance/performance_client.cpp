@@ -57,6 +57,17 @@ int PerformanceClient::SetSchedulerPolicy(pid_t task_id,
           task_id, WrapString(scheduler_policy)));
 }
 
+int PerformanceClient::SetSchedulerPolicies(
+    std::vector<std::pair<pid_t, std::string>> task_policies) {
+  for (auto& task_policy : task_policies) {
+    if (task_policy.first == 0)
+      task_policy.first = gettid();
+  }
+
+  return ReturnStatusOrError(
+      InvokeRemoteMethod<PerformanceRPC::SetSchedulerPolicies>(task_policies));
+}
+
 int PerformanceClient::SetSchedulerClass(pid_t task_id,
                                          const std::string& scheduler_class) {
   if (task_id == 0)
@@ -130,6 +141,27 @@ extern "C" int dvrSetSchedulerPolicy(pid_t task_id,
     return error;
 }
 
+extern "C" int dvrSetSchedulerPolicies(const pid_t* task_ids,
+                                       const char* const* scheduler_policies,
+                                       size_t count) {
+  if (count > 0 && (task_ids == nullptr || scheduler_policies == nullptr))
+    return -EINVAL;
+
+  std::vector<std::pair<pid_t, std::string>> task_policies;
+  task_policies.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    if (scheduler_policies[i] == nullptr)
+      return -EINVAL;
+    task_policies.emplace_back(task_ids[i], scheduler_policies[i]);
+  }
+
+  int error;
+  if (auto client = android::dvr::PerformanceClient::Create(&error))
+    return client->SetSchedulerPolicies(std::move(task_policies));
+  else
+    return error;
+}
+
 extern "C" int dvrSetSchedulerClass(pid_t task_id,
                                     const char* scheduler_class) {
   int error;
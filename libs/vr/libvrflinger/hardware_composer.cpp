@@ -51,6 +51,10 @@ const char kDvrStandaloneProperty[] = "ro.boot.vr";
 
 const char kRightEyeOffsetProperty[] = "dvr.right_eye_offset_ns";
 
+// When set, the post thread wakes up only as long before vsync as posting a
+// frame has recently taken, instead of the full configured frame post offset.
+const char kAdaptivePostOffsetProperty[] = "dvr.adaptive_post_offset";
+
 const char kUseExternalDisplayProperty[] = "persist.vr.use_external_display";
 
 // Surface flinger uses "VSYNC-sf" and "VSYNC-app" for its version of these
@@ -66,6 +70,15 @@ constexpr int64_t kDefaultVsyncPeriodNs = 16666667;
 // Hardware composer reports dpi as dots per thousand inches (dpi * 1000).
 constexpr int kDefaultDpi = 400000;
 
+// Bounds of the adaptive frame post offset. The configured frame post offset
+// is the upper bound.
+constexpr int64_t kMinFramePostOffsetNs = 1000000;
+// Slack added to the post duration estimate.
+constexpr int64_t kFramePostOffsetMarginNs = 500000;
+// The post duration estimate follows longer posts right away, and decays by
+// 1/kPostDurationDecay of the difference after shorter ones.
+constexpr int64_t kPostDurationDecay = 16;
+
 // Get time offset from a vsync to when the pose for that vsync should be
 // predicted out to. For example, if scanout gets halfway through the frame
 // at the halfway point between vsyncs, then this could be half the period.
@@ -844,6 +857,10 @@ void HardwareComposer::PostThread() {
       last_vsync_timestamp_ = GetSystemClockNs();
       vsync_prediction_interval_ = 1;
       retire_fence_fds_.clear();
+
+      adaptive_post_offset_ =
+          property_get_bool(kAdaptivePostOffsetProperty, false);
+      post_duration_estimate_ns_ = 0;
     }
 
     int64_t vsync_timestamp = 0;
@@ -891,18 +908,19 @@ void HardwareComposer::PostThread() {
       vsync_ring_->Publish(vsync);
     }
 
+    const int64_t display_time_est_ns =
+        vsync_timestamp + target_display_->vsync_period_ns;
     {
       // Sleep until shortly before vsync.
       ATRACE_NAME("sleep");
 
-      const int64_t display_time_est_ns =
-          vsync_timestamp + target_display_->vsync_period_ns;
+      const int64_t frame_post_offset_ns = GetFramePostOffsetNs();
       const int64_t now_ns = GetSystemClockNs();
-      const int64_t sleep_time_ns = display_time_est_ns - now_ns -
-                                    post_thread_config_.frame_post_offset_ns;
-      const int64_t wakeup_time_ns =
-          display_time_est_ns - post_thread_config_.frame_post_offset_ns;
+      const int64_t sleep_time_ns =
+          display_time_est_ns - now_ns - frame_post_offset_ns;
+      const int64_t wakeup_time_ns = display_time_est_ns - frame_post_offset_ns;
 
+      ATRACE_INT64("frame_post_offset_ns", frame_post_offset_ns);
       ATRACE_INT64("sleep_time_ns", sleep_time_ns);
       if (sleep_time_ns > 0) {
         int error = SleepUntil(wakeup_time_ns);
@@ -916,6 +934,7 @@ void HardwareComposer::PostThread() {
       }
     }
 
+    const int64_t post_start_ns = GetSystemClockNs();
     {
       auto status = composer_callback_->GetVsyncTime(target_display_->id);
 
@@ -945,7 +964,41 @@ void HardwareComposer::PostThread() {
     }
 
     PostLayers(target_display_->id);
+
+    const int64_t post_end_ns = GetSystemClockNs();
+    UpdatePostDurationEstimate(post_end_ns - post_start_ns,
+                               post_end_ns >= display_time_est_ns);
+  }
+}
+
+int64_t HardwareComposer::GetFramePostOffsetNs() const {
+  const int64_t configured_offset_ns = post_thread_config_.frame_post_offset_ns;
+  if (!adaptive_post_offset_ || post_duration_estimate_ns_ == 0)
+    return configured_offset_ns;
+
+  return std::clamp(post_duration_estimate_ns_ + kFramePostOffsetMarginNs,
+                    std::min(kMinFramePostOffsetNs, configured_offset_ns),
+                    configured_offset_ns);
+}
+
+void HardwareComposer::UpdatePostDurationEstimate(int64_t post_duration_ns,
+                                                  bool missed_display_time) {
+  if (missed_display_time) {
+    // Posting finished too late for the frame to make it to the display. Fall
+    // back to the configured offset and let the estimate decay from there.
+    ALOGW_IF(adaptive_post_offset_,
+             "HardwareComposer::PostThread: Frame posted after the estimated "
+             "display time, post_duration_ns=%" PRId64,
+             post_duration_ns);
+    post_duration_estimate_ns_ = std::max<int64_t>(
+        post_duration_ns, post_thread_config_.frame_post_offset_ns);
+  } else if (post_duration_ns > post_duration_estimate_ns_) {
+    post_duration_estimate_ns_ = post_duration_ns;
+  } else {
+    post_duration_estimate_ns_ -=
+        (post_duration_estimate_ns_ - post_duration_ns) / kPostDurationDecay;
   }
+  ATRACE_INT64("post_duration_estimate_ns", post_duration_estimate_ns_);
 }
 
 bool HardwareComposer::UpdateTargetDisplay() {
@@ -435,6 +435,16 @@ class HardwareComposer {
   pdx::Status<int64_t> WaitForPredictedVSync();
   int SleepUntil(int64_t wakeup_timestamp);
 
+  // Returns how long before the estimated display time the post thread wakes
+  // up to post the next frame. Called only from the post thread.
+  int64_t GetFramePostOffsetNs() const;
+
+  // Updates the post duration estimate with the time it took to post the last
+  // frame, and whether posting finished after its estimated display time.
+  // Called only from the post thread.
+  void UpdatePostDurationEstimate(int64_t post_duration_ns,
+                                  bool missed_display_time);
+
   // Initialize any newly connected displays, and set target_display_ to the
   // display we should render to. Returns true if target_display_
   // changed. Called only from the post thread.
@@ -527,6 +537,14 @@ class HardwareComposer {
   // Counter tracking the number of skipped frames.
   int frame_skip_count_ = 0;
 
+  // Whether the frame post offset adapts to the measured post duration. Read
+  // from a system property whenever the post thread resumes.
+  bool adaptive_post_offset_ = false;
+
+  // Recent peak of the time from the post thread waking up before vsync to the
+  // frame being handed to hardware composer, or 0 if nothing was measured yet.
+  int64_t post_duration_estimate_ns_ = 0;
+
   // Fd array for tracking retire fences that are returned by hwc. This allows
   // us to detect when the display driver begins queuing frames.
   std::vector<pdx::LocalHandle> retire_fence_fds_;
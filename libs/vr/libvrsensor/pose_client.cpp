@@ -42,10 +42,11 @@ class PoseClient : public pdx::ClientBase<PoseClient> {
   // Polls the pose service for the current state and stores it in *state.
   // Returns zero on success, a negative error code otherwise.
   int Poll(DvrPose* state) {
-    // Allocate the helper class to access the sensor pose buffer.
+    // Allocate the helper class to access the sensor pose buffer. Clients poll
+    // it at least once per frame, so map it for frequent CPU reads.
     if (sensor_pose_buffer_ == nullptr) {
       sensor_pose_buffer_ = std::make_unique<SensorPoseRing>(
-          DvrGlobalBuffers::kSensorPoseBuffer, CPUUsageMode::READ_RARELY);
+          DvrGlobalBuffers::kSensorPoseBuffer, CPUUsageMode::READ_OFTEN);
     }
 
     if (state) {
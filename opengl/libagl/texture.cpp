@@ -281,6 +281,29 @@ int copyPixels(
         return 0;
     }
 
+    if ((dst.format == src.format) &&
+        (dst.stride > 0) && (src.stride > 0) &&
+        (x >= 0) && (y >= 0) &&
+        (x+w <= GLint(src.width)) && (y+h <= GLint(src.height)) &&
+        (xoffset >= 0) && (yoffset >= 0) &&
+        (xoffset+w <= GLint(dst.width)) && (yoffset+h <= GLint(dst.height)))
+    {
+        // no conversion and no clipping (e.g. sub-image updates, or rows
+        // padded by the unpack alignment): copy the rows directly instead of
+        // rasterizing a textured rectangle.
+        const GGLFormat& pixelFormat(c->rasterizer.formats[src.format]);
+        const size_t bpp = pixelFormat.size;
+        const size_t bpr = w * bpp;
+        const uint8_t* s = src.data + (y * src.stride + x) * bpp;
+        uint8_t* d = dst.data + (yoffset * dst.stride + xoffset) * bpp;
+        for (GLsizei i=0 ; i<h ; i++) {
+            memcpy(d, s, bpr);
+            s += src.stride * bpp;
+            d += dst.stride * bpp;
+        }
+        return 0;
+    }
+
     // use pixel-flinger to handle all the conversions
     GGLContext* ggl = getRasterizer(c);
     if (!ggl) {
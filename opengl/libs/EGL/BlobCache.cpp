@@ -20,10 +20,10 @@
 
 #include <errno.h>
 #include <inttypes.h>
+#include <stdlib.h>
 
 #include <cutils/properties.h>
 #include <log/log.h>
-#include <chrono>
 
 namespace android {
 
@@ -36,20 +36,16 @@ static const uint32_t blobCacheVersion = 3;
 // BlobCache::Header::mDeviceVersion value
 static const uint32_t blobCacheDeviceVersion = 1;
 
+static inline std::string_view toView(const void* data, size_t size) {
+    return std::string_view(static_cast<const char*>(data), size);
+}
+
 BlobCache::BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize):
         mMaxTotalSize(maxTotalSize),
         mMaxKeySize(maxKeySize),
         mMaxValueSize(maxValueSize),
-        mTotalSize(0) {
-    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
-#ifdef _WIN32
-    srand(now);
-#else
-    mRandState[0] = (now >> 0) & 0xFFFF;
-    mRandState[1] = (now >> 16) & 0xFFFF;
-    mRandState[2] = (now >> 32) & 0xFFFF;
-#endif
-    ALOGV("initializing random seed using %lld", (unsigned long long)now);
+        mTotalSize(0),
+        mChangeCount(0) {
 }
 
 void BlobCache::set(const void* key, size_t keySize, const void* value,
@@ -78,15 +74,10 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
         return;
     }
 
-    std::shared_ptr<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, nullptr);
-
     while (true) {
-        auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), dummyEntry);
-        if (index == mCacheEntries.end() || dummyEntry < *index) {
+        auto index = mCacheIndex.find(toView(key, keySize));
+        if (index == mCacheIndex.end()) {
             // Create a new cache entry.
-            std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
             size_t newTotalSize = mTotalSize + keySize + valueSize;
             if (mMaxTotalSize < newTotalSize) {
                 if (isCleanable()) {
@@ -101,18 +92,21 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                     break;
                 }
             }
-            mCacheEntries.insert(index, CacheEntry(keyBlob, valueBlob));
+            std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
+            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
+            mCacheEntries.emplace_front(keyBlob, valueBlob);
+            mCacheIndex.emplace(toView(keyBlob->getData(), keySize), mCacheEntries.begin());
             mTotalSize = newTotalSize;
             ALOGV("set: created new cache entry with %zu byte key and %zu byte value",
                     keySize, valueSize);
         } else {
             // Update the existing cache entry.
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
-            std::shared_ptr<Blob> oldValueBlob(index->getValue());
-            size_t newTotalSize = mTotalSize + valueSize - oldValueBlob->getSize();
+            auto entry = index->second;
+            size_t newTotalSize = mTotalSize + valueSize - entry->getValue()->getSize();
             if (mMaxTotalSize < newTotalSize) {
                 if (isCleanable()) {
-                    // Clean the cache and try again.
+                    // Clean the cache and try again. The entry may be evicted,
+                    // so look it up again.
                     clean();
                     continue;
                 } else {
@@ -122,11 +116,13 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                     break;
                 }
             }
-            index->setValue(valueBlob);
+            entry->setValue(std::shared_ptr<Blob>(new Blob(value, valueSize, true)));
+            mCacheEntries.splice(mCacheEntries.begin(), mCacheEntries, entry);
             mTotalSize = newTotalSize;
             ALOGV("set: updated existing cache entry with %zu byte key and %zu byte "
                     "value", keySize, valueSize);
         }
+        mChangeCount++;
         break;
     }
 }
@@ -138,17 +134,17 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value,
                 keySize, mMaxKeySize);
         return 0;
     }
-    std::shared_ptr<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, nullptr);
-    auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), dummyEntry);
-    if (index == mCacheEntries.end() || dummyEntry < *index) {
+    auto index = mCacheIndex.find(toView(key, keySize));
+    if (index == mCacheIndex.end()) {
         ALOGV("get: no cache entry found for key of size %zu", keySize);
         return 0;
     }
 
-    // The key was found. Return the value if the caller's buffer is large
-    // enough.
-    std::shared_ptr<Blob> valueBlob(index->getValue());
+    // The key was found. Mark it most recently used, and return the value if
+    // the caller's buffer is large enough.
+    auto entry = index->second;
+    mCacheEntries.splice(mCacheEntries.begin(), mCacheEntries, entry);
+    std::shared_ptr<Blob> valueBlob(entry->getValue());
     size_t valueBlobSize = valueBlob->getSize();
     if (valueBlobSize <= valueSize) {
         ALOGV("get: copying %zu bytes to caller's buffer", valueBlobSize);
@@ -224,9 +220,23 @@ int BlobCache::flatten(void* buffer, size_t size) const {
     return 0;
 }
 
+void BlobCache::clear() {
+    mCacheIndex.clear();
+    mCacheEntries.clear();
+    mTotalSize = 0;
+    mChangeCount++;
+}
+
 int BlobCache::unflatten(void const* buffer, size_t size) {
+    return unflatten(buffer, size, nullptr);
+}
+
+int BlobCache::unflatten(void const* buffer, size_t size,
+        const std::shared_ptr<const void>& backing) {
     // All errors should result in the BlobCache being in an empty state.
-    mCacheEntries.clear();
+    const size_t changeCount = mChangeCount;
+    clear();
+    mChangeCount = changeCount;
 
     // Read the cache header
     if (size < sizeof(Header)) {
@@ -254,7 +264,7 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
     size_t numEntries = header->mNumEntries;
     for (size_t i = 0; i < numEntries; i++) {
         if (byteOffset + sizeof(EntryHeader) > size) {
-            mCacheEntries.clear();
+            clear();
             ALOGE("unflatten: not enough room for cache entry headers");
             return -EINVAL;
         }
@@ -267,13 +277,12 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
 
         size_t totalSize = align4(entrySize);
         if (byteOffset + totalSize > size) {
-            mCacheEntries.clear();
+            clear();
             ALOGE("unflatten: not enough room for cache entry headers");
             return -EINVAL;
         }
 
-        const uint8_t* data = eheader->mData;
-        set(data, keySize, data + keySize, valueSize);
+        addFlattenedEntry(eheader->mData, keySize, valueSize, backing);
 
         byteOffset += totalSize;
     }
@@ -281,22 +290,39 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
     return 0;
 }
 
-long int BlobCache::blob_random() {
-#ifdef _WIN32
-    return rand();
-#else
-    return nrand48(mRandState);
-#endif
+void BlobCache::addFlattenedEntry(const uint8_t* data, size_t keySize, size_t valueSize,
+        const std::shared_ptr<const void>& backing) {
+    // The cache that was flattened may have had larger limits.
+    if (keySize == 0 || valueSize == 0 || mMaxKeySize < keySize ||
+            mMaxValueSize < valueSize || mMaxTotalSize < mTotalSize + keySize + valueSize ||
+            mCacheIndex.count(toView(data, keySize)) > 0) {
+        return;
+    }
+
+    std::shared_ptr<Blob> keyBlob;
+    std::shared_ptr<Blob> valueBlob;
+    if (backing) {
+        keyBlob.reset(new Blob(data, keySize, backing));
+        valueBlob.reset(new Blob(data + keySize, valueSize, backing));
+    } else {
+        keyBlob.reset(new Blob(data, keySize, true));
+        valueBlob.reset(new Blob(data + keySize, valueSize, true));
+    }
+    // Entries are flattened most recently used first.
+    mCacheEntries.emplace_back(keyBlob, valueBlob);
+    mCacheIndex.emplace(toView(keyBlob->getData(), keySize), std::prev(mCacheEntries.end()));
+    mTotalSize += keySize + valueSize;
 }
 
 void BlobCache::clean() {
-    // Remove a random cache entry until the total cache size gets below half
-    // the maximum total cache size.
+    // Remove the least recently used cache entry until the total cache size
+    // gets below half the maximum total cache size.
     while (mTotalSize > mMaxTotalSize / 2) {
-        size_t i = size_t(blob_random() % (mCacheEntries.size()));
-        const CacheEntry& entry(mCacheEntries[i]);
-        mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
-        mCacheEntries.erase(mCacheEntries.begin() + i);
+        const CacheEntry& entry(mCacheEntries.back());
+        const std::shared_ptr<Blob>& key(entry.getKey());
+        mTotalSize -= key->getSize() + entry.getValue()->getSize();
+        mCacheIndex.erase(toView(key->getData(), key->getSize()));
+        mCacheEntries.pop_back();
     }
 }
 
@@ -313,20 +339,20 @@ BlobCache::Blob::Blob(const void* data, size_t size, bool copyData) :
     }
 }
 
+BlobCache::Blob::Blob(const void* data, size_t size,
+        const std::shared_ptr<const void>& backing) :
+        mData(data),
+        mSize(size),
+        mOwnsData(false),
+        mBacking(backing) {
+}
+
 BlobCache::Blob::~Blob() {
     if (mOwnsData) {
         free(const_cast<void*>(mData));
     }
 }
 
-bool BlobCache::Blob::operator<(const Blob& rhs) const {
-    if (mSize == rhs.mSize) {
-        return memcmp(mData, rhs.mData, mSize) < 0;
-    } else {
-        return mSize < rhs.mSize;
-    }
-}
-
 const void* BlobCache::Blob::getData() const {
     return mData;
 }
@@ -349,10 +375,6 @@ BlobCache::CacheEntry::CacheEntry(const CacheEntry& ce):
         mValue(ce.mValue) {
 }
 
-bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
-    return *mKey < *rhs.mKey;
-}
-
 const BlobCache::CacheEntry& BlobCache::CacheEntry::operator=(const CacheEntry& rhs) {
     mKey = rhs.mKey;
     mValue = rhs.mValue;
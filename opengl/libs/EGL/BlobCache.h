@@ -19,14 +19,19 @@
 
 #include <stddef.h>
 
+#include <list>
 #include <memory>
-#include <vector>
+#include <string_view>
+#include <unordered_map>
 
 namespace android {
 
 // A BlobCache is an in-memory cache for binary key/value pairs.  A BlobCache
 // does NOT provide any thread-safety guarantees.
 //
+// Entries are found through a hash of their key, and when the cache is full
+// the least recently used entries are evicted first.
+//
 // The cache contents can be serialized to an in-memory buffer or mmap'd file
 // and then reloaded in a subsequent execution of the program.  This
 // serialization is non-portable and the data should only be used by the device
@@ -99,9 +104,20 @@ public:
 
     // clear flushes out all contents of the cache then the BlobCache, leaving
     // it in an empty state.
-    void clear() { mCacheEntries.clear(); }
+    void clear();
 
 protected:
+    // unflatten is the same as above, except that the unflattened keys and
+    // values point into 'buffer' instead of being copied out of it. They keep
+    // a reference to 'backing', which must keep 'buffer' valid.
+    int unflatten(void const* buffer, size_t size,
+            const std::shared_ptr<const void>& backing);
+
+    // getChangeCount returns the number of times the contents of the cache
+    // have changed, so that callers can tell whether they need saving again.
+    // unflattening doesn't count as a change.
+    size_t getChangeCount() const { return mChangeCount; }
+
     // mMaxTotalSize is the maximum size that all cache entries can occupy. This
     // includes space for both keys and values. When a call to BlobCache::set
     // would otherwise cause this limit to be exceeded, either the key/value
@@ -114,13 +130,15 @@ private:
     BlobCache(const BlobCache&);
     void operator=(const BlobCache&);
 
-    // A random function helper to get around MinGW not having nrand48()
-    long int blob_random();
-
-    // clean evicts a randomly chosen set of entries from the cache such that
+    // clean evicts the least recently used entries from the cache such that
     // the total size of all remaining entries is less than mMaxTotalSize/2.
     void clean();
 
+    // addFlattenedEntry adds an entry read by unflatten to the back of
+    // mCacheEntries, unless it doesn't fit in the cache.
+    void addFlattenedEntry(const uint8_t* data, size_t keySize, size_t valueSize,
+            const std::shared_ptr<const void>& backing);
+
     // isCleanable returns true if the cache is full enough for the clean method
     // to have some effect, and false otherwise.
     bool isCleanable() const;
@@ -129,10 +147,10 @@ private:
     class Blob {
     public:
         Blob(const void* data, size_t size, bool copyData);
+        // Points to data without copying it, keeping backing alive instead.
+        Blob(const void* data, size_t size, const std::shared_ptr<const void>& backing);
         ~Blob();
 
-        bool operator<(const Blob& rhs) const;
-
         const void* getData() const;
         size_t getSize() const;
 
@@ -150,6 +168,9 @@ private:
         // mOwnsData indicates whether or not this Blob object should free the
         // memory pointed to by mData when the Blob gets destructed.
         bool mOwnsData;
+
+        // mBacking, if set, owns the memory pointed to by mData.
+        std::shared_ptr<const void> mBacking;
     };
 
     // A CacheEntry is a single key/value pair in the cache.
@@ -159,7 +180,6 @@ private:
         CacheEntry(const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value);
         CacheEntry(const CacheEntry& ce);
 
-        bool operator<(const CacheEntry& rhs) const;
         const CacheEntry& operator=(const CacheEntry&);
 
         std::shared_ptr<Blob> getKey() const;
@@ -236,13 +256,17 @@ private:
     // the cache.
     size_t mTotalSize;
 
-    // mRandState is the pseudo-random number generator state. It is passed to
-    // nrand48 to generate random numbers when needed.
-    unsigned short mRandState[3];
+    // mChangeCount is the number of times the cache contents have changed.
+    size_t mChangeCount;
+
+    // mCacheEntries stores all the cache entries that are resident in memory,
+    // most recently used first. Cache entries are added to it by the 'set'
+    // method.
+    std::list<CacheEntry> mCacheEntries;
 
-    // mCacheEntries stores all the cache entries that are resident in memory.
-    // Cache entries are added to it by the 'set' method.
-    std::vector<CacheEntry> mCacheEntries;
+    // mCacheIndex maps the key of every entry in mCacheEntries, viewing the
+    // data of the entry's key Blob, to the entry.
+    std::unordered_map<std::string_view, std::list<CacheEntry>::iterator> mCacheIndex;
 };
 
 }
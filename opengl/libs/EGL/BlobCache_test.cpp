@@ -267,6 +267,32 @@ TEST_F(BlobCacheTest, ExceedingTotalLimitHalvesCacheSize) {
     ASSERT_EQ(maxEntries/2 + 1, numCached);
 }
 
+TEST_F(BlobCacheTest, ExceedingTotalLimitEvictsLeastRecentlyUsed) {
+    // Fill up the entire cache with 1 char key/value pairs.
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        mBC->set(&k, 1, "x", 1);
+    }
+    // Use the oldest entry again, so that it is the most recently used.
+    {
+        uint8_t k = 0;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+    // Insert one more entry, causing a cache overflow.
+    {
+        uint8_t k = maxEntries;
+        mBC->set(&k, 1, "x", 1);
+    }
+    // The new entry, the entry that was used and the two entries set last remain.
+    for (int i = 0; i < maxEntries + 1; i++) {
+        SCOPED_TRACE(i);
+        uint8_t k = i;
+        const bool cached = i == 0 || i >= maxEntries - 2;
+        ASSERT_EQ(cached ? size_t(1) : size_t(0), mBC->get(&k, 1, nullptr, 0));
+    }
+}
+
 class BlobCacheFlattenTest : public BlobCacheTest {
 protected:
     virtual void SetUp() {
@@ -320,6 +346,34 @@ TEST_F(BlobCacheFlattenTest, FlattenFullCache) {
     }
 }
 
+TEST_F(BlobCacheFlattenTest, FlattenKeepsLeastRecentlyUsedOrder) {
+    // Fill up the entire cache with 1 char key/value pairs.
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        mBC->set(&k, 1, &k, 1);
+    }
+    {
+        uint8_t k = 0;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+
+    roundTrip();
+
+    // Overflowing the deserialized cache evicts the same entries as
+    // overflowing the original would have.
+    {
+        uint8_t k = maxEntries;
+        mBC2->set(&k, 1, &k, 1);
+    }
+    for (int i = 0; i < maxEntries + 1; i++) {
+        SCOPED_TRACE(i);
+        uint8_t k = i;
+        const bool cached = i == 0 || i >= maxEntries - 2;
+        ASSERT_EQ(cached ? size_t(1) : size_t(0), mBC2->get(&k, 1, nullptr, 0));
+    }
+}
+
 TEST_F(BlobCacheFlattenTest, FlattenDoesntChangeCache) {
     // Fill up the entire cache with 1 char key/value pairs.
     const int maxEntries = MAX_TOTAL_SIZE / 2;
@@ -22,6 +22,8 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 
+#include <array>
+
 
 // Cache file header
 static const char* cacheFileMagic = "EGL$";
@@ -30,17 +32,28 @@ static const size_t cacheFileHeaderSize = 8;
 namespace android {
 
 static uint32_t crc32c(const uint8_t* buf, size_t len) {
-    const uint32_t polyBits = 0x82F63B78;
-    uint32_t r = 0;
-    for (size_t i = 0; i < len; i++) {
-        r ^= buf[i];
-        for (int j = 0; j < 8; j++) {
-            if (r & 1) {
-                r = (r >> 1) ^ polyBits;
-            } else {
-                r >>= 1;
+    // One table lookup per byte instead of eight shifts, since the whole cache
+    // is checked when it is loaded and again when it is saved.
+    static const std::array<uint32_t, 256> table = [] {
+        const uint32_t polyBits = 0x82F63B78;
+        std::array<uint32_t, 256> t;
+        for (uint32_t i = 0; i < t.size(); i++) {
+            uint32_t r = i;
+            for (int j = 0; j < 8; j++) {
+                if (r & 1) {
+                    r = (r >> 1) ^ polyBits;
+                } else {
+                    r >>= 1;
+                }
             }
+            t[i] = r;
         }
+        return t;
+    }();
+
+    uint32_t r = 0;
+    for (size_t i = 0; i < len; i++) {
+        r = (r >> 8) ^ table[(r ^ buf[i]) & 0xFF];
     }
     return r;
 }
@@ -85,37 +98,44 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
             close(fd);
             return;
         }
+        close(fd);
+        // The cache entries point into the mapping rather than being copied
+        // out of it, so it is only unmapped once the last of them is gone.
+        // Until then, only the pages of the entries that are used need to stay
+        // resident.
+        std::shared_ptr<const void> mapping(buf, [fileSize](const void* p) {
+            munmap(const_cast<void*>(p), fileSize);
+        });
 
         // Check the file magic and CRC
         size_t cacheSize = fileSize - headerSize;
         if (memcmp(buf, cacheFileMagic, 4) != 0) {
             ALOGE("cache file has bad mojo");
-            close(fd);
             return;
         }
         uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
         if (crc32c(buf + headerSize, cacheSize) != *crc) {
             ALOGE("cache file failed CRC check");
-            close(fd);
             return;
         }
 
-        int err = unflatten(buf + headerSize, cacheSize);
+        int err = unflatten(buf + headerSize, cacheSize, mapping);
         if (err < 0) {
             ALOGE("error reading cache contents: %s (%d)", strerror(-err),
                     -err);
-            munmap(buf, fileSize);
-            close(fd);
             return;
         }
-
-        munmap(buf, fileSize);
-        close(fd);
+        mWrittenChangeCount = getChangeCount();
     }
 }
 
 void FileBlobCache::writeToFile() {
     if (mFilename.length() > 0) {
+        if (getChangeCount() == mWrittenChangeCount) {
+            // The file already has the current contents.
+            return;
+        }
+
         size_t cacheSize = getFlattenedSize();
         size_t headerSize = cacheFileHeaderSize;
         const char* fname = mFilename.c_str();
@@ -180,6 +200,7 @@ void FileBlobCache::writeToFile() {
         delete [] buf;
         fchmod(fd, S_IRUSR);
         close(fd);
+        mWrittenChangeCount = getChangeCount();
     }
 }
 
@@ -30,12 +30,17 @@ public:
             const std::string& filename);
 
     // writeToFile attempts to save the current contents of BlobCache to
-    // disk.
+    // disk. Nothing is written if the contents haven't changed since they
+    // were loaded or last saved.
     void writeToFile();
 
 private:
     // mFilename is the name of the file for storing cache contents.
     std::string mFilename;
+
+    // mWrittenChangeCount is the BlobCache change count of the contents in
+    // the file.
+    size_t mWrittenChangeCount = 0;
 };
 
 } // namespace android
@@ -125,7 +125,7 @@ int Loader::driver_t::set(void* hnd, int32_t api)
 }
 
 Loader::Loader()
-    : getProcAddress(nullptr)
+    : getProcAddress(nullptr), gles1Dso(nullptr)
 {
 }
 
@@ -222,10 +222,14 @@ void Loader::unload_system_driver(egl_connection_t* cnx) {
                (__eglMustCastToProperFunctionPointerType*)&cnx
                        ->hooks[egl_connection_t::GLESv2_INDEX]
                        ->gl);
-    uninit_api(gl_names,
-               (__eglMustCastToProperFunctionPointerType*)&cnx
-                       ->hooks[egl_connection_t::GLESv1_INDEX]
-                       ->gl);
+    {
+        std::lock_guard<std::mutex> lock(gles1Mutex);
+        uninit_api(gl_names,
+                   (__eglMustCastToProperFunctionPointerType*)&cnx
+                           ->hooks[egl_connection_t::GLESv1_INDEX]
+                           ->gl);
+        gles1Dso = nullptr;
+    }
     uninit_api(egl_names, (__eglMustCastToProperFunctionPointerType*)&cnx->egl);
 
     if (cnx->dso) {
@@ -362,6 +366,17 @@ void Loader::close(egl_connection_t* cnx)
     }
 }
 
+void Loader::resolve_gles1_api(egl_connection_t* cnx) {
+    std::lock_guard<std::mutex> lock(gles1Mutex);
+    if (gles1Dso) {
+        init_api(gles1Dso, gl_names_1, gl_names,
+            (__eglMustCastToProperFunctionPointerType*)
+                &cnx->hooks[egl_connection_t::GLESv1_INDEX]->gl,
+            getProcAddress);
+        gles1Dso = nullptr;
+    }
+}
+
 void Loader::init_api(void* dso,
         char const * const * api,
         char const * const * ref_api,
@@ -749,10 +764,10 @@ void Loader::initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask) {
     }
 
     if (mask & GLESv1_CM) {
-        init_api(dso, gl_names_1, gl_names,
-            (__eglMustCastToProperFunctionPointerType*)
-                &cnx->hooks[egl_connection_t::GLESv1_INDEX]->gl,
-            getProcAddress);
+        // Resolving a whole table of entry points takes a while, so the
+        // GLESv1 one is only filled by resolve_gles1_api() when it is needed.
+        std::lock_guard<std::mutex> lock(gles1Mutex);
+        gles1Dso = dso;
     }
 
     if (mask & GLESv2) {
@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <mutex>
+
 #include <EGL/egl.h>
 
 // ----------------------------------------------------------------------------
@@ -46,6 +48,11 @@ class Loader {
 
     getProcAddressType getProcAddress;
 
+    // The driver library the GLESv1 entry points are resolved from, once a
+    // GLES 1 context is created. Most apps never create one.
+    std::mutex gles1Mutex;
+    void* gles1Dso;
+
 public:
     static Loader& getInstance();
     ~Loader();
@@ -53,6 +60,10 @@ public:
     void* open(egl_connection_t* cnx);
     void close(egl_connection_t* cnx);
 
+    // Fills cnx's GLESv1 hooks, if that hasn't been done since the driver was
+    // loaded. Must be called before a GLES 1 context can be made current.
+    void resolve_gles1_api(egl_connection_t* cnx);
+
 private:
     Loader();
     driver_t* attempt_to_load_angle(egl_connection_t* cnx);
@@ -24,6 +24,8 @@
 
 #include <log/log.h>
 
+#include <private/EGL/driver.h>
+
 #include "../egl_impl.h"
 
 #include "egldefs.h"
@@ -212,6 +214,14 @@ EGLBoolean egl_init_drivers() {
     return res;
 }
 
+void egl_preload_driver() {
+    if (egl_init_drivers()) {
+        // Normally done when a GLES 1 context is created. Done here so that
+        // apps share the table rather than each filling its own.
+        Loader::getInstance().resolve_gles1_api(&gEGLImpl);
+    }
+}
+
 static pthread_mutex_t sLogPrintMutex = PTHREAD_MUTEX_INITIALIZER;
 static std::chrono::steady_clock::time_point sLogPrintTime;
 static constexpr std::chrono::seconds DURATION(1);
@@ -22,6 +22,7 @@
 
 #include <private/EGL/cache.h>
 
+#include <cutils/properties.h>
 #include <unistd.h>
 
 #include <thread>
@@ -33,6 +34,13 @@ static const size_t maxKeySize = 12 * 1024;
 static const size_t maxValueSize = 64 * 1024;
 static const size_t maxTotalSize = 2 * 1024 * 1024;
 
+// Limits of the shared cache, which holds the shaders of many apps at once.
+static const size_t sharedMaxTotalSize = 8 * 1024 * 1024;
+
+// Names the file holding the shared, read-only cache. The cache is disabled
+// if it is not set.
+static const char* sharedCacheFileProperty = "ro.egl.shared_blob_cache";
+
 // The time in seconds to wait before saving newly inserted cache entries.
 static const unsigned int deferredSaveDelay = 4;
 
@@ -64,7 +72,8 @@ static EGLsizeiANDROID getBlob(const void* key, EGLsizeiANDROID keySize,
 // egl_cache_t definition
 //
 egl_cache_t::egl_cache_t() :
-        mInitialized(false) {
+        mInitialized(false),
+        mSharedBlobCacheLoaded(false) {
 }
 
 egl_cache_t::~egl_cache_t() {
@@ -160,6 +169,13 @@ EGLsizeiANDROID egl_cache_t::getBlob(const void* key, EGLsizeiANDROID keySize,
     }
 
     if (mInitialized) {
+        BlobCache* shared = getSharedBlobCacheLocked();
+        if (shared) {
+            EGLsizeiANDROID size = shared->get(key, keySize, value, valueSize);
+            if (size > 0) {
+                return size;
+            }
+        }
         BlobCache* bc = getBlobCacheLocked();
         return bc->get(key, keySize, value, valueSize);
     }
@@ -178,6 +194,18 @@ BlobCache* egl_cache_t::getBlobCacheLocked() {
     return mBlobCache.get();
 }
 
+BlobCache* egl_cache_t::getSharedBlobCacheLocked() {
+    if (!mSharedBlobCacheLoaded) {
+        mSharedBlobCacheLoaded = true;
+        char filename[PROPERTY_VALUE_MAX];
+        if (property_get(sharedCacheFileProperty, filename, "") > 0) {
+            mSharedBlobCache.reset(new FileBlobCache(maxKeySize, maxValueSize,
+                    sharedMaxTotalSize, filename));
+        }
+    }
+    return mSharedBlobCache.get();
+}
+
 // ----------------------------------------------------------------------------
 }; // namespace android
 // ----------------------------------------------------------------------------
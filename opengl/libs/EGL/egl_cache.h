@@ -59,7 +59,8 @@ public:
 
     // getBlob attempts to retrieve the value blob associated with a given key
     // blob from cache.  This will be called by the hardware vendor's EGL
-    // implementation via the EGL_ANDROID_blob_cache extension.
+    // implementation via the EGL_ANDROID_blob_cache extension.  The shared
+    // cache, if there is one, is searched before the process's own cache.
     EGLsizeiANDROID getBlob(const void* key, EGLsizeiANDROID keySize,
         void* value, EGLsizeiANDROID valueSize);
 
@@ -82,6 +83,11 @@ private:
     // possible.
     BlobCache* getBlobCacheLocked();
 
+    // getSharedBlobCacheLocked returns the read-only cache shared by all
+    // processes, loading it from disk the first time it's needed, or NULL if
+    // the device doesn't have one.
+    BlobCache* getSharedBlobCacheLocked();
+
     // mInitialized indicates whether the egl_cache_t is in the initialized
     // state.  It is initialized to false at construction time, and gets set to
     // true when initialize is called.  It is set back to false when terminate
@@ -95,6 +101,18 @@ private:
     // first time it's needed.
     std::unique_ptr<FileBlobCache> mBlobCache;
 
+    // mSharedBlobCache holds the shaders that were compiled ahead of time for
+    // every app, for example by populating the file named by the
+    // ro.egl.shared_blob_cache property when the system image is built or
+    // updated.  It is never written to, so the same shaders aren't compiled
+    // again by every app and after every clear-data.  It persists through
+    // terminate, since it never changes.
+    std::unique_ptr<FileBlobCache> mSharedBlobCache;
+
+    // mSharedBlobCacheLoaded indicates whether getSharedBlobCacheLocked has
+    // tried to load mSharedBlobCache.
+    bool mSharedBlobCacheLoaded;
+
     // mFilename is the name of the file for storing cache contents in between
     // program invocations.  It is initialized to an empty string at
     // construction time, and can be set with the setCacheFilename method.  An
@@ -84,7 +84,8 @@ int egl_get_init_count(EGLDisplay dpy) {
 egl_display_t egl_display_t::sDisplay[NUM_DISPLAYS];
 
 egl_display_t::egl_display_t() :
-    magic('_dpy'), finishOnSwap(false), traceGpuCompletion(false), refs(0), eglIsInitialized(false) {
+    magic('_dpy'), finishOnSwap(false), traceGpuCompletion(false), refs(0), eglIsInitialized(false),
+    objectsGeneration(0) {
 }
 
 egl_display_t::~egl_display_t() {
@@ -112,6 +113,7 @@ void egl_display_t::addObject(egl_object_t* object) {
 void egl_display_t::removeObject(egl_object_t* object) {
     std::lock_guard<std::mutex> _l(lock);
     objects.erase(object);
+    objectsGeneration.fetch_add(1, std::memory_order_release);
 }
 
 bool egl_display_t::getObject(egl_object_t* object) const {
@@ -491,6 +493,7 @@ EGLBoolean egl_display_t::terminate() {
 
         // this marks all object handles are "terminated"
         objects.clear();
+        objectsGeneration.fetch_add(1, std::memory_order_release);
     }
 
     { // scope for refLock
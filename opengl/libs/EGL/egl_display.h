@@ -21,6 +21,7 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <string>
@@ -72,6 +73,11 @@ public:
     void removeObject(egl_object_t* object);
     // add reference to this object. returns true if this is a valid object.
     bool getObject(egl_object_t* object) const;
+    // changes whenever an object is removed from this display's list, so an
+    // object that was valid is known to still be while it doesn't change.
+    uint32_t getObjectsGeneration() const {
+        return objectsGeneration.load(std::memory_order_acquire);
+    }
 
     static egl_display_t* get(EGLDisplay dpy);
     static EGLDisplay getFromNativeDisplay(EGLNativeDisplayType disp, const EGLAttrib* attrib_list);
@@ -126,6 +132,7 @@ private:
     mutable std::mutex                  refLock;
     mutable std::condition_variable     refCond;
             std::unordered_set<egl_object_t*> objects;
+            std::atomic<uint32_t>       objectsGeneration;
             std::string mVendorString;
             std::string mVersionString;
             std::string mClientApiString;
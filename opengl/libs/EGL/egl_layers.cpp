@@ -27,6 +27,7 @@
 #include <nativebridge/native_bridge.h>
 #include <nativeloader/native_loader.h>
 #include <sys/prctl.h>
+#include <sys/system_properties.h>
 
 namespace android {
 
@@ -78,7 +79,8 @@ const void* getNextLayerProcAddress(void* layer_id, const char* name) {
 
     ALOGV("getNextLayerProcAddress servicing %s", name);
 
-    if (func_indices.find(name) == func_indices.end()) {
+    auto index_it = func_indices.find(name);
+    if (index_it == func_indices.end()) {
         // No entry for this function - it is an extension
         // call down the GPA chain directly to the impl
         ALOGV("getNextLayerProcAddress - name(%s) no func_indices entry found", name);
@@ -103,7 +105,7 @@ const void* getNextLayerProcAddress(void* layer_id, const char* name) {
         return reinterpret_cast<void*>(val);
     }
 
-    int index = func_indices[name];
+    int index = index_it->second;
     val = (*next_layer_funcs)[index];
     ALOGV("getNextLayerProcAddress - name(%s) index(%i) entry(%llu) - Got a hit, returning known entry", name, index, (unsigned long long)val);
     return reinterpret_cast<void*>(val);
@@ -150,6 +152,24 @@ LayerLoader& LayerLoader::getInstance() {
 
 const char kSystemLayerLibraryDir[] = "/data/local/debug/gles";
 
+bool LayerLoader::DebugLayersChanged() {
+    // getInstance() retries LoadLayers() from every EGL call that initializes the driver until
+    // layers are found, so cheaply check that neither source could have changed first. The
+    // property area serial changes whenever any property is set.
+    uint32_t property_serial = __system_property_area_serial();
+    const std::string& app_layers = android::GraphicsEnv::getInstance().getDebugLayersGLES();
+
+    if (debug_layers_checked_ && property_serial == debug_layers_serial_ &&
+        app_layers == debug_layers_app_) {
+        return false;
+    }
+
+    debug_layers_checked_ = true;
+    debug_layers_serial_ = property_serial;
+    debug_layers_app_ = app_layers;
+    return true;
+}
+
 std::string LayerLoader::GetDebugLayers() {
     // Layers can be specified at the Java level in GraphicsEnvironemnt
     // gpu_debug_layers_gles = layer1:layer2:layerN
@@ -255,6 +275,10 @@ bool LayerLoader::Initialized() {
     return initialized_;
 }
 
+unsigned LayerLoader::AppliedLayerCount() {
+    return layers_loaded_ ? current_layer_ : 0;
+}
+
 void LayerLoader::InitLayers(egl_connection_t* cnx) {
     if (!layers_loaded_) return;
 
@@ -330,6 +354,8 @@ void LayerLoader::InitLayers(egl_connection_t* cnx) {
 }
 
 void LayerLoader::LoadLayers() {
+    if (!DebugLayersChanged()) return;
+
     std::string debug_layers = GetDebugLayers();
 
     // If no layers are specified, we're done
@@ -44,6 +44,8 @@ public:
     void LayerPlatformEntries(layer_setup_func layer_setup, EGLFuncPointer*, char const* const*);
     void LayerDriverEntries(layer_setup_func layer_setup, EGLFuncPointer*, char const* const*);
     bool Initialized();
+    // The number of layers ApplyLayers() currently applies
+    unsigned AppliedLayerCount();
     std::string GetDebugLayers();
 
     EGLFuncPointer GetGpaNext(unsigned i);
@@ -54,10 +56,22 @@ public:
     std::vector<layer_setup_func> layer_setup_;
 
 private:
-    LayerLoader() : layers_loaded_(false), initialized_(false), current_layer_(0){};
+    LayerLoader()
+          : layers_loaded_(false),
+            initialized_(false),
+            current_layer_(0),
+            debug_layers_checked_(false),
+            debug_layers_serial_(0){};
+    bool DebugLayersChanged();
+
     bool layers_loaded_;
     bool initialized_;
     unsigned current_layer_;
+
+    // What the debug layer list was last read from, see DebugLayersChanged()
+    bool debug_layers_checked_;
+    uint32_t debug_layers_serial_;
+    std::string debug_layers_app_;
 };
 
 }; // namespace android
@@ -23,6 +23,81 @@
 namespace android {
 // ----------------------------------------------------------------------------
 
+namespace {
+
+// Objects this thread validated recently, so that validating them again
+// doesn't take their display's lock. Each entry holds a reference, so the
+// object can't be deleted and its address reused while it is cached, and is
+// only trusted while nothing has been removed from its display since.
+class ThreadObjectCache {
+public:
+    ~ThreadObjectCache() { clear(); }
+
+    // Adds a reference to object if it is cached and still valid.
+    bool get(egl_display_t const* display, egl_object_t* object) {
+        const uint32_t generation = display->getObjectsGeneration();
+        for (Entry& entry : mEntries) {
+            if (entry.display != display) continue;
+            if (entry.generation != generation) {
+                release(entry);
+            } else if (entry.object == object) {
+                object->incRef();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // generation must have been read before object was validated.
+    void put(egl_display_t const* display, egl_object_t* object, uint32_t generation) {
+        Entry& entry = mEntries[mNext];
+        mNext = (mNext + 1) % kNumEntries;
+        release(entry);
+        object->incRef();
+        entry = {display, object, generation};
+    }
+
+    void remove(egl_object_t* object) {
+        for (Entry& entry : mEntries) {
+            if (entry.object == object) {
+                release(entry);
+            }
+        }
+    }
+
+    void clear() {
+        for (Entry& entry : mEntries) {
+            release(entry);
+        }
+    }
+
+private:
+    // Enough for a context and its draw and read surfaces, and then some
+    static constexpr size_t kNumEntries = 4;
+
+    struct Entry {
+        egl_display_t const* display;
+        egl_object_t* object;
+        uint32_t generation;
+    };
+
+    static void release(Entry& entry) {
+        egl_object_t* object = entry.object;
+        entry = {};
+        if (object) {
+            // This may delete object, so the entry is cleared first.
+            object->destroy();
+        }
+    }
+
+    Entry mEntries[kNumEntries] = {};
+    size_t mNext = 0;
+};
+
+thread_local ThreadObjectCache sThreadObjectCache;
+
+} // namespace
+
 egl_object_t::egl_object_t(egl_display_t* disp) :
     display(disp), count(1) {
     // NOTE: this does an implicit incRef
@@ -39,6 +114,8 @@ void egl_object_t::terminate() {
         // shouldn't happen because this is called from LocalRef
         ALOGE("egl_object_t::terminate() removed the last reference!");
     }
+    // Let the object go as soon as its other users are done with it
+    sThreadObjectCache.remove(this);
 }
 
 void egl_object_t::destroy() {
@@ -50,7 +127,20 @@ void egl_object_t::destroy() {
 bool egl_object_t::get(egl_display_t const* display, egl_object_t* object) {
     // used by LocalRef, this does an incRef() atomically with
     // checking that the object is valid.
-    return display->getObject(object);
+    ThreadObjectCache& cache = sThreadObjectCache;
+    if (cache.get(display, object)) {
+        return true;
+    }
+    const uint32_t generation = display->getObjectsGeneration();
+    if (!display->getObject(object)) {
+        return false;
+    }
+    cache.put(display, object, generation);
+    return true;
+}
+
+void egl_object_t::releaseThreadCache() {
+    sThreadObjectCache.clear();
 }
 
 // ----------------------------------------------------------------------------
@@ -55,6 +55,10 @@ public:
     inline size_t decRef() { return count.fetch_sub(1, std::memory_order_acq_rel); }
     inline egl_display_t* getDisplay() const { return display; }
 
+    // Drops the references the calling thread keeps to the objects it
+    // validated last.
+    static void releaseThreadCache();
+
 private:
     static bool get(egl_display_t const* display, egl_object_t* object);
 
@@ -47,6 +47,7 @@
 
 #include "../egl_impl.h"
 
+#include "Loader.h"
 #include "egl_display.h"
 #include "egl_object.h"
 #include "egl_layers.h"
@@ -256,8 +257,16 @@ static const extention_map_t sExtensionMap[] = {
          !strcmp((procname), "eglHibernateProcessIMG")      ||    \
          !strcmp((procname), "eglAwakenProcessIMG"))
 
+struct GLExtensionEntry {
+    // The driver's entry point, below any layers
+    __eglMustCastToProperFunctionPointerType addr;
+    int slot;
+    // How many layers the hooks in slot go through
+    unsigned layerCount;
+};
+
 // accesses protected by sExtensionMapMutex
-static std::unordered_map<std::string, __eglMustCastToProperFunctionPointerType> sGLExtentionMap;
+static std::unordered_map<std::string, GLExtensionEntry> sGLExtentionMap;
 
 static int sGLExtentionSlot = 0;
 static pthread_mutex_t sExtensionMapMutex = PTHREAD_MUTEX_INITIALIZER;
@@ -989,6 +998,9 @@ EGLContext eglCreateContextImpl(EGLDisplay dpy, EGLConfig config,
                     }
                 };
             }
+            if (version == egl_connection_t::GLESv1_INDEX) {
+                Loader::getInstance().resolve_gles1_api(cnx);
+            }
             egl_context_t* c = new egl_context_t(dpy, context, config, cnx,
                     version);
             return c;
@@ -1247,26 +1259,28 @@ __eglMustCastToProperFunctionPointerType eglGetProcAddressImpl(const char *procn
 
     auto& extentionMap = sGLExtentionMap;
     auto pos = extentionMap.find(name);
-    addr = (pos != extentionMap.end()) ? pos->second : nullptr;
     const int slot = sGLExtentionSlot;
 
-    ALOGE_IF(slot >= MAX_NUMBER_OF_GL_EXTENSIONS,
-             "no more slots for eglGetProcAddress(\"%s\")",
-             procname);
-
     egl_connection_t* const cnx = &gEGLImpl;
     LayerLoader& layer_loader(LayerLoader::getInstance());
 
-    if (!addr && (slot < MAX_NUMBER_OF_GL_EXTENSIONS)) {
+    if (pos == extentionMap.end()) {
+        ALOGE_IF(slot >= MAX_NUMBER_OF_GL_EXTENSIONS,
+                 "no more slots for eglGetProcAddress(\"%s\")",
+                 procname);
 
-        if (cnx->dso && cnx->egl.eglGetProcAddress) {
+        addr = nullptr;
+        if (slot < MAX_NUMBER_OF_GL_EXTENSIONS && cnx->dso && cnx->egl.eglGetProcAddress) {
 
             // Extensions are independent of the bound context
             addr = cnx->egl.eglGetProcAddress(procname);
             if (addr) {
 
                 // purposefully track the bottom of the stack in extensionMap
-                extentionMap[name] = addr;
+                GLExtensionEntry& entry = extentionMap[name];
+                entry.addr = addr;
+                entry.slot = slot;
+                entry.layerCount = layer_loader.AppliedLayerCount();
 
                 // Apply layers
                 addr = layer_loader.ApplyLayers(procname, addr);
@@ -1279,16 +1293,22 @@ __eglMustCastToProperFunctionPointerType eglGetProcAddressImpl(const char *procn
             }
         }
 
-    } else if (slot < MAX_NUMBER_OF_GL_EXTENSIONS) {
-
-        // We've seen this func before, but we tracked the bottom, so re-apply layers
-        // More layers might have been enabled
-        addr = layer_loader.ApplyLayers(procname, addr);
-
-        // Track the top most entry point
-        cnx->hooks[egl_connection_t::GLESv1_INDEX]->ext.extensions[slot] =
-        cnx->hooks[egl_connection_t::GLESv2_INDEX]->ext.extensions[slot] = addr;
-        addr = gExtensionForwarders[slot];
+    } else {
+        GLExtensionEntry& entry = pos->second;
+
+        // We've seen this func before, but we tracked the bottom, so re-apply layers if more
+        // have been enabled since. Otherwise the hooks already hold the top most entry point, and
+        // asking every layer for it again would make each lookup cost a walk of the chain.
+        const unsigned layerCount = layer_loader.AppliedLayerCount();
+        if (entry.layerCount != layerCount) {
+            entry.layerCount = layerCount;
+            addr = layer_loader.ApplyLayers(procname, entry.addr);
+
+            // Track the top most entry point
+            cnx->hooks[egl_connection_t::GLESv1_INDEX]->ext.extensions[entry.slot] =
+            cnx->hooks[egl_connection_t::GLESv2_INDEX]->ext.extensions[entry.slot] = addr;
+        }
+        addr = gExtensionForwarders[entry.slot];
     }
 
     pthread_mutex_unlock(&sExtensionMapMutex);
@@ -1645,6 +1665,7 @@ EGLBoolean eglReleaseThreadImpl(void)
     // If there is context bound to the thread, release it
     egl_display_t::loseCurrent(get_context(getContext()));
 
+    egl_object_t::releaseThreadCache();
     egl_tls_t::clearTLS();
     return EGL_TRUE;
 }
@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cutils/compiler.h>
+
+namespace android {
+
+// Loads, relocates and resolves all the entry points of the system GLES
+// driver, without initializing a display. Meant to be called by the zygote
+// before it forks, so that every app shares the driver's relocated pages and
+// hook tables instead of loading its own copy. Apps that GraphicsEnv points
+// at ANGLE or an updated driver unload it again when they first use EGL.
+ANDROID_API void egl_preload_driver();
+
+} // namespace android
@@ -17,6 +17,8 @@
 #include <bufferhub/BufferHubIdGenerator.h>
 #include <log/log.h>
 
+#include <limits>
+
 namespace android {
 namespace frameworks {
 namespace bufferhub {
@@ -29,25 +31,35 @@ BufferHubIdGenerator& BufferHubIdGenerator::getInstance() {
     return generator;
 }
 
-int BufferHubIdGenerator::getId() {
-    std::lock_guard<std::mutex> lock(mIdsInUseMutex);
-
+int BufferHubIdGenerator::nextId() {
+    int lastId = mLastId.load(std::memory_order_relaxed);
+    int id;
     do {
-        if (++mLastId >= std::numeric_limits<int>::max()) {
-            mLastId = 0;
-        }
-    } while (mIdsInUse.find(mLastId) != mIdsInUse.end());
+        id = lastId >= std::numeric_limits<int>::max() - 1 ? 0 : lastId + 1;
+    } while (!mLastId.compare_exchange_weak(lastId, id, std::memory_order_relaxed));
+    return id;
+}
 
-    mIdsInUse.insert(mLastId);
-    return mLastId;
+int BufferHubIdGenerator::getId() {
+    // Only ids that are still in use after the counter wrapped around are skipped.
+    while (true) {
+        const int id = nextId();
+        Shard& shard = shardFor(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.idsInUse.insert(id).second) {
+            return id;
+        }
+    }
 }
 
 void BufferHubIdGenerator::freeId(int id) {
-    std::lock_guard<std::mutex> lock(mIdsInUseMutex);
-    auto iter = mIdsInUse.find(id);
-    if (iter != mIdsInUse.end()) {
-        mIdsInUse.erase(iter);
-    } else {
+    if (id < 0) {
+        ALOGW("%s: Cannot free nonexistent id #%d", __FUNCTION__, id);
+        return;
+    }
+    Shard& shard = shardFor(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.idsInUse.erase(id) == 0) {
         ALOGW("%s: Cannot free nonexistent id #%d", __FUNCTION__, id);
     }
 }
@@ -17,8 +17,10 @@
 #ifndef ANDROID_FRAMEWORKS_BUFFERHUB_V1_0_ID_GENERATOR_H
 #define ANDROID_FRAMEWORKS_BUFFERHUB_V1_0_ID_GENERATOR_H
 
+#include <array>
+#include <atomic>
 #include <mutex>
-#include <set>
+#include <unordered_set>
 
 #include <utils/Mutex.h>
 
@@ -45,11 +47,24 @@ private:
     BufferHubIdGenerator() = default;
     ~BufferHubIdGenerator() = default;
 
+    // Ids in use are split over shards by id, each with its own lock, so that buffers created and
+    // freed at the same time rarely wait on each other. Consecutive ids map to different shards.
+    static constexpr int kNumShards = 16;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_set<int> idsInUse GUARDED_BY(mutex);
+    };
+
+    Shard& shardFor(int id) { return mShards[id % kNumShards]; }
+
+    // Advances mLastId to the next candidate id, wrapping around to 0.
+    int nextId();
+
     // Start from -1 so all valid ids will be >= 0
-    int mLastId = -1;
+    std::atomic<int> mLastId{-1};
 
-    std::mutex mIdsInUseMutex;
-    std::set<int> mIdsInUse GUARDED_BY(mIdsInUseMutex);
+    std::array<Shard, kNumShards> mShards;
 };
 
 } // namespace implementation
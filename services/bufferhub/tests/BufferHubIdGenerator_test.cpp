@@ -1,6 +1,10 @@
 #include <bufferhub/BufferHubIdGenerator.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
 namespace android {
 namespace frameworks {
 namespace bufferhub {
@@ -39,6 +43,38 @@ TEST_F(BufferHubIdGeneratorTest, TestGenerateUniqueIncrementalID) {
     }
 }
 
+TEST_F(BufferHubIdGeneratorTest, TestConcurrentGenerateAndFreeUniqueID) {
+    const int kNumThreads = 8;
+    const int kIdsPerThread = 1000;
+    std::vector<std::vector<int>> ids(kNumThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t) {
+        threads.emplace_back([this, &ids, t] {
+            for (int i = 0; i < kIdsPerThread; ++i) {
+                ids[t].push_back(mIdGenerator->getId());
+                // Churn through ids that are freed right away as well.
+                mIdGenerator->freeId(mIdGenerator->getId());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::unordered_set<int> uniqueIds;
+    for (const auto& threadIds : ids) {
+        for (int id : threadIds) {
+            EXPECT_GE(id, 0);
+            EXPECT_TRUE(uniqueIds.insert(id).second) << "id " << id << " handed out twice";
+        }
+    }
+    EXPECT_EQ(uniqueIds.size(), static_cast<size_t>(kNumThreads * kIdsPerThread));
+
+    for (int id : uniqueIds) {
+        mIdGenerator->freeId(id);
+    }
+}
+
 } // namespace
 
 } // namespace implementation
@@ -30,6 +30,7 @@
 
 #include <vkjson.h>
 
+#include "gpumem/GpuMem.h"
 #include "gpustats/GpuStats.h"
 
 namespace android {
@@ -46,7 +47,8 @@ const String16 sDump("android.permission.DUMP");
 
 const char* const GpuService::SERVICE_NAME = "gpu";
 
-GpuService::GpuService() : mGpuStats(std::make_unique<GpuStats>()){};
+GpuService::GpuService()
+      : mGpuMem(std::make_unique<GpuMem>()), mGpuStats(std::make_unique<GpuStats>()){};
 
 void GpuService::setGpuStats(const std::string& driverPackageName,
                              const std::string& driverVersionName, uint64_t driverVersionCode,
@@ -82,6 +84,31 @@ void GpuService::setCpuVulkanInUse(const std::string& appPackageName,
     mGpuStats->setCpuVulkanInUse(appPackageName, driverVersionCode);
 }
 
+void GpuService::setGpuMemory(uint64_t grallocMemory, uint64_t driverMemory) {
+    ATRACE_CALL();
+
+    // Attribute the memory to the caller, so a process can't report for another.
+    const int32_t pid = IPCThreadState::self()->getCallingPid();
+    mGpuMem->update(pid, grallocMemory, driverMemory);
+}
+
+status_t GpuService::getGpuMemInfo(std::vector<GpuMemInfo>* outInfo) const {
+    ATRACE_CALL();
+
+    // Like the dump, this shows the memory use of every process.
+    IPCThreadState* ipc = IPCThreadState::self();
+    const int pid = ipc->getCallingPid();
+    const int uid = ipc->getCallingUid();
+    if ((uid != AID_SHELL) && !PermissionCache::checkPermission(sDump, pid, uid)) {
+        ALOGE("Permission Denial: can't get gpu memory info from pid=%d, uid=%d", pid, uid);
+        return PERMISSION_DENIED;
+    }
+
+    mGpuMem->pull(outInfo);
+
+    return OK;
+}
+
 status_t GpuService::shellCommand(int /*in*/, int out, int err, std::vector<String16>& args) {
     ATRACE_CALL();
 
@@ -117,6 +144,10 @@ status_t GpuService::doDump(int fd, const Vector<String16>& args, bool /*asProto
                 index++;
                 mGpuStats->dump(args, &result);
                 dumpAll = false;
+            } else if ((index < numArgs) && (args[index] == String16("--gpumem"))) {
+                index++;
+                mGpuMem->dump(args, &result);
+                dumpAll = false;
             }
         }
 
@@ -126,6 +157,9 @@ status_t GpuService::doDump(int fd, const Vector<String16>& args, bool /*asProto
 
             mGpuStats->dump(Vector<String16>(), &result);
             result.append("\n");
+
+            mGpuMem->dump(Vector<String16>(), &result);
+            result.append("\n");
         }
     }
 
@@ -28,6 +28,7 @@
 
 namespace android {
 
+class GpuMem;
 class GpuStats;
 
 class GpuService : public BnGpuService, public PriorityDumper {
@@ -52,6 +53,8 @@ private:
     status_t getGpuStatsAppInfo(std::vector<GpuStatsAppInfo>* outStats) const override;
     void setCpuVulkanInUse(const std::string& appPackageName,
                            const uint64_t driverVersionCode) override;
+    void setGpuMemory(uint64_t grallocMemory, uint64_t driverMemory) override;
+    status_t getGpuMemInfo(std::vector<GpuMemInfo>* outInfo) const override;
 
     /*
      * IBinder interface
@@ -74,6 +77,7 @@ private:
     /*
      * Attributes
      */
+    std::unique_ptr<GpuMem> mGpuMem;
     std::unique_ptr<GpuStats> mGpuStats;
 };
 
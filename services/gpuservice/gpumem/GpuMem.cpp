@@ -0,0 +1,133 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "GpuMem"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "GpuMem.h"
+
+#include <android-base/stringprintf.h>
+#include <errno.h>
+#include <log/log.h>
+#include <signal.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace android {
+
+using base::StringAppendF;
+
+void GpuMem::update(int32_t pid, uint64_t grallocMemory, uint64_t driverMemory) {
+    ATRACE_CALL();
+
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mRecords.count(pid) && mRecords.size() >= MAX_NUM_PROCESSES) {
+        removeDeadProcessesLocked();
+        if (mRecords.size() >= MAX_NUM_PROCESSES) {
+            // Make room by dropping the process that reported least recently.
+            auto oldest = std::min_element(mRecords.begin(), mRecords.end(),
+                                           [](const auto& a, const auto& b) {
+                                               return a.second.info.lastUpdateTime <
+                                                       b.second.info.lastUpdateTime;
+                                           });
+            mRecords.erase(oldest);
+        }
+    }
+
+    Record& record = mRecords[pid];
+    const uint64_t total = grallocMemory + driverMemory;
+    record.info.pid = pid;
+    record.info.grallocMemory = grallocMemory;
+    record.info.driverMemory = driverMemory;
+    record.info.peakMemory = std::max(record.info.peakMemory, total);
+    record.info.lastUpdateTime = systemTime();
+    if (record.history.size() >= MAX_NUM_HISTORY) {
+        record.history.pop_front();
+    }
+    record.history.push_back(static_cast<int64_t>(total));
+}
+
+void GpuMem::dump(const Vector<String16>& args, std::string* result) {
+    ATRACE_CALL();
+
+    if (!result) {
+        ALOGE("Dump result shouldn't be nullptr.");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    std::unordered_set<std::string> argsSet;
+    for (size_t i = 0; i < args.size(); i++) {
+        argsSet.insert(String8(args[i]).c_str());
+    }
+
+    if (argsSet.count("--clear")) {
+        mRecords.clear();
+        return;
+    }
+
+    removeDeadProcessesLocked();
+
+    uint64_t grallocMemory = 0;
+    uint64_t driverMemory = 0;
+    for (const auto& ele : mRecords) {
+        grallocMemory += ele.second.info.grallocMemory;
+        driverMemory += ele.second.info.driverMemory;
+    }
+    StringAppendF(result, "GPU memory: %zu processes, gralloc %.2f KiB, driver %.2f KiB\n",
+                  mRecords.size(), grallocMemory / 1024.0, driverMemory / 1024.0);
+
+    for (const auto& ele : mRecords) {
+        result->append(toInfoLocked(ele.second).toString());
+        result->append("\n");
+    }
+}
+
+void GpuMem::pull(std::vector<GpuMemInfo>* outInfo) {
+    ATRACE_CALL();
+
+    std::lock_guard<std::mutex> lock(mLock);
+    removeDeadProcessesLocked();
+
+    outInfo->clear();
+    outInfo->reserve(mRecords.size());
+    for (const auto& ele : mRecords) {
+        outInfo->emplace_back(toInfoLocked(ele.second));
+    }
+}
+
+void GpuMem::removeDeadProcessesLocked() {
+    for (auto it = mRecords.begin(); it != mRecords.end();) {
+        if (kill(it->first, 0) != 0 && errno == ESRCH) {
+            it = mRecords.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+GpuMemInfo GpuMem::toInfoLocked(const Record& record) const {
+    GpuMemInfo info = record.info;
+    info.memoryHistory.assign(record.history.begin(), record.history.end());
+    return info;
+}
+
+} // namespace android
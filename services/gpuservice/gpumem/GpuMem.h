@@ -0,0 +1,65 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <graphicsenv/GpuStatsInfo.h>
+#include <utils/String16.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Keeps the graphics memory use processes report, so the gpu service can
+// attribute it to them.
+class GpuMem {
+public:
+    GpuMem() = default;
+    ~GpuMem() = default;
+
+    // Record the graphics memory use reported by pid.
+    void update(int32_t pid, uint64_t grallocMemory, uint64_t driverMemory);
+    // dumpsys interface
+    void dump(const Vector<String16>& args, std::string* result);
+    // Pull per-process graphics memory use
+    void pull(std::vector<GpuMemInfo>* outInfo);
+
+    // This limits the number of reports kept per process.
+    static const size_t MAX_NUM_HISTORY = 16;
+    // Below limits the memory usage of GpuMem to be less than 64KB.
+    static const size_t MAX_NUM_PROCESSES = 256;
+
+private:
+    struct Record {
+        GpuMemInfo info;
+        std::deque<int64_t> history;
+    };
+
+    // Drop the records of processes that have died.
+    void removeDeadProcessesLocked();
+    GpuMemInfo toInfoLocked(const Record& record) const;
+
+    // GpuMem access should be guarded by mLock.
+    std::mutex mLock;
+    // Key is pid.
+    std::unordered_map<int32_t, Record> mRecords;
+};
+
+} // namespace android
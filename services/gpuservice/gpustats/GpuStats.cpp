@@ -108,32 +108,45 @@ void GpuStats::insert(const std::string& driverPackageName, const std::string& d
         addLoadingCount(driver, isDriverLoaded, &mGlobalStats[driverVersionCode]);
     }
 
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-    if (!mAppStats.count(appStatsKey)) {
+    GpuStatsAppInfo* appInfo = findAppStatsLocked(appPackageName, driverVersionCode);
+    if (!appInfo) {
         if (mAppStats.size() >= MAX_NUM_APP_RECORDS) {
-            ALOGV("GpuStatsAppInfo has reached maximum size. Ignore new stats.");
-            return;
+            ALOGV("GpuStatsAppInfo has reached maximum size. Drop the least recently used.");
+            const GpuStatsAppInfo& oldest = mAppStats.back();
+            mAppStatsIndex.erase({oldest.appPackageName, oldest.driverVersionCode});
+            mAppStats.pop_back();
         }
 
-        GpuStatsAppInfo appInfo;
-        addLoadingTime(driver, driverLoadingTime, &appInfo);
-        appInfo.appPackageName = appPackageName;
-        appInfo.driverVersionCode = driverVersionCode;
-        mAppStats.insert({appStatsKey, appInfo});
-        return;
+        mAppStats.emplace_front();
+        appInfo = &mAppStats.front();
+        appInfo->appPackageName = appPackageName;
+        appInfo->driverVersionCode = driverVersionCode;
+        mAppStatsIndex.insert({{appInfo->appPackageName, driverVersionCode}, mAppStats.begin()});
     }
 
-    addLoadingTime(driver, driverLoadingTime, &mAppStats[appStatsKey]);
+    addLoadingTime(driver, driverLoadingTime, appInfo);
 }
 
 void GpuStats::setCpuVulkanInUse(const std::string& appPackageName,
                                  const uint64_t driverVersionCode) {
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-    if (!mAppStats.count(appStatsKey)) {
+    std::lock_guard<std::mutex> lock(mLock);
+    GpuStatsAppInfo* appInfo = findAppStatsLocked(appPackageName, driverVersionCode);
+    if (!appInfo) {
         return;
     }
 
-    mAppStats[appStatsKey].cpuVulkanInUse = true;
+    appInfo->cpuVulkanInUse = true;
+}
+
+GpuStatsAppInfo* GpuStats::findAppStatsLocked(const std::string& appPackageName,
+                                              uint64_t driverVersionCode) {
+    const auto it = mAppStatsIndex.find({appPackageName, driverVersionCode});
+    if (it == mAppStatsIndex.end()) {
+        return nullptr;
+    }
+
+    mAppStats.splice(mAppStats.begin(), mAppStats, it->second);
+    return &*it->second;
 }
 
 void GpuStats::interceptSystemDriverStatsLocked() {
@@ -183,12 +196,14 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
         }
 
         if (dumpApp) {
+            mAppStatsIndex.clear();
             mAppStats.clear();
             clearAll = false;
         }
 
         if (clearAll) {
             mGlobalStats.clear();
+            mAppStatsIndex.clear();
             mAppStats.clear();
         }
 
@@ -212,7 +227,7 @@ void GpuStats::dumpGlobalLocked(std::string* result) {
 
 void GpuStats::dumpAppLocked(std::string* result) {
     for (const auto& ele : mAppStats) {
-        result->append(ele.second.toString());
+        result->append(ele.toString());
         result->append("\n");
     }
 }
@@ -241,9 +256,10 @@ void GpuStats::pullAppStats(std::vector<GpuStatsAppInfo>* outStats) {
     outStats->reserve(mAppStats.size());
 
     for (const auto& ele : mAppStats) {
-        outStats->emplace_back(ele.second);
+        outStats->emplace_back(ele);
     }
 
+    mAppStatsIndex.clear();
     mAppStats.clear();
 }
 
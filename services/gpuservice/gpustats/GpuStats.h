@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <list>
 #include <mutex>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -50,6 +52,28 @@ public:
     static const size_t MAX_NUM_LOADING_TIMES = 50;
 
 private:
+    // Points into the GpuStatsAppInfo it keys, so looking a record up doesn't build a string.
+    struct AppStatsKey {
+        std::string_view appPackageName;
+        uint64_t driverVersionCode;
+
+        bool operator==(const AppStatsKey& other) const {
+            return driverVersionCode == other.driverVersionCode &&
+                    appPackageName == other.appPackageName;
+        }
+    };
+
+    struct AppStatsKeyHash {
+        size_t operator()(const AppStatsKey& key) const {
+            return std::hash<std::string_view>()(key.appPackageName) ^
+                    std::hash<uint64_t>()(key.driverVersionCode);
+        }
+    };
+
+    // Find the app stats record for the key and make it the most recently used, or return
+    // nullptr if there is none.
+    GpuStatsAppInfo* findAppStatsLocked(const std::string& appPackageName,
+                                        uint64_t driverVersionCode);
     // Dump global stats
     void dumpGlobalLocked(std::string* result);
     // Dump app stats
@@ -64,8 +88,11 @@ private:
     std::mutex mLock;
     // Key is driver version code.
     std::unordered_map<uint64_t, GpuStatsGlobalInfo> mGlobalStats;
-    // Key is <app package name>+<driver version code>.
-    std::unordered_map<std::string, GpuStatsAppInfo> mAppStats;
+    // Most recently used first. Once there are MAX_NUM_APP_RECORDS, the least recently used
+    // record makes room for a new one.
+    std::list<GpuStatsAppInfo> mAppStats;
+    std::unordered_map<AppStatsKey, std::list<GpuStatsAppInfo>::iterator, AppStatsKeyHash>
+            mAppStatsIndex;
 };
 
 } // namespace android
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "GpuMemTest"
+
+#include <gtest/gtest.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gpumem/GpuMem.h"
+
+namespace android {
+namespace {
+
+// Far above any pid_max, so kill() always reports these as gone.
+constexpr int32_t kDeadPid = 0x7fff0000;
+
+class GpuMemTest : public testing::Test {
+protected:
+    const GpuMemInfo* find(const std::vector<GpuMemInfo>& infos, int32_t pid) {
+        auto it = std::find_if(infos.begin(), infos.end(),
+                               [pid](const GpuMemInfo& info) { return info.pid == pid; });
+        return it == infos.end() ? nullptr : &*it;
+    }
+
+    GpuMem mGpuMem;
+};
+
+TEST_F(GpuMemTest, pullReturnsLatestUpdate) {
+    const int32_t pid = getpid();
+    mGpuMem.update(pid, 100, 50);
+    mGpuMem.update(pid, 300, 20);
+
+    std::vector<GpuMemInfo> infos;
+    mGpuMem.pull(&infos);
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ(pid, infos[0].pid);
+    EXPECT_EQ(300u, infos[0].grallocMemory);
+    EXPECT_EQ(20u, infos[0].driverMemory);
+    EXPECT_EQ(320u, infos[0].peakMemory);
+    EXPECT_EQ(std::vector<int64_t>({150, 320}), infos[0].memoryHistory);
+
+    mGpuMem.update(pid, 10, 10);
+    mGpuMem.pull(&infos);
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ(320u, infos[0].peakMemory);
+}
+
+TEST_F(GpuMemTest, historyKeepsLatestReports) {
+    const int32_t pid = getpid();
+    for (size_t i = 0; i < GpuMem::MAX_NUM_HISTORY + 4; i++) {
+        mGpuMem.update(pid, i, 0);
+    }
+
+    std::vector<GpuMemInfo> infos;
+    mGpuMem.pull(&infos);
+    ASSERT_EQ(1u, infos.size());
+    ASSERT_EQ(GpuMem::MAX_NUM_HISTORY, infos[0].memoryHistory.size());
+    EXPECT_EQ(4, infos[0].memoryHistory.front());
+    EXPECT_EQ(static_cast<int64_t>(GpuMem::MAX_NUM_HISTORY + 3), infos[0].memoryHistory.back());
+}
+
+TEST_F(GpuMemTest, pullDropsDeadProcesses) {
+    mGpuMem.update(getpid(), 100, 0);
+    mGpuMem.update(kDeadPid, 100, 0);
+
+    std::vector<GpuMemInfo> infos;
+    mGpuMem.pull(&infos);
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ(getpid(), infos[0].pid);
+}
+
+TEST_F(GpuMemTest, fullTableDropsDeadProcessesFirst) {
+    for (size_t i = 0; i < GpuMem::MAX_NUM_PROCESSES; i++) {
+        mGpuMem.update(kDeadPid + static_cast<int32_t>(i), 100, 0);
+    }
+    mGpuMem.update(getpid(), 100, 0);
+
+    std::vector<GpuMemInfo> infos;
+    mGpuMem.pull(&infos);
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ(getpid(), infos[0].pid);
+}
+
+TEST_F(GpuMemTest, fullTableEvictsLeastRecentlyUpdated) {
+    // kill() accepts thread ids too, so threads stand in for live processes.
+    std::mutex lock;
+    std::condition_variable cv;
+    bool done = false;
+    std::vector<int32_t> tids;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < GpuMem::MAX_NUM_PROCESSES; i++) {
+        threads.emplace_back([&]() {
+            std::unique_lock<std::mutex> guard(lock);
+            tids.push_back(static_cast<int32_t>(syscall(__NR_gettid)));
+            cv.notify_all();
+            cv.wait(guard, [&]() { return done; });
+        });
+    }
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        cv.wait(guard, [&]() { return tids.size() == GpuMem::MAX_NUM_PROCESSES; });
+    }
+
+    for (int32_t tid : tids) {
+        mGpuMem.update(tid, 100, 0);
+    }
+    // Reporting again makes the first thread the most recent one.
+    mGpuMem.update(tids[0], 100, 0);
+    mGpuMem.update(getpid(), 100, 0);
+
+    std::vector<GpuMemInfo> infos;
+    mGpuMem.pull(&infos);
+    EXPECT_EQ(GpuMem::MAX_NUM_PROCESSES, infos.size());
+    EXPECT_NE(nullptr, find(infos, getpid()));
+    EXPECT_NE(nullptr, find(infos, tids[0]));
+    EXPECT_EQ(nullptr, find(infos, tids[1]));
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        done = true;
+    }
+    cv.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace
+} // namespace android
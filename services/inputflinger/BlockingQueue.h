@@ -18,7 +18,9 @@
 #define _UI_INPUT_BLOCKING_QUEUE_H
 
 #include "android-base/thread_annotations.h"
+#include <algorithm>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <vector>
 
@@ -54,6 +56,23 @@ public:
         return t;
     };
 
+    /**
+     * Retrieve and remove all of the objects, oldest first.
+     * Blocks execution while queue is empty.
+     */
+    std::vector<T> popAll() {
+        std::unique_lock lock(mLock);
+        android::base::ScopedLockAssertion assumeLock(mLock);
+        mHasElements.wait(lock, [this]{
+                android::base::ScopedLockAssertion assumeLock(mLock);
+                return !this->mQueue.empty();
+        });
+        std::vector<T> all;
+        all.reserve(mCapacity);
+        std::swap(all, mQueue);
+        return all;
+    };
+
     /**
      * Add a new object to the queue.
      * Does not block.
@@ -72,6 +91,32 @@ public:
         return true;
     };
 
+    /**
+     * Add a new object to the queue, making room if the queue is full by removing
+     * the oldest object for which isDroppable returns true.
+     * Does not block.
+     * Return true if an element was successfully added, and set outDropped if another one
+     * was removed for it.
+     * Return false if the queue is full of objects that cannot be dropped.
+     */
+    bool push(T&& t, const std::function<bool(const T&)>& isDroppable, bool* outDropped) {
+        *outDropped = false;
+        {
+            std::scoped_lock lock(mLock);
+            if (mQueue.size() == mCapacity) {
+                auto it = std::find_if(mQueue.begin(), mQueue.end(), isDroppable);
+                if (it == mQueue.end()) {
+                    return false;
+                }
+                mQueue.erase(it);
+                *outDropped = true;
+            }
+            mQueue.push_back(std::move(t));
+        }
+        mHasElements.notify_one();
+        return true;
+    };
+
     void erase(const std::function<bool(const T&)>& lambda) {
         std::scoped_lock lock(mLock);
         mQueue.erase(std::remove_if(mQueue.begin(), mQueue.end(),
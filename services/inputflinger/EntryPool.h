@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _UI_INPUT_ENTRY_POOL_H
+#define _UI_INPUT_ENTRY_POOL_H
+
+#include "android-base/thread_annotations.h"
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+
+struct EntryPoolStats {
+    size_t capacity;
+    size_t inUse;
+    size_t peakInUse;
+    uint64_t allocations;
+    uint64_t heapAllocations; // allocations that did not come from the slab
+};
+
+/**
+ * A fixed-size slab of storage for objects of type T, meant to back a class specific
+ * operator new / operator delete pair.
+ * The slab is allocated once, up front. Allocations that don't fit, either because the slab
+ * is full or because they are not sizeof(T) (a subclass), fall back to the heap.
+ *
+ * Allocation and release may happen on different threads.
+ */
+template <class T>
+class EntryPool {
+public:
+    explicit EntryPool(size_t capacity) : mCapacity(capacity), mSlots(new Slot[capacity]) {
+        for (size_t i = 0; i < mCapacity; i++) {
+            mSlots[i].next = i + 1 < mCapacity ? &mSlots[i + 1] : nullptr;
+        }
+        mFreeList = mCapacity ? &mSlots[0] : nullptr;
+    }
+
+    ~EntryPool() {
+        delete[] mSlots;
+    }
+
+    EntryPool(const EntryPool&) = delete;
+    EntryPool& operator=(const EntryPool&) = delete;
+
+    void* allocate(size_t size) {
+        {
+            std::scoped_lock lock(mLock);
+            mAllocations++;
+            if (size == sizeof(T) && mFreeList != nullptr) {
+                Slot* slot = mFreeList;
+                mFreeList = slot->next;
+                mInUse++;
+                if (mInUse > mPeakInUse) {
+                    mPeakInUse = mInUse;
+                }
+                return slot->storage;
+            }
+            mHeapAllocations++;
+        }
+        return ::operator new(size);
+    }
+
+    void release(void* p) {
+        if (p == nullptr) {
+            return;
+        }
+        if (!owns(p)) {
+            ::operator delete(p);
+            return;
+        }
+        std::scoped_lock lock(mLock);
+        Slot* slot = static_cast<Slot*>(p);
+        slot->next = mFreeList;
+        mFreeList = slot;
+        mInUse--;
+    }
+
+    EntryPoolStats getStats() {
+        std::scoped_lock lock(mLock);
+        return EntryPoolStats{mCapacity, mInUse, mPeakInUse, mAllocations, mHeapAllocations};
+    }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    bool owns(const void* p) const {
+        const Slot* slot = static_cast<const Slot*>(p);
+        return slot >= mSlots && slot < mSlots + mCapacity;
+    }
+
+    const size_t mCapacity;
+    Slot* const mSlots;
+
+    std::mutex mLock;
+    Slot* mFreeList GUARDED_BY(mLock);
+    size_t mInUse GUARDED_BY(mLock) = 0;
+    size_t mPeakInUse GUARDED_BY(mLock) = 0;
+    uint64_t mAllocations GUARDED_BY(mLock) = 0;
+    uint64_t mHeapAllocations GUARDED_BY(mLock) = 0;
+};
+
+} // namespace android
+#endif
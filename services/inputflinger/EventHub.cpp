@@ -247,7 +247,8 @@ EventHub::EventHub(void) :
         mOpeningDevices(nullptr), mClosingDevices(nullptr),
         mNeedToSendFinishedDeviceScan(false),
         mNeedToReopenDevices(false), mNeedToScanDevices(true),
-        mPendingEventCount(0), mPendingEventIndex(0), mPendingINotify(false) {
+        mPendingEventCount(0), mPendingEventIndex(0), mPendingINotify(false),
+        mEventBatchCount(0), mEventCount(0), mMaxEventsPerBatch(0) {
     acquire_wake_lock(PARTIAL_WAKE_LOCK, WAKE_LOCK_ID);
 
     mEpollFd = epoll_create1(EPOLL_CLOEXEC);
@@ -479,6 +480,32 @@ status_t EventHub::getAbsoluteAxisValue(int32_t deviceId, int32_t axis, int32_t*
     return -1;
 }
 
+status_t EventHub::getMtSlotValues(int32_t deviceId, int32_t axis, size_t slotCount,
+        std::vector<int32_t>* outValues) const {
+    outValues->clear();
+
+    if (axis >= ABS_MT_SLOT && axis <= ABS_MAX) {
+        AutoMutex _l(mLock);
+
+        Device* device = getDeviceLocked(deviceId);
+        if (device && device->hasValidFd() && test_bit(axis, device->absBitmask)) {
+            // EVIOCGMTSLOTS takes the axis code followed by room for one value per slot.
+            std::vector<int32_t> request(slotCount + 1);
+            request[0] = axis;
+            if (ioctl(device->fd, EVIOCGMTSLOTS(sizeof(int32_t) * request.size()),
+                    request.data())) {
+                ALOGW("Error reading multitouch slots of axis %d for device %s fd %d, errno=%d",
+                     axis, device->identifier.name.c_str(), device->fd, errno);
+                return -errno;
+            }
+
+            outValues->assign(request.begin() + 1, request.end());
+            return OK;
+        }
+    }
+    return -1;
+}
+
 bool EventHub::markSupportedKeyCodes(int32_t deviceId, size_t numCodes,
         const int32_t* keyCodes, uint8_t* outFlags) const {
     AutoMutex _l(mLock);
@@ -821,6 +848,7 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
 
     RawEvent* event = buffer;
     size_t capacity = bufferSize;
+    size_t inputEventCount = 0;
     bool awoken = false;
     for (;;) {
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
@@ -832,6 +860,7 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
             ALOGI("Reopening all input devices due to a configuration change.");
 
             closeAllDevicesLocked();
+            mDeviceConfigCache.clear();
             mNeedToScanDevices = true;
             break; // return to the caller before we actually rescan
         }
@@ -886,6 +915,8 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
         }
 
         // Grab the next input event.
+        // Every ready device is read before returning, so the reader gets all of them in
+        // one batch.
         bool deviceChanged = false;
         while (mPendingEventIndex < mPendingEventCount) {
             const struct epoll_event& eventItem = mPendingEventItems[mPendingEventIndex++];
@@ -962,6 +993,7 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                     int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
 
                     size_t count = size_t(readSize) / sizeof(struct input_event);
+                    inputEventCount += count;
                     for (size_t i = 0; i < count; i++) {
                         struct input_event& iev = readBuffer[i];
                         event->when = processEventTimestamp(iev);
@@ -1052,6 +1084,14 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
         }
     }
 
+    if (inputEventCount) {
+        mEventBatchCount++;
+        mEventCount += inputEventCount;
+        if (inputEventCount > mMaxEventsPerBatch) {
+            mMaxEventsPerBatch = inputEventCount;
+        }
+    }
+
     // All done, return the number of events we read.
     return event - buffer;
 }
@@ -1605,7 +1645,25 @@ void EventHub::addDeviceLocked(Device* device) {
     mOpeningDevices = device;
 }
 
+std::string EventHub::getDeviceConfigCacheKey(const InputDeviceIdentifier& identifier) {
+    // The configuration and key map lookups depend on the vendor, product, version and name.
+    return StringPrintf("%04x:%04x:%04x:%s", identifier.vendor, identifier.product,
+            identifier.version, identifier.name.c_str());
+}
+
 void EventHub::loadConfigurationLocked(Device* device) {
+    const std::string key = getDeviceConfigCacheKey(device->identifier);
+    auto it = mDeviceConfigCache.find(key);
+    if (it != mDeviceConfigCache.end()) {
+        const DeviceConfigCacheEntry& entry = it->second;
+        device->configurationFile = entry.configurationFile;
+        if (entry.configuration) {
+            device->configuration = new PropertyMap();
+            device->configuration->addAll(entry.configuration.get());
+        }
+        return;
+    }
+
     device->configurationFile = getInputDeviceConfigurationFilePathByDeviceIdentifier(
             device->identifier, INPUT_DEVICE_CONFIGURATION_FILE_TYPE_CONFIGURATION);
     if (device->configurationFile.empty()) {
@@ -1620,6 +1678,16 @@ void EventHub::loadConfigurationLocked(Device* device) {
                     device->identifier.name.c_str());
         }
     }
+
+    if (mDeviceConfigCache.size() >= MAX_DEVICE_CONFIG_CACHE_SIZE) {
+        mDeviceConfigCache.clear();
+    }
+    DeviceConfigCacheEntry& entry = mDeviceConfigCache[key];
+    entry.configurationFile = device->configurationFile;
+    if (device->configuration) {
+        entry.configuration = std::make_unique<PropertyMap>();
+        entry.configuration->addAll(device->configuration);
+    }
 }
 
 bool EventHub::loadVirtualKeyMapLocked(Device* device) {
@@ -1635,7 +1703,20 @@ bool EventHub::loadVirtualKeyMapLocked(Device* device) {
 }
 
 status_t EventHub::loadKeyMapLocked(Device* device) {
-    return device->keyMap.load(device->identifier, device->configuration);
+    // The key map depends on the configuration, so it is only cached alongside it.
+    auto it = mDeviceConfigCache.find(getDeviceConfigCacheKey(device->identifier));
+    if (it == mDeviceConfigCache.end()) {
+        return device->keyMap.load(device->identifier, device->configuration);
+    }
+
+    DeviceConfigCacheEntry& entry = it->second;
+    if (!entry.haveKeyMap) {
+        entry.keyMapStatus = entry.keyMap.load(device->identifier, device->configuration);
+        entry.haveKeyMap = true;
+    }
+    // The key layout and character maps are immutable once loaded, so they can be shared.
+    device->keyMap = entry.keyMap;
+    return entry.keyMapStatus;
 }
 
 bool EventHub::isExternalDeviceLocked(Device* device) {
@@ -1919,6 +2000,11 @@ void EventHub::dump(std::string& dump) {
         AutoMutex _l(mLock);
 
         dump += StringPrintf(INDENT "BuiltInKeyboardId: %d\n", mBuiltInKeyboardId);
+        dump += StringPrintf(INDENT "EventBatches: %" PRIu64 ", Events: %" PRIu64
+                ", AverageEventsPerBatch: %.1f, MaxEventsPerBatch: %zu\n",
+                mEventBatchCount, mEventCount,
+                mEventBatchCount ? double(mEventCount) / mEventBatchCount : 0.0,
+                mMaxEventsPerBatch);
 
         dump += INDENT "Devices:\n";
 
@@ -18,6 +18,7 @@
 #ifndef _RUNTIME_EVENT_HUB_H
 #define _RUNTIME_EVENT_HUB_H
 
+#include <unordered_map>
 #include <vector>
 
 #include <input/Input.h>
@@ -214,6 +215,9 @@ public:
     virtual int32_t getSwitchState(int32_t deviceId, int32_t sw) const = 0;
     virtual status_t getAbsoluteAxisValue(int32_t deviceId, int32_t axis,
             int32_t* outValue) const = 0;
+    /* Reads the current values of a multitouch axis for the first slotCount slots. */
+    virtual status_t getMtSlotValues(int32_t deviceId, int32_t axis, size_t slotCount,
+            std::vector<int32_t>* outValues) const = 0;
 
     /*
      * Examine key input devices for specific framework keycode support
@@ -292,6 +296,8 @@ public:
     virtual int32_t getKeyCodeState(int32_t deviceId, int32_t keyCode) const;
     virtual int32_t getSwitchState(int32_t deviceId, int32_t sw) const;
     virtual status_t getAbsoluteAxisValue(int32_t deviceId, int32_t axis, int32_t* outValue) const;
+    virtual status_t getMtSlotValues(int32_t deviceId, int32_t axis, size_t slotCount,
+            std::vector<int32_t>* outValues) const;
 
     virtual bool markSupportedKeyCodes(int32_t deviceId, size_t numCodes,
             const int32_t* keyCodes, uint8_t* outFlags) const;
@@ -418,6 +424,7 @@ private:
     void loadConfigurationLocked(Device* device);
     bool loadVirtualKeyMapLocked(Device* device);
     status_t loadKeyMapLocked(Device* device);
+    static std::string getDeviceConfigCacheKey(const InputDeviceIdentifier& identifier);
 
     bool isExternalDeviceLocked(Device* device);
     bool deviceHasMicLocked(Device* device);
@@ -480,7 +487,27 @@ private:
     size_t mPendingEventIndex;
     bool mPendingINotify;
 
+    // Input events read from devices, for the dump: how many getEvents calls returned some,
+    // how many in total, and the most returned at once.
+    uint64_t mEventBatchCount;
+    uint64_t mEventCount;
+    size_t mMaxEventsPerBatch;
+
     bool mUsingEpollWakeup;
+
+    // The configuration and key map files found and parsed for devices opened before, keyed by
+    // the identifier fields that the file lookups depend on. A device that reconnects, such as a
+    // Bluetooth keyboard waking up, reuses them rather than searching for and parsing its files
+    // again on the reader thread. Cleared when all devices are reopened.
+    struct DeviceConfigCacheEntry {
+        std::string configurationFile;
+        std::unique_ptr<PropertyMap> configuration;
+        bool haveKeyMap = false;
+        status_t keyMapStatus = NAME_NOT_FOUND;
+        KeyMap keyMap;
+    };
+    static const size_t MAX_DEVICE_CONFIG_CACHE_SIZE = 32;
+    std::unordered_map<std::string, DeviceConfigCacheEntry> mDeviceConfigCache;
 };
 
 }; // namespace android
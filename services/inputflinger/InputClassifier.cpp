@@ -231,56 +231,107 @@ void MotionClassifier::callInputClassifierHal() {
     // From this point on, mService is guaranteed to be non-null.
 
     while (true) {
-        ClassifierEvent event = mEvents.pop();
-        bool halResponseOk = true;
-        switch (event.type) {
-            case ClassifierEventType::MOTION: {
-                NotifyMotionArgs* motionArgs = static_cast<NotifyMotionArgs*>(event.args.get());
-                common::V1_0::MotionEvent motionEvent =
-                        notifyMotionArgsToHalMotionEvent(*motionArgs);
-                Return<common::V1_0::Classification> response = mService->classify(motionEvent);
-                halResponseOk = response.isOk();
-                if (halResponseOk) {
-                    common::V1_0::Classification halClassification = response;
-                    updateClassification(motionArgs->deviceId, motionArgs->eventTime,
-                            getMotionClassification(halClassification));
+        // The HAL takes one event per call, but everything that queued up while it was busy
+        // is taken at once.
+        std::vector<ClassifierEvent> events = mEvents.popAll();
+        recordBatch(events.size());
+        for (ClassifierEvent& event : events) {
+            bool halResponseOk = true;
+            switch (event.type) {
+                case ClassifierEventType::MOTION: {
+                    NotifyMotionArgs* motionArgs =
+                            static_cast<NotifyMotionArgs*>(event.args.get());
+                    common::V1_0::MotionEvent motionEvent =
+                            notifyMotionArgsToHalMotionEvent(*motionArgs);
+                    const nsecs_t callTime = systemTime(SYSTEM_TIME_MONOTONIC);
+                    Return<common::V1_0::Classification> response =
+                            mService->classify(motionEvent);
+                    const nsecs_t responseTime = systemTime(SYSTEM_TIME_MONOTONIC);
+                    halResponseOk = response.isOk();
+                    if (halResponseOk) {
+                        common::V1_0::Classification halClassification = response;
+                        updateClassification(motionArgs->deviceId, motionArgs->eventTime,
+                                getMotionClassification(halClassification));
+                        recordHalCall(responseTime - callTime,
+                                responseTime - motionArgs->eventTime);
+                    }
+                    break;
+                }
+                case ClassifierEventType::DEVICE_RESET: {
+                    const int32_t deviceId = *(event.getDeviceId());
+                    halResponseOk = mService->resetDevice(deviceId).isOk();
+                    setClassification(deviceId, MotionClassification::NONE);
+                    break;
+                }
+                case ClassifierEventType::HAL_RESET: {
+                    halResponseOk = mService->reset().isOk();
+                    clearClassifications();
+                    break;
+                }
+                case ClassifierEventType::EXIT: {
+                    clearClassifications();
+                    return;
                 }
-                break;
-            }
-            case ClassifierEventType::DEVICE_RESET: {
-                const int32_t deviceId = *(event.getDeviceId());
-                halResponseOk = mService->resetDevice(deviceId).isOk();
-                setClassification(deviceId, MotionClassification::NONE);
-                break;
-            }
-            case ClassifierEventType::HAL_RESET: {
-                halResponseOk = mService->reset().isOk();
-                clearClassifications();
-                break;
             }
-            case ClassifierEventType::EXIT: {
+            if (!halResponseOk) {
+                ALOGE("Error communicating with InputClassifier HAL. "
+                        "Exiting MotionClassifier HAL thread");
                 clearClassifications();
                 return;
             }
         }
-        if (!halResponseOk) {
-            ALOGE("Error communicating with InputClassifier HAL. "
-                    "Exiting MotionClassifier HAL thread");
-            clearClassifications();
-            return;
-        }
     }
 }
 
+static bool isMoveEvent(const ClassifierEvent& event) {
+    if (event.type != ClassifierEventType::MOTION) {
+        return false;
+    }
+    const NotifyMotionArgs* motionArgs = static_cast<const NotifyMotionArgs*>(event.args.get());
+    return (motionArgs->action & AMOTION_EVENT_ACTION_MASK) == AMOTION_EVENT_ACTION_MOVE;
+}
+
 void MotionClassifier::enqueueEvent(ClassifierEvent&& event) {
-    bool eventAdded = mEvents.push(std::move(event));
+    // A HAL that falls behind gets the latest moves: the oldest queued move is dropped to make
+    // room. Only when nothing can be dropped, its state is given up on.
+    bool droppedMove;
+    bool eventAdded = mEvents.push(std::move(event), isMoveEvent, &droppedMove);
+    if (droppedMove) {
+        std::scoped_lock lock(mLock);
+        mStats.droppedMoves++;
+    }
     if (!eventAdded) {
         // If the queue is full, suspect the HAL is slow in processing the events.
         ALOGE("Dropped event with eventTime %" PRId64, event.args->eventTime);
+        {
+            std::scoped_lock lock(mLock);
+            mStats.overflowResets++;
+        }
         reset();
     }
 }
 
+void MotionClassifier::recordBatch(size_t size) {
+    std::scoped_lock lock(mLock);
+    mStats.batches++;
+    if (size > mStats.maxBatchSize) {
+        mStats.maxBatchSize = size;
+    }
+}
+
+void MotionClassifier::recordHalCall(nsecs_t duration, nsecs_t latency) {
+    std::scoped_lock lock(mLock);
+    mStats.halCalls++;
+    mStats.totalHalCallTime += duration;
+    if (duration > mStats.maxHalCallTime) {
+        mStats.maxHalCallTime = duration;
+    }
+    mStats.totalLatency += latency;
+    if (latency > mStats.maxLatency) {
+        mStats.maxLatency = latency;
+    }
+}
+
 void MotionClassifier::requestExit() {
     reset();
     mEvents.push(ClassifierEvent::createExitEvent());
@@ -350,21 +401,42 @@ void MotionClassifier::reset(const NotifyDeviceResetArgs& args) {
     enqueueEvent(std::make_unique<NotifyDeviceResetArgs>(args));
 }
 
-const char* MotionClassifier::getServiceStatus() REQUIRES(mLock) {
-    if (!mService) {
+const char* MotionClassifier::getServiceStatus() EXCLUDES(mLock) {
+    sp<android::hardware::input::classifier::V1_0::IInputClassifier> service;
+    {
+        std::scoped_lock lock(mLock);
+        service = mService;
+    }
+    if (!service) {
         return "null";
     }
-    if (mService->ping().isOk()) {
+    // Not under mLock: the ping goes to the HAL, which may be slow, and notifyMotion
+    // needs mLock to read the classification.
+    if (service->ping().isOk()) {
         return "running";
     }
     return "not responding";
 }
 
 void MotionClassifier::dump(std::string& dump) {
+    const char* serviceStatus = getServiceStatus();
     std::scoped_lock lock(mLock);
-    dump += StringPrintf(INDENT2 "mService status: %s\n", getServiceStatus());
+    dump += StringPrintf(INDENT2 "mService status: %s\n", serviceStatus);
     dump += StringPrintf(INDENT2 "mEvents: %zu element(s) (max=%zu)\n",
             mEvents.size(), MAX_EVENTS);
+    dump += StringPrintf(INDENT2 "Batches: %" PRIu64 " (max size=%zu), "
+            "dropped moves: %" PRIu64 ", overflow resets: %" PRIu64 "\n",
+            mStats.batches, mStats.maxBatchSize, mStats.droppedMoves, mStats.overflowResets);
+    if (mStats.halCalls) {
+        dump += StringPrintf(INDENT2 "HAL calls: %" PRIu64 ", duration avg=%0.3fms max=%0.3fms, "
+                "latency from event time avg=%0.3fms max=%0.3fms\n", mStats.halCalls,
+                mStats.totalHalCallTime / 1000000.0 / mStats.halCalls,
+                mStats.maxHalCallTime / 1000000.0,
+                mStats.totalLatency / 1000000.0 / mStats.halCalls,
+                mStats.maxLatency / 1000000.0);
+    } else {
+        dump += INDENT2 "HAL calls: 0\n";
+    }
     dump += INDENT2 "mClassifications, mLastDownTimes:\n";
     dump += INDENT3 "Device Id\tClassification\tLast down time";
     // Combine mClassifications and mLastDownTimes into a single table.
@@ -422,8 +494,14 @@ void InputClassifier::notifyMotion(const NotifyMotionArgs* args) {
         return;
     }
 
+    const MotionClassification classification = mMotionClassifier->classify(*args);
+    if (classification == args->classification) {
+        // Nothing to change, so there is no need for a copy
+        mListener->notifyMotion(args);
+        return;
+    }
     NotifyMotionArgs newArgs(*args);
-    newArgs.classification = mMotionClassifier->classify(newArgs);
+    newArgs.classification = classification;
     mListener->notifyMotion(&newArgs);
 }
 
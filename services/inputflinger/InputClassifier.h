@@ -220,7 +220,26 @@ private:
     /**
      * Return string status of mService
      */
-    const char* getServiceStatus() REQUIRES(mLock);
+    const char* getServiceStatus() EXCLUDES(mLock);
+
+    /**
+     * Counters for dumpsys. Latencies are measured from the event time to the HAL's
+     * response, HAL call durations around the classify call.
+     */
+    struct Stats {
+        uint64_t batches = 0;
+        size_t maxBatchSize = 0;
+        uint64_t droppedMoves = 0;
+        uint64_t overflowResets = 0;
+        uint64_t halCalls = 0;
+        nsecs_t totalHalCallTime = 0;
+        nsecs_t maxHalCallTime = 0;
+        nsecs_t totalLatency = 0;
+        nsecs_t maxLatency = 0;
+    };
+    Stats mStats GUARDED_BY(mLock);
+    void recordBatch(size_t size);
+    void recordHalCall(nsecs_t duration, nsecs_t latency);
 };
 
 
@@ -45,8 +45,10 @@
 
 #include "InputDispatcher.h"
 
+#include <algorithm>
 #include <errno.h>
 #include <inttypes.h>
+#include <iterator>
 #include <limits.h>
 #include <sstream>
 #include <stddef.h>
@@ -100,6 +102,12 @@ constexpr size_t RECENT_QUEUE_MAX_SIZE = 10;
 // Sequence number for synthesized or injected events.
 constexpr uint32_t SYNTHESIZED_EVENT_SEQUENCE_NUM = 0;
 
+// Sizes of the entry pools. These cover the queue depths of normal operation, including
+// high rate stylus input fanned out to gesture monitors; deeper queues spill to the heap.
+constexpr size_t KEY_ENTRY_POOL_SIZE = 32;
+constexpr size_t MOTION_ENTRY_POOL_SIZE = 64;
+constexpr size_t DISPATCH_ENTRY_POOL_SIZE = 256;
+
 
 static inline nsecs_t now() {
     return systemTime(SYSTEM_TIME_MONOTONIC);
@@ -264,7 +272,9 @@ static T getValueByKey(std::unordered_map<U, T>& map, U key) {
 
 InputDispatcher::InputDispatcher(const sp<InputDispatcherPolicyInterface>& policy) :
     mPolicy(policy),
-    mPendingEvent(nullptr), mLastDropReason(DROP_REASON_NOT_DROPPED),
+    mPendingEvent(nullptr), mNextInboundOrder(0), mLastInboundDisplayId(ADISPLAY_ID_NONE),
+    mLastDropReason(DROP_REASON_NOT_DROPPED),
+    mPublishingMessages(false),
     mAppSwitchSawKeyDown(false), mAppSwitchDueTime(LONG_LONG_MAX),
     mNextUnblockedEvent(nullptr),
     mDispatchEnabled(false), mDispatchFrozen(false), mInputFilterEnabled(false),
@@ -297,6 +307,7 @@ void InputDispatcher::dispatchOnce() {
     { // acquire lock
         std::scoped_lock _l(mLock);
         mDispatcherIsAlive.notify_all();
+        mLooperThreadId = std::this_thread::get_id();
 
         // Run a dispatch loop if there are no pending commands.
         // The dispatch loop might enqueue commands to run afterwards.
@@ -311,10 +322,16 @@ void InputDispatcher::dispatchOnce() {
         }
     } // release lock
 
+    // Write out the events that were dispatched above.
+    publishPendingMessages();
+
     // Wait for callback or timeout or wake.  (make sure we round up, not down)
     nsecs_t currentTime = now();
     int timeoutMillis = toMillisecondTimeoutDelay(currentTime, nextWakeupTime);
     mLooper->pollOnce(timeoutMillis);
+
+    // Write out the events queued by the receive callbacks or by other threads.
+    publishPendingMessages();
 }
 
 void InputDispatcher::dispatchOnceInnerLocked(nsecs_t* nextWakeupTime) {
@@ -346,7 +363,8 @@ void InputDispatcher::dispatchOnceInnerLocked(nsecs_t* nextWakeupTime) {
     // Ready to start a new event.
     // If we don't already have a pending event, go grab one.
     if (! mPendingEvent) {
-        if (mInboundQueue.isEmpty()) {
+        mPendingEvent = dequeueInboundEventLocked();
+        if (!mPendingEvent) {
             if (isAppSwitchDue) {
                 // The inbound queue is empty so the app switch key we were waiting
                 // for will never arrive.  Stop waiting for it.
@@ -370,8 +388,6 @@ void InputDispatcher::dispatchOnceInnerLocked(nsecs_t* nextWakeupTime) {
                 return;
             }
         } else {
-            // Inbound queue has at least one entry.
-            mPendingEvent = mInboundQueue.dequeueAtHead();
             traceInboundQueueLengthLocked();
         }
 
@@ -430,7 +446,7 @@ void InputDispatcher::dispatchOnceInnerLocked(nsecs_t* nextWakeupTime) {
                 && isStaleEvent(currentTime, typedEntry)) {
             dropReason = DROP_REASON_STALE;
         }
-        if (dropReason == DROP_REASON_NOT_DROPPED && mNextUnblockedEvent) {
+        if (dropReason == DROP_REASON_NOT_DROPPED && isBlockedByNextUnblockedEventLocked()) {
             dropReason = DROP_REASON_BLOCKED;
         }
         done = dispatchKeyLocked(currentTime, typedEntry, &dropReason, nextWakeupTime);
@@ -446,7 +462,7 @@ void InputDispatcher::dispatchOnceInnerLocked(nsecs_t* nextWakeupTime) {
                 && isStaleEvent(currentTime, typedEntry)) {
             dropReason = DROP_REASON_STALE;
         }
-        if (dropReason == DROP_REASON_NOT_DROPPED && mNextUnblockedEvent) {
+        if (dropReason == DROP_REASON_NOT_DROPPED && isBlockedByNextUnblockedEventLocked()) {
             dropReason = DROP_REASON_BLOCKED;
         }
         done = dispatchMotionLocked(currentTime, typedEntry,
@@ -470,9 +486,23 @@ void InputDispatcher::dispatchOnceInnerLocked(nsecs_t* nextWakeupTime) {
     }
 }
 
+// Events queued before mNextUnblockedEvent are pruned. Events of other displays that were
+// queued after it can be dequeued first, and are not.
+bool InputDispatcher::isBlockedByNextUnblockedEventLocked() const {
+    return mNextUnblockedEvent
+            && mPendingEvent->inboundOrder < mNextUnblockedEvent->inboundOrder;
+}
+
 bool InputDispatcher::enqueueInboundEventLocked(EventEntry* entry) {
-    bool needWake = mInboundQueue.isEmpty();
-    mInboundQueue.enqueueAtTail(entry);
+    bool needWake = isInboundQueueEmptyLocked();
+    entry->inboundOrder = mNextInboundOrder++;
+    entry->enqueueTime = now();
+    if (entry->type == EventEntry::TYPE_MOTION
+            && static_cast<MotionEntry*>(entry)->displayId != ADISPLAY_ID_NONE) {
+        mInboundQueuesByDisplay[static_cast<MotionEntry*>(entry)->displayId].enqueueAtTail(entry);
+    } else {
+        mInboundQueue.enqueueAtTail(entry);
+    }
     traceInboundQueueLengthLocked();
 
     switch (entry->type) {
@@ -530,6 +560,68 @@ bool InputDispatcher::enqueueInboundEventLocked(EventEntry* entry) {
     return needWake;
 }
 
+/**
+ * Each display's queue keeps its order, and an event in mInboundQueue (keys, configuration
+ * changes, device resets, motions without a display) waits until every event queued before it
+ * has been dequeued, so that the events of any one device are still dispatched in order.
+ * The displays whose next event is eligible take turns.
+ */
+InputDispatcher::EventEntry* InputDispatcher::dequeueInboundEventLocked() {
+    const EventEntry* sharedHead = mInboundQueue.head;
+    auto isEligible = [sharedHead](const Queue<EventEntry>& queue) {
+        return !queue.isEmpty()
+                && (sharedHead == nullptr || queue.head->inboundOrder < sharedHead->inboundOrder);
+    };
+
+    // The next eligible display after the one served last, wrapping around.
+    auto chosen = mInboundQueuesByDisplay.end();
+    for (auto it = mInboundQueuesByDisplay.upper_bound(mLastInboundDisplayId);
+            it != mInboundQueuesByDisplay.end(); ++it) {
+        if (isEligible(it->second)) {
+            chosen = it;
+            break;
+        }
+    }
+    if (chosen == mInboundQueuesByDisplay.end()) {
+        for (auto it = mInboundQueuesByDisplay.begin(); it != mInboundQueuesByDisplay.end();
+                ++it) {
+            if (isEligible(it->second)) {
+                chosen = it;
+                break;
+            }
+        }
+    }
+
+    if (chosen != mInboundQueuesByDisplay.end()) {
+        mLastInboundDisplayId = chosen->first;
+        return chosen->second.dequeueAtHead();
+    }
+    if (!mInboundQueue.isEmpty()) {
+        return mInboundQueue.dequeueAtHead();
+    }
+    return nullptr;
+}
+
+bool InputDispatcher::isInboundQueueEmptyLocked() const {
+    if (!mInboundQueue.isEmpty()) {
+        return false;
+    }
+    for (const auto& [displayId, queue] : mInboundQueuesByDisplay) {
+        if (!queue.isEmpty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t InputDispatcher::getInboundQueueLengthLocked() const {
+    uint32_t length = mInboundQueue.count();
+    for (const auto& [displayId, queue] : mInboundQueuesByDisplay) {
+        length += queue.count();
+    }
+    return length;
+}
+
 void InputDispatcher::addRecentEventLocked(EventEntry* entry) {
     entry->refCount += 1;
     mRecentQueue.enqueueAtTail(entry);
@@ -540,9 +632,17 @@ void InputDispatcher::addRecentEventLocked(EventEntry* entry) {
 
 sp<InputWindowHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t displayId,
         int32_t x, int32_t y, bool addOutsideTargets, bool addPortalWindows) {
+    auto gridIt = mWindowGridsByDisplay.find(displayId);
+    if (gridIt == mWindowGridsByDisplay.end()) {
+        return nullptr;
+    }
+    std::vector<uint32_t> candidates;
+    gridIt->second.getTouchCandidates(x, y, &candidates);
+
     // Traverse windows from front to back to find touched window.
-    const std::vector<sp<InputWindowHandle>> windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<InputWindowHandle>& windowHandle : windowHandles) {
+    const std::vector<sp<InputWindowHandle>>& windowHandles = getWindowHandlesLocked(displayId);
+    for (uint32_t index : candidates) {
+        const sp<InputWindowHandle>& windowHandle = windowHandles[index];
         const InputWindowInfo* windowInfo = windowHandle->getInfo();
         if (windowInfo->displayId == displayId) {
             int32_t flags = windowInfo->layoutParamsFlags;
@@ -718,8 +818,7 @@ InputDispatcher::CommandEntry* InputDispatcher::postCommandLocked(Command comman
 }
 
 void InputDispatcher::drainInboundQueueLocked() {
-    while (! mInboundQueue.isEmpty()) {
-        EventEntry* entry = mInboundQueue.dequeueAtHead();
+    while (EventEntry* entry = dequeueInboundEventLocked()) {
         releaseInboundEventLocked(entry);
     }
     traceInboundQueueLengthLocked();
@@ -1581,7 +1680,7 @@ int32_t InputDispatcher::findTouchedWindowTargetsLocked(nsecs_t currentTime,
         sp<InputWindowHandle> foregroundWindowHandle =
                 mTempTouchState.getFirstForegroundWindowHandle();
         if (foregroundWindowHandle && foregroundWindowHandle->getInfo()->hasWallpaper) {
-            const std::vector<sp<InputWindowHandle>> windowHandles =
+            const std::vector<sp<InputWindowHandle>>& windowHandles =
                     getWindowHandlesLocked(displayId);
             for (const sp<InputWindowHandle>& windowHandle : windowHandles) {
                 const InputWindowInfo* info = windowHandle->getInfo();
@@ -1790,13 +1889,23 @@ bool InputDispatcher::checkInjectionPermission(const sp<InputWindowHandle>& wind
 bool InputDispatcher::isWindowObscuredAtPointLocked(
         const sp<InputWindowHandle>& windowHandle, int32_t x, int32_t y) const {
     int32_t displayId = windowHandle->getInfo()->displayId;
-    const std::vector<sp<InputWindowHandle>> windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<InputWindowHandle>& otherHandle : windowHandles) {
-        if (otherHandle == windowHandle) {
+    auto gridIt = mWindowGridsByDisplay.find(displayId);
+    if (gridIt == mWindowGridsByDisplay.end()) {
+        return false;
+    }
+    const WindowGrid& grid = gridIt->second;
+    std::vector<uint32_t> candidates;
+    grid.getObscuringCandidates(x, y, &candidates);
+
+    // Only the windows in front of this one can obscure it.
+    const uint32_t windowIndex = grid.indexOf(windowHandle);
+    const std::vector<sp<InputWindowHandle>>& windowHandles = getWindowHandlesLocked(displayId);
+    for (uint32_t index : candidates) {
+        if (index >= windowIndex) {
             break;
         }
 
-        const InputWindowInfo* otherInfo = otherHandle->getInfo();
+        const InputWindowInfo* otherInfo = windowHandles[index]->getInfo();
         if (otherInfo->displayId == displayId
                 && otherInfo->visible && !otherInfo->isTrustedOverlay()
                 && otherInfo->frameContainsPoint(x, y)) {
@@ -1809,7 +1918,7 @@ bool InputDispatcher::isWindowObscuredAtPointLocked(
 
 bool InputDispatcher::isWindowObscuredLocked(const sp<InputWindowHandle>& windowHandle) const {
     int32_t displayId = windowHandle->getInfo()->displayId;
-    const std::vector<sp<InputWindowHandle>> windowHandles = getWindowHandlesLocked(displayId);
+    const std::vector<sp<InputWindowHandle>>& windowHandles = getWindowHandlesLocked(displayId);
     const InputWindowInfo* windowInfo = windowHandle->getInfo();
     for (const sp<InputWindowHandle>& otherHandle : windowHandles) {
         if (otherHandle == windowHandle) {
@@ -2203,20 +2312,28 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
             connection->getInputChannelName().c_str());
 #endif
 
+    // The messages already handed to publishPendingMessages have to be written first.
+    if (connection->publishInProgress) {
+        return;
+    }
+
     while (connection->status == Connection::STATUS_NORMAL
             && !connection->outboundQueue.isEmpty()) {
         DispatchEntry* dispatchEntry = connection->outboundQueue.head;
         dispatchEntry->deliveryTime = currentTime;
 
-        // Publish the event.
+        // Make the message. It is written to the channel by publishPendingMessages once the
+        // lock has been released.
         status_t status;
+        PendingMessage pending;
+        pending.seq = dispatchEntry->seq;
         EventEntry* eventEntry = dispatchEntry->eventEntry;
         switch (eventEntry->type) {
         case EventEntry::TYPE_KEY: {
             KeyEntry* keyEntry = static_cast<KeyEntry*>(eventEntry);
 
-            // Publish the key event.
-            status = connection->inputPublisher.publishKeyEvent(dispatchEntry->seq,
+            status = connection->inputPublisher.makeKeyEventMessage(&pending.msg,
+                    dispatchEntry->seq,
                     keyEntry->deviceId, keyEntry->source, keyEntry->displayId,
                     dispatchEntry->resolvedAction, dispatchEntry->resolvedFlags,
                     keyEntry->keyCode, keyEntry->scanCode,
@@ -2260,8 +2377,8 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
                 }
             }
 
-            // Publish the motion event.
-            status = connection->inputPublisher.publishMotionEvent(dispatchEntry->seq,
+            status = connection->inputPublisher.makeMotionEventMessage(&pending.msg,
+                    dispatchEntry->seq,
                     motionEntry->deviceId, motionEntry->source, motionEntry->displayId,
                     dispatchEntry->resolvedAction, motionEntry->actionButton,
                     dispatchEntry->resolvedFlags, motionEntry->edgeFlags,
@@ -2280,29 +2397,7 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
 
         // Check the result.
         if (status) {
-            if (status == WOULD_BLOCK) {
-                if (connection->waitQueue.isEmpty()) {
-                    ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
-                            "This is unexpected because the wait queue is empty, so the pipe "
-                            "should be empty and we shouldn't have any problems writing an "
-                            "event to it, status=%d", connection->getInputChannelName().c_str(),
-                            status);
-                    abortBrokenDispatchCycleLocked(currentTime, connection, true /*notify*/);
-                } else {
-                    // Pipe is full and we are waiting for the app to finish process some events
-                    // before sending more events to it.
-#if DEBUG_DISPATCH_CYCLE
-                    ALOGD("channel '%s' ~ Could not publish event because the pipe is full, "
-                            "waiting for the application to catch up",
-                            connection->getInputChannelName().c_str());
-#endif
-                    connection->inputPublisherBlocked = true;
-                }
-            } else {
-                ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
-                        "status=%d", connection->getInputChannelName().c_str(), status);
-                abortBrokenDispatchCycleLocked(currentTime, connection, true /*notify*/);
-            }
+            handlePublishErrorLocked(currentTime, connection, status);
             return;
         }
 
@@ -2311,6 +2406,126 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
         traceOutboundQueueLength(connection);
         connection->waitQueue.enqueueAtTail(dispatchEntry);
         traceWaitQueueLength(connection);
+
+        if (connection->pendingMessages.empty()) {
+            if (mConnectionsWithPendingMessages.empty()
+                    && mLooperThreadId != std::this_thread::get_id()) {
+                // Only the dispatcher thread publishes.
+                mLooper->wake();
+            }
+            mConnectionsWithPendingMessages.push_back(connection);
+        }
+        connection->pendingMessages.push_back(pending);
+    }
+}
+
+void InputDispatcher::handlePublishErrorLocked(nsecs_t currentTime,
+        const sp<Connection>& connection, status_t status) {
+    if (status == WOULD_BLOCK) {
+        if (connection->waitQueue.isEmpty()) {
+            ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
+                    "This is unexpected because the wait queue is empty, so the pipe "
+                    "should be empty and we shouldn't have any problems writing an "
+                    "event to it, status=%d", connection->getInputChannelName().c_str(),
+                    status);
+            abortBrokenDispatchCycleLocked(currentTime, connection, true /*notify*/);
+        } else {
+            // Pipe is full and we are waiting for the app to finish process some events
+            // before sending more events to it.
+#if DEBUG_DISPATCH_CYCLE
+            ALOGD("channel '%s' ~ Could not publish event because the pipe is full, "
+                    "waiting for the application to catch up",
+                    connection->getInputChannelName().c_str());
+#endif
+            connection->inputPublisherBlocked = true;
+        }
+    } else {
+        ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
+                "status=%d", connection->getInputChannelName().c_str(), status);
+        abortBrokenDispatchCycleLocked(currentTime, connection, true /*notify*/);
+    }
+}
+
+void InputDispatcher::publishPendingMessages() {
+    struct Batch {
+        sp<Connection> connection;
+        std::vector<PendingMessage> messages;
+        size_t publishedCount;
+        status_t status;
+    };
+    std::vector<Batch> batches;
+
+    std::unique_lock _l(mLock);
+    if (mConnectionsWithPendingMessages.empty()) {
+        return;
+    }
+    mPublishingMessages = true;
+    while (!mConnectionsWithPendingMessages.empty()) {
+        batches.clear();
+        for (const sp<Connection>& connection : mConnectionsWithPendingMessages) {
+            if (connection->pendingMessages.empty()) {
+                // The connection was aborted.
+                continue;
+            }
+            connection->publishInProgress = true;
+            batches.push_back({connection, std::move(connection->pendingMessages), 0, OK});
+            connection->pendingMessages.clear();
+        }
+        mConnectionsWithPendingMessages.clear();
+
+        // The messages are copies, so nothing here touches state guarded by the lock.
+        // Writes are non-blocking, and each connection's messages go out in order.
+        _l.unlock();
+        for (Batch& batch : batches) {
+            if (ATRACE_ENABLED()) {
+                std::string message = StringPrintf(
+                        "publishPendingMessages(inputChannel=%s, count=%zu)",
+                        batch.connection->getInputChannelName().c_str(), batch.messages.size());
+                ATRACE_NAME(message.c_str());
+            }
+            for (const PendingMessage& pending : batch.messages) {
+                batch.status = batch.connection->inputPublisher.publishMessage(pending.msg);
+                if (batch.status) {
+                    break;
+                }
+                batch.publishedCount++;
+            }
+        }
+        _l.lock();
+
+        nsecs_t currentTime = now();
+        for (Batch& batch : batches) {
+            const sp<Connection>& connection = batch.connection;
+            connection->publishInProgress = false;
+            if (batch.status) {
+                // Put the entries that were not written back at the head of the outbound
+                // queue, unless the connection was aborted in the meantime.
+                for (size_t i = batch.messages.size(); i-- > batch.publishedCount; ) {
+                    DispatchEntry* dispatchEntry =
+                            connection->findWaitQueueEntry(batch.messages[i].seq);
+                    if (dispatchEntry) {
+                        connection->waitQueue.dequeue(dispatchEntry);
+                        connection->outboundQueue.enqueueAtHead(dispatchEntry);
+                    }
+                }
+                traceWaitQueueLength(connection);
+                traceOutboundQueueLength(connection);
+                if (connection->status == Connection::STATUS_NORMAL) {
+                    handlePublishErrorLocked(currentTime, connection, batch.status);
+                }
+            } else {
+                // Events may have been enqueued while the lock was released.
+                startDispatchCycleLocked(currentTime, connection);
+            }
+        }
+    }
+
+    mPublishingMessages = false;
+    mPendingMessagesPublished.notify_all();
+
+    // A broken connection leaves commands behind for dispatchOnce to run.
+    if (haveCommandsLocked()) {
+        mLooper->wake();
     }
 }
 
@@ -2344,6 +2559,7 @@ void InputDispatcher::abortBrokenDispatchCycleLocked(nsecs_t currentTime,
     traceOutboundQueueLength(connection);
     drainDispatchQueue(&connection->waitQueue);
     traceWaitQueueLength(connection);
+    connection->pendingMessages.clear();
 
     // The connection appears to be unrecoverably broken.
     // Ignore already broken or zombie connections.
@@ -3060,6 +3276,19 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event,
                     mInjectionSyncFinished.wait_for(_l, std::chrono::nanoseconds(remainingTimeout));
                 }
             }
+
+            // The injected events have been dispatched, but may not have been written to
+            // their input channels yet. Callers expect to find them there once we return.
+            if (injectionResult == INPUT_EVENT_INJECTION_SUCCEEDED) {
+                while (mPublishingMessages || !mConnectionsWithPendingMessages.empty()) {
+                    nsecs_t remainingTimeout = endTime - now();
+                    if (remainingTimeout <= 0) {
+                        break;
+                    }
+                    mPendingMessagesPublished.wait_for(_l,
+                            std::chrono::nanoseconds(remainingTimeout));
+                }
+            }
         }
 
         injectionState->release();
@@ -3130,7 +3359,7 @@ void InputDispatcher::decrementPendingForegroundDispatches(EventEntry* entry) {
     }
 }
 
-std::vector<sp<InputWindowHandle>> InputDispatcher::getWindowHandlesLocked(
+const std::vector<sp<InputWindowHandle>>& InputDispatcher::getWindowHandlesLocked(
         int32_t displayId) const {
     std::unordered_map<int32_t, std::vector<sp<InputWindowHandle>>>::const_iterator it =
             mWindowHandlesByDisplay.find(displayId);
@@ -3139,7 +3368,8 @@ std::vector<sp<InputWindowHandle>> InputDispatcher::getWindowHandlesLocked(
     }
 
     // Return an empty one if nothing found.
-    return std::vector<sp<InputWindowHandle>>();
+    static const std::vector<sp<InputWindowHandle>> EMPTY_WINDOW_HANDLES;
+    return EMPTY_WINDOW_HANDLES;
 }
 
 sp<InputWindowHandle> InputDispatcher::getWindowHandleLocked(
@@ -3206,6 +3436,7 @@ void InputDispatcher::setInputWindows(const std::vector<sp<InputWindowHandle>>&
         if (inputWindowHandles.empty()) {
             // Remove all handles on a display if there are no windows left.
             mWindowHandlesByDisplay.erase(displayId);
+            mWindowGridsByDisplay.erase(displayId);
         } else {
             // Since we compare the pointer of input window handles across window updates, we need
             // to make sure the handle object for the same window stays unchanged across updates.
@@ -3267,6 +3498,7 @@ void InputDispatcher::setInputWindows(const std::vector<sp<InputWindowHandle>>&
 
             // Insert or replace
             mWindowHandlesByDisplay[displayId] = newHandles;
+            mWindowGridsByDisplay[displayId].rebuild(newHandles);
         }
 
         if (!foundHoveredWindow) {
@@ -3614,6 +3846,36 @@ void InputDispatcher::logDispatchStateLocked() {
     }
 }
 
+static void dumpLatencyStats(std::string& dump, const InputLatencyStats& stats) {
+    if (stats.getCount(InputLatencyStats::STAGE_END_TO_END) == 0) {
+        return;
+    }
+    dump += StringPrintf(INDENT3 "Latency: count=%" PRIu32 "\n",
+            stats.getCount(InputLatencyStats::STAGE_END_TO_END));
+    for (size_t i = 0; i < InputLatencyStats::STAGE_COUNT; i++) {
+        const InputLatencyStats::Stage stage = static_cast<InputLatencyStats::Stage>(i);
+        dump += StringPrintf(INDENT4 "%s:", InputLatencyStats::stageToString(stage));
+        for (float percentile : {50.0f, 90.0f, 99.0f}) {
+            const nsecs_t limit = stats.getPercentile(stage, percentile);
+            if (limit < 0) {
+                dump += StringPrintf(" p%.0f>%0.1fms", percentile,
+                        InputLatencyStats::BUCKET_LIMITS_US.back() * 0.001f);
+            } else {
+                dump += StringPrintf(" p%.0f<=%0.1fms", percentile, limit * 0.000001f);
+            }
+        }
+        dump += "\n";
+    }
+}
+
+static void dumpEntryPoolStats(std::string& dump, const char* name,
+        const EntryPoolStats& stats) {
+    dump += StringPrintf(INDENT2 "%s: capacity=%zu, inUse=%zu, peakInUse=%zu, "
+            "allocations=%" PRIu64 ", heapAllocations=%" PRIu64 "\n",
+            name, stats.capacity, stats.inUse, stats.peakInUse, stats.allocations,
+            stats.heapAllocations);
+}
+
 void InputDispatcher::dumpDispatchStateLocked(std::string& dump) {
     dump += StringPrintf(INDENT "DispatchEnabled: %s\n", toString(mDispatchEnabled));
     dump += StringPrintf(INDENT "DispatchFrozen: %s\n", toString(mDispatchFrozen));
@@ -3775,6 +4037,19 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) {
     } else {
         dump += INDENT "InboundQueue: <empty>\n";
     }
+    for (const auto& [displayId, queue] : mInboundQueuesByDisplay) {
+        if (queue.isEmpty()) {
+            continue;
+        }
+        dump += StringPrintf(INDENT "InboundQueue for display %" PRId32 ": length=%u\n",
+                displayId, queue.count());
+        for (EventEntry* entry = queue.head; entry; entry = entry->next) {
+            dump += INDENT2;
+            entry->appendDescription(dump);
+            dump += StringPrintf(", age=%0.1fms\n",
+                    (currentTime - entry->eventTime) * 0.000001f);
+        }
+    }
 
     if (!mReplacedKeys.isEmpty()) {
         dump += INDENT "ReplacedKeys:\n";
@@ -3799,6 +4074,8 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) {
                     connection->getStatusLabel(), toString(connection->monitor),
                     toString(connection->inputPublisherBlocked));
 
+            dumpLatencyStats(dump, connection->latencyStats);
+
             if (!connection->outboundQueue.isEmpty()) {
                 dump += StringPrintf(INDENT3 "OutboundQueue: length=%u\n",
                         connection->outboundQueue.count());
@@ -3835,6 +4112,11 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) {
         dump += INDENT "Connections: <none>\n";
     }
 
+    dump += INDENT "EntryPools:\n";
+    dumpEntryPoolStats(dump, "KeyEntry", KeyEntry::pool().getStats());
+    dumpEntryPoolStats(dump, "MotionEntry", MotionEntry::pool().getStats());
+    dumpEntryPoolStats(dump, "DispatchEntry", DispatchEntry::pool().getStats());
+
     if (isAppSwitchPendingLocked()) {
         dump += StringPrintf(INDENT "AppSwitch: pending, due in %0.1fms\n",
                 (mAppSwitchDueTime - now()) / 1000000.0);
@@ -4229,6 +4511,7 @@ void InputDispatcher::doDispatchCycleFinishedLockedInterruptible(
     DispatchEntry* dispatchEntry = connection->findWaitQueueEntry(seq);
     if (dispatchEntry) {
         nsecs_t eventDuration = finishTime - dispatchEntry->deliveryTime;
+        updateLatencyStatsLocked(connection, dispatchEntry, finishTime);
         if (eventDuration > SLOW_EVENT_PROCESSING_WARNING_TIMEOUT) {
             std::string msg =
                     StringPrintf("Window '%s' spent %0.1fms processing the last input event: ",
@@ -4489,9 +4772,39 @@ void InputDispatcher::updateDispatchStatistics(nsecs_t currentTime, const EventE
     // TODO Write some statistics about how long we spend waiting.
 }
 
+void InputDispatcher::updateLatencyStatsLocked(const sp<Connection>& connection,
+        const DispatchEntry* dispatchEntry, nsecs_t finishTime) {
+    const EventEntry* entry = dispatchEntry->eventEntry;
+    // The event time of injected events is up to the injector, and synthesized events never
+    // went through the reader.
+    if (entry->isInjected() || entry->enqueueTime == 0
+            || (entry->type != EventEntry::TYPE_KEY && entry->type != EventEntry::TYPE_MOTION)) {
+        return;
+    }
+    InputLatencyStats& stats = connection->latencyStats;
+    stats.record(InputLatencyStats::STAGE_EVENT_TO_DISPATCHER,
+            entry->enqueueTime - entry->eventTime);
+    stats.record(InputLatencyStats::STAGE_DISPATCHER_TO_PUBLISH,
+            dispatchEntry->deliveryTime - entry->enqueueTime);
+    stats.record(InputLatencyStats::STAGE_PUBLISH_TO_FINISH,
+            finishTime - dispatchEntry->deliveryTime);
+    stats.record(InputLatencyStats::STAGE_END_TO_END, finishTime - entry->eventTime);
+}
+
+void InputDispatcher::getInputLatencyStats(std::vector<InputLatencyStats>* outStats) {
+    std::scoped_lock _l(mLock);
+    outStats->clear();
+    outStats->reserve(mConnectionsByFd.size());
+    for (size_t i = 0; i < mConnectionsByFd.size(); i++) {
+        const sp<Connection>& connection = mConnectionsByFd.valueAt(i);
+        outStats->push_back(connection->latencyStats);
+        outStats->back().windowName = connection->getWindowName();
+    }
+}
+
 void InputDispatcher::traceInboundQueueLengthLocked() {
     if (ATRACE_ENABLED()) {
-        ATRACE_INT("iq", mInboundQueue.count());
+        ATRACE_INT("iq", getInboundQueueLengthLocked());
     }
 }
 
@@ -4558,7 +4871,8 @@ void InputDispatcher::InjectionState::release() {
 InputDispatcher::EventEntry::EventEntry(uint32_t sequenceNum, int32_t type,
         nsecs_t eventTime, uint32_t policyFlags) :
         sequenceNum(sequenceNum), refCount(1), type(type), eventTime(eventTime),
-        policyFlags(policyFlags), injectionState(nullptr), dispatchInProgress(false) {
+        policyFlags(policyFlags), injectionState(nullptr), dispatchInProgress(false),
+        inboundOrder(0), enqueueTime(0) {
 }
 
 InputDispatcher::EventEntry::~EventEntry() {
@@ -4649,6 +4963,21 @@ void InputDispatcher::KeyEntry::recycle() {
 }
 
 
+void* InputDispatcher::KeyEntry::operator new(size_t size) {
+    return pool().allocate(size);
+}
+
+void InputDispatcher::KeyEntry::operator delete(void* p) {
+    pool().release(p);
+}
+
+EntryPool<InputDispatcher::KeyEntry>& InputDispatcher::KeyEntry::pool() {
+    // Never destroyed, so that entries still alive at exit can be released.
+    static EntryPool<KeyEntry>* sPool = new EntryPool<KeyEntry>(KEY_ENTRY_POOL_SIZE);
+    return *sPool;
+}
+
+
 // --- InputDispatcher::MotionEntry ---
 
 InputDispatcher::MotionEntry::MotionEntry(uint32_t sequenceNum, nsecs_t eventTime, int32_t deviceId,
@@ -4697,6 +5026,21 @@ void InputDispatcher::MotionEntry::appendDescription(std::string& msg) const {
 }
 
 
+void* InputDispatcher::MotionEntry::operator new(size_t size) {
+    return pool().allocate(size);
+}
+
+void InputDispatcher::MotionEntry::operator delete(void* p) {
+    pool().release(p);
+}
+
+EntryPool<InputDispatcher::MotionEntry>& InputDispatcher::MotionEntry::pool() {
+    // Never destroyed, so that entries still alive at exit can be released.
+    static EntryPool<MotionEntry>* sPool = new EntryPool<MotionEntry>(MOTION_ENTRY_POOL_SIZE);
+    return *sPool;
+}
+
+
 // --- InputDispatcher::DispatchEntry ---
 
 volatile int32_t InputDispatcher::DispatchEntry::sNextSeqAtomic;
@@ -4725,6 +5069,21 @@ uint32_t InputDispatcher::DispatchEntry::nextSeq() {
     return seq;
 }
 
+void* InputDispatcher::DispatchEntry::operator new(size_t size) {
+    return pool().allocate(size);
+}
+
+void InputDispatcher::DispatchEntry::operator delete(void* p) {
+    pool().release(p);
+}
+
+EntryPool<InputDispatcher::DispatchEntry>& InputDispatcher::DispatchEntry::pool() {
+    // Never destroyed, so that entries still alive at exit can be released.
+    static EntryPool<DispatchEntry>* sPool =
+            new EntryPool<DispatchEntry>(DISPATCH_ENTRY_POOL_SIZE);
+    return *sPool;
+}
+
 
 // --- InputDispatcher::InputState ---
 
@@ -5092,7 +5451,7 @@ bool InputDispatcher::InputState::shouldCancelMotion(const MotionMemento& mement
 InputDispatcher::Connection::Connection(const sp<InputChannel>& inputChannel, bool monitor) :
         status(STATUS_NORMAL), inputChannel(inputChannel),
         monitor(monitor),
-        inputPublisher(inputChannel), inputPublisherBlocked(false) {
+        inputPublisher(inputChannel), inputPublisherBlocked(false), publishInProgress(false) {
 }
 
 InputDispatcher::Connection::~Connection() {
@@ -5154,6 +5513,107 @@ InputDispatcher::TouchedMonitor::TouchedMonitor(const Monitor& monitor, float xO
         float yOffset) : monitor(monitor), xOffset(xOffset), yOffset(yOffset) {
 }
 
+// --- InputDispatcher::WindowGrid ---
+
+void InputDispatcher::WindowGrid::rebuild(
+        const std::vector<sp<InputWindowHandle>>& windowHandles) {
+    mCells.clear();
+    mTouchableAnywhere.clear();
+    mObscuringAnywhere.clear();
+    mIndices.clear();
+
+    // Visit the windows front to back so that every list stays sorted by index.
+    for (uint32_t index = 0; index < windowHandles.size(); index++) {
+        const InputWindowInfo* info = windowHandles[index]->getInfo();
+        mIndices[windowHandles[index].get()] = index;
+        if (!info->visible) {
+            // Invisible windows never take touches nor obscure other windows.
+            continue;
+        }
+
+        // Mirrors the checks of findTouchedWindowAtLocked.
+        const int32_t flags = info->layoutParamsFlags;
+        const bool touchable = !(flags & InputWindowInfo::FLAG_NOT_TOUCHABLE);
+        const bool isTouchModal = (flags & (InputWindowInfo::FLAG_NOT_FOCUSABLE
+                | InputWindowInfo::FLAG_NOT_TOUCH_MODAL)) == 0;
+        if ((touchable && isTouchModal) || (flags & InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH)) {
+            mTouchableAnywhere.push_back(index);
+        } else if (touchable) {
+            const Rect bounds = info->touchableRegion.getBounds();
+            if (!addToCells(index, bounds.left, bounds.top, bounds.right, bounds.bottom,
+                    &Cell::touchable)) {
+                mTouchableAnywhere.push_back(index);
+            }
+        }
+
+        if (!info->isTrustedOverlay()) {
+            if (!addToCells(index, info->frameLeft, info->frameTop, info->frameRight,
+                    info->frameBottom, &Cell::obscuring)) {
+                mObscuringAnywhere.push_back(index);
+            }
+        }
+    }
+}
+
+uint64_t InputDispatcher::WindowGrid::cellKey(int32_t cellX, int32_t cellY) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32)
+            | static_cast<uint32_t>(cellY);
+}
+
+bool InputDispatcher::WindowGrid::addToCells(uint32_t index, int32_t left, int32_t top,
+        int32_t right, int32_t bottom, std::vector<uint32_t> Cell::*list) {
+    if (left >= right || top >= bottom) {
+        // Nothing can hit an empty rect.
+        return true;
+    }
+    // right and bottom are exclusive.
+    const int32_t firstCellX = left >> CELL_SHIFT;
+    const int32_t firstCellY = top >> CELL_SHIFT;
+    const int32_t lastCellX = (right - 1) >> CELL_SHIFT;
+    const int32_t lastCellY = (bottom - 1) >> CELL_SHIFT;
+    const int64_t cellCount = (int64_t(lastCellX) - firstCellX + 1)
+            * (int64_t(lastCellY) - firstCellY + 1);
+    if (cellCount > MAX_CELLS_PER_WINDOW) {
+        return false;
+    }
+    for (int32_t cellY = firstCellY; cellY <= lastCellY; cellY++) {
+        for (int32_t cellX = firstCellX; cellX <= lastCellX; cellX++) {
+            (mCells[cellKey(cellX, cellY)].*list).push_back(index);
+        }
+    }
+    return true;
+}
+
+void InputDispatcher::WindowGrid::getCandidates(int32_t x, int32_t y,
+        const std::vector<uint32_t>& anywhere, std::vector<uint32_t> Cell::*list,
+        std::vector<uint32_t>* outIndices) const {
+    outIndices->clear();
+    auto it = mCells.find(cellKey(x >> CELL_SHIFT, y >> CELL_SHIFT));
+    if (it == mCells.end()) {
+        *outIndices = anywhere;
+        return;
+    }
+    const std::vector<uint32_t>& inCell = it->second.*list;
+    outIndices->reserve(inCell.size() + anywhere.size());
+    std::merge(inCell.begin(), inCell.end(), anywhere.begin(), anywhere.end(),
+            std::back_inserter(*outIndices));
+}
+
+void InputDispatcher::WindowGrid::getTouchCandidates(int32_t x, int32_t y,
+        std::vector<uint32_t>* outIndices) const {
+    getCandidates(x, y, mTouchableAnywhere, &Cell::touchable, outIndices);
+}
+
+void InputDispatcher::WindowGrid::getObscuringCandidates(int32_t x, int32_t y,
+        std::vector<uint32_t>* outIndices) const {
+    getCandidates(x, y, mObscuringAnywhere, &Cell::obscuring, outIndices);
+}
+
+uint32_t InputDispatcher::WindowGrid::indexOf(const sp<InputWindowHandle>& windowHandle) const {
+    auto it = mIndices.find(windowHandle.get());
+    return it != mIndices.end() ? it->second : mIndices.size();
+}
+
 // --- InputDispatcher::TouchState ---
 
 InputDispatcher::TouchState::TouchState() :
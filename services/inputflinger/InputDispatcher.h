@@ -20,10 +20,12 @@
 #include <condition_variable>
 #include <input/Input.h>
 #include <input/InputApplication.h>
+#include <input/InputLatencyStats.h>
 #include <input/InputTransport.h>
 #include <input/InputWindow.h>
 #include <input/ISetInputWindowsListener.h>
 #include <optional>
+#include <thread>
 #include <ui/Region.h>
 #include <utils/threads.h>
 #include <utils/Timers.h>
@@ -31,6 +33,7 @@
 #include <utils/Looper.h>
 #include <utils/BitSet.h>
 #include <cutils/atomic.h>
+#include <map>
 #include <unordered_map>
 
 #include <stddef.h>
@@ -38,6 +41,7 @@
 #include <limits.h>
 #include <unordered_map>
 
+#include "EntryPool.h"
 #include "InputListener.h"
 #include "InputReporterInterface.h"
 
@@ -389,6 +393,11 @@ public:
      */
     virtual status_t pilferPointers(const sp<IBinder>& token) = 0;
 
+    /* Gets the latency histograms of the input delivered to each registered input channel.
+     *
+     * This method may be called on any thread (usually by the input manager).
+     */
+    virtual void getInputLatencyStats(std::vector<InputLatencyStats>* outStats) = 0;
 };
 
 /* Dispatches events to input targets.  Some functions of the input dispatcher, such as
@@ -449,6 +458,8 @@ public:
     virtual status_t unregisterInputChannel(const sp<InputChannel>& inputChannel) override;
     virtual status_t pilferPointers(const sp<IBinder>& token) override;
 
+    virtual void getInputLatencyStats(std::vector<InputLatencyStats>* outStats) override;
+
 private:
     template <typename T>
     struct Link {
@@ -491,6 +502,8 @@ private:
         InjectionState* injectionState;
 
         bool dispatchInProgress; // initially false, set to true while dispatching
+        uint64_t inboundOrder; // assigned when the event is added to an inbound queue
+        nsecs_t enqueueTime; // when the event was added to an inbound queue
 
         inline bool isInjected() const { return injectionState != nullptr; }
 
@@ -552,6 +565,11 @@ private:
         virtual void appendDescription(std::string& msg) const;
         void recycle();
 
+        // Key entries come out of a fixed-size pool, falling back to the heap when it is full.
+        static void* operator new(size_t size);
+        static void operator delete(void* p);
+        static EntryPool<KeyEntry>& pool();
+
     protected:
         virtual ~KeyEntry();
     };
@@ -585,6 +603,11 @@ private:
                 float xOffset, float yOffset);
         virtual void appendDescription(std::string& msg) const;
 
+        // Motion entries come out of a fixed-size pool, falling back to the heap when it is full.
+        static void* operator new(size_t size);
+        static void operator delete(void* p);
+        static EntryPool<MotionEntry>& pool();
+
     protected:
         virtual ~MotionEntry();
     };
@@ -619,6 +642,12 @@ private:
             return targetFlags & InputTarget::FLAG_SPLIT;
         }
 
+        // Dispatch entries come out of a fixed-size pool, falling back to the heap when it is
+        // full.
+        static void* operator new(size_t size);
+        static void operator delete(void* p);
+        static EntryPool<DispatchEntry>& pool();
+
     private:
         static volatile int32_t sNextSeqAtomic;
 
@@ -857,6 +886,13 @@ private:
     };
 
     /* Manages the dispatch state associated with a single input channel. */
+    // An event that has been moved to a connection's wait queue but not yet written to its
+    // input channel.
+    struct PendingMessage {
+        uint32_t seq;
+        InputMessage msg;
+    };
+
     class Connection : public RefBase {
     protected:
         virtual ~Connection();
@@ -888,6 +924,18 @@ private:
         // yet received a "finished" response from the application.
         Queue<DispatchEntry> waitQueue;
 
+        // Messages for the entries at the tail of the wait queue that still have to be written
+        // to the input channel by publishPendingMessages, in order.
+        std::vector<PendingMessage> pendingMessages;
+
+        // True while publishPendingMessages is writing this connection's messages without
+        // holding the lock. No new messages are made for the connection until it is done, so
+        // that events are always written in sequence.
+        bool publishInProgress;
+
+        // How long the events that finished on this connection spent in each stage.
+        InputLatencyStats latencyStats;
+
         explicit Connection(const sp<InputChannel>& inputChannel, bool monitor);
 
         inline const std::string getInputChannelName() const { return inputChannel->getName(); }
@@ -924,15 +972,34 @@ private:
 
     EventEntry* mPendingEvent GUARDED_BY(mLock);
     Queue<EventEntry> mInboundQueue GUARDED_BY(mLock);
+    // Motion events on a display are queued per display, so that a burst of input on one
+    // display (a mouse on an external display) does not sit in front of another display's
+    // touches. Every other event goes to mInboundQueue. See dequeueInboundEventLocked.
+    std::map<int32_t /*displayId*/, Queue<EventEntry>> mInboundQueuesByDisplay GUARDED_BY(mLock);
+    uint64_t mNextInboundOrder GUARDED_BY(mLock);
+    int32_t mLastInboundDisplayId GUARDED_BY(mLock);
     Queue<EventEntry> mRecentQueue GUARDED_BY(mLock);
     Queue<CommandEntry> mCommandQueue GUARDED_BY(mLock);
 
     DropReason mLastDropReason GUARDED_BY(mLock);
 
+    // Connections with messages waiting for publishPendingMessages.
+    std::vector<sp<Connection>> mConnectionsWithPendingMessages GUARDED_BY(mLock);
+    // The thread that runs dispatchOnce. Other threads wake it up to publish their messages.
+    std::thread::id mLooperThreadId GUARDED_BY(mLock);
+    // True while publishPendingMessages has released the lock to write messages.
+    bool mPublishingMessages GUARDED_BY(mLock);
+    std::condition_variable mPendingMessagesPublished;
+
     void dispatchOnceInnerLocked(nsecs_t* nextWakeupTime) REQUIRES(mLock);
 
     // Enqueues an inbound event.  Returns true if mLooper->wake() should be called.
     bool enqueueInboundEventLocked(EventEntry* entry) REQUIRES(mLock);
+    // Dequeues the next inbound event to dispatch, or returns null if there is none.
+    EventEntry* dequeueInboundEventLocked() REQUIRES(mLock);
+    bool isInboundQueueEmptyLocked() const REQUIRES(mLock);
+    uint32_t getInboundQueueLengthLocked() const REQUIRES(mLock);
+    bool isBlockedByNextUnblockedEventLocked() const REQUIRES(mLock);
 
     // Cleans up input state when dropping an inbound event.
     void dropInboundEventLocked(EventEntry* entry, DropReason dropReason) REQUIRES(mLock);
@@ -1044,8 +1111,50 @@ private:
     std::unordered_map<int32_t, std::vector<sp<InputWindowHandle>>> mWindowHandlesByDisplay
             GUARDED_BY(mLock);
     // Get window handles by display, return an empty vector if not found.
-    std::vector<sp<InputWindowHandle>> getWindowHandlesLocked(int32_t displayId) const
+    const std::vector<sp<InputWindowHandle>>& getWindowHandlesLocked(int32_t displayId) const
             REQUIRES(mLock);
+
+    // Uniform grid over the window handles of one display, so that hit tests only visit the
+    // windows whose bounds cover the cell of the point instead of every window on the display.
+    // Windows are referred to by their index in the display's window handle list, so ascending
+    // indices are front to back. Rebuilt whenever setInputWindows replaces the list.
+    struct WindowGrid {
+        void rebuild(const std::vector<sp<InputWindowHandle>>& windowHandles);
+
+        // Indices of the windows that can take part in a touch at (x, y): the touchable windows
+        // whose touchable region bounds cover the cell, plus the touch modal windows and the
+        // windows watching outside touches.
+        void getTouchCandidates(int32_t x, int32_t y, std::vector<uint32_t>* outIndices) const;
+        // Indices of the visible untrusted windows whose frame may contain (x, y).
+        void getObscuringCandidates(int32_t x, int32_t y,
+                std::vector<uint32_t>* outIndices) const;
+        // Index of the window, or the number of windows if it isn't on the display.
+        uint32_t indexOf(const sp<InputWindowHandle>& windowHandle) const;
+
+    private:
+        // 256px cells keep a full screen window to a few dozen cells.
+        static constexpr int32_t CELL_SHIFT = 8;
+        // Windows larger than this are kept out of the cells and always visited.
+        static constexpr int64_t MAX_CELLS_PER_WINDOW = 1024;
+
+        struct Cell {
+            std::vector<uint32_t> touchable;
+            std::vector<uint32_t> obscuring;
+        };
+
+        static uint64_t cellKey(int32_t cellX, int32_t cellY);
+        // Returns false if the rect was too large to bucket.
+        bool addToCells(uint32_t index, int32_t left, int32_t top, int32_t right, int32_t bottom,
+                std::vector<uint32_t> Cell::*list);
+        void getCandidates(int32_t x, int32_t y, const std::vector<uint32_t>& anywhere,
+                std::vector<uint32_t> Cell::*list, std::vector<uint32_t>* outIndices) const;
+
+        std::unordered_map<uint64_t, Cell> mCells;
+        std::vector<uint32_t> mTouchableAnywhere;
+        std::vector<uint32_t> mObscuringAnywhere;
+        std::unordered_map<const InputWindowHandle*, uint32_t> mIndices;
+    };
+    std::unordered_map<int32_t, WindowGrid> mWindowGridsByDisplay GUARDED_BY(mLock);
     sp<InputWindowHandle> getWindowHandleLocked(const sp<IBinder>& windowHandleToken) const
             REQUIRES(mLock);
     sp<InputChannel> getInputChannelLocked(const sp<IBinder>& windowToken) const REQUIRES(mLock);
@@ -1206,6 +1315,12 @@ private:
             REQUIRES(mLock);
     void startDispatchCycleLocked(nsecs_t currentTime, const sp<Connection>& connection)
             REQUIRES(mLock);
+    void handlePublishErrorLocked(nsecs_t currentTime, const sp<Connection>& connection,
+            status_t status) REQUIRES(mLock);
+    // Writes the messages made by startDispatchCycleLocked to their input channels.
+    // Must be called without holding the lock, so that the socket writes for one connection
+    // do not hold up the rest of the dispatcher.
+    void publishPendingMessages() EXCLUDES(mLock);
     void finishDispatchCycleLocked(nsecs_t currentTime, const sp<Connection>& connection,
             uint32_t seq, bool handled) REQUIRES(mLock);
     void abortBrokenDispatchCycleLocked(nsecs_t currentTime, const sp<Connection>& connection,
@@ -1281,6 +1396,8 @@ private:
     // Statistics gathering.
     void updateDispatchStatistics(nsecs_t currentTime, const EventEntry* entry,
             int32_t injectionResult, nsecs_t timeSpentWaitingForApplication);
+    void updateLatencyStatsLocked(const sp<Connection>& connection,
+            const DispatchEntry* dispatchEntry, nsecs_t finishTime) REQUIRES(mLock);
     void traceInboundQueueLengthLocked() REQUIRES(mLock);
     void traceOutboundQueueLength(const sp<Connection>& connection);
     void traceWaitQueueLength(const sp<Connection>& connection);
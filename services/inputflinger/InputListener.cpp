@@ -19,11 +19,15 @@
 //#define LOG_NDEBUG 0
 
 #include "InputListener.h"
+#include "EntryPool.h"
 
 #include <android/log.h>
 
 namespace android {
 
+// Enough for the motion args a few reader loops queue up before they are flushed.
+constexpr size_t MOTION_ARGS_POOL_SIZE = 32;
+
 // --- NotifyConfigurationChangedArgs ---
 
 NotifyConfigurationChangedArgs::NotifyConfigurationChangedArgs(
@@ -94,7 +98,7 @@ NotifyMotionArgs::NotifyMotionArgs(uint32_t sequenceNum, nsecs_t eventTime, int3
         int32_t edgeFlags, uint32_t deviceTimestamp, uint32_t pointerCount,
         const PointerProperties* pointerProperties, const PointerCoords* pointerCoords,
         float xPrecision, float yPrecision, nsecs_t downTime,
-        const std::vector<TouchVideoFrame>& videoFrames) :
+        std::vector<TouchVideoFrame> videoFrames) :
         NotifyArgs(sequenceNum, eventTime), deviceId(deviceId), source(source),
         displayId(displayId), policyFlags(policyFlags),
         action(action), actionButton(actionButton),
@@ -102,7 +106,7 @@ NotifyMotionArgs::NotifyMotionArgs(uint32_t sequenceNum, nsecs_t eventTime, int3
         classification(classification), edgeFlags(edgeFlags), deviceTimestamp(deviceTimestamp),
         pointerCount(pointerCount),
         xPrecision(xPrecision), yPrecision(yPrecision), downTime(downTime),
-        videoFrames(videoFrames) {
+        videoFrames(std::move(videoFrames)) {
     for (uint32_t i = 0; i < pointerCount; i++) {
         this->pointerProperties[i].copyFrom(pointerProperties[i]);
         this->pointerCoords[i].copyFrom(pointerCoords[i]);
@@ -124,6 +128,36 @@ NotifyMotionArgs::NotifyMotionArgs(const NotifyMotionArgs& other) :
     }
 }
 
+NotifyMotionArgs::NotifyMotionArgs(NotifyMotionArgs&& other) :
+        NotifyArgs(other.sequenceNum, other.eventTime), deviceId(other.deviceId),
+        source(other.source), displayId(other.displayId), policyFlags(other.policyFlags),
+        action(other.action), actionButton(other.actionButton), flags(other.flags),
+        metaState(other.metaState), buttonState(other.buttonState),
+        classification(other.classification), edgeFlags(other.edgeFlags),
+        deviceTimestamp(other.deviceTimestamp), pointerCount(other.pointerCount),
+        xPrecision(other.xPrecision), yPrecision(other.yPrecision), downTime(other.downTime),
+        videoFrames(std::move(other.videoFrames)) {
+    for (uint32_t i = 0; i < pointerCount; i++) {
+        pointerProperties[i].copyFrom(other.pointerProperties[i]);
+        pointerCoords[i].copyFrom(other.pointerCoords[i]);
+    }
+}
+
+static EntryPool<NotifyMotionArgs>& motionArgsPool() {
+    // Never destroyed, so that args still alive at exit can be released.
+    static EntryPool<NotifyMotionArgs>* sPool =
+            new EntryPool<NotifyMotionArgs>(MOTION_ARGS_POOL_SIZE);
+    return *sPool;
+}
+
+void* NotifyMotionArgs::operator new(size_t size) {
+    return motionArgsPool().allocate(size);
+}
+
+void NotifyMotionArgs::operator delete(void* p) {
+    motionArgsPool().release(p);
+}
+
 bool NotifyMotionArgs::operator==(const NotifyMotionArgs& rhs) const {
     bool equal =
             sequenceNum == rhs.sequenceNum
@@ -23,6 +23,7 @@
 
 #include <binder/IPCThreadState.h>
 
+#include <inttypes.h>
 #include <log/log.h>
 #include <unordered_map>
 
@@ -92,6 +93,12 @@ sp<InputDispatcherInterface> InputManager::getDispatcher() {
     return mDispatcher;
 }
 
+struct IBinderHash {
+    std::size_t operator()(const sp<IBinder>& b) const {
+        return std::hash<IBinder*>{}(b.get());
+    }
+};
+
 class BinderWindowHandle : public InputWindowHandle {
 public:
     BinderWindowHandle(const InputWindowInfo& info) {
@@ -117,6 +124,96 @@ void InputManager::setInputWindows(const std::vector<InputWindowInfo>& infos,
     }
 }
 
+status_t InputManager::updateInputWindows(const InputWindowsUpdate& update,
+        const sp<ISetInputWindowsListener>& setInputWindowsListener) {
+    std::scoped_lock lock(mInputWindowsLock);
+
+    if (!update.isFull() && update.baseGeneration != mInputWindowsGeneration) {
+        ALOGE("Dropping input windows update from generation %" PRIu64 " to %" PRIu64
+              ", current generation is %" PRIu64, update.baseGeneration, update.generation,
+              mInputWindowsGeneration);
+        if (setInputWindowsListener) {
+            setInputWindowsListener->onSetInputWindowsFinished();
+        }
+        return BAD_VALUE;
+    }
+
+    std::vector<sp<InputWindowHandle>> windows;
+    if (update.isFull()) {
+        for (const auto& info : update.changedWindows) {
+            windows.push_back(new BinderWindowHandle(info));
+        }
+    } else {
+        std::unordered_map<sp<IBinder>, sp<InputWindowHandle>, IBinderHash> windowsByToken;
+        for (const sp<InputWindowHandle>& window : mInputWindows) {
+            windowsByToken[window->getToken()] = window;
+        }
+        for (const sp<IBinder>& token : update.removedWindows) {
+            windowsByToken.erase(token);
+        }
+        // Changed windows get a new handle; the dispatcher matches them to its own handles by
+        // token anyway.
+        for (const auto& info : update.changedWindows) {
+            if (info.token != nullptr) {
+                windowsByToken[info.token] = new BinderWindowHandle(info);
+            }
+        }
+
+        auto appendWindow = [&](const sp<IBinder>& token) {
+            auto it = windowsByToken.find(token);
+            if (it != windowsByToken.end()) {
+                windows.push_back(it->second);
+            }
+        };
+        if (update.order.empty()) {
+            for (const sp<InputWindowHandle>& window : mInputWindows) {
+                appendWindow(window->getToken());
+            }
+        } else {
+            for (const sp<IBinder>& token : update.order) {
+                appendWindow(token);
+            }
+        }
+    }
+
+    // Only hand the displays whose windows changed to the dispatcher, so that it neither
+    // re-diffs nor takes its lock for the others.
+    std::unordered_map<int32_t, std::vector<sp<InputWindowHandle>>> oldHandlesPerDisplay;
+    std::unordered_map<int32_t, std::vector<sp<InputWindowHandle>>> newHandlesPerDisplay;
+    for (const sp<InputWindowHandle>& window : mInputWindows) {
+        oldHandlesPerDisplay[window->getInfo()->displayId].push_back(window);
+    }
+    for (const sp<InputWindowHandle>& window : windows) {
+        newHandlesPerDisplay[window->getInfo()->displayId].push_back(window);
+    }
+    std::vector<int32_t> changedDisplays;
+    for (const auto& [displayId, handles] : newHandlesPerDisplay) {
+        auto it = oldHandlesPerDisplay.find(displayId);
+        if (it == oldHandlesPerDisplay.end() || it->second != handles) {
+            changedDisplays.push_back(displayId);
+        }
+    }
+    for (const auto& [displayId, handles] : oldHandlesPerDisplay) {
+        if (newHandlesPerDisplay.find(displayId) == newHandlesPerDisplay.end()) {
+            changedDisplays.push_back(displayId);
+        }
+    }
+
+    mInputWindows = std::move(windows);
+    mInputWindowsGeneration = update.generation;
+
+    // Report completion once, after the last display is updated.
+    for (size_t i = 0; i < changedDisplays.size(); i++) {
+        const int32_t displayId = changedDisplays[i];
+        mDispatcher->setInputWindows(newHandlesPerDisplay[displayId], displayId,
+                i + 1 == changedDisplays.size() ? setInputWindowsListener : nullptr);
+    }
+    if (changedDisplays.empty() && setInputWindowsListener) {
+        setInputWindowsListener->onSetInputWindowsFinished();
+    }
+    return OK;
+}
+
 void InputManager::transferTouchFocus(const sp<IBinder>& fromToken, const sp<IBinder>& toToken) {
     mDispatcher->transferTouchFocus(fromToken, toToken);
 }
@@ -137,4 +234,17 @@ void InputManager::unregisterInputChannel(const sp<InputChannel>& channel) {
     mDispatcher->unregisterInputChannel(channel);
 }
 
+status_t InputManager::getInputLatencyStats(std::vector<InputLatencyStats>* outStats) {
+    // Window names say what the user is doing, so only the system gets to see them.
+    IPCThreadState* ipc = IPCThreadState::self();
+    const int uid = ipc->getCallingUid();
+    if (uid != AID_SYSTEM && uid != AID_SHELL && uid != AID_ROOT) {
+        ALOGE("Invalid attempt to get input latency stats over IPC "
+                "from non system/shell/root entity (PID: %d)", ipc->getCallingPid());
+        return PERMISSION_DENIED;
+    }
+    mDispatcher->getInputLatencyStats(outStats);
+    return OK;
+}
+
 } // namespace android
@@ -37,6 +37,8 @@
 #include <utils/Timers.h>
 #include <utils/RefBase.h>
 
+#include <mutex>
+
 namespace android {
 class InputChannel;
 
@@ -96,11 +98,15 @@ public:
 
     virtual void setInputWindows(const std::vector<InputWindowInfo>& handles,
             const sp<ISetInputWindowsListener>& setInputWindowsListener);
+    virtual status_t updateInputWindows(const InputWindowsUpdate& update,
+            const sp<ISetInputWindowsListener>& setInputWindowsListener);
     virtual void transferTouchFocus(const sp<IBinder>& fromToken, const sp<IBinder>& toToken);
 
     virtual void registerInputChannel(const sp<InputChannel>& channel);
     virtual void unregisterInputChannel(const sp<InputChannel>& channel);
 
+    virtual status_t getInputLatencyStats(std::vector<InputLatencyStats>* outStats);
+
 private:
     sp<InputReaderInterface> mReader;
     sp<InputReaderThread> mReaderThread;
@@ -110,6 +116,11 @@ private:
     sp<InputDispatcherInterface> mDispatcher;
     sp<InputDispatcherThread> mDispatcherThread;
 
+    // The windows built up by updateInputWindows, front to back.
+    std::mutex mInputWindowsLock;
+    uint64_t mInputWindowsGeneration GUARDED_BY(mInputWindowsLock) = 0;
+    std::vector<sp<InputWindowHandle>> mInputWindows GUARDED_BY(mInputWindowsLock);
+
     void initialize();
 };
 
@@ -52,6 +52,10 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <condition_variable>
+#include <thread>
+#include <utility>
+
 #include <log/log.h>
 
 #include <android-base/stringprintf.h>
@@ -258,6 +262,251 @@ static void synthesizeButtonKeys(InputReaderContext* context, int32_t action,
 }
 
 
+// --- InputReader::DeviceWorker ---
+
+namespace {
+
+// Keeps the args a worker produces until the reader thread merges them.
+class CollectingInputListener : public InputListenerInterface {
+public:
+    std::vector<NotifyArgs*> args;
+
+    virtual ~CollectingInputListener() {
+        for (NotifyArgs* a : args) {
+            delete a;
+        }
+    }
+
+    virtual void notifyConfigurationChanged(const NotifyConfigurationChangedArgs* a) {
+        args.push_back(new NotifyConfigurationChangedArgs(*a));
+    }
+    virtual void notifyKey(const NotifyKeyArgs* a) {
+        args.push_back(new NotifyKeyArgs(*a));
+    }
+    virtual void notifyMotion(const NotifyMotionArgs* a) {
+        args.push_back(new NotifyMotionArgs(*a));
+    }
+    virtual void notifySwitch(const NotifySwitchArgs* a) {
+        args.push_back(new NotifySwitchArgs(*a));
+    }
+    virtual void notifyDeviceReset(const NotifyDeviceResetArgs* a) {
+        args.push_back(new NotifyDeviceResetArgs(*a));
+    }
+};
+
+} // namespace
+
+/**
+ * The context of a device that is processed on a worker thread.
+ *
+ * Called from the reader thread, e.g. while the device is configured or reset, it forwards
+ * to the reader's own context. Called from the worker thread, which only runs while the
+ * reader thread holds mLock and waits for it:
+ * - output goes to a queue of its own, which the reader merges with the other workers',
+ * - calls that reach into other devices (meta state, pointer fading, external stylus state)
+ *   are deferred until the reader thread can make them,
+ * - the other calls are serialized with the other workers by mWorkerContextLock.
+ */
+class InputReader::DeviceWorker : public InputReaderContext {
+public:
+    explicit DeviceWorker(InputReader* reader) :
+            mReader(reader), mCollector(new CollectingInputListener()),
+            mHasWork(false), mExiting(false) {
+        mThread = std::thread([this]() { threadLoop(); });
+    }
+
+    virtual ~DeviceWorker() {
+        {
+            std::scoped_lock lock(mLock);
+            mExiting = true;
+        }
+        mCondition.notify_all();
+        mThread.join();
+    }
+
+    bool hasEvents() const {
+        return !mRuns.empty();
+    }
+
+    void addEvents(InputDevice* device, const RawEvent* rawEvents, size_t count) {
+        mDevice = device;
+        mRuns.push_back({rawEvents, count});
+    }
+
+    void processOnCallerThread() {
+        processRuns();
+    }
+
+    void start() {
+        {
+            std::scoped_lock lock(mLock);
+            mHasWork = true;
+        }
+        mCondition.notify_all();
+    }
+
+    void waitUntilDone() {
+        std::unique_lock lock(mLock);
+        mCondition.wait(lock, [this]() { return !mHasWork; });
+    }
+
+    const std::vector<NotifyArgs*>& getArgs() const {
+        return mCollector->args;
+    }
+
+    // Runs the deferred calls, on the reader thread. The merged args are already deleted.
+    void finish() {
+        mCollector->args.clear();
+        for (const Deferred& deferred : mDeferred) {
+            switch (deferred.type) {
+            case Deferred::UPDATE_GLOBAL_META_STATE:
+                mReader->mContext.updateGlobalMetaState();
+                break;
+            case Deferred::FADE_POINTER:
+                mReader->mContext.fadePointer();
+                break;
+            case Deferred::DISPATCH_EXTERNAL_STYLUS_STATE:
+                mReader->mContext.dispatchExternalStylusState(deferred.stylusState);
+                break;
+            }
+        }
+        mDeferred.clear();
+    }
+
+    virtual void updateGlobalMetaState() {
+        if (!onWorkerThread()) {
+            mReader->mContext.updateGlobalMetaState();
+            return;
+        }
+        mDeferred.push_back({Deferred::UPDATE_GLOBAL_META_STATE, StylusState()});
+    }
+
+    virtual int32_t getGlobalMetaState() {
+        // Only the reader thread changes it, and it is waiting.
+        return mReader->mContext.getGlobalMetaState();
+    }
+
+    virtual void disableVirtualKeysUntil(nsecs_t time) {
+        std::unique_lock lock = lockIfOnWorkerThread();
+        mReader->mContext.disableVirtualKeysUntil(time);
+    }
+
+    virtual bool shouldDropVirtualKey(nsecs_t now,
+            InputDevice* device, int32_t keyCode, int32_t scanCode) {
+        std::unique_lock lock = lockIfOnWorkerThread();
+        return mReader->mContext.shouldDropVirtualKey(now, device, keyCode, scanCode);
+    }
+
+    virtual void fadePointer() {
+        if (!onWorkerThread()) {
+            mReader->mContext.fadePointer();
+            return;
+        }
+        mDeferred.push_back({Deferred::FADE_POINTER, StylusState()});
+    }
+
+    virtual void requestTimeoutAtTime(nsecs_t when) {
+        std::unique_lock lock = lockIfOnWorkerThread();
+        mReader->mContext.requestTimeoutAtTime(when);
+    }
+
+    virtual int32_t bumpGeneration() {
+        std::unique_lock lock = lockIfOnWorkerThread();
+        return mReader->mContext.bumpGeneration();
+    }
+
+    virtual void getExternalStylusDevices(std::vector<InputDeviceInfo>& outDevices) {
+        std::unique_lock lock = lockIfOnWorkerThread();
+        mReader->mContext.getExternalStylusDevices(outDevices);
+    }
+
+    virtual void dispatchExternalStylusState(const StylusState& state) {
+        if (!onWorkerThread()) {
+            mReader->mContext.dispatchExternalStylusState(state);
+            return;
+        }
+        mDeferred.push_back({Deferred::DISPATCH_EXTERNAL_STYLUS_STATE, state});
+    }
+
+    virtual InputReaderPolicyInterface* getPolicy() {
+        return mReader->mContext.getPolicy();
+    }
+
+    virtual InputListenerInterface* getListener() {
+        if (!onWorkerThread()) {
+            return mReader->mContext.getListener();
+        }
+        return mCollector.get();
+    }
+
+    virtual EventHubInterface* getEventHub() {
+        return mReader->mContext.getEventHub();
+    }
+
+    virtual uint32_t getNextSequenceNum() {
+        std::unique_lock lock = lockIfOnWorkerThread();
+        return mReader->mContext.getNextSequenceNum();
+    }
+
+private:
+    struct Deferred {
+        enum Type {
+            UPDATE_GLOBAL_META_STATE,
+            FADE_POINTER,
+            DISPATCH_EXTERNAL_STYLUS_STATE,
+        };
+        Type type;
+        StylusState stylusState;
+    };
+
+    InputReader* const mReader;
+    const sp<CollectingInputListener> mCollector;
+
+    // Only used by the reader thread, or by the worker thread while the reader thread waits.
+    InputDevice* mDevice = nullptr;
+    std::vector<std::pair<const RawEvent*, size_t>> mRuns;
+    std::vector<Deferred> mDeferred;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    bool mHasWork;
+    bool mExiting;
+    std::thread mThread;
+
+    bool onWorkerThread() const {
+        return std::this_thread::get_id() == mThread.get_id();
+    }
+
+    std::unique_lock<std::mutex> lockIfOnWorkerThread() {
+        if (!onWorkerThread()) {
+            return std::unique_lock<std::mutex>();
+        }
+        return std::unique_lock<std::mutex>(mReader->mWorkerContextLock);
+    }
+
+    void processRuns() {
+        for (const auto& [rawEvents, count] : mRuns) {
+            mDevice->process(rawEvents, count);
+        }
+        mRuns.clear();
+    }
+
+    void threadLoop() {
+        std::unique_lock lock(mLock);
+        for (;;) {
+            mCondition.wait(lock, [this]() { return mHasWork || mExiting; });
+            if (mExiting) {
+                return;
+            }
+            lock.unlock();
+            processRuns();
+            lock.lock();
+            mHasWork = false;
+            mCondition.notify_all();
+        }
+    }
+};
+
 // --- InputReader ---
 
 InputReader::InputReader(const sp<EventHubInterface>& eventHub,
@@ -266,7 +515,7 @@ InputReader::InputReader(const sp<EventHubInterface>& eventHub,
         mContext(this), mEventHub(eventHub), mPolicy(policy),
         mNextSequenceNum(1), mGlobalMetaState(0), mGeneration(1),
         mDisableVirtualKeysTimeout(LLONG_MIN), mNextTimeout(LLONG_MAX),
-        mConfigurationChangesToRefresh(0) {
+        mConfigurationChangesToRefresh(0), mParallelDeviceProcessing(false) {
     mQueuedListener = new QueuedInputListener(listener);
 
     { // acquire lock
@@ -274,6 +523,7 @@ InputReader::InputReader(const sp<EventHubInterface>& eventHub,
 
         refreshConfigurationLocked(0);
         updateGlobalMetaStateLocked();
+        mParallelDeviceProcessing = mConfig.parallelDeviceProcessing;
     } // release lock
 }
 
@@ -354,8 +604,11 @@ void InputReader::processEventsLocked(const RawEvent* rawEvents, size_t count) {
         if (type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
             int32_t deviceId = rawEvent->deviceId;
             while (batchSize < count) {
+                // In parallel mode, the events of all devices up to the next synthetic event
+                // are handed out together.
                 if (rawEvent[batchSize].type >= EventHubInterface::FIRST_SYNTHETIC_EVENT
-                        || rawEvent[batchSize].deviceId != deviceId) {
+                        || (!mParallelDeviceProcessing
+                                && rawEvent[batchSize].deviceId != deviceId)) {
                     break;
                 }
                 batchSize += 1;
@@ -363,7 +616,11 @@ void InputReader::processEventsLocked(const RawEvent* rawEvents, size_t count) {
 #if DEBUG_RAW_EVENTS
             ALOGD("BatchSize: %zu Count: %zu", batchSize, count);
 #endif
-            processEventsForDeviceLocked(deviceId, rawEvent, batchSize);
+            if (mParallelDeviceProcessing) {
+                processEventsInParallelLocked(rawEvent, batchSize);
+            } else {
+                processEventsForDeviceLocked(deviceId, rawEvent, batchSize);
+            }
         } else {
             switch (rawEvent->type) {
             case EventHubInterface::DEVICE_ADDED:
@@ -442,12 +699,13 @@ void InputReader::removeDeviceLocked(nsecs_t when, int32_t deviceId) {
 
     device->reset(when);
     delete device;
+    mDeviceWorkers.erase(deviceId);
 }
 
 InputDevice* InputReader::createDeviceLocked(int32_t deviceId, int32_t controllerNumber,
         const InputDeviceIdentifier& identifier, uint32_t classes) {
-    InputDevice* device = new InputDevice(&mContext, deviceId, bumpGenerationLocked(),
-            controllerNumber, identifier, classes);
+    InputDevice* device = new InputDevice(getContextForDeviceLocked(deviceId),
+            deviceId, bumpGenerationLocked(), controllerNumber, identifier, classes);
 
     // External devices.
     if (classes & INPUT_DEVICE_CLASS_EXTERNAL) {
@@ -536,6 +794,73 @@ void InputReader::processEventsForDeviceLocked(int32_t deviceId,
     device->process(rawEvents, count);
 }
 
+void InputReader::processEventsInParallelLocked(const RawEvent* rawEvents, size_t count) {
+    // Hand each device's runs of events to its worker, in the order the devices first appear.
+    std::vector<DeviceWorker*> workers;
+    for (size_t i = 0; i < count; ) {
+        int32_t deviceId = rawEvents[i].deviceId;
+        size_t runSize = 1;
+        while (i + runSize < count && rawEvents[i + runSize].deviceId == deviceId) {
+            runSize += 1;
+        }
+
+        ssize_t deviceIndex = mDevices.indexOfKey(deviceId);
+        auto it = mDeviceWorkers.find(deviceId);
+        if (deviceIndex < 0 || it == mDeviceWorkers.end()
+                || mDevices.valueAt(deviceIndex)->getContext() != it->second.get()) {
+            // Unknown devices are discarded here, devices without a worker are processed
+            // on this thread.
+            processEventsForDeviceLocked(deviceId, rawEvents + i, runSize);
+        } else if (!mDevices.valueAt(deviceIndex)->isIgnored()) {
+            DeviceWorker* worker = it->second.get();
+            if (!worker->hasEvents()) {
+                workers.push_back(worker);
+            }
+            worker->addEvents(mDevices.valueAt(deviceIndex), rawEvents + i, runSize);
+        }
+        i += runSize;
+    }
+
+    if (workers.size() == 1) {
+        // Not worth a thread switch: a worker's context forwards straight to mContext when it
+        // is called from the reader thread.
+        workers[0]->processOnCallerThread();
+        return;
+    }
+
+    for (DeviceWorker* worker : workers) {
+        worker->start();
+    }
+    for (DeviceWorker* worker : workers) {
+        worker->waitUntilDone();
+    }
+
+    // Merge the workers' output by event time. Each worker's own output keeps its order.
+    const sp<InputListenerInterface> listener = mQueuedListener;
+    std::vector<size_t> next(workers.size(), 0);
+    for (;;) {
+        ssize_t earliest = -1;
+        for (size_t i = 0; i < workers.size(); i++) {
+            const std::vector<NotifyArgs*>& args = workers[i]->getArgs();
+            if (next[i] < args.size() && (earliest < 0 || args[next[i]]->eventTime
+                    < workers[earliest]->getArgs()[next[earliest]]->eventTime)) {
+                earliest = i;
+            }
+        }
+        if (earliest < 0) {
+            break;
+        }
+        NotifyArgs* args = workers[earliest]->getArgs()[next[earliest]++];
+        args->notify(listener);
+        delete args;
+    }
+
+    // Then do what the workers deferred because it affects other devices.
+    for (DeviceWorker* worker : workers) {
+        worker->finish();
+    }
+}
+
 void InputReader::timeoutExpiredLocked(nsecs_t when) {
     for (size_t i = 0; i < mDevices.size(); i++) {
         InputDevice* device = mDevices.valueAt(i);
@@ -844,6 +1169,8 @@ void InputReader::dump(std::string& dump) {
     }
 
     dump += INDENT "Configuration:\n";
+    dump += StringPrintf(INDENT2 "ParallelDeviceProcessing: %s (%zu workers)\n",
+            toString(mParallelDeviceProcessing), mDeviceWorkers.size());
     dump += INDENT2 "ExcludedDeviceNames: [";
     for (size_t i = 0; i < mConfig.excludedDeviceNames.size(); i++) {
         if (i != 0) {
@@ -978,6 +1305,17 @@ uint32_t InputReader::ContextImpl::getNextSequenceNum() {
     return (mReader->mNextSequenceNum)++;
 }
 
+InputReaderContext* InputReader::getContextForDeviceLocked(int32_t deviceId) {
+    if (!mParallelDeviceProcessing) {
+        return &mContext;
+    }
+    std::unique_ptr<DeviceWorker>& worker = mDeviceWorkers[deviceId];
+    if (!worker) {
+        worker = std::make_unique<DeviceWorker>(this);
+    }
+    return worker.get();
+}
+
 // --- InputDevice ---
 
 InputDevice::InputDevice(InputReaderContext* context, int32_t id, int32_t generation,
@@ -1751,8 +2089,9 @@ void MultiTouchMotionAccumulator::configure(InputDevice* device,
 }
 
 void MultiTouchMotionAccumulator::reset(InputDevice* device) {
-    // Unfortunately there is no way to read the initial contents of the slots.
-    // So when we reset the accumulator, we must assume they are all zeroes.
+    // With the slots protocol, the initial contents of the slots are read back from the
+    // driver, so that touches that are already down, or that were down when the evdev buffer
+    // overran, are not lost. Otherwise we must assume they are all zeroes.
     if (mUsingSlotsProtocol) {
         // Query the driver for the current slot index and use it as the initial slot
         // before we start reading events from the device.  It is possible that the
@@ -1771,6 +2110,7 @@ void MultiTouchMotionAccumulator::reset(InputDevice* device) {
             initialSlot = -1;
         }
         clearSlots(initialSlot);
+        syncSlots(device);
     } else {
         clearSlots(-1);
     }
@@ -1807,63 +2147,7 @@ void MultiTouchMotionAccumulator::process(const RawEvent* rawEvent) {
             }
 #endif
         } else {
-            Slot* slot = &mSlots[mCurrentSlot];
-
-            switch (rawEvent->code) {
-            case ABS_MT_POSITION_X:
-                slot->mInUse = true;
-                slot->mAbsMTPositionX = rawEvent->value;
-                break;
-            case ABS_MT_POSITION_Y:
-                slot->mInUse = true;
-                slot->mAbsMTPositionY = rawEvent->value;
-                break;
-            case ABS_MT_TOUCH_MAJOR:
-                slot->mInUse = true;
-                slot->mAbsMTTouchMajor = rawEvent->value;
-                break;
-            case ABS_MT_TOUCH_MINOR:
-                slot->mInUse = true;
-                slot->mAbsMTTouchMinor = rawEvent->value;
-                slot->mHaveAbsMTTouchMinor = true;
-                break;
-            case ABS_MT_WIDTH_MAJOR:
-                slot->mInUse = true;
-                slot->mAbsMTWidthMajor = rawEvent->value;
-                break;
-            case ABS_MT_WIDTH_MINOR:
-                slot->mInUse = true;
-                slot->mAbsMTWidthMinor = rawEvent->value;
-                slot->mHaveAbsMTWidthMinor = true;
-                break;
-            case ABS_MT_ORIENTATION:
-                slot->mInUse = true;
-                slot->mAbsMTOrientation = rawEvent->value;
-                break;
-            case ABS_MT_TRACKING_ID:
-                if (mUsingSlotsProtocol && rawEvent->value < 0) {
-                    // The slot is no longer in use but it retains its previous contents,
-                    // which may be reused for subsequent touches.
-                    slot->mInUse = false;
-                } else {
-                    slot->mInUse = true;
-                    slot->mAbsMTTrackingId = rawEvent->value;
-                }
-                break;
-            case ABS_MT_PRESSURE:
-                slot->mInUse = true;
-                slot->mAbsMTPressure = rawEvent->value;
-                break;
-            case ABS_MT_DISTANCE:
-                slot->mInUse = true;
-                slot->mAbsMTDistance = rawEvent->value;
-                break;
-            case ABS_MT_TOOL_TYPE:
-                slot->mInUse = true;
-                slot->mAbsMTToolType = rawEvent->value;
-                slot->mHaveAbsMTToolType = true;
-                break;
-            }
+            updateSlot(&mSlots[mCurrentSlot], rawEvent->code, rawEvent->value);
         }
     } else if (rawEvent->type == EV_SYN && rawEvent->code == SYN_MT_REPORT) {
         // MultiTouch Sync: The driver has returned all data for *one* of the pointers.
@@ -1873,6 +2157,95 @@ void MultiTouchMotionAccumulator::process(const RawEvent* rawEvent) {
     }
 }
 
+void MultiTouchMotionAccumulator::updateSlot(Slot* slot, int32_t code, int32_t value) {
+    switch (code) {
+    case ABS_MT_POSITION_X:
+        slot->mInUse = true;
+        slot->mAbsMTPositionX = value;
+        break;
+    case ABS_MT_POSITION_Y:
+        slot->mInUse = true;
+        slot->mAbsMTPositionY = value;
+        break;
+    case ABS_MT_TOUCH_MAJOR:
+        slot->mInUse = true;
+        slot->mAbsMTTouchMajor = value;
+        break;
+    case ABS_MT_TOUCH_MINOR:
+        slot->mInUse = true;
+        slot->mAbsMTTouchMinor = value;
+        slot->mHaveAbsMTTouchMinor = true;
+        break;
+    case ABS_MT_WIDTH_MAJOR:
+        slot->mInUse = true;
+        slot->mAbsMTWidthMajor = value;
+        break;
+    case ABS_MT_WIDTH_MINOR:
+        slot->mInUse = true;
+        slot->mAbsMTWidthMinor = value;
+        slot->mHaveAbsMTWidthMinor = true;
+        break;
+    case ABS_MT_ORIENTATION:
+        slot->mInUse = true;
+        slot->mAbsMTOrientation = value;
+        break;
+    case ABS_MT_TRACKING_ID:
+        if (mUsingSlotsProtocol && value < 0) {
+            // The slot is no longer in use but it retains its previous contents,
+            // which may be reused for subsequent touches.
+            slot->mInUse = false;
+        } else {
+            slot->mInUse = true;
+            slot->mAbsMTTrackingId = value;
+        }
+        break;
+    case ABS_MT_PRESSURE:
+        slot->mInUse = true;
+        slot->mAbsMTPressure = value;
+        break;
+    case ABS_MT_DISTANCE:
+        slot->mInUse = true;
+        slot->mAbsMTDistance = value;
+        break;
+    case ABS_MT_TOOL_TYPE:
+        slot->mInUse = true;
+        slot->mAbsMTToolType = value;
+        slot->mHaveAbsMTToolType = true;
+        break;
+    }
+}
+
+void MultiTouchMotionAccumulator::syncSlots(InputDevice* device) {
+    // The tracking id goes first, a slot without a touch in it is left cleared.
+    static const int32_t SYNCED_AXES[] = {
+            ABS_MT_TRACKING_ID, ABS_MT_POSITION_X, ABS_MT_POSITION_Y,
+            ABS_MT_TOUCH_MAJOR, ABS_MT_TOUCH_MINOR, ABS_MT_WIDTH_MAJOR, ABS_MT_WIDTH_MINOR,
+            ABS_MT_ORIENTATION, ABS_MT_PRESSURE, ABS_MT_DISTANCE, ABS_MT_TOOL_TYPE,
+    };
+
+    std::vector<int32_t> trackingIds;
+    status_t status = device->getEventHub()->getMtSlotValues(device->getId(),
+            ABS_MT_TRACKING_ID, mSlotCount, &trackingIds);
+    if (status) {
+        ALOGD("Could not retrieve current multitouch slot contents.  status=%d", status);
+        return;
+    }
+
+    std::vector<int32_t> values;
+    for (int32_t axis : SYNCED_AXES) {
+        if (axis != ABS_MT_TRACKING_ID && device->getEventHub()->getMtSlotValues(
+                device->getId(), axis, mSlotCount, &values)) {
+            continue; // not supported by this device
+        }
+        const std::vector<int32_t>& axisValues = axis == ABS_MT_TRACKING_ID ? trackingIds : values;
+        for (size_t i = 0; i < mSlotCount && i < axisValues.size(); i++) {
+            if (trackingIds[i] >= 0) {
+                updateSlot(&mSlots[i], axis, axisValues[i]);
+            }
+        }
+    }
+}
+
 void MultiTouchMotionAccumulator::finishSync() {
     if (!mUsingSlotsProtocol) {
         clearSlots(-1);
@@ -3670,6 +4043,8 @@ void TouchInputMapper::configureSurface(nsecs_t when, bool* outResetNeeded) {
         mXPrecision = 1.0f / mXScale;
         mYPrecision = 1.0f / mYScale;
 
+        configureSurfaceTransform();
+
         mOrientedRanges.x.axis = AMOTION_EVENT_AXIS_X;
         mOrientedRanges.x.source = mSource;
         mOrientedRanges.y.axis = AMOTION_EVENT_AXIS_Y;
@@ -4957,6 +5332,37 @@ const BitSet32& TouchInputMapper::findActiveIdBits(const CookedPointerData& cook
     return cookedPointerData.hoveringIdBits;
 }
 
+void TouchInputMapper::configureSurfaceTransform() {
+    const float rawMinX = mRawPointerAxes.x.minValue;
+    const float rawMaxX = mRawPointerAxes.x.maxValue;
+    const float rawMinY = mRawPointerAxes.y.minValue;
+    const float rawMaxY = mRawPointerAxes.y.maxValue;
+
+    SurfaceTransform& t = mSurfaceTransform;
+    switch (mSurfaceOrientation) {
+    case DISPLAY_ORIENTATION_90:
+        t = { 0, mYScale, mYTranslate - rawMinY * mYScale,
+              -mXScale, 0, rawMaxX * mXScale + mXTranslate,
+              float(-M_PI_2) };
+        break;
+    case DISPLAY_ORIENTATION_180:
+        t = { -mXScale, 0, rawMaxX * mXScale,
+              0, -mYScale, rawMaxY * mYScale + mYTranslate,
+              float(-M_PI) };
+        break;
+    case DISPLAY_ORIENTATION_270:
+        t = { 0, -mYScale, rawMaxY * mYScale,
+              mXScale, 0, mXTranslate - rawMinX * mXScale,
+              float(M_PI_2) };
+        break;
+    default:
+        t = { mXScale, 0, mXTranslate - rawMinX * mXScale,
+              0, mYScale, mYTranslate - rawMinY * mYScale,
+              0 };
+        break;
+    }
+}
+
 void TouchInputMapper::cookPointerData() {
     uint32_t currentPointerCount = mCurrentRawState.rawPointerData.pointerCount;
 
@@ -5136,57 +5542,22 @@ void TouchInputMapper::cookPointerData() {
         mAffineTransform.applyTo(xTransformed, yTransformed);
 
         // Adjust X, Y, and coverage coords for surface orientation.
-        float x, y;
-        float left, top, right, bottom;
+        const SurfaceTransform& t = mSurfaceTransform;
+        float x = xTransformed * t.xx + yTransformed * t.xy + t.x0;
+        float y = xTransformed * t.yx + yTransformed * t.yy + t.y0;
 
-        switch (mSurfaceOrientation) {
-        case DISPLAY_ORIENTATION_90:
-            x = float(yTransformed - mRawPointerAxes.y.minValue) * mYScale + mYTranslate;
-            y = float(mRawPointerAxes.x.maxValue - xTransformed) * mXScale + mXTranslate;
-            left = float(rawTop - mRawPointerAxes.y.minValue) * mYScale + mYTranslate;
-            right = float(rawBottom- mRawPointerAxes.y.minValue) * mYScale + mYTranslate;
-            bottom = float(mRawPointerAxes.x.maxValue - rawLeft) * mXScale + mXTranslate;
-            top = float(mRawPointerAxes.x.maxValue - rawRight) * mXScale + mXTranslate;
-            orientation -= M_PI_2;
-            if (mOrientedRanges.haveOrientation && orientation < mOrientedRanges.orientation.min) {
-                orientation += (mOrientedRanges.orientation.max - mOrientedRanges.orientation.min);
-            }
-            break;
-        case DISPLAY_ORIENTATION_180:
-            x = float(mRawPointerAxes.x.maxValue - xTransformed) * mXScale;
-            y = float(mRawPointerAxes.y.maxValue - yTransformed) * mYScale + mYTranslate;
-            left = float(mRawPointerAxes.x.maxValue - rawRight) * mXScale;
-            right = float(mRawPointerAxes.x.maxValue - rawLeft) * mXScale;
-            bottom = float(mRawPointerAxes.y.maxValue - rawTop) * mYScale + mYTranslate;
-            top = float(mRawPointerAxes.y.maxValue - rawBottom) * mYScale + mYTranslate;
-            orientation -= M_PI;
-            if (mOrientedRanges.haveOrientation && orientation < mOrientedRanges.orientation.min) {
+        orientation += t.orientationOffset;
+        if (mOrientedRanges.haveOrientation) {
+            if (t.orientationOffset < 0 && orientation < mOrientedRanges.orientation.min) {
                 orientation += (mOrientedRanges.orientation.max - mOrientedRanges.orientation.min);
-            }
-            break;
-        case DISPLAY_ORIENTATION_270:
-            x = float(mRawPointerAxes.y.maxValue - yTransformed) * mYScale;
-            y = float(xTransformed - mRawPointerAxes.x.minValue) * mXScale + mXTranslate;
-            left = float(mRawPointerAxes.y.maxValue - rawBottom) * mYScale;
-            right = float(mRawPointerAxes.y.maxValue - rawTop) * mYScale;
-            bottom = float(rawRight - mRawPointerAxes.x.minValue) * mXScale + mXTranslate;
-            top = float(rawLeft - mRawPointerAxes.x.minValue) * mXScale + mXTranslate;
-            orientation += M_PI_2;
-            if (mOrientedRanges.haveOrientation && orientation > mOrientedRanges.orientation.max) {
+            } else if (t.orientationOffset > 0
+                    && orientation > mOrientedRanges.orientation.max) {
                 orientation -= (mOrientedRanges.orientation.max - mOrientedRanges.orientation.min);
             }
-            break;
-        default:
-            x = float(xTransformed - mRawPointerAxes.x.minValue) * mXScale + mXTranslate;
-            y = float(yTransformed - mRawPointerAxes.y.minValue) * mYScale + mYTranslate;
-            left = float(rawLeft - mRawPointerAxes.x.minValue) * mXScale + mXTranslate;
-            right = float(rawRight - mRawPointerAxes.x.minValue) * mXScale + mXTranslate;
-            bottom = float(rawBottom - mRawPointerAxes.y.minValue) * mYScale + mYTranslate;
-            top = float(rawTop - mRawPointerAxes.y.minValue) * mYScale + mYTranslate;
-            break;
         }
 
-        // Write output coords.
+        // Write output coords, in increasing axis order so that each value is appended to the
+        // packed axis values rather than inserted between them.
         PointerCoords& out = mCurrentCookedState.cookedPointerData.pointerCoords[i];
         out.clear();
         out.setAxisValue(AMOTION_EVENT_AXIS_X, x);
@@ -5195,17 +5566,30 @@ void TouchInputMapper::cookPointerData() {
         out.setAxisValue(AMOTION_EVENT_AXIS_SIZE, size);
         out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, touchMajor);
         out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, touchMinor);
+        if (mCalibration.coverageCalibration != Calibration::COVERAGE_CALIBRATION_BOX) {
+            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor);
+            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor);
+        }
         out.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, orientation);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt);
         out.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, distance);
+        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt);
         if (mCalibration.coverageCalibration == Calibration::COVERAGE_CALIBRATION_BOX) {
+            // The corners of the box map to opposite corners of the surface box, with the
+            // edges swapped along each surface axis that runs against the raw axis.
+            float left = rawLeft * t.xx + rawTop * t.xy + t.x0;
+            float top = rawLeft * t.yx + rawTop * t.yy + t.y0;
+            float right = rawRight * t.xx + rawBottom * t.xy + t.x0;
+            float bottom = rawRight * t.yx + rawBottom * t.yy + t.y0;
+            if (t.xx + t.xy < 0) {
+                std::swap(left, right);
+            }
+            if (t.yx + t.yy < 0) {
+                std::swap(top, bottom);
+            }
             out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_1, left);
             out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_2, top);
             out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_3, right);
             out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_4, bottom);
-        } else {
-            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor);
-            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor);
         }
 
         // Write output properties.
@@ -33,9 +33,12 @@
 #include <utils/Timers.h>
 #include <utils/BitSet.h>
 
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <stddef.h>
 #include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
@@ -176,6 +179,10 @@ protected:
 
     friend class ContextImpl;
 
+    // The context that a new device and its mappers should use: mContext, or the device's
+    // worker when devices are processed in parallel.
+    InputReaderContext* getContextForDeviceLocked(int32_t deviceId);
+
 private:
     Mutex mLock;
 
@@ -199,6 +206,17 @@ private:
     // low-level input event decoding and device management
     void processEventsLocked(const RawEvent* rawEvents, size_t count);
 
+    // Processes the raw events of one device on a thread of its own, when
+    // InputReaderConfiguration::parallelDeviceProcessing was set at startup.
+    class DeviceWorker;
+    friend class DeviceWorker;
+    bool mParallelDeviceProcessing;
+    std::unordered_map<int32_t, std::unique_ptr<DeviceWorker>> mDeviceWorkers;
+    // Serializes the calls that workers make into the reader while the reader thread waits
+    // for them.
+    std::mutex mWorkerContextLock;
+    void processEventsInParallelLocked(const RawEvent* rawEvents, size_t count);
+
     void addDeviceLocked(nsecs_t when, int32_t deviceId);
     void removeDeviceLocked(nsecs_t when, int32_t deviceId);
     void processEventsForDeviceLocked(int32_t deviceId, const RawEvent* rawEvents, size_t count);
@@ -728,6 +746,8 @@ private:
     uint32_t mDeviceTimestamp;
 
     void clearSlots(int32_t initialSlot);
+    void syncSlots(InputDevice* device);
+    void updateSlot(Slot* slot, int32_t code, int32_t value);
 };
 
 
@@ -1269,6 +1289,7 @@ protected:
     virtual void configureRawPointerAxes();
     virtual void dumpRawPointerAxes(std::string& dump);
     virtual void configureSurface(nsecs_t when, bool* outResetNeeded);
+    void configureSurfaceTransform();
     virtual void dumpSurface(std::string& dump);
     virtual void configureVirtualKeys();
     virtual void dumpVirtualKeys(std::string& dump);
@@ -1319,6 +1340,16 @@ private:
     float mYScale;
     float mYPrecision;
 
+    // Maps raw touch coordinates onto surface coordinates for mSurfaceOrientation, folding the
+    // translation and scaling factors above into x = rawX * xx + rawY * xy + x0 and
+    // y = rawX * yx + rawY * yy + y0. orientationOffset rotates the pointer orientation.
+    struct SurfaceTransform {
+        float xx, xy, x0;
+        float yx, yy, y0;
+        float orientationOffset;
+    };
+    SurfaceTransform mSurfaceTransform;
+
     float mGeometricScale;
 
     float mPressureScale;
@@ -196,10 +196,11 @@ std::optional<TouchVideoFrame> TouchVideoDevice::readFrame() {
         ALOGW("The timestamp %ld.%ld was not acquired using CLOCK_MONOTONIC",
                 buf.timestamp.tv_sec, buf.timestamp.tv_usec);
     }
-    std::vector<int16_t> data(mHeight * mWidth);
+    std::shared_ptr<std::vector<int16_t>> data = obtainFrameData();
     const int16_t* readFrom = mReadLocations[buf.index];
-    std::copy(readFrom, readFrom + mHeight * mWidth, data.begin());
-    TouchVideoFrame frame(mHeight, mWidth, std::move(data), buf.timestamp);
+    std::copy(readFrom, readFrom + mHeight * mWidth, data->begin());
+    TouchVideoFrame frame =
+            TouchVideoFrame::fromSharedData(mHeight, mWidth, std::move(data), buf.timestamp);
 
     result = ioctl(mFd.get(), VIDIOC_QBUF, &buf);
     if (result == -1) {
@@ -208,6 +209,24 @@ std::optional<TouchVideoFrame> TouchVideoDevice::readFrame() {
     return std::make_optional(std::move(frame));
 }
 
+std::shared_ptr<std::vector<int16_t>> TouchVideoDevice::obtainFrameData() {
+    for (size_t i = 0; i < FRAME_RING_SIZE; i++) {
+        std::shared_ptr<std::vector<int16_t>>& slot =
+                mFrameRing[(mNextRingIndex + i) % FRAME_RING_SIZE];
+        if (slot == nullptr) {
+            slot = std::make_shared<std::vector<int16_t>>(mHeight * mWidth);
+        } else if (slot.use_count() != 1) {
+            // Frames that were handed out still share it. The count can only go down
+            // from another thread, since a new owner would have to copy it from us.
+            continue;
+        }
+        mNextRingIndex = (mNextRingIndex + i + 1) % FRAME_RING_SIZE;
+        return slot;
+    }
+    ALOGW("All %zu frame buffers are in use, allocating a new one", FRAME_RING_SIZE);
+    return std::make_shared<std::vector<int16_t>>(mHeight * mWidth);
+}
+
 /*
  * This function should not be called unless buffer is ready! This must be checked with
  * select, poll, epoll, or some other similar api first.
@@ -20,6 +20,7 @@
 #include <array>
 #include <android-base/unique_fd.h>
 #include <input/TouchVideoFrame.h>
+#include <memory>
 #include <optional>
 #include <stdint.h>
 #include <string>
@@ -104,6 +105,14 @@ private:
      */
     static constexpr size_t MAX_QUEUE_SIZE = 10;
     std::vector<TouchVideoFrame> mFrames;
+    /**
+     * Storage for the frame data, reused once no frame shares it anymore, so that reading
+     * a frame doesn't allocate. Sized to cover the internal queue plus the frames that are
+     * still on their way through the input pipeline.
+     */
+    static constexpr size_t FRAME_RING_SIZE = 2 * MAX_QUEUE_SIZE;
+    std::array<std::shared_ptr<std::vector<int16_t>>, FRAME_RING_SIZE> mFrameRing;
+    size_t mNextRingIndex = 0;
 
     /**
      * The constructor is private because opening a v4l2 device requires many checks.
@@ -120,6 +129,11 @@ private:
      * Read a single frame. May return nullopt if no data is currently available for reading.
      */
     std::optional<TouchVideoFrame> readFrame();
+    /**
+     * Get storage for the data of one frame that no frame shares. Comes from the ring
+     * when a slot is free, and from the heap otherwise.
+     */
+    std::shared_ptr<std::vector<int16_t>> obtainFrameData();
 };
 } // namespace android
 #endif //_INPUTFLINGER_TOUCH_VIDEO_DEVICE_H
@@ -42,9 +42,13 @@ public:
     virtual status_t dump(int fd, const Vector<String16>& args);
     void setInputWindows(const std::vector<InputWindowInfo>&,
             const sp<ISetInputWindowsListener>&) {}
+    status_t updateInputWindows(const InputWindowsUpdate&, const sp<ISetInputWindowsListener>&) {
+        return OK;
+    }
     void transferTouchFocus(const sp<IBinder>&, const sp<IBinder>&) {}
     void registerInputChannel(const sp<InputChannel>&) {}
     void unregisterInputChannel(const sp<InputChannel>&) {}
+    status_t getInputLatencyStats(std::vector<InputLatencyStats>*) { return INVALID_OPERATION; }
 
 private:
     virtual ~InputFlinger();
@@ -131,12 +131,20 @@ struct NotifyMotionArgs : public NotifyArgs {
             int32_t edgeFlags, uint32_t deviceTimestamp, uint32_t pointerCount,
             const PointerProperties* pointerProperties, const PointerCoords* pointerCoords,
             float xPrecision, float yPrecision, nsecs_t downTime,
-            const std::vector<TouchVideoFrame>& videoFrames);
+            std::vector<TouchVideoFrame> videoFrames);
 
     NotifyMotionArgs(const NotifyMotionArgs& other);
 
+    // Takes the video frames instead of copying them.
+    NotifyMotionArgs(NotifyMotionArgs&& other);
+
     virtual ~NotifyMotionArgs() { }
 
+    // Motion args allocated on the heap, e.g. the copies QueuedInputListener keeps until
+    // it is flushed, come out of a fixed-size pool, falling back to the heap when it is full.
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
     bool operator==(const NotifyMotionArgs& rhs) const;
 
     virtual void notify(const sp<InputListenerInterface>& listener) const;
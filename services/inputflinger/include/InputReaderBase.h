@@ -252,6 +252,10 @@ struct InputReaderConfiguration {
     // The set of currently disabled input devices.
     SortedVector<int32_t> disabledDevices;
 
+    // True to process the raw events of each input device on a worker thread of its own,
+    // so that a slow device does not hold up the others. Only read at startup.
+    bool parallelDeviceProcessing;
+
     InputReaderConfiguration() :
             virtualKeyQuietTime(0),
             pointerVelocityControlParameters(1.0f, 500.0f, 3000.0f, 3.0f),
@@ -268,7 +272,7 @@ struct InputReaderConfiguration {
             pointerGestureSwipeMaxWidthRatio(0.25f),
             pointerGestureMovementSpeedRatio(0.8f),
             pointerGestureZoomSpeedRatio(0.3f),
-            showTouches(false), pointerCapture(false) { }
+            showTouches(false), pointerCapture(false), parallelDeviceProcessing(false) { }
 
     std::optional<DisplayViewport> getDisplayViewportByType(ViewportType type) const;
     std::optional<DisplayViewport> getDisplayViewportByUniqueId(const std::string& uniqueDisplayId)
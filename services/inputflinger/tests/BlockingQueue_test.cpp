@@ -93,6 +93,59 @@ TEST(BlockingQueueTest, Queue_Erases) {
     ASSERT_EQ(3, queue.pop());
 }
 
+TEST(BlockingQueueTest, Queue_PopsAllInOrder) {
+    constexpr size_t capacity = 4;
+    BlockingQueue<int> queue(capacity);
+
+    queue.push(1);
+    queue.push(2);
+    queue.push(3);
+    ASSERT_EQ(std::vector<int>({1, 2, 3}), queue.popAll());
+    ASSERT_EQ(0u, queue.size());
+    // The queue is still usable afterwards
+    ASSERT_TRUE(queue.push(4));
+    ASSERT_EQ(4, queue.pop());
+}
+
+TEST(BlockingQueueTest, Queue_WhenFull_DropsOldestDroppableElement) {
+    constexpr size_t capacity = 3;
+    BlockingQueue<int> queue(capacity);
+    const auto isEven = [](const int& element) { return element % 2 == 0; };
+
+    queue.push(1);
+    queue.push(2);
+    queue.push(4);
+    bool dropped;
+    ASSERT_TRUE(queue.push(5, isEven, &dropped));
+    ASSERT_TRUE(dropped);
+    ASSERT_EQ(std::vector<int>({1, 4, 5}), queue.popAll());
+}
+
+TEST(BlockingQueueTest, Queue_WhenNotFull_DoesNotDrop) {
+    constexpr size_t capacity = 3;
+    BlockingQueue<int> queue(capacity);
+    const auto isEven = [](const int& element) { return element % 2 == 0; };
+
+    queue.push(2);
+    bool dropped;
+    ASSERT_TRUE(queue.push(3, isEven, &dropped));
+    ASSERT_FALSE(dropped);
+    ASSERT_EQ(std::vector<int>({2, 3}), queue.popAll());
+}
+
+TEST(BlockingQueueTest, Queue_WhenFullOfUndroppableElements_RejectsNewElement) {
+    constexpr size_t capacity = 2;
+    BlockingQueue<int> queue(capacity);
+    const auto isEven = [](const int& element) { return element % 2 == 0; };
+
+    queue.push(1);
+    queue.push(3);
+    bool dropped;
+    ASSERT_FALSE(queue.push(4, isEven, &dropped));
+    ASSERT_FALSE(dropped);
+    ASSERT_EQ(std::vector<int>({1, 3}), queue.popAll());
+}
+
 // --- BlockingQueueTest - Multiple threads ---
 
 TEST(BlockingQueueTest, Queue_AllowsMultipleThreads) {
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../EntryPool.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+struct PooledEntry {
+    int32_t a;
+    int64_t b;
+};
+
+// --- EntryPoolTest ---
+
+/**
+ * A released slot is handed out again by the next allocation.
+ */
+TEST(EntryPoolTest, Allocate_ReusesReleasedSlot) {
+    EntryPool<PooledEntry> pool(2);
+
+    void* first = pool.allocate(sizeof(PooledEntry));
+    ASSERT_NE(nullptr, first);
+    pool.release(first);
+    ASSERT_EQ(first, pool.allocate(sizeof(PooledEntry)));
+
+    EntryPoolStats stats = pool.getStats();
+    ASSERT_EQ(2u, stats.capacity);
+    ASSERT_EQ(1u, stats.inUse);
+    ASSERT_EQ(1u, stats.peakInUse);
+    ASSERT_EQ(2u, stats.allocations);
+    ASSERT_EQ(0u, stats.heapAllocations);
+    pool.release(first);
+}
+
+/**
+ * Once the slab is exhausted, allocations come from the heap and are released back to it.
+ */
+TEST(EntryPoolTest, Allocate_FallsBackToHeapWhenFull) {
+    EntryPool<PooledEntry> pool(1);
+
+    void* pooled = pool.allocate(sizeof(PooledEntry));
+    void* heap = pool.allocate(sizeof(PooledEntry));
+    ASSERT_NE(nullptr, heap);
+    ASSERT_NE(pooled, heap);
+
+    EntryPoolStats stats = pool.getStats();
+    ASSERT_EQ(1u, stats.inUse);
+    ASSERT_EQ(1u, stats.heapAllocations);
+
+    pool.release(heap);
+    ASSERT_EQ(1u, pool.getStats().inUse);
+    pool.release(pooled);
+    ASSERT_EQ(0u, pool.getStats().inUse);
+    ASSERT_EQ(1u, pool.getStats().peakInUse);
+}
+
+/**
+ * Allocations of a different size (e.g. a subclass) never use the slab.
+ */
+TEST(EntryPoolTest, Allocate_OtherSizeUsesHeap) {
+    EntryPool<PooledEntry> pool(4);
+
+    void* p = pool.allocate(sizeof(PooledEntry) * 2);
+    EntryPoolStats stats = pool.getStats();
+    ASSERT_EQ(0u, stats.inUse);
+    ASSERT_EQ(1u, stats.heapAllocations);
+    pool.release(p);
+}
+
+/**
+ * Entries may be allocated on one thread and released on another.
+ */
+TEST(EntryPoolTest, AllocateAndReleaseOnDifferentThreads) {
+    constexpr size_t capacity = 16;
+    constexpr size_t count = 1000;
+    EntryPool<PooledEntry> pool(capacity);
+
+    std::vector<void*> entries;
+    std::thread allocateThread([&]() {
+        for (size_t i = 0; i < count; i++) {
+            entries.push_back(pool.allocate(sizeof(PooledEntry)));
+        }
+    });
+    allocateThread.join();
+
+    std::thread releaseThread([&]() {
+        for (void* entry : entries) {
+            pool.release(entry);
+        }
+    });
+    releaseThread.join();
+
+    EntryPoolStats stats = pool.getStats();
+    ASSERT_EQ(0u, stats.inUse);
+    ASSERT_EQ(capacity, stats.peakInUse);
+    ASSERT_EQ(count, stats.allocations);
+    ASSERT_EQ(count - capacity, stats.heapAllocations);
+}
+
+} // namespace android
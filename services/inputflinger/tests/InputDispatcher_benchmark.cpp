@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <binder/Binder.h>
+#include <poll.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../InputDispatcher.h"
+
+namespace android {
+namespace {
+
+constexpr int32_t kDeviceId = 1;
+constexpr int32_t kInjectorPid = 999;
+constexpr int32_t kInjectorUid = 1001;
+constexpr nsecs_t kDispatchingTimeout = 5000 * 1000000LL; // 5 s
+constexpr int kReceiveTimeoutMs = 1000;
+
+constexpr int32_t kWindowSize = 100;
+constexpr int32_t kWindowColumns = 10;
+
+// A touch gesture: a DOWN, kMovesPerGesture MOVEs and an UP, sampled at 120 Hz.
+constexpr size_t kMovesPerGesture = 30;
+constexpr nsecs_t kSampleInterval = 8 * 1000000; // 8 ms
+
+// --- FakeInputDispatcherPolicy ---
+
+class FakeInputDispatcherPolicy : public InputDispatcherPolicyInterface {
+public:
+    FakeInputDispatcherPolicy() {}
+
+protected:
+    virtual ~FakeInputDispatcherPolicy() {}
+
+private:
+    virtual void notifyConfigurationChanged(nsecs_t) {}
+
+    virtual nsecs_t notifyANR(const sp<InputApplicationHandle>&, const sp<IBinder>&,
+                              const std::string& name) {
+        ALOGE("The window is not responding : %s", name.c_str());
+        return 0;
+    }
+
+    virtual void notifyInputChannelBroken(const sp<IBinder>&) {}
+
+    virtual void notifyFocusChanged(const sp<IBinder>&, const sp<IBinder>&) {}
+
+    virtual void getDispatcherConfiguration(InputDispatcherConfiguration* outConfig) {
+        *outConfig = mConfig;
+    }
+
+    virtual bool filterInputEvent(const InputEvent*, uint32_t) { return true; }
+
+    virtual void interceptKeyBeforeQueueing(const KeyEvent*, uint32_t&) {}
+
+    virtual void interceptMotionBeforeQueueing(int32_t, nsecs_t, uint32_t&) {}
+
+    virtual nsecs_t interceptKeyBeforeDispatching(const sp<IBinder>&, const KeyEvent*,
+                                                  uint32_t) {
+        return 0;
+    }
+
+    virtual bool dispatchUnhandledKey(const sp<IBinder>&, const KeyEvent*, uint32_t, KeyEvent*) {
+        return false;
+    }
+
+    virtual void notifySwitch(nsecs_t, uint32_t, uint32_t, uint32_t) {}
+
+    virtual void pokeUserActivity(nsecs_t, int32_t) {}
+
+    virtual bool checkInjectEventsPermissionNonReentrant(int32_t, int32_t) { return false; }
+
+    virtual void onPointerDownOutsideFocus(const sp<IBinder>&) {}
+
+    InputDispatcherConfiguration mConfig;
+};
+
+class FakeApplicationHandle : public InputApplicationHandle {
+public:
+    FakeApplicationHandle() {}
+    virtual ~FakeApplicationHandle() {}
+
+    virtual bool updateInfo() {
+        mInfo.dispatchingTimeout = kDispatchingTimeout;
+        return true;
+    }
+};
+
+// The client end of an input channel, which acknowledges every event it reads.
+class FakeInputReceiver {
+public:
+    explicit FakeInputReceiver(const std::string& name) {
+        InputChannel::openInputChannelPair(name, mServerChannel, mClientChannel);
+        mServerChannel->setToken(new BBinder());
+        mConsumer = std::make_unique<InputConsumer>(mClientChannel);
+    }
+
+    virtual ~FakeInputReceiver() {}
+
+    // Waits for the next event and finishes it. Returns false on a timeout or error.
+    bool receiveEvent() {
+        while (true) {
+            uint32_t consumeSeq;
+            InputEvent* event;
+            int motionEventType;
+            int touchMoveNumber;
+            bool flag;
+            status_t status = mConsumer->consume(&mEventFactory, true /*consumeBatches*/, -1,
+                                                 &consumeSeq, &event, &motionEventType,
+                                                 &touchMoveNumber, &flag);
+            if (status == OK) {
+                return mConsumer->sendFinishedSignal(consumeSeq, true /*handled*/) == OK;
+            }
+            if (status != WOULD_BLOCK) {
+                return false;
+            }
+
+            struct pollfd pfd = {mClientChannel->getFd(), POLLIN, 0};
+            if (poll(&pfd, 1, kReceiveTimeoutMs) <= 0) {
+                return false;
+            }
+        }
+    }
+
+    sp<InputChannel> mServerChannel, mClientChannel;
+
+private:
+    std::unique_ptr<InputConsumer> mConsumer;
+    PreallocatedInputEventFactory mEventFactory;
+};
+
+class FakeWindowHandle : public InputWindowHandle, public FakeInputReceiver {
+public:
+    FakeWindowHandle(const sp<InputApplicationHandle>& inputApplicationHandle,
+                     const sp<InputDispatcher>& dispatcher, const std::string& name,
+                     const Rect& frame)
+          : FakeInputReceiver(name), mName(name), mFrame(frame) {
+        dispatcher->registerInputChannel(mServerChannel, ADISPLAY_ID_DEFAULT);
+
+        inputApplicationHandle->updateInfo();
+        mInfo.applicationInfo = *inputApplicationHandle->getInfo();
+    }
+
+    virtual bool updateInfo() {
+        mInfo.token = mServerChannel->getToken();
+        mInfo.name = mName;
+        mInfo.layoutParamsFlags = InputWindowInfo::FLAG_NOT_TOUCH_MODAL;
+        mInfo.layoutParamsType = InputWindowInfo::TYPE_APPLICATION;
+        mInfo.dispatchingTimeout = kDispatchingTimeout;
+        mInfo.frameLeft = mFrame.left;
+        mInfo.frameTop = mFrame.top;
+        mInfo.frameRight = mFrame.right;
+        mInfo.frameBottom = mFrame.bottom;
+        mInfo.globalScaleFactor = 1.0;
+        mInfo.touchableRegion.clear();
+        mInfo.addTouchableRegion(mFrame);
+        mInfo.visible = true;
+        mInfo.canReceiveKeys = true;
+        mInfo.hasFocus = false;
+        mInfo.hasWallpaper = false;
+        mInfo.paused = false;
+        mInfo.layer = 0;
+        mInfo.ownerPid = kInjectorPid;
+        mInfo.ownerUid = kInjectorUid;
+        mInfo.inputFeatures = 0;
+        mInfo.displayId = ADISPLAY_ID_DEFAULT;
+        return true;
+    }
+
+private:
+    const std::string mName;
+    const Rect mFrame;
+};
+
+static NotifyMotionArgs generateMotionArgs(uint32_t sequenceNum, int32_t action, nsecs_t downTime,
+                                           nsecs_t eventTime, float x, float y) {
+    PointerProperties pointerProperties[1];
+    PointerCoords pointerCoords[1];
+
+    pointerProperties[0].clear();
+    pointerProperties[0].id = 0;
+    pointerProperties[0].toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+
+    pointerCoords[0].clear();
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, x);
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, y);
+
+    return NotifyMotionArgs(sequenceNum, eventTime, kDeviceId, AINPUT_SOURCE_TOUCHSCREEN,
+            ADISPLAY_ID_DEFAULT, POLICY_FLAG_PASS_TO_USER, action, 0 /*actionButton*/,
+            0 /*flags*/, AMETA_NONE, 0 /*buttonState*/, MotionClassification::NONE,
+            AMOTION_EVENT_EDGE_FLAG_NONE, 0 /*deviceTimestamp*/, 1 /*pointerCount*/,
+            pointerProperties, pointerCoords, 0 /*xPrecision*/, 0 /*yPrecision*/, downTime,
+            {} /*videoFrames*/);
+}
+
+// Sends touch gestures through InputDispatcher::notifyMotion, the way InputReader does, and
+// measures the time until every target has read each event. The touched window is the bottom
+// one, so touch target selection walks all the windows in front of it.
+// range(0) is the number of windows and range(1) the number of gesture monitors.
+void BM_DispatchTouchGesture(benchmark::State& state) {
+    sp<FakeInputDispatcherPolicy> policy = new FakeInputDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(policy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    sp<InputDispatcherThread> dispatcherThread = new InputDispatcherThread(dispatcher);
+    dispatcherThread->run("InputDispatcherBenchmark", PRIORITY_URGENT_DISPLAY);
+
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    std::vector<sp<FakeWindowHandle>> windows;
+    std::vector<sp<InputWindowHandle>> windowHandles;
+    for (int32_t i = 0; i < state.range(0); i++) {
+        const int32_t left = (i % kWindowColumns) * kWindowSize;
+        const int32_t top = (i / kWindowColumns) * kWindowSize;
+        sp<FakeWindowHandle> window =
+                new FakeWindowHandle(application, dispatcher, "Window " + std::to_string(i),
+                                     Rect(left, top, left + kWindowSize, top + kWindowSize));
+        windows.push_back(window);
+        windowHandles.push_back(window);
+    }
+    dispatcher->setInputWindows(windowHandles, ADISPLAY_ID_DEFAULT);
+
+    std::vector<std::unique_ptr<FakeInputReceiver>> monitors;
+    for (int32_t i = 0; i < state.range(1); i++) {
+        monitors.push_back(std::make_unique<FakeInputReceiver>("Monitor " + std::to_string(i)));
+        dispatcher->registerInputMonitor(monitors.back()->mServerChannel, ADISPLAY_ID_DEFAULT,
+                                         true /*isGestureMonitor*/);
+    }
+
+    const sp<FakeWindowHandle>& target = windows.back();
+    const InputWindowInfo* targetInfo = target->getInfo();
+    const float x = targetInfo->frameLeft + kWindowSize / 2;
+    const float y = targetInfo->frameTop + kWindowSize / 2;
+
+    std::vector<nsecs_t> latencies;
+    uint32_t sequenceNum = 0;
+    bool failed = false;
+    for (auto _ : state) {
+        const nsecs_t downTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (size_t i = 0; i <= kMovesPerGesture + 1; i++) {
+            const int32_t action = i == 0 ? AMOTION_EVENT_ACTION_DOWN
+                    : i > kMovesPerGesture ? AMOTION_EVENT_ACTION_UP : AMOTION_EVENT_ACTION_MOVE;
+            NotifyMotionArgs args = generateMotionArgs(++sequenceNum, action, downTime,
+                    downTime + i * kSampleInterval, x, y + (i % 2));
+
+            const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+            dispatcher->notifyMotion(&args);
+            bool received = target->receiveEvent();
+            for (const auto& monitor : monitors) {
+                received = monitor->receiveEvent() && received;
+            }
+            latencies.push_back(systemTime(SYSTEM_TIME_MONOTONIC) - start);
+
+            if (!received) {
+                state.SkipWithError("An event was not delivered");
+                failed = true;
+                break;
+            }
+        }
+        if (failed) {
+            break;
+        }
+    }
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentileUs = [&latencies](size_t percentile) {
+            return latencies[(latencies.size() - 1) * percentile / 100] / 1000.0;
+        };
+        state.counters["p50_us"] = percentileUs(50);
+        state.counters["p90_us"] = percentileUs(90);
+        state.counters["p99_us"] = percentileUs(99);
+    }
+    state.SetItemsProcessed(latencies.size());
+
+    // Unregistering the channels wakes the dispatcher thread, so it sees the exit request.
+    dispatcherThread->requestExit();
+    dispatcher->setInputWindows({}, ADISPLAY_ID_DEFAULT);
+    for (const auto& monitor : monitors) {
+        dispatcher->unregisterInputChannel(monitor->mServerChannel);
+    }
+    for (const auto& window : windows) {
+        dispatcher->unregisterInputChannel(window->mServerChannel);
+    }
+    dispatcherThread->join();
+}
+BENCHMARK(BM_DispatchTouchGesture)
+        ->Args({1, 0})
+        ->Args({10, 0})
+        ->Args({50, 0})
+        ->Args({10, 1})
+        ->Args({10, 4})
+        ->Args({50, 4});
+
+} // namespace
+} // namespace android
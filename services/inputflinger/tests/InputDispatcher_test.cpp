@@ -710,6 +710,59 @@ TEST_F(InputDispatcherTest, SetInputWindow_InputWindowInfo) {
     windowSecond->consumeEvent(AINPUT_EVENT_TYPE_KEY, ADISPLAY_ID_NONE);
 }
 
+// A touch far from the origin should go to the window under it, not to the
+// windows that share a hit-test cell with the origin.
+TEST_F(InputDispatcherTest, SetInputWindow_TouchGoesToWindowUnderPoint) {
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    sp<FakeWindowHandle> windowSmall = new FakeWindowHandle(application, mDispatcher, "Small",
+            ADISPLAY_ID_DEFAULT);
+    sp<FakeWindowHandle> windowLarge = new FakeWindowHandle(application, mDispatcher, "Large",
+            ADISPLAY_ID_DEFAULT);
+
+    windowSmall->setFrame(Rect(1000, 1200, 1100, 1300));
+    windowSmall->setLayoutParamFlags(InputWindowInfo::FLAG_NOT_TOUCH_MODAL);
+    windowLarge->setFrame(Rect(0, 0, 2000, 2000));
+    windowLarge->setLayoutParamFlags(InputWindowInfo::FLAG_NOT_TOUCH_MODAL);
+
+    std::vector<sp<InputWindowHandle>> inputWindowHandles;
+    inputWindowHandles.push_back(windowSmall);
+    inputWindowHandles.push_back(windowLarge);
+
+    mDispatcher->setInputWindows(inputWindowHandles, ADISPLAY_ID_DEFAULT);
+    ASSERT_EQ(INPUT_EVENT_INJECTION_SUCCEEDED, injectMotionDown(mDispatcher,
+            AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT, 1050, 1250))
+            << "Inject motion event should return INPUT_EVENT_INJECTION_SUCCEEDED";
+
+    windowSmall->consumeEvent(AINPUT_EVENT_TYPE_MOTION, ADISPLAY_ID_DEFAULT);
+    windowLarge->assertNoEvents();
+}
+
+// A touch modal window takes the touches that fall outside the windows in front of it, even
+// where its frame doesn't reach.
+TEST_F(InputDispatcherTest, SetInputWindow_TouchModalWindowGetsTouchesOutsideOthers) {
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    sp<FakeWindowHandle> windowTop = new FakeWindowHandle(application, mDispatcher, "Top",
+            ADISPLAY_ID_DEFAULT);
+    sp<FakeWindowHandle> windowModal = new FakeWindowHandle(application, mDispatcher, "Modal",
+            ADISPLAY_ID_DEFAULT);
+
+    windowTop->setFrame(Rect(0, 0, 100, 100));
+    windowTop->setLayoutParamFlags(InputWindowInfo::FLAG_NOT_TOUCH_MODAL);
+    windowModal->setFrame(Rect(0, 0, 100, 100));
+
+    std::vector<sp<InputWindowHandle>> inputWindowHandles;
+    inputWindowHandles.push_back(windowTop);
+    inputWindowHandles.push_back(windowModal);
+
+    mDispatcher->setInputWindows(inputWindowHandles, ADISPLAY_ID_DEFAULT);
+    ASSERT_EQ(INPUT_EVENT_INJECTION_SUCCEEDED, injectMotionDown(mDispatcher,
+            AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT, 500, 700))
+            << "Inject motion event should return INPUT_EVENT_INJECTION_SUCCEEDED";
+
+    windowModal->consumeEvent(AINPUT_EVENT_TYPE_MOTION, ADISPLAY_ID_DEFAULT);
+    windowTop->assertNoEvents();
+}
+
 /* Test InputDispatcher for MultiDisplay */
 class InputDispatcherFocusOnTwoDisplaysTest : public InputDispatcherTest {
 public:
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "InputClassifier.h"
+#include "InputListener.h"
+
+namespace android {
+namespace {
+
+constexpr nsecs_t kSampleInterval = 8 * 1000000; // 8 ms, a 120 Hz touch panel
+constexpr size_t kEventsPerFlush = 4;
+
+// The last stage of the pipeline, standing in for the dispatcher.
+class CountingInputListener : public InputListenerInterface {
+public:
+    size_t motionCount = 0;
+
+    virtual void notifyConfigurationChanged(const NotifyConfigurationChangedArgs*) {}
+    virtual void notifyKey(const NotifyKeyArgs*) {}
+    virtual void notifyMotion(const NotifyMotionArgs* args) {
+        benchmark::DoNotOptimize(args->pointerCoords[0].getX());
+        motionCount++;
+    }
+    virtual void notifySwitch(const NotifySwitchArgs*) {}
+    virtual void notifyDeviceReset(const NotifyDeviceResetArgs*) {}
+};
+
+// Pushes touch moves through QueuedInputListener and InputClassifier the way InputReader
+// does: queued while a batch of raw events is processed, then flushed together.
+// range(0) is the number of pointers down.
+void BM_QueuedMotionThroughClassifier(benchmark::State& state) {
+    sp<CountingInputListener> sink = new CountingInputListener();
+    sp<InputClassifier> classifier = new InputClassifier(sink);
+    sp<QueuedInputListener> queue = new QueuedInputListener(classifier);
+
+    const uint32_t pointerCount = state.range(0);
+    PointerProperties pointerProperties[MAX_POINTERS];
+    PointerCoords pointerCoords[MAX_POINTERS];
+    for (uint32_t i = 0; i < pointerCount; i++) {
+        pointerProperties[i].clear();
+        pointerProperties[i].id = i;
+        pointerProperties[i].toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+        pointerCoords[i].clear();
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, 100 + 50 * i);
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 200);
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 1);
+    }
+
+    uint32_t sequenceNum = 0;
+    nsecs_t eventTime = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < kEventsPerFlush; i++) {
+            eventTime += kSampleInterval;
+            NotifyMotionArgs args(++sequenceNum, eventTime, 1 /*deviceId*/,
+                    AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT, 0 /*policyFlags*/,
+                    AMOTION_EVENT_ACTION_MOVE, 0 /*actionButton*/, 0 /*flags*/,
+                    AMETA_NONE, 0 /*buttonState*/, MotionClassification::NONE,
+                    AMOTION_EVENT_EDGE_FLAG_NONE, 0 /*deviceTimestamp*/, pointerCount,
+                    pointerProperties, pointerCoords, 0 /*xPrecision*/, 0 /*yPrecision*/,
+                    0 /*downTime*/, {} /*videoFrames*/);
+            queue->notifyMotion(&args);
+        }
+        queue->flush();
+    }
+    state.SetItemsProcessed(sink->motionCount);
+}
+BENCHMARK(BM_QueuedMotionThroughClassifier)->Arg(1)->Arg(2)->Arg(10);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
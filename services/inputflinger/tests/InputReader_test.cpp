@@ -243,6 +243,10 @@ public:
         mConfig.pointerCapture = enabled;
     }
 
+    void setParallelDeviceProcessing(bool enabled) {
+        mConfig.parallelDeviceProcessing = enabled;
+    }
+
     void setShowTouches(bool enabled) {
         mConfig.showTouches = enabled;
     }
@@ -311,6 +315,7 @@ class FakeEventHub : public EventHubInterface {
         KeyedVector<int32_t, int32_t> scanCodeStates;
         KeyedVector<int32_t, int32_t> switchStates;
         KeyedVector<int32_t, int32_t> absoluteAxisValue;
+        std::unordered_map<int32_t, std::vector<int32_t>> mtSlotValues;
         KeyedVector<int32_t, KeyInfo> keysByScanCode;
         KeyedVector<int32_t, KeyInfo> keysByUsageCode;
         KeyedVector<int32_t, bool> leds;
@@ -335,6 +340,7 @@ class FakeEventHub : public EventHubInterface {
     KeyedVector<int32_t, Device*> mDevices;
     std::vector<std::string> mExcludedDevices;
     List<RawEvent> mEvents;
+    bool mReturnsAllEvents = false;
     std::unordered_map<int32_t /*deviceId*/, std::vector<TouchVideoFrame>> mVideoFrames;
 
 protected:
@@ -452,6 +458,11 @@ public:
         device->absoluteAxisValue.replaceValueFor(axis, value);
     }
 
+    void setMtSlotValues(int32_t deviceId, int32_t axis, const std::vector<int32_t>& values) {
+        Device* device = getDevice(deviceId);
+        device->mtSlotValues[axis] = values;
+    }
+
     void addKey(int32_t deviceId, int32_t scanCode, int32_t usageCode,
             int32_t keyCode, uint32_t flags) {
         Device* device = getDevice(deviceId);
@@ -500,6 +511,12 @@ public:
         }
     }
 
+    // Makes getEvents return every queued event at once, like a wakeup with several
+    // devices ready, instead of one at a time.
+    void setReturnsAllEvents(bool returnsAllEvents) {
+        mReturnsAllEvents = returnsAllEvents;
+    }
+
     void setVideoFrames(std::unordered_map<int32_t /*deviceId*/,
             std::vector<TouchVideoFrame>> videoFrames) {
         mVideoFrames = std::move(videoFrames);
@@ -609,14 +626,13 @@ private:
         mExcludedDevices = devices;
     }
 
-    virtual size_t getEvents(int, RawEvent* buffer, size_t) {
-        if (mEvents.empty()) {
-            return 0;
+    virtual size_t getEvents(int, RawEvent* buffer, size_t bufferSize) {
+        size_t count = 0;
+        while (!mEvents.empty() && count < (mReturnsAllEvents ? bufferSize : 1)) {
+            buffer[count++] = *mEvents.begin();
+            mEvents.erase(mEvents.begin());
         }
-
-        *buffer = *mEvents.begin();
-        mEvents.erase(mEvents.begin());
-        return 1;
+        return count;
     }
 
     virtual std::vector<TouchVideoFrame> getVideoFrames(int32_t deviceId) {
@@ -676,6 +692,21 @@ private:
         return -1;
     }
 
+    virtual status_t getMtSlotValues(int32_t deviceId, int32_t axis, size_t slotCount,
+            std::vector<int32_t>* outValues) const {
+        outValues->clear();
+        Device* device = getDevice(deviceId);
+        if (device) {
+            auto it = device->mtSlotValues.find(axis);
+            if (it != device->mtSlotValues.end()) {
+                *outValues = it->second;
+                outValues->resize(slotCount);
+                return OK;
+            }
+        }
+        return -1;
+    }
+
     virtual bool markSupportedKeyCodes(int32_t deviceId, size_t numCodes, const int32_t* keyCodes,
             uint8_t* outFlags) const {
         bool result = false;
@@ -1577,6 +1608,57 @@ TEST_F(InputReaderTest, Device_CanDispatchToDisplay) {
 }
 
 
+// --- InputReaderParallelTest ---
+
+class InputReaderParallelTest : public InputReaderTest {
+protected:
+    virtual void SetUp() {
+        InputReaderTest::SetUp();
+        mFakePolicy->setParallelDeviceProcessing(true);
+        mReader = new InstrumentedInputReader(mFakeEventHub, mFakePolicy, mFakeListener);
+    }
+};
+
+TEST_F(InputReaderParallelTest, LoopOnce_MergesDevicesOutputByEventTime) {
+    ASSERT_NO_FATAL_FAILURE(addDevice(1, "keyboard1", INPUT_DEVICE_CLASS_KEYBOARD, nullptr));
+    ASSERT_NO_FATAL_FAILURE(addDevice(2, "keyboard2", INPUT_DEVICE_CLASS_KEYBOARD, nullptr));
+    mFakeEventHub->addKey(1, KEY_A, 0, AKEYCODE_A, 0);
+    mFakeEventHub->addKey(2, KEY_B, 0, AKEYCODE_B, 0);
+
+    // Both devices' events come in one batch, the later key first.
+    mFakeEventHub->setReturnsAllEvents(true);
+    mFakeEventHub->enqueueEvent(ARBITRARY_TIME + 20, 1, EV_KEY, KEY_A, 1);
+    mFakeEventHub->enqueueEvent(ARBITRARY_TIME + 10, 2, EV_KEY, KEY_B, 1);
+    mReader->loopOnce();
+    ASSERT_NO_FATAL_FAILURE(mFakeEventHub->assertQueueIsEmpty());
+
+    NotifyKeyArgs args;
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasCalled(&args));
+    ASSERT_EQ(2, args.deviceId);
+    ASSERT_EQ(AKEYCODE_B, args.keyCode);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasCalled(&args));
+    ASSERT_EQ(1, args.deviceId);
+    ASSERT_EQ(AKEYCODE_A, args.keyCode);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasNotCalled());
+}
+
+TEST_F(InputReaderParallelTest, LoopOnce_FromOneDevice_KeepsItsOrder) {
+    ASSERT_NO_FATAL_FAILURE(addDevice(1, "keyboard", INPUT_DEVICE_CLASS_KEYBOARD, nullptr));
+    mFakeEventHub->addKey(1, KEY_A, 0, AKEYCODE_A, 0);
+
+    mFakeEventHub->setReturnsAllEvents(true);
+    mFakeEventHub->enqueueEvent(ARBITRARY_TIME, 1, EV_KEY, KEY_A, 1);
+    mFakeEventHub->enqueueEvent(ARBITRARY_TIME + 10, 1, EV_KEY, KEY_A, 0);
+    mReader->loopOnce();
+
+    NotifyKeyArgs args;
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasCalled(&args));
+    ASSERT_EQ(AKEY_EVENT_ACTION_DOWN, args.action);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasCalled(&args));
+    ASSERT_EQ(AKEY_EVENT_ACTION_UP, args.action);
+}
+
+
 // --- InputDeviceTest ---
 
 class InputDeviceTest : public testing::Test {
@@ -6248,6 +6330,33 @@ TEST_F(MultiTouchInputMapperTest, WhenMapperIsReset_TimestampIsCleared) {
     ASSERT_EQ(0U, args.deviceTimestamp);
 }
 
+TEST_F(MultiTouchInputMapperTest, WhenMapperIsReset_SlotsAreReadFromTheDriver) {
+    MultiTouchInputMapper* mapper = new MultiTouchInputMapper(mDevice);
+
+    addConfigurationProperty("touch.deviceType", "touchScreen");
+    prepareDisplay(DISPLAY_ORIENTATION_0);
+    prepareAxes(POSITION | ID | SLOT);
+    addMapperAndConfigure(mapper);
+    NotifyMotionArgs args;
+
+    // A finger is down in slot 1 when the events that put it there are lost, e.g. to an
+    // evdev buffer overrun.
+    mFakeEventHub->setMtSlotValues(DEVICE_ID, ABS_MT_TRACKING_ID, {-1, 7});
+    mFakeEventHub->setMtSlotValues(DEVICE_ID, ABS_MT_POSITION_X, {0, 100});
+    mFakeEventHub->setMtSlotValues(DEVICE_ID, ABS_MT_POSITION_Y, {0, 200});
+    mFakeEventHub->setAbsoluteAxisValue(DEVICE_ID, ABS_MT_SLOT, 1);
+    mapper->reset(ARBITRARY_TIME);
+
+    // The next frame only moves it horizontally, its y comes from the driver.
+    process(mapper, ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_X, 110);
+    processSync(mapper);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&args));
+    ASSERT_EQ(AMOTION_EVENT_ACTION_DOWN, args.action);
+    ASSERT_EQ(size_t(1), args.pointerCount);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(args.pointerCoords[0],
+            toDisplayX(110), toDisplayY(200), 1, 0, 0, 0, 0, 0, 0, 0));
+}
+
 /**
  * Set the input device port <--> display port associations, and check that the
  * events are routed to the display that matches the display port.
@@ -55,7 +55,7 @@ CorrectedGyroSensor::CorrectedGyroSensor(sensor_t const* list, size_t count)
 bool CorrectedGyroSensor::process(sensors_event_t* outEvent,
         const sensors_event_t& event)
 {
-    if (event.type == SENSOR_TYPE_GYROSCOPE) {
+    if (event.type == SENSOR_TYPE_GYROSCOPE && isOutputDue(event.timestamp)) {
         const vec3_t bias(mSensorFusion.getGyroBias());
         *outEvent = event;
         outEvent->data[0] -= bias.x;
@@ -68,11 +68,13 @@ bool CorrectedGyroSensor::process(sensors_event_t* outEvent,
 }
 
 status_t CorrectedGyroSensor::activate(void* ident, bool enabled) {
+    if (!enabled) clearSamplingPeriod(ident);
     mSensorDevice.activate(ident, mGyro.getHandle(), enabled);
     return mSensorFusion.activate(FUSION_9AXIS, ident, enabled);
 }
 
 status_t CorrectedGyroSensor::setDelay(void* ident, int /*handle*/, int64_t ns) {
+    setSamplingPeriod(ident, ns);
     mSensorDevice.setDelay(ident, mGyro.getHandle(), ns);
     return mSensorFusion.setDelay(FUSION_9AXIS, ident, ns);
 }
@@ -487,7 +487,17 @@ void Fusion::predict(const vec3_t& w, float dT) {
     if (x0.w < 0)
         x0 = -x0;
 
-    P = Phi*P*transpose(Phi) + GQGt;
+    // P = Phi*P*transpose(Phi) + GQGt, using the structure of Phi (its lower
+    // blocks are 0 and I33) to skip half of the 3x3 products.
+    const mat33_t Phi00t(transpose(Phi[0][0]));
+    const mat33_t Phi10t(transpose(Phi[1][0]));
+    const mat33_t PhiP00(Phi[0][0]*P[0][0] + Phi[1][0]*P[0][1]);
+    const mat33_t PhiP10(Phi[0][0]*P[1][0] + Phi[1][0]*P[1][1]);
+    const mat33_t PPhit01(P[0][1]*Phi00t + P[1][1]*Phi10t);
+    P[0][0] = PhiP00*Phi00t + PhiP10*Phi10t + GQGt[0][0];
+    P[1][0] = PhiP10 + GQGt[1][0];
+    P[0][1] = PPhit01 + GQGt[0][1];
+    P[1][1] += GQGt[1][1];
 
     checkState();
 }
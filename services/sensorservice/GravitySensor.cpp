@@ -56,7 +56,7 @@ bool GravitySensor::process(sensors_event_t* outEvent,
 {
     if (event.type == SENSOR_TYPE_ACCELEROMETER) {
         vec3_t g;
-        if (!mSensorFusion.hasEstimate(FUSION_NOMAG))
+        if (!mSensorFusion.hasEstimate(FUSION_NOMAG) || !isOutputDue(event.timestamp))
             return false;
         const mat33_t R(mSensorFusion.getRotationMatrix(FUSION_NOMAG));
         // FIXME: we need to estimate the length of gravity because
@@ -76,10 +76,12 @@ bool GravitySensor::process(sensors_event_t* outEvent,
 }
 
 status_t GravitySensor::activate(void* ident, bool enabled) {
+    if (!enabled) clearSamplingPeriod(ident);
     return mSensorFusion.activate(FUSION_NOMAG, ident, enabled);
 }
 
 status_t GravitySensor::setDelay(void* ident, int /*handle*/, int64_t ns) {
+    setSamplingPeriod(ident, ns);
     return mSensorFusion.setDelay(FUSION_NOMAG, ident, ns);
 }
 
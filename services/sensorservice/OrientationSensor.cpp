@@ -48,7 +48,7 @@ bool OrientationSensor::process(sensors_event_t* outEvent,
         const sensors_event_t& event)
 {
     if (event.type == SENSOR_TYPE_ACCELEROMETER) {
-        if (mSensorFusion.hasEstimate()) {
+        if (mSensorFusion.hasEstimate() && isOutputDue(event.timestamp)) {
             vec3_t g;
             const float rad2deg = 180 / M_PI;
             const mat33_t R(mSensorFusion.getRotationMatrix());
@@ -72,10 +72,12 @@ bool OrientationSensor::process(sensors_event_t* outEvent,
 }
 
 status_t OrientationSensor::activate(void* ident, bool enabled) {
+    if (!enabled) clearSamplingPeriod(ident);
     return mSensorFusion.activate(FUSION_9AXIS, ident, enabled);
 }
 
 status_t OrientationSensor::setDelay(void* ident, int /*handle*/, int64_t ns) {
+    setSamplingPeriod(ident, ns);
     return mSensorFusion.setDelay(FUSION_9AXIS, ident, ns);
 }
 
@@ -43,6 +43,12 @@ void RecentEventLogger::addEvent(const sensors_event_t& event) {
     mIsLastEventCurrent = true;
 }
 
+void RecentEventLogger::addEvent(const sensors_event_t& event, const timespec& wallTime) {
+    std::lock_guard<std::mutex> lk(mLock);
+    mRecentEvents.emplace(event, wallTime);
+    mIsLastEventCurrent = true;
+}
+
 bool RecentEventLogger::isEmpty() const {
     return mRecentEvents.size() == 0;
 }
@@ -122,5 +128,9 @@ RecentEventLogger::SensorEventLog::SensorEventLog(const sensors_event_t& e) : mE
     clock_gettime(CLOCK_REALTIME, &mWallTime);
 }
 
+RecentEventLogger::SensorEventLog::SensorEventLog(const sensors_event_t& e,
+        const timespec& wallTime) : mWallTime(wallTime), mEvent(e) {
+}
+
 } // namespace SensorServiceUtil
 } // namespace android
@@ -37,6 +37,9 @@ class RecentEventLogger : public Dumpable {
 public:
     explicit RecentEventLogger(int sensorType);
     void addEvent(const sensors_event_t& event);
+    // Like addEvent, with the wall time already read by the caller, so that a batch of events
+    // needs a single clock read.
+    void addEvent(const sensors_event_t& event, const timespec& wallTime);
 
     // Populate event with the last recorded sensor event if it is not stale. An event is
     // considered stale if the sensor has become deactivated since the event was recorded.
@@ -53,6 +56,7 @@ public:
 protected:
     struct SensorEventLog {
         explicit SensorEventLog(const sensors_event_t& e);
+        SensorEventLog(const sensors_event_t& e, const timespec& wallTime);
         timespec mWallTime;
         sensors_event_t mEvent;
     };
@@ -47,7 +47,7 @@ bool RotationVectorSensor::process(sensors_event_t* outEvent,
         const sensors_event_t& event)
 {
     if (event.type == SENSOR_TYPE_ACCELEROMETER) {
-        if (mSensorFusion.hasEstimate(mMode)) {
+        if (mSensorFusion.hasEstimate(mMode) && isOutputDue(event.timestamp)) {
             const vec4_t q(mSensorFusion.getAttitude(mMode));
             *outEvent = event;
             outEvent->data[0] = q.x;
@@ -63,10 +63,12 @@ bool RotationVectorSensor::process(sensors_event_t* outEvent,
 }
 
 status_t RotationVectorSensor::activate(void* ident, bool enabled) {
+    if (!enabled) clearSamplingPeriod(ident);
     return mSensorFusion.activate(mMode, ident, enabled);
 }
 
 status_t RotationVectorSensor::setDelay(void* ident, int /*handle*/, int64_t ns) {
+    setSamplingPeriod(ident, ns);
     return mSensorFusion.setDelay(mMode, ident, ns);
 }
 
@@ -133,7 +135,7 @@ bool GyroDriftSensor::process(sensors_event_t* outEvent,
         const sensors_event_t& event)
 {
     if (event.type == SENSOR_TYPE_ACCELEROMETER) {
-        if (mSensorFusion.hasEstimate()) {
+        if (mSensorFusion.hasEstimate() && isOutputDue(event.timestamp)) {
             const vec3_t b(mSensorFusion.getGyroBias());
             *outEvent = event;
             outEvent->data[0] = b.x;
@@ -148,10 +150,12 @@ bool GyroDriftSensor::process(sensors_event_t* outEvent,
 }
 
 status_t GyroDriftSensor::activate(void* ident, bool enabled) {
+    if (!enabled) clearSamplingPeriod(ident);
     return mSensorFusion.activate(FUSION_9AXIS, ident, enabled);
 }
 
 status_t GyroDriftSensor::setDelay(void* ident, int /*handle*/, int64_t ns) {
+    setSamplingPeriod(ident, ns);
     return mSensorFusion.setDelay(FUSION_9AXIS, ident, ns);
 }
 
@@ -481,17 +481,26 @@ ssize_t SensorDevice::pollFmq(sensors_event_t* buffer, size_t maxNumEventsToRead
         }
     }
 
-    size_t eventsToRead = std::min({availableEvents, maxNumEventsToRead, mEventBuffer.size()});
+    size_t eventsToRead = std::min(availableEvents, maxNumEventsToRead);
     if (eventsToRead > 0) {
-        if (mEventQueue->read(mEventBuffer.data(), eventsToRead)) {
+        // Convert the events straight out of the FMQ's shared memory into the caller's buffer,
+        // rather than copying them out with read() first. The events may wrap around the end of
+        // the queue, in which case the transaction has a second region.
+        EventMessageQueue::MemTransaction tx;
+        if (mEventQueue->beginRead(eventsToRead, &tx)) {
+            const EventMessageQueue::MemRegion regions[] = {
+                    tx.getFirstRegion(), tx.getSecondRegion()};
+            for (const auto& region : regions) {
+                const Event* events = region.getAddress();
+                for (size_t i = 0; i < region.getLength(); i++) {
+                    convertToSensorEvent(events[i], &buffer[eventsRead++]);
+                }
+            }
+            mEventQueue->commitRead(eventsToRead);
+
             // Notify the Sensors HAL that sensor events have been read. This is required to support
             // the use of writeBlocking by the Sensors HAL.
             mEventQueueFlag->wake(asBaseType(EventQueueFlagBits::EVENTS_READ));
-
-            for (size_t i = 0; i < eventsToRead; i++) {
-                convertToSensorEvent(mEventBuffer[i], &buffer[i]);
-            }
-            eventsRead = eventsToRead;
         } else {
             ALOGW("Failed to read %zu events, currently %zu events available",
                     eventsToRead, availableEvents);
@@ -125,18 +125,29 @@ int32_t SensorService::SensorDirectConnection::configureChannel(int handle, int
     };
 
     Mutex::Autolock _l(mConnectionLock);
+    if (rateLevel != SENSOR_DIRECT_RATE_STOP) {
+        auto activated = mActivated.find(handle);
+        auto token = mReportTokens.find(handle);
+        if (activated != mActivated.end() && activated->second == rateLevel
+                && token != mReportTokens.end()) {
+            return token->second;
+        }
+    }
+
     SensorDevice& dev(SensorDevice::getInstance());
     int ret = dev.configureDirectChannel(handle, getHalChannelHandle(), &config);
 
     if (rateLevel == SENSOR_DIRECT_RATE_STOP) {
         if (ret == NO_ERROR) {
             mActivated.erase(handle);
+            mReportTokens.erase(handle);
         } else if (ret > 0) {
             ret = UNKNOWN_ERROR;
         }
     } else {
         if (ret > 0) {
             mActivated[handle] = rateLevel;
+            mReportTokens[handle] = ret;
         }
     }
 
@@ -159,6 +170,7 @@ void SensorService::SensorDirectConnection::stopAll(bool backupRecord) {
         mActivatedBackup = mActivated;
     }
     mActivated.clear();
+    mReportTokens.clear();
 }
 
 void SensorService::SensorDirectConnection::recoverAll() {
@@ -176,7 +188,10 @@ void SensorService::SensorDirectConnection::recoverAll() {
         struct sensors_direct_cfg_t config = {
             .rate_level = i.second
         };
-        dev.configureDirectChannel(i.first, getHalChannelHandle(), &config);
+        int ret = dev.configureDirectChannel(i.first, getHalChannelHandle(), &config);
+        if (ret > 0) {
+            mReportTokens[i.first] = ret;
+        }
     }
 }
 
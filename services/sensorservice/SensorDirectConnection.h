@@ -74,6 +74,9 @@ private:
     mutable Mutex mConnectionLock;
     std::unordered_map<int, int> mActivated;
     std::unordered_map<int, int> mActivatedBackup;
+    // Report token the HAL returned for each sensor in mActivated, so that configuring a sensor
+    // again at the rate it already runs at doesn't need to go through the HAL.
+    std::unordered_map<int, int32_t> mReportTokens;
 
     mutable Mutex mDestroyLock;
     bool mDestroyed;
@@ -32,7 +32,9 @@ SensorService::SensorEventConnection::SensorEventConnection(
         const String16& opPackageName, bool hasSensorAccess)
     : mService(service), mUid(uid), mWakeLockRefCount(0), mHasLooperCallbacks(false),
       mDead(false), mDataInjectionMode(isDataInjectionMode), mEventCache(nullptr),
-      mCacheSize(0), mMaxCacheSize(0), mTimeOfLastEventDrop(0), mEventsDropped(0),
+      mCacheStart(0), mCacheSize(0), mMaxCacheSize(0), mCacheSizeLimit(-1),
+      mCacheHighWater(0), mCacheAllocations(0), mTotalEventsDropped(0), mTimeOfLastEventDrop(0),
+      mEventsDropped(0),
       mPackageName(packageName), mOpPackageName(opPackageName), mDestroyed(false),
       mHasSensorAccess(hasSensorAccess) {
     mChannel = new BitTube(mService->mSocketBufferSize);
@@ -89,6 +91,8 @@ void SensorService::SensorEventConnection::dump(String8& result) {
     result.appendFormat("\t %s | WakeLockRefCount %d | uid %d | cache size %d | "
             "max cache size %d\n", mPackageName.string(), mWakeLockRefCount, mUid, mCacheSize,
             mMaxCacheSize);
+    result.appendFormat("\t cache high water %d | cache allocations %d | events dropped %d\n",
+            mCacheHighWater, mCacheAllocations, mTotalEventsDropped);
     for (size_t i = 0; i < mSensorInfo.size(); ++i) {
         const FlushInfo& flushInfo = mSensorInfo.valueAt(i);
         result.appendFormat("\t %s 0x%08x | status: %s | pending flush events %d \n",
@@ -119,12 +123,14 @@ bool SensorService::SensorEventConnection::addSensor(int32_t handle) {
         return false;
     }
     mSensorInfo.add(handle, FlushInfo());
+    mCacheSizeLimit = -1;
     return true;
 }
 
 bool SensorService::SensorEventConnection::removeSensor(int32_t handle) {
     Mutex::Autolock _l(mConnectionLock);
     if (mSensorInfo.removeItem(handle) >= 0) {
+        mCacheSizeLimit = -1;
         return true;
     }
     return false;
@@ -235,8 +241,17 @@ status_t SensorService::SensorEventConnection::sendEvents(
     std::unique_ptr<sensors_event_t[]> sanitizedBuffer;
 
     int count = 0;
+    // Set when scratch points at the caller's buffer, which other connections
+    // still have to read.
+    bool sharedBuffer = false;
+    sensors_event_t* const scratchBuffer = scratch;
     Mutex::Autolock _l(mConnectionLock);
-    if (scratch) {
+    if (scratch && canSendEventsUnfilteredLocked(buffer, numEvents)) {
+        // Every event is for this connection, so send them without copying.
+        scratch = const_cast<sensors_event_t *>(buffer);
+        count = numEvents;
+        sharedBuffer = true;
+    } else if (scratch) {
         size_t i=0;
         while (i<numEvents) {
             int32_t sensor_handle = buffer[i].sensor;
@@ -331,6 +346,11 @@ status_t SensorService::SensorEventConnection::sendEvents(
     int index_wake_up_event = -1;
     if (hasSensorAccess()) {
         index_wake_up_event = findWakeUpSensorEventLocked(scratch, count);
+        if (index_wake_up_event >= 0 && sharedBuffer) {
+            // The ack flag must only be set in this connection's copy.
+            memcpy(scratchBuffer, scratch, count * sizeof(sensors_event_t));
+            scratch = scratchBuffer;
+        }
         if (index_wake_up_event >= 0) {
             scratch[index_wake_up_event].flags |= WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
             ++mWakeLockRefCount;
@@ -356,8 +376,10 @@ status_t SensorService::SensorEventConnection::sendEvents(
 #endif
         }
         if (mEventCache == nullptr) {
-            mMaxCacheSize = computeMaxCacheSizeLocked();
+            mMaxCacheSize = cacheSizeLimitLocked();
             mEventCache = new sensors_event_t[mMaxCacheSize];
+            ++mCacheAllocations;
+            mCacheStart = 0;
             mCacheSize = 0;
         }
         // Save the events so that they can be written later
@@ -387,6 +409,27 @@ bool SensorService::SensorEventConnection::hasSensorAccess() {
     return mHasSensorAccess && !mService->mSensorPrivacyPolicy->isSensorPrivacyEnabled();
 }
 
+bool SensorService::SensorEventConnection::canSendEventsUnfilteredLocked(
+        sensors_event_t const* buffer, size_t numEvents) {
+    if (!hasSensorAccess()) {
+        return false;
+    }
+    for (size_t i = 0; i < numEvents; i++) {
+        // Flush complete events are only sent to the connection that asked for them.
+        if (buffer[i].type == SENSOR_TYPE_META_DATA) {
+            return false;
+        }
+        ssize_t index = mSensorInfo.indexOfKey(buffer[i].sensor);
+        if (index < 0 || mSensorInfo.valueAt(index).mFirstFlushPending) {
+            return false;
+        }
+        if (mHandleToAppOp.find(buffer[i].sensor) != mHandleToAppOp.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool SensorService::SensorEventConnection::noteOpIfRequired(const sensors_event_t& event) {
     bool success = true;
     const auto iter = mHandleToAppOp.find(event.sensor);
@@ -400,10 +443,13 @@ bool SensorService::SensorEventConnection::noteOpIfRequired(const sensors_event_
 void SensorService::SensorEventConnection::reAllocateCacheLocked(sensors_event_t const* scratch,
                                                                  int count) {
     sensors_event_t *eventCache_new;
-    const int new_cache_size = computeMaxCacheSizeLocked();
+    const int new_cache_size = cacheSizeLimitLocked();
     // Allocate new cache, copy over events from the old cache & scratch, free up memory.
     eventCache_new = new sensors_event_t[new_cache_size];
-    memcpy(eventCache_new, mEventCache, mCacheSize * sizeof(sensors_event_t));
+    const int firstPart = std::min(mCacheSize, mMaxCacheSize - mCacheStart);
+    memcpy(eventCache_new, &mEventCache[mCacheStart], firstPart * sizeof(sensors_event_t));
+    memcpy(&eventCache_new[firstPart], mEventCache,
+            (mCacheSize - firstPart) * sizeof(sensors_event_t));
     memcpy(&eventCache_new[mCacheSize], scratch, count * sizeof(sensors_event_t));
 
     ALOGD_IF(DEBUG_CONNECTIONS, "reAllocateCacheLocked maxCacheSize=%d %d", mMaxCacheSize,
@@ -411,8 +457,38 @@ void SensorService::SensorEventConnection::reAllocateCacheLocked(sensors_event_t
 
     delete[] mEventCache;
     mEventCache = eventCache_new;
+    mCacheStart = 0;
     mCacheSize += count;
     mMaxCacheSize = new_cache_size;
+    mCacheHighWater = std::max(mCacheHighWater, mCacheSize);
+    ++mCacheAllocations;
+}
+
+int SensorService::SensorEventConnection::cacheSizeLimitLocked() {
+    if (mCacheSizeLimit < 0) {
+        mCacheSizeLimit = computeMaxCacheSizeLocked();
+    }
+    return mCacheSizeLimit;
+}
+
+void SensorService::SensorEventConnection::copyToCacheLocked(sensors_event_t const* events,
+                                                             int count) {
+    const int end = (mCacheStart + mCacheSize) % mMaxCacheSize;
+    const int firstPart = std::min(count, mMaxCacheSize - end);
+    memcpy(&mEventCache[end], events, firstPart * sizeof(sensors_event_t));
+    memcpy(mEventCache, &events[firstPart], (count - firstPart) * sizeof(sensors_event_t));
+    mCacheSize += count;
+    mCacheHighWater = std::max(mCacheHighWater, mCacheSize);
+}
+
+void SensorService::SensorEventConnection::dropFromCacheLocked(int count) {
+    // Count flush complete events in the oldest events, which may wrap around the end of the
+    // cache.
+    const int firstPart = std::min(count, mMaxCacheSize - mCacheStart);
+    countFlushCompleteEventsLocked(&mEventCache[mCacheStart], firstPart);
+    countFlushCompleteEventsLocked(mEventCache, count - firstPart);
+    mCacheStart = (mCacheStart + count) % mMaxCacheSize;
+    mCacheSize -= count;
 }
 
 void SensorService::SensorEventConnection::appendEventsToCacheLocked(sensors_event_t const* events,
@@ -421,9 +497,8 @@ void SensorService::SensorEventConnection::appendEventsToCacheLocked(sensors_eve
         return;
     } else if (mCacheSize + count <= mMaxCacheSize) {
         // The events fit within the current cache: add them
-        memcpy(&mEventCache[mCacheSize], events, count * sizeof(sensors_event_t));
-        mCacheSize += count;
-    } else if (mCacheSize + count <= computeMaxCacheSizeLocked()) {
+        copyToCacheLocked(events, count);
+    } else if (mCacheSize + count <= cacheSizeLimitLocked()) {
         // The events fit within a resized cache: resize the cache and add the events
         reAllocateCacheLocked(events, count);
     } else {
@@ -438,6 +513,7 @@ void SensorService::SensorEventConnection::appendEventsToCacheLocked(sensors_eve
 
         // Determine the number of new events to copy into the cache
         int eventsToCopy = std::min(mMaxCacheSize, count);
+        mTotalEventsDropped += cachedEventsToDrop + newEventsToDrop;
 
         constexpr nsecs_t kMinimumTimeBetweenDropLogNs = 2 * 1000 * 1000 * 1000; // 2 sec
         if (events[0].timestamp - mTimeOfLastEventDrop > kMinimumTimeBetweenDropLogNs) {
@@ -451,21 +527,14 @@ void SensorService::SensorEventConnection::appendEventsToCacheLocked(sensors_eve
             mEventsDropped += cachedEventsToDrop + newEventsToDrop;
         }
 
-        // Check for any flush complete events in the events that will be dropped
-        countFlushCompleteEventsLocked(mEventCache, cachedEventsToDrop);
+        // Check for any flush complete events in the events that will be dropped. Dropping
+        // only moves the start of the cache, so a client that has stopped reading costs the
+        // polling thread no more than the new events it is sent.
+        dropFromCacheLocked(cachedEventsToDrop);
         countFlushCompleteEventsLocked(events, newEventsToDrop);
 
-        // Only shift the events if they will not all be overwritten
-        if (eventsToCopy != mMaxCacheSize) {
-            memmove(mEventCache, &mEventCache[cachedEventsToDrop],
-                    (mCacheSize - cachedEventsToDrop) * sizeof(sensors_event_t));
-        }
-        mCacheSize -= cachedEventsToDrop;
-
         // Copy the events into the cache
-        memcpy(&mEventCache[mCacheSize], &events[newEventsToDrop],
-                eventsToCopy * sizeof(sensors_event_t));
-        mCacheSize += eventsToCopy;
+        copyToCacheLocked(&events[newEventsToDrop], eventsToCopy);
     }
 }
 
@@ -510,15 +579,16 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
     Mutex::Autolock _l(mConnectionLock);
     // Send pending flush complete events (if any)
     sendPendingFlushEventsLocked();
-    for (int numEventsSent = 0; numEventsSent < mCacheSize;) {
-        const int numEventsToWrite = helpers::min(mCacheSize - numEventsSent, maxWriteSize);
+    while (mCacheSize > 0) {
+        // Write from the start of the cache up to its end, where the events may wrap around.
+        const int numEventsToWrite = helpers::min(helpers::min(mCacheSize, maxWriteSize),
+                                                  mMaxCacheSize - mCacheStart);
+        sensors_event_t* const events = &mEventCache[mCacheStart];
         int index_wake_up_event = -1;
         if (hasSensorAccess()) {
-            index_wake_up_event =
-                      findWakeUpSensorEventLocked(mEventCache + numEventsSent, numEventsToWrite);
+            index_wake_up_event = findWakeUpSensorEventLocked(events, numEventsToWrite);
             if (index_wake_up_event >= 0) {
-                mEventCache[index_wake_up_event + numEventsSent].flags |=
-                        WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
+                events[index_wake_up_event].flags |= WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 ++mWakeLockRefCount;
 #if DEBUG_CONNECTIONS
                 ++mTotalAcksNeeded;
@@ -527,13 +597,11 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
         }
 
         ssize_t size = SensorEventQueue::write(mChannel,
-                          reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
-                          numEventsToWrite);
+                          reinterpret_cast<ASensorEvent const*>(events), numEventsToWrite);
         if (size < 0) {
             if (index_wake_up_event >= 0) {
                 // If there was a wake_up sensor_event, reset the flag.
-                mEventCache[index_wake_up_event + numEventsSent].flags  &=
-                        ~WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
+                events[index_wake_up_event].flags &= ~WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 if (mWakeLockRefCount > 0) {
                     --mWakeLockRefCount;
                 }
@@ -541,21 +609,18 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
                 --mTotalAcksNeeded;
 #endif
             }
-            memmove(mEventCache, &mEventCache[numEventsSent],
-                                 (mCacheSize - numEventsSent) * sizeof(sensors_event_t));
-            ALOGD_IF(DEBUG_CONNECTIONS, "wrote %d events from cache size==%d ",
-                    numEventsSent, mCacheSize);
-            mCacheSize -= numEventsSent;
+            ALOGD_IF(DEBUG_CONNECTIONS, "%d events left in cache", mCacheSize);
             return;
         }
-        numEventsSent += numEventsToWrite;
+        mCacheStart = (mCacheStart + numEventsToWrite) % mMaxCacheSize;
+        mCacheSize -= numEventsToWrite;
 #if DEBUG_CONNECTIONS
         mEventsSentFromCache += numEventsToWrite;
 #endif
     }
     ALOGD_IF(DEBUG_CONNECTIONS, "wrote all events from cache size=%d ", mCacheSize);
-    // All events from the cache have been sent. Reset cache size to zero.
-    mCacheSize = 0;
+    // All events from the cache have been sent.
+    mCacheStart = 0;
     // There are no more events in the cache. We don't need to poll for write on the fd.
     // Update Looper registration.
     updateLooperRegistrationLocked(mService->getLooper());
@@ -105,10 +105,21 @@ private:
     // amongst wake-up sensors and non-wake up sensors.
     int computeMaxCacheSizeLocked() const;
 
+    // Returns computeMaxCacheSizeLocked, computed again only after the sensors of this connection
+    // change, since the polling thread checks it whenever the cache is full.
+    int cacheSizeLimitLocked();
+
     // When more sensors register, the maximum cache size desired may change.  Compute max cache
     // size, reallocate memory and copy over events from the older cache.
     void reAllocateCacheLocked(sensors_event_t const* scratch, int count);
 
+    // Copies count events to the end of mEventCache, which must have room for them.
+    void copyToCacheLocked(sensors_event_t const* events, int count);
+
+    // Drops the count oldest events from mEventCache, keeping track of the flush complete events
+    // among them.
+    void dropFromCacheLocked(int count);
+
     // Add the events to the cache. If the cache would be exceeded, drop events at the beginning of
     // the cache.
     void appendEventsToCacheLocked(sensors_event_t const* events, int count);
@@ -138,6 +149,10 @@ private:
     // Call noteOp for the sensor if the sensor requires a permission
     bool noteOpIfRequired(const sensors_event_t& event);
 
+    // Returns whether every event in buffer would pass the filtering in sendEvents unchanged, so
+    // that buffer can be sent as it is instead of being copied to the scratch buffer.
+    bool canSendEventsUnfilteredLocked(sensors_event_t const* buffer, size_t numEvents);
+
     sp<SensorService> const mService;
     sp<BitTube> mChannel;
     uid_t mUid;
@@ -171,8 +186,15 @@ private:
     // protected by SensorService::mLock. Key for this vector is the sensor handle.
     KeyedVector<int, FlushInfo> mSensorInfo;
 
+    // mEventCache is a ring of mMaxCacheSize events. The mCacheSize oldest unsent events start at
+    // mCacheStart.
     sensors_event_t *mEventCache;
-    int mCacheSize, mMaxCacheSize;
+    int mCacheStart, mCacheSize, mMaxCacheSize;
+    // Cached result of computeMaxCacheSizeLocked, or -1 once it needs computing again.
+    int mCacheSizeLimit;
+    // For dumpsys: the most events ever cached, how many times the cache was allocated, and how
+    // many events were dropped because it was full.
+    int mCacheHighWater, mCacheAllocations, mTotalEventsDropped;
     int64_t mTimeOfLastEventDrop;
     int mEventsDropped;
     String8 mPackageName;
@@ -21,6 +21,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <algorithm>
+
 namespace android {
 // ---------------------------------------------------------------------------
 
@@ -84,5 +86,37 @@ VirtualSensor::VirtualSensor() :
         BaseSensor(DUMMY_SENSOR), mSensorFusion(SensorFusion::getInstance()) {
 }
 
+void VirtualSensor::setSamplingPeriod(void* ident, int64_t ns) {
+    std::lock_guard<std::mutex> lock(mSamplingPeriodsLock);
+    mSamplingPeriods[ident] = ns > 0 ? ns : 0;
+    updateMinSamplingPeriodLocked();
+}
+
+void VirtualSensor::clearSamplingPeriod(void* ident) {
+    std::lock_guard<std::mutex> lock(mSamplingPeriodsLock);
+    mSamplingPeriods.erase(ident);
+    updateMinSamplingPeriodLocked();
+}
+
+void VirtualSensor::updateMinSamplingPeriodLocked() {
+    int64_t minPeriod = mSamplingPeriods.empty() ? 0 : INT64_MAX;
+    for (const auto& period : mSamplingPeriods) {
+        minPeriod = std::min(minPeriod, period.second);
+    }
+    mMinSamplingPeriodNs = minPeriod;
+}
+
+bool VirtualSensor::isOutputDue(int64_t timestamp) {
+    const int64_t period = mMinSamplingPeriodNs;
+    // Allow for jitter in the input timestamps, so that an input running at
+    // exactly the requested rate isn't halved.
+    if (period > 0 && timestamp >= mLastOutputTimestamp &&
+            timestamp - mLastOutputTimestamp < period - period / 10) {
+        return false;
+    }
+    mLastOutputTimestamp = timestamp;
+    return true;
+}
+
 // ---------------------------------------------------------------------------
 }; // namespace android
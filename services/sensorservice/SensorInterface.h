@@ -20,6 +20,10 @@
 #include <sensor/Sensor.h>
 #include <utils/RefBase.h>
 
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
 // ---------------------------------------------------------------------------
 
 namespace android {
@@ -97,7 +101,29 @@ public:
     VirtualSensor();
     virtual bool isVirtual() const override { return true; }
 protected:
+    // Record the sampling period ident asked for, or forget it once ident
+    // disables the sensor. The fastest period among the clients decides how
+    // often the sensor needs an output.
+    void setSamplingPeriod(void* ident, int64_t ns);
+    void clearSamplingPeriod(void* ident);
+
+    // Returns whether an output with this timestamp is due for any client.
+    // The fused inputs may arrive much faster than every client asked for,
+    // e.g. when another app runs the accelerometer at 400Hz, so process()
+    // calls this before computing an output and skips it when it isn't
+    // due. Only called from process().
+    bool isOutputDue(int64_t timestamp);
+
     SensorFusion& mSensorFusion;
+
+private:
+    void updateMinSamplingPeriodLocked();
+
+    std::mutex mSamplingPeriodsLock;
+    std::unordered_map<void*, int64_t> mSamplingPeriods;
+    // 0 when some client wants every output
+    std::atomic<int64_t> mMinSamplingPeriodNs{0};
+    int64_t mLastOutputTimestamp = 0;
 };
 
 
@@ -962,6 +962,14 @@ bool SensorService::SensorEventAckReceiver::threadLoop() {
 
 void SensorService::recordLastValueLocked(
         const sensors_event_t* buffer, size_t count) {
+    // The events of a batch were all read at once, so they share one wall time. Batches usually
+    // hold runs of events from the same sensor, so the logger is only looked up again when the
+    // sensor changes.
+    timespec wallTime;
+    clock_gettime(CLOCK_REALTIME, &wallTime);
+    bool lookedUp = false;
+    int32_t lastHandle = 0;
+    SensorServiceUtil::RecentEventLogger* logger = nullptr;
     for (size_t i = 0; i < count; i++) {
         if (buffer[i].type == SENSOR_TYPE_META_DATA ||
             buffer[i].type == SENSOR_TYPE_DYNAMIC_SENSOR_META ||
@@ -969,9 +977,14 @@ void SensorService::recordLastValueLocked(
             continue;
         }
 
-        auto logger = mRecentEvent.find(buffer[i].sensor);
-        if (logger != mRecentEvent.end()) {
-            logger->second->addEvent(buffer[i]);
+        if (!lookedUp || buffer[i].sensor != lastHandle) {
+            lookedUp = true;
+            lastHandle = buffer[i].sensor;
+            auto entry = mRecentEvent.find(lastHandle);
+            logger = entry != mRecentEvent.end() ? entry->second : nullptr;
+        }
+        if (logger != nullptr) {
+            logger->addEvent(buffer[i], wallTime);
         }
     }
 }
@@ -103,6 +103,7 @@ public:
     void notifyAvailableFrames() override;
 
     bool hasReadyFrame() const override;
+    bool isReadyFrameSignaled() const override { return fenceHasSignaled(); }
 
     // Returns the current scaling mode, unless mOverrideScalingMode
     // is set, in which case, it returns mOverrideScalingMode
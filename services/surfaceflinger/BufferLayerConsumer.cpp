@@ -498,6 +498,11 @@ void BufferLayerConsumer::addAndGetFrameTimestamps(const NewFrameEventsEntry* ne
     }
 }
 
+sp<IMemory> BufferLayerConsumer::getFrameTimestampsMemory() {
+    sp<Layer> l = mLayer.promote();
+    return l.get() ? l->getFrameTimestampsMemory() : nullptr;
+}
+
 void BufferLayerConsumer::abandonLocked() {
     BLC_LOGV("abandonLocked");
     mCurrentTextureBuffer = nullptr;
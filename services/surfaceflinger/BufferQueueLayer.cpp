@@ -192,6 +192,29 @@ uint32_t BufferQueueLayer::getDrawingScalingMode() const {
     return mConsumer->getCurrentScalingMode();
 }
 
+Region BufferQueueLayer::getScreenDamage() const {
+    // Surface damage is in buffer space, so it can only be mapped to the
+    // screen through the layer transform when the buffer is shown without
+    // its own transform, crop or scaling.
+    const Region screenBounds(getScreenBounds());
+    const bool fullDamage = surfaceDamageRegion.isRect() &&
+            surfaceDamageRegion.getBounds() == Rect::INVALID_RECT;
+    if (fullDamage || mActiveBuffer == nullptr || mCurrentTransform != 0 ||
+        getTransformToDisplayInverse() ||
+        (!mCurrentCrop.isEmpty() && mCurrentCrop != mActiveBuffer->getBounds()) ||
+        getBufferScaleTransform().getType() != ui::Transform::IDENTITY) {
+        return screenBounds;
+    }
+
+    Region damage;
+    for (const Rect& rect : getTransform().transform(surfaceDamageRegion)) {
+        // Grow by a pixel, as the layer may be drawn at a fractional offset
+        // and filtered into its neighbours.
+        damage.orSelf(Rect(rect.left - 1, rect.top - 1, rect.right + 1, rect.bottom + 1));
+    }
+    return damage.intersect(screenBounds);
+}
+
 Region BufferQueueLayer::getDrawingSurfaceDamage() const {
     return mConsumer->getSurfaceDamage();
 }
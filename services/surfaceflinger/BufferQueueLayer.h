@@ -54,6 +54,8 @@ public:
     int32_t getQueuedFrameCount() const override;
 
     bool shouldPresentNow(nsecs_t expectedPresentTime) const override;
+
+    Region getScreenDamage() const override;
     // -----------------------------------------------------------------------
 
     // -----------------------------------------------------------------------
@@ -51,10 +51,7 @@ BufferStateLayer::BufferStateLayer(const LayerCreationArgs& args)
     mCurrentState.dataspace = ui::Dataspace::V0_SRGB;
 }
 BufferStateLayer::~BufferStateLayer() {
-    if (mActiveBuffer != nullptr) {
-        auto& engine(mFlinger->getRenderEngine());
-        engine.unbindExternalTextureBuffer(mActiveBuffer->getId());
-    }
+    releaseActiveBufferImage();
 }
 
 // -----------------------------------------------------------------------
@@ -222,7 +219,8 @@ bool BufferStateLayer::setBuffer(const sp<GraphicBuffer>& buffer, nsecs_t postTi
     mCurrentState.modified = true;
     setTransactionFlags(eTransactionNeeded);
 
-    mFlinger->mTimeStats->setPostTime(getSequence(), getFrameNumber(), getName().c_str(), postTime);
+    mFlinger->mTimeStats->setPostTime(getSequence(), getFrameNumber(), getName().c_str(),
+                                      getOwnerUid(), postTime);
     mDesiredPresentTime = desiredPresentTime;
 
     if (mFlinger->mUseSmart90ForVideo) {
@@ -571,12 +569,9 @@ status_t BufferStateLayer::updateActiveBuffer() {
         return BAD_VALUE;
     }
 
-    if (mActiveBuffer != nullptr) {
-        // todo: get this to work with BufferStateLayerCache
-        auto& engine(mFlinger->getRenderEngine());
-        engine.unbindExternalTextureBuffer(mActiveBuffer->getId());
-    }
+    releaseActiveBufferImage();
     mActiveBuffer = s.buffer;
+    mActiveBufferClientCacheId = s.clientCacheId;
     mActiveBufferFence = s.acquireFence;
     auto& layerCompositionState = getCompositionLayer()->editState().frontEnd;
     layerCompositionState.buffer = mActiveBuffer;
@@ -621,6 +616,19 @@ void BufferStateLayer::onFirstRef() {
     }
 }
 
+void BufferStateLayer::releaseActiveBufferImage() {
+    if (mActiveBuffer == nullptr) {
+        return;
+    }
+    // Images of cached buffers are created when the buffer is cached and destroyed when it is
+    // uncached, so cycling through cached buffers does not recreate them every frame.
+    if (ClientCache::getInstance().isCached(mActiveBufferClientCacheId, mActiveBuffer)) {
+        return;
+    }
+    auto& engine(mFlinger->getRenderEngine());
+    engine.unbindExternalTextureBuffer(mActiveBuffer->getId());
+}
+
 void BufferStateLayer::HwcSlotGenerator::bufferErased(const client_cache_t& clientCacheId) {
     std::lock_guard lock(mMutex);
     if (!clientCacheId.isValid()) {
@@ -140,6 +140,7 @@ private:
     friend class SlotGenerationTest;
     void onFirstRef() override;
     bool willPresentCurrentTransaction() const;
+    void releaseActiveBufferImage();
 
     static const std::array<float, 16> IDENTITY_MATRIX;
 
@@ -153,6 +154,10 @@ private:
 
     sp<Fence> mPreviousReleaseFence;
 
+    // Cache id the active buffer was set with. While ClientCache still holds the buffer under
+    // this id, the cache owns its RenderEngine image.
+    client_cache_t mActiveBufferClientCacheId;
+
     bool mCurrentStateModified = false;
     bool mReleasePreviousBuffer = false;
     nsecs_t mCallbackHandleAcquireTime = -1;
@@ -21,6 +21,10 @@
 
 #include <cinttypes>
 
+#include <pthread.h>
+#include <renderengine/RenderEngine.h>
+#include <utils/Trace.h>
+
 #include "ClientCache.h"
 
 namespace android {
@@ -29,6 +33,25 @@ ANDROID_SINGLETON_STATIC_INSTANCE(ClientCache);
 
 ClientCache::ClientCache() : mDeathRecipient(new CacheDeathRecipient) {}
 
+ClientCache::~ClientCache() {
+    if (!mPrewarmThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard lock(mPrewarmMutex);
+        mStopPrewarm = true;
+    }
+    mPrewarmCondition.notify_one();
+    mPrewarmThread.join();
+}
+
+void ClientCache::setRenderEngine(renderengine::RenderEngine* renderEngine) {
+    LOG_ALWAYS_FATAL_IF(mRenderEngine != nullptr, "ClientCache render engine is already set");
+    mRenderEngine = renderEngine;
+    mPrewarmThread = std::thread(&ClientCache::prewarmLoop, this);
+    pthread_setname_np(mPrewarmThread.native_handle(), "ClientCachePrewarm");
+}
+
 bool ClientCache::getBuffer(const client_cache_t& cacheId,
                             ClientCacheBuffer** outClientCacheBuffer) {
     auto& [processToken, id] = cacheId;
@@ -67,43 +90,61 @@ void ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& bu
         return;
     }
 
-    std::lock_guard lock(mMutex);
-    sp<IBinder> token;
+    sp<GraphicBuffer> replacedBuffer;
+    {
+        std::lock_guard lock(mMutex);
+        sp<IBinder> token;
+
+        // If this is a new process token, set a death recipient. If the client process dies, we
+        // will get a callback through binderDied.
+        auto it = mBuffers.find(processToken);
+        if (it == mBuffers.end()) {
+            token = processToken.promote();
+            if (!token) {
+                ALOGE("failed to cache buffer: invalid token");
+                return;
+            }
 
-    // If this is a new process token, set a death recipient. If the client process dies, we will
-    // get a callback through binderDied.
-    auto it = mBuffers.find(processToken);
-    if (it == mBuffers.end()) {
-        token = processToken.promote();
-        if (!token) {
-            ALOGE("failed to cache buffer: invalid token");
-            return;
+            // A token local to SurfaceFlinger can't die on its own, so its owner removes it with
+            // removeProcess instead.
+            if (token->localBinder() == nullptr) {
+                status_t err = token->linkToDeath(mDeathRecipient);
+                if (err != NO_ERROR) {
+                    ALOGE("failed to cache buffer: could not link to death");
+                    return;
+                }
+            }
+            auto [itr, success] =
+                    mBuffers.emplace(processToken,
+                                     std::unordered_map<uint64_t, ClientCacheBuffer>());
+            LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
+            it = itr;
         }
 
-        status_t err = token->linkToDeath(mDeathRecipient);
-        if (err != NO_ERROR) {
-            ALOGE("failed to cache buffer: could not link to death");
+        auto& processBuffers = it->second;
+
+        if (processBuffers.size() > BUFFER_CACHE_MAX_SIZE) {
+            ALOGE("failed to cache buffer: cache is full");
             return;
         }
-        auto [itr, success] =
-                mBuffers.emplace(processToken, std::unordered_map<uint64_t, ClientCacheBuffer>());
-        LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
-        it = itr;
-    }
 
-    auto& processBuffers = it->second;
-
-    if (processBuffers.size() > BUFFER_CACHE_MAX_SIZE) {
-        ALOGE("failed to cache buffer: cache is full");
-        return;
+        auto& cachedBuffer = processBuffers[id];
+        if (cachedBuffer.buffer != nullptr && cachedBuffer.buffer->getId() != buffer->getId()) {
+            replacedBuffer = cachedBuffer.buffer;
+        }
+        cachedBuffer.buffer = buffer;
     }
 
-    processBuffers[id].buffer = buffer;
+    if (replacedBuffer) {
+        releaseImages({replacedBuffer});
+    }
+    queuePrewarm(cacheId, buffer);
 }
 
 void ClientCache::erase(const client_cache_t& cacheId) {
     auto& [processToken, id] = cacheId;
     std::vector<sp<ErasedRecipient>> pendingErase;
+    sp<GraphicBuffer> erasedBuffer;
     {
         std::lock_guard lock(mMutex);
         ClientCacheBuffer* buf = nullptr;
@@ -111,6 +152,7 @@ void ClientCache::erase(const client_cache_t& cacheId) {
             ALOGE("failed to erase buffer, could not retrieve buffer");
             return;
         }
+        erasedBuffer = buf->buffer;
 
         for (auto& recipient : buf->recipients) {
             sp<ErasedRecipient> erasedRecipient = recipient.promote();
@@ -125,6 +167,7 @@ void ClientCache::erase(const client_cache_t& cacheId) {
     for (auto& recipient : pendingErase) {
         recipient->bufferErased(cacheId);
     }
+    releaseImages({erasedBuffer});
 }
 
 sp<GraphicBuffer> ClientCache::get(const client_cache_t& cacheId) {
@@ -139,6 +182,21 @@ sp<GraphicBuffer> ClientCache::get(const client_cache_t& cacheId) {
     return buf->buffer;
 }
 
+bool ClientCache::isCached(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer) {
+    if (buffer == nullptr || cacheId.token == nullptr) {
+        return false;
+    }
+
+    std::lock_guard lock(mMutex);
+    auto it = mBuffers.find(cacheId.token);
+    if (it == mBuffers.end()) {
+        return false;
+    }
+    auto bufItr = it->second.find(cacheId.id);
+    return bufItr != it->second.end() && bufItr->second.buffer != nullptr &&
+            bufItr->second.buffer->getId() == buffer->getId();
+}
+
 void ClientCache::registerErasedRecipient(const client_cache_t& cacheId,
                                           const wp<ErasedRecipient>& recipient) {
     std::lock_guard lock(mMutex);
@@ -166,6 +224,7 @@ void ClientCache::unregisterErasedRecipient(const client_cache_t& cacheId,
 
 void ClientCache::removeProcess(const wp<IBinder>& processToken) {
     std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>> pendingErase;
+    std::vector<sp<GraphicBuffer>> erasedBuffers;
     {
         if (processToken == nullptr) {
             ALOGE("failed to remove process, invalid (nullptr) process token");
@@ -180,6 +239,7 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
 
         for (auto& [id, clientCacheBuffer] : itr->second) {
             client_cache_t cacheId = {processToken, id};
+            erasedBuffers.push_back(clientCacheBuffer.buffer);
             for (auto& recipient : clientCacheBuffer.recipients) {
                 sp<ErasedRecipient> erasedRecipient = recipient.promote();
                 if (erasedRecipient) {
@@ -193,6 +253,55 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
     for (auto& [recipient, cacheId] : pendingErase) {
         recipient->bufferErased(cacheId);
     }
+    releaseImages(erasedBuffers);
+}
+
+void ClientCache::queuePrewarm(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer) {
+    if (mRenderEngine == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard lock(mPrewarmMutex);
+        mPendingPrewarms.emplace_back(cacheId, buffer);
+    }
+    mPrewarmCondition.notify_one();
+}
+
+void ClientCache::releaseImages(const std::vector<sp<GraphicBuffer>>& buffers) {
+    if (mRenderEngine == nullptr) {
+        return;
+    }
+    for (const auto& buffer : buffers) {
+        if (buffer != nullptr) {
+            mRenderEngine->unbindExternalTextureBuffer(buffer->getId());
+        }
+    }
+}
+
+void ClientCache::prewarmLoop() {
+    std::unique_lock lock(mPrewarmMutex);
+    while (true) {
+        mPrewarmCondition.wait(lock, [this]() REQUIRES(mPrewarmMutex) {
+            return mStopPrewarm || !mPendingPrewarms.empty();
+        });
+        if (mStopPrewarm) {
+            break;
+        }
+        auto [cacheId, buffer] = std::move(mPendingPrewarms.front());
+        mPendingPrewarms.pop_front();
+        lock.unlock();
+
+        ATRACE_NAME("ClientCache::prewarm");
+        mRenderEngine->cacheExternalTextureBuffer(buffer);
+        // The buffer may have been uncached while its image was being created, after erase
+        // already released whatever image existed. Drop the image so it does not outlive the
+        // cache entry that owns it.
+        if (!isCached(cacheId, buffer)) {
+            releaseImages({buffer});
+        }
+
+        lock.lock();
+    }
 }
 
 void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
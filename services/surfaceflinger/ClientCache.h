@@ -23,24 +23,41 @@
 #include <utils/RefBase.h>
 #include <utils/Singleton.h>
 
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <mutex>
 #include <set>
+#include <thread>
 #include <unordered_map>
 
 #define BUFFER_CACHE_MAX_SIZE 64
 
 namespace android {
 
+namespace renderengine {
+class RenderEngine;
+} // namespace renderengine
+
 class ClientCache : public Singleton<ClientCache> {
 public:
     ClientCache();
+    ~ClientCache();
+
+    // Once set, buffers are imported into the RenderEngine image cache on a background thread
+    // as soon as they are cached, instead of on the first frame that draws them. The cache owns
+    // those images and destroys them when the buffer is uncached.
+    void setRenderEngine(renderengine::RenderEngine* renderEngine);
 
     void add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer);
     void erase(const client_cache_t& cacheId);
 
     sp<GraphicBuffer> get(const client_cache_t& cacheId);
 
+    // Returns true if buffer is the buffer currently cached under cacheId. Unlike get, a miss is
+    // not an error.
+    bool isCached(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer);
+
     void removeProcess(const wp<IBinder>& processToken);
 
     class ErasedRecipient : public virtual RefBase {
@@ -73,6 +90,19 @@ private:
 
     bool getBuffer(const client_cache_t& cacheId, ClientCacheBuffer** outClientCacheBuffer)
             REQUIRES(mMutex);
+
+    void queuePrewarm(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer);
+    void releaseImages(const std::vector<sp<GraphicBuffer>>& buffers);
+    void prewarmLoop();
+
+    renderengine::RenderEngine* mRenderEngine = nullptr;
+
+    std::thread mPrewarmThread;
+    std::mutex mPrewarmMutex;
+    std::condition_variable mPrewarmCondition;
+    std::deque<std::pair<client_cache_t, sp<GraphicBuffer>>> mPendingPrewarms
+            GUARDED_BY(mPrewarmMutex);
+    bool mStopPrewarm GUARDED_BY(mPrewarmMutex) = false;
 };
 
 }; // namespace android
@@ -140,9 +140,13 @@ void ColorLayer::setPerFrameData(const sp<const DisplayDevice>& display,
 
     // Clear out the transform, because it doesn't make sense absent a source buffer
     error = hwcLayer->setTransform(HWC2::Transform::None);
+    auto& committedTransform = outputLayer->editState().hwc->committed.bufferTransform;
     if (error != HWC2::Error::None) {
         ALOGE("[%s] Failed to clear transform: %s (%d)", mName.string(), to_string(error).c_str(),
               static_cast<int32_t>(error));
+        committedTransform.reset();
+    } else {
+        committedTransform = static_cast<Hwc2::Transform>(0);
     }
     outputLayer->editState().bufferTransform = static_cast<Hwc2::Transform>(0);
 
@@ -130,6 +130,11 @@ public:
     // Gets the ordered set of output layers for this output
     virtual const OutputLayers& getOutputLayersOrderedByZ() const = 0;
 
+    // Returns a hash of the output color state and of the geometry, buffer and
+    // color state of each output layer. If two frames have the same hash, the
+    // second one would present the same content as the first.
+    virtual size_t getContentHash() const = 0;
+
 protected:
     virtual void setDisplayColorProfile(std::unique_ptr<DisplayColorProfile>) = 0;
     virtual void setRenderSurface(std::unique_ptr<RenderSurface>) = 0;
@@ -17,10 +17,12 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
 #include <vector>
 
 #include <ui/Fence.h>
 #include <ui/GraphicTypes.h>
+#include <ui/Region.h>
 #include <ui/Size.h>
 #include <utils/Errors.h>
 #include <utils/StrongPointer.h>
@@ -80,6 +82,17 @@ public:
     // which will fire when the buffer is ready for consumption.
     virtual void queueBuffer(base::unique_fd&& readyFence) = 0;
 
+    // Records the region of the surface, in physical display coordinates,
+    // whose content changes in the frame being composed. This is called once
+    // per composed frame, whether or not the frame uses client composition.
+    virtual void addFrameDamage(const Region& damage) = 0;
+
+    // Returns the region of the most recently dequeued buffer that is out of
+    // date, i.e. the damage of every frame composed since the buffer was last
+    // drawn. Returns std::nullopt if the buffer contents are unknown and it
+    // must be redrawn in full.
+    virtual std::optional<Region> getBufferDamage() const = 0;
+
     // Called after the HWC calls are made to present the display
     virtual void onPresentDisplayCompleted() = 0;
 
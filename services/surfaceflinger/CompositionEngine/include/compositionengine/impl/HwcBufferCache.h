@@ -48,11 +48,19 @@ public:
     void getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer, uint32_t* outSlot,
                       sp<GraphicBuffer>* outBuffer);
 
+    // The number of buffers found in the HWC cache, and the number that had to
+    // be sent to HWC, since this cache was created.
+    uint32_t getHitCount() const { return mHitCount; }
+    uint32_t getMissCount() const { return mMissCount; }
+
 private:
     // an array where the index corresponds to a slot and the value corresponds to a (counter,
     // buffer) pair. "counter" is a unique value that indicates the last time this slot was updated
     // or used and allows us to keep track of the least-recently used buffer.
     wp<GraphicBuffer> mBuffers[BufferQueue::NUM_BUFFER_SLOTS];
+
+    uint32_t mHitCount = 0;
+    uint32_t mMissCount = 0;
 };
 
 } // namespace compositionengine::impl
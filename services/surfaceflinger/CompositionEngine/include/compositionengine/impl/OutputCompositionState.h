@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
 
 #include <math/mat4.h>
 #include <ui/GraphicTypes.h>
@@ -76,6 +77,13 @@ struct OutputCompositionState {
     // True if the last composition frame had visible layers
     bool lastCompositionHadVisibleLayers{false};
 
+    // The content hash of the last frame presented on this output, if any
+    std::optional<size_t> lastPresentedContentHash;
+
+    // A hash of the layers and their composition types when this output was
+    // last composed, if any
+    std::optional<size_t> lastCompositionLayoutHash;
+
     // The color transform to apply
     android_color_transform_t colorTransform{HAL_COLOR_TRANSFORM_IDENTITY};
 
@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <utility>
 
 #include <compositionengine/impl/HwcBufferCache.h>
 #include <renderengine/Mesh.h>
@@ -77,6 +78,20 @@ struct OutputLayerCompositionState {
         // The buffer cache for this layer. This is used to lower the
         // cost of sending reused buffers to the HWC.
         HwcBufferCache hwcBufferCache;
+
+        // The geometry state the HWC layer last accepted. A value is only set
+        // once the HWC accepted it, so that writing the geometry state again
+        // skips the calls for values the HWC already has.
+        struct Committed {
+            std::optional<Rect> displayFrame;
+            std::optional<FloatRect> sourceCrop;
+            std::optional<uint32_t> z;
+            std::optional<Hwc2::Transform> bufferTransform;
+            std::optional<Hwc2::IComposerClient::BlendMode> blendMode;
+            std::optional<float> alpha;
+            std::optional<std::pair<uint32_t, uint32_t>> info;
+        };
+        Committed committed;
     };
 
     // The HWC state is optional, and is only set up if there is any potential
@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <deque>
 #include <memory>
+#include <unordered_map>
 
 #include <android-base/unique_fd.h>
 #include <compositionengine/RenderSurface.h>
@@ -55,6 +57,8 @@ public:
     status_t prepareFrame() override;
     sp<GraphicBuffer> dequeueBuffer(base::unique_fd* bufferFence) override;
     void queueBuffer(base::unique_fd&& readyFence) override;
+    void addFrameDamage(const Region& damage) override;
+    std::optional<Region> getBufferDamage() const override;
     void onPresentDisplayCompleted() override;
     void setViewportAndProjection() override;
     void flip() override;
@@ -71,6 +75,9 @@ public:
     void flipClientTarget(bool flip) override;
 
 private:
+    // Forgets the contents of all buffers, so they are redrawn in full.
+    void resetBufferDamage();
+
     const compositionengine::CompositionEngine& mCompositionEngine;
     const compositionengine::Display& mDisplay;
 
@@ -83,6 +90,14 @@ private:
     bool mProtected{false};
     bool mFlipClientTarget{false};
     std::uint32_t mPageFlipCount{0};
+
+    // Damage of the most recently composed frames, newest first.
+    static constexpr size_t kMaxFrameDamageHistory = 8;
+    std::deque<Region> mFrameDamageHistory;
+    std::uint64_t mFrameDamageCount{0};
+    // The value of mFrameDamageCount when each buffer was last drawn, keyed by
+    // buffer id.
+    std::unordered_map<std::uint64_t, std::uint64_t> mBufferDrawnFrames;
 };
 
 std::unique_ptr<compositionengine::RenderSurface> createRenderSurface(
@@ -67,6 +67,8 @@ public:
                          sp<compositionengine::LayerFE>));
     MOCK_METHOD1(setOutputLayersOrderedByZ, void(OutputLayers&&));
     MOCK_CONST_METHOD0(getOutputLayersOrderedByZ, OutputLayers&());
+
+    MOCK_CONST_METHOD0(getContentHash, size_t());
 };
 
 } // namespace android::compositionengine::mock
@@ -41,6 +41,8 @@ public:
     MOCK_METHOD1(dequeueBuffer, sp<GraphicBuffer>(base::unique_fd*));
     MOCK_METHOD1(flipClientTarget, void(bool flip));
     MOCK_METHOD1(queueBuffer, void(base::unique_fd&&));
+    MOCK_METHOD1(addFrameDamage, void(const Region&));
+    MOCK_CONST_METHOD0(getBufferDamage, std::optional<Region>());
     MOCK_METHOD0(onPresentDisplayCompleted, void());
     MOCK_METHOD0(setViewportAndProjection, void());
     MOCK_METHOD0(flip, void());
@@ -39,8 +39,14 @@ void HwcBufferCache::getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer, uin
     if (currentBuffer == weakCopy) {
         // already cached in HWC, skip sending the buffer
         *outBuffer = nullptr;
+        if (buffer != nullptr) {
+            mHitCount++;
+        }
     } else {
         *outBuffer = buffer;
+        if (buffer != nullptr) {
+            mMissCount++;
+        }
 
         // update cache
         currentBuffer = buffer;
@@ -14,11 +14,15 @@
  * limitations under the License.
  */
 
+#include <functional>
+
 #include <android-base/stringprintf.h>
 #include <compositionengine/CompositionEngine.h>
 #include <compositionengine/DisplayColorProfile.h>
+#include <compositionengine/Layer.h>
 #include <compositionengine/LayerFE.h>
 #include <compositionengine/RenderSurface.h>
+#include <compositionengine/impl/LayerCompositionState.h>
 #include <compositionengine/impl/Output.h>
 #include <compositionengine/impl/OutputLayer.h>
 #include <ui/DebugUtils.h>
@@ -28,6 +32,41 @@ namespace android::compositionengine {
 Output::~Output() = default;
 
 namespace impl {
+namespace {
+
+template <typename T>
+void hashCombine(size_t& seed, const T& value) {
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+void hashCombine(size_t& seed, const Rect& rect) {
+    hashCombine(seed, rect.left);
+    hashCombine(seed, rect.top);
+    hashCombine(seed, rect.right);
+    hashCombine(seed, rect.bottom);
+}
+
+void hashCombine(size_t& seed, const FloatRect& rect) {
+    hashCombine(seed, rect.left);
+    hashCombine(seed, rect.top);
+    hashCombine(seed, rect.right);
+    hashCombine(seed, rect.bottom);
+}
+
+void hashCombine(size_t& seed, const Region& region) {
+    for (const Rect& rect : region) {
+        hashCombine(seed, rect);
+    }
+}
+
+void hashCombine(size_t& seed, const mat4& matrix) {
+    const float* values = matrix.asArray();
+    for (size_t i = 0; i < 16; i++) {
+        hashCombine(seed, values[i]);
+    }
+}
+
+} // namespace
 
 Output::Output(const CompositionEngine& compositionEngine)
       : mCompositionEngine(compositionEngine) {}
@@ -236,6 +275,58 @@ const Output::OutputLayers& Output::getOutputLayersOrderedByZ() const {
     return mOutputLayersOrderedByZ;
 }
 
+size_t Output::getContentHash() const {
+    size_t hash = 0;
+    hashCombine(hash, mState.isEnabled);
+    hashCombine(hash, mState.bounds);
+    hashCombine(hash, mState.orientation);
+    hashCombine(hash, mState.frame);
+    hashCombine(hash, mState.viewport);
+    hashCombine(hash, mState.scissor);
+    hashCombine(hash, mState.needsFiltering);
+    hashCombine(hash, mState.colorTransform);
+    hashCombine(hash, mState.colorTransformMat);
+    hashCombine(hash, mState.colorMode);
+    hashCombine(hash, mState.renderIntent);
+    hashCombine(hash, mState.dataspace);
+
+    for (const auto& outputLayer : mOutputLayersOrderedByZ) {
+        if (!outputLayer) {
+            continue;
+        }
+        const auto& layer = outputLayer->getLayer();
+        hashCombine(hash, &layer);
+
+        const auto& state = outputLayer->getState();
+        hashCombine(hash, state.visibleRegion);
+        hashCombine(hash, state.forceClientComposition);
+        hashCombine(hash, state.clearClientTarget);
+        hashCombine(hash, state.displayFrame);
+        hashCombine(hash, state.sourceCrop);
+        hashCombine(hash, state.bufferTransform);
+        hashCombine(hash, state.z);
+
+        // A newly latched buffer comes with new damage and a new acquire
+        // fence, even if the same graphic buffer is queued again.
+        const auto& feState = layer.getState().frontEnd;
+        hashCombine(hash, feState.buffer ? feState.buffer->getId() : 0);
+        hashCombine(hash, feState.acquireFence.get());
+        hashCombine(hash, feState.surfaceDamage.isEmpty());
+        hashCombine(hash, feState.sidebandStream.get());
+        hashCombine(hash, feState.compositionType);
+        hashCombine(hash, feState.blendMode);
+        hashCombine(hash, feState.alpha);
+        hashCombine(hash, feState.color.r);
+        hashCombine(hash, feState.color.g);
+        hashCombine(hash, feState.color.b);
+        hashCombine(hash, feState.color.a);
+        hashCombine(hash, feState.dataspace);
+        hashCombine(hash, feState.hdrMetadata.validTypes);
+        hashCombine(hash, feState.colorTransform);
+    }
+    return hash;
+}
+
 void Output::dirtyEntireOutput() {
     mState.dirtyRegion.set(mState.bounds);
 }
@@ -42,6 +42,12 @@ FloatRect reduce(const FloatRect& win, const Region& exclude) {
     return Region(Rect{win}).subtract(exclude).getBounds().toFloatRect();
 }
 
+// Returns true if the HWC layer already has |value|.
+template <typename T>
+bool isCommitted(const std::optional<T>& committed, const T& value) {
+    return committed && *committed == value;
+}
+
 } // namespace
 
 std::unique_ptr<compositionengine::OutputLayer> createOutputLayer(
@@ -303,7 +309,7 @@ void OutputLayer::updateCompositionState(bool includeGeometry) {
     }
 }
 
-void OutputLayer::writeStateToHWC(bool includeGeometry) const {
+void OutputLayer::writeStateToHWC(bool includeGeometry) {
     // Skip doing this if there is no HWC interface
     if (!mState.hwc) {
         return;
@@ -317,61 +323,99 @@ void OutputLayer::writeStateToHWC(bool includeGeometry) const {
     }
 
     if (includeGeometry) {
+        auto& committed = (*mState.hwc).committed;
+
         // Output dependent state
 
-        if (auto error = hwcLayer->setDisplayFrame(mState.displayFrame);
-            error != HWC2::Error::None) {
-            ALOGE("[%s] Failed to set display frame [%d, %d, %d, %d]: %s (%d)",
-                  mLayerFE->getDebugName(), mState.displayFrame.left, mState.displayFrame.top,
-                  mState.displayFrame.right, mState.displayFrame.bottom, to_string(error).c_str(),
-                  static_cast<int32_t>(error));
+        if (!isCommitted(committed.displayFrame, mState.displayFrame)) {
+            if (auto error = hwcLayer->setDisplayFrame(mState.displayFrame);
+                error != HWC2::Error::None) {
+                ALOGE("[%s] Failed to set display frame [%d, %d, %d, %d]: %s (%d)",
+                      mLayerFE->getDebugName(), mState.displayFrame.left, mState.displayFrame.top,
+                      mState.displayFrame.right, mState.displayFrame.bottom,
+                      to_string(error).c_str(), static_cast<int32_t>(error));
+                committed.displayFrame.reset();
+            } else {
+                committed.displayFrame = mState.displayFrame;
+            }
         }
 
-        if (auto error = hwcLayer->setSourceCrop(mState.sourceCrop); error != HWC2::Error::None) {
-            ALOGE("[%s] Failed to set source crop [%.3f, %.3f, %.3f, %.3f]: "
-                  "%s (%d)",
-                  mLayerFE->getDebugName(), mState.sourceCrop.left, mState.sourceCrop.top,
-                  mState.sourceCrop.right, mState.sourceCrop.bottom, to_string(error).c_str(),
-                  static_cast<int32_t>(error));
+        if (!isCommitted(committed.sourceCrop, mState.sourceCrop)) {
+            if (auto error = hwcLayer->setSourceCrop(mState.sourceCrop);
+                error != HWC2::Error::None) {
+                ALOGE("[%s] Failed to set source crop [%.3f, %.3f, %.3f, %.3f]: "
+                      "%s (%d)",
+                      mLayerFE->getDebugName(), mState.sourceCrop.left, mState.sourceCrop.top,
+                      mState.sourceCrop.right, mState.sourceCrop.bottom, to_string(error).c_str(),
+                      static_cast<int32_t>(error));
+                committed.sourceCrop.reset();
+            } else {
+                committed.sourceCrop = mState.sourceCrop;
+            }
         }
 
-        if (auto error = hwcLayer->setZOrder(mState.z); error != HWC2::Error::None) {
-            ALOGE("[%s] Failed to set Z %u: %s (%d)", mLayerFE->getDebugName(), mState.z,
-                  to_string(error).c_str(), static_cast<int32_t>(error));
+        if (!isCommitted(committed.z, mState.z)) {
+            if (auto error = hwcLayer->setZOrder(mState.z); error != HWC2::Error::None) {
+                ALOGE("[%s] Failed to set Z %u: %s (%d)", mLayerFE->getDebugName(), mState.z,
+                      to_string(error).c_str(), static_cast<int32_t>(error));
+                committed.z.reset();
+            } else {
+                committed.z = mState.z;
+            }
         }
 
-        if (auto error =
-                    hwcLayer->setTransform(static_cast<HWC2::Transform>(mState.bufferTransform));
-            error != HWC2::Error::None) {
-            ALOGE("[%s] Failed to set transform %s: %s (%d)", mLayerFE->getDebugName(),
-                  toString(mState.bufferTransform).c_str(), to_string(error).c_str(),
-                  static_cast<int32_t>(error));
+        if (!isCommitted(committed.bufferTransform, mState.bufferTransform)) {
+            if (auto error = hwcLayer->setTransform(
+                        static_cast<HWC2::Transform>(mState.bufferTransform));
+                error != HWC2::Error::None) {
+                ALOGE("[%s] Failed to set transform %s: %s (%d)", mLayerFE->getDebugName(),
+                      toString(mState.bufferTransform).c_str(), to_string(error).c_str(),
+                      static_cast<int32_t>(error));
+                committed.bufferTransform.reset();
+            } else {
+                committed.bufferTransform = mState.bufferTransform;
+            }
         }
 
         // Output independent state
 
         const auto& outputIndependentState = mLayer->getState().frontEnd;
 
-        if (auto error = hwcLayer->setBlendMode(
-                    static_cast<HWC2::BlendMode>(outputIndependentState.blendMode));
-            error != HWC2::Error::None) {
-            ALOGE("[%s] Failed to set blend mode %s: %s (%d)", mLayerFE->getDebugName(),
-                  toString(outputIndependentState.blendMode).c_str(), to_string(error).c_str(),
-                  static_cast<int32_t>(error));
+        if (!isCommitted(committed.blendMode, outputIndependentState.blendMode)) {
+            if (auto error = hwcLayer->setBlendMode(
+                        static_cast<HWC2::BlendMode>(outputIndependentState.blendMode));
+                error != HWC2::Error::None) {
+                ALOGE("[%s] Failed to set blend mode %s: %s (%d)", mLayerFE->getDebugName(),
+                      toString(outputIndependentState.blendMode).c_str(),
+                      to_string(error).c_str(), static_cast<int32_t>(error));
+                committed.blendMode.reset();
+            } else {
+                committed.blendMode = outputIndependentState.blendMode;
+            }
         }
 
-        if (auto error = hwcLayer->setPlaneAlpha(outputIndependentState.alpha);
-            error != HWC2::Error::None) {
-            ALOGE("[%s] Failed to set plane alpha %.3f: %s (%d)", mLayerFE->getDebugName(),
-                  outputIndependentState.alpha, to_string(error).c_str(),
-                  static_cast<int32_t>(error));
+        if (!isCommitted(committed.alpha, outputIndependentState.alpha)) {
+            if (auto error = hwcLayer->setPlaneAlpha(outputIndependentState.alpha);
+                error != HWC2::Error::None) {
+                ALOGE("[%s] Failed to set plane alpha %.3f: %s (%d)", mLayerFE->getDebugName(),
+                      outputIndependentState.alpha, to_string(error).c_str(),
+                      static_cast<int32_t>(error));
+                committed.alpha.reset();
+            } else {
+                committed.alpha = outputIndependentState.alpha;
+            }
         }
 
-        if (auto error =
-                    hwcLayer->setInfo(outputIndependentState.type, outputIndependentState.appId);
-            error != HWC2::Error::None) {
-            ALOGE("[%s] Failed to set info %s (%d)", mLayerFE->getDebugName(),
-                  to_string(error).c_str(), static_cast<int32_t>(error));
+        const auto info = std::make_pair(outputIndependentState.type, outputIndependentState.appId);
+        if (!isCommitted(committed.info, info)) {
+            if (auto error = hwcLayer->setInfo(info.first, info.second);
+                error != HWC2::Error::None) {
+                ALOGE("[%s] Failed to set info %s (%d)", mLayerFE->getDebugName(),
+                      to_string(error).c_str(), static_cast<int32_t>(error));
+                committed.info.reset();
+            } else {
+                committed.info = info;
+            }
         }
     }
 }
@@ -33,6 +33,8 @@ void dumpHwc(const OutputLayerCompositionState::Hwc& hwc, std::string& out) {
     }
 
     dumpVal(out, "composition", toString(hwc.hwcCompositionType), hwc.hwcCompositionType);
+    dumpVal(out, "bufferCacheHits", hwc.hwcBufferCache.getHitCount());
+    dumpVal(out, "bufferCacheMisses", hwc.hwcBufferCache.getMissCount());
 }
 
 } // namespace
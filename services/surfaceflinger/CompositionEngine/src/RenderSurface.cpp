@@ -87,11 +87,13 @@ const sp<Fence>& RenderSurface::getClientTargetAcquireFence() const {
 void RenderSurface::setDisplaySize(const ui::Size& size) {
     mDisplaySurface->resizeBuffers(size.width, size.height);
     mSize = size;
+    resetBufferDamage();
 }
 
 void RenderSurface::setBufferDataspace(ui::Dataspace dataspace) {
     native_window_set_buffers_data_space(mNativeWindow.get(),
                                          static_cast<android_dataspace>(dataspace));
+    resetBufferDamage();
 }
 
 void RenderSurface::setProtected(bool useProtected) {
@@ -103,6 +105,7 @@ void RenderSurface::setProtected(bool useProtected) {
     ALOGE_IF(status != NO_ERROR, "Unable to set BQ usage bits for protected content: %d", status);
     if (status == NO_ERROR) {
         mProtected = useProtected;
+        resetBufferDamage();
     }
 }
 
@@ -167,6 +170,9 @@ void RenderSurface::queueBuffer(base::unique_fd&& readyFence) {
     const auto id = mDisplay.getId();
 
     if (mFlipClientTarget || hwc.hasClientComposition(id) || hwc.hasFlipClientTargetRequest(id)) {
+        // Only a buffer dequeued for client composition has been drawn.
+        const bool drawn = mGraphicBuffer != nullptr && !mFlipClientTarget;
+
         // hasFlipClientTargetRequest could return true even if we haven't
         // dequeued a buffer before. Try dequeueing one if we don't have a
         // buffer ready.
@@ -203,6 +209,11 @@ void RenderSurface::queueBuffer(base::unique_fd&& readyFence) {
                 }
             }
 
+            if (drawn && result == NO_ERROR) {
+                mBufferDrawnFrames[mGraphicBuffer->getId()] = mFrameDamageCount;
+            } else {
+                mBufferDrawnFrames.erase(mGraphicBuffer->getId());
+            }
             mGraphicBuffer = nullptr;
         }
     }
@@ -213,6 +224,38 @@ void RenderSurface::queueBuffer(base::unique_fd&& readyFence) {
     }
 }
 
+void RenderSurface::addFrameDamage(const Region& damage) {
+    mFrameDamageHistory.push_front(damage);
+    if (mFrameDamageHistory.size() > kMaxFrameDamageHistory) {
+        mFrameDamageHistory.pop_back();
+    }
+    mFrameDamageCount++;
+}
+
+std::optional<Region> RenderSurface::getBufferDamage() const {
+    if (mGraphicBuffer == nullptr) {
+        return std::nullopt;
+    }
+    const auto it = mBufferDrawnFrames.find(mGraphicBuffer->getId());
+    if (it == mBufferDrawnFrames.end()) {
+        return std::nullopt;
+    }
+    const std::uint64_t age = mFrameDamageCount - it->second;
+    if (age == 0 || age > mFrameDamageHistory.size()) {
+        return std::nullopt;
+    }
+    Region damage;
+    for (size_t i = 0; i < age; i++) {
+        damage.orSelf(mFrameDamageHistory[i]);
+    }
+    return damage;
+}
+
+void RenderSurface::resetBufferDamage() {
+    mFrameDamageHistory.clear();
+    mBufferDrawnFrames.clear();
+}
+
 void RenderSurface::onPresentDisplayCompleted() {
     mDisplaySurface->onFrameCommitted();
 }
@@ -82,5 +82,14 @@ TEST_F(HwcBufferCacheTest, cacheMapsNegativeSlotToZero) {
     testSlot(-123, 0);
 }
 
+TEST_F(HwcBufferCacheTest, cacheCountsHitsAndMisses) {
+    testSlot(0, 0);
+
+    // Each buffer is sent once, then found in the cache once. Setting the slot
+    // to nullptr counts as neither.
+    EXPECT_EQ(2u, mCache.getHitCount());
+    EXPECT_EQ(2u, mCache.getMissCount());
+}
+
 } // namespace
 } // namespace android::compositionengine
@@ -310,5 +310,36 @@ TEST_F(OutputLayerWriteStateToHWCTest, canSetsAllState) {
     mOutputLayer.writeStateToHWC(true);
 }
 
+TEST_F(OutputLayerWriteStateToHWCTest, retriesStateRejectedByHWC) {
+    expectGeometryCommonCalls();
+    mOutputLayer.writeStateToHWC(true);
+
+    expectGeometryCommonCalls();
+    mOutputLayer.writeStateToHWC(true);
+}
+
+TEST_F(OutputLayerWriteStateToHWCTest, skipsStateAlreadyCommitted) {
+    EXPECT_CALL(*mHwcLayer, setDisplayFrame(kDisplayFrame)).WillOnce(Return(HWC2::Error::None));
+    EXPECT_CALL(*mHwcLayer, setSourceCrop(kSourceCrop)).WillOnce(Return(HWC2::Error::None));
+    EXPECT_CALL(*mHwcLayer, setZOrder(kZOrder)).WillOnce(Return(HWC2::Error::None));
+    EXPECT_CALL(*mHwcLayer, setTransform(static_cast<HWC2::Transform>(kBufferTransform)))
+            .WillOnce(Return(HWC2::Error::None));
+    EXPECT_CALL(*mHwcLayer, setBlendMode(static_cast<HWC2::BlendMode>(kBlendMode)))
+            .WillOnce(Return(HWC2::Error::None));
+    EXPECT_CALL(*mHwcLayer, setPlaneAlpha(kAlpha)).WillOnce(Return(HWC2::Error::None));
+    EXPECT_CALL(*mHwcLayer, setInfo(kType, kAppId)).WillOnce(Return(HWC2::Error::None));
+
+    mOutputLayer.writeStateToHWC(true);
+
+    // Nothing changed, so nothing is sent again.
+    mOutputLayer.writeStateToHWC(true);
+
+    // Only the value that changed is sent.
+    mOutputLayer.editState().z = kZOrder + 1;
+    EXPECT_CALL(*mHwcLayer, setZOrder(kZOrder + 1)).WillOnce(Return(HWC2::Error::None));
+
+    mOutputLayer.writeStateToHWC(true);
+}
+
 } // namespace
 } // namespace android::compositionengine
@@ -16,7 +16,9 @@
 
 #include <cmath>
 
+#include <compositionengine/impl/LayerCompositionState.h>
 #include <compositionengine/impl/Output.h>
+#include <compositionengine/impl/OutputLayerCompositionState.h>
 #include <compositionengine/mock/CompositionEngine.h>
 #include <compositionengine/mock/DisplayColorProfile.h>
 #include <compositionengine/mock/Layer.h>
@@ -377,5 +379,45 @@ TEST_F(OutputTest, getOrCreateOutputLayerWorks) {
     }
 }
 
+/* ------------------------------------------------------------------------
+ * Output::getContentHash()
+ */
+
+TEST_F(OutputTest, getContentHashTracksOutputAndLayerState) {
+    mock::OutputLayer* outputLayer = new StrictMock<mock::OutputLayer>();
+    Output::OutputLayers outputLayers;
+    outputLayers.emplace_back(std::unique_ptr<OutputLayer>(outputLayer));
+    outputLayers.emplace_back(nullptr);
+    mOutput.setOutputLayersOrderedByZ(std::move(outputLayers));
+
+    StrictMock<mock::Layer> layer;
+    impl::LayerCompositionState layerState;
+    impl::OutputLayerCompositionState outputLayerState;
+    EXPECT_CALL(*outputLayer, getLayer()).WillRepeatedly(ReturnRef(layer));
+    EXPECT_CALL(*outputLayer, getState()).WillRepeatedly(ReturnRef(outputLayerState));
+    EXPECT_CALL(layer, getState()).WillRepeatedly(ReturnRef(layerState));
+
+    const size_t initialHash = mOutput.getContentHash();
+    EXPECT_EQ(initialHash, mOutput.getContentHash());
+
+    // Output color state is covered.
+    mOutput.editState().dataspace = ui::Dataspace::DISPLAY_P3;
+    const size_t dataspaceHash = mOutput.getContentHash();
+    EXPECT_NE(initialHash, dataspaceHash);
+
+    // Layer geometry is covered.
+    outputLayerState.displayFrame = Rect(10, 20);
+    const size_t geometryHash = mOutput.getContentHash();
+    EXPECT_NE(dataspaceHash, geometryHash);
+
+    // Layer content is covered.
+    layerState.frontEnd.alpha = 0.5f;
+    const size_t alphaHash = mOutput.getContentHash();
+    EXPECT_NE(geometryHash, alphaHash);
+
+    layerState.frontEnd.surfaceDamage = Region(Rect(10, 20));
+    EXPECT_NE(alphaHash, mOutput.getContentHash());
+}
+
 } // namespace
 } // namespace android::compositionengine
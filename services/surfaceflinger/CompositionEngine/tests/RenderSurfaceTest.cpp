@@ -353,6 +353,50 @@ TEST_F(RenderSurfaceTest, queueBufferHandlesNativeWindowQueueBufferFailureOnVirt
     EXPECT_EQ(nullptr, mSurface.mutableGraphicBufferForTest().get());
 }
 
+/* ------------------------------------------------------------------------
+ * RenderSurface::getBufferDamage()
+ */
+
+TEST_F(RenderSurfaceTest, getBufferDamageAccumulatesDamageSinceBufferWasDrawn) {
+    sp<GraphicBuffer> bufferA = new GraphicBuffer();
+    sp<GraphicBuffer> bufferB = new GraphicBuffer();
+    const Region damage1(Rect(0, 0, 10, 10));
+    const Region damage2(Rect(20, 20, 30, 30));
+    const Region damage3(Rect(40, 40, 50, 50));
+
+    EXPECT_CALL(mHwComposer, hasClientComposition(DEFAULT_DISPLAY_ID))
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*mNativeWindow, queueBuffer(_, _)).WillRepeatedly(Return(NO_ERROR));
+    EXPECT_CALL(*mDisplaySurface, advanceFrame()).WillRepeatedly(Return(NO_ERROR));
+
+    // Buffers that were never drawn must be redrawn in full.
+    mSurface.addFrameDamage(damage1);
+    mSurface.mutableGraphicBufferForTest() = bufferA;
+    EXPECT_FALSE(mSurface.getBufferDamage());
+    mSurface.queueBuffer(base::unique_fd());
+
+    mSurface.addFrameDamage(damage2);
+    mSurface.mutableGraphicBufferForTest() = bufferB;
+    EXPECT_FALSE(mSurface.getBufferDamage());
+    mSurface.queueBuffer(base::unique_fd());
+
+    // bufferA is missing the changes of the last two frames.
+    mSurface.addFrameDamage(damage3);
+    mSurface.mutableGraphicBufferForTest() = bufferA;
+    auto damage = mSurface.getBufferDamage();
+    ASSERT_TRUE(damage);
+    EXPECT_TRUE(damage->subtract(damage2.merge(damage3)).isEmpty());
+    EXPECT_TRUE(damage2.merge(damage3).subtract(*damage).isEmpty());
+    mSurface.queueBuffer(base::unique_fd());
+
+    // Resizing invalidates the contents of every buffer.
+    EXPECT_CALL(*mDisplaySurface, resizeBuffers(640, 480)).Times(1);
+    mSurface.setDisplaySize(ui::Size(640, 480));
+    mSurface.addFrameDamage(damage1);
+    mSurface.mutableGraphicBufferForTest() = bufferB;
+    EXPECT_FALSE(mSurface.getBufferDamage());
+}
+
 /* ------------------------------------------------------------------------
  * RenderSurface::onPresentDisplayCompleted()
  */
@@ -23,6 +23,7 @@
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <android/native_window.h>
 #include <binder/IBinder.h>
@@ -97,6 +98,24 @@ public:
     void                    setLayersNeedingFences(const Vector< sp<Layer> >& layers);
     const Vector< sp<Layer> >& getLayersNeedingFences() const;
 
+    // Per-layer inputs and accumulated coverage from the last visible region
+    // pass over this display, in reverse Z order. Lets
+    // SurfaceFlinger::computeVisibleRegions skip the unchanged layers above the
+    // topmost layer whose geometry changed.
+    struct VisibleRegionCacheEntry {
+        const Layer* layer;
+        // Layer::visibilityGeneration written by the pass that produced this entry
+        uint64_t generation;
+        bool visible;
+        bool opaque;
+        Rect bounds;
+        Region transparentRegion;
+        // aboveOpaqueLayers and aboveCoveredLayers after accumulating this layer
+        Region aboveOpaqueLayers;
+        Region aboveCoveredLayers;
+    };
+    std::vector<VisibleRegionCacheEntry>& editVisibleRegionCache() { return mVisibleRegionCache; }
+
     void                    setLayerStack(uint32_t stack);
     void                    setDisplaySize(const int newWidth, const int newHeight);
     void                    setProjection(int orientation, const Rect& viewport, const Rect& frame);
@@ -199,6 +218,8 @@ private:
     Vector< sp<Layer> > mVisibleLayersSortedByZ;
     // list of layers needing fences
     Vector< sp<Layer> > mLayersNeedingFences;
+    // results of the last computeVisibleRegions pass on this display
+    std::vector<VisibleRegionCacheEntry> mVisibleRegionCache;
 
     /*
      * Transaction state
@@ -1347,18 +1347,31 @@ void CommandReader::resetData()
 {
     mErrors.clear();
 
+    // Reset the return data in place instead of clearing the map, so that
+    // every frame reuses the entries, and the vectors that weren't taken,
+    // rather than allocating them again.
     for (auto& data : mReturnData) {
-        if (data.second.presentFence >= 0) {
-            close(data.second.presentFence);
+        ReturnData& returnData = data.second;
+        if (returnData.presentFence >= 0) {
+            close(returnData.presentFence);
         }
-        for (auto fence : data.second.releaseFences) {
+        for (auto fence : returnData.releaseFences) {
             if (fence >= 0) {
                 close(fence);
             }
         }
+
+        returnData.displayRequests = 0;
+        returnData.changedLayers.clear();
+        returnData.compositionTypes.clear();
+        returnData.requestedLayers.clear();
+        returnData.requestMasks.clear();
+        returnData.presentFence = -1;
+        returnData.releasedLayers.clear();
+        returnData.releaseFences.clear();
+        returnData.presentOrValidateState = -1;
     }
 
-    mReturnData.clear();
     mCurrentReturnData = nullptr;
 }
 
@@ -275,6 +275,8 @@ private:
     };
 
     std::vector<CommandError> mErrors;
+    // Entries are kept, and reset, across parses. A display without an entry
+    // reads the same as one whose returned data has been reset or taken.
     std::unordered_map<Display, ReturnData> mReturnData;
 
     // When SELECT_DISPLAY is parsed, this is updated to point to the
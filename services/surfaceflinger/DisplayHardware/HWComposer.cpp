@@ -420,11 +420,13 @@ status_t HWComposer::prepare(DisplayId displayId, const compositionengine::Outpu
     // rendered to the client target yet, we should not attempt to skip
     // validate.
     //
-    // displayData.hasClientComposition hasn't been updated for this frame.
-    // The check below is incorrect.  We actually rely on HWC here to fall
-    // back to validate when there is any client layer.
+    // displayData.hasClientComposition describes the previous frame, so look
+    // at the composition types requested for this frame instead. A frame that
+    // stops requesting client composition can then be presented in a single
+    // round trip, and HWC still falls back to validate if it changes any of
+    // the requested types.
     displayData.validateWasSkipped = false;
-    if (!displayData.hasClientComposition) {
+    if (!requestsClientComposition(output)) {
         sp<Fence> outPresentFence;
         uint32_t state = UINT32_MAX;
         error = hwcDisplay->presentOrValidate(&numTypes, &numRequests, &outPresentFence , &state);
@@ -508,6 +510,17 @@ status_t HWComposer::prepare(DisplayId displayId, const compositionengine::Outpu
     return NO_ERROR;
 }
 
+bool HWComposer::requestsClientComposition(const compositionengine::Output& output) {
+    for (auto& outputLayer : output.getOutputLayersOrderedByZ()) {
+        const auto& state = outputLayer->getState();
+        if (state.hwc &&
+            (*state.hwc).hwcCompositionType == Hwc2::IComposerClient::Composition::CLIENT) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool HWComposer::hasDeviceComposition(const std::optional<DisplayId>& displayId) const {
     if (!displayId) {
         // Displays without a corresponding HWC display are never composed by
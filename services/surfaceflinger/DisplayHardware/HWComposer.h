@@ -328,6 +328,10 @@ private:
 
     static void validateChange(HWC2::Composition from, HWC2::Composition to);
 
+    // Whether any layer of the output is requesting client composition for
+    // the upcoming frame.
+    static bool requestsClientComposition(const compositionengine::Output& output);
+
     struct DisplayData {
         bool isVirtual = false;
         bool hasClientComposition = false;
@@ -19,6 +19,7 @@
 
 #include <cinttypes>
 
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <utils/Mutex.h>
 
@@ -34,9 +35,17 @@ namespace impl {
 namespace V1_0 = android::hardware::power::V1_0;
 using V1_3::PowerHint;
 
+namespace {
+
+constexpr int32_t kDefaultUpdateImminentTimeoutMs = 80;
+
+} // namespace
+
 PowerAdvisor::~PowerAdvisor() = default;
 
-PowerAdvisor::PowerAdvisor() = default;
+PowerAdvisor::PowerAdvisor()
+      : mUpdateImminentTimeout(ms2ns(property_get_int32("debug.sf.update_imminent_timeout_ms",
+                                                        kDefaultUpdateImminentTimeoutMs))) {}
 
 void PowerAdvisor::setExpensiveRenderingExpected(DisplayId displayId, bool expected) {
     if (expected) {
@@ -47,6 +56,7 @@ void PowerAdvisor::setExpensiveRenderingExpected(DisplayId displayId, bool expec
 
     const bool expectsExpensiveRendering = !mExpensiveDisplays.empty();
     if (mNotifiedExpensiveRendering != expectsExpensiveRendering) {
+        std::lock_guard lock(mPowerHalMutex);
         const sp<V1_3::IPower> powerHal = getPowerHal();
         if (powerHal == nullptr) {
             return;
@@ -63,6 +73,30 @@ void PowerAdvisor::setExpensiveRenderingExpected(DisplayId displayId, bool expec
     }
 }
 
+void PowerAdvisor::notifyDisplayUpdateImminent() {
+    if (mUpdateImminentTimeout <= 0) {
+        return;
+    }
+
+    // Only the first update after an idle period is boosted. Once frames are
+    // flowing, the power HAL's own load tracking keeps up with them.
+    const nsecs_t now = systemTime();
+    const nsecs_t lastUpdateTime = mLastUpdateImminentTime.exchange(now);
+    if (now - lastUpdateTime < mUpdateImminentTimeout) {
+        return;
+    }
+
+    std::lock_guard lock(mPowerHalMutex);
+    const sp<V1_3::IPower> powerHal = getPowerHal();
+    if (powerHal == nullptr) {
+        return;
+    }
+    auto ret = powerHal->powerHintAsync(V1_0::PowerHint::INTERACTION, 0);
+    if (!ret.isOk()) {
+        mReconnectPowerHal = true;
+    }
+}
+
 sp<V1_3::IPower> PowerAdvisor::getPowerHal() {
     static sp<V1_3::IPower> sPowerHal_1_3 = nullptr;
     static bool sHasPowerHal_1_3 = true;
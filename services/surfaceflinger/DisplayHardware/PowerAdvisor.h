@@ -22,10 +22,14 @@
 #undef HWC2_INCLUDE_STRINGIFICATION
 #undef HWC2_USE_CPP11
 
+#include <atomic>
+#include <mutex>
 #include <unordered_set>
 
+#include <android-base/thread_annotations.h>
 #include <android/hardware/power/1.3/IPower.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 
 #include "DisplayIdentification.h"
 
@@ -37,6 +41,10 @@ public:
     virtual ~PowerAdvisor();
 
     virtual void setExpensiveRenderingExpected(DisplayId displayId, bool expected) = 0;
+
+    // Called when a frame is about to be composed, ahead of the work for it, so
+    // that the power HAL can ramp up before rather than after a slow frame.
+    virtual void notifyDisplayUpdateImminent() = 0;
 };
 
 namespace impl {
@@ -51,13 +59,24 @@ public:
     ~PowerAdvisor() override;
 
     void setExpensiveRenderingExpected(DisplayId displayId, bool expected) override;
+    void notifyDisplayUpdateImminent() override;
 
 private:
-    sp<V1_3::IPower> getPowerHal();
+    sp<V1_3::IPower> getPowerHal() REQUIRES(mPowerHalMutex);
 
     std::unordered_set<DisplayId> mExpensiveDisplays;
     bool mNotifiedExpensiveRendering = false;
-    bool mReconnectPowerHal = false;
+
+    // Held while talking to the power HAL, since display update notifications
+    // come from binder threads as well as the main thread.
+    std::mutex mPowerHalMutex;
+    bool mReconnectPowerHal GUARDED_BY(mPowerHalMutex) = false;
+
+    // An update after the display has not been updated for this long sends an
+    // interaction boost, as the frame would otherwise start at idle
+    // frequencies. Zero disables the boost.
+    const nsecs_t mUpdateImminentTimeout;
+    std::atomic<nsecs_t> mLastUpdateImminentTime{0};
 };
 
 } // namespace impl
@@ -79,7 +79,7 @@ VirtualDisplaySurface::VirtualDisplaySurface(HWComposer& hwc,
         mDbgState(DBG_STATE_IDLE),
         mDbgLastCompositionType(COMPOSITION_UNKNOWN),
         mMustRecompose(false),
-        mForceHwcCopy(SurfaceFlinger::useHwcForRgbToYuv),
+        mForceHwcCopy(false),
         mSecure(secure),
         mSinkUsage(0) {
     mSource[SOURCE_SINK] = sink;
@@ -101,6 +101,12 @@ VirtualDisplaySurface::VirtualDisplaySurface(HWComposer& hwc,
     sink->query(NATIVE_WINDOW_CONSUMER_USAGE_BITS, &sinkUsage);
     mSinkUsage |= (GRALLOC_USAGE_HW_COMPOSER | sinkUsage);
     setOutputUsage(mSinkUsage);
+
+    // The extra HWC copy of GLES-composed frames only pays off when it saves a
+    // video encoder an RGB-to-YUV conversion. Other sinks take the GLES output
+    // buffer as it is.
+    mForceHwcCopy = SurfaceFlinger::useHwcForRgbToYuv &&
+            (sinkUsage & GRALLOC_USAGE_HW_VIDEO_ENCODER);
     if (sinkUsage & (GRALLOC_USAGE_SW_READ_MASK | GRALLOC_USAGE_SW_WRITE_MASK)) {
         int sinkFormat;
         sink->query(NATIVE_WINDOW_FORMAT, &sinkFormat);
@@ -160,7 +166,8 @@ status_t VirtualDisplaySurface::prepareFrame(CompositionType compositionType) {
         // directly to the consumer.
         //
         // On the other hand, when the consumer prefers RGB or can consume RGB
-        // inexpensively, this forces an unnecessary copy.
+        // inexpensively, this forces an unnecessary copy, so this is only
+        // done for video encoder sinks.
         mCompositionType = COMPOSITION_MIXED;
     }
 
@@ -77,7 +77,8 @@ Layer::Layer(const LayerCreationArgs& args)
       : mFlinger(args.flinger),
         mName(args.name),
         mClientRef(args.client),
-        mWindowType(args.metadata.getInt32(METADATA_WINDOW_TYPE, 0)) {
+        mWindowType(args.metadata.getInt32(METADATA_WINDOW_TYPE, 0)),
+        mOwnerUid(args.metadata.getInt32(METADATA_OWNER_UID, -1)) {
     mCurrentCrop.makeInvalid();
 
     uint32_t layerFlags = 0;
@@ -919,9 +920,28 @@ uint32_t Layer::doTransaction(uint32_t flags) {
 }
 
 void Layer::commitTransaction(const State& stateToCommit) {
+    if (mDrawingState.z != stateToCommit.z ||
+        mDrawingState.layerStack != stateToCommit.layerStack ||
+        mDrawingState.zOrderRelativeOf != stateToCommit.zOrderRelativeOf ||
+        !hasSameRelatives(mDrawingState.zOrderRelatives, stateToCommit.zOrderRelatives)) {
+        mFlinger->mDrawingState.invalidateZOrderCache();
+    }
     mDrawingState = stateToCommit;
 }
 
+bool Layer::hasSameRelatives(const SortedVector<wp<Layer>>& lhs,
+                             const SortedVector<wp<Layer>>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); i++) {
+        if (lhs[i] != rhs[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 uint32_t Layer::getTransactionFlags(uint32_t flags) {
     return mTransactionFlags.fetch_and(~flags) & flags;
 }
@@ -1422,7 +1442,8 @@ void Layer::addAndGetFrameTimestamps(const NewFrameEventsEntry* newTimestamps,
                                      FrameEventHistoryDelta* outDelta) {
     if (newTimestamps) {
         mFlinger->mTimeStats->setPostTime(getSequence(), newTimestamps->frameNumber,
-                                          getName().c_str(), newTimestamps->postedTime);
+                                          getName().c_str(), getOwnerUid(),
+                                          newTimestamps->postedTime);
     }
 
     Mutex::Autolock lock(mFrameEventHistoryMutex);
@@ -1442,6 +1463,11 @@ void Layer::addAndGetFrameTimestamps(const NewFrameEventsEntry* newTimestamps,
     }
 }
 
+sp<IMemory> Layer::getFrameTimestampsMemory() {
+    Mutex::Autolock lock(mFrameEventHistoryMutex);
+    return mFrameEventHistory.getSharedTimestampsMemory();
+}
+
 size_t Layer::getChildrenCount() const {
     size_t count = 0;
     for (const sp<Layer>& child : mCurrentChildren) {
@@ -1854,6 +1880,9 @@ void Layer::commitChildList() {
         const auto& child = mCurrentChildren[i];
         child->commitChildList();
     }
+    if (!mDrawingChildren.hasSameLayers(mCurrentChildren)) {
+        mFlinger->mDrawingState.invalidateZOrderCache();
+    }
     mDrawingChildren = mCurrentChildren;
     mDrawingParent = mCurrentParent;
 }
@@ -104,6 +104,8 @@ public:
     Region coveredRegion;
     Region visibleNonTransparentRegion;
     Region surfaceDamageRegion;
+    // changes every time the regions above are recomputed
+    uint64_t visibilityGeneration{0};
 
     // Layer serial number.  This gives layers an explicit ordering, so we
     // have a stable sort order when their layer stack and Z-order are
@@ -615,6 +617,12 @@ public:
      */
     virtual bool hasReadyFrame() const { return false; }
 
+    /*
+     * Returns if the ready frame can be latched without waiting for its
+     * acquire fence
+     */
+    virtual bool isReadyFrameSignaled() const { return true; }
+
     virtual int32_t getQueuedFrameCount() const { return 0; }
 
     // -----------------------------------------------------------------------
@@ -644,6 +652,7 @@ public:
     void onDisconnect();
     void addAndGetFrameTimestamps(const NewFrameEventsEntry* newEntry,
                                   FrameEventHistoryDelta* outDelta);
+    sp<IMemory> getFrameTimestampsMemory();
 
     virtual bool getTransformToDisplayInverse() const { return false; }
 
@@ -681,6 +690,9 @@ public:
     sp<Layer> getParent() const { return mCurrentParent.promote(); }
     bool hasParent() const { return getParent() != nullptr; }
     Rect getScreenBounds(bool reduceTransparentRegion = true) const;
+    // Returns the part of the screen, in layer stack space, that changed when
+    // the current buffer was latched. Defaults to the whole layer.
+    virtual Region getScreenDamage() const { return Region(getScreenBounds()); }
     bool setChildLayer(const sp<Layer>& childLayer, int32_t z);
     bool setChildRelativeLayer(const sp<Layer>& childLayer,
             const sp<IBinder>& relativeToHandle, int32_t relativeZ);
@@ -737,6 +749,8 @@ protected:
     friend class TestableSurfaceFlinger;
 
     virtual void commitTransaction(const State& stateToCommit);
+    static bool hasSameRelatives(const SortedVector<wp<Layer>>& lhs,
+                                 const SortedVector<wp<Layer>>& rhs);
 
     uint32_t getEffectiveUsage(uint32_t usage) const;
 
@@ -820,6 +834,7 @@ public:
     // this to be called once.
     sp<IBinder> getHandle();
     const String8& getName() const;
+    int getOwnerUid() const { return mOwnerUid; }
     virtual void notifyAvailableFrames() {}
     virtual PixelFormat getPixelFormat() const { return PIXEL_FORMAT_NONE; }
     bool getPremultipledAlpha() const;
@@ -908,6 +923,8 @@ protected:
 
     // Window types from WindowManager.LayoutParams
     const int mWindowType;
+    // Uid of the app owning this layer as given at creation, or -1 if unknown
+    const int mOwnerUid;
 
     // This is populated if the layer is registered with Scheduler for tracking purposes.
     std::unique_ptr<scheduler::LayerHistory::LayerHandle> mSchedulerLayerHandle;
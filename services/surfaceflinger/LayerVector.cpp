@@ -59,6 +59,21 @@ int LayerVector::do_compare(const void* lhs, const void* rhs) const
     return (l->sequence > r->sequence) ? 1 : -1;
 }
 
+bool LayerVector::hasSameLayers(const LayerVector& other) const {
+    if (array() == other.array()) {
+        return true;
+    }
+    if (size() != other.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < size(); i++) {
+        if ((*this)[i] != other[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void LayerVector::traverseInZOrder(StateSet stateSet, const Visitor& visitor) const {
     for (size_t i = 0; i < size(); i++) {
         const auto& layer = (*this)[i];
@@ -47,6 +47,9 @@ public:
     // Sorts layer by layer-stack, Z order, and finally creation order (sequence).
     int do_compare(const void* lhs, const void* rhs) const override;
 
+    // Returns true if both vectors hold the same layers in the same order.
+    bool hasSameLayers(const LayerVector& other) const;
+
     using Visitor = std::function<void(Layer*)>;
     void traverseInReverseZOrder(StateSet stateSet, const Visitor& visitor) const;
     void traverseInZOrder(StateSet stateSet, const Visitor& visitor) const;
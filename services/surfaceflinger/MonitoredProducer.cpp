@@ -86,6 +86,16 @@ status_t MonitoredProducer::cancelBuffer(int slot, const sp<Fence>& fence) {
     return mProducer->cancelBuffer(slot, fence);
 }
 
+status_t MonitoredProducer::dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                                           std::vector<DequeueBufferOutput>* outputs) {
+    return mProducer->dequeueBuffers(inputs, outputs);
+}
+
+status_t MonitoredProducer::queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                                         std::vector<QueueBufferOutput>* outputs) {
+    return mProducer->queueBuffers(requests, outputs);
+}
+
 int MonitoredProducer::query(int what, int* value) {
     return mProducer->query(what, value);
 }
@@ -108,6 +118,11 @@ void MonitoredProducer::allocateBuffers(uint32_t width, uint32_t height,
     mProducer->allocateBuffers(width, height, format, usage);
 }
 
+void MonitoredProducer::reallocateBuffers(uint32_t width, uint32_t height,
+        PixelFormat format, uint64_t usage) {
+    mProducer->reallocateBuffers(width, height, format, usage);
+}
+
 status_t MonitoredProducer::allowAllocation(bool allow) {
     return mProducer->allowAllocation(allow);
 }
@@ -146,6 +161,10 @@ void MonitoredProducer::getFrameTimestamps(FrameEventHistoryDelta* outDelta) {
     mProducer->getFrameTimestamps(outDelta);
 }
 
+status_t MonitoredProducer::getFrameTimestampsMemory(sp<IMemory>* outMemory) {
+    return mProducer->getFrameTimestampsMemory(outMemory);
+}
+
 status_t MonitoredProducer::getUniqueId(uint64_t* outId) const {
     return mProducer->getUniqueId(outId);
 }
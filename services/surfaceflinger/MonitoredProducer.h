@@ -50,6 +50,10 @@ public:
     virtual status_t queueBuffer(int slot, const QueueBufferInput& input,
             QueueBufferOutput* output);
     virtual status_t cancelBuffer(int slot, const sp<Fence>& fence);
+    virtual status_t dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                                    std::vector<DequeueBufferOutput>* outputs) override;
+    virtual status_t queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                                  std::vector<QueueBufferOutput>* outputs) override;
     virtual int query(int what, int* value);
     virtual status_t connect(const sp<IProducerListener>& token, int api,
             bool producerControlledByApp, QueueBufferOutput* output);
@@ -57,6 +61,8 @@ public:
     virtual status_t setSidebandStream(const sp<NativeHandle>& stream);
     virtual void allocateBuffers(uint32_t width, uint32_t height,
             PixelFormat format, uint64_t usage);
+    virtual void reallocateBuffers(uint32_t width, uint32_t height,
+            PixelFormat format, uint64_t usage) override;
     virtual status_t allowAllocation(bool allow);
     virtual status_t setGenerationNumber(uint32_t generationNumber);
     virtual String8 getConsumerName() const override;
@@ -68,6 +74,7 @@ public:
     virtual status_t setSharedBufferMode(bool sharedBufferMode) override;
     virtual status_t setAutoRefresh(bool autoRefresh) override;
     virtual void getFrameTimestamps(FrameEventHistoryDelta *outDelta) override;
+    virtual status_t getFrameTimestampsMemory(sp<IMemory>* outMemory) override;
     virtual status_t getUniqueId(uint64_t* outId) const override;
     virtual status_t getConsumerUsage(uint64_t* outUsage) const override;
 
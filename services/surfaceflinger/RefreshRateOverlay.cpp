@@ -15,7 +15,11 @@
  */
 
 #include "RefreshRateOverlay.h"
+
+#include <algorithm>
+
 #include "Client.h"
+#include "ClientCache.h"
 #include "Layer.h"
 
 namespace android {
@@ -24,22 +28,64 @@ using RefreshRateType = scheduler::RefreshRateConfigs::RefreshRateType;
 
 RefreshRateOverlay::RefreshRateOverlay(SurfaceFlinger& flinger)
       : mFlinger(flinger), mClient(new Client(&mFlinger)) {
+    mRedBuffer = createBuffer(RED);
+    mGreenBuffer = createBuffer(GREEN);
+    mRedCacheId = cacheBuffer(mRedBuffer);
+    mGreenCacheId = cacheBuffer(mGreenBuffer);
     createLayer();
 }
 
+RefreshRateOverlay::~RefreshRateOverlay() {
+    if (mRedCacheId.isValid() || mGreenCacheId.isValid()) {
+        ClientCache::getInstance().removeProcess(IInterface::asBinder(mClient));
+    }
+}
+
+client_cache_t RefreshRateOverlay::cacheBuffer(const sp<GraphicBuffer>& buffer) const {
+    if (buffer == nullptr) {
+        return client_cache_t();
+    }
+    client_cache_t cacheId;
+    cacheId.token = IInterface::asBinder(mClient);
+    cacheId.id = buffer->getId();
+    ClientCache::getInstance().add(cacheId, buffer);
+    return cacheId;
+}
+
+sp<GraphicBuffer> RefreshRateOverlay::createBuffer(uint32_t color) const {
+    sp<GraphicBuffer> buffer =
+            new GraphicBuffer(mFrame.getWidth(), mFrame.getHeight(), HAL_PIXEL_FORMAT_RGBA_8888, 1,
+                              GRALLOC_USAGE_SW_WRITE_RARELY | GRALLOC_USAGE_HW_COMPOSER |
+                                      GRALLOC_USAGE_HW_TEXTURE,
+                              "RefreshRateOverlayBuffer");
+    uint32_t* pixels;
+    if (buffer->initCheck() != NO_ERROR ||
+        buffer->lock(GRALLOC_USAGE_SW_WRITE_RARELY, reinterpret_cast<void**>(&pixels)) !=
+                NO_ERROR) {
+        ALOGE("failed to allocate overlay buffer");
+        return nullptr;
+    }
+    for (uint32_t y = 0; y < buffer->getHeight(); y++) {
+        std::fill_n(pixels + y * buffer->getStride(), buffer->getWidth(), color);
+    }
+    buffer->unlock();
+    return buffer;
+}
+
 bool RefreshRateOverlay::createLayer() {
     const status_t ret =
             mFlinger.createLayer(String8("RefreshRateOverlay"), mClient, 0, 0,
-                                 PIXEL_FORMAT_RGBA_8888, ISurfaceComposerClient::eFXSurfaceColor,
-                                 LayerMetadata(), &mIBinder, &mGbp, nullptr);
+                                 PIXEL_FORMAT_RGBA_8888,
+                                 ISurfaceComposerClient::eFXSurfaceBufferState, LayerMetadata(),
+                                 &mIBinder, &mGbp, nullptr);
     if (ret) {
-        ALOGE("failed to create color layer");
+        ALOGE("failed to create buffer state layer");
         return false;
     }
 
     Mutex::Autolock _l(mFlinger.mStateLock);
     mLayer = mClient->getLayerUser(mIBinder);
-    mLayer->setCrop_legacy(Rect(50, 70, 200, 100), true);
+    mLayer->setFrame(mFrame);
 
     // setting Layer's Z requires resorting layersSortedByZ
     ssize_t idx = mFlinger.mCurrentState.layersSortedByZ.indexOf(mLayer);
@@ -52,8 +98,17 @@ bool RefreshRateOverlay::createLayer() {
 }
 
 void RefreshRateOverlay::changeRefreshRate(RefreshRateType type) {
-    const half3& color = (type == RefreshRateType::PERFORMANCE) ? GREEN : RED;
-    mLayer->setColor(color);
+    if (mLayer == nullptr) {
+        return;
+    }
+    const bool performance = type == RefreshRateType::PERFORMANCE;
+    const sp<GraphicBuffer>& buffer = performance ? mGreenBuffer : mRedBuffer;
+    if (buffer == nullptr) {
+        return;
+    }
+    mLayer->setBuffer(buffer, systemTime(), -1 /* desiredPresentTime */,
+                      performance ? mGreenCacheId : mRedCacheId);
+    mLayer->setAcquireFence(Fence::NO_FENCE);
     mFlinger.mTransactionFlags.fetch_or(eTransactionMask);
 }
 
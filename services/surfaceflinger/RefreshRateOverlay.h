@@ -15,6 +15,8 @@
  */
 #pragma once
 
+#include <ui/GraphicBuffer.h>
+
 #include "SurfaceFlinger.h"
 
 namespace android {
@@ -24,11 +26,14 @@ using RefreshRateType = scheduler::RefreshRateConfigs::RefreshRateType;
 class RefreshRateOverlay {
 public:
     RefreshRateOverlay(SurfaceFlinger& flinger);
+    ~RefreshRateOverlay();
 
     void changeRefreshRate(RefreshRateType type);
 
 private:
     bool createLayer();
+    sp<GraphicBuffer> createBuffer(uint32_t color) const;
+    client_cache_t cacheBuffer(const sp<GraphicBuffer>& buffer) const;
 
     SurfaceFlinger& mFlinger;
     sp<Client> mClient;
@@ -36,8 +41,18 @@ private:
     sp<IBinder> mIBinder;
     sp<IGraphicBufferProducer> mGbp;
 
-    const half3 RED = half3(1.0f, 0.0f, 0.0f);
-    const half3 GREEN = half3(0.0f, 1.0f, 0.0f);
+    // The indicator is a buffer layer rather than a color layer, so that the composer can
+    // always compose it as a device layer instead of falling back to client composition
+    // for the whole display. Both buffers are drawn once, up front.
+    const Rect mFrame = Rect(50, 70, 200, 100);
+    // RGBA_8888 pixels, red in the lowest byte.
+    static constexpr uint32_t RED = 0xff0000ff;
+    static constexpr uint32_t GREEN = 0xff00ff00;
+    sp<GraphicBuffer> mRedBuffer;
+    sp<GraphicBuffer> mGreenBuffer;
+    // Both buffers are cached under mClient, so that the layer keeps one HWC slot for each.
+    client_cache_t mRedCacheId;
+    client_cache_t mGreenCacheId;
 };
 
 }; // namespace android
@@ -49,6 +49,13 @@ enum class samplingStep {
     sample
 };
 
+// The sampled area is rendered downscaled by an integer factor so that it
+// covers at most this many pixels. The GPU then does most of the reduction
+// while rendering, and the CPU only maps and walks a small buffer, however
+// large or spread out the sampling areas are. The median luma of an evenly
+// subsampled area closely tracks that of the full area.
+constexpr int32_t kMaxSampledPixels = 256 * 256;
+
 constexpr auto defaultRegionSamplingOffset = -3ms;
 constexpr auto defaultRegionSamplingPeriod = 100ms;
 constexpr auto defaultRegionSamplingTimerTimeout = 100ms;
@@ -312,11 +319,26 @@ float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t st
     return bucket / 255.0f;
 }
 
+int32_t getSamplingScale(int32_t width, int32_t height) {
+    int32_t scale = 1;
+    while (static_cast<int64_t>((width + scale - 1) / scale) * ((height + scale - 1) / scale) >
+           kMaxSampledPixels) {
+        scale++;
+    }
+    return scale;
+}
+
+Rect scaleSamplingArea(const Rect& area, int32_t scale) {
+    return Rect(area.left / scale, area.top / scale, (area.right + scale - 1) / scale,
+                (area.bottom + scale - 1) / scale);
+}
+
 std::vector<float> RegionSamplingThread::sampleBuffer(
-        const sp<GraphicBuffer>& buffer, const Point& leftTop,
-        const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation) {
+        const sp<GraphicBuffer>& buffer, base::unique_fd fence, const Point& leftTop,
+        int32_t scale, const std::vector<RegionSamplingThread::Descriptor>& descriptors,
+        uint32_t orientation) {
     void* data_raw = nullptr;
-    buffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, &data_raw);
+    buffer->lockAsync(GRALLOC_USAGE_SW_READ_OFTEN, &data_raw, fence.release());
     std::shared_ptr<uint32_t> data(reinterpret_cast<uint32_t*>(data_raw),
                                    [&buffer](auto) { buffer->unlock(); });
     if (!data) return {};
@@ -327,8 +349,9 @@ std::vector<float> RegionSamplingThread::sampleBuffer(
     std::vector<float> lumas(descriptors.size());
     std::transform(descriptors.begin(), descriptors.end(), lumas.begin(),
                    [&](auto const& descriptor) {
-                       return sampleArea(data.get(), width, height, stride, orientation,
-                                         descriptor.area - leftTop);
+                       Rect area = scaleSamplingArea(descriptor.area - leftTop, scale);
+                       area.intersect(Rect(width, height), &area);
+                       return sampleArea(data.get(), width, height, stride, orientation, area);
                    });
     return lumas;
 }
@@ -354,6 +377,10 @@ void RegionSamplingThread::captureSample() {
     }
 
     const Rect sampledArea = sampleRegion.bounds();
+    const int32_t scale = getSamplingScale(sampledArea.getWidth(), sampledArea.getHeight());
+    const Rect scaledArea = scaleSamplingArea(Rect(sampledArea.getWidth(),
+                                                   sampledArea.getHeight()),
+                                              scale);
 
     auto dx = 0;
     auto dy = 0;
@@ -375,8 +402,8 @@ void RegionSamplingThread::captureSample() {
     ui::Transform t(orientation);
     auto screencapRegion = t.transform(sampleRegion);
     screencapRegion = screencapRegion.translate(dx, dy);
-    DisplayRenderArea renderArea(device, screencapRegion.bounds(), sampledArea.getWidth(),
-                                 sampledArea.getHeight(), ui::Dataspace::V0_SRGB, orientation);
+    DisplayRenderArea renderArea(device, screencapRegion.bounds(), scaledArea.getWidth(),
+                                 scaledArea.getHeight(), ui::Dataspace::V0_SRGB, orientation);
 
     std::unordered_set<sp<IRegionSamplingListener>, SpHash<IRegionSamplingListener>> listeners;
 
@@ -422,17 +449,20 @@ void RegionSamplingThread::captureSample() {
     };
 
     sp<GraphicBuffer> buffer = nullptr;
-    if (mCachedBuffer && mCachedBuffer->getWidth() == sampledArea.getWidth() &&
-        mCachedBuffer->getHeight() == sampledArea.getHeight()) {
+    if (mCachedBuffer && mCachedBuffer->getWidth() == scaledArea.getWidth() &&
+        mCachedBuffer->getHeight() == scaledArea.getHeight()) {
         buffer = mCachedBuffer;
     } else {
         const uint32_t usage = GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER;
-        buffer = new GraphicBuffer(sampledArea.getWidth(), sampledArea.getHeight(),
+        buffer = new GraphicBuffer(scaledArea.getWidth(), scaledArea.getHeight(),
                                    PIXEL_FORMAT_RGBA_8888, 1, usage, "RegionSamplingThread");
     }
 
+    // The mapper waits for the render to finish when the buffer is locked for
+    // sampling, so there is no need to block on the fence until then.
     bool ignored;
-    mFlinger.captureScreenCommon(renderArea, traverseLayers, buffer, false, ignored);
+    base::unique_fd fence;
+    mFlinger.captureScreenCommonAsync(renderArea, traverseLayers, buffer, false, ignored, &fence);
 
     std::vector<Descriptor> activeDescriptors;
     for (const auto& descriptor : descriptors) {
@@ -443,7 +473,8 @@ void RegionSamplingThread::captureSample() {
 
     ALOGV("Sampling %zu descriptors", activeDescriptors.size());
     std::vector<float> lumas =
-            sampleBuffer(buffer, sampledArea.leftTop(), activeDescriptors, orientation);
+            sampleBuffer(buffer, std::move(fence), sampledArea.leftTop(), scale, activeDescriptors,
+                         orientation);
     if (lumas.size() != activeDescriptors.size()) {
         ALOGW("collected %zu median luma values for %zu descriptors", lumas.size(),
               activeDescriptors.size());
@@ -23,6 +23,7 @@
 #include <unordered_map>
 
 #include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
 #include <binder/IBinder.h>
 #include <ui/GraphicBuffer.h>
 #include <ui/Rect.h>
@@ -39,6 +40,11 @@ struct SamplingOffsetCallback;
 
 float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
                  uint32_t orientation, const Rect& area);
+// Returns the smallest integer factor by which a width x height area must be
+// downscaled to be sampled.
+int32_t getSamplingScale(int32_t width, int32_t height);
+// Maps an area to a buffer downscaled by scale, rounding outwards.
+Rect scaleSamplingArea(const Rect& area, int32_t scale);
 
 class RegionSamplingThread : public IBinder::DeathRecipient {
 public:
@@ -94,8 +100,8 @@ private:
         }
     };
     std::vector<float> sampleBuffer(
-            const sp<GraphicBuffer>& buffer, const Point& leftTop,
-            const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation);
+            const sp<GraphicBuffer>& buffer, base::unique_fd fence, const Point& leftTop,
+            int32_t scale, const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation);
 
     void doSample();
     void binderDied(const wp<IBinder>& who) override;
@@ -23,6 +23,7 @@
 #include <math.h>
 
 #include <algorithm>
+#include <cmath>
 
 #include <android-base/stringprintf.h>
 #include <cutils/properties.h>
@@ -57,6 +58,15 @@ static const bool kEnableZeroPhaseTracer = false;
 // present time and the nearest software-predicted vsync.
 static const nsecs_t kErrorThreshold = 160000000000; // 400 usec squared
 
+// Resync samples further than this from the fitted vsync line (or three
+// standard deviations, if larger) are rejected as outliers. A fit whose
+// residual reaches this value has no confidence.
+static const nsecs_t kMinOutlierThreshold = 200000; // 200 usec
+
+// Model confidence above which the model is used before
+// MIN_RESYNC_SAMPLES_FOR_UPDATE samples have been collected.
+static const double kHighConfidence = 0.9;
+
 #undef LOG_TAG
 #define LOG_TAG "DispSyncThread"
 class DispSyncThread : public Thread {
@@ -516,6 +526,7 @@ void DispSync::resetLocked() {
         mReferenceTime = mResyncSamples[lastSampleIdx];
     }
     mModelUpdated = false;
+    mModelConfidence = 0;
     for (size_t i = 0; i < MAX_RESYNC_SAMPLES; i++) {
         mResyncSamples[i] = 0;
     }
@@ -547,6 +558,7 @@ void DispSync::beginResync() {
     ALOGV("[%s] beginResync", mName);
     mThread->unlockModel();
     mModelUpdated = false;
+    mModelConfidence = 0;
     mNumResyncSamples = 0;
 }
 
@@ -657,58 +669,148 @@ nsecs_t DispSync::getPeriod() {
 
 void DispSync::updateModelLocked() {
     ALOGV("[%s] updateModelLocked %zu", mName, mNumResyncSamples);
-    if (mNumResyncSamples >= MIN_RESYNC_SAMPLES_FOR_UPDATE) {
-        ALOGV("[%s] Computing...", mName);
-        nsecs_t durationSum = 0;
-        nsecs_t minDuration = INT64_MAX;
-        nsecs_t maxDuration = 0;
-        for (size_t i = 1; i < mNumResyncSamples; i++) {
-            size_t idx = (mFirstResyncSample + i) % MAX_RESYNC_SAMPLES;
-            size_t prev = (idx + MAX_RESYNC_SAMPLES - 1) % MAX_RESYNC_SAMPLES;
-            nsecs_t duration = mResyncSamples[idx] - mResyncSamples[prev];
-            durationSum += duration;
-            minDuration = min(minDuration, duration);
-            maxDuration = max(maxDuration, duration);
-        }
+    if (mNumResyncSamples < MIN_RESYNC_SAMPLES_FOR_FIT) {
+        return;
+    }
+    ALOGV("[%s] Computing...", mName);
 
-        // Exclude the min and max from the average
-        durationSum -= minDuration + maxDuration;
-        mPeriod = durationSum / (mNumResyncSamples - 3);
-
-        ALOGV("[%s] mPeriod = %" PRId64, mName, ns2us(mPeriod));
-
-        double sampleAvgX = 0;
-        double sampleAvgY = 0;
-        double scale = 2.0 * M_PI / double(mPeriod);
-        // Intentionally skip the first sample
-        for (size_t i = 1; i < mNumResyncSamples; i++) {
-            size_t idx = (mFirstResyncSample + i) % MAX_RESYNC_SAMPLES;
-            nsecs_t sample = mResyncSamples[idx] - mReferenceTime;
-            double samplePhase = double(sample % mPeriod) * scale;
-            sampleAvgX += cos(samplePhase);
-            sampleAvgY += sin(samplePhase);
+    nsecs_t samples[MAX_RESYNC_SAMPLES];
+    nsecs_t durations[MAX_RESYNC_SAMPLES];
+    const size_t numSamples = mNumResyncSamples;
+    for (size_t i = 0; i < numSamples; i++) {
+        samples[i] = mResyncSamples[(mFirstResyncSample + i) % MAX_RESYNC_SAMPLES];
+        if (i > 0) {
+            durations[i - 1] = samples[i] - samples[i - 1];
         }
+    }
+
+    // The median duration is a period estimate that is robust against missed
+    // vsyncs and bad timestamps. It is only used to number the samples, the
+    // period itself comes from the fit below.
+    const size_t numDurations = numSamples - 1;
+    std::nth_element(durations, durations + numDurations / 2, durations + numDurations);
+    const nsecs_t periodEstimate = durations[numDurations / 2];
+    if (periodEstimate <= 0) {
+        return;
+    }
 
-        sampleAvgX /= double(mNumResyncSamples - 1);
-        sampleAvgY /= double(mNumResyncSamples - 1);
+    // Fit sample = intercept + period * vsyncIndex with least squares, then
+    // fit again without the samples that are too far off the first line.
+    double x[MAX_RESYNC_SAMPLES];
+    double y[MAX_RESYNC_SAMPLES];
+    bool inlier[MAX_RESYNC_SAMPLES];
+    for (size_t i = 0; i < numSamples; i++) {
+        y[i] = double(samples[i] - samples[0]);
+        x[i] = std::round(y[i] / double(periodEstimate));
+        inlier[i] = true;
+    }
 
-        mPhase = nsecs_t(atan2(sampleAvgY, sampleAvgX) / scale);
+    double slope = 0;
+    double intercept = 0;
+    if (!fitLine(x, y, inlier, numSamples, &slope, &intercept)) {
+        return;
+    }
 
-        ALOGV("[%s] mPhase = %" PRId64, mName, ns2us(mPhase));
+    double residuals[MAX_RESYNC_SAMPLES];
+    for (size_t i = 0; i < numSamples; i++) {
+        residuals[i] = std::abs(y[i] - (intercept + slope * x[i]));
+    }
+    double sortedResiduals[MAX_RESYNC_SAMPLES];
+    std::copy(residuals, residuals + numSamples, sortedResiduals);
+    std::nth_element(sortedResiduals, sortedResiduals + numSamples / 2,
+                     sortedResiduals + numSamples);
+    // 1.4826 scales the median absolute deviation to a standard deviation.
+    const double outlierThreshold =
+            std::max(double(kMinOutlierThreshold), 3.0 * 1.4826 * sortedResiduals[numSamples / 2]);
 
-        if (mPhase < -(mPeriod / 2)) {
-            mPhase += mPeriod;
-            ALOGV("[%s] Adjusting mPhase -> %" PRId64, mName, ns2us(mPhase));
+    size_t numInliers = 0;
+    for (size_t i = 0; i < numSamples; i++) {
+        inlier[i] = residuals[i] <= outlierThreshold;
+        numInliers += inlier[i];
+    }
+    if (numInliers < numSamples && numInliers >= MIN_RESYNC_SAMPLES_FOR_FIT) {
+        fitLine(x, y, inlier, numSamples, &slope, &intercept);
+    } else {
+        std::fill(inlier, inlier + numSamples, true);
+        numInliers = numSamples;
+    }
+
+    double sqErrSum = 0;
+    for (size_t i = 0; i < numSamples; i++) {
+        if (inlier[i]) {
+            const double err = y[i] - (intercept + slope * x[i]);
+            sqErrSum += err * err;
         }
+    }
+    mModelResidual = nsecs_t(std::sqrt(sqErrSum / numInliers));
+    mNumOutlierSamples = numSamples - numInliers;
 
-        // Artificially inflate the period if requested.
-        mPeriod += mPeriod * mRefreshSkipCount;
+    // Confidence grows with the number of inliers and shrinks with the fit
+    // residual and the share of rejected samples.
+    const double sampleFactor =
+            std::min(1.0, double(numInliers - 2) / (MIN_RESYNC_SAMPLES_FOR_FIT - 2));
+    const double residualFactor =
+            std::max(0.0, 1.0 - double(mModelResidual) / kMinOutlierThreshold);
+    mModelConfidence = sampleFactor * residualFactor * double(numInliers) / double(numSamples);
 
+    mPeriod = nsecs_t(std::round(slope));
+    ALOGV("[%s] mPeriod = %" PRId64, mName, ns2us(mPeriod));
+
+    // Express the phase relative to mReferenceTime, in [-mPeriod / 2, mPeriod / 2].
+    const double offset = double(samples[0] - mReferenceTime) + intercept;
+    mPhase = nsecs_t(std::round(offset - slope * std::round(offset / slope)));
+    ALOGV("[%s] mPhase = %" PRId64, mName, ns2us(mPhase));
+
+    // Artificially inflate the period if requested.
+    mPeriod += mPeriod * mRefreshSkipCount;
+
+    if (mTraceDetailedInfo) {
+        ATRACE_INT("DispSync:Confidence", int32_t(mModelConfidence * 100));
+        ATRACE_INT64("DispSync:Residual", mModelResidual);
+    }
+
+    // With a confident fit we can stop sampling before the usual number of
+    // samples, which lets HW vsync be turned off sooner.
+    if (numSamples >= MIN_RESYNC_SAMPLES_FOR_UPDATE || mModelConfidence >= kHighConfidence) {
         mThread->updateModel(mPeriod, mPhase, mReferenceTime);
         mModelUpdated = true;
     }
 }
 
+bool DispSync::fitLine(const double* x, const double* y, const bool* use, size_t count,
+                       double* outSlope, double* outIntercept) {
+    double sumX = 0;
+    double sumY = 0;
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (use[i]) {
+            sumX += x[i];
+            sumY += y[i];
+            n++;
+        }
+    }
+    if (n < 2) {
+        return false;
+    }
+    const double meanX = sumX / n;
+    const double meanY = sumY / n;
+
+    double sxx = 0;
+    double sxy = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (use[i]) {
+            sxx += (x[i] - meanX) * (x[i] - meanX);
+            sxy += (x[i] - meanX) * (y[i] - meanY);
+        }
+    }
+    if (sxx == 0 || sxy <= 0) {
+        return false;
+    }
+    *outSlope = sxy / sxx;
+    *outIntercept = meanY - *outSlope * meanX;
+    return true;
+}
+
 void DispSync::updateErrorLocked() {
     if (!mModelUpdated) {
         return;
@@ -794,6 +896,8 @@ void DispSync::dump(std::string& result) const {
                   1000000000.0 / mPeriod, mRefreshSkipCount);
     StringAppendF(&result, "mPhase: %" PRId64 " ns\n", mPhase);
     StringAppendF(&result, "mError: %" PRId64 " ns (sqrt=%.1f)\n", mError, sqrt(mError));
+    StringAppendF(&result, "model confidence: %.2f (residual %" PRId64 " ns, %zu outliers)\n",
+                  mModelConfidence, mModelResidual, mNumOutlierSamples);
     StringAppendF(&result, "mNumResyncSamplesSincePresent: %d (limit %d)\n",
                   mNumResyncSamplesSincePresent, MAX_RESYNC_SAMPLES_WITHOUT_PRESENT);
     StringAppendF(&result, "mNumResyncSamples: %zd (max %d)\n", mNumResyncSamples,
@@ -189,12 +189,17 @@ public:
 
 private:
     void updateModelLocked();
+    // Least-squares fit of y = intercept + slope * x over the points with use[i]
+    // set. Returns false if the points do not determine an increasing line.
+    static bool fitLine(const double* x, const double* y, const bool* use, size_t count,
+                        double* outSlope, double* outIntercept);
     void updateErrorLocked();
     void resetLocked();
     void resetErrorLocked();
 
     enum { MAX_RESYNC_SAMPLES = 32 };
     enum { MIN_RESYNC_SAMPLES_FOR_UPDATE = 6 };
+    enum { MIN_RESYNC_SAMPLES_FOR_FIT = 4 };
     enum { NUM_PRESENT_SAMPLES = 8 };
     enum { MAX_RESYNC_SAMPLES_WITHOUT_PRESENT = 4 };
     enum { ACCEPTABLE_ZERO_ERR_SAMPLES_COUNT = 64 };
@@ -232,6 +237,13 @@ private:
     // Whether we have updated the vsync event model since the last resync.
     bool mModelUpdated;
 
+    // How well the resync samples fit the model, from 0 to 1, the RMS
+    // distance of the accepted samples from the model and the number of
+    // samples rejected as outliers by the last model update.
+    double mModelConfidence = 0;
+    nsecs_t mModelResidual = 0;
+    size_t mNumOutlierSamples = 0;
+
     // These member variables are the state used during the resynchronization
     // process to store information about the hardware vsync event times used
     // to compute the model.
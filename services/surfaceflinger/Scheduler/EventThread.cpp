@@ -21,6 +21,7 @@
 #include <sched.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <optional>
@@ -228,6 +229,15 @@ status_t EventThread::registerDisplayEventConnection(const sp<EventThreadConnect
         return ALREADY_EXISTS;
     }
 
+    // Dead connections are otherwise only dropped when a hotplug or config
+    // change event is dispatched.
+    mDisplayEventConnections.erase(std::remove_if(mDisplayEventConnections.begin(),
+                                                  mDisplayEventConnections.end(),
+                                                  [](const wp<EventThreadConnection>& ptr) {
+                                                      return ptr.promote() == nullptr;
+                                                  }),
+                                   mDisplayEventConnections.end());
+
     mDisplayEventConnections.push_back(connection);
     mCondition.notify_all();
     return NO_ERROR;
@@ -239,6 +249,14 @@ void EventThread::removeDisplayEventConnectionLocked(const wp<EventThreadConnect
     if (it != mDisplayEventConnections.cend()) {
         mDisplayEventConnections.erase(it);
     }
+    removeVSyncRequestLocked(connection);
+}
+
+void EventThread::removeVSyncRequestLocked(const wp<EventThreadConnection>& connection) {
+    auto it = std::find(mVSyncRequests.cbegin(), mVSyncRequests.cend(), connection);
+    if (it != mVSyncRequests.cend()) {
+        mVSyncRequests.erase(it);
+    }
 }
 
 void EventThread::setVsyncRate(uint32_t rate, const sp<EventThreadConnection>& connection) {
@@ -250,6 +268,11 @@ void EventThread::setVsyncRate(uint32_t rate, const sp<EventThreadConnection>& c
 
     const auto request = rate == 0 ? VSyncRequest::None : static_cast<VSyncRequest>(rate);
     if (connection->vsyncRequest != request) {
+        if (connection->vsyncRequest == VSyncRequest::None) {
+            mVSyncRequests.push_back(connection);
+        } else if (request == VSyncRequest::None) {
+            removeVSyncRequestLocked(connection);
+        }
         connection->vsyncRequest = request;
         mCondition.notify_all();
     }
@@ -264,7 +287,12 @@ void EventThread::requestNextVsync(const sp<EventThreadConnection>& connection)
 
     if (connection->vsyncRequest == VSyncRequest::None) {
         connection->vsyncRequest = VSyncRequest::Single;
-        mCondition.notify_all();
+        mVSyncRequests.push_back(connection);
+        // While VSYNC is running the request is picked up with the next VSYNC
+        // event, so only wake the thread if it has to leave the idle state.
+        if (mState == State::Idle) {
+            mCondition.notify_all();
+        }
     }
 }
 
@@ -332,6 +360,18 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
                     break;
 
                 case DisplayEventReceiver::DISPLAY_EVENT_VSYNC:
+                    // If this thread fell behind, only dispatch the latest of back-to-back VSYNC
+                    // events, since consumers would otherwise wake up to render for stale ones.
+                    // Connections with a VSYNC rate above 1 only consume events whose count is a
+                    // multiple of their rate, so nothing is dropped while one of them is waiting.
+                    while (canCollapseVSyncLocked() && !mPendingEvents.empty() &&
+                           mPendingEvents.front().header.type ==
+                                   DisplayEventReceiver::DISPLAY_EVENT_VSYNC &&
+                           mPendingEvents.front().header.displayId == event->header.displayId) {
+                        ALOGV("Dropping stale %s", toString(*event).c_str());
+                        event = mPendingEvents.front();
+                        mPendingEvents.pop_front();
+                    }
                     if (mInterceptVSyncsCallback) {
                         mInterceptVSyncsCallback(event->header.timestamp);
                     }
@@ -339,24 +379,45 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
             }
         }
 
-        bool vsyncRequested = false;
-
         int aliveCount = 0;
-        // Find connections that should consume this event.
-        auto it = mDisplayEventConnections.begin();
-        while (it != mDisplayEventConnections.end()) {
-            if (const auto connection = it->promote()) {
-                vsyncRequested |= connection->vsyncRequest != VSyncRequest::None;
+        // Find connections that should consume this event. VSYNC events only
+        // need to look at connections that requested VSYNC, so idle connections
+        // are not touched at every VSYNC.
+        if (event && event->header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+            auto it = mVSyncRequests.begin();
+            while (it != mVSyncRequests.end()) {
+                const auto connection = it->promote();
+                if (!connection) {
+                    it = mVSyncRequests.erase(it);
+                    continue;
+                }
 
-                if (event && shouldConsumeEvent(*event, connection)) {
+                if (shouldConsumeEvent(*event, connection)) {
                     consumers.push_back(connection);
                     if (mDolphinCheck)
                         aliveCount++;
                 }
 
-                ++it;
-            } else {
-                it = mDisplayEventConnections.erase(it);
+                if (connection->vsyncRequest == VSyncRequest::None) {
+                    it = mVSyncRequests.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        } else if (event) {
+            auto it = mDisplayEventConnections.begin();
+            while (it != mDisplayEventConnections.end()) {
+                if (const auto connection = it->promote()) {
+                    if (shouldConsumeEvent(*event, connection)) {
+                        consumers.push_back(connection);
+                        if (mDolphinCheck)
+                            aliveCount++;
+                    }
+
+                    ++it;
+                } else {
+                    it = mDisplayEventConnections.erase(it);
+                }
             }
         }
         if (mDolphinCheck) {
@@ -367,10 +428,13 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
                         consumers.push_back(connection);
                         aliveCount++;
                     }
+                    ++it;
                 }
             }
         }
 
+        const bool vsyncRequested = !mVSyncRequests.empty();
+
         if (!consumers.empty()) {
             dispatchEvent(*event, consumers);
             consumers.clear();
@@ -417,6 +481,13 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
     }
 }
 
+bool EventThread::canCollapseVSyncLocked() const {
+    return std::none_of(mVSyncRequests.begin(), mVSyncRequests.end(), [](const auto& request) {
+        const auto connection = request.promote();
+        return connection && connection->vsyncRequest > VSyncRequest::Periodic;
+    });
+}
+
 bool EventThread::shouldConsumeEvent(const DisplayEventReceiver::Event& event,
                                      const sp<EventThreadConnection>& connection) const {
     switch (event.header.type) {
@@ -479,6 +550,7 @@ void EventThread::dump(std::string& result) const {
         StringAppendF(&result, "    %s\n", toString(event).c_str());
     }
 
+    StringAppendF(&result, "  vsync requests (count=%zu)\n", mVSyncRequests.size());
     StringAppendF(&result, "  connections (count=%zu):\n", mDisplayEventConnections.size());
     for (const auto& ptr : mDisplayEventConnections) {
         if (const auto connection = ptr.promote()) {
@@ -159,6 +159,9 @@ private:
 
     void threadMain(std::unique_lock<std::mutex>& lock) REQUIRES(mMutex);
 
+    // Returns false if a connection has a VSYNC rate above 1, since dropping a queued VSYNC
+    // event would then make that connection miss its slot.
+    bool canCollapseVSyncLocked() const REQUIRES(mMutex);
     bool shouldConsumeEvent(const DisplayEventReceiver::Event& event,
                             const sp<EventThreadConnection>& connection) const REQUIRES(mMutex);
     void dispatchEvent(const DisplayEventReceiver::Event& event,
@@ -166,6 +169,7 @@ private:
 
     void removeDisplayEventConnectionLocked(const wp<EventThreadConnection>& connection)
             REQUIRES(mMutex);
+    void removeVSyncRequestLocked(const wp<EventThreadConnection>& connection) REQUIRES(mMutex);
 
     // Implements VSyncSource::Callback
     void onVSyncEvent(nsecs_t timestamp) override;
@@ -182,6 +186,9 @@ private:
     mutable std::condition_variable mCondition;
 
     std::vector<wp<EventThreadConnection>> mDisplayEventConnections GUARDED_BY(mMutex);
+    // Connections whose vsyncRequest is not None. Dead connections are pruned
+    // when the next VSYNC event is dispatched.
+    std::vector<wp<EventThreadConnection>> mVSyncRequests GUARDED_BY(mMutex);
     std::deque<DisplayEventReceiver::Event> mPendingEvents GUARDED_BY(mMutex);
 
     // VSYNC state of connected display.
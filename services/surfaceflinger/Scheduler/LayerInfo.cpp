@@ -16,10 +16,13 @@
 
 #include "LayerInfo.h"
 
+#include <algorithm>
 #include <cinttypes>
+#include <cmath>
 #include <cstdint>
 #include <numeric>
 #include <string>
+#include <vector>
 
 namespace android {
 namespace scheduler {
@@ -46,5 +49,45 @@ void LayerInfo::setLastPresentTime(nsecs_t lastPresentTime) {
     mRefreshRateHistory.insertRefreshRate(refreshDuration);
 }
 
+float LayerInfo::RefreshRateHistory::getRefreshRate() const {
+    const float maxRefreshRate = 1e9f / mMinRefreshDuration;
+    if (mElements.size() < HISTORY_SIZE) {
+        return maxRefreshRate;
+    }
+
+    // Find the dominant frame duration, and how many frames follow it. The
+    // median is not skewed by dropped or doubled frames.
+    std::vector<int64_t> durations(mElements.begin(), mElements.end());
+    const nsecs_t median = calculate_median(&durations);
+    if (median <= 0) {
+        return maxRefreshRate;
+    }
+    const nsecs_t tolerance = median * CADENCE_TOLERANCE;
+    nsecs_t cadenceSum = 0;
+    size_t cadenceCount = 0;
+    for (nsecs_t duration : mElements) {
+        if (std::abs(duration - median) <= tolerance) {
+            cadenceSum += duration;
+            cadenceCount++;
+        }
+    }
+    if (cadenceCount < HISTORY_SIZE * STABLE_CADENCE_RATIO) {
+        return maxRefreshRate;
+    }
+
+    const float refreshRate = std::min(maxRefreshRate, 1e9f * cadenceCount / cadenceSum);
+    // Common video and game frame rates.
+    static constexpr float kContentRefreshRates[] = {24.f, 25.f, 30.f, 48.f, 50.f, 60.f};
+    for (float contentRefreshRate : kContentRefreshRates) {
+        if (std::abs(refreshRate - contentRefreshRate) <= contentRefreshRate * SNAP_TOLERANCE) {
+            return contentRefreshRate;
+        }
+    }
+    if (std::abs(refreshRate - maxRefreshRate) <= maxRefreshRate * SNAP_TOLERANCE) {
+        return maxRefreshRate;
+    }
+    return refreshRate;
+}
+
 } // namespace scheduler
 } // namespace android
@@ -53,19 +53,22 @@ class LayerInfo {
             }
         }
 
-        float getRefreshRateAvg() const {
-            nsecs_t refreshDuration = mMinRefreshDuration;
-            if (mElements.size() == HISTORY_SIZE) {
-                refreshDuration = scheduler::calculate_mean(mElements);
-            }
-
-            return 1e9f / refreshDuration;
-        }
+        // Returns the refresh rate of the layer's frame cadence. Layers that do
+        // not follow a stable cadence, e.g. jittery UI, and layers without a full
+        // history are reported at the max refresh rate.
+        float getRefreshRate() const;
         void clearHistory() { mElements.clear(); }
 
     private:
         std::deque<nsecs_t> mElements;
         static constexpr size_t HISTORY_SIZE = 30;
+        // Frame durations within this fraction of the median belong to the cadence.
+        static constexpr float CADENCE_TOLERANCE = 0.1f;
+        // Share of frame durations that must belong to the cadence for it to be stable.
+        static constexpr float STABLE_CADENCE_RATIO = 0.8f;
+        // Stable cadences within this fraction of a common content frame rate
+        // are reported as that rate, e.g. 23.976 fps video as 24 fps.
+        static constexpr float SNAP_TOLERANCE = 0.02f;
         const nsecs_t mMinRefreshDuration;
     };
 
@@ -131,10 +134,10 @@ public:
         return mPresentTimeHistory.isRelevant();
     }
 
-    // Calculate the average refresh rate.
+    // Calculate the refresh rate from the layer's frame cadence.
     float getDesiredRefreshRate() const {
         std::lock_guard lock(mLock);
-        return mRefreshRateHistory.getRefreshRateAvg();
+        return mRefreshRateHistory.getRefreshRate();
     }
 
     bool getHDRContent() {
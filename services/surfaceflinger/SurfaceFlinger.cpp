@@ -31,12 +31,14 @@
 #include <mutex>
 #include <optional>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <cutils/properties.h>
 #include <log/log.h>
 
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
 #include <binder/PermissionCache.h>
 
 #include <compositionengine/CompositionEngine.h>
@@ -61,6 +63,7 @@
 #include <ui/DebugUtils.h>
 #include <ui/DisplayInfo.h>
 #include <ui/DisplayStatInfo.h>
+#include <ui/FenceTime.h>
 #include <ui/GraphicBufferAllocator.h>
 #include <ui/PixelFormat.h>
 #include <ui/UiConfig.h>
@@ -396,6 +399,26 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
     property_get("debug.sf.luma_sampling", value, "1");
     mLumaSampling = atoi(value);
 
+    property_get("debug.sf.incremental_visible_regions", value, "1");
+    mIncrementalVisibleRegions = atoi(value);
+
+    property_get("debug.sf.coalesce_transactions", value, "1");
+    mCoalesceTransactions = atoi(value);
+
+    property_get("debug.sf.skip_unchanged_composition", value, "1");
+    mSkipUnchangedComposition = atoi(value);
+
+    property_get("debug.sf.partial_client_composition", value, "1");
+    mPartialClientComposition = atoi(value);
+
+    property_get("debug.sf.late_latch", value, "0");
+    mLateLatch = atoi(value);
+    ALOGI_IF(mLateLatch, "Enabling late buffer latching");
+
+    property_get("debug.sf.composite_physical_displays_first", value, "0");
+    mCompositePhysicalDisplaysFirst = atoi(value);
+    ALOGI_IF(mCompositePhysicalDisplaysFirst, "Compositing physical displays first");
+
     char property[PROPERTY_VALUE_MAX] = {0};
     if((property_get("vendor.display.vsync_reliable_on_doze", property, "0") > 0) &&
         (!strncmp(property, "1", PROPERTY_VALUE_MAX ) ||
@@ -707,6 +730,10 @@ void SurfaceFlinger::init() {
 
     ALOGI("Phase offset NS: %" PRId64 "", mPhaseOffsets->getCurrentAppOffset());
 
+    // Every layer keeps acquire and release timelines, so resolve their fences
+    // in one place instead of once per layer per frame.
+    FenceResolver::enable();
+
     Mutex::Autolock _l(mStateLock);
     // start the EventThread
     mScheduler =
@@ -758,6 +785,9 @@ void SurfaceFlinger::init() {
     mCompositionEngine->setRenderEngine(
             renderengine::RenderEngine::create(static_cast<int32_t>(defaultCompositionPixelFormat),
                                                renderEngineFeature, maxFrameBufferAcquiredBuffers));
+    ClientCache::getInstance().setRenderEngine(&getRenderEngine());
+    // Layers drawn with a fallback program while the right one compiled need to be redrawn
+    getRenderEngine().setProgramCompiledCallback([this]() { repaintEverything(); });
 
     LOG_ALWAYS_FATAL_IF(mVrFlingerRequestsDisplay,
             "Starting with vr flinger active is not currently supported.");
@@ -1145,7 +1175,9 @@ bool SurfaceFlinger::performSetActiveConfig() {
     ATRACE_CALL();
     if (mCheckPendingFence) {
         if (previousFrameMissed()) {
-            // fence has not signaled yet. wait for the next invalidate
+            // fence has not signaled yet. check again on the next invalidate, but still compose
+            // this frame: only SF's own state waits for the switch, so skipping the frame would
+            // just drop it.
             mEventQueue->invalidate();
             return true;
         }
@@ -1545,11 +1577,13 @@ void SurfaceFlinger::waitForEvent() {
 
 void SurfaceFlinger::signalTransaction() {
     mScheduler->resetIdleTimer();
+    mPowerAdvisor.notifyDisplayUpdateImminent();
     mEventQueue->invalidate();
 }
 
 void SurfaceFlinger::signalLayerUpdate() {
     mScheduler->resetIdleTimer();
+    mPowerAdvisor.notifyDisplayUpdateImminent();
     mEventQueue->invalidate();
 }
 
@@ -1849,11 +1883,12 @@ void SurfaceFlinger::onMessageReceived(int32_t what) NO_THREAD_SAFETY_ANALYSIS {
                 mScheduler->updateFpsBasedOnContent();
             }
 
-            if (performSetActiveConfig()) {
-                break;
-            }
+            // While the panel switches configs, the present fence is late because of the switch,
+            // not because SF is behind, so it must not hold composition back either. Any other
+            // missed frame still propagates backpressure.
+            const bool configFencePending = performSetActiveConfig();
 
-            if (frameMissed && mPropagateBackpressure) {
+            if (frameMissed && mPropagateBackpressure && !configFencePending) {
                 if ((hwcFrameMissed && !gpuFrameMissed) ||
                     mPropagateBackpressureClientComposition) {
                     signalLayerUpdate();
@@ -1909,6 +1944,9 @@ void SurfaceFlinger::onMessageReceived(int32_t what) NO_THREAD_SAFETY_ANALYSIS {
                 // a new buffer was latched, or if HWC has requested a full
                 // repaint
                 signalRefresh();
+            } else {
+                // Only frames that get composed update the composition duration.
+                mLatchTime = 0;
             }
             if (mFrameExtn && mDolphinFuncsEnabled) {
                 if (!refreshNeeded) {
@@ -1964,11 +2002,49 @@ void SurfaceFlinger::handleMessageRefresh() {
     preComposition();
     rebuildLayerStacks();
     calculateWorkingSet();
+
+    std::vector<sp<DisplayDevice>> displays;
+    displays.reserve(mDisplays.size());
     for (const auto& [token, display] : mDisplays) {
+        displays.push_back(display);
+    }
+    if (mCompositePhysicalDisplaysFirst) {
+        // RenderEngine owns a single GL context and HWC commands go through a
+        // single command buffer, so displays cannot be composed concurrently.
+        // Compose and present the HWC-backed displays first so GPU work for
+        // virtual displays (casting, screen recording) never pushes a physical
+        // display past its vsync.
+        std::stable_partition(displays.begin(), displays.end(),
+                              [](const auto& display) { return !display->isVirtual(); });
+    }
+    for (const auto& display : displays) {
+        // Skip validate and present if the frame would show what the last one
+        // did, e.g. after a transaction that changed no visible state. The
+        // dirty region catches new content in a buffer that is queued again.
+        auto compositionDisplay = display->getCompositionDisplay();
+        const size_t contentHash = compositionDisplay->getContentHash();
+        if (mSkipUnchangedComposition && !repaintEverything && !mDebugRegion &&
+            !display->isVirtual() && compositionDisplay->getDirtyRegion(false).isEmpty() &&
+            compositionDisplay->getState().lastPresentedContentHash == contentHash) {
+            ATRACE_NAME("skipUnchangedComposition");
+            compositionDisplay->editState().dirtyRegion.clear();
+            mSkippedCompositionCount++;
+            continue;
+        }
+
         beginFrame(display);
         prepareFrame(display);
         doDebugFlashRegions(display, repaintEverything);
         doComposition(display, repaintEverything);
+        compositionDisplay->editState().lastPresentedContentHash = contentHash;
+    }
+
+    if (mLateLatch && mLatchTime > 0) {
+        // Follow increases right away and decreases slowly, so that a single
+        // fast frame does not push the latch point past the deadline.
+        const nsecs_t duration = systemTime() - mLatchTime;
+        mCompositionDuration = std::max(duration, (mCompositionDuration * 7 + duration) / 8);
+        mLatchTime = 0;
     }
 
     logLayerStats();
@@ -2006,7 +2082,11 @@ bool SurfaceFlinger::handleMessageInvalidate() {
 
     for (auto& layer : mLayersPendingRefresh) {
         Region visibleReg;
-        visibleReg.set(layer->getScreenBounds());
+        if (mPartialClientComposition) {
+            visibleReg = layer->getScreenDamage();
+        } else {
+            visibleReg.set(layer->getScreenBounds());
+        }
         invalidateLayerStack(layer, visibleReg);
     }
     mLayersPendingRefresh.clear();
@@ -3408,9 +3488,110 @@ void SurfaceFlinger::updateInputWindowInfo() {
         }
     });
 
-    mInputFlinger->setInputWindows(inputHandles,
-                                   mInputWindowCommands.syncInputWindows ? mSetInputWindowsListener
-                                                                         : nullptr);
+    // Windows without a token reach InputDispatcher as empty infos that it discards, and the
+    // update is keyed by token, so leave them out.
+    inputHandles.erase(std::remove_if(inputHandles.begin(), inputHandles.end(),
+                                      [](const InputWindowInfo& info) {
+                                          return info.token == nullptr;
+                                      }),
+                       inputHandles.end());
+
+    InputWindowsUpdate update = makeInputWindowsUpdate(inputHandles);
+    if (!update.isFull() && update.isEmpty()) {
+        // Layers changed but none of their input info did; skip the transaction.
+        mInputWindowsNotResent += inputHandles.size();
+        if (mInputWindowCommands.syncInputWindows) {
+            setInputWindowsFinished();
+        }
+        return;
+    }
+
+    if (update.isFull()) {
+        mInputWindowsFullUpdates++;
+    } else {
+        mInputWindowsDeltaUpdates++;
+    }
+    mInputWindowsSent += update.changedWindows.size();
+    mInputWindowsNotResent += inputHandles.size() - update.changedWindows.size();
+    if (CC_UNLIKELY(ATRACE_ENABLED())) {
+        Parcel parcel;
+        update.write(parcel);
+        ATRACE_INT("InputWindowsUpdateBytes", parcel.dataSize());
+    }
+
+    const status_t result =
+            mInputFlinger->updateInputWindows(update,
+                                              mInputWindowCommands.syncInputWindows
+                                                      ? mSetInputWindowsListener
+                                                      : nullptr);
+    if (result != NO_ERROR) {
+        // InputFlinger drops every delta whose base it doesn't have, so start over with a full
+        // list on the next frame instead of building on an update it never got.
+        ALOGE("Failed to send input windows update: %s (%d)", strerror(-result), result);
+        mInputWindowsGeneration = 0;
+        mSentInputWindows.clear();
+        mInputInfoChanged = true;
+        signalTransaction();
+        if (mInputWindowCommands.syncInputWindows) {
+            setInputWindowsFinished();
+        }
+        return;
+    }
+    mInputWindowsGeneration = update.generation;
+    mSentInputWindows = std::move(inputHandles);
+}
+
+InputWindowsUpdate SurfaceFlinger::makeInputWindowsUpdate(
+        const std::vector<InputWindowInfo>& windows) const {
+    InputWindowsUpdate update;
+    update.generation = mInputWindowsGeneration + 1;
+
+    std::unordered_map<const IBinder*, size_t> sentIndices;
+    for (size_t i = 0; i < mSentInputWindows.size(); i++) {
+        sentIndices[mSentInputWindows[i].token.get()] = i;
+    }
+    std::unordered_set<const IBinder*> tokens;
+    for (const auto& info : windows) {
+        tokens.insert(info.token.get());
+    }
+
+    // Windows are keyed by token, so start over with a full list whenever tokens aren't unique.
+    if (mInputWindowsGeneration == 0 || tokens.size() != windows.size() ||
+        sentIndices.size() != mSentInputWindows.size()) {
+        update.changedWindows = windows;
+        return update;
+    }
+
+    update.baseGeneration = mInputWindowsGeneration;
+    bool orderChanged = false;
+    size_t lastSentIndex = 0;
+    for (size_t i = 0; i < windows.size(); i++) {
+        const auto it = sentIndices.find(windows[i].token.get());
+        if (it == sentIndices.end()) {
+            update.changedWindows.push_back(windows[i]);
+            orderChanged = true;
+            continue;
+        }
+        if (mSentInputWindows[it->second] != windows[i]) {
+            update.changedWindows.push_back(windows[i]);
+        }
+        if (i > 0 && it->second < lastSentIndex) {
+            orderChanged = true;
+        }
+        lastSentIndex = it->second;
+    }
+    for (const auto& info : mSentInputWindows) {
+        if (tokens.find(info.token.get()) == tokens.end()) {
+            update.removedWindows.push_back(info.token);
+        }
+    }
+    if (orderChanged) {
+        update.order.reserve(windows.size());
+        for (const auto& info : windows) {
+            update.order.push_back(info.token);
+        }
+    }
+    return update;
 }
 
 void SurfaceFlinger::commitInputWindowCommands() {
@@ -3480,11 +3661,16 @@ void SurfaceFlinger::commitTransaction()
     mAnimCompositionPending = mAnimTransactionPending;
 
     withTracingLock([&]() {
+        if (!mDrawingState.layersSortedByZ.hasSameLayers(mCurrentState.layersSortedByZ)) {
+            mDrawingState.invalidateZOrderCache();
+        }
         mDrawingState = mCurrentState;
         // clear the "changed" flags in current state
         mCurrentState.colorMatrixChanged = false;
 
-        mDrawingState.traverseInZOrder([&](Layer* layer) {
+        // This walk commits the child lists as it descends, so it must not use
+        // the flattened Z order.
+        mDrawingState.layersSortedByZ.traverseInZOrder(mDrawingState.stateSet, [&](Layer* layer) {
             layer->commitChildList();
 
             // If the layer can be reached when traversing mDrawingState, then the layer is no
@@ -3534,7 +3720,17 @@ void SurfaceFlinger::commitOffscreenLayers() {
     }
 }
 
-void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displayDevice,
+static bool regionsEqual(const Region& lhs, const Region& rhs) {
+    if (lhs.isTriviallyEqual(rhs)) {
+        return true;
+    }
+    size_t lhsCount, rhsCount;
+    const Rect* lhsRects = lhs.getArray(&lhsCount);
+    const Rect* rhsRects = rhs.getArray(&rhsCount);
+    return lhsCount == rhsCount && std::equal(lhsRects, lhsRects + lhsCount, rhsRects);
+}
+
+void SurfaceFlinger::computeVisibleRegions(const sp<DisplayDevice>& displayDevice,
                                            Region& outDirtyRegion, Region& outOpaqueRegion) {
     ATRACE_CALL();
     ALOGV("computeVisibleRegions");
@@ -3559,6 +3755,17 @@ void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displa
         }
     });
 
+    // Layers are visited front to back, so as long as every layer visited so
+    // far is unchanged since the last pass, the regions accumulated above the
+    // current layer are unchanged too and its cached results are still valid.
+    auto& cache = displayDevice->editVisibleRegionCache();
+    const bool useCache = mIncrementalVisibleRegions && !bIgnoreLayer;
+    if (!useCache) {
+        cache.clear();
+    }
+    bool reusingCache = useCache;
+    size_t cacheIndex = 0;
+
     mDrawingState.traverseInReverseZOrder([&](Layer* layer) {
         // start with the whole surface at its current location
         const Layer::State& s(layer->getDrawingState());
@@ -3572,6 +3779,7 @@ void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displa
             Region visibleNonTransRegion;
             visibleNonTransRegion.set(Rect(0, 0));
             layer->setVisibleNonTransparentRegion(visibleNonTransRegion);
+            layer->visibilityGeneration = ++mVisibilityGeneration;
             return;
         }
 
@@ -3604,11 +3812,13 @@ void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displa
          */
         Region transparentRegion;
 
+        const bool visible = layer->isVisible();
+        Rect bounds;
 
         // handle hidden surfaces by setting the visible region to empty
-        if (CC_LIKELY(layer->isVisible())) {
+        if (CC_LIKELY(visible)) {
             const bool translucent = !layer->isOpaque(s);
-            Rect bounds(layer->getScreenBounds());
+            bounds = layer->getScreenBounds();
 
             visibleRegion.set(bounds);
             ui::Transform tr = layer->getTransform();
@@ -3635,9 +3845,54 @@ void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displa
                 }
             }
         }
+        const bool opaque = !opaqueRegion.isEmpty();
+
+        if (reusingCache) {
+            if (cacheIndex < cache.size()) {
+                const auto& entry = cache[cacheIndex];
+                if (entry.layer == layer && entry.generation == layer->visibilityGeneration &&
+                    !layer->contentDirty && entry.visible == visible && entry.opaque == opaque &&
+                    entry.bounds == bounds &&
+                    regionsEqual(entry.transparentRegion, transparentRegion)) {
+                    // The layer's regions are exactly what this pass would
+                    // compute, in which case its dirty region reduces to the
+                    // part of it that is under translucent layers.
+                    if (!layer->visibleRegion.isEmpty()) {
+                        outDirtyRegion.orSelf(layer->visibleRegion.intersect(layer->coveredRegion));
+                    }
+                    aboveOpaqueLayers = entry.aboveOpaqueLayers;
+                    aboveCoveredLayers = entry.aboveCoveredLayers;
+                    cacheIndex++;
+                    return;
+                }
+            }
+            reusingCache = false;
+        }
+
+        auto updateCache = [&]() {
+            layer->visibilityGeneration = ++mVisibilityGeneration;
+            if (!useCache) {
+                return;
+            }
+            DisplayDevice::VisibleRegionCacheEntry entry{layer,
+                                                         layer->visibilityGeneration,
+                                                         visible,
+                                                         opaque,
+                                                         bounds,
+                                                         transparentRegion,
+                                                         aboveOpaqueLayers,
+                                                         aboveCoveredLayers};
+            if (cacheIndex < cache.size()) {
+                cache[cacheIndex] = std::move(entry);
+            } else {
+                cache.push_back(std::move(entry));
+            }
+            cacheIndex++;
+        };
 
         if (visibleRegion.isEmpty()) {
             layer->clearVisibilityRegions();
+            updateCache();
             return;
         }
 
@@ -3689,8 +3944,13 @@ void SurfaceFlinger::computeVisibleRegions(const sp<const DisplayDevice>& displa
         layer->setCoveredRegion(coveredRegion);
         layer->setVisibleNonTransparentRegion(
                 visibleRegion.subtract(transparentRegion));
+        updateCache();
     });
 
+    if (useCache) {
+        cache.resize(cacheIndex);
+    }
+
     outOpaqueRegion = aboveOpaqueLayers;
 }
 
@@ -3708,11 +3968,10 @@ bool SurfaceFlinger::handlePageFlip()
     ATRACE_CALL();
     ALOGV("handlePageFlip");
 
-    nsecs_t latchTime = systemTime();
-
     bool visibleRegions = false;
     bool frameQueued = false;
     bool newDataLatched = false;
+    const nsecs_t expectedPresentTime = mScheduler->expectedPresentTime();
 
     // Store the set of layers that need updates. This set must not change as
     // buffers are being latched, as this could result in a deadlock.
@@ -3726,8 +3985,6 @@ bool SurfaceFlinger::handlePageFlip()
     mDrawingState.traverseInZOrder([&](Layer* layer) {
         if (layer->hasReadyFrame()) {
             frameQueued = true;
-            nsecs_t expectedPresentTime;
-            expectedPresentTime = mScheduler->expectedPresentTime();
             if (layer->shouldPresentNow(expectedPresentTime)) {
                 mLayersWithQueuedFrames.push_back(layer);
             } else {
@@ -3739,6 +3996,13 @@ bool SurfaceFlinger::handlePageFlip()
         }
     });
 
+    if (mLateLatch && !mLayersWithQueuedFrames.empty()) {
+        waitForLateFrames(expectedPresentTime);
+    }
+
+    const nsecs_t latchTime = systemTime();
+    mLatchTime = latchTime;
+
     if (!mLayersWithQueuedFrames.empty()) {
         // mStateLock is needed for latchBuffer as LayerRejecter::reject()
         // writes to Layer current state. See also b/119481871
@@ -3774,6 +4038,29 @@ bool SurfaceFlinger::handlePageFlip()
     return !mLayersWithQueuedFrames.empty() && newDataLatched;
 }
 
+void SurfaceFlinger::waitForLateFrames(nsecs_t expectedPresentTime) {
+    // Leave some slack for scheduling jitter of the composition itself.
+    constexpr nsecs_t kLatchMargin = 1000000;
+    constexpr nsecs_t kPollInterval = 500000;
+
+    const nsecs_t deadline = expectedPresentTime - mCompositionDuration - kLatchMargin;
+    const auto isUnsignaled = [](const sp<Layer>& layer) { return !layer->isReadyFrameSignaled(); };
+    if (!std::any_of(mLayersWithQueuedFrames.begin(), mLayersWithQueuedFrames.end(),
+                     isUnsignaled)) {
+        return;
+    }
+
+    ATRACE_NAME("waitForLateFrames");
+    do {
+        if (systemTime() + kPollInterval > deadline) {
+            ATRACE_NAME("late latch deadline");
+            break;
+        }
+        usleep(ns2us(kPollInterval));
+    } while (std::any_of(mLayersWithQueuedFrames.begin(), mLayersWithQueuedFrames.end(),
+                         isUnsignaled));
+}
+
 void SurfaceFlinger::invalidateHwcGeometry()
 {
     mGeometryInvalid = true;
@@ -3792,6 +4079,8 @@ void SurfaceFlinger::doDisplayComposition(const sp<DisplayDevice>& displayDevice
     }
 
     ALOGV("doDisplayComposition");
+    display->getRenderSurface()->addFrameDamage(computeFrameDamage(displayDevice, inDirtyRegion));
+
     base::unique_fd readyFence;
     if (!doComposeSurfaces(displayDevice, Region::INVALID_REGION, &readyFence)) return;
 
@@ -3799,6 +4088,46 @@ void SurfaceFlinger::doDisplayComposition(const sp<DisplayDevice>& displayDevice
     display->getRenderSurface()->queueBuffer(std::move(readyFence));
 }
 
+Region SurfaceFlinger::computeFrameDamage(const sp<DisplayDevice>& displayDevice,
+                                          const Region& dirtyRegion) {
+    auto display = displayDevice->getCompositionDisplay();
+    auto& displayState = display->editState();
+    const Rect fullDamage(display->getRenderSurface()->getSize());
+
+    // The previous contents of the client target can only be reused while
+    // the same layers are composed into it in the same way, as a layer that
+    // moved from device to client composition was never drawn into it.
+    size_t layout = 0;
+    for (auto& layer : displayDevice->getVisibleLayersSortedByZ()) {
+        const size_t values[] = {std::hash<const Layer*>{}(layer.get()),
+                                 static_cast<size_t>(layer->getCompositionType(displayDevice)),
+                                 static_cast<size_t>(layer->getClearClientTarget(displayDevice))};
+        for (size_t value : values) {
+            layout ^= value + 0x9e3779b9 + (layout << 6) + (layout >> 2);
+        }
+    }
+    const bool layoutChanged = displayState.lastCompositionLayoutHash != layout;
+    displayState.lastCompositionLayoutHash = layout;
+
+    if (!mPartialClientComposition || mDebugRegion || displayDevice->isVirtual() ||
+        layoutChanged) {
+        return Region(fullDamage);
+    }
+
+    Rect damage = displayState.transform.transform(dirtyRegion).getBounds();
+    if (damage.isEmpty()) {
+        return Region();
+    }
+    if (displayState.transform.getType() & ui::Transform::SCALE) {
+        // Scaled layer edges can touch pixels just outside the rounded bounds.
+        damage = Rect(damage.left - 1, damage.top - 1, damage.right + 1, damage.bottom + 1);
+    }
+    if (!damage.intersect(fullDamage, &damage)) {
+        return Region();
+    }
+    return Region(damage);
+}
+
 bool SurfaceFlinger::doComposeSurfaces(const sp<DisplayDevice>& displayDevice,
                                        const Region& debugRegion, base::unique_fd* readyFence) {
     ATRACE_CALL();
@@ -3854,6 +4183,16 @@ bool SurfaceFlinger::doComposeSurfaces(const sp<DisplayDevice>& displayDevice,
 
         clientCompositionDisplay.physicalDisplay = displayState.scissor;
         clientCompositionDisplay.clip = displayState.scissor;
+        if (mPartialClientComposition && debugRegion.isEmpty()) {
+            // Only redraw what changed since this buffer was last drawn.
+            if (const auto damage = display->getRenderSurface()->getBufferDamage()) {
+                const Rect damageBounds = damage->getBounds();
+                if (damageBounds != Rect(display->getRenderSurface()->getSize())) {
+                    clientCompositionDisplay.damage = damageBounds;
+                    mPartialClientCompositionCount++;
+                }
+            }
+        }
         const ui::Transform& displayTransform = displayState.transform;
         clientCompositionDisplay.globalTransform = displayTransform.asMatrix4();
         clientCompositionDisplay.orientation = displayState.orientation;
@@ -4071,47 +4410,120 @@ bool SurfaceFlinger::flushTransactionQueues() {
     // to prevent onHandleDestroyed from being called while the lock is held,
     // we must keep a copy of the transactions (specifically the composer
     // states) around outside the scope of the lock
-    std::vector<const TransactionState> transactions;
-    bool flushedATransaction = false;
+    std::vector<TransactionState> transactions;
     {
         Mutex::Autolock _l(mStateLock);
+        {
+            std::lock_guard<std::mutex> lock(mQueueLock);
 
-        auto it = mTransactionQueues.begin();
-        while (it != mTransactionQueues.end()) {
-            auto& [applyToken, transactionQueue] = *it;
+            auto it = mTransactionQueues.begin();
+            while (it != mTransactionQueues.end()) {
+                auto& [applyToken, transactionQueue] = *it;
 
-            while (!transactionQueue.empty()) {
-                const auto& transaction = transactionQueue.front();
-                if (!transactionIsReadyToBeApplied(transaction.desiredPresentTime,
-                                                   transaction.states)) {
-                    setTransactionFlags(eTransactionFlushNeeded);
-                    break;
+                while (!transactionQueue.empty()) {
+                    const auto& transaction = transactionQueue.front();
+                    if (!transactionIsReadyToBeApplied(transaction.desiredPresentTime,
+                                                       transaction.states)) {
+                        setTransactionFlags(eTransactionFlushNeeded);
+                        break;
+                    }
+                    transactions.push_back(std::move(transactionQueue.front()));
+                    transactionQueue.pop();
+                }
+
+                if (transactionQueue.empty()) {
+                    it = mTransactionQueues.erase(it);
+                    mTransactionCV.broadcast();
+                } else {
+                    it = std::next(it, 1);
                 }
-                transactions.push_back(transaction);
-                applyTransactionState(transaction.states, transaction.displays, transaction.flags,
-                                      mPendingInputWindowCommands, transaction.desiredPresentTime,
-                                      transaction.buffer, transaction.callback,
-                                      transaction.postTime, transaction.privileged,
-                                      /*isMainThread*/ true);
-                transactionQueue.pop();
-                flushedATransaction = true;
-            }
-
-            if (transactionQueue.empty()) {
-                it = mTransactionQueues.erase(it);
-                mTransactionCV.broadcast();
-            } else {
-                it = std::next(it, 1);
+            }
+        }
+
+        if (mCoalesceTransactions) {
+            coalesceTransactionStates(transactions);
+        }
+
+        // Apply outside of mQueueLock so clients can keep queueing meanwhile.
+        for (const auto& transaction : transactions) {
+            applyTransactionState(transaction.states, transaction.displays, transaction.flags,
+                                  mPendingInputWindowCommands, transaction.desiredPresentTime,
+                                  transaction.buffer, transaction.callback,
+                                  transaction.postTime, transaction.privileged,
+                                  /*isMainThread*/ true);
+        }
+    }
+    return !transactions.empty();
+}
+
+void SurfaceFlinger::coalesceTransactionStates(std::vector<TransactionState>& transactions) {
+    // Properties whose setters fully replace the previous value, so only the
+    // last write of a flush is observable.
+    constexpr uint64_t kCoalescableMask = layer_state_t::ePositionChanged |
+            layer_state_t::eAlphaChanged | layer_state_t::eMatrixChanged |
+            layer_state_t::eCropChanged_legacy | layer_state_t::eCropChanged |
+            layer_state_t::eCornerRadiusChanged | layer_state_t::eColorChanged;
+
+    if (transactions.size() < 2) {
+        return;
+    }
+
+    // Keyed by client and layer handle, as a state only reaches the layer if
+    // its client owns the handle.
+    std::map<std::pair<const IBinder*, const IBinder*>, uint64_t> written;
+    for (auto transaction = transactions.rbegin(); transaction != transactions.rend();
+         ++transaction) {
+        for (size_t i = transaction->states.size(); i-- > 0;) {
+            layer_state_t& s = transaction->states.editItemAt(i).state;
+            const auto key = std::make_pair(transaction->states[i].client.get(), s.surface.get());
+            if (key.second == nullptr) {
+                continue;
+            }
+
+            // Deferred states are replayed later and would overwrite newer
+            // values, so they must be applied as sent.
+            if (s.what & layer_state_t::eDeferTransaction_legacy) {
+                continue;
+            }
+
+            auto it = written.find(key);
+            if (it != written.end()) {
+                const uint64_t redundant = s.what & it->second;
+                s.what &= ~redundant;
+                mCoalescedLayerStateWrites += __builtin_popcountll(redundant);
+            }
+
+            // A write that is latched with the next resize, or that may be
+            // rejected, does not supersede an earlier one.
+            uint64_t supersedes = s.what & kCoalescableMask;
+            if (s.what & layer_state_t::eGeometryAppliesWithResize) {
+                supersedes &= ~(layer_state_t::ePositionChanged |
+                                layer_state_t::eCropChanged_legacy);
+            }
+            if (!transaction->privileged && (supersedes & layer_state_t::eMatrixChanged)) {
+                ui::Transform t;
+                t.set(s.matrix.dsdx, s.matrix.dtdy, s.matrix.dtdx, s.matrix.dsdy);
+                if (!t.preserveRects()) {
+                    supersedes &= ~layer_state_t::eMatrixChanged;
+                }
+            }
+            if (supersedes) {
+                written[key] |= supersedes;
             }
         }
     }
-    return flushedATransaction;
 }
 
 bool SurfaceFlinger::transactionFlushNeeded() {
+    std::lock_guard<std::mutex> lock(mQueueLock);
     return !mTransactionQueues.empty();
 }
 
+bool SurfaceFlinger::hasPendingTransactions(const sp<IBinder>& applyToken) {
+    std::lock_guard<std::mutex> lock(mQueueLock);
+    return mTransactionQueues.find(applyToken) != mTransactionQueues.end();
+}
+
 bool SurfaceFlinger::containsAnyInvalidClientState(const Vector<ComposerState>& states) {
     for (const ComposerState& state : states) {
         // Here we need to check that the interface we're given is indeed
@@ -4169,18 +4581,42 @@ void SurfaceFlinger::setTransactionState(const Vector<ComposerState>& states,
 
     bool privileged = callingThreadHasUnscopedSurfaceFlingerAccess();
 
-    Mutex::Autolock _l(mStateLock);
-
     if (containsAnyInvalidClientState(states)) {
         return;
     }
 
-    // If its TransactionQueue already has a pending TransactionState or if it is pending
-    auto itr = mTransactionQueues.find(applyToken);
+    const bool readyToBeApplied = transactionIsReadyToBeApplied(desiredPresentTime, states);
+
+    // Queues the transaction if it has to wait for its fences, its desired
+    // present time, or for a pending TransactionState with the same token.
+    auto queueIfPending = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(mQueueLock);
+            auto itr = mTransactionQueues.find(applyToken);
+            if (itr == mTransactionQueues.end() && readyToBeApplied) {
+                return false;
+            }
+            mTransactionQueues[applyToken].emplace(states, displays, flags, desiredPresentTime,
+                                                   uncacheBuffer, listenerCallbacks, postTime,
+                                                   privileged);
+        }
+        setTransactionFlags(eTransactionFlushNeeded);
+        return true;
+    };
+
+    // Deferred transactions only touch the queue, so don't contend with the
+    // main thread for mStateLock. Animation frames have to wait for the prior
+    // frame to be applied, which happens under mStateLock.
+    if (!(flags & eAnimation) && queueIfPending()) {
+        return;
+    }
+
+    Mutex::Autolock _l(mStateLock);
+
     // if this is an animation frame, wait until prior animation frame has
     // been applied by SF
     if (flags & eAnimation) {
-        while (itr != mTransactionQueues.end()) {
+        while (hasPendingTransactions(applyToken)) {
             status_t err = mTransactionCV.waitRelative(mStateLock, s2ns(5));
             if (CC_UNLIKELY(err != NO_ERROR)) {
                 ALOGW_IF(err == TIMED_OUT,
@@ -4188,15 +4624,11 @@ void SurfaceFlinger::setTransactionState(const Vector<ComposerState>& states,
                          "waiting for animation frame to apply");
                 break;
             }
-            itr = mTransactionQueues.find(applyToken);
         }
     }
-    if (itr != mTransactionQueues.end() ||
-        !transactionIsReadyToBeApplied(desiredPresentTime, states)) {
-        mTransactionQueues[applyToken].emplace(states, displays, flags, desiredPresentTime,
-                                               uncacheBuffer, listenerCallbacks, postTime,
-                                               privileged);
-        setTransactionFlags(eTransactionFlushNeeded);
+
+    // Another thread may have queued a transaction for this token meanwhile.
+    if (queueIfPending()) {
         return;
     }
 
@@ -5705,7 +6137,24 @@ void SurfaceFlinger::dumpAllLocked(const DumpArgs& args, std::string& result) co
 
     StringAppendF(&result, "Total missed frame count: %u\n", mFrameMissedCount.load());
     StringAppendF(&result, "HWC missed frame count: %u\n", mHwcFrameMissedCount.load());
-    StringAppendF(&result, "GPU missed frame count: %u\n\n", mGpuFrameMissedCount.load());
+    StringAppendF(&result, "GPU missed frame count: %u\n", mGpuFrameMissedCount.load());
+    StringAppendF(&result, "Skipped unchanged composition count: %u%s\n",
+                  mSkippedCompositionCount.load(), mSkipUnchangedComposition ? "" : " (disabled)");
+    StringAppendF(&result, "Partial client composition count: %u%s\n\n",
+                  mPartialClientCompositionCount.load(),
+                  mPartialClientComposition ? "" : " (disabled)");
+
+    if (mLateLatch) {
+        StringAppendF(&result, "Late latch: composition duration estimate %" PRId64 " us\n",
+                      ns2us(mCompositionDuration));
+    }
+    StringAppendF(&result, "Coalesced layer state writes: %" PRIu64 "%s\n\n",
+                  mCoalescedLayerStateWrites, mCoalesceTransactions ? "" : " (disabled)");
+    StringAppendF(&result,
+                  "Input window updates: %" PRIu64 " full, %" PRIu64 " delta, %" PRIu64
+                  " windows sent, %" PRIu64 " unchanged windows not resent\n\n",
+                  mInputWindowsFullUpdates.load(), mInputWindowsDeltaUpdates.load(),
+                  mInputWindowsSent.load(), mInputWindowsNotResent.load());
 
     dumpBufferingStats(result);
 
@@ -5983,9 +6432,9 @@ status_t SurfaceFlinger::CheckTransactCodeCredentials(uint32_t code) {
         code == IBinder::SYSPROPS_TRANSACTION) {
         return OK;
     }
-    // Numbers from 1000 to 1035 and 20000 are currently used for backdoors. The code
+    // Numbers from 1000 to 1036 and 20000 are currently used for backdoors. The code
     // in onTransact verifies that the user is root, and has access to use SF.
-    if ((code >= 1000 && code <= 1035) || (code == 20000)) {
+    if ((code >= 1000 && code <= 1036) || (code == 20000)) {
         ALOGV("Accessing SurfaceFlinger through backdoor code: %u", code);
         return OK;
     }
@@ -6331,6 +6780,18 @@ status_t SurfaceFlinger::onTransact(uint32_t code, const Parcel& data, Parcel* r
                 }
                 return NO_ERROR;
             }
+            // Pull TimeStats as a serialized SFTimeStatsGlobalProto, limited to the
+            // given number of layers if it is positive.
+            case 1036: {
+                n = data.readInt32();
+                std::optional<uint32_t> maxLayers;
+                if (n > 0) {
+                    maxLayers = static_cast<uint32_t>(n);
+                }
+                const std::string proto = mTimeStats->dumpProto(maxLayers);
+                reply->writeByteVector(std::vector<uint8_t>(proto.begin(), proto.end()));
+                return NO_ERROR;
+            }
             case 20000: {
               uint64_t disp = data.readUint64();
               int mode = data.readInt32();
@@ -6663,6 +7124,24 @@ status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
                                              const sp<GraphicBuffer>& buffer,
                                              bool useIdentityTransform,
                                              bool& outCapturedSecureLayers) {
+    base::unique_fd fence;
+    status_t result = captureScreenCommonAsync(renderArea, traverseLayers, buffer,
+                                               useIdentityTransform, outCapturedSecureLayers,
+                                               &fence);
+    if (result == NO_ERROR && fence.get() >= 0) {
+        sync_wait(fence.get(), -1);
+    }
+    return result;
+}
+
+status_t SurfaceFlinger::captureScreenCommonAsync(RenderArea& renderArea,
+                                                  TraverseLayersFunction traverseLayers,
+                                                  const sp<GraphicBuffer>& buffer,
+                                                  bool useIdentityTransform,
+                                                  bool& outCapturedSecureLayers,
+                                                  base::unique_fd* outFence) {
+    ATRACE_CALL();
+
     // This mutex protects syncFd and captureResult for communication of the return values from the
     // main thread back to this Binder thread
     std::mutex captureMutex;
@@ -6719,8 +7198,7 @@ status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
     }
 
     if (result == NO_ERROR) {
-        sync_wait(syncFd, -1);
-        close(syncFd);
+        outFence->reset(syncFd);
     }
 
     return result;
@@ -6864,11 +7342,42 @@ void SurfaceFlinger::setInputWindowsFinished() {
 
 // ---------------------------------------------------------------------------
 
+std::shared_ptr<const SurfaceFlinger::State::LayerList> SurfaceFlinger::State::getZOrderCache()
+        const {
+    // The current state is modified from binder threads and other threads
+    // only see the drawing state under a lock, so only cache on the main thread.
+    if (stateSet != LayerVector::StateSet::Drawing ||
+        std::this_thread::get_id() != ownerThreadId) {
+        return nullptr;
+    }
+    if (!zOrderCache) {
+        ATRACE_NAME("rebuildZOrderCache");
+        auto layers = std::make_shared<LayerList>();
+        layersSortedByZ.traverseInZOrder(stateSet,
+                                         [&](Layer* layer) { layers->emplace_back(layer); });
+        zOrderCache = std::move(layers);
+    }
+    return zOrderCache;
+}
+
 void SurfaceFlinger::State::traverseInZOrder(const LayerVector::Visitor& visitor) const {
+    // Hold a reference so the visitor can invalidate the cache while we iterate
+    if (const auto layers = getZOrderCache()) {
+        for (const auto& layer : *layers) {
+            visitor(layer.get());
+        }
+        return;
+    }
     layersSortedByZ.traverseInZOrder(stateSet, visitor);
 }
 
 void SurfaceFlinger::State::traverseInReverseZOrder(const LayerVector::Visitor& visitor) const {
+    if (const auto layers = getZOrderCache()) {
+        for (auto it = layers->rbegin(); it != layers->rend(); ++it) {
+            visitor(it->get());
+        }
+        return;
+    }
     layersSortedByZ.traverseInReverseZOrder(stateSet, visitor);
 }
 
@@ -393,6 +393,20 @@ private:
 
         void traverseInZOrder(const LayerVector::Visitor& visitor) const;
         void traverseInReverseZOrder(const LayerVector::Visitor& visitor) const;
+
+        // The Drawing state keeps its layer tree flattened in Z order so that
+        // traversals on the main thread are a linear scan. The flattened order
+        // must be dropped whenever the drawing tree, a Z value, a layer stack
+        // or a relative-Z link changes.
+        void invalidateZOrderCache() const { zOrderCache.reset(); }
+
+    private:
+        using LayerList = std::vector<sp<Layer>>;
+        std::shared_ptr<const LayerList> getZOrderCache() const;
+
+        const std::thread::id ownerThreadId = std::this_thread::get_id();
+        // only accessed from ownerThreadId
+        mutable std::shared_ptr<const LayerList> zOrderCache;
     };
 
     /* ------------------------------------------------------------------------
@@ -538,8 +552,8 @@ private:
     void setActiveConfigInternal() REQUIRES(mStateLock);
     // Active config is updated on INVALIDATE call in a state machine-like manner. When the
     // desired config was set, HWC needs to update the panel on the next refresh, and when
-    // we receive the fence back, we know that the process was complete. It returns whether
-    // we need to wait for the next invalidate
+    // we receive the fence back, we know that the process was complete. Returns true while it
+    // is still waiting for that fence.
     bool performSetActiveConfig() REQUIRES(mStateLock);
     // called on the main thread in response to setPowerMode()
     void setPowerModeInternal(const sp<DisplayDevice>& display, int mode) REQUIRES(mStateLock);
@@ -562,6 +576,8 @@ private:
 
     void updateInputFlinger();
     void updateInputWindowInfo();
+    // Diffs the windows against the ones last sent to InputFlinger.
+    InputWindowsUpdate makeInputWindowsUpdate(const std::vector<InputWindowInfo>& windows) const;
     void commitInputWindowCommands() REQUIRES(mStateLock);
     void executeInputWindowCommands();
     void setInputWindowsFinished();
@@ -572,6 +588,9 @@ private:
      * is necessary to perform a refresh during this vsync.
      */
     bool handlePageFlip();
+    // Waits for the acquire fences of mLayersWithQueuedFrames for as long as
+    // the frame can still be composed in time for expectedPresentTime.
+    void waitForLateFrames(nsecs_t expectedPresentTime);
 
     /* ------------------------------------------------------------------------
      * Transactions
@@ -586,8 +605,13 @@ private:
             REQUIRES(mStateLock);
     // Returns true if at least one transaction was flushed
     bool flushTransactionQueues();
+    // Drops property writes that a later transaction in the same flush overwrites.
+    void coalesceTransactionStates(std::vector<TransactionState>& transactions)
+            REQUIRES(mStateLock);
     // Returns true if there is at least one transaction that needs to be flushed
     bool transactionFlushNeeded();
+    // Returns true if transactions with this apply token are waiting to be applied.
+    bool hasPendingTransactions(const sp<IBinder>& applyToken);
     uint32_t getTransactionFlags(uint32_t flags);
     uint32_t peekTransactionFlags();
     // Can only be called from the main thread or with mStateLock held
@@ -665,6 +689,12 @@ private:
     status_t captureScreenCommon(RenderArea& renderArea, TraverseLayersFunction traverseLayers,
                                  const sp<GraphicBuffer>& buffer, bool useIdentityTransform,
                                  bool& outCapturedSecureLayers);
+    // Like captureScreenCommon, but returns as soon as the capture has been
+    // submitted to the GPU. outFence signals once buffer has been rendered.
+    status_t captureScreenCommonAsync(RenderArea& renderArea,
+                                      TraverseLayersFunction traverseLayers,
+                                      const sp<GraphicBuffer>& buffer, bool useIdentityTransform,
+                                      bool& outCapturedSecureLayers, base::unique_fd* outFence);
     const sp<DisplayDevice> getDisplayByIdOrLayerStack(uint64_t displayOrLayerStack);
     status_t captureScreenImplLocked(const RenderArea& renderArea,
                                      TraverseLayersFunction traverseLayers,
@@ -761,7 +791,7 @@ private:
      * Compositing
      */
     void invalidateHwcGeometry();
-    void computeVisibleRegions(const sp<const DisplayDevice>& display, Region& dirtyRegion,
+    void computeVisibleRegions(const sp<DisplayDevice>& display, Region& dirtyRegion,
                                Region& opaqueRegion);
 
     sp<DisplayDevice> getVsyncSource();
@@ -800,6 +830,9 @@ private:
     void doDebugFlashRegions(const sp<DisplayDevice>& display, bool repaintEverything);
     void logLayerStats();
     void doDisplayComposition(const sp<DisplayDevice>& display, const Region& dirtyRegion);
+    // Returns the region of the display's client target, in physical display
+    // coordinates, whose content changes in this frame.
+    Region computeFrameDamage(const sp<DisplayDevice>& display, const Region& dirtyRegion);
 
     // This fails if using GL and the surface has been destroyed. readyFence
     // will be populated if using GL and native fence sync is supported, to
@@ -1026,6 +1059,13 @@ private:
     bool mGeometryInvalid = false;
     bool mAnimCompositionPending = false;
     std::vector<sp<Layer>> mLayersWithQueuedFrames;
+    // Delay latching in handlePageFlip until unsignaled frames are ready or
+    // the composition deadline is reached.
+    bool mLateLatch = false;
+    // When buffers were latched for the current frame, and a decaying maximum
+    // of the time from latching to the end of composition.
+    nsecs_t mLatchTime = 0;
+    nsecs_t mCompositionDuration = 0;
     // Tracks layers that need to update a display's dirty region.
     std::vector<sp<Layer>> mLayersPendingRefresh;
     std::array<sp<Fence>, 2> mPreviousPresentFences = {Fence::NO_FENCE, Fence::NO_FENCE};
@@ -1076,9 +1116,25 @@ private:
     const std::shared_ptr<TimeStats> mTimeStats;
     bool mUseHwcVirtualDisplays = false;
     bool mUseFbScaling = false;
+    // Compose physical displays before virtual ones in handleMessageRefresh.
+    bool mCompositePhysicalDisplaysFirst = false;
+    // Reuse cached visible regions for unchanged layers in computeVisibleRegions.
+    bool mIncrementalVisibleRegions = true;
+    // Bumped every time computeVisibleRegions writes a layer's visibility regions.
+    uint64_t mVisibilityGeneration = 0;
+    // Merge redundant layer property writes of transactions flushed together.
+    bool mCoalesceTransactions = true;
+    uint64_t mCoalescedLayerStateWrites GUARDED_BY(mStateLock) = 0;
     std::atomic<uint32_t> mFrameMissedCount = 0;
     std::atomic<uint32_t> mHwcFrameMissedCount = 0;
     std::atomic<uint32_t> mGpuFrameMissedCount = 0;
+    // Skip composition of displays whose content hash matches the last frame.
+    bool mSkipUnchangedComposition = true;
+    std::atomic<uint32_t> mSkippedCompositionCount = 0;
+    // Only redraw the damaged part of client targets that still hold the
+    // contents of a recent frame.
+    bool mPartialClientComposition = true;
+    std::atomic<uint32_t> mPartialClientCompositionCount = 0;
 
     TransactionCompletedThread mTransactionCompletedThread;
 
@@ -1133,7 +1189,11 @@ private:
         const int64_t postTime;
         bool privileged;
     };
-    std::unordered_map<sp<IBinder>, std::queue<TransactionState>, IBinderHash> mTransactionQueues;
+    // Guards mTransactionQueues so that clients can queue deferred transactions
+    // without taking mStateLock. Lock order: mStateLock, then mQueueLock.
+    std::mutex mQueueLock;
+    std::unordered_map<sp<IBinder>, std::queue<TransactionState>, IBinderHash> mTransactionQueues
+            GUARDED_BY(mQueueLock);
 
     /* ------------------------------------------------------------------------
      * Feature prototyping
@@ -1208,6 +1268,14 @@ private:
     ui::DisplayPrimaries mInternalDisplayPrimaries;
 
     sp<IInputFlinger> mInputFlinger;
+    // The input windows last sent to InputFlinger, front to back, and their generation. Should
+    // only be accessed by the main thread.
+    std::vector<InputWindowInfo> mSentInputWindows;
+    uint64_t mInputWindowsGeneration = 0;
+    std::atomic<uint64_t> mInputWindowsFullUpdates = 0;
+    std::atomic<uint64_t> mInputWindowsDeltaUpdates = 0;
+    std::atomic<uint64_t> mInputWindowsSent = 0;
+    std::atomic<uint64_t> mInputWindowsNotResent = 0;
     InputWindowCommands mPendingInputWindowCommands GUARDED_BY(mStateLock);
     // Should only be accessed by the main thread.
     InputWindowCommands mInputWindowCommands;
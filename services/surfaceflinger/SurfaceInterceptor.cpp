@@ -21,6 +21,8 @@
 #include "SurfaceFlinger.h"
 #include "SurfaceInterceptor.h"
 
+#include <fcntl.h>
+
 #include <fstream>
 
 #include <android-base/file.h>
@@ -48,8 +50,15 @@ void SurfaceInterceptor::enable(const SortedVector<sp<Layer>>& layers,
         return;
     }
     ATRACE_CALL();
-    mEnabled = true;
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
+    mOutputFd.reset(open(mOutputFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+    if (mOutputFd < 0) {
+        ALOGE("Could not open %s: %s", mOutputFileName.c_str(), strerror(errno));
+        return;
+    }
+    mStopWriter = false;
+    mWriterThread = std::thread(&SurfaceInterceptor::writerLoop, this);
+    mEnabled = true;
     saveExistingDisplaysLocked(displays);
     saveExistingSurfacesLocked(layers);
 }
@@ -61,10 +70,14 @@ void SurfaceInterceptor::disable() {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     mEnabled = false;
-    status_t err(writeProtoFileLocked());
-    ALOGE_IF(err == PERMISSION_DENIED, "Could not save the proto file! Permission denied");
-    ALOGE_IF(err == NOT_ENOUGH_DATA, "Could not save the proto file! There are missing fields");
-    mTrace.Clear();
+    flushIncrementsLocked();
+    {
+        std::lock_guard<std::mutex> writerGuard(mWriterMutex);
+        mStopWriter = true;
+    }
+    mWriterCondition.notify_one();
+    mWriterThread.join();
+    mOutputFd.reset();
 }
 
 bool SurfaceInterceptor::isEnabled() {
@@ -133,21 +146,43 @@ void SurfaceInterceptor::addInitialDisplayStateLocked(Increment* increment,
             display.viewport, display.frame);
 }
 
-status_t SurfaceInterceptor::writeProtoFileLocked() {
+void SurfaceInterceptor::flushIncrementsLocked() {
     ATRACE_CALL();
-    std::string output;
+    std::string chunk;
 
     if (!mTrace.IsInitialized()) {
-        return NOT_ENOUGH_DATA;
+        ALOGE("Could not save %d increments! There are missing fields", mTrace.increment_size());
+    } else if (!mTrace.SerializeToString(&chunk)) {
+        ALOGE("Could not serialize %d increments!", mTrace.increment_size());
     }
-    if (!mTrace.SerializeToString(&output)) {
-        return PERMISSION_DENIED;
+    mTrace.Clear();
+    if (chunk.empty()) {
+        return;
     }
-    if (!android::base::WriteStringToFile(output, mOutputFileName, true)) {
-        return PERMISSION_DENIED;
+
+    {
+        std::lock_guard<std::mutex> writerGuard(mWriterMutex);
+        mPendingChunks.push_back(std::move(chunk));
     }
+    mWriterCondition.notify_one();
+}
+
+void SurfaceInterceptor::writerLoop() {
+    std::unique_lock<std::mutex> writerLock(mWriterMutex);
+    while (true) {
+        mWriterCondition.wait(writerLock, [this] { return mStopWriter || !mPendingChunks.empty(); });
+        if (mPendingChunks.empty()) {
+            break;
+        }
+        const std::string chunk(std::move(mPendingChunks.front()));
+        mPendingChunks.pop_front();
 
-    return NO_ERROR;
+        writerLock.unlock();
+        if (!android::base::WriteFully(mOutputFd, chunk.data(), chunk.size())) {
+            ALOGE("Could not save the proto file! %s", strerror(errno));
+        }
+        writerLock.lock();
+    }
 }
 
 const sp<const Layer> SurfaceInterceptor::getLayer(const wp<const IBinder>& weakHandle) {
@@ -167,6 +202,9 @@ int32_t SurfaceInterceptor::getLayerId(const sp<const Layer>& layer) {
 }
 
 Increment* SurfaceInterceptor::createTraceIncrementLocked() {
+    if (mTrace.increment_size() >= kIncrementsPerChunk) {
+        flushIncrementsLocked();
+    }
     Increment* increment(mTrace.add_increment());
     increment->set_time_stamp(systemTime());
     return increment;
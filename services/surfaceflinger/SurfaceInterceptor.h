@@ -19,7 +19,13 @@
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
+#include <condition_variable>
+#include <deque>
 #include <mutex>
+#include <string>
+#include <thread>
+
+#include <android-base/unique_fd.h>
 
 #include <gui/LayerState.h>
 
@@ -115,7 +121,11 @@ private:
     void addInitialSurfaceStateLocked(Increment* increment, const sp<const Layer>& layer);
     void addInitialDisplayStateLocked(Increment* increment, const DisplayDeviceState& display);
 
-    status_t writeProtoFileLocked();
+    // Serializes the increments collected so far and hands them to the writer
+    // thread. The output file is a plain Trace proto: each chunk only holds
+    // repeated increment fields, so appending chunks appends increments.
+    void flushIncrementsLocked();
+    void writerLoop();
     const sp<const Layer> getLayer(const wp<const IBinder>& weakHandle);
     const std::string getLayerName(const sp<const Layer>& layer);
     int32_t getLayerId(const sp<const Layer>& layer);
@@ -168,11 +178,22 @@ private:
             const DisplayState& state, int32_t sequenceId);
 
 
+    // Increments are streamed to the output file in chunks of this size, so
+    // memory use does not grow with the length of the capture.
+    static constexpr int kIncrementsPerChunk = 128;
+
     bool mEnabled {false};
     std::string mOutputFileName {DEFAULT_FILENAME};
     std::mutex mTraceMutex {};
     Trace mTrace {};
     SurfaceFlinger* const mFlinger;
+
+    base::unique_fd mOutputFd;
+    std::thread mWriterThread;
+    std::mutex mWriterMutex {};
+    std::condition_variable mWriterCondition {};
+    std::deque<std::string> mPendingChunks {};
+    bool mStopWriter {false};
 };
 
 } // namespace impl
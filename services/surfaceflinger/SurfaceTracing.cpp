@@ -59,8 +59,16 @@ LayersTraceProto SurfaceTracing::traceWhenNotified() {
 }
 
 bool SurfaceTracing::addTraceToBuffer(LayersTraceProto& entry) {
+    // Serialize before taking mTraceLock. mSfLock has already been released, so
+    // this doesn't hold up the main thread.
+    std::string serialized;
+    {
+        ATRACE_NAME("SerializeLayersTrace");
+        entry.SerializeToString(&serialized);
+    }
+
     std::scoped_lock lock(mTraceLock);
-    mBuffer.emplace(std::move(entry));
+    mBuffer.emplace(std::move(serialized));
     if (mWriteToFile) {
         writeProtoFileLocked();
         mWriteToFile = false;
@@ -82,31 +90,42 @@ void SurfaceTracing::writeToFileAsync() {
 
 void SurfaceTracing::LayersTraceBuffer::reset(size_t newSize) {
     // use the swap trick to make sure memory is released
-    std::queue<LayersTraceProto>().swap(mStorage);
+    std::queue<std::string>().swap(mStorage);
     mSizeInBytes = newSize;
     mUsedInBytes = 0U;
 }
 
-void SurfaceTracing::LayersTraceBuffer::emplace(LayersTraceProto&& proto) {
-    auto protoSize = proto.ByteSize();
-    while (mUsedInBytes + protoSize > mSizeInBytes) {
+void SurfaceTracing::LayersTraceBuffer::emplace(std::string&& entry) {
+    const size_t entrySize = entry.size();
+    while (mUsedInBytes + entrySize > mSizeInBytes) {
         if (mStorage.empty()) {
             return;
         }
-        mUsedInBytes -= mStorage.front().ByteSize();
+        mUsedInBytes -= mStorage.front().size();
         mStorage.pop();
     }
-    mUsedInBytes += protoSize;
-    mStorage.emplace();
-    mStorage.back().Swap(&proto);
+    mUsedInBytes += entrySize;
+    mStorage.emplace(std::move(entry));
+}
+
+static void appendVarint(std::string* output, uint64_t value) {
+    while (value >= 0x80) {
+        output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    output->push_back(static_cast<char>(value));
 }
 
-void SurfaceTracing::LayersTraceBuffer::flush(LayersTraceFileProto* fileProto) {
-    fileProto->mutable_entry()->Reserve(mStorage.size());
+void SurfaceTracing::LayersTraceBuffer::flush(std::string* output) {
+    // Length-delimited field tag, see the protobuf encoding documentation.
+    constexpr uint32_t kEntryTag = (LayersTraceFileProto::kEntryFieldNumber << 3) | 2;
 
+    output->reserve(output->size() + mUsedInBytes + mStorage.size() * 8);
     while (!mStorage.empty()) {
-        auto entry = fileProto->add_entry();
-        entry->Swap(&mStorage.front());
+        const std::string& entry = mStorage.front();
+        appendVarint(output, kEntryTag);
+        appendVarint(output, entry.size());
+        output->append(entry);
         mStorage.pop();
     }
 }
@@ -176,13 +195,14 @@ void SurfaceTracing::writeProtoFileLocked() {
 
     fileProto.set_magic_number(uint64_t(LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_H) << 32 |
                                LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_L);
-    mBuffer.flush(&fileProto);
-    mBuffer.reset(mBufferSize);
-
     if (!fileProto.SerializeToString(&output)) {
         ALOGE("Could not save the proto file! Permission denied");
         mLastErr = PERMISSION_DENIED;
     }
+    // Entries are already serialized, so append them after the header fields.
+    mBuffer.flush(&output);
+    mBuffer.reset(mBufferSize);
+
     if (!android::base::WriteStringToFile(output, kDefaultFileName, S_IRWXU | S_IRGRP, getuid(),
                                           getgid(), true)) {
         ALOGE("Could not save the proto file! There are missing fields");
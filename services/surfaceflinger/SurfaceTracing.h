@@ -25,6 +25,7 @@
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <thread>
 
 using namespace android::surfaceflinger;
@@ -64,7 +65,10 @@ private:
     static constexpr auto kDefaultBufferCapInByte = 100_MB;
     static constexpr auto kDefaultFileName = "/data/misc/wmtrace/layers_trace.pb";
 
-    class LayersTraceBuffer { // ring buffer
+    // Ring buffer of serialized LayersTraceProto entries. Entries are kept in
+    // wire format so that their memory matches the size budget and writing the
+    // trace file doesn't need to walk the protos again.
+    class LayersTraceBuffer {
     public:
         size_t size() const { return mSizeInBytes; }
         size_t used() const { return mUsedInBytes; }
@@ -72,13 +76,14 @@ private:
 
         void setSize(size_t newSize) { mSizeInBytes = newSize; }
         void reset(size_t newSize);
-        void emplace(LayersTraceProto&& proto);
-        void flush(LayersTraceFileProto* fileProto);
+        void emplace(std::string&& entry);
+        // Appends the entries to output as LayersTraceFileProto.entry fields.
+        void flush(std::string* output);
 
     private:
         size_t mUsedInBytes = 0U;
         size_t mSizeInBytes = 0U;
-        std::queue<LayersTraceProto> mStorage;
+        std::queue<std::string> mStorage;
     };
 
     void mainLoop();
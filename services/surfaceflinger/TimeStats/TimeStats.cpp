@@ -77,6 +77,12 @@ std::string TimeStats::miniDump() {
     return result;
 }
 
+std::string TimeStats::dumpProto(std::optional<uint32_t> maxLayers) {
+    std::string result;
+    dump(/*asProto=*/true, maxLayers, result);
+    return result;
+}
+
 void TimeStats::incrementTotalFrames() {
     if (!mEnabled.load()) return;
 
@@ -162,10 +168,9 @@ static std::string getPackageName(const std::string& layerName) {
     return "";
 }
 
-void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerID) {
+void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerID, LayerRecord& layerRecord) {
     ATRACE_CALL();
 
-    LayerRecord& layerRecord = mTimeStatsTracker[layerID];
     TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
     std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
     while (!timeRecords.empty()) {
@@ -175,11 +180,12 @@ void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerID) {
 
         const std::string& layerName = layerRecord.layerName;
         if (prevTimeRecord.ready) {
-            if (!mTimeStats.stats.count(layerName)) {
-                mTimeStats.stats[layerName].layerName = layerName;
-                mTimeStats.stats[layerName].packageName = getPackageName(layerName);
+            auto [it, inserted] = mTimeStats.stats.try_emplace(layerName);
+            TimeStatsHelper::TimeStatsLayer& timeStatsLayer = it->second;
+            if (inserted) {
+                timeStatsLayer.layerName = layerName;
+                timeStatsLayer.packageName = getPackageName(layerName);
             }
-            TimeStatsHelper::TimeStatsLayer& timeStatsLayer = mTimeStats.stats[layerName];
             timeStatsLayer.totalFrames++;
             timeStatsLayer.droppedFrames += layerRecord.droppedFrames;
             layerRecord.droppedFrames = 0;
@@ -219,18 +225,33 @@ void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerID) {
             ALOGV("[%d]-[%" PRIu64 "]-present2present[%d]", layerID,
                   timeRecords[0].frameTime.frameNumber, presentToPresentMs);
             timeStatsLayer.deltas["present2present"].insert(presentToPresentMs);
+
+            if (layerRecord.uid >= 0) {
+                auto uidIter = mTimeStats.uidStats.find(layerRecord.uid);
+                if (uidIter == mTimeStats.uidStats.end() &&
+                    mTimeStats.uidStats.size() < MAX_NUM_UID_RECORDS) {
+                    uidIter = mTimeStats.uidStats.try_emplace(layerRecord.uid).first;
+                    uidIter->second.uid = layerRecord.uid;
+                }
+                if (uidIter != mTimeStats.uidStats.end()) {
+                    TimeStatsHelper::TimeStatsUid& timeStatsUid = uidIter->second;
+                    timeStatsUid.totalFrames++;
+                    timeStatsUid.deltas["post2present"].insert(postToPresentMs);
+                    timeStatsUid.deltas["acquire2present"].insert(acquireToPresentMs);
+                }
+            }
         }
 
-        // Output additional trace points to track frame time.
-        ATRACE_INT64(("TimeStats-Post - " + layerName).c_str(), timeRecords[0].frameTime.postTime);
-        ATRACE_INT64(("TimeStats-Acquire - " + layerName).c_str(),
-                     timeRecords[0].frameTime.acquireTime);
-        ATRACE_INT64(("TimeStats-Latch - " + layerName).c_str(),
-                     timeRecords[0].frameTime.latchTime);
-        ATRACE_INT64(("TimeStats-Desired - " + layerName).c_str(),
-                     timeRecords[0].frameTime.desiredTime);
-        ATRACE_INT64(("TimeStats-Present - " + layerName).c_str(),
-                     timeRecords[0].frameTime.presentTime);
+        // Output additional trace points to track frame time. Building the
+        // counter names allocates, so only do it while tracing.
+        if (ATRACE_ENABLED()) {
+            const FrameTime& frameTime = timeRecords[0].frameTime;
+            ATRACE_INT64(("TimeStats-Post - " + layerName).c_str(), frameTime.postTime);
+            ATRACE_INT64(("TimeStats-Acquire - " + layerName).c_str(), frameTime.acquireTime);
+            ATRACE_INT64(("TimeStats-Latch - " + layerName).c_str(), frameTime.latchTime);
+            ATRACE_INT64(("TimeStats-Desired - " + layerName).c_str(), frameTime.desiredTime);
+            ATRACE_INT64(("TimeStats-Present - " + layerName).c_str(), frameTime.presentTime);
+        }
 
         prevTimeRecord = timeRecords[0];
         timeRecords.pop_front();
@@ -253,24 +274,47 @@ static bool layerNameIsValid(const std::string& layerName) {
     return std::regex_match(layerName.begin(), layerName.end(), layerNameRegex);
 }
 
+TimeStats::LayerRecord* TimeStats::getLayerRecordLocked(int32_t layerID) {
+    auto it = mTimeStatsTracker.find(layerID);
+    return it != mTimeStatsTracker.end() ? &it->second : nullptr;
+}
+
+TimeStats::TimeRecord* TimeStats::getWaitingTimeRecordLocked(LayerRecord& layerRecord,
+                                                             uint64_t frameNumber) {
+    if (layerRecord.waitData < 0 ||
+        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
+        return nullptr;
+    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+    return timeRecord.frameTime.frameNumber == frameNumber ? &timeRecord : nullptr;
+}
+
 void TimeStats::setPostTime(int32_t layerID, uint64_t frameNumber, const std::string& layerName,
-                            nsecs_t postTime) {
+                            int32_t uid, nsecs_t postTime) {
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
-    ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerID, frameNumber, layerName.c_str(),
-          postTime);
+    ALOGV("[%d]-[%" PRIu64 "]-[%s]-[%d]-PostTime[%" PRId64 "]", layerID, frameNumber,
+          layerName.c_str(), uid, postTime);
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerID) && mTimeStatsTracker.size() < MAX_NUM_LAYER_RECORDS &&
-        layerNameIsValid(layerName)) {
-        mTimeStatsTracker[layerID].layerName = layerName;
+    LayerRecord* layerRecord = getLayerRecordLocked(layerID);
+    if (!layerRecord) {
+        if (mTimeStatsTracker.size() >= MAX_NUM_LAYER_RECORDS || mRejectedLayers.count(layerID)) {
+            return;
+        }
+        // Most layers keep posting frames with a name that is never tracked,
+        // so remember the rejection instead of matching the name every frame.
+        if (!layerNameIsValid(layerName)) {
+            mRejectedLayers.insert(layerID);
+            return;
+        }
+        layerRecord = &mTimeStatsTracker[layerID];
+        layerRecord->layerName = layerName;
+        layerRecord->uid = uid;
     }
-    if (!mTimeStatsTracker.count(layerID)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerID];
-    if (layerRecord.timeRecords.size() == MAX_NUM_TIME_RECORDS) {
+    if (layerRecord->timeRecords.size() == MAX_NUM_TIME_RECORDS) {
         ALOGE("[%d]-[%s]-timeRecords is at its maximum size[%zu]. Ignore this when unittesting.",
-              layerID, layerRecord.layerName.c_str(), MAX_NUM_TIME_RECORDS);
+              layerID, layerRecord->layerName.c_str(), MAX_NUM_TIME_RECORDS);
         mTimeStatsTracker.erase(layerID);
         return;
     }
@@ -287,10 +331,10 @@ void TimeStats::setPostTime(int32_t layerID, uint64_t frameNumber, const std::st
                             .desiredTime = postTime,
                     },
     };
-    layerRecord.timeRecords.push_back(timeRecord);
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        layerRecord.waitData = layerRecord.timeRecords.size() - 1;
+    layerRecord->timeRecords.push_back(timeRecord);
+    if (layerRecord->waitData < 0 ||
+        layerRecord->waitData >= static_cast<int32_t>(layerRecord->timeRecords.size()))
+        layerRecord->waitData = layerRecord->timeRecords.size() - 1;
 }
 
 void TimeStats::setLatchTime(int32_t layerID, uint64_t frameNumber, nsecs_t latchTime) {
@@ -300,14 +344,11 @@ void TimeStats::setLatchTime(int32_t layerID, uint64_t frameNumber, nsecs_t latc
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerID, frameNumber, latchTime);
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerID)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerID];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.latchTime = latchTime;
+    LayerRecord* layerRecord = getLayerRecordLocked(layerID);
+    if (!layerRecord) return;
+    TimeRecord* timeRecord = getWaitingTimeRecordLocked(*layerRecord, frameNumber);
+    if (timeRecord) {
+        timeRecord->frameTime.latchTime = latchTime;
     }
 }
 
@@ -318,14 +359,11 @@ void TimeStats::setDesiredTime(int32_t layerID, uint64_t frameNumber, nsecs_t de
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerID, frameNumber, desiredTime);
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerID)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerID];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.desiredTime = desiredTime;
+    LayerRecord* layerRecord = getLayerRecordLocked(layerID);
+    if (!layerRecord) return;
+    TimeRecord* timeRecord = getWaitingTimeRecordLocked(*layerRecord, frameNumber);
+    if (timeRecord) {
+        timeRecord->frameTime.desiredTime = desiredTime;
     }
 }
 
@@ -336,14 +374,11 @@ void TimeStats::setAcquireTime(int32_t layerID, uint64_t frameNumber, nsecs_t ac
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerID, frameNumber, acquireTime);
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerID)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerID];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.acquireTime = acquireTime;
+    LayerRecord* layerRecord = getLayerRecordLocked(layerID);
+    if (!layerRecord) return;
+    TimeRecord* timeRecord = getWaitingTimeRecordLocked(*layerRecord, frameNumber);
+    if (timeRecord) {
+        timeRecord->frameTime.acquireTime = acquireTime;
     }
 }
 
@@ -356,14 +391,11 @@ void TimeStats::setAcquireFence(int32_t layerID, uint64_t frameNumber,
           acquireFence->getSignalTime());
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerID)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerID];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.acquireFence = acquireFence;
+    LayerRecord* layerRecord = getLayerRecordLocked(layerID);
+    if (!layerRecord) return;
+    TimeRecord* timeRecord = getWaitingTimeRecordLocked(*layerRecord, frameNumber);
+    if (timeRecord) {
+        timeRecord->acquireFence = acquireFence;
     }
 }
 
@@ -374,19 +406,16 @@ void TimeStats::setPresentTime(int32_t layerID, uint64_t frameNumber, nsecs_t pr
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerID, frameNumber, presentTime);
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerID)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerID];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.presentTime = presentTime;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
+    LayerRecord* layerRecord = getLayerRecordLocked(layerID);
+    if (!layerRecord) return;
+    TimeRecord* timeRecord = getWaitingTimeRecordLocked(*layerRecord, frameNumber);
+    if (timeRecord) {
+        timeRecord->frameTime.presentTime = presentTime;
+        timeRecord->ready = true;
+        layerRecord->waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerID);
+    flushAvailableRecordsToStatsLocked(layerID, *layerRecord);
 }
 
 void TimeStats::setPresentFence(int32_t layerID, uint64_t frameNumber,
@@ -398,19 +427,16 @@ void TimeStats::setPresentFence(int32_t layerID, uint64_t frameNumber,
           presentFence->getSignalTime());
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerID)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerID];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.presentFence = presentFence;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
+    LayerRecord* layerRecord = getLayerRecordLocked(layerID);
+    if (!layerRecord) return;
+    TimeRecord* timeRecord = getWaitingTimeRecordLocked(*layerRecord, frameNumber);
+    if (timeRecord) {
+        timeRecord->presentFence = presentFence;
+        timeRecord->ready = true;
+        layerRecord->waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerID);
+    flushAvailableRecordsToStatsLocked(layerID, *layerRecord);
 }
 
 void TimeStats::onDestroy(int32_t layerID) {
@@ -420,7 +446,7 @@ void TimeStats::onDestroy(int32_t layerID) {
     ALOGV("[%d]-onDestroy", layerID);
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerID)) return;
+    mRejectedLayers.erase(layerID);
     mTimeStatsTracker.erase(layerID);
 }
 
@@ -431,19 +457,19 @@ void TimeStats::removeTimeRecord(int32_t layerID, uint64_t frameNumber) {
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerID, frameNumber);
 
     std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerID)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerID];
+    LayerRecord* layerRecord = getLayerRecordLocked(layerID);
+    if (!layerRecord) return;
     size_t removeAt = 0;
-    for (const TimeRecord& record : layerRecord.timeRecords) {
+    for (const TimeRecord& record : layerRecord->timeRecords) {
         if (record.frameTime.frameNumber == frameNumber) break;
         removeAt++;
     }
-    if (removeAt == layerRecord.timeRecords.size()) return;
-    layerRecord.timeRecords.erase(layerRecord.timeRecords.begin() + removeAt);
-    if (layerRecord.waitData > static_cast<int32_t>(removeAt)) {
-        layerRecord.waitData--;
+    if (removeAt == layerRecord->timeRecords.size()) return;
+    layerRecord->timeRecords.erase(layerRecord->timeRecords.begin() + removeAt);
+    if (layerRecord->waitData > static_cast<int32_t>(removeAt)) {
+        layerRecord->waitData--;
     }
-    layerRecord.droppedFrames++;
+    layerRecord->droppedFrames++;
 }
 
 void TimeStats::flushPowerTimeLocked() {
@@ -579,7 +605,9 @@ void TimeStats::clear() {
 
     std::lock_guard<std::mutex> lock(mMutex);
     mTimeStatsTracker.clear();
+    mRejectedLayers.clear();
     mTimeStats.stats.clear();
+    mTimeStats.uidStats.clear();
     mTimeStats.statsStart = (mEnabled.load() ? static_cast<int64_t>(std::time(0)) : 0);
     mTimeStats.statsEnd = 0;
     mTimeStats.totalFrames = 0;
@@ -30,6 +30,7 @@
 #include <mutex>
 #include <optional>
 #include <unordered_map>
+#include <unordered_set>
 
 using namespace android::surfaceflinger;
 
@@ -42,13 +43,16 @@ public:
     virtual void parseArgs(bool asProto, const Vector<String16>& args, std::string& result) = 0;
     virtual bool isEnabled() = 0;
     virtual std::string miniDump() = 0;
+    // Serialized SFTimeStatsGlobalProto, for callers that pull the stats
+    // directly instead of through dumpsys.
+    virtual std::string dumpProto(std::optional<uint32_t> maxLayers) = 0;
 
     virtual void incrementTotalFrames() = 0;
     virtual void incrementMissedFrames() = 0;
     virtual void incrementClientCompositionFrames() = 0;
 
     virtual void setPostTime(int32_t layerID, uint64_t frameNumber, const std::string& layerName,
-                             nsecs_t postTime) = 0;
+                             int32_t uid, nsecs_t postTime) = 0;
     virtual void setLatchTime(int32_t layerID, uint64_t frameNumber, nsecs_t latchTime) = 0;
     virtual void setDesiredTime(int32_t layerID, uint64_t frameNumber, nsecs_t desiredTime) = 0;
     virtual void setAcquireTime(int32_t layerID, uint64_t frameNumber, nsecs_t acquireTime) = 0;
@@ -89,6 +93,7 @@ class TimeStats : public android::TimeStats {
 
     struct LayerRecord {
         std::string layerName;
+        int32_t uid = -1;
         // This is the index in timeRecords, at which the timestamps for that
         // specific frame are still not fully received. This is not waiting for
         // fences to signal, but rather waiting to receive those fences/timestamps.
@@ -114,13 +119,14 @@ public:
     void parseArgs(bool asProto, const Vector<String16>& args, std::string& result) override;
     bool isEnabled() override;
     std::string miniDump() override;
+    std::string dumpProto(std::optional<uint32_t> maxLayers) override;
 
     void incrementTotalFrames() override;
     void incrementMissedFrames() override;
     void incrementClientCompositionFrames() override;
 
     void setPostTime(int32_t layerID, uint64_t frameNumber, const std::string& layerName,
-                     nsecs_t postTime) override;
+                     int32_t uid, nsecs_t postTime) override;
     void setLatchTime(int32_t layerID, uint64_t frameNumber, nsecs_t latchTime) override;
     void setDesiredTime(int32_t layerID, uint64_t frameNumber, nsecs_t desiredTime) override;
     void setAcquireTime(int32_t layerID, uint64_t frameNumber, nsecs_t acquireTime) override;
@@ -142,8 +148,12 @@ public:
     static const size_t MAX_NUM_TIME_RECORDS = 64;
 
 private:
+    LayerRecord* getLayerRecordLocked(int32_t layerID);
+    // Returns the record that is still waiting for timestamps if it is for
+    // frameNumber, or nullptr otherwise.
+    TimeRecord* getWaitingTimeRecordLocked(LayerRecord& layerRecord, uint64_t frameNumber);
     bool recordReadyLocked(int32_t layerID, TimeRecord* timeRecord);
-    void flushAvailableRecordsToStatsLocked(int32_t layerID);
+    void flushAvailableRecordsToStatsLocked(int32_t layerID, LayerRecord& layerRecord);
     void flushPowerTimeLocked();
     void flushAvailableGlobalRecordsToStatsLocked();
 
@@ -157,10 +167,13 @@ private:
     TimeStatsHelper::TimeStatsGlobal mTimeStats;
     // Hashmap for LayerRecord with layerID as the hash key
     std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
+    // Layers whose name will never be tracked
+    std::unordered_set<int32_t> mRejectedLayers;
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
 
     static const size_t MAX_NUM_LAYER_RECORDS = 200;
+    static const size_t MAX_NUM_UID_RECORDS = 200;
 };
 
 } // namespace impl
@@ -95,6 +95,18 @@ std::string TimeStatsHelper::TimeStatsLayer::toString() const {
     return result;
 }
 
+std::string TimeStatsHelper::TimeStatsUid::toString() const {
+    std::string result = "\n";
+    StringAppendF(&result, "uid = %d\n", uid);
+    StringAppendF(&result, "totalFrames = %d\n", totalFrames);
+    for (const auto& ele : deltas) {
+        StringAppendF(&result, "%s histogram is as below:\n", ele.first.c_str());
+        result.append(ele.second.toString());
+    }
+
+    return result;
+}
+
 std::string TimeStatsHelper::TimeStatsGlobal::toString(std::optional<uint32_t> maxLayers) const {
     std::string result = "SurfaceFlinger TimeStats:\n";
     StringAppendF(&result, "statsStart = %" PRId64 "\n", statsStart);
@@ -115,6 +127,9 @@ std::string TimeStatsHelper::TimeStatsGlobal::toString(std::optional<uint32_t> m
     for (const auto& ele : dumpStats) {
         result.append(ele->toString());
     }
+    for (const auto& ele : uidStats) {
+        result.append(ele.second.toString());
+    }
 
     return result;
 }
@@ -137,6 +152,22 @@ SFTimeStatsLayerProto TimeStatsHelper::TimeStatsLayer::toProto() const {
     return layerProto;
 }
 
+SFTimeStatsUidProto TimeStatsHelper::TimeStatsUid::toProto() const {
+    SFTimeStatsUidProto uidProto;
+    uidProto.set_uid(uid);
+    uidProto.set_total_frames(totalFrames);
+    for (const auto& ele : deltas) {
+        SFTimeStatsDeltaProto* deltaProto = uidProto.add_deltas();
+        deltaProto->set_delta_name(ele.first);
+        for (const auto& histEle : ele.second.hist) {
+            SFTimeStatsHistogramBucketProto* histProto = deltaProto->add_histograms();
+            histProto->set_time_millis(histEle.first);
+            histProto->set_frame_count(histEle.second);
+        }
+    }
+    return uidProto;
+}
+
 SFTimeStatsGlobalProto TimeStatsHelper::TimeStatsGlobal::toProto(
         std::optional<uint32_t> maxLayers) const {
     SFTimeStatsGlobalProto globalProto;
@@ -163,6 +194,10 @@ SFTimeStatsGlobalProto TimeStatsHelper::TimeStatsGlobal::toProto(
         SFTimeStatsLayerProto* layerProto = globalProto.add_stats();
         layerProto->CopyFrom(ele->toProto());
     }
+    for (const auto& ele : uidStats) {
+        SFTimeStatsUidProto* uidProto = globalProto.add_uid_stats();
+        uidProto->CopyFrom(ele.second.toProto());
+    }
     return globalProto;
 }
 
@@ -52,6 +52,17 @@ public:
         SFTimeStatsLayerProto toProto() const;
     };
 
+    // Latency of all tracked layers owned by one app
+    class TimeStatsUid {
+    public:
+        int32_t uid = -1;
+        int32_t totalFrames = 0;
+        std::unordered_map<std::string, Histogram> deltas;
+
+        std::string toString() const;
+        SFTimeStatsUidProto toProto() const;
+    };
+
     class TimeStatsGlobal {
     public:
         int64_t statsStart = 0;
@@ -62,6 +73,7 @@ public:
         int64_t displayOnTime = 0;
         Histogram presentToPresent;
         std::unordered_map<std::string, TimeStatsLayer> stats;
+        std::unordered_map<int32_t, TimeStatsUid> uidStats;
         std::unordered_map<uint32_t, nsecs_t> refreshRateStats;
 
         std::string toString(std::optional<uint32_t> maxLayers) const;
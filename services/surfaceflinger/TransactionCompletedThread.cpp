@@ -24,6 +24,7 @@
 #include <cinttypes>
 
 #include <binder/IInterface.h>
+#include <binder/IPCThreadState.h>
 #include <gui/ITransactionCompletedListener.h>
 #include <utils/RefBase.h>
 
@@ -261,18 +262,11 @@ void TransactionCompletedThread::threadMain() {
             }
             // If the listener has completed transactions
             if (!listenerStats.transactionStats.empty()) {
-                // If the listener is still alive
-                if (IInterface::asBinder(listener)->isBinderAlive()) {
-                    // Send callback
-                    listenerStats.listener->onTransactionCompleted(listenerStats);
-                    IInterface::asBinder(listener)->unlinkToDeath(mDeathRecipient);
-                }
+                completedListenerStats.push_back(std::move(listenerStats));
                 completedTransactionsItr = mCompletedTransactions.erase(completedTransactionsItr);
             } else {
                 completedTransactionsItr++;
             }
-
-            completedListenerStats.push_back(std::move(listenerStats));
         }
 
         if (mPresentFence) {
@@ -289,7 +283,23 @@ void TransactionCompletedThread::threadMain() {
         //
         // To avoid this deadlock, we need to unlock mMutex when dropping our last reference to
         // to the layer.
+        //
+        // The callbacks are sent unlocked too, so that the main thread can keep adding callback
+        // handles for the next frame while they are written. They are oneway, so all listeners
+        // are sent to in one driver write.
         mMutex.unlock();
+        IPCThreadState::self()->beginOnewayBatch();
+        for (const auto& listenerStats : completedListenerStats) {
+            const sp<IBinder> binder = IInterface::asBinder(listenerStats.listener);
+            // If the listener is still alive
+            if (binder->isBinderAlive()) {
+                listenerStats.listener->onTransactionCompleted(listenerStats);
+                binder->unlinkToDeath(mDeathRecipient);
+            }
+        }
+        if (status_t err = IPCThreadState::self()->endOnewayBatch(); err != NO_ERROR) {
+            ALOGW("Failed to send transaction callbacks: %s (%d)", strerror(-err), err);
+        }
         completedListenerStats.clear();
         mMutex.lock();
     }
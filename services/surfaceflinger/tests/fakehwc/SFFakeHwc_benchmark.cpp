@@ -0,0 +1,262 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "FakeHwcBenchmark"
+
+#include "FakeComposerClient.h"
+#include "FakeComposerService.h"
+#include "FakeComposerUtils.h"
+
+#include <gui/Surface.h>
+#include <gui/SurfaceComposerClient.h>
+
+#include <android/native_window.h>
+#include <benchmark/benchmark.h>
+#include <binder/ProcessState.h>
+#include <hwbinder/ProcessState.h>
+#include <log/log.h>
+#include <ui/DisplayInfo.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+using namespace android;
+using namespace android::hardware;
+
+using namespace sftest;
+
+namespace {
+
+using Transaction = SurfaceComposerClient::Transaction;
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kLayerSize = 64;
+
+// Frames are allowed longer than the tests' default wait, since some runs
+// compose many layers.
+constexpr auto kFrameTimeout = 500ms;
+
+FakeComposerClient* sFakeComposer;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// A set of small buffer layers laid out in a grid on the primary display,
+// shown and presented once before the benchmark loop starts.
+class LayerSet {
+public:
+    LayerSet(const sp<SurfaceComposerClient>& client, size_t count) {
+        const auto display = SurfaceComposerClient::getPhysicalDisplayToken(PRIMARY_DISPLAY);
+        DisplayInfo info;
+        SurfaceComposerClient::getDisplayInfo(display, &info);
+        const uint32_t columns = std::max(1u, info.w / kLayerSize);
+
+        Transaction t;
+        t.setDisplayLayerStack(display, 0);
+        for (size_t i = 0; i < count; i++) {
+            sp<SurfaceControl> sc =
+                    client->createSurface(String8::format("Benchmark Surface %zu", i),
+                                          kLayerSize, kLayerSize, PIXEL_FORMAT_RGBA_8888, 0);
+            if (sc == nullptr || !sc->isValid()) {
+                ALOGE("Failed to create layer %zu", i);
+                return;
+            }
+            t.setLayer(sc, static_cast<int32_t>(i));
+            t.setPosition(sc, (i % columns) * kLayerSize, (i / columns) * kLayerSize);
+            t.show(sc);
+            mLayers.push_back(sc);
+        }
+        postBuffers();
+        t.apply();
+        mValid = presentFrame();
+    }
+
+    ~LayerSet() {
+        mLayers.clear();
+        presentFrame();
+        sFakeComposer->clearFrames();
+    }
+
+    bool isValid() const { return mValid; }
+    const std::vector<sp<SurfaceControl>>& layers() const { return mLayers; }
+
+    // Queues a new buffer to every layer, without drawing into it.
+    void postBuffers() {
+        for (const auto& sc : mLayers) {
+            ANativeWindow_Buffer outBuffer;
+            sp<Surface> s = sc->getSurface();
+            if (s->lock(&outBuffer, nullptr) == NO_ERROR) {
+                s->unlockAndPost();
+            }
+        }
+    }
+
+    // Runs a VSYNC and waits until the fake composer has presented the
+    // resulting frame. Returns false on a timeout.
+    static bool presentFrame() {
+        const int frame = sFakeComposer->getFrameCount();
+        sFakeComposer->runVSyncAndWait(kFrameTimeout);
+        return sFakeComposer->getFrameCount() > frame;
+    }
+
+private:
+    std::vector<sp<SurfaceControl>> mLayers;
+    bool mValid = false;
+};
+
+sp<SurfaceComposerClient> createClient(benchmark::State& state) {
+    sp<SurfaceComposerClient> client = new SurfaceComposerClient;
+    if (client->initCheck() != NO_ERROR) {
+        state.SkipWithError("SurfaceComposerClient failed to initialize");
+        return nullptr;
+    }
+    return client;
+}
+
+// Time for SurfaceComposerClient::Transaction::apply to change every layer,
+// which covers the binder call and SurfaceFlinger queueing the state.
+void BM_TransactionApply(benchmark::State& state) {
+    sp<SurfaceComposerClient> client = createClient(state);
+    if (client == nullptr) {
+        return;
+    }
+    LayerSet layerSet(client, state.range(0));
+    if (!layerSet.isValid()) {
+        state.SkipWithError("Failed to present the initial frame");
+        return;
+    }
+
+    float alpha = 1.0f;
+    for (auto _ : state) {
+        alpha = alpha < 1.0f ? 1.0f : 0.5f;
+        Transaction t;
+        for (const auto& sc : layerSet.layers()) {
+            t.setAlpha(sc, alpha);
+        }
+
+        const auto start = Clock::now();
+        t.apply();
+        state.SetIterationTime(secondsSince(start));
+
+        // Keep SurfaceFlinger from accumulating pending state
+        if (!LayerSet::presentFrame()) {
+            state.SkipWithError("Frame timed out");
+            break;
+        }
+    }
+    client->dispose();
+}
+BENCHMARK(BM_TransactionApply)->RangeMultiplier(4)->Range(1, 64)->UseManualTime();
+
+// Time from applying a transaction that changes every layer until the fake
+// composer has presented the frame containing it. This covers the main
+// thread's transaction handling, invalidate and refresh.
+void BM_TransactionToPresent(benchmark::State& state) {
+    sp<SurfaceComposerClient> client = createClient(state);
+    if (client == nullptr) {
+        return;
+    }
+    LayerSet layerSet(client, state.range(0));
+    if (!layerSet.isValid()) {
+        state.SkipWithError("Failed to present the initial frame");
+        return;
+    }
+
+    float alpha = 1.0f;
+    for (auto _ : state) {
+        alpha = alpha < 1.0f ? 1.0f : 0.5f;
+        Transaction t;
+        for (const auto& sc : layerSet.layers()) {
+            t.setAlpha(sc, alpha);
+        }
+
+        const auto start = Clock::now();
+        t.apply();
+        if (!LayerSet::presentFrame()) {
+            state.SkipWithError("Frame timed out");
+            break;
+        }
+        state.SetIterationTime(secondsSince(start));
+    }
+    client->dispose();
+}
+BENCHMARK(BM_TransactionToPresent)->RangeMultiplier(4)->Range(1, 64)->UseManualTime();
+
+// Time from the VSYNC until the fake composer has presented a frame that
+// latches a new buffer on every layer.
+void BM_LatchToPresent(benchmark::State& state) {
+    sp<SurfaceComposerClient> client = createClient(state);
+    if (client == nullptr) {
+        return;
+    }
+    LayerSet layerSet(client, state.range(0));
+    if (!layerSet.isValid()) {
+        state.SkipWithError("Failed to present the initial frame");
+        return;
+    }
+
+    for (auto _ : state) {
+        layerSet.postBuffers();
+
+        const auto start = Clock::now();
+        if (!LayerSet::presentFrame()) {
+            state.SkipWithError("Frame timed out");
+            break;
+        }
+        state.SetIterationTime(secondsSince(start));
+    }
+    client->dispose();
+}
+BENCHMARK(BM_LatchToPresent)->RangeMultiplier(4)->Range(1, 64)->UseManualTime();
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+
+    sftest::FakeHwcEnvironment fakeEnvironment;
+    fakeEnvironment.SetUp();
+
+    // TODO: See TODO comment at DisplayTest::SetUp in SFFakeHwc_test.cpp for
+    // background on the lifetime of the FakeComposerClient.
+    sFakeComposer = new FakeComposerClient;
+    sp<ComposerClient> client = new ComposerClient(sFakeComposer);
+    sp<IComposer> fakeService = new FakeComposerService(client);
+    (void)fakeService->registerAsService("mock");
+
+    android::hardware::ProcessState::self()->startThreadPool();
+    android::ProcessState::self()->startThreadPool();
+
+    startSurfaceFlinger();
+
+    // Fake composer wants to enable VSync injection
+    sFakeComposer->onSurfaceFlingerStart();
+
+    ::benchmark::RunSpecifiedBenchmarks();
+
+    // Fake composer needs to release SurfaceComposerClient before the stop.
+    sFakeComposer->onSurfaceFlingerStop();
+    stopSurfaceFlinger();
+    sFakeComposer = nullptr;
+
+    fakeEnvironment.TearDown();
+    return 0;
+}
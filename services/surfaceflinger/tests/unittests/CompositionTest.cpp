@@ -296,7 +296,7 @@ struct BaseDisplayVariant {
         EXPECT_CALL(*test->mComposer,
                     setColorTransform(HWC_DISPLAY, _, Hwc2::ColorTransform::IDENTITY))
                 .Times(1);
-        EXPECT_CALL(*test->mComposer, presentOrValidateDisplay(HWC_DISPLAY, _, _, _, _)).Times(1);
+        Case::CompositionType::setupHwcValidateCallExpectations(test);
         EXPECT_CALL(*test->mComposer, getDisplayRequests(HWC_DISPLAY, _, _, _)).Times(1);
         EXPECT_CALL(*test->mComposer, acceptDisplayChanges(HWC_DISPLAY)).Times(1);
         EXPECT_CALL(*test->mComposer, presentDisplay(HWC_DISPLAY, _)).Times(1);
@@ -904,9 +904,26 @@ struct BufferLayerVariant : public BaseLayerVariant<LayerProperties> {
  * Variants to control how the composition type is changed
  */
 
+// Layers that request client composition cannot be presented before the
+// client target is rendered, so those frames are validated explicitly.
+template <IComposerClient::Composition RequestedCompositionType>
+void setupHwcValidateCallExpectationsFor(CompositionTest* test) {
+    if (RequestedCompositionType == IComposerClient::Composition::CLIENT) {
+        EXPECT_CALL(*test->mComposer, presentOrValidateDisplay(HWC_DISPLAY, _, _, _, _)).Times(0);
+        EXPECT_CALL(*test->mComposer, validateDisplay(HWC_DISPLAY, _, _)).Times(1);
+    } else {
+        EXPECT_CALL(*test->mComposer, presentOrValidateDisplay(HWC_DISPLAY, _, _, _, _)).Times(1);
+        EXPECT_CALL(*test->mComposer, validateDisplay(HWC_DISPLAY, _, _)).Times(0);
+    }
+}
+
 struct NoCompositionTypeVariant {
     static void setupHwcSetCallExpectations(CompositionTest*) {}
 
+    static void setupHwcValidateCallExpectations(CompositionTest* test) {
+        setupHwcValidateCallExpectationsFor<IComposerClient::Composition::INVALID>(test);
+    }
+
     static void setupHwcGetCallExpectations(CompositionTest* test) {
         EXPECT_CALL(*test->mComposer, getChangedCompositionTypes(HWC_DISPLAY, _, _)).Times(1);
     }
@@ -922,6 +939,10 @@ struct KeepCompositionTypeVariant {
                 .Times(1);
     }
 
+    static void setupHwcValidateCallExpectations(CompositionTest* test) {
+        setupHwcValidateCallExpectationsFor<CompositionType>(test);
+    }
+
     static void setupHwcGetCallExpectations(CompositionTest* test) {
         EXPECT_CALL(*test->mComposer, getChangedCompositionTypes(HWC_DISPLAY, _, _)).Times(1);
     }
@@ -938,6 +959,10 @@ struct ChangeCompositionTypeVariant {
                 .Times(1);
     }
 
+    static void setupHwcValidateCallExpectations(CompositionTest* test) {
+        setupHwcValidateCallExpectationsFor<InitialCompositionType>(test);
+    }
+
     static void setupHwcGetCallExpectations(CompositionTest* test) {
         EXPECT_CALL(*test->mComposer, getChangedCompositionTypes(HWC_DISPLAY, _, _))
                 .WillOnce(DoAll(SetArgPointee<1>(std::vector<Hwc2::Layer>{
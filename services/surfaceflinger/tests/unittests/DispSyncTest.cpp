@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LibSurfaceFlingerUnittests"
+
+#include <gtest/gtest.h>
+
+#include <log/log.h>
+
+#include "Scheduler/DispSync.h"
+
+namespace android {
+namespace {
+
+constexpr nsecs_t kPeriod = 16666667;
+constexpr nsecs_t kStartTime = 1000000000;
+
+class DispSyncTest : public testing::Test {
+protected:
+    DispSyncTest() { mDispSync.init(true, 0); }
+
+    // Returns true if the model still wants more samples.
+    bool addSample(nsecs_t timestamp) {
+        bool periodChanged = false;
+        const bool needsMore = mDispSync.addResyncSample(timestamp, &periodChanged);
+        EXPECT_FALSE(periodChanged);
+        return needsMore;
+    }
+
+    impl::DispSync mDispSync{"DispSyncTest"};
+};
+
+TEST_F(DispSyncTest, cleanSamplesLockModelEarly) {
+    EXPECT_TRUE(addSample(kStartTime));
+    EXPECT_TRUE(addSample(kStartTime + kPeriod));
+    EXPECT_TRUE(addSample(kStartTime + 2 * kPeriod));
+    EXPECT_FALSE(addSample(kStartTime + 3 * kPeriod));
+    EXPECT_NEAR(kPeriod, mDispSync.getPeriod(), 10);
+
+    std::string dump;
+    mDispSync.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("model confidence: 1.00"));
+}
+
+TEST_F(DispSyncTest, noisySamplesNeedFullResync) {
+    for (int i = 0; i < 5; i++) {
+        const nsecs_t jitter = (i % 2) ? 100000 : -100000;
+        EXPECT_TRUE(addSample(kStartTime + i * kPeriod + jitter));
+    }
+    EXPECT_FALSE(addSample(kStartTime + 5 * kPeriod + 100000));
+}
+
+TEST_F(DispSyncTest, rejectsOutliersAndMissedVsyncs) {
+    // Vsyncs 3 and 6 are missing, vsync 5 has a bad timestamp.
+    const int vsyncs[] = {0, 1, 2, 4, 5, 7, 8, 9};
+    for (int vsync : vsyncs) {
+        const nsecs_t outlier = (vsync == 5) ? 2000000 : 0;
+        addSample(kStartTime + vsync * kPeriod + outlier);
+    }
+    const nsecs_t period = mDispSync.getPeriod();
+    EXPECT_NEAR(kPeriod, period, 1000);
+
+    // The predicted vsyncs stay in phase with the last sample.
+    const nsecs_t phase = (mDispSync.computeNextRefresh(0) - (kStartTime + 9 * kPeriod)) % period;
+    EXPECT_TRUE(phase < 10000 || phase > period - 10000) << "phase " << phase;
+
+    std::string dump;
+    mDispSync.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("1 outliers"));
+}
+
+} // namespace
+} // namespace android
@@ -81,6 +81,7 @@ protected:
                                                 bool expectedConnected);
     void expectConfigChangedEventReceivedByConnection(PhysicalDisplayId expectedDisplayId,
                                                       int32_t expectedConfigId);
+    void queueVSyncEvents(std::initializer_list<nsecs_t> timestamps);
 
     AsyncCallRecorder<void (*)(bool)> mVSyncSetEnabledCallRecorder;
     AsyncCallRecorder<void (*)(VSyncSource::Callback*)> mVSyncSetCallbackCallRecorder;
@@ -210,6 +211,21 @@ void EventThreadTest::expectConfigChangedEventReceivedByConnection(
     EXPECT_EQ(expectedConfigId, event.config.configId);
 }
 
+// Queues the events in one step, as if the thread had fallen behind the VSYNC source.
+void EventThreadTest::queueVSyncEvents(std::initializer_list<nsecs_t> timestamps) {
+    {
+        std::lock_guard<std::mutex> lock(mThread->mMutex);
+        for (const nsecs_t timestamp : timestamps) {
+            DisplayEventReceiver::Event event;
+            event.header = {DisplayEventReceiver::DISPLAY_EVENT_VSYNC,
+                            mThread->mVSyncState->displayId, timestamp};
+            event.vsync.count = ++mThread->mVSyncState->count;
+            mThread->mPendingEvents.push_back(event);
+        }
+    }
+    mThread->mCondition.notify_all();
+}
+
 namespace {
 
 /* ------------------------------------------------------------------------
@@ -343,6 +359,62 @@ TEST_F(EventThreadTest, setVsyncRateTwoPostsEveryOtherEventToThatConnection) {
     expectVsyncEventReceivedByConnection(101112, 4u);
 }
 
+TEST_F(EventThreadTest, backToBackVSyncEventsAreCollapsed) {
+    mThread->setVsyncRate(1, mConnection);
+
+    // EventThread should enable vsync callbacks.
+    expectVSyncSetEnabledCallReceived(true);
+
+    // Only the latest of the queued events is seen by the interceptor and the connection.
+    queueVSyncEvents({123, 456, 789});
+    expectInterceptCallReceived(789);
+    expectVsyncEventReceivedByConnection(789, 3u);
+    EXPECT_FALSE(mInterceptVSyncCallRecorder.waitForUnexpectedCall().has_value());
+    EXPECT_FALSE(mConnectionEventCallRecorder.waitForUnexpectedCall().has_value());
+}
+
+TEST_F(EventThreadTest, backToBackVSyncEventsAreNotCollapsedForVsyncRateAboveOne) {
+    mThread->setVsyncRate(2, mConnection);
+
+    // EventThread should enable vsync callbacks.
+    expectVSyncSetEnabledCallReceived(true);
+
+    // Every queued event is seen by the interceptor, and the connection still gets its slot.
+    queueVSyncEvents({123, 456, 789});
+    expectInterceptCallReceived(123);
+    expectInterceptCallReceived(456);
+    expectInterceptCallReceived(789);
+    expectVsyncEventReceivedByConnection(456, 2u);
+    EXPECT_FALSE(mConnectionEventCallRecorder.waitForUnexpectedCall().has_value());
+}
+
+TEST_F(EventThreadTest, requestNextVsyncWhileVSyncIsEnabledIsServedByTheNextEvent) {
+    // Keep vsync enabled through a second connection.
+    ConnectionEventRecorder periodicConnectionEventRecorder{0};
+    sp<MockEventThreadConnection> periodicConnection =
+            createConnection(periodicConnectionEventRecorder);
+    mThread->setVsyncRate(1, periodicConnection);
+    expectVSyncSetEnabledCallReceived(true);
+
+    // The request does not need to wake the thread, but must still be served.
+    mThread->requestNextVsync(mConnection);
+    EXPECT_TRUE(mResyncCallRecorder.waitForCall().has_value());
+
+    mCallback->onVSyncEvent(123);
+    expectInterceptCallReceived(123);
+    expectVsyncEventReceivedByConnection(123, 1u);
+    expectVsyncEventReceivedByConnection("periodicConnection", periodicConnectionEventRecorder,
+                                         123, 1u);
+
+    // The single request is consumed, the periodic one is not.
+    mCallback->onVSyncEvent(456);
+    expectInterceptCallReceived(456);
+    EXPECT_FALSE(mConnectionEventCallRecorder.waitForUnexpectedCall().has_value());
+    expectVsyncEventReceivedByConnection("periodicConnection", periodicConnectionEventRecorder,
+                                         456, 2u);
+    EXPECT_FALSE(mVSyncSetEnabledCallRecorder.waitForUnexpectedCall().has_value());
+}
+
 TEST_F(EventThreadTest, connectionsRemovedIfInstanceDestroyed) {
     mThread->setVsyncRate(1, mConnection);
 
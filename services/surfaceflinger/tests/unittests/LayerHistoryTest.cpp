@@ -85,6 +85,36 @@ TEST_F(LayerHistoryTest, explicitTimestamp) {
     EXPECT_FLOAT_EQ(30.f, mLayerHistory->getDesiredRefreshRateAndHDR().first);
 }
 
+TEST_F(LayerHistoryTest, videoCadenceIsDetectedDespiteJitter) {
+    std::unique_ptr<LayerHistory::LayerHandle> testVideoLayer =
+            mLayerHistory->createLayer("24FpsVideoLayer", MAX_REFRESH_RATE);
+    mLayerHistory->setVisibility(testVideoLayer, true);
+
+    // 23.976 fps with up to 1.5 ms of jitter and one dropped frame.
+    nsecs_t presentTime = systemTime();
+    for (int i = 0; i < 31; i++) {
+        presentTime += 41708333 + ((i % 3) - 1) * 1500000 + (i == 17 ? 41708333 : 0);
+        mLayerHistory->insert(testVideoLayer, presentTime, false /*isHDR*/);
+    }
+
+    EXPECT_FLOAT_EQ(24.f, mLayerHistory->getDesiredRefreshRateAndHDR().first);
+}
+
+TEST_F(LayerHistoryTest, irregularCadenceUsesMaxRefreshRate) {
+    std::unique_ptr<LayerHistory::LayerHandle> testLayer =
+            mLayerHistory->createLayer("JitteryLayer", MAX_REFRESH_RATE);
+    mLayerHistory->setVisibility(testLayer, true);
+
+    constexpr nsecs_t durations[] = {11111111, 22222222, 16666667};
+    nsecs_t presentTime = systemTime();
+    for (int i = 0; i < 31; i++) {
+        presentTime += durations[i % 3];
+        mLayerHistory->insert(testLayer, presentTime, false /*isHDR*/);
+    }
+
+    EXPECT_FLOAT_EQ(MAX_REFRESH_RATE, mLayerHistory->getDesiredRefreshRateAndHDR().first);
+}
+
 TEST_F(LayerHistoryTest, multipleLayers) {
     std::unique_ptr<LayerHistory::LayerHandle> testLayer =
             mLayerHistory->createLayer("TestLayer", MAX_REFRESH_RATE);
@@ -136,4 +136,17 @@ TEST_F(RegionSamplingTest, orientation_90) {
                 testing::Eq(1.0));
 }
 
+TEST_F(RegionSamplingTest, sampling_scale) {
+    EXPECT_EQ(1, getSamplingScale(kWidth, kHeight));
+    EXPECT_EQ(1, getSamplingScale(256, 256));
+    EXPECT_EQ(2, getSamplingScale(257, 256));
+    EXPECT_EQ(9, getSamplingScale(1440, 2960));
+}
+
+TEST_F(RegionSamplingTest, scaled_area_rounds_outwards) {
+    EXPECT_EQ(Rect(0, 0, kWidth, kHeight), scaleSamplingArea(whole_area, 1));
+    EXPECT_EQ(Rect(1, 0, 4, 2), scaleSamplingArea(Rect(5, 3, 13, 7), 4));
+    EXPECT_EQ(Rect(25, 8), scaleSamplingArea(whole_area, 4));
+}
+
 } // namespace android
@@ -47,6 +47,7 @@ using testing::UnorderedElementsAre;
 #define LAYER_ID_0         0
 #define LAYER_ID_1         1
 #define LAYER_ID_INVALID   -1
+#define UID_0              10000
 #define NUM_LAYERS         1
 #define NUM_LAYERS_INVALID "INVALID"
 
@@ -178,7 +179,8 @@ static std::string genLayerName(int32_t layerID) {
 void TimeStatsTest::setTimeStamp(TimeStamp type, int32_t id, uint64_t frameNumber, nsecs_t ts) {
     switch (type) {
         case TimeStamp::POST:
-            ASSERT_NO_FATAL_FAILURE(mTimeStats->setPostTime(id, frameNumber, genLayerName(id), ts));
+            ASSERT_NO_FATAL_FAILURE(
+                    mTimeStats->setPostTime(id, frameNumber, genLayerName(id), UID_0, ts));
             break;
         case TimeStamp::ACQUIRE:
             ASSERT_NO_FATAL_FAILURE(mTimeStats->setAcquireTime(id, frameNumber, ts));
@@ -325,6 +327,21 @@ TEST_F(TimeStatsTest, canNotInsertInvalidLayerNameTimeStats) {
     ASSERT_EQ(0, globalProto.stats_size());
 }
 
+TEST_F(TimeStatsTest, canInsertLayerTimeStatsAfterInvalidLayerIdIsDestroyed) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    ASSERT_NO_FATAL_FAILURE(mTimeStats->setPostTime(LAYER_ID_0, 1, "invalid.dummy", UID_0, 1000000));
+    ASSERT_NO_FATAL_FAILURE(mTimeStats->onDestroy(LAYER_ID_0));
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 2, 2000000);
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 3, 3000000);
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(1, globalProto.stats_size());
+    EXPECT_EQ(genLayerName(LAYER_ID_0), globalProto.stats(0).layer_name());
+}
+
 TEST_F(TimeStatsTest, canInsertMultipleLayersTimeStats) {
     EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
 
@@ -339,6 +356,28 @@ TEST_F(TimeStatsTest, canInsertMultipleLayersTimeStats) {
     EXPECT_EQ(2, globalProto.stats_size());
 }
 
+TEST_F(TimeStatsTest, canInsertUidTimeStats) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 1, 1000000);
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_1, 1, 1000000);
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 2, 2000000);
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_1, 2, 2000000);
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(mTimeStats->dumpProto(std::nullopt)));
+
+    ASSERT_EQ(1, globalProto.uid_stats_size());
+    const SFTimeStatsUidProto& uidProto = globalProto.uid_stats(0);
+    EXPECT_EQ(UID_0, uidProto.uid());
+    EXPECT_EQ(2, uidProto.total_frames());
+    ASSERT_EQ(2, uidProto.deltas_size());
+    for (const SFTimeStatsDeltaProto& deltaProto : uidProto.deltas()) {
+        ASSERT_EQ(1, deltaProto.histograms_size());
+        EXPECT_EQ(2, deltaProto.histograms(0).frame_count());
+    }
+}
+
 TEST_F(TimeStatsTest, canInsertUnorderedLayerTimeStats) {
     EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
 
@@ -4,6 +4,7 @@
 #include <pdx/status.h>
 #include <private/dvr/bufferhub_rpc.h>
 #include <private/dvr/buffer_hub.h>
+#include <private/dvr/ion_buffer.h>
 
 namespace android {
 namespace dvr {
@@ -54,14 +55,14 @@ class ProducerQueueChannel : public BufferHubChannel {
                        const ProducerQueueConfig& config,
                        const UsagePolicy& usage_policy, int* error);
 
-  // Allocate one single producer buffer by |OnProducerQueueAllocateBuffers|.
+  // Creates one single producer buffer by |OnProducerQueueAllocateBuffers|
+  // from a buffer and metadata buffer it has allocated.
   // Note that the newly created buffer's file handle will be pushed to client
   // and our return type is a RemoteChannelHandle.
   // Returns the remote channel handle and the slot number for the newly
   // allocated buffer.
   pdx::Status<std::pair<pdx::RemoteChannelHandle, size_t>> AllocateBuffer(
-      pdx::Message& message, uint32_t width, uint32_t height,
-      uint32_t layer_count, uint32_t format, uint64_t usage);
+      pdx::Message& message, IonBuffer buffer, IonBuffer metadata_buffer);
 
   // The producer queue's configuration. Now we assume the configuration is
   // immutable once the queue is created.
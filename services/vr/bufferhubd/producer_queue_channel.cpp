@@ -1,4 +1,5 @@
 #include <inttypes.h>
+#include <string.h>
 
 #include <private/dvr/consumer_queue_channel.h>
 #include <private/dvr/producer_channel.h>
@@ -179,9 +180,43 @@ ProducerQueueChannel::OnProducerQueueAllocateBuffers(
   uint64_t effective_usage =
       (usage & ~usage_policy_.usage_clear_mask) | usage_policy_.usage_set_mask;
 
+  if (buffer_count > BufferHubRPC::kMaxQueueCapacity - capacity_) {
+    ALOGE(
+        "ProducerQueueChannel::OnProducerQueueAllocateBuffers: %zu buffers "
+        "exceed kMaxQueueCapacity, capacity=%zu.",
+        buffer_count, capacity_);
+    return ErrorStatus(E2BIG);
+  }
+
+  // All buffers share one description, and so do their metadata buffers, so
+  // each set is allocated in a single pass.
+  std::vector<IonBuffer> buffers;
+  if (int ret = IonBuffer::AllocMany(width, height, layer_count, format,
+                                     effective_usage, buffer_count, &buffers)) {
+    ALOGE(
+        "ProducerQueueChannel::OnProducerQueueAllocateBuffers: Failed to "
+        "allocate buffers: %s",
+        strerror(-ret));
+    return ErrorStatus(ENOMEM);
+  }
+
+  const size_t metadata_buf_size =
+      BufferHubDefs::kMetadataHeaderSize + config_.user_metadata_size;
+  std::vector<IonBuffer> metadata_buffers;
+  if (int ret = IonBuffer::AllocMany(
+          metadata_buf_size, /*height=*/1, /*layer_count=*/1,
+          BufferHubDefs::kMetadataFormat, BufferHubDefs::kMetadataUsage,
+          buffer_count, &metadata_buffers)) {
+    ALOGE(
+        "ProducerQueueChannel::OnProducerQueueAllocateBuffers: Failed to "
+        "allocate metadata: %s",
+        strerror(-ret));
+    return ErrorStatus(ENOMEM);
+  }
+
   for (size_t i = 0; i < buffer_count; i++) {
-    auto status = AllocateBuffer(message, width, height, layer_count, format,
-                                 effective_usage);
+    auto status = AllocateBuffer(message, std::move(buffers[i]),
+                                 std::move(metadata_buffers[i]));
     if (!status) {
       ALOGE(
           "ProducerQueueChannel::OnProducerQueueAllocateBuffers: Failed to "
@@ -195,9 +230,8 @@ ProducerQueueChannel::OnProducerQueueAllocateBuffers(
 }
 
 Status<std::pair<RemoteChannelHandle, size_t>>
-ProducerQueueChannel::AllocateBuffer(Message& message, uint32_t width,
-                                     uint32_t height, uint32_t layer_count,
-                                     uint32_t format, uint64_t usage) {
+ProducerQueueChannel::AllocateBuffer(Message& message, IonBuffer buffer,
+                                     IonBuffer metadata_buffer) {
   ATRACE_NAME("ProducerQueueChannel::AllocateBuffer");
   ALOGD_IF(TRACE,
            "ProducerQueueChannel::AllocateBuffer: producer_channel_id=%d",
@@ -223,20 +257,19 @@ ProducerQueueChannel::AllocateBuffer(Message& message, uint32_t width,
   ALOGD_IF(TRACE,
            "ProducerQueueChannel::AllocateBuffer: buffer_id=%d width=%u "
            "height=%u layer_count=%u format=%u usage=%" PRIx64,
-           buffer_id, width, height, layer_count, format, usage);
+           buffer_id, buffer.width(), buffer.height(), buffer.layer_count(),
+           buffer.format(), buffer.usage());
   auto buffer_handle = status.take();
 
-  auto producer_channel_status =
-      ProducerChannel::Create(service(), buffer_id, width, height, layer_count,
-                              format, usage, config_.user_metadata_size);
-  if (!producer_channel_status) {
+  std::shared_ptr<ProducerChannel> producer_channel = ProducerChannel::Create(
+      service(), buffer_id, buffer_id, std::move(buffer),
+      std::move(metadata_buffer), config_.user_metadata_size);
+  if (!producer_channel) {
     ALOGE(
         "ProducerQueueChannel::AllocateBuffer: Failed to create producer "
-        "buffer: %s",
-        producer_channel_status.GetErrorMessage().c_str());
+        "buffer.");
     return ErrorStatus(ENOMEM);
   }
-  auto producer_channel = producer_channel_status.take();
 
   ALOGD_IF(
       TRACE,
@@ -1,6 +1,7 @@
 #include "performance_service.h"
 
 #include <sstream>
+#include <unordered_set>
 
 #include <sched.h>
 #include <sys/prctl.h>
@@ -238,87 +239,149 @@ std::string PerformanceService::DumpState(size_t /*max_length*/) {
   return stream.str();
 }
 
-Status<void> PerformanceService::OnSetSchedulerPolicy(
-    Message& message, pid_t task_id, const std::string& scheduler_policy) {
-  ALOGI(
-      "PerformanceService::OnSetSchedulerPolicy: task_id=%d "
-      "scheduler_policy=%s",
-      task_id, scheduler_policy.c_str());
-
+Status<const PerformanceService::SchedulerPolicyConfig*>
+PerformanceService::CheckSchedulerPolicy(
+    const Message& message, pid_t task_id,
+    const std::string& scheduler_policy) const {
   Task task(task_id);
   if (!task) {
     ALOGE(
-        "PerformanceService::OnSetSchedulerPolicy: Unable to access /proc/%d "
+        "PerformanceService::CheckSchedulerPolicy: Unable to access /proc/%d "
         "to gather task information.",
         task_id);
     return ErrorStatus(EINVAL);
   }
 
   auto search = scheduler_policies_.find(scheduler_policy);
-  if (search != scheduler_policies_.end()) {
-    auto config = search->second;
+  if (search == scheduler_policies_.end()) {
+    ALOGE(
+        "PerformanceService::CheckSchedulerPolicy: Invalid scheduler_policy=%s "
+        "requested by task=%d.",
+        scheduler_policy.c_str(), task_id);
+    return ErrorStatus(EINVAL);
+  }
 
-    // Make sure the sending process is allowed to make the requested change to
-    // this task.
-    if (!config.IsAllowed(message, task))
-      return ErrorStatus(EPERM);
+  // Make sure the sending process is allowed to make the requested change to
+  // this task.
+  if (!search->second.IsAllowed(message, task))
+    return ErrorStatus(EPERM);
 
-    if (scheduler_policy == kVrAppRenderPolicy) {
-      // We only allow one vr:app:render thread at a time
-      SetVrAppRenderThread(task_id);
-    }
+  return &search->second;
+}
 
-    // Get the thread group's cpu set. Policies that do not specify a cpuset
-    // should default to this cpuset.
-    std::string thread_group_cpuset;
+void PerformanceService::ApplySchedulerPolicy(
+    pid_t task_id, const std::string& scheduler_policy,
+    const SchedulerPolicyConfig& config) {
+  if (scheduler_policy == kVrAppRenderPolicy) {
+    // We only allow one vr:app:render thread at a time
+    SetVrAppRenderThread(task_id);
+  }
+
+  // Get the thread group's cpu set. Policies that do not specify a cpuset
+  // should default to this cpuset.
+  std::string target_cpuset;
+  if (config.cpuset.empty()) {
+    Task task(task_id);
     Task thread_group{task.thread_group_id()};
     if (thread_group) {
-      thread_group_cpuset = thread_group.GetCpuSetPath();
+      target_cpuset = thread_group.GetCpuSetPath();
     } else {
       ALOGE(
-          "PerformanceService::OnSetSchedulerPolicy: Failed to get thread "
+          "PerformanceService::ApplySchedulerPolicy: Failed to get thread "
           "group tgid=%d for task_id=%d",
           task.thread_group_id(), task_id);
-      thread_group_cpuset = kRootCpuSet;
+      target_cpuset = kRootCpuSet;
     }
+  } else {
+    target_cpuset = config.cpuset;
+  }
+  ALOGI("PerformanceService::ApplySchedulerPolicy: Using cpuset=%s",
+        target_cpuset.c_str());
+
+  auto target_set = cpuset_.Lookup(target_cpuset);
+  if (target_set) {
+    auto attach_status = target_set->AttachTask(task_id);
+    ALOGW_IF(!attach_status,
+             "PerformanceService::ApplySchedulerPolicy: Failed to attach "
+             "task=%d to cpuset=%s: %s",
+             task_id, target_cpuset.c_str(),
+             attach_status.GetErrorMessage().c_str());
+  } else {
+    ALOGW(
+        "PerformanceService::ApplySchedulerPolicy: Failed to lookup "
+        "cpuset=%s",
+        target_cpuset.c_str());
+  }
 
-    std::string target_cpuset;
-    if (config.cpuset.empty()) {
-      target_cpuset = thread_group_cpuset;
-    } else {
-      target_cpuset = config.cpuset;
+  struct sched_param param;
+  param.sched_priority = config.priority;
+
+  sched_setscheduler(task_id, config.scheduler_policy, &param);
+  prctl(PR_SET_TIMERSLACK_PID, config.timer_slack, task_id);
+}
+
+Status<void> PerformanceService::OnSetSchedulerPolicy(
+    Message& message, pid_t task_id, const std::string& scheduler_policy) {
+  ALOGI(
+      "PerformanceService::OnSetSchedulerPolicy: task_id=%d "
+      "scheduler_policy=%s",
+      task_id, scheduler_policy.c_str());
+
+  auto config = CheckSchedulerPolicy(message, task_id, scheduler_policy);
+  if (!config)
+    return config.error_status();
+
+  ApplySchedulerPolicy(task_id, scheduler_policy, *config.get());
+  return {};
+}
+
+Status<void> PerformanceService::OnSetSchedulerPolicies(
+    Message& message,
+    const std::vector<std::pair<pid_t, std::string>>& task_policies) {
+  ALOGI("PerformanceService::OnSetSchedulerPolicies: count=%zu",
+        task_policies.size());
+
+  // Check the whole request before changing anything, so that a rejected
+  // request leaves every task as it was.
+  std::vector<const SchedulerPolicyConfig*> configs;
+  configs.reserve(task_policies.size());
+  std::unordered_set<pid_t> task_ids;
+  pid_t vr_app_render_thread = -1;
+  for (const auto& task_policy : task_policies) {
+    const pid_t task_id = task_policy.first;
+    const std::string& scheduler_policy = task_policy.second;
+
+    if (!task_ids.insert(task_id).second) {
+      ALOGE(
+          "PerformanceService::OnSetSchedulerPolicies: task_id=%d listed more "
+          "than once.",
+          task_id);
+      return ErrorStatus(EINVAL);
     }
-    ALOGI("PerformanceService::OnSetSchedulerPolicy: Using cpuset=%s",
-          target_cpuset.c_str());
-
-    auto target_set = cpuset_.Lookup(target_cpuset);
-    if (target_set) {
-      auto attach_status = target_set->AttachTask(task_id);
-      ALOGW_IF(!attach_status,
-               "PerformanceService::OnSetSchedulerPolicy: Failed to attach "
-               "task=%d to cpuset=%s: %s",
-               task_id, target_cpuset.c_str(),
-               attach_status.GetErrorMessage().c_str());
-    } else {
-      ALOGW(
-          "PerformanceService::OnSetSchedulerPolicy: Failed to lookup "
-          "cpuset=%s",
-          target_cpuset.c_str());
+
+    // Only one vr:app:render thread is allowed at a time.
+    if (scheduler_policy == kVrAppRenderPolicy) {
+      if (vr_app_render_thread >= 0) {
+        ALOGE(
+            "PerformanceService::OnSetSchedulerPolicies: More than one task "
+            "requested %s.",
+            kVrAppRenderPolicy);
+        return ErrorStatus(EINVAL);
+      }
+      vr_app_render_thread = task_id;
     }
 
-    struct sched_param param;
-    param.sched_priority = config.priority;
+    auto config = CheckSchedulerPolicy(message, task_id, scheduler_policy);
+    if (!config)
+      return config.error_status();
+    configs.push_back(config.get());
+  }
 
-    sched_setscheduler(task_id, config.scheduler_policy, &param);
-    prctl(PR_SET_TIMERSLACK_PID, config.timer_slack, task_id);
-    return {};
-  } else {
-    ALOGE(
-        "PerformanceService::OnSetSchedulerPolicy: Invalid scheduler_policy=%s "
-        "requested by task=%d.",
-        scheduler_policy.c_str(), task_id);
-    return ErrorStatus(EINVAL);
+  for (size_t i = 0; i < task_policies.size(); i++) {
+    ApplySchedulerPolicy(task_policies[i].first, task_policies[i].second,
+                         *configs[i]);
   }
+  return {};
 }
 
 Status<void> PerformanceService::OnSetCpuPartition(
@@ -404,6 +467,11 @@ Status<void> PerformanceService::HandleMessage(Message& message) {
           *this, &PerformanceService::OnSetSchedulerPolicy, message);
       return {};
 
+    case PerformanceRPC::SetSchedulerPolicies::Opcode:
+      DispatchRemoteMethod<PerformanceRPC::SetSchedulerPolicies>(
+          *this, &PerformanceService::OnSetSchedulerPolicies, message);
+      return {};
+
     case PerformanceRPC::SetCpuPartition::Opcode:
       DispatchRemoteMethod<PerformanceRPC::SetCpuPartition>(
           *this, &PerformanceService::OnSetCpuPartition, message);
@@ -4,6 +4,8 @@
 #include <functional>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <pdx/service.h>
 
@@ -31,6 +33,9 @@ class PerformanceService : public pdx::ServiceBase<PerformanceService> {
 
   pdx::Status<void> OnSetSchedulerPolicy(pdx::Message& message, pid_t task_id,
                                          const std::string& scheduler_class);
+  pdx::Status<void> OnSetSchedulerPolicies(
+      pdx::Message& message,
+      const std::vector<std::pair<pid_t, std::string>>& task_policies);
 
   pdx::Status<void> OnSetCpuPartition(pdx::Message& message, pid_t task_id,
                                       const std::string& partition);
@@ -75,6 +80,17 @@ class PerformanceService : public pdx::ServiceBase<PerformanceService> {
 
   std::unordered_map<std::string, SchedulerPolicyConfig> scheduler_policies_;
 
+  // Returns the config of |scheduler_policy| if the sender of |message| may
+  // apply it to |task_id|. Does not change any state.
+  pdx::Status<const SchedulerPolicyConfig*> CheckSchedulerPolicy(
+      const pdx::Message& message, pid_t task_id,
+      const std::string& scheduler_policy) const;
+
+  // Moves |task_id| to the cpuset, scheduler policy and timer slack of
+  // |config|. The permission check must already have passed.
+  void ApplySchedulerPolicy(pid_t task_id, const std::string& scheduler_policy,
+                            const SchedulerPolicyConfig& config);
+
   std::function<bool(const pdx::Message& message, const Task& task)>
       partition_permission_check_;
 
@@ -197,6 +197,59 @@ TEST(PerformanceTest, SetSchedulerPolicy) {
   EXPECT_EQ(0, error);
 }
 
+TEST(PerformanceTest, SetSchedulerPolicies) {
+  int error;
+
+  pid_t thread_id = -1;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool policies_set = false;
+
+  std::thread thread{[&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    thread_id = gettid();
+    condition.notify_all();
+    condition.wait(lock, [&] { return policies_set; });
+  }};
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&] { return thread_id >= 0; });
+  }
+
+  const pid_t task_ids[] = {0, thread_id};
+  const char* const policies[] = {"background", "audio:low"};
+  error = dvrSetSchedulerPolicies(task_ids, policies, 2);
+  EXPECT_EQ(0, error);
+  EXPECT_EQ(SCHED_BATCH, sched_getscheduler(0));
+  EXPECT_EQ(SCHED_FIFO | SCHED_RESET_ON_FORK, sched_getscheduler(thread_id));
+
+  // An invalid entry rejects the whole request.
+  const char* const invalid_policies[] = {"normal", "foobar"};
+  error = dvrSetSchedulerPolicies(task_ids, invalid_policies, 2);
+  EXPECT_EQ(-EINVAL, error);
+  EXPECT_EQ(SCHED_BATCH, sched_getscheduler(0));
+  EXPECT_EQ(SCHED_FIFO | SCHED_RESET_ON_FORK, sched_getscheduler(thread_id));
+
+  // Listing a task more than once is rejected.
+  const pid_t duplicate_task_ids[] = {0, 0};
+  error = dvrSetSchedulerPolicies(duplicate_task_ids, policies, 2);
+  EXPECT_EQ(-EINVAL, error);
+
+  const char* const normal_policies[] = {"normal", "normal"};
+  error = dvrSetSchedulerPolicies(task_ids, normal_policies, 2);
+  EXPECT_EQ(0, error);
+  EXPECT_EQ(SCHED_NORMAL, sched_getscheduler(0));
+  EXPECT_EQ(SCHED_NORMAL, sched_getscheduler(thread_id));
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    policies_set = true;
+  }
+  condition.notify_all();
+  thread.join();
+}
+
 TEST(PerformanceTest, SchedulerClassResetOnFork) {
   int error;
 
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <array>
 #include <new>
+#include <vector>
 
 #include <log/log.h>
 
@@ -80,17 +81,25 @@ class Hal {
 
     int GetDebugReportIndex() const { return debug_report_index_; }
 
+    // Like the HAL device's vkEnumerateInstanceExtensionProperties for
+    // pLayerName == nullptr, but from a copy made when the HAL was opened,
+    // since engines often ask many times during startup.
+    VkResult EnumerateInstanceExtensions(uint32_t* count,
+                                         VkExtensionProperties* props) const;
+
    private:
-    Hal() : dev_(nullptr), debug_report_index_(-1) {}
+    Hal() : dev_(nullptr), debug_report_index_(-1), instance_extensions_cached_(false) {}
     Hal(const Hal&) = delete;
     Hal& operator=(const Hal&) = delete;
 
-    bool InitDebugReportIndex();
+    bool InitInstanceExtensions();
 
     static Hal hal_;
 
     const hwvulkan_device_t* dev_;
     int debug_report_index_;
+    bool instance_extensions_cached_;
+    std::vector<VkExtensionProperties> instance_extensions_;
 };
 
 class CreateInfoWrapper {
@@ -281,7 +290,7 @@ bool Hal::Open() {
 
     hal_.dev_ = device;
 
-    hal_.InitDebugReportIndex();
+    hal_.InitInstanceExtensions();
 
     android::GraphicsEnv::getInstance().setDriverLoaded(
         android::GraphicsEnv::Api::API_VK, true, systemTime() - openTime);
@@ -289,7 +298,7 @@ bool Hal::Open() {
     return true;
 }
 
-bool Hal::InitDebugReportIndex() {
+bool Hal::InitInstanceExtensions() {
     ATRACE_CALL();
 
     uint32_t count;
@@ -299,19 +308,13 @@ bool Hal::InitDebugReportIndex() {
         return false;
     }
 
-    VkExtensionProperties* exts = reinterpret_cast<VkExtensionProperties*>(
-        malloc(sizeof(VkExtensionProperties) * count));
-    if (!exts) {
-        ALOGE("failed to allocate HAL instance extension array");
-        return false;
-    }
-
-    if (dev_->EnumerateInstanceExtensionProperties(nullptr, &count, exts) !=
-        VK_SUCCESS) {
+    std::vector<VkExtensionProperties> exts(count);
+    if (dev_->EnumerateInstanceExtensionProperties(nullptr, &count,
+                                                   exts.data()) != VK_SUCCESS) {
         ALOGE("failed to enumerate HAL instance extensions");
-        free(exts);
         return false;
     }
+    exts.resize(count);
 
     for (uint32_t i = 0; i < count; i++) {
         if (strcmp(exts[i].extensionName, VK_EXT_DEBUG_REPORT_EXTENSION_NAME) ==
@@ -321,11 +324,29 @@ bool Hal::InitDebugReportIndex() {
         }
     }
 
-    free(exts);
+    instance_extensions_ = std::move(exts);
+    instance_extensions_cached_ = true;
 
     return true;
 }
 
+VkResult Hal::EnumerateInstanceExtensions(uint32_t* count,
+                                          VkExtensionProperties* props) const {
+    if (!instance_extensions_cached_)
+        return dev_->EnumerateInstanceExtensionProperties(nullptr, count,
+                                                          props);
+
+    const uint32_t total = static_cast<uint32_t>(instance_extensions_.size());
+    if (!props) {
+        *count = total;
+        return VK_SUCCESS;
+    }
+    const uint32_t copied = std::min(*count, total);
+    std::copy_n(instance_extensions_.begin(), copied, props);
+    *count = copied;
+    return copied < total ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
 CreateInfoWrapper::CreateInfoWrapper(const VkInstanceCreateInfo& create_info,
                                      const VkAllocationCallbacks& allocator)
     : is_instance_(true),
@@ -453,8 +474,7 @@ VkResult CreateInfoWrapper::SanitizeExtensions() {
 
 VkResult CreateInfoWrapper::QueryExtensionCount(uint32_t& count) const {
     if (is_instance_) {
-        return Hal::Device().EnumerateInstanceExtensionProperties(
-            nullptr, &count, nullptr);
+        return Hal::Get().EnumerateInstanceExtensions(&count, nullptr);
     } else {
         const auto& driver = GetData(physical_dev_).driver;
         return driver.EnumerateDeviceExtensionProperties(physical_dev_, nullptr,
@@ -466,8 +486,7 @@ VkResult CreateInfoWrapper::EnumerateExtensions(
     uint32_t& count,
     VkExtensionProperties* props) const {
     if (is_instance_) {
-        return Hal::Device().EnumerateInstanceExtensionProperties(
-            nullptr, &count, props);
+        return Hal::Get().EnumerateInstanceExtensions(&count, props);
     } else {
         const auto& driver = GetData(physical_dev_).driver;
         return driver.EnumerateDeviceExtensionProperties(physical_dev_, nullptr,
@@ -856,8 +875,11 @@ VkResult EnumerateInstanceExtensionProperties(
     }
 
     ATRACE_BEGIN("driver.EnumerateInstanceExtensionProperties");
-    VkResult result = Hal::Device().EnumerateInstanceExtensionProperties(
-        pLayerName, pPropertyCount, pProperties);
+    VkResult result =
+        pLayerName ? Hal::Device().EnumerateInstanceExtensionProperties(
+                         pLayerName, pPropertyCount, pProperties)
+                   : Hal::Get().EnumerateInstanceExtensions(pPropertyCount,
+                                                            pProperties);
     ATRACE_END();
 
     if (!pLayerName && (result == VK_SUCCESS || result == VK_INCOMPLETE)) {
@@ -925,7 +947,9 @@ VkResult EnumerateDeviceExtensionProperties(
         VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME,
         VK_KHR_INCREMENTAL_PRESENT_SPEC_VERSION});
 
-    bool hdrBoardConfig =
+    // These are fixed for the life of the device, and each costs a call into
+    // another process, so ask once.
+    static const bool hdrBoardConfig =
         getBool<ISurfaceFlingerConfigs, &ISurfaceFlingerConfigs::hasHDRDisplay>(
             false);
     if (hdrBoardConfig) {
@@ -943,9 +967,12 @@ VkResult EnumerateDeviceExtensionProperties(
 
     // conditionally add VK_GOOGLE_display_timing if present timestamps are
     // supported by the driver:
-    const std::string timestamp_property("service.sf.present_timestamp");
-    android::base::WaitForPropertyCreation(timestamp_property);
-    if (android::base::GetBoolProperty(timestamp_property, true)) {
+    static const bool presentTimestamps = [] {
+        const std::string timestamp_property("service.sf.present_timestamp");
+        android::base::WaitForPropertyCreation(timestamp_property);
+        return android::base::GetBoolProperty(timestamp_property, true);
+    }();
+    if (presentTimestamps) {
         loader_extensions.push_back({
                 VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME,
                 VK_GOOGLE_DISPLAY_TIMING_SPEC_VERSION});
@@ -79,16 +79,19 @@ class LayerLibrary {
           filename_(filename),
           dlhandle_(nullptr),
           native_bridge_(false),
-          refcount_(0) {}
+          refcount_(0),
+          pinned_(false) {}
 
     LayerLibrary(LayerLibrary&& other) noexcept
         : path_(std::move(other.path_)),
           filename_(std::move(other.filename_)),
           dlhandle_(other.dlhandle_),
           native_bridge_(other.native_bridge_),
-          refcount_(other.refcount_) {
+          refcount_(other.refcount_),
+          pinned_(other.pinned_) {
         other.dlhandle_ = nullptr;
         other.refcount_ = 0;
+        other.pinned_ = false;
     }
 
     LayerLibrary(const LayerLibrary&) = delete;
@@ -97,6 +100,10 @@ class LayerLibrary {
     // these are thread-safe
     bool Open();
     void Close();
+    // Like Open(), but the first time it succeeds it also takes a reference
+    // that is never released, so apps that create and destroy instances
+    // repeatedly don't load and unload the library each time.
+    bool OpenAndPin();
 
     bool EnumerateLayers(size_t library_idx,
                          std::vector<Layer>& instance_layers) const;
@@ -108,6 +115,8 @@ class LayerLibrary {
     const std::string GetFilename() { return filename_; }
 
    private:
+    bool OpenLocked();
+
     // TODO(b/79940628): remove that adapter when we could use NativeBridgeGetTrampoline
     // for native libraries.
     template<typename Func = void*>
@@ -128,10 +137,26 @@ class LayerLibrary {
     void* dlhandle_;
     bool native_bridge_;
     size_t refcount_;
+    bool pinned_;
 };
 
 bool LayerLibrary::Open() {
     std::lock_guard<std::mutex> lock(mutex_);
+    return OpenLocked();
+}
+
+bool LayerLibrary::OpenAndPin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!OpenLocked())
+        return false;
+    if (!pinned_) {
+        refcount_++;
+        pinned_ = true;
+    }
+    return true;
+}
+
+bool LayerLibrary::OpenLocked() {
     if (refcount_++ == 0) {
         ALOGV("opening layer library '%s'", path_.c_str());
         // Libraries in the system layer library dir can't be loaded into
@@ -541,7 +566,7 @@ const VkExtensionProperties* FindLayerDeviceExtension(const Layer& layer,
 
 LayerRef GetLayerRef(const Layer& layer) {
     LayerLibrary& library = g_layer_libraries[layer.library_idx];
-    return LayerRef((library.Open()) ? &layer : nullptr);
+    return LayerRef((library.OpenAndPin()) ? &layer : nullptr);
 }
 
 LayerRef::LayerRef(const Layer* layer) : layer_(layer) {}
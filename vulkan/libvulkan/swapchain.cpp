@@ -17,16 +17,21 @@
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
 #include <android/hardware/graphics/common/1.0/types.h>
+#include <cutils/properties.h>
 #include <grallocusage/GrallocUsageConversion.h>
 #include <log/log.h>
 #include <sync/sync.h>
 #include <system/window.h>
 #include <ui/BufferQueueDefs.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 #include <utils/Vector.h>
 
+#include <time.h>
+
 #include <algorithm>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -201,6 +206,104 @@ class TimingInfo {
             { NATIVE_WINDOW_TIMESTAMP_PENDING };
 };
 
+// Paces FIFO presents for apps that don't set their own desiredPresentTime,
+// when debug.vulkan.frame_pacing is set.
+//
+// Each frame is given a present time on the display's vsync grid, a whole
+// number of refresh cycles after the previous one. The number of cycles is
+// the fewest that fit the time the app spends between acquiring and
+// presenting an image, so a game that can't make 60fps settles at a steady
+// 30fps instead of alternating between the two. The vsync predictions come
+// from the compositor timing SurfaceFlinger sends along with the frame
+// events, so no extra queries are made.
+//
+// Acquiring the next image is held back until the previous frame's
+// composition deadline, so the app doesn't render frames ahead only to wait
+// for them in the queue, which would add latency without making frames
+// any more regular.
+class FramePacer {
+   public:
+    // Returns how long to sleep before dequeueing the next buffer.
+    int64_t get_acquire_delay(int64_t now) const {
+        if (!last_target_present_) {
+            return 0;
+        }
+        const int64_t wake = last_target_present_ - composite_to_present_;
+        if (wake <= now || wake - now > 2 * max_interval()) {
+            return 0;
+        }
+        return wake - now;
+    }
+
+    void on_acquired(int64_t now) { last_acquire_ = now; }
+
+    // Returns the timestamp to queue the next buffer with, or 0 to queue it
+    // without one.
+    int64_t on_present(ANativeWindow* window, int64_t now) {
+        int64_t composite_deadline = 0;
+        int64_t composite_interval = 0;
+        int64_t composite_to_present = 0;
+        if (native_window_get_compositor_timing(window, &composite_deadline,
+                                                &composite_interval,
+                                                &composite_to_present) !=
+                android::NO_ERROR ||
+            composite_interval <= 0) {
+            reset();
+            return 0;
+        }
+        composite_interval_ = composite_interval;
+        composite_to_present_ = composite_to_present;
+
+        if (last_acquire_) {
+            const int64_t work = now - last_acquire_;
+            work_average_ = work_average_
+                    ? work_average_ - work_average_ / 8 + work / 8
+                    : work;
+        }
+        const int64_t cycles = std::min<int64_t>(
+                std::max<int64_t>(
+                        (work_average_ + composite_interval - 1) /
+                                composite_interval,
+                        1),
+                kMaxCycles);
+
+        // The earliest this frame can reach the display
+        const int64_t earliest = composite_deadline + composite_to_present;
+        int64_t target = earliest;
+        if (last_target_present_) {
+            const int64_t wanted =
+                    last_target_present_ + cycles * composite_interval;
+            if (wanted > earliest) {
+                // Snap to the vsync nearest to wanted
+                target += (wanted - earliest + composite_interval / 2) /
+                        composite_interval * composite_interval;
+            }
+        }
+        last_target_present_ = target;
+        ATRACE_INT("FramePacer cycles", static_cast<int32_t>(cycles));
+
+        // SurfaceFlinger holds a buffer until the vsync whose expected present
+        // time is past its timestamp. Going half a cycle early leaves room for
+        // prediction error in either direction.
+        return target - composite_interval / 2;
+    }
+
+    // Forgets the current schedule, e.g. when the app sets present times
+    // itself.
+    void reset() { last_target_present_ = 0; }
+
+   private:
+    static constexpr int64_t kMaxCycles = 4;
+
+    int64_t max_interval() const { return kMaxCycles * composite_interval_; }
+
+    int64_t last_acquire_{0};
+    int64_t work_average_{0};
+    int64_t last_target_present_{0};
+    int64_t composite_interval_{0};
+    int64_t composite_to_present_{0};
+};
+
 // ----------------------------------------------------------------------------
 
 struct Surface {
@@ -234,11 +337,18 @@ struct Swapchain {
           pre_transform(pre_transform_),
           frame_timestamps_enabled(false),
           shared(present_mode == VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR ||
-                 present_mode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR) {
+                 present_mode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR),
+          frame_pacing(!mailbox_mode && !shared &&
+                       property_get_bool("debug.vulkan.frame_pacing", false)) {
         ANativeWindow* window = surface.window.get();
         native_window_get_refresh_cycle_duration(
             window,
             &refresh_duration);
+        if (frame_pacing) {
+            // The pacer needs the compositor timing the frame events carry
+            native_window_enable_frame_timestamps(window, true);
+            frame_timestamps_enabled = true;
+        }
     }
     uint64_t get_refresh_duration()
     {
@@ -257,6 +367,16 @@ struct Swapchain {
     bool frame_timestamps_enabled;
     int64_t refresh_duration;
     bool shared;
+    bool frame_pacing;
+    FramePacer pacer;
+
+    // What the images were created with, to tell whether a swapchain
+    // replacing this one can take over its buffers
+    VkSwapchainCreateFlagsKHR flags;
+    VkFormat image_format;
+    VkImageUsageFlags image_usage;
+    VkPresentModeKHR present_mode;
+    uint32_t min_image_count;
 
     struct Image {
         Image() : image(VK_NULL_HANDLE), dequeue_fence(-1), dequeued(false) {}
@@ -330,6 +450,46 @@ void ReleaseSwapchainImage(VkDevice device,
     image.buffer.clear();
 }
 
+// Whether the buffers of swapchain, which is being replaced, fit the
+// swapchain create_info describes. If nothing the buffers depend on changes,
+// as when the app only changes the pre-transform after a rotation, the new
+// swapchain can use the buffers that are in the window's queue already
+// instead of having new ones allocated.
+bool CanReuseSwapchainBuffers(const Swapchain& swapchain,
+                              const VkSwapchainCreateInfoKHR& create_info) {
+    if (swapchain.shared || swapchain.flags != create_info.flags ||
+        swapchain.image_format != create_info.imageFormat ||
+        swapchain.image_usage != create_info.imageUsage ||
+        swapchain.present_mode != create_info.presentMode ||
+        swapchain.min_image_count != create_info.minImageCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < swapchain.num_images; i++) {
+        const Swapchain::Image& img = swapchain.images[i];
+        // Images the app still holds stay with it
+        if (img.dequeued || !img.buffer ||
+            static_cast<uint32_t>(img.buffer->width) !=
+                    create_info.imageExtent.width ||
+            static_cast<uint32_t>(img.buffer->height) !=
+                    create_info.imageExtent.height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Freeing a buffer unmaps and frees its memory, which can take a while, so
+// the last references to the buffers of a replaced swapchain are dropped on
+// another thread.
+void ReleaseBuffersAsync(std::vector<android::sp<ANativeWindowBuffer>> buffers) {
+    if (buffers.empty())
+        return;
+    std::thread([buffers = std::move(buffers)]() mutable {
+        ATRACE_NAME("ReleaseSwapchainBuffers");
+        buffers.clear();
+    }).detach();
+}
+
 void OrphanSwapchain(VkDevice device, Swapchain* swapchain) {
     if (swapchain->surface.swapchain_handle != HandleFromSwapchain(swapchain))
         return;
@@ -1038,8 +1198,20 @@ VkResult CreateSwapchainKHR(VkDevice device,
               reinterpret_cast<uint64_t>(create_info->oldSwapchain));
         return VK_ERROR_NATIVE_WINDOW_IN_USE_KHR;
     }
-    if (create_info->oldSwapchain != VK_NULL_HANDLE)
-        OrphanSwapchain(device, SwapchainFromHandle(create_info->oldSwapchain));
+    // The old swapchain's buffers, which are either taken over or released
+    // once the window no longer references them either.
+    std::vector<android::sp<ANativeWindowBuffer>> old_buffers;
+    bool reuse_buffers = false;
+    if (create_info->oldSwapchain != VK_NULL_HANDLE) {
+        Swapchain* old_swapchain = SwapchainFromHandle(create_info->oldSwapchain);
+        reuse_buffers = CanReuseSwapchainBuffers(*old_swapchain, *create_info);
+        for (uint32_t i = 0; i < old_swapchain->num_images; i++) {
+            const Swapchain::Image& img = old_swapchain->images[i];
+            if (!img.dequeued && img.buffer)
+                old_buffers.push_back(img.buffer);
+        }
+        OrphanSwapchain(device, old_swapchain);
+    }
 
     // -- Reset the native window --
     // The native window might have been used previously, and had its properties
@@ -1051,21 +1223,24 @@ VkResult CreateSwapchainKHR(VkDevice device,
     // been queued, since after that point at least one is assumed to be in
     // non-FREE state at any given time. Disconnecting and re-connecting
     // orphans the previous buffers, getting us back to the state where we can
-    // dequeue all buffers.
-    err = native_window_api_disconnect(surface.window.get(),
-                                       NATIVE_WINDOW_API_EGL);
-    ALOGW_IF(err != 0, "native_window_api_disconnect failed: %s (%d)",
-             strerror(-err), err);
-    err =
-        native_window_api_connect(surface.window.get(), NATIVE_WINDOW_API_EGL);
-    ALOGW_IF(err != 0, "native_window_api_connect failed: %s (%d)",
-             strerror(-err), err);
-
-    err = native_window_set_buffer_count(surface.window.get(), 0);
-    if (err != 0) {
-        ALOGE("native_window_set_buffer_count(0) failed: %s (%d)",
-              strerror(-err), err);
-        return VK_ERROR_SURFACE_LOST_KHR;
+    // dequeue all buffers. When the old buffers are reused, they stay queued
+    // instead, along with the buffer count they were dequeued under.
+    if (!reuse_buffers) {
+        err = native_window_api_disconnect(surface.window.get(),
+                                           NATIVE_WINDOW_API_EGL);
+        ALOGW_IF(err != 0, "native_window_api_disconnect failed: %s (%d)",
+                 strerror(-err), err);
+        err = native_window_api_connect(surface.window.get(),
+                                        NATIVE_WINDOW_API_EGL);
+        ALOGW_IF(err != 0, "native_window_api_connect failed: %s (%d)",
+                 strerror(-err), err);
+
+        err = native_window_set_buffer_count(surface.window.get(), 0);
+        if (err != 0) {
+            ALOGE("native_window_set_buffer_count(0) failed: %s (%d)",
+                  strerror(-err), err);
+            return VK_ERROR_SURFACE_LOST_KHR;
+        }
     }
 
     int swap_interval =
@@ -1193,13 +1368,22 @@ VkResult CreateSwapchainKHR(VkDevice device,
         (swap_interval ? create_info->minImageCount
                        : std::max(3u, create_info->minImageCount)) -
         1 + min_undequeued_buffers;
+    if (reuse_buffers && num_images != old_buffers.size()) {
+        // Can't happen for the same present mode and minImageCount, but the
+        // buffers can't be reused without the window to dequeue more from
+        ALOGE("Swapchain needs %u images, but the one it replaces had %zu",
+              num_images, old_buffers.size());
+        return VK_ERROR_OUT_OF_DATE_KHR;
+    }
 
     // Lower layer insists that we have at least two buffers. This is wasteful
     // and we'd like to relax it in the shared case, but not all the pieces are
     // in place for that to work yet. Note we only lie to the lower layer-- we
     // don't want to give the app back a swapchain with extra images (which they
     // can't actually use!).
-    err = native_window_set_buffer_count(surface.window.get(), std::max(2u, num_images));
+    err = reuse_buffers ? 0
+                        : native_window_set_buffer_count(surface.window.get(),
+                                                         std::max(2u, num_images));
     if (err != 0) {
         // TODO(jessehall): Improve error reporting. Can we enumerate possible
         // errors and translate them to valid Vulkan result codes?
@@ -1259,6 +1443,11 @@ VkResult CreateSwapchainKHR(VkDevice device,
     Swapchain* swapchain = new (mem)
         Swapchain(surface, num_images, create_info->presentMode,
                   TranslateVulkanToNativeTransform(create_info->preTransform));
+    swapchain->flags = create_info->flags;
+    swapchain->image_format = create_info->imageFormat;
+    swapchain->image_usage = create_info->imageUsage;
+    swapchain->present_mode = create_info->presentMode;
+    swapchain->min_image_count = create_info->minImageCount;
     // -- Dequeue all buffers and create a VkImage for each --
     // Any failures during or after this must cancel the dequeued buffers.
 
@@ -1297,18 +1486,24 @@ VkResult CreateSwapchainKHR(VkDevice device,
     for (uint32_t i = 0; i < num_images; i++) {
         Swapchain::Image& img = swapchain->images[i];
 
-        ANativeWindowBuffer* buffer;
-        err = surface.window->dequeueBuffer(surface.window.get(), &buffer,
-                                            &img.dequeue_fence);
-        if (err != 0) {
-            // TODO(jessehall): Improve error reporting. Can we enumerate
-            // possible errors and translate them to valid Vulkan result codes?
-            ALOGE("dequeueBuffer[%u] failed: %s (%d)", i, strerror(-err), err);
-            result = VK_ERROR_SURFACE_LOST_KHR;
-            break;
+        if (reuse_buffers) {
+            img.buffer = old_buffers[i];
+        } else {
+            ANativeWindowBuffer* buffer;
+            err = surface.window->dequeueBuffer(surface.window.get(), &buffer,
+                                                &img.dequeue_fence);
+            if (err != 0) {
+                // TODO(jessehall): Improve error reporting. Can we enumerate
+                // possible errors and translate them to valid Vulkan result
+                // codes?
+                ALOGE("dequeueBuffer[%u] failed: %s (%d)", i, strerror(-err),
+                      err);
+                result = VK_ERROR_SURFACE_LOST_KHR;
+                break;
+            }
+            img.buffer = buffer;
+            img.dequeued = true;
         }
-        img.buffer = buffer;
-        img.dequeued = true;
 
         image_create.extent =
             VkExtent3D{static_cast<uint32_t>(img.buffer->width),
@@ -1357,6 +1552,11 @@ VkResult CreateSwapchainKHR(VkDevice device,
         }
     }
 
+    if (!reuse_buffers) {
+        // The window let go of these when it was reconnected
+        ReleaseBuffersAsync(std::move(old_buffers));
+    }
+
     if (result != VK_SUCCESS) {
         swapchain->~Swapchain();
         allocator->pfnFree(allocator->pUserData, swapchain);
@@ -1381,7 +1581,7 @@ void DestroySwapchainKHR(VkDevice device,
     bool active = swapchain->surface.swapchain_handle == swapchain_handle;
     ANativeWindow* window = active ? swapchain->surface.window.get() : nullptr;
 
-    if (swapchain->frame_timestamps_enabled) {
+    if (swapchain->frame_timestamps_enabled && window) {
         native_window_enable_frame_timestamps(window, false);
     }
     for (uint32_t i = 0; i < swapchain->num_images; i++)
@@ -1439,10 +1639,6 @@ VkResult AcquireNextImageKHR(VkDevice device,
     if (swapchain.surface.swapchain_handle != swapchain_handle)
         return VK_ERROR_OUT_OF_DATE_KHR;
 
-    ALOGW_IF(
-        timeout != UINT64_MAX,
-        "vkAcquireNextImageKHR: non-infinite timeouts not yet implemented");
-
     if (swapchain.shared) {
         // In shared mode, we keep the buffer dequeued all the time, so we don't
         // want to dequeue a buffer here. Instead, just ask the driver to ensure
@@ -1453,15 +1649,72 @@ VkResult AcquireNextImageKHR(VkDevice device,
         return result;
     }
 
+    // Timeouts too long to fit an int64_t are as good as infinite
+    const int64_t dequeue_timeout =
+            timeout > static_cast<uint64_t>(INT64_MAX)
+                    ? -1
+                    : static_cast<int64_t>(timeout);
+    // A zero timeout is a poll
+    const VkResult timeout_result = timeout ? VK_TIMEOUT : VK_NOT_READY;
+
+    if (swapchain.frame_pacing) {
+        int64_t delay =
+                swapchain.pacer.get_acquire_delay(systemTime(SYSTEM_TIME_MONOTONIC));
+        const bool pacer_times_out =
+                dequeue_timeout >= 0 && delay >= dequeue_timeout;
+        if (pacer_times_out) {
+            delay = dequeue_timeout;
+        }
+        if (delay > 0) {
+            ATRACE_NAME("FramePacer stall");
+            struct timespec ts = {
+                    .tv_sec = static_cast<time_t>(delay / 1000000000),
+                    .tv_nsec = static_cast<long>(delay % 1000000000),
+            };
+            nanosleep(&ts, nullptr);
+        }
+        if (pacer_times_out) {
+            return timeout_result;
+        }
+    }
+
+    // The window blocks in dequeueBuffer by default. A finite timeout only
+    // applies to this dequeue: it is set just before it and the default is
+    // restored right after, so other users of the window, and later
+    // acquires with an infinite timeout, keep blocking. Windows that don't
+    // support it keep blocking, as they always have.
+    bool dequeue_timeout_set = false;
+    if (dequeue_timeout >= 0) {
+        err = native_window_set_dequeue_timeout(window, dequeue_timeout);
+        ALOGW_IF(err != 0,
+                 "native_window_set_dequeue_timeout(%" PRId64 ") failed: %s (%d)",
+                 dequeue_timeout, strerror(-err), err);
+        dequeue_timeout_set = err == 0;
+    }
+
     ANativeWindowBuffer* buffer;
     int fence_fd;
     err = window->dequeueBuffer(window, &buffer, &fence_fd);
+    if (dequeue_timeout_set) {
+        int restore_err = native_window_set_dequeue_timeout(window, -1);
+        ALOGW_IF(restore_err != 0,
+                 "native_window_set_dequeue_timeout(-1) failed: %s (%d)",
+                 strerror(-restore_err), restore_err);
+    }
+    if (err == android::TIMED_OUT || err == android::WOULD_BLOCK) {
+        ALOGV("dequeueBuffer returned no buffer in time: %s (%d)",
+              strerror(-err), err);
+        return timeout_result;
+    }
     if (err != 0) {
         // TODO(jessehall): Improve error reporting. Can we enumerate possible
         // errors and translate them to valid Vulkan result codes?
         ALOGE("dequeueBuffer failed: %s (%d)", strerror(-err), err);
         return VK_ERROR_SURFACE_LOST_KHR;
     }
+    if (swapchain.frame_pacing) {
+        swapchain.pacer.on_acquired(systemTime(SYSTEM_TIME_MONOTONIC));
+    }
 
     uint32_t idx;
     for (idx = 0; idx < swapchain.num_images; idx++) {
@@ -1688,6 +1941,19 @@ VkResult QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* present_info) {
                             static_cast<int64_t>(time->desiredPresentTime));
                     }
                 }
+                if (swapchain.frame_pacing) {
+                    if (time && time->desiredPresentTime) {
+                        // The app is pacing itself
+                        swapchain.pacer.reset();
+                    } else {
+                        int64_t timestamp = swapchain.pacer.on_present(
+                                window, systemTime(SYSTEM_TIME_MONOTONIC));
+                        native_window_set_buffers_timestamp(
+                                window,
+                                timestamp ? timestamp
+                                          : NATIVE_WINDOW_TIMESTAMP_AUTO);
+                    }
+                }
 
                 err = window->queueBuffer(window, img.buffer.get(), fence);
                 // queueBuffer always closes fence, even on error
@@ -24,7 +24,10 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <new>
 
+#include <cutils/properties.h>
 #include <log/log.h>
 
 #include "null_driver_gen.h"
@@ -48,6 +51,15 @@ struct VkQueue_T {
 
 struct VkCommandBuffer_T {
     hwvulkan_dispatch_t dispatch;
+    // The rest is only used in perf mode, see RecordCommand.
+    VkDevice_T* device;
+    VkAllocationCallbacks allocator;
+    uint8_t* commands;
+    size_t commands_size;
+    size_t commands_capacity;
+    size_t last_command;
+    uint64_t command_count;
+    bool out_of_memory;
 };
 
 namespace {
@@ -93,6 +105,48 @@ enum Enum {
 
 const VkDeviceSize kMaxDeviceMemory = 0x10000000;  // 256 MiB, arbitrary
 
+// In perf mode (debug.vulkan.nulldrv.perf=1 when the device is created) the
+// driver does the CPU-side work a real driver would for the common commands,
+// so that it can be used to measure loader, layer and dispatch overhead
+// without any vendor code: command buffers encode their commands into a
+// linear buffer that is reused across recordings, and the device counts what
+// was created, recorded and submitted, which is logged when it is destroyed.
+struct PerfCounters {
+    std::atomic<uint64_t> handles_allocated;
+    std::atomic<uint64_t> command_buffers_recorded;
+    std::atomic<uint64_t> commands_recorded;
+    std::atomic<uint64_t> command_bytes_recorded;
+    std::atomic<uint64_t> queue_submits;
+    std::atomic<uint64_t> command_buffers_submitted;
+};
+
+// A recorded command is a CommandHeader followed by its arguments and then
+// any arrays it was given. size covers all of them.
+enum CommandId : uint32_t {
+    kCmdBindPipeline,
+    kCmdSetViewport,
+    kCmdSetScissor,
+    kCmdBindDescriptorSets,
+    kCmdBindIndexBuffer,
+    kCmdBindVertexBuffers,
+    kCmdDraw,
+    kCmdDrawIndexed,
+    kCmdDispatch,
+    kCmdCopyBuffer,
+    kCmdPipelineBarrier,
+    kCmdPushConstants,
+    kCmdBeginRenderPass,
+    kCmdNextSubpass,
+    kCmdEndRenderPass,
+};
+
+struct CommandHeader {
+    uint32_t id;
+    uint32_t size;
+};
+
+const size_t kMinCommandsCapacity = 4096;
+
 }  // anonymous namespace
 
 struct VkDevice_T {
@@ -101,6 +155,8 @@ struct VkDevice_T {
     VkInstance_T* instance;
     VkQueue_T queue;
     std::array<uint64_t, HandleType::kNumTypes> next_handle;
+    bool perf_mode;
+    PerfCounters perf;
 };
 
 // -----------------------------------------------------------------------------
@@ -167,6 +223,11 @@ VkInstance_T* GetInstanceFromPhysicalDevice(
         offsetof(VkInstance_T, physical_device));
 }
 
+VkDevice_T* GetDeviceFromQueue(VkQueue_T* queue) {
+    return reinterpret_cast<VkDevice_T*>(reinterpret_cast<uintptr_t>(queue) -
+                                         offsetof(VkDevice_T, queue));
+}
+
 uint64_t AllocHandle(uint64_t type, uint64_t* next_handle) {
     const uint64_t kHandleMask = (UINT64_C(1) << 56) - 1;
     ALOGE_IF(*next_handle == kHandleMask,
@@ -185,6 +246,8 @@ Handle AllocHandle(VkInstance instance, HandleType::Enum type) {
 
 template <class Handle>
 Handle AllocHandle(VkDevice device, HandleType::Enum type) {
+    if (device->perf_mode)
+        device->perf.handles_allocated.fetch_add(1, std::memory_order_relaxed);
     return reinterpret_cast<Handle>(
         AllocHandle(type, &device->next_handle[type]));
 }
@@ -676,6 +739,9 @@ VkResult CreateDevice(VkPhysicalDevice physical_device,
     device->queue.dispatch.magic = HWVULKAN_DISPATCH_MAGIC;
     std::fill(device->next_handle.begin(), device->next_handle.end(),
               UINT64_C(0));
+    device->perf_mode = property_get_bool("debug.vulkan.nulldrv.perf", false);
+    new (&device->perf) PerfCounters();
+    ALOGI_IF(device->perf_mode, "Perf mode enabled");
 
     for (uint32_t i = 0; i < create_info->enabledExtensionCount; i++) {
         if (strcmp(create_info->ppEnabledExtensionNames[i],
@@ -692,6 +758,16 @@ void DestroyDevice(VkDevice device,
                    const VkAllocationCallbacks* /*allocator*/) {
     if (!device)
         return;
+    if (device->perf_mode) {
+        const PerfCounters& perf = device->perf;
+        ALOGI("Perf counters: %" PRIu64 " handles allocated, %" PRIu64
+              " command buffers recorded with %" PRIu64 " commands (%" PRIu64
+              " bytes), %" PRIu64 " queue submits of %" PRIu64
+              " command buffers",
+              perf.handles_allocated.load(), perf.command_buffers_recorded.load(),
+              perf.commands_recorded.load(), perf.command_bytes_recorded.load(),
+              perf.queue_submits.load(), perf.command_buffers_submitted.load());
+    }
     device->allocator.pfnFree(device->allocator.pUserData, device);
 }
 
@@ -734,7 +810,93 @@ void DestroyCommandPool(VkDevice /*device*/,
 // -----------------------------------------------------------------------------
 // CmdBuffer
 
-VkResult AllocateCommandBuffers(VkDevice /*device*/,
+namespace {
+
+size_t ArgsSize() {
+    return 0;
+}
+
+template <typename T, typename... Rest>
+size_t ArgsSize(const T&, const Rest&... rest) {
+    return sizeof(T) + ArgsSize(rest...);
+}
+
+void CopyArgs(uint8_t*) {}
+
+template <typename T, typename... Rest>
+void CopyArgs(uint8_t* dst, const T& arg, const Rest&... rest) {
+    memcpy(dst, &arg, sizeof(T));
+    CopyArgs(dst + sizeof(T), rest...);
+}
+
+void ResetCommands(VkCommandBuffer cmdbuf) {
+    cmdbuf->commands_size = 0;
+    cmdbuf->last_command = 0;
+    cmdbuf->command_count = 0;
+    cmdbuf->out_of_memory = false;
+}
+
+// Returns size bytes at the end of the command buffer's commands, growing
+// them if needed, or nullptr if they couldn't be grown.
+uint8_t* AllocCommandSpace(VkCommandBuffer cmdbuf, size_t size) {
+    if (cmdbuf->out_of_memory)
+        return nullptr;
+    if (cmdbuf->commands_size + size > cmdbuf->commands_capacity) {
+        size_t capacity = std::max(
+            {kMinCommandsCapacity, cmdbuf->commands_capacity * 2,
+             cmdbuf->commands_size + size});
+        void* commands = cmdbuf->allocator.pfnReallocation(
+            cmdbuf->allocator.pUserData, cmdbuf->commands, capacity,
+            alignof(CommandHeader), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+        if (!commands) {
+            cmdbuf->out_of_memory = true;
+            return nullptr;
+        }
+        cmdbuf->commands = static_cast<uint8_t*>(commands);
+        cmdbuf->commands_capacity = capacity;
+    }
+    uint8_t* dst = cmdbuf->commands + cmdbuf->commands_size;
+    cmdbuf->commands_size += size;
+    return dst;
+}
+
+// Appends a command with the given arguments in perf mode.
+template <typename... Args>
+void RecordCommand(VkCommandBuffer cmdbuf, CommandId id, const Args&... args) {
+    if (!cmdbuf->device->perf_mode)
+        return;
+    const size_t offset = cmdbuf->commands_size;
+    const CommandHeader header = {
+        id, static_cast<uint32_t>(sizeof(CommandHeader) + ArgsSize(args...))};
+    uint8_t* dst = AllocCommandSpace(cmdbuf, header.size);
+    if (!dst)
+        return;
+    CopyArgs(dst, header, args...);
+    cmdbuf->last_command = offset;
+    cmdbuf->command_count++;
+}
+
+// Appends count elements of data to the last command recorded in perf mode.
+template <typename T>
+void RecordCommandArray(VkCommandBuffer cmdbuf, const T* data, uint32_t count) {
+    if (!cmdbuf->device->perf_mode || cmdbuf->command_count == 0 || !data ||
+        count == 0)
+        return;
+    const size_t size = sizeof(T) * count;
+    uint8_t* dst = AllocCommandSpace(cmdbuf, size);
+    if (!dst)
+        return;
+    memcpy(dst, data, size);
+
+    CommandHeader header;
+    memcpy(&header, cmdbuf->commands + cmdbuf->last_command, sizeof(header));
+    header.size += static_cast<uint32_t>(size);
+    memcpy(cmdbuf->commands + cmdbuf->last_command, &header, sizeof(header));
+}
+
+}  // namespace
+
+VkResult AllocateCommandBuffers(VkDevice device,
                                 const VkCommandBufferAllocateInfo* alloc_info,
                                 VkCommandBuffer* cmdbufs) {
     VkResult result = VK_SUCCESS;
@@ -750,6 +912,11 @@ VkResult AllocateCommandBuffers(VkDevice /*device*/,
             break;
         }
         cmdbufs[i]->dispatch.magic = HWVULKAN_DISPATCH_MAGIC;
+        cmdbufs[i]->device = device;
+        cmdbufs[i]->allocator = pool.allocator;
+        cmdbufs[i]->commands = nullptr;
+        cmdbufs[i]->commands_capacity = 0;
+        ResetCommands(cmdbufs[i]);
     }
     if (result != VK_SUCCESS) {
         for (uint32_t i = 0; i < alloc_info->commandBufferCount; i++) {
@@ -766,8 +933,12 @@ void FreeCommandBuffers(VkDevice /*device*/,
                         uint32_t count,
                         const VkCommandBuffer* cmdbufs) {
     CommandPool& pool = *GetCommandPoolFromHandle(cmd_pool);
-    for (uint32_t i = 0; i < count; i++)
+    for (uint32_t i = 0; i < count; i++) {
+        if (cmdbufs[i] && cmdbufs[i]->commands)
+            pool.allocator.pfnFree(pool.allocator.pUserData,
+                                   cmdbufs[i]->commands);
         pool.allocator.pfnFree(pool.allocator.pUserData, cmdbufs[i]);
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -1156,6 +1327,14 @@ VkResult EnumerateInstanceLayerProperties(uint32_t* pCount, VkLayerProperties* p
 }
 
 VkResult QueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* pSubmitInfo, VkFence fence) {
+    VkDevice_T* device = GetDeviceFromQueue(queue);
+    if (device->perf_mode) {
+        uint64_t cmdbuf_count = 0;
+        for (uint32_t i = 0; i < submitCount; i++)
+            cmdbuf_count += pSubmitInfo[i].commandBufferCount;
+        device->perf.queue_submits.fetch_add(1, std::memory_order_relaxed);
+        device->perf.command_buffers_submitted.fetch_add(cmdbuf_count, std::memory_order_relaxed);
+    }
     return VK_SUCCESS;
 }
 
@@ -1331,25 +1510,37 @@ VkResult ResetCommandPool(VkDevice device, VkCommandPool cmdPool, VkCommandPoolR
 }
 
 VkResult BeginCommandBuffer(VkCommandBuffer cmdBuffer, const VkCommandBufferBeginInfo* pBeginInfo) {
+    ResetCommands(cmdBuffer);
     return VK_SUCCESS;
 }
 
 VkResult EndCommandBuffer(VkCommandBuffer cmdBuffer) {
-    return VK_SUCCESS;
+    VkDevice_T* device = cmdBuffer->device;
+    if (device->perf_mode) {
+        device->perf.command_buffers_recorded.fetch_add(1, std::memory_order_relaxed);
+        device->perf.commands_recorded.fetch_add(cmdBuffer->command_count, std::memory_order_relaxed);
+        device->perf.command_bytes_recorded.fetch_add(cmdBuffer->commands_size, std::memory_order_relaxed);
+    }
+    return cmdBuffer->out_of_memory ? VK_ERROR_OUT_OF_HOST_MEMORY : VK_SUCCESS;
 }
 
 VkResult ResetCommandBuffer(VkCommandBuffer cmdBuffer, VkCommandBufferResetFlags flags) {
-    ALOGV("TODO: vk%s", __FUNCTION__);
+    ResetCommands(cmdBuffer);
     return VK_SUCCESS;
 }
 
 void CmdBindPipeline(VkCommandBuffer cmdBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipeline pipeline) {
+    RecordCommand(cmdBuffer, kCmdBindPipeline, pipelineBindPoint, pipeline);
 }
 
 void CmdSetViewport(VkCommandBuffer cmdBuffer, uint32_t firstViewport, uint32_t viewportCount, const VkViewport* pViewports) {
+    RecordCommand(cmdBuffer, kCmdSetViewport, firstViewport, viewportCount);
+    RecordCommandArray(cmdBuffer, pViewports, viewportCount);
 }
 
 void CmdSetScissor(VkCommandBuffer cmdBuffer, uint32_t firstScissor, uint32_t scissorCount, const VkRect2D* pScissors) {
+    RecordCommand(cmdBuffer, kCmdSetScissor, firstScissor, scissorCount);
+    RecordCommandArray(cmdBuffer, pScissors, scissorCount);
 }
 
 void CmdSetLineWidth(VkCommandBuffer cmdBuffer, float lineWidth) {
@@ -1374,18 +1565,27 @@ void CmdSetStencilReference(VkCommandBuffer cmdBuffer, VkStencilFaceFlags faceMa
 }
 
 void CmdBindDescriptorSets(VkCommandBuffer cmdBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount, const VkDescriptorSet* pDescriptorSets, uint32_t dynamicOffsetCount, const uint32_t* pDynamicOffsets) {
+    RecordCommand(cmdBuffer, kCmdBindDescriptorSets, pipelineBindPoint, layout, firstSet, setCount, dynamicOffsetCount);
+    RecordCommandArray(cmdBuffer, pDescriptorSets, setCount);
+    RecordCommandArray(cmdBuffer, pDynamicOffsets, dynamicOffsetCount);
 }
 
 void CmdBindIndexBuffer(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+    RecordCommand(cmdBuffer, kCmdBindIndexBuffer, buffer, offset, indexType);
 }
 
 void CmdBindVertexBuffers(VkCommandBuffer cmdBuffer, uint32_t startBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets) {
+    RecordCommand(cmdBuffer, kCmdBindVertexBuffers, startBinding, bindingCount);
+    RecordCommandArray(cmdBuffer, pBuffers, bindingCount);
+    RecordCommandArray(cmdBuffer, pOffsets, bindingCount);
 }
 
 void CmdDraw(VkCommandBuffer cmdBuffer, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+    RecordCommand(cmdBuffer, kCmdDraw, vertexCount, instanceCount, firstVertex, firstInstance);
 }
 
 void CmdDrawIndexed(VkCommandBuffer cmdBuffer, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
+    RecordCommand(cmdBuffer, kCmdDrawIndexed, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
 void CmdDrawIndirect(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t count, uint32_t stride) {
@@ -1395,12 +1595,15 @@ void CmdDrawIndexedIndirect(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDevice
 }
 
 void CmdDispatch(VkCommandBuffer cmdBuffer, uint32_t x, uint32_t y, uint32_t z) {
+    RecordCommand(cmdBuffer, kCmdDispatch, x, y, z);
 }
 
 void CmdDispatchIndirect(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset) {
 }
 
 void CmdCopyBuffer(VkCommandBuffer cmdBuffer, VkBuffer srcBuffer, VkBuffer destBuffer, uint32_t regionCount, const VkBufferCopy* pRegions) {
+    RecordCommand(cmdBuffer, kCmdCopyBuffer, srcBuffer, destBuffer, regionCount);
+    RecordCommandArray(cmdBuffer, pRegions, regionCount);
 }
 
 void CmdCopyImage(VkCommandBuffer cmdBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkImage destImage, VkImageLayout destImageLayout, uint32_t regionCount, const VkImageCopy* pRegions) {
@@ -1443,6 +1646,10 @@ void CmdWaitEvents(VkCommandBuffer commandBuffer, uint32_t eventCount, const VkE
 }
 
 void CmdPipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, VkDependencyFlags dependencyFlags, uint32_t memoryBarrierCount, const VkMemoryBarrier* pMemoryBarriers, uint32_t bufferMemoryBarrierCount, const VkBufferMemoryBarrier* pBufferMemoryBarriers, uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier* pImageMemoryBarriers) {
+    RecordCommand(commandBuffer, kCmdPipelineBarrier, srcStageMask, dstStageMask, dependencyFlags, memoryBarrierCount, bufferMemoryBarrierCount, imageMemoryBarrierCount);
+    RecordCommandArray(commandBuffer, pMemoryBarriers, memoryBarrierCount);
+    RecordCommandArray(commandBuffer, pBufferMemoryBarriers, bufferMemoryBarrierCount);
+    RecordCommandArray(commandBuffer, pImageMemoryBarriers, imageMemoryBarrierCount);
 }
 
 void CmdBeginQuery(VkCommandBuffer cmdBuffer, VkQueryPool queryPool, uint32_t slot, VkQueryControlFlags flags) {
@@ -1461,15 +1668,21 @@ void CmdCopyQueryPoolResults(VkCommandBuffer cmdBuffer, VkQueryPool queryPool, u
 }
 
 void CmdPushConstants(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t start, uint32_t length, const void* values) {
+    RecordCommand(cmdBuffer, kCmdPushConstants, layout, stageFlags, start, length);
+    RecordCommandArray(cmdBuffer, static_cast<const uint8_t*>(values), length);
 }
 
 void CmdBeginRenderPass(VkCommandBuffer cmdBuffer, const VkRenderPassBeginInfo* pRenderPassBegin, VkSubpassContents contents) {
+    RecordCommand(cmdBuffer, kCmdBeginRenderPass, pRenderPassBegin->renderPass, pRenderPassBegin->framebuffer, pRenderPassBegin->renderArea, pRenderPassBegin->clearValueCount, contents);
+    RecordCommandArray(cmdBuffer, pRenderPassBegin->pClearValues, pRenderPassBegin->clearValueCount);
 }
 
 void CmdNextSubpass(VkCommandBuffer cmdBuffer, VkSubpassContents contents) {
+    RecordCommand(cmdBuffer, kCmdNextSubpass, contents);
 }
 
 void CmdEndRenderPass(VkCommandBuffer cmdBuffer) {
+    RecordCommand(cmdBuffer, kCmdEndRenderPass);
 }
 
 void CmdExecuteCommands(VkCommandBuffer cmdBuffer, uint32_t cmdBuffersCount, const VkCommandBuffer* pCmdBuffers) {